@@ -28,6 +28,15 @@
 #include "unit-def.h"
 #include "unit-name.h"
 
+/* Maximum number of GetAll() calls for unit properties we keep in flight at the same time */
+#define SECURITY_QUERIES_IN_FLIGHT_MAX 64U
+
+typedef struct SecurityQuery {
+        const char *name;
+        sd_bus_slot *slot;
+        sd_bus_message *reply;
+} SecurityQuery;
+
 struct security_info {
         char *id;
         char *type;
@@ -1951,7 +1960,7 @@ static int property_read_device_allow(
         return sd_bus_message_exit_container(m);
 }
 
-static int acquire_security_info(sd_bus *bus, const char *name, struct security_info *info, AnalyzeSecurityFlags flags) {
+static int acquire_security_info(sd_bus_message *reply, const char *name, struct security_info *info, AnalyzeSecurityFlags flags) {
 
         static const struct bus_properties_map security_map[] = {
                 { "AmbientCapabilities",     "t",       NULL,                                    offsetof(struct security_info, ambient_capabilities)      },
@@ -2005,27 +2014,25 @@ static int acquire_security_info(sd_bus *bus, const char *name, struct security_
         };
 
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
-        _cleanup_free_ char *path = NULL;
         int r;
 
         /* Note: this mangles *info on failure! */
 
-        assert(bus);
+        assert(reply);
         assert(name);
         assert(info);
 
-        path = unit_dbus_path_from_name(name);
-        if (!path)
-                return log_oom();
+        /* 'reply' is the reply to a GetAll() call on the unit object, which might be a method error */
+        r = sd_bus_message_get_errno(reply);
+        if (r > 0)
+                return log_error_errno(r, "Failed to get unit properties: %s",
+                                       bus_error_message(sd_bus_message_get_error(reply), r));
 
-        r = bus_map_all_properties(
-                        bus,
-                        "org.freedesktop.systemd1",
-                        path,
+        r = bus_message_map_all_properties(
+                        reply,
                         security_map,
                         BUS_MAP_STRDUP | BUS_MAP_BOOLEAN_AS_BOOL,
                         &error,
-                        NULL,
                         info);
         if (r < 0)
                 return log_error_errno(r, "Failed to get unit properties: %s", bus_error_message(&error, r));
@@ -2075,7 +2082,7 @@ static int acquire_security_info(sd_bus *bus, const char *name, struct security_
         return 0;
 }
 
-static int analyze_security_one(sd_bus *bus, const char *name, Table *overview_table, AnalyzeSecurityFlags flags) {
+static int analyze_security_one(sd_bus_message *reply, const char *name, Table *overview_table, AnalyzeSecurityFlags flags) {
         _cleanup_(security_info_free) struct security_info info = {
                 .default_dependencies = true,
                 .capability_bounding_set = UINT64_MAX,
@@ -2084,10 +2091,10 @@ static int analyze_security_one(sd_bus *bus, const char *name, Table *overview_t
         };
         int r;
 
-        assert(bus);
+        assert(reply);
         assert(name);
 
-        r = acquire_security_info(bus, name, &info, flags);
+        r = acquire_security_info(reply, name, &info, flags);
         if (r == -EMEDIUMTYPE) /* Ignore this one because not loaded or Type is oneshot */
                 return 0;
         if (r < 0)
@@ -2100,6 +2107,116 @@ static int analyze_security_one(sd_bus *bus, const char *name, Table *overview_t
         return 0;
 }
 
+static int get_unit_properties_async(sd_bus *bus, const char *name, sd_bus_slot **ret_slot, sd_bus_message_handler_t callback, void *userdata) {
+        _cleanup_free_ char *path = NULL;
+
+        assert(bus);
+        assert(name);
+
+        path = unit_dbus_path_from_name(name);
+        if (!path)
+                return log_oom();
+
+        return sd_bus_call_method_async(
+                        bus,
+                        ret_slot,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.DBus.Properties",
+                        "GetAll",
+                        callback,
+                        userdata,
+                        "s", "");
+}
+
+static int on_get_all_properties(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        SecurityQuery *q = userdata;
+
+        assert(m);
+        assert(q);
+
+        q->slot = sd_bus_slot_unref(q->slot);
+        q->reply = sd_bus_message_ref(m);
+
+        return 0;
+}
+
+static void security_query_array_free(SecurityQuery *q, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+                sd_bus_slot_unref(q[i].slot);
+                sd_bus_message_unref(q[i].reply);
+        }
+
+        free(q);
+}
+
+static int analyze_security_many(sd_bus *bus, char **names, Table *overview_table, AnalyzeSecurityFlags flags) {
+        SecurityQuery *queries;
+        size_t n, issued = 0, analyzed = 0;
+        int ret = 0, r;
+
+        assert(bus);
+
+        /* Querying the properties of one unit after the other means one full bus round trip per unit, which
+         * adds up with the hundreds of units found on big systems. Hence, keep a window of GetAll() calls in
+         * flight, and assess the replies in the original order as they come in, so that the output is the
+         * same as when processing them one by one. */
+
+        n = strv_length(names);
+        queries = new0(SecurityQuery, n);
+        if (n > 0 && !queries)
+                return log_oom();
+
+        while (analyzed < n) {
+                SecurityQuery *q;
+
+                while (issued < n && issued - analyzed < SECURITY_QUERIES_IN_FLIGHT_MAX) {
+                        q = queries + issued;
+                        q->name = names[issued];
+
+                        r = get_unit_properties_async(bus, q->name, &q->slot, on_get_all_properties, q);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to request properties of unit %s: %m", q->name);
+                                goto finish;
+                        }
+
+                        issued++;
+                }
+
+                q = queries + analyzed;
+                if (!q->reply) {
+                        r = sd_bus_process(bus, NULL);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to process bus messages: %m");
+                                goto finish;
+                        }
+                        if (r > 0)
+                                continue;
+
+                        r = sd_bus_wait(bus, UINT64_MAX);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to wait for bus messages: %m");
+                                goto finish;
+                        }
+
+                        continue;
+                }
+
+                r = analyze_security_one(q->reply, q->name, overview_table, flags);
+                if (r < 0 && ret >= 0)
+                        ret = r;
+
+                q->reply = sd_bus_message_unref(q->reply);
+                analyzed++;
+        }
+
+        r = ret;
+
+finish:
+        security_query_array_free(queries, n);
+        return r;
+}
+
 int analyze_security(sd_bus *bus, char **units, AnalyzeSecurityFlags flags) {
         _cleanup_(table_unrefp) Table *overview_table = NULL;
         int ret = 0, r;
@@ -2117,7 +2234,6 @@ int analyze_security(sd_bus *bus, char **units, AnalyzeSecurityFlags flags) {
                 _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
                 _cleanup_strv_free_ char **list = NULL;
                 size_t allocated = 0, n = 0;
-                char **i;
 
                 r = sd_bus_call_method(
                                 bus,
@@ -2163,12 +2279,7 @@ int analyze_security(sd_bus *bus, char **units, AnalyzeSecurityFlags flags) {
 
                 flags |= ANALYZE_SECURITY_SHORT|ANALYZE_SECURITY_ONLY_LOADED|ANALYZE_SECURITY_ONLY_LONG_RUNNING;
 
-                STRV_FOREACH(i, list) {
-                        r = analyze_security_one(bus, *i, overview_table, flags);
-                        if (r < 0 && ret >= 0)
-                                ret = r;
-                }
-
+                ret = analyze_security_many(bus, list, overview_table, flags);
         } else {
                 char **i;
 
@@ -2199,7 +2310,7 @@ int analyze_security(sd_bus *bus, char **units, AnalyzeSecurityFlags flags) {
                         } else
                                 name = mangled;
 
-                        r = analyze_security_one(bus, name, overview_table, flags);
+                        r = analyze_security_many(bus, STRV_MAKE(name), overview_table, flags);
                         if (r < 0 && ret >= 0)
                                 ret = r;
                 }
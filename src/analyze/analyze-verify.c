@@ -12,6 +12,7 @@
 #include "pager.h"
 #include "path-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "unit-name.h"
 
 static int prepare_filename(const char *filename, char **ret) {
@@ -187,6 +188,8 @@ static int verify_documentation(Unit *u, bool check_man) {
 
 static int verify_unit(Unit *u, bool check_man) {
         _cleanup_(sd_bus_error_free) sd_bus_error err = SD_BUS_ERROR_NULL;
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t start;
         int r, k;
 
         assert(u);
@@ -195,9 +198,14 @@ static int verify_unit(Unit *u, bool check_man) {
                 unit_dump(u, stdout, "\t");
 
         log_unit_debug(u, "Creating %s/start job", u->id);
+        start = now(CLOCK_MONOTONIC);
         r = manager_add_job(u->manager, JOB_START, u, JOB_REPLACE, NULL, &err, NULL);
         if (r < 0)
                 log_unit_error_errno(u, r, "Failed to create %s/start: %s", u->id, bus_error_message(&err, r));
+        else
+                log_unit_debug(u, "Created %s/start job in %s.",
+                               u->id,
+                               format_timespan(ts, sizeof(ts), usec_sub_unsigned(now(CLOCK_MONOTONIC), start), 1));
 
         k = verify_socket(u);
         if (k < 0 && r == 0)
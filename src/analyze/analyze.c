@@ -30,6 +30,7 @@
 #include "format-table.h"
 #include "glob-util.h"
 #include "hashmap.h"
+#include "json.h"
 #include "locale-util.h"
 #include "log.h"
 #include "main-func.h"
@@ -830,6 +831,71 @@ static int analyze_plot(int argc, char *argv[], void *userdata) {
         return 0;
 }
 
+static int analyze_trace(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(json_variant_unrefp) JsonVariant *events = NULL, *v = NULL;
+        const char *type, *name;
+        uint64_t timestamp, duration;
+        int r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return bus_log_connect_error(r);
+
+        r = bus_call_method(bus, bus_systemd_mgr, "GetTrace", &error, &reply, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get startup trace: %s", bus_error_message(&error, r));
+
+        r = json_variant_new_array(&events, NULL, 0);
+        if (r < 0)
+                return log_oom();
+
+        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(sstt)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        /* Output the events in the Trace Event Format understood by chrome://tracing and similar viewers,
+         * one thread row per event category. Timestamps are in µs on CLOCK_MONOTONIC. */
+        while ((r = sd_bus_message_read(reply, "(sstt)", &type, &name, &timestamp, &duration)) > 0) {
+                _cleanup_(json_variant_unrefp) JsonVariant *e = NULL;
+                bool instant = duration == USEC_INFINITY;
+
+                r = json_build(&e, JSON_BUILD_OBJECT(
+                                               JSON_BUILD_PAIR("name", JSON_BUILD_STRING(name)),
+                                               JSON_BUILD_PAIR("cat", JSON_BUILD_STRING(type)),
+                                               JSON_BUILD_PAIR("ph", JSON_BUILD_STRING(instant ? "i" : "X")),
+                                               JSON_BUILD_PAIR("ts", JSON_BUILD_UNSIGNED(timestamp)),
+                                               JSON_BUILD_PAIR_CONDITION(!instant, "dur", JSON_BUILD_UNSIGNED(duration)),
+                                               JSON_BUILD_PAIR_CONDITION(instant, "s", JSON_BUILD_STRING("g")),
+                                               JSON_BUILD_PAIR("pid", JSON_BUILD_UNSIGNED(1)),
+                                               /* Generators run in parallel, give each its own row */
+                                               JSON_BUILD_PAIR("tid", JSON_BUILD_STRING(streq(type, "generator") ? name : type))));
+                if (r < 0)
+                        return log_error_errno(r, "Failed to build JSON object: %m");
+
+                r = json_variant_append_array(&events, e);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to append JSON object to array: %m");
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = json_build(&v, JSON_BUILD_OBJECT(
+                                       JSON_BUILD_PAIR("traceEvents", JSON_BUILD_VARIANT(events)),
+                                       JSON_BUILD_PAIR("displayTimeUnit", JSON_BUILD_STRING("ms"))));
+        if (r < 0)
+                return log_error_errno(r, "Failed to build JSON object: %m");
+
+        json_variant_dump(v, JSON_FORMAT_PRETTY_AUTO|JSON_FORMAT_COLOR_AUTO, stdout, NULL);
+        return 0;
+}
+
 static int list_dependencies_print(
                 const char *name,
                 unsigned level,
@@ -1136,6 +1202,43 @@ static int analyze_time(int argc, char *argv[], void *userdata) {
         return 0;
 }
 
+static const struct {
+        const char *dependency;
+        const char *color;
+} graph_colors[] = {
+        { "After",     "green"    },
+        { "Requires",  "black"    },
+        { "Requisite", "darkblue" },
+        { "Wants",     "grey66"   },
+        { "Conflicts", "red"      },
+};
+
+static bool graph_dependency_selected(const char *dependency) {
+        if (arg_dot == DEP_ALL)
+                return true;
+
+        return (arg_dot == DEP_ORDER) == streq(dependency, "After");
+}
+
+static bool graph_source_matches(const char *from, char *patterns[], char *from_patterns[]) {
+        return strv_isempty(from_patterns) || strv_fnmatch(patterns, from) || strv_fnmatch(from_patterns, from);
+}
+
+static void graph_print_edge(const char *from, const char *to, const char *color, char *patterns[], char *to_patterns[]) {
+        bool match_patterns, match_patterns2;
+
+        match_patterns = strv_fnmatch(patterns, from);
+        match_patterns2 = strv_fnmatch(patterns, to);
+
+        if (!strv_isempty(to_patterns) && !match_patterns2 && !strv_fnmatch(to_patterns, to))
+                return;
+
+        if (!strv_isempty(patterns) && !match_patterns && !match_patterns2)
+                return;
+
+        printf("\t\"%s\"->\"%s\" [color=\"%s\"];\n", from, to, color);
+}
+
 static int graph_one_property(
                 sd_bus *bus,
                 const UnitInfo *u,
@@ -1148,64 +1251,128 @@ static int graph_one_property(
         _cleanup_strv_free_ char **units = NULL;
         char **unit;
         int r;
-        bool match_patterns;
 
         assert(u);
         assert(prop);
         assert(color);
 
-        match_patterns = strv_fnmatch(patterns, u->id);
-
-        if (!strv_isempty(from_patterns) && !match_patterns && !strv_fnmatch(from_patterns, u->id))
+        if (!graph_source_matches(u->id, patterns, from_patterns))
                 return 0;
 
         r = bus_get_unit_property_strv(bus, u->unit_path, prop, &units);
         if (r < 0)
                 return r;
 
-        STRV_FOREACH(unit, units) {
-                bool match_patterns2;
+        STRV_FOREACH(unit, units)
+                graph_print_edge(u->id, *unit, color, patterns, to_patterns);
 
-                match_patterns2 = strv_fnmatch(patterns, *unit);
+        return 0;
+}
 
-                if (!strv_isempty(to_patterns) && !match_patterns2 && !strv_fnmatch(to_patterns, *unit))
-                        continue;
+static int graph_one(sd_bus *bus, const UnitInfo *u, char *patterns[], char *from_patterns[], char *to_patterns[]) {
+        int r;
 
-                if (!strv_isempty(patterns) && !match_patterns && !match_patterns2)
+        assert(bus);
+        assert(u);
+
+        for (size_t i = 0; i < ELEMENTSOF(graph_colors); i++) {
+                if (!graph_dependency_selected(graph_colors[i].dependency))
                         continue;
 
-                printf("\t\"%s\"->\"%s\" [color=\"%s\"];\n", u->id, *unit, color);
+                r = graph_one_property(bus, u, graph_colors[i].dependency, graph_colors[i].color, patterns, from_patterns, to_patterns);
+                if (r < 0)
+                        return r;
         }
 
         return 0;
 }
 
-static int graph_one(sd_bus *bus, const UnitInfo *u, char *patterns[], char *from_patterns[], char *to_patterns[]) {
+static const char *graph_color(const char *dependency) {
+        for (size_t i = 0; i < ELEMENTSOF(graph_colors); i++)
+                if (streq(graph_colors[i].dependency, dependency))
+                        return graph_colors[i].color;
+
+        return NULL;
+}
+
+static int graph_all(sd_bus *bus, char *patterns[], char *from_patterns[], char *to_patterns[]) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_strv_free_ char **dependencies = NULL;
         int r;
 
         assert(bus);
-        assert(u);
 
-        if (IN_SET(arg_dot, DEP_ORDER, DEP_ALL)) {
-                r = graph_one_property(bus, u, "After", "green", patterns, from_patterns, to_patterns);
-                if (r < 0)
-                        return r;
+        /* Retrieve the dependencies of all units in a single call. Returns -EOPNOTSUPP if the manager
+         * doesn't support that, in which case the properties of each unit need to be queried. */
+
+        for (size_t i = 0; i < ELEMENTSOF(graph_colors); i++)
+                if (graph_dependency_selected(graph_colors[i].dependency) &&
+                    strv_extend(&dependencies, graph_colors[i].dependency) < 0)
+                        return log_oom();
+
+        r = bus_message_new_method_call(bus, &m, bus_systemd_mgr, "ListUnitDependencyGraph");
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_message_append_strv(m, NULL);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_message_append_strv(m, dependencies);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0) {
+                if (sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD))
+                        return -EOPNOTSUPP;
+
+                return log_error_errno(r, "Failed to get dependency graph: %s", bus_error_message(&error, r));
         }
 
-        if (IN_SET(arg_dot, DEP_REQUIRE, DEP_ALL)) {
-                r = graph_one_property(bus, u, "Requires", "black", patterns, from_patterns, to_patterns);
+        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(sssa(ss))");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        printf("digraph systemd {\n");
+
+        while ((r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_STRUCT, "sssa(ss)")) > 0) {
+                const char *id, *dependency, *other;
+                bool match;
+
+                r = sd_bus_message_read(reply, "sss", &id, NULL, NULL);
                 if (r < 0)
-                        return r;
-                r = graph_one_property(bus, u, "Requisite", "darkblue", patterns, from_patterns, to_patterns);
+                        return bus_log_parse_error(r);
+
+                match = graph_source_matches(id, patterns, from_patterns);
+
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ss)");
                 if (r < 0)
-                        return r;
-                r = graph_one_property(bus, u, "Wants", "grey66", patterns, from_patterns, to_patterns);
+                        return bus_log_parse_error(r);
+
+                while ((r = sd_bus_message_read(reply, "(ss)", &dependency, &other)) > 0) {
+                        const char *color;
+
+                        color = graph_color(dependency);
+                        if (match && color)
+                                graph_print_edge(id, other, color, patterns, to_patterns);
+                }
                 if (r < 0)
-                        return r;
-                r = graph_one_property(bus, u, "Conflicts", "red", patterns, from_patterns, to_patterns);
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_exit_container(reply);
                 if (r < 0)
-                        return r;
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return bus_log_parse_error(r);
         }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        printf("}\n");
 
         return 0;
 }
@@ -1278,26 +1445,30 @@ static int dot(int argc, char *argv[], void *userdata) {
         if (r < 0)
                 return r;
 
-        r = bus_call_method(bus, bus_systemd_mgr, "ListUnits", &error, &reply, "");
-        if (r < 0)
-                log_error_errno(r, "Failed to list units: %s", bus_error_message(&error, r));
+        r = graph_all(bus, expanded_patterns, expanded_from_patterns, expanded_to_patterns);
+        if (r == -EOPNOTSUPP) {
+                r = bus_call_method(bus, bus_systemd_mgr, "ListUnits", &error, &reply, "");
+                if (r < 0)
+                        return log_error_errno(r, "Failed to list units: %s", bus_error_message(&error, r));
 
-        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
-        if (r < 0)
-                return bus_log_parse_error(r);
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
+                if (r < 0)
+                        return bus_log_parse_error(r);
 
-        printf("digraph systemd {\n");
+                printf("digraph systemd {\n");
 
-        while ((r = bus_parse_unit_info(reply, &u)) > 0) {
+                while ((r = bus_parse_unit_info(reply, &u)) > 0) {
 
-                r = graph_one(bus, &u, expanded_patterns, expanded_from_patterns, expanded_to_patterns);
+                        r = graph_one(bus, &u, expanded_patterns, expanded_from_patterns, expanded_to_patterns);
+                        if (r < 0)
+                                return r;
+                }
                 if (r < 0)
-                        return r;
-        }
-        if (r < 0)
-                return bus_log_parse_error(r);
+                        return bus_log_parse_error(r);
 
-        printf("}\n");
+                printf("}\n");
+        } else if (r < 0)
+                return r;
 
         log_info("   Color legend: black     = Requires\n"
                  "                 dark blue = Requisite\n"
@@ -2120,6 +2291,7 @@ static int help(int argc, char *argv[], void *userdata) {
                "  blame                    Print list of running units ordered by time to init\n"
                "  critical-chain [UNIT...] Print a tree of the time critical chain of units\n"
                "  plot                     Output SVG graphic showing service initialization\n"
+               "  trace                    Output startup trace in Chrome trace event JSON format\n"
                "  dot [UNIT...]            Output dependency graph in %s format\n"
                "  dump                     Output state serialization of service manager\n"
                "  cat-config               Show configuration file and drop-ins\n"
@@ -2348,6 +2520,7 @@ static int run(int argc, char *argv[]) {
                 { "blame",             VERB_ANY, 1,        0,            analyze_blame          },
                 { "critical-chain",    VERB_ANY, VERB_ANY, 0,            analyze_critical_chain },
                 { "plot",              VERB_ANY, 1,        0,            analyze_plot           },
+                { "trace",             VERB_ANY, 1,        0,            analyze_trace          },
                 { "dot",               VERB_ANY, VERB_ANY, 0,            dot                    },
                 /* The following seven verbs are deprecated */
                 { "log-level",         VERB_ANY, 2,        0,            get_or_set_log_level   },
@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <linux/falloc.h>
 #include <sys/sendfile.h>
 #include <sys/xattr.h>
 #include <unistd.h>
@@ -14,11 +15,13 @@
 #include "chattr-util.h"
 #include "copy.h"
 #include "dirent-util.h"
+#include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
 #include "io-util.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "missing_syscall.h"
 #include "mountpoint-util.h"
 #include "nulstr-util.h"
@@ -101,6 +104,44 @@ static int sigint_pending(void) {
         return true;
 }
 
+static int create_hole(int fd, off_t size) {
+        off_t offset, end;
+
+        /* Creates a hole of the specified size at the current file offset of fd, and moves the file offset
+         * to the end of it. */
+
+        offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0)
+                return -errno;
+
+        end = lseek(fd, 0, SEEK_END);
+        if (end < 0)
+                return -errno;
+
+        /* If we are not at the end of the target file, punch a hole into the existing part */
+        if (offset < end &&
+            fallocate(fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, offset, MIN(size, end - offset)) < 0 &&
+            !ERRNO_IS_NOT_SUPPORTED(errno))
+                return -errno;
+
+        if (end - offset >= size) {
+                /* The whole hole fits into the existing file, move the offset past it */
+                if (lseek(fd, offset + size, SEEK_SET) < 0)
+                        return -errno;
+
+                return 0;
+        }
+
+        /* Otherwise grow the file (and thus the hole) to the requested size */
+        if (ftruncate(fd, offset + size) < 0)
+                return -errno;
+
+        if (lseek(fd, 0, SEEK_END) < 0)
+                return -errno;
+
+        return 0;
+}
+
 int copy_bytes_full(
                 int fdf, int fdt,
                 uint64_t max_bytes,
@@ -130,6 +171,10 @@ int copy_bytes_full(
         if (ret_remains_size)
                 *ret_remains_size = 0;
 
+        /* If we shall detect runs of zeroes we need to look at the data ourselves, hence only do read()/write() */
+        if (FLAGS_SET(copy_flags, COPY_SPARSE))
+                try_cfr = try_sendfile = try_splice = false;
+
         /* Try btrfs reflinks first. This only works on regular, seekable files, hence let's check the file offsets of
          * source and destination first. */
         if ((copy_flags & COPY_REFLINK)) {
@@ -200,6 +245,57 @@ int copy_bytes_full(
                 if (max_bytes != UINT64_MAX && m > max_bytes)
                         m = max_bytes;
 
+                if (FLAGS_SET(copy_flags, COPY_HOLES)) {
+                        off_t c, e;
+
+                        c = lseek(fdf, 0, SEEK_CUR);
+                        if (c < 0)
+                                return -errno;
+
+                        /* Look for the next data segment. ENXIO means there's only a hole left until EOF. */
+                        e = lseek(fdf, c, SEEK_DATA);
+                        if (e < 0 && errno == ENXIO)
+                                e = lseek(fdf, 0, SEEK_END);
+                        if (e < 0)
+                                return -errno;
+
+                        if (e > c) {
+                                /* We are in a hole, create an equally sized one in the target */
+                                n = MIN(max_bytes, (uint64_t) (e - c));
+                                r = create_hole(fdt, n);
+                                if (r < 0)
+                                        return r;
+
+                                if (max_bytes != UINT64_MAX) {
+                                        max_bytes -= n;
+                                        if (max_bytes <= 0)
+                                                return 1;
+                                }
+
+                                if (m > max_bytes)
+                                        m = max_bytes;
+                        }
+
+                        c = e;
+
+                        /* Find the end of the data segment, and copy only up to there in this iteration */
+                        e = lseek(fdf, c, SEEK_HOLE);
+                        if (e < 0) {
+                                if (errno == ENXIO) /* EOF */
+                                        break;
+                                return -errno;
+                        }
+
+                        /* SEEK_HOLE moved the file offset, go back to the start of the data */
+                        if (lseek(fdf, c, SEEK_SET) < 0)
+                                return -errno;
+
+                        if (e == c) /* EOF */
+                                break;
+
+                        m = MIN(m, (size_t) (e - c));
+                }
+
                 /* First try copy_file_range(), unless we already tried */
                 if (try_cfr) {
                         n = try_copy_file_range(fdf, NULL, fdt, NULL, m, 0u);
@@ -301,6 +397,14 @@ int copy_bytes_full(
                         if (n == 0) /* EOF */
                                 break;
 
+                        if (FLAGS_SET(copy_flags, COPY_SPARSE) && memeqzero(buf, n)) {
+                                r = create_hole(fdt, n);
+                                if (r < 0)
+                                        return r;
+
+                                goto next;
+                        }
+
                         z = (size_t) n;
                         do {
                                 ssize_t k;
@@ -346,8 +450,13 @@ int copy_bytes_full(
                 /* sendfile accepts at most SSIZE_MAX-offset bytes to copy,
                  * so reduce our maximum by the amount we already copied,
                  * but don't go below our copy buffer size, unless we are
-                 * close the limit of bytes we are allowed to copy. */
-                m = MAX(MIN(COPY_BUFFER_SIZE, max_bytes), m - n);
+                 * close the limit of bytes we are allowed to copy. When
+                 * copying holes, m was clamped to the data segment, hence
+                 * start over from the full size for the next one. */
+                if (FLAGS_SET(copy_flags, COPY_HOLES))
+                        m = SSIZE_MAX;
+                else
+                        m = MAX(MIN(COPY_BUFFER_SIZE, max_bytes), m - n);
         }
 
         return 0; /* return 0 if we hit EOF earlier than the size limit */
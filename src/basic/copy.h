@@ -17,6 +17,8 @@ typedef enum CopyFlags {
         COPY_CRTIME      = 1 << 5, /* Generate a user.crtime_usec xattr off the source crtime if there is one, on copying */
         COPY_SIGINT      = 1 << 6, /* Check for SIGINT regularly and return EINTR if seen (caller needs to block SIGINT) */
         COPY_MAC_CREATE  = 1 << 7, /* Create files with the correct MAC label (currently SELinux only) */
+        COPY_HOLES       = 1 << 8, /* Copy holes as holes, rather than writing out zeroes (source must be seekable) */
+        COPY_SPARSE      = 1 << 9, /* Write blocks of zeroes as holes, for sources that are not seekable (target must be seekable) */
 } CopyFlags;
 
 typedef int (*copy_progress_bytes_t)(uint64_t n_bytes, void *userdata);
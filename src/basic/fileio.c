@@ -361,7 +361,7 @@ int verify_file(const char *fn, const char *blob, bool accept_extra_nl) {
         return 1;
 }
 
-int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size) {
+int read_full_virtual_file_at(int dir_fd, const char *filename, char **ret_contents, size_t *ret_size) {
         _cleanup_free_ char *buf = NULL;
         _cleanup_close_ int fd = -1;
         struct stat st;
@@ -369,6 +369,8 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
         int n_retries;
         char *p;
 
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(filename);
         assert(ret_contents);
 
         /* Virtual filesystems such as sysfs or procfs use kernfs, and kernfs can work
@@ -380,7 +382,7 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
          * why the usage of fread(3) is prohibited in this case as it always performs a
          * second call to read(2) looking for EOF. See issue 13585. */
 
-        fd = open(filename, O_RDONLY|O_CLOEXEC);
+        fd = openat(dir_fd, filename, O_RDONLY|O_CLOEXEC);
         if (fd < 0)
                 return -errno;
 
@@ -468,6 +470,10 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
         return 0;
 }
 
+int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size) {
+        return read_full_virtual_file_at(AT_FDCWD, filename, ret_contents, ret_size);
+}
+
 int read_full_stream_full(
                 FILE *f,
                 const char *filename,
@@ -1068,7 +1074,6 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(FILE*, funlockfile);
 int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
         size_t n = 0, allocated = 0, count = 0;
         _cleanup_free_ char *buffer = NULL;
-        int r;
 
         assert(f);
 
@@ -1109,6 +1114,7 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                 for (;;) {
                         EndOfLineMarker eol;
                         char c;
+                        int k;
 
                         if (n >= limit)
                                 return -ENOBUFS;
@@ -1116,11 +1122,17 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                         if (count >= INT_MAX) /* We couldn't return the counter anymore as "int", hence refuse this */
                                 return -ENOBUFS;
 
-                        r = safe_fgetc(f, &c);
-                        if (r < 0)
-                                return r;
-                        if (r == 0) /* EOF is definitely EOL */
-                                break;
+                        /* Same as safe_fgetc(), but we hold the lock already, hence use the unlocked variant,
+                         * which is inlined and much faster for a per-character loop like this one. */
+                        errno = 0;
+                        k = getc_unlocked(f);
+                        if (k == EOF) {
+                                if (ferror_unlocked(f))
+                                        return errno_or_else(EIO);
+
+                                break; /* EOF is definitely EOL */
+                        }
+                        c = k;
 
                         eol = categorize_eol(c, flags);
 
@@ -1169,7 +1181,7 @@ int read_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret) {
                         }
 
                         if (ret) {
-                                if (!GREEDY_REALLOC(buffer, allocated, n + 2))
+                                if (n + 2 > allocated && !GREEDY_REALLOC(buffer, allocated, n + 2))
                                         return -ENOMEM;
 
                                 buffer[n] = c;
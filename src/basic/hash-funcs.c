@@ -16,6 +16,60 @@ DEFINE_HASH_OPS_FULL(string_hash_ops_free_free,
                      char, string_hash_func, string_compare_func, free,
                      char, free);
 
+void fast_string_hash_func(const char *p, struct siphash *state) {
+        /* Hashmaps recognize this function and call fast_hash64() instead. Anybody else gets siphash24,
+         * so that hash_ops users which feed the hash into a siphash state of their own keep working. */
+        siphash24_compress(p, strlen(p) + 1, state);
+}
+
+DEFINE_HASH_OPS(fast_string_hash_ops, char, fast_string_hash_func, string_compare_func);
+DEFINE_HASH_OPS_WITH_KEY_DESTRUCTOR(fast_string_hash_ops_free,
+                                    char, fast_string_hash_func, string_compare_func, free);
+DEFINE_HASH_OPS_FULL(fast_string_hash_ops_free_free,
+                     char, fast_string_hash_func, string_compare_func, free,
+                     char, free);
+
+static inline uint64_t rotl64(uint64_t x, unsigned b) {
+        return (x << b) | (x >> (64 - b));
+}
+
+static inline uint64_t fast_hash64_round(uint64_t h, uint64_t w) {
+        return rotl64(h ^ (w * UINT64_C(0xc2b2ae3d27d4eb4f)), 31) * UINT64_C(0x9e3779b97f4a7c15);
+}
+
+uint64_t fast_hash64(const void *p, size_t n, const uint8_t k[static 16]) {
+        const uint8_t *q = p;
+        uint64_t k0, k1, h, w;
+
+        assert(p || n == 0);
+
+        memcpy(&k0, k, sizeof(k0));
+        memcpy(&k1, k + sizeof(k0), sizeof(k1));
+
+        h = k0 ^ (n * UINT64_C(0x9e3779b97f4a7c15));
+
+        for (; n >= sizeof(w); n -= sizeof(w), q += sizeof(w)) {
+                memcpy(&w, q, sizeof(w));
+                h = fast_hash64_round(h, w);
+        }
+
+        if (n > 0) {
+                w = 0;
+                memcpy(&w, q, n);
+                h = fast_hash64_round(h, w);
+        }
+
+        /* The MurmurHash3 finalizer, so that every input bit affects every output bit */
+        h ^= k1;
+        h ^= h >> 33;
+        h *= UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 33;
+        h *= UINT64_C(0xc4ceb9fe1a85ec53);
+        h ^= h >> 33;
+
+        return h;
+}
+
 void path_hash_func(const char *q, struct siphash *state) {
         size_t n;
 
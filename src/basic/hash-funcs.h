@@ -79,6 +79,17 @@ extern const struct hash_ops string_hash_ops;
 extern const struct hash_ops string_hash_ops_free;
 extern const struct hash_ops string_hash_ops_free_free;
 
+/* Like the string_hash_ops, but hashmaps using these hash the keys with fast_hash64() rather than with
+ * siphash24. That function is not designed to withstand collision attacks however, hence only use these
+ * for tables whose keys can't be chosen by untrusted parties. */
+void fast_string_hash_func(const char *p, struct siphash *state);
+extern const struct hash_ops fast_string_hash_ops;
+extern const struct hash_ops fast_string_hash_ops_free;
+extern const struct hash_ops fast_string_hash_ops_free_free;
+
+/* A keyed hash function that processes 8 bytes per round, for tables with trusted keys, see above */
+uint64_t fast_hash64(const void *p, size_t n, const uint8_t k[static 16]) _pure_;
+
 void path_hash_func(const char *p, struct siphash *state);
 extern const struct hash_ops path_hash_ops;
 extern const struct hash_ops path_hash_ops_free;
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+
+#include "hashed-string.h"
+#include "random-util.h"
+#include "siphash24.h"
+
+static uint8_t hashed_string_key[16];
+static pthread_once_t hashed_string_key_once = PTHREAD_ONCE_INIT;
+
+static void hashed_string_key_init(void) {
+        /* A random key, so that nobody can guess strings with colliding hashes, which would make all
+         * lookups fall back to strcmp(). It has to stay the same for the whole lifetime of the process
+         * however, hashed strings created before and after a fork() must compare the same way. */
+        random_bytes(hashed_string_key, sizeof(hashed_string_key));
+}
+
+char *hashed_string_init(void *buffer, const char *s, size_t n) {
+        uint64_t *h = buffer;
+        char *p;
+
+        assert(buffer);
+        assert(s || n == 0);
+
+        assert_se(pthread_once(&hashed_string_key_once, hashed_string_key_init) == 0);
+
+        p = (char*) (h + 1);
+        *((char*) mempcpy(p, s, n)) = 0;
+        *h = siphash24(p, n + 1, hashed_string_key);
+
+        return p;
+}
+
+char *hashed_strndup(const char *s, size_t n) {
+        void *buffer;
+
+        assert(s || n == 0);
+
+        n = strnlen(s, n);
+
+        buffer = malloc(HASHED_STRING_SIZE(n));
+        if (!buffer)
+                return NULL;
+
+        return hashed_string_init(buffer, s, n);
+}
+
+char *hashed_string_free(char *s) {
+        if (!s)
+                return NULL;
+
+        free((uint64_t*) s - 1);
+        return NULL;
+}
+
+void hashed_string_hash_func(const char *s, struct siphash *state) {
+        uint64_t h = hashed_string_hash(s);
+
+        siphash24_compress(&h, sizeof(h), state);
+}
+
+int hashed_string_compare_func(const char *a, const char *b) {
+        int r;
+
+        /* Strings with different hashes are never equal, hence order by the hash first, and only look at
+         * the strings themselves if the hashes match. */
+        r = CMP(hashed_string_hash(a), hashed_string_hash(b));
+        if (r != 0)
+                return r;
+
+        return strcmp(a, b);
+}
+
+DEFINE_HASH_OPS(hashed_string_hash_ops, char, hashed_string_hash_func, hashed_string_compare_func);
+DEFINE_HASH_OPS_WITH_KEY_DESTRUCTOR(hashed_string_hash_ops_free,
+                                    char, hashed_string_hash_func, hashed_string_compare_func, hashed_string_free);
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "alloc-util.h"
+#include "hash-funcs.h"
+#include "macro.h"
+
+/* A hashed string is a regular NUL terminated string, that is preceded in memory by a 64bit hash of its
+ * contents, calculated once when the string is created, with a key that is fixed for the lifetime of the
+ * process. Hashmaps using hashed_string_hash_ops only have to hash these 8 bytes instead of the full
+ * string, both on lookups and when resizing, and can refuse most mismatches by comparing the hashes.
+ *
+ * The strings can be passed everywhere a "const char*" is expected, but must be allocated with
+ * hashed_string_new() or hashed_strndup() and released with hashed_string_free(), never with free(). Keys
+ * passed to lookups in hashmaps using hashed_string_hash_ops must be hashed strings too, use
+ * hashed_string_onstack() for that. */
+
+char *hashed_string_init(void *buffer, const char *s, size_t n);
+
+#define HASHED_STRING_SIZE(n) (sizeof(uint64_t) + (n) + 1)
+
+char *hashed_strndup(const char *s, size_t n);
+static inline char *hashed_string_new(const char *s) {
+        return hashed_strndup(s, strlen(s));
+}
+char *hashed_string_free(char *s);
+DEFINE_TRIVIAL_CLEANUP_FUNC(char*, hashed_string_free);
+
+/* Like strdupa(), but returns a hashed string */
+#define hashed_string_onstack(s)                                        \
+        ({                                                              \
+                const char *_s_ = (s);                                  \
+                size_t _n_ = strlen(_s_);                               \
+                hashed_string_init(alloca_align(HASHED_STRING_SIZE(_n_), __alignof__(uint64_t)), _s_, _n_); \
+        })
+
+static inline uint64_t hashed_string_hash(const char *s) {
+        return ((const uint64_t*) s)[-1];
+}
+
+void hashed_string_hash_func(const char *s, struct siphash *state);
+int hashed_string_compare_func(const char *a, const char *b) _pure_;
+extern const struct hash_ops hashed_string_hash_ops;
+extern const struct hash_ops hashed_string_hash_ops_free;
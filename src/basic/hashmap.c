@@ -6,6 +6,7 @@
 
 #include "alloc-util.h"
 #include "fileio.h"
+#include "hashed-string.h"
 #include "hashmap.h"
 #include "macro.h"
 #include "memory-util.h"
@@ -192,6 +193,18 @@ static uint8_t shared_hash_key[HASH_KEY_SIZE];
 static bool shared_hash_key_initialized;
 
 /* Fields that all hashmap/set types must have */
+/* The hash and compare functions of the most common key types are recognized when a hashmap is created, and
+ * then called inline, rather than through the function pointers of the hash_ops. Anything else goes through
+ * the hash_ops. */
+enum HashmapKeyType {
+        HASHMAP_KEY_GENERIC,
+        HASHMAP_KEY_TRIVIAL,         /* the pointer itself is the key */
+        HASHMAP_KEY_UINT64,
+        HASHMAP_KEY_STRING,
+        HASHMAP_KEY_FAST_STRING,     /* hashed with fast_hash64() rather than siphash24 */
+        HASHMAP_KEY_HASHED_STRING,   /* see hashed-string.h */
+};
+
 struct HashmapBase {
         const struct hash_ops *hash_ops;  /* hash and compare ops to use */
 
@@ -207,6 +220,7 @@ struct HashmapBase {
         bool from_pool:1;            /* whether was allocated from mempool */
         bool dirty:1;                /* whether dirtied since last iterated_cache_get() */
         bool cached:1;               /* whether this hashmap is being cached */
+        enum HashmapKeyType key_type:3; /* HASHMAP_KEY_*, derived from hash_ops */
 
 #if ENABLE_DEBUG_HASHMAP
         struct hashmap_debug_info debug;
@@ -280,9 +294,9 @@ _destructor_ static void cleanup_pools(void) {
 
         /* Be nice to valgrind */
 
-        /* The pool is only allocated by the main thread, but the memory can
-         * be passed to other threads. Let's clean up if we are the main thread
-         * and no other threads are live. */
+        /* Tiles may be allocated by any thread, and may be passed to other
+         * threads. Let's clean up if we are the main thread and no other
+         * threads are live. */
         /* We build our own is_main_thread() here, which doesn't use C11
          * TLS based caching of the result. That's because valgrind apparently
          * doesn't like malloc() (which C11 TLS internally uses) to be called
@@ -333,18 +347,81 @@ static uint8_t *hash_key(HashmapBase *h) {
                                : shared_hash_key;
 }
 
+static enum HashmapKeyType hash_ops_key_type(const struct hash_ops *hash_ops) {
+        assert(hash_ops);
+
+        if (hash_ops->hash == trivial_hash_func && hash_ops->compare == trivial_compare_func)
+                return HASHMAP_KEY_TRIVIAL;
+        if (hash_ops->hash == (hash_func_t) uint64_hash_func && hash_ops->compare == (compare_func_t) uint64_compare_func)
+                return HASHMAP_KEY_UINT64;
+        if (hash_ops->hash == (hash_func_t) string_hash_func && hash_ops->compare == (compare_func_t) string_compare_func)
+                return HASHMAP_KEY_STRING;
+        if (hash_ops->hash == (hash_func_t) fast_string_hash_func && hash_ops->compare == (compare_func_t) string_compare_func)
+                return HASHMAP_KEY_FAST_STRING;
+        if (hash_ops->hash == (hash_func_t) hashed_string_hash_func &&
+            hash_ops->compare == (compare_func_t) hashed_string_compare_func)
+                return HASHMAP_KEY_HASHED_STRING;
+
+        return HASHMAP_KEY_GENERIC;
+}
+
 static unsigned base_bucket_hash(HashmapBase *h, const void *p) {
         struct siphash state;
         uint64_t hash;
 
-        siphash24_init(&state, hash_key(h));
+        switch (h->key_type) {
+
+        case HASHMAP_KEY_TRIVIAL:
+                hash = siphash24_uint64((uint64_t) (uintptr_t) p, hash_key(h));
+                break;
+
+        case HASHMAP_KEY_UINT64:
+                hash = siphash24_uint64(*(const uint64_t*) p, hash_key(h));
+                break;
+
+        case HASHMAP_KEY_STRING:
+                hash = siphash24_string(p, hash_key(h));
+                break;
+
+        case HASHMAP_KEY_FAST_STRING:
+                hash = fast_hash64(p, strlen(p), hash_key(h));
+                break;
+
+        case HASHMAP_KEY_HASHED_STRING:
+                hash = siphash24_uint64(hashed_string_hash(p), hash_key(h));
+                break;
+
+        default:
+                siphash24_init(&state, hash_key(h));
 
-        h->hash_ops->hash(p, &state);
+                h->hash_ops->hash(p, &state);
 
-        hash = siphash24_finalize(&state);
+                hash = siphash24_finalize(&state);
+        }
 
         return (unsigned) (hash % n_buckets(h));
 }
+
+static bool base_key_equal(HashmapBase *h, const void *a, const void *b) {
+        switch (h->key_type) {
+
+        case HASHMAP_KEY_TRIVIAL:
+                return a == b;
+
+        case HASHMAP_KEY_UINT64:
+                return *(const uint64_t*) a == *(const uint64_t*) b;
+
+        case HASHMAP_KEY_STRING:
+        case HASHMAP_KEY_FAST_STRING:
+                return streq(a, b);
+
+        case HASHMAP_KEY_HASHED_STRING:
+                return hashed_string_hash(a) == hashed_string_hash(b) && streq(a, b);
+
+        default:
+                return h->hash_ops->compare(a, b) == 0;
+        }
+}
 #define bucket_hash(h, p) base_bucket_hash(HASHMAP_BASE(h), p)
 
 static void base_set_dirty(HashmapBase *h) {
@@ -782,6 +859,7 @@ static struct HashmapBase *hashmap_base_new(const struct hash_ops *hash_ops, enu
         h->type = type;
         h->from_pool = up;
         h->hash_ops = hash_ops ?: &trivial_hash_ops;
+        h->key_type = hash_ops_key_type(h->hash_ops);
 
         if (type == HASHMAP_TYPE_ORDERED) {
                 OrderedHashmap *lh = (OrderedHashmap*)h;
@@ -858,11 +936,9 @@ static void hashmap_free_no_clear(HashmapBase *h) {
         assert_se(pthread_mutex_unlock(&hashmap_debug_list_mutex) == 0);
 #endif
 
-        if (h->from_pool) {
-                /* Ensure that the object didn't get migrated between threads. */
-                assert_se(is_main_thread());
+        if (h->from_pool)
                 mempool_free_tile(hashmap_type_info[h->type].mempool, h);
-        } else
+        else
                 free(h);
 }
 
@@ -1199,7 +1275,7 @@ static unsigned base_bucket_scan(HashmapBase *h, unsigned idx, const void *key)
                         return IDX_NIL;
                 if (dib == distance) {
                         e = bucket_at(h, idx);
-                        if (h->hash_ops->compare(e->key, key) == 0)
+                        if (base_key_equal(h, e->key, key))
                                 return idx;
                 }
 
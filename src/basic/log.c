@@ -50,6 +50,11 @@ static int journal_fd = -1;
 
 static bool syslog_is_stream = false;
 
+/* Whether the last attempt to write to the journal socket timed out, and how many messages we didn't manage
+ * to send there since. */
+static bool journal_congested = false;
+static unsigned journal_n_diverted = 0;
+
 static bool show_color = false;
 static bool show_location = false;
 static bool show_time = false;
@@ -601,8 +606,29 @@ static int write_to_journal(
         mh.msg_iov = iovec;
         mh.msg_iovlen = ELEMENTSOF(iovec);
 
-        if (sendmsg(journal_fd, &mh, MSG_NOSIGNAL) < 0)
+        /* If the journal didn't keep up last time and we ran into the send timeout, don't wait for it again
+         * for each further message, but only try without blocking, until it catches up. The caller will
+         * write the messages elsewhere in the meantime. */
+        if (sendmsg(journal_fd, &mh, MSG_NOSIGNAL | (journal_congested ? MSG_DONTWAIT : 0)) < 0) {
+                if (errno == EAGAIN) {
+                        journal_congested = true;
+                        journal_n_diverted++;
+                }
+
                 return -errno;
+        }
+
+        if (journal_congested) {
+                char note[DECIMAL_STR_MAX(unsigned) + 96];
+                unsigned n;
+
+                n = journal_n_diverted;
+                journal_congested = false;
+                journal_n_diverted = 0;
+
+                xsprintf(note, "Journal socket was congested, %u log messages were written elsewhere.", n);
+                (void) write_to_journal(LOG_NOTICE|log_facility, 0, NULL, 0, NULL, NULL, NULL, NULL, NULL, note);
+        }
 
         return 1;
 }
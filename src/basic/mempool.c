@@ -1,22 +1,124 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "alloc-util.h"
 #include "env-util.h"
 #include "macro.h"
 #include "memory-util.h"
 #include "mempool.h"
-#include "process-util.h"
 #include "util.h"
 
+/* Tiles are handed out by per-thread state, so that allocating and freeing tiles in the thread that
+ * allocated them needs no locking. Each tile is preceded by a pointer to the state it was allocated from.
+ * Tiles freed by other threads are pushed onto a lock-free list of that state, which its thread collects
+ * once its own freelist runs dry. When a thread exits, its state is abandoned, as its tiles might still be
+ * in use, and adopted by the next thread that needs one. */
+
 struct pool {
         struct pool *next;
         size_t n_tiles;
         size_t n_used;
 };
 
+struct mempool_thread {
+        struct mempool *mempool;
+        struct mempool_thread *next; /* next state of the same thread, or next abandoned state */
+
+        struct pool *first_pool;
+        void *freelist;
+        void *remote_freelist;       /* tiles freed by other threads, only accessed atomically */
+};
+
+#define TILE_HEADER_SIZE ALIGN(sizeof(struct mempool_thread*))
+
+static thread_local struct mempool_thread *thread_states = NULL;
+
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static bool thread_key_valid = false;
+
+/* Protects the abandoned lists of all mempools */
+static pthread_mutex_t abandoned_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void mempool_thread_abandon(struct mempool_thread *t) {
+        assert_se(pthread_mutex_lock(&abandoned_mutex) == 0);
+        t->next = t->mempool->abandoned;
+        t->mempool->abandoned = t;
+        assert_se(pthread_mutex_unlock(&abandoned_mutex) == 0);
+}
+
+static void thread_states_abandon(void *p) {
+        struct mempool_thread *t = p;
+
+        /* Called on thread exit */
+
+        while (t) {
+                struct mempool_thread *n = t->next;
+
+                mempool_thread_abandon(t);
+                t = n;
+        }
+
+        thread_states = NULL;
+}
+
+static void thread_key_init(void) {
+        thread_key_valid = pthread_key_create(&thread_key, thread_states_abandon) == 0;
+}
+
+static struct mempool_thread *mempool_thread_find(struct mempool *mp) {
+        struct mempool_thread *t;
+
+        for (t = thread_states; t; t = t->next)
+                if (t->mempool == mp)
+                        return t;
+
+        return NULL;
+}
+
+static struct mempool_thread *mempool_thread_get(struct mempool *mp) {
+        struct mempool_thread *t;
+
+        t = mempool_thread_find(mp);
+        if (t)
+                return t;
+
+        assert_se(pthread_once(&thread_key_once, thread_key_init) == 0);
+        assert(thread_key_valid); /* checked by mempool_enabled() */
+
+        assert_se(pthread_mutex_lock(&abandoned_mutex) == 0);
+        t = mp->abandoned;
+        if (t)
+                mp->abandoned = t->next;
+        assert_se(pthread_mutex_unlock(&abandoned_mutex) == 0);
+
+        if (!t) {
+                t = new(struct mempool_thread, 1);
+                if (!t)
+                        return NULL;
+
+                *t = (struct mempool_thread) {
+                        .mempool = mp,
+                };
+        }
+
+        /* The key points to the whole list of this thread, so that its destructor can abandon all of them */
+        t->next = thread_states;
+        if (pthread_setspecific(thread_key, t) != 0) {
+                mempool_thread_abandon(t);
+                return NULL;
+        }
+        thread_states = t;
+
+        return t;
+}
+
 void* mempool_alloc_tile(struct mempool *mp) {
+        struct mempool_thread *t;
+        uint8_t *tile;
         size_t i;
 
         /* When a tile is released we add it to the list and simply
@@ -25,38 +127,48 @@ void* mempool_alloc_tile(struct mempool *mp) {
         assert(mp->tile_size >= sizeof(void*));
         assert(mp->at_least > 0);
 
-        if (mp->freelist) {
+        t = mempool_thread_get(mp);
+        if (!t)
+                return NULL;
+
+        if (!t->freelist)
+                t->freelist = __atomic_exchange_n(&t->remote_freelist, NULL, __ATOMIC_ACQUIRE);
+
+        if (t->freelist) {
                 void *r;
 
-                r = mp->freelist;
-                mp->freelist = * (void**) mp->freelist;
+                r = t->freelist;
+                t->freelist = * (void**) t->freelist;
                 return r;
         }
 
-        if (_unlikely_(!mp->first_pool) ||
-            _unlikely_(mp->first_pool->n_used >= mp->first_pool->n_tiles)) {
+        if (_unlikely_(!t->first_pool) ||
+            _unlikely_(t->first_pool->n_used >= t->first_pool->n_tiles)) {
                 size_t size, n;
                 struct pool *p;
 
-                n = mp->first_pool ? mp->first_pool->n_tiles : 0;
+                n = t->first_pool ? t->first_pool->n_tiles : 0;
                 n = MAX(mp->at_least, n * 2);
-                size = PAGE_ALIGN(ALIGN(sizeof(struct pool)) + n*mp->tile_size);
-                n = (size - ALIGN(sizeof(struct pool))) / mp->tile_size;
+                size = PAGE_ALIGN(ALIGN(sizeof(struct pool)) + n*(TILE_HEADER_SIZE + mp->tile_size));
+                n = (size - ALIGN(sizeof(struct pool))) / (TILE_HEADER_SIZE + mp->tile_size);
 
                 p = malloc(size);
                 if (!p)
                         return NULL;
 
-                p->next = mp->first_pool;
+                p->next = t->first_pool;
                 p->n_tiles = n;
                 p->n_used = 0;
 
-                mp->first_pool = p;
+                t->first_pool = p;
         }
 
-        i = mp->first_pool->n_used++;
+        i = t->first_pool->n_used++;
+
+        tile = ((uint8_t*) t->first_pool) + ALIGN(sizeof(struct pool)) + i*(TILE_HEADER_SIZE + mp->tile_size);
+        * (struct mempool_thread**) tile = t;
 
-        return ((uint8_t*) mp->first_pool) + ALIGN(sizeof(struct pool)) + i*mp->tile_size;
+        return tile + TILE_HEADER_SIZE;
 }
 
 void* mempool_alloc0_tile(struct mempool *mp) {
@@ -69,32 +181,61 @@ void* mempool_alloc0_tile(struct mempool *mp) {
 }
 
 void mempool_free_tile(struct mempool *mp, void *p) {
-        * (void**) p = mp->freelist;
-        mp->freelist = p;
+        struct mempool_thread *t;
+        void *head;
+
+        t = * (struct mempool_thread**) ((uint8_t*) p - TILE_HEADER_SIZE);
+        assert(t->mempool == mp);
+
+        if (t == mempool_thread_find(mp)) {
+                * (void**) p = t->freelist;
+                t->freelist = p;
+                return;
+        }
+
+        /* Allocated by another thread, hand it back */
+        head = __atomic_load_n(&t->remote_freelist, __ATOMIC_RELAXED);
+        do
+                * (void**) p = head;
+        while (!__atomic_compare_exchange_n(&t->remote_freelist, &head, p, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
 }
 
 bool mempool_enabled(void) {
         static int b = -1;
 
-        if (!is_main_thread())
-                return false;
-
         if (!mempool_use_allowed)
                 b = false;
-        if (b < 0)
-                b = getenv_bool("SYSTEMD_MEMPOOL") != 0;
+        if (b < 0) {
+                assert_se(pthread_once(&thread_key_once, thread_key_init) == 0);
+                b = thread_key_valid && getenv_bool("SYSTEMD_MEMPOOL") != 0;
+        }
 
         return b;
 }
 
 #if VALGRIND
-void mempool_drop(struct mempool *mp) {
-        struct pool *p = mp->first_pool;
+static void mempool_thread_drop(struct mempool_thread *t) {
+        struct pool *p = t->first_pool;
         while (p) {
                 struct pool *n;
                 n = p->next;
                 free(p);
                 p = n;
         }
+        t->first_pool = NULL;
+        t->freelist = t->remote_freelist = NULL;
+}
+
+void mempool_drop(struct mempool *mp) {
+        struct mempool_thread *t;
+
+        /* Only call this if no other threads are around anymore */
+
+        t = mempool_thread_find(mp);
+        if (t)
+                mempool_thread_drop(t);
+
+        for (t = mp->abandoned; t; t = t->next)
+                mempool_thread_drop(t);
 }
 #endif
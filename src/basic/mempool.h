@@ -4,13 +4,13 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-struct pool;
+struct mempool_thread;
 
+/* Tiles may be freed by any thread, not only the one that allocated them. */
 struct mempool {
-        struct pool *first_pool;
-        void *freelist;
         size_t tile_size;
         unsigned at_least;
+        struct mempool_thread *abandoned; /* per-thread state of exited threads, for reuse */
 };
 
 void* mempool_alloc_tile(struct mempool *mp);
@@ -28,6 +28,10 @@ struct sockaddr_vm {
 #define SO_REUSEPORT 15
 #endif
 
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 #ifndef SO_PEERGROUPS
 #define SO_PEERGROUPS 59
 #endif
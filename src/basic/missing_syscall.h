@@ -693,6 +693,40 @@ static inline int missing_pidfd_open(pid_t pid, unsigned flags) {
 
 /* ======================================================================= */
 
+/* should be always defined, see kernel 2b188cc1bb857a9d4701ae59aa7768b5124e262e */
+#if defined(__alpha__)
+#  define systemd_NR_io_uring_setup 535
+#  define systemd_NR_io_uring_enter 536
+#else
+#  define systemd_NR_io_uring_setup 425
+#  define systemd_NR_io_uring_enter 426
+#endif
+
+/* may be (invalid) negative number due to libseccomp, see PR 13319 */
+#if defined __NR_io_uring_setup && __NR_io_uring_setup >= 0
+#  if defined systemd_NR_io_uring_setup
+assert_cc(__NR_io_uring_setup == systemd_NR_io_uring_setup);
+#  endif
+#else
+#  if defined __NR_io_uring_setup
+#    undef __NR_io_uring_setup
+#  endif
+#  define __NR_io_uring_setup systemd_NR_io_uring_setup
+#endif
+
+#if defined __NR_io_uring_enter && __NR_io_uring_enter >= 0
+#  if defined systemd_NR_io_uring_enter
+assert_cc(__NR_io_uring_enter == systemd_NR_io_uring_enter);
+#  endif
+#else
+#  if defined __NR_io_uring_enter
+#    undef __NR_io_uring_enter
+#  endif
+#  define __NR_io_uring_enter systemd_NR_io_uring_enter
+#endif
+
+/* ======================================================================= */
+
 #if !HAVE_RT_SIGQUEUEINFO
 static inline int missing_rt_sigqueueinfo(pid_t tgid, int sig, siginfo_t *info) {
 #  if defined __NR_rt_sigqueueinfo && __NR_rt_sigqueueinfo >= 0
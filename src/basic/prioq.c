@@ -7,7 +7,13 @@
  * priority. Insertion and removal are Θ(log n). Optionally, the caller can
  * provide a pointer to an index which will be kept up-to-date by the prioq.
  *
- * The underlying algorithm used in this implementation is a Heap.
+ * The underlying algorithm used in this implementation is a 4-ary Heap. Compared
+ * to a binary heap it is only half as deep, and the children of an item are
+ * adjacent in memory, hence it needs fewer cache lines per operation.
+ *
+ * If no compare function is given, the items are ordered by a 64bit key that
+ * is stored along with them, so that comparisons neither call out nor
+ * dereference the item data.
  */
 
 #include <errno.h>
@@ -17,9 +23,12 @@
 #include "hashmap.h"
 #include "prioq.h"
 
+#define PRIOQ_ARITY 4U
+
 struct prioq_item {
         void *data;
         unsigned *idx;
+        uint64_t key;
 };
 
 struct Prioq {
@@ -64,84 +73,85 @@ int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func) {
         return 0;
 }
 
-static void swap(Prioq *q, unsigned j, unsigned k) {
-        assert(q);
-        assert(j < q->n_items);
-        assert(k < q->n_items);
+static int compare(Prioq *q, const struct prioq_item *a, const struct prioq_item *b) {
+        if (!q->compare_func)
+                return CMP(a->key, b->key);
 
-        assert(!q->items[j].idx || *(q->items[j].idx) == j);
-        assert(!q->items[k].idx || *(q->items[k].idx) == k);
+        return q->compare_func(a->data, b->data);
+}
 
-        SWAP_TWO(q->items[j].data, q->items[k].data);
-        SWAP_TWO(q->items[j].idx, q->items[k].idx);
+static void place(Prioq *q, unsigned k, const struct prioq_item *i) {
+        assert(q);
+        assert(k < q->n_items);
 
-        if (q->items[j].idx)
-                *q->items[j].idx = j;
+        q->items[k] = *i;
 
-        if (q->items[k].idx)
-                *q->items[k].idx = k;
+        if (i->idx)
+                *i->idx = k;
 }
 
+/* Both directions move the item into a hole that travels through the heap, instead of swapping it
+ * with each item it passes, so that every item on the way is written only once. */
+
 static unsigned shuffle_up(Prioq *q, unsigned idx) {
+        struct prioq_item i;
+
         assert(q);
         assert(idx < q->n_items);
 
+        i = q->items[idx];
+
         while (idx > 0) {
                 unsigned k;
 
-                k = (idx-1)/2;
+                k = (idx-1)/PRIOQ_ARITY;
 
-                if (q->compare_func(q->items[k].data, q->items[idx].data) <= 0)
+                if (compare(q, q->items + k, &i) <= 0)
                         break;
 
-                swap(q, idx, k);
+                place(q, idx, q->items + k);
                 idx = k;
         }
 
+        place(q, idx, &i);
         return idx;
 }
 
 static unsigned shuffle_down(Prioq *q, unsigned idx) {
+        struct prioq_item i;
+
         assert(q);
+        assert(idx < q->n_items);
+
+        i = q->items[idx];
 
         for (;;) {
                 unsigned j, k, s;
 
-                k = (idx+1)*2; /* right child */
-                j = k-1;       /* left child */
-
+                j = idx*PRIOQ_ARITY + 1; /* first child */
                 if (j >= q->n_items)
                         break;
 
-                if (q->compare_func(q->items[j].data, q->items[idx].data) < 0)
-
-                        /* So our left child is smaller than we are, let's
-                         * remember this fact */
-                        s = j;
-                else
-                        s = idx;
-
-                if (k < q->n_items &&
-                    q->compare_func(q->items[k].data, q->items[s].data) < 0)
+                k = MIN(j + PRIOQ_ARITY, q->n_items); /* one past the last child */
 
-                        /* So our right child is smaller than we are, let's
-                         * remember this fact */
-                        s = k;
+                /* Find the smallest child */
+                for (s = j++; j < k; j++)
+                        if (compare(q, q->items + j, q->items + s) < 0)
+                                s = j;
 
-                /* s now points to the smallest of the three items */
-
-                if (s == idx)
-                        /* No swap necessary, we're done */
+                if (compare(q, q->items + s, &i) >= 0)
+                        /* None of the children is smaller than we are, we're done */
                         break;
 
-                swap(q, idx, s);
+                place(q, idx, q->items + s);
                 idx = s;
         }
 
+        place(q, idx, &i);
         return idx;
 }
 
-int prioq_put(Prioq *q, void *data, unsigned *idx) {
+int prioq_put_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key) {
         struct prioq_item *i;
         unsigned k;
 
@@ -162,8 +172,11 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
 
         k = q->n_items++;
         i = q->items + k;
-        i->data = data;
-        i->idx = idx;
+        *i = (struct prioq_item) {
+                .data = data,
+                .idx = idx,
+                .key = key,
+        };
 
         if (idx)
                 *idx = k;
@@ -173,6 +186,13 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
         return 0;
 }
 
+int prioq_put(Prioq *q, void *data, unsigned *idx) {
+        assert(q);
+        assert(q->compare_func);
+
+        return prioq_put_with_key(q, data, idx, 0);
+}
+
 static void remove_item(Prioq *q, struct prioq_item *i) {
         struct prioq_item *l;
 
@@ -192,8 +212,7 @@ static void remove_item(Prioq *q, struct prioq_item *i) {
 
                 k = i - q->items;
 
-                i->data = l->data;
-                i->idx = l->idx;
+                *i = *l;
                 if (i->idx)
                         *i->idx = k;
                 q->n_items--;
@@ -243,9 +262,20 @@ int prioq_remove(Prioq *q, void *data, unsigned *idx) {
         return 1;
 }
 
+static int reshuffle_item(Prioq *q, struct prioq_item *i) {
+        unsigned k;
+
+        assert(q);
+        assert(i);
+
+        k = i - q->items;
+        k = shuffle_down(q, k);
+        shuffle_up(q, k);
+        return 1;
+}
+
 int prioq_reshuffle(Prioq *q, void *data, unsigned *idx) {
         struct prioq_item *i;
-        unsigned k;
 
         assert(q);
 
@@ -253,10 +283,20 @@ int prioq_reshuffle(Prioq *q, void *data, unsigned *idx) {
         if (!i)
                 return 0;
 
-        k = i - q->items;
-        k = shuffle_down(q, k);
-        shuffle_up(q, k);
-        return 1;
+        return reshuffle_item(q, i);
+}
+
+int prioq_reshuffle_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key) {
+        struct prioq_item *i;
+
+        assert(q);
+
+        i = find_item(q, data, idx);
+        if (!i)
+                return 0;
+
+        i->key = key;
+        return reshuffle_item(q, i);
 }
 
 void *prioq_peek_by_index(Prioq *q, unsigned idx) {
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 #pragma once
 
+#include <inttypes.h>
 #include <stdbool.h>
 
 #include "hashmap.h"
@@ -19,6 +20,10 @@ int prioq_put(Prioq *q, void *data, unsigned *idx);
 int prioq_remove(Prioq *q, void *data, unsigned *idx);
 int prioq_reshuffle(Prioq *q, void *data, unsigned *idx);
 
+/* For queues allocated without a compare function, which are ordered by the key passed here */
+int prioq_put_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key);
+int prioq_reshuffle_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key);
+
 void *prioq_peek_by_index(Prioq *q, unsigned idx) _pure_;
 static inline void *prioq_peek(Prioq *q) {
         return prioq_peek_by_index(q, 0);
@@ -17,6 +17,7 @@
     coding style)
 */
 
+#include <endian.h>
 #include <stdio.h>
 
 #include "macro.h"
@@ -198,3 +199,23 @@ uint64_t siphash24(const void *in, size_t inlen, const uint8_t k[static 16]) {
 
         return siphash24_finalize(&state);
 }
+
+uint64_t siphash24_uint64(uint64_t v, const uint8_t k[static 16]) {
+        struct siphash state;
+        uint64_t m;
+
+        assert(k);
+
+        /* Returns the same as siphash24() on the 8 bytes of "v", but skips the handling of partial blocks */
+
+        siphash24_init(&state, k);
+
+        m = le64toh(v);
+        state.v3 ^= m;
+        sipround(&state);
+        sipround(&state);
+        state.v0 ^= m;
+        state.inlen = sizeof(v);
+
+        return siphash24_finalize(&state);
+}
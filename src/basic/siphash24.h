@@ -35,6 +35,7 @@ static inline void siphash24_compress_string(const char *in, struct siphash *sta
 uint64_t siphash24_finalize(struct siphash *state);
 
 uint64_t siphash24(const void *in, size_t inlen, const uint8_t k[static 16]);
+uint64_t siphash24_uint64(uint64_t v, const uint8_t k[static 16]);
 
 static inline uint64_t siphash24_string(const char *s, const uint8_t k[static 16]) {
         return siphash24(s, strlen(s) + 1, k);
@@ -5,7 +5,6 @@
 #include <string.h>
 
 #include "alloc-util.h"
-#include "sort-util.h"
 #include "strbuf.h"
 
 /*
@@ -36,6 +35,7 @@ struct strbuf *strbuf_new(void) {
                 .buf = new0(char, 1),
                 .root = new0(struct strbuf_node, 1),
                 .len = 1,
+                .allocated = 1,
                 .nodes_count = 1,
         };
         if (!str->buf || !str->root) {
@@ -104,12 +104,29 @@ static void bubbleinsert(struct strbuf_node *node,
         node->children_count++;
 }
 
+static struct strbuf_child_entry *strbuf_node_lookup(const struct strbuf_node *node, uint8_t c) {
+        size_t left = 0, right = node->children_count;
+
+        /* This is the hot path when adding strings, hence don't go through bsearch() and a callback */
+        while (left < right) {
+                size_t middle = (left + right) / 2;
+
+                if (node->children[middle].c < c)
+                        left = middle + 1;
+                else if (node->children[middle].c > c)
+                        right = middle;
+                else
+                        return node->children + middle;
+        }
+
+        return NULL;
+}
+
 /* add string, return the index/offset into the buffer */
 ssize_t strbuf_add_string(struct strbuf *str, const char *s, size_t len) {
         uint8_t c;
         struct strbuf_node *node;
         size_t depth;
-        char *buf_new;
         struct strbuf_child_entry *child;
         struct strbuf_node *node_child;
         ssize_t off;
@@ -128,8 +145,6 @@ ssize_t strbuf_add_string(struct strbuf *str, const char *s, size_t len) {
 
         node = str->root;
         for (depth = 0; depth <= len; depth++) {
-                struct strbuf_child_entry search;
-
                 /* match against current node */
                 off = node->value_off + node->value_len - len;
                 if (depth == len || (node->value_len >= len && memcmp(str->buf + off, s, len) == 0)) {
@@ -141,18 +156,15 @@ ssize_t strbuf_add_string(struct strbuf *str, const char *s, size_t len) {
                 c = s[len - 1 - depth];
 
                 /* lookup child node */
-                search.c = c;
-                child = typesafe_bsearch(&search, node->children, node->children_count, strbuf_children_cmp);
+                child = strbuf_node_lookup(node, c);
                 if (!child)
                         break;
                 node = child->child;
         }
 
         /* add new string */
-        buf_new = realloc(str->buf, str->len + len+1);
-        if (!buf_new)
+        if (!GREEDY_REALLOC(str->buf, str->allocated, str->len + len+1))
                 return -ENOMEM;
-        str->buf = buf_new;
         off = str->len;
         memcpy(str->buf + off, s, len);
         str->len += len;
@@ -10,6 +10,7 @@
 struct strbuf {
         char *buf;
         size_t len;
+        size_t allocated;
         struct strbuf_node *root;
 
         size_t nodes_count;
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+
+/* Statically defined tracepoints, for use with bpftrace, BCC, perf or SystemTap. A probe is a single nop
+ * instruction plus a note in the ELF file describing where its arguments can be found, hence it costs next
+ * to nothing when no tracer is attached. Arguments should be values already at hand (integers, pointers,
+ * strings that already exist), as they are evaluated even if nobody is listening. They must not be
+ * bit-fields, since <sys/sdt.h> applies sizeof() and typeof() to them.
+ *
+ * The provider names the subsystem, and the probe name the point in the code. Probes that mark the end of
+ * an operation are suffixed with "_done", and carry the same first argument as the matching start probe,
+ * so that the two can be correlated. See docs/TRACING.md for the list of probes. If built with -Dusdt=false
+ * the probes are compiled out entirely, and their arguments aren't evaluated. */
+
+#if ENABLE_USDT
+#  include <sys/sdt.h>
+#  define USDT(provider, name, ...) STAP_PROBEV(provider, name, ##__VA_ARGS__)
+#else
+/* Keep the arguments type-checked and "used", but never evaluate them */
+static inline void usdt_unused(int dummy, ...) {}
+#  define USDT(provider, name, ...)                                     \
+        do {                                                            \
+                if (false)                                              \
+                        usdt_unused(0, ##__VA_ARGS__);                  \
+        } while (false)
+#endif
@@ -25,7 +25,9 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "alloc-util.h"
 #include "gunicode.h"
@@ -123,6 +125,47 @@ int utf8_encoded_to_unichar(const char *str, char32_t *ret_unichar) {
         return 0;
 }
 
+/* The fast paths below look at 8 bytes at once, with plain word operations rather than SSE2/AVX2/NEON
+ * intrinsics, so that they work the same on all architectures and need no runtime dispatching. Compilers
+ * vectorize the loops over multiple words by themselves where that pays off. */
+#define WORD_ONES UINT64_C(0x0101010101010101)
+#define WORD_HIGH UINT64_C(0x8080808080808080)
+
+static inline uint64_t word_load(const char *p) {
+        uint64_t v;
+
+        memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+/* Returns true if all 8 bytes are printable ASCII, i.e. in the range ' '…'~'. */
+static inline bool word_is_printable_ascii(uint64_t v) {
+        uint64_t del = v ^ (WORD_ONES * 0x7F);
+
+        /* The high bit of a byte is set in the result if the byte itself has it set, if it is below ' '
+         * or if it is DEL. This is only exact for words without bytes with the high bit set, but these
+         * are refused anyway. */
+        return ((v | ((v - WORD_ONES * ' ') & ~v) | ((del - WORD_ONES) & ~del)) & WORD_HIGH) == 0;
+}
+
+/* Returns the number of ASCII bytes at the beginning of the first "length" bytes of "str". */
+static size_t ascii_span(const char *str, size_t length) {
+        size_t i = 0;
+
+        for (; i + 16 <= length; i += 16)
+                if ((word_load(str + i) | word_load(str + i + 8)) & WORD_HIGH)
+                        break;
+
+        for (; i + 8 <= length; i += 8)
+                if (word_load(str + i) & WORD_HIGH)
+                        break;
+
+        while (i < length && (uint8_t) str[i] < 0x80)
+                i++;
+
+        return i;
+}
+
 bool utf8_is_printable_newline(const char* str, size_t length, bool allow_newline) {
         const char *p;
 
@@ -132,6 +175,12 @@ bool utf8_is_printable_newline(const char* str, size_t length, bool allow_newlin
                 int encoded_len, r;
                 char32_t val;
 
+                if (length >= 8 && word_is_printable_ascii(word_load(p))) {
+                        p += 8;
+                        length -= 8;
+                        continue;
+                }
+
                 encoded_len = utf8_encoded_valid_unichar(p, length);
                 if (encoded_len < 0)
                         return false;
@@ -151,15 +200,20 @@ bool utf8_is_printable_newline(const char* str, size_t length, bool allow_newlin
 }
 
 char *utf8_is_valid(const char *str) {
-        const char *p;
+        const char *p, *e;
 
         assert(str);
 
         p = str;
-        while (*p) {
+        e = str + strlen(str);
+        while (p < e) {
                 int len;
 
-                len = utf8_encoded_valid_unichar(p, (size_t) -1);
+                p += ascii_span(p, e - p);
+                if (p >= e)
+                        break;
+
+                len = utf8_encoded_valid_unichar(p, e - p);
                 if (len < 0)
                         return NULL;
 
@@ -170,18 +224,30 @@ char *utf8_is_valid(const char *str) {
 }
 
 char *utf8_escape_invalid(const char *str) {
+        const char *e;
         char *p, *s;
+        size_t l;
 
         assert(str);
 
-        p = s = malloc(strlen(str) * 4 + 1);
+        l = strlen(str);
+        e = str + l;
+
+        p = s = malloc(l * 4 + 1);
         if (!p)
                 return NULL;
 
-        while (*str) {
+        while (str < e) {
+                size_t n;
                 int len;
 
-                len = utf8_encoded_valid_unichar(str, (size_t) -1);
+                n = ascii_span(str, e - str);
+                s = mempcpy(s, str, n);
+                str += n;
+                if (str >= e)
+                        break;
+
+                len = utf8_encoded_valid_unichar(str, e - str);
                 if (len > 0) {
                         s = mempcpy(s, str, len);
                         str += len;
@@ -283,16 +349,16 @@ char *utf8_escape_non_printable_full(const char *str, size_t console_width) {
 }
 
 char *ascii_is_valid(const char *str) {
-        const char *p;
+        size_t l;
 
         /* Check whether the string consists of valid ASCII bytes,
          * i.e values between 0 and 127, inclusive. */
 
         assert(str);
 
-        for (p = str; *p; p++)
-                if ((unsigned char) *p >= 128)
-                        return NULL;
+        l = strlen(str);
+        if (ascii_span(str, l) < l)
+                return NULL;
 
         return (char*) str;
 }
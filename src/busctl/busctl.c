@@ -60,6 +60,8 @@ static bool arg_augment_creds = true;
 static bool arg_watch_bind = false;
 static usec_t arg_timeout = 0;
 static const char *arg_destination = NULL;
+static unsigned arg_count = 1000;
+static unsigned arg_concurrency = 16;
 
 STATIC_DESTRUCTOR_REGISTER(arg_matches, strv_freep);
 
@@ -2011,15 +2013,15 @@ static void json_dump_with_flags(JsonVariant *v, FILE *f) {
                           f, NULL);
 }
 
-static int call(int argc, char **argv, void *userdata) {
-        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
-        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+static int method_call_new_from_argv(sd_bus *bus, char **argv, sd_bus_message **ret) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         int r;
 
-        r = acquire_bus(false, &bus);
-        if (r < 0)
-                return r;
+        assert(bus);
+        assert(argv);
+        assert(ret);
+
+        /* Takes SERVICE OBJECT INTERFACE METHOD [SIGNATURE [ARGUMENT...]] in argv[1] and following */
 
         r = sd_bus_message_new_method_call(bus, &m, argv[1], argv[2], argv[3], argv[4]);
         if (r < 0)
@@ -2051,6 +2053,24 @@ static int call(int argc, char **argv, void *userdata) {
                                                "Too many parameters for signature.");
         }
 
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
+static int call(int argc, char **argv, void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        int r;
+
+        r = acquire_bus(false, &bus);
+        if (r < 0)
+                return r;
+
+        r = method_call_new_from_argv(bus, argv, &m);
+        if (r < 0)
+                return r;
+
         if (!arg_expect_reply) {
                 r = sd_bus_send(bus, m, NULL);
                 if (r < 0)
@@ -2103,6 +2123,156 @@ static int call(int argc, char **argv, void *userdata) {
         return 0;
 }
 
+typedef struct BenchCall BenchCall;
+
+typedef struct Bench {
+        sd_bus *bus;
+        char **argv;
+
+        unsigned n_sent;
+        unsigned n_done;
+        unsigned n_failed;
+        int error;
+
+        BenchCall *calls;
+        usec_t *latencies;
+} Bench;
+
+struct BenchCall {
+        Bench *bench;
+        usec_t sent;
+};
+
+static int bench_send(Bench *b);
+
+static int bench_reply(sd_bus_message *reply, void *userdata, sd_bus_error *ret_error) {
+        BenchCall *c = userdata;
+        Bench *b = c->bench;
+        int r;
+
+        assert(reply);
+        assert(b);
+
+        b->latencies[b->n_done++] = now(CLOCK_MONOTONIC) - c->sent;
+
+        if (sd_bus_message_is_method_error(reply, NULL)) {
+                const sd_bus_error *e = sd_bus_message_get_error(reply);
+
+                /* Only log the first failure, it's likely all of them fail the same way */
+                if (b->n_failed++ == 0)
+                        log_warning("Call failed: %s", bus_error_message(e, sd_bus_error_get_errno(e)));
+        }
+
+        r = bench_send(b);
+        if (r < 0 && b->error == 0)
+                b->error = r;
+
+        return 0;
+}
+
+static int bench_send(Bench *b) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        BenchCall *c;
+        int r;
+
+        assert(b);
+
+        if (b->n_sent >= arg_count)
+                return 0;
+
+        r = method_call_new_from_argv(b->bus, b->argv, &m);
+        if (r < 0)
+                return r;
+
+        c = b->calls + b->n_sent;
+        *c = (BenchCall) {
+                .bench = b,
+                .sent = now(CLOCK_MONOTONIC),
+        };
+
+        r = sd_bus_call_async(b->bus, NULL, m, bench_reply, c, arg_timeout);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue method call: %m");
+
+        b->n_sent++;
+        return 0;
+}
+
+static int usec_compare(const usec_t *a, const usec_t *b) {
+        return CMP(*a, *b);
+}
+
+static usec_t bench_percentile(Bench *b, unsigned percent) {
+        assert(b);
+        assert(b->n_done > 0);
+
+        return b->latencies[(b->n_done - 1) * percent / 100];
+}
+
+static int bench(int argc, char **argv, void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_free_ BenchCall *calls = NULL;
+        _cleanup_free_ usec_t *latencies = NULL;
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t start, elapsed;
+        unsigned i;
+        Bench b;
+        int r;
+
+        r = acquire_bus(false, &bus);
+        if (r < 0)
+                return r;
+
+        calls = new(BenchCall, arg_count);
+        latencies = new(usec_t, arg_count);
+        if (!calls || !latencies)
+                return log_oom();
+
+        b = (Bench) {
+                .bus = bus,
+                .argv = argv,
+                .calls = calls,
+                .latencies = latencies,
+        };
+
+        /* Keep arg_concurrency calls in flight at any time, issuing the next one whenever a reply comes in */
+        start = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < arg_concurrency; i++) {
+                r = bench_send(&b);
+                if (r < 0)
+                        return r;
+        }
+
+        while (b.n_done < b.n_sent) {
+                r = sd_bus_process(bus, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to process bus: %m");
+                if (b.error < 0)
+                        return b.error;
+                if (r > 0)
+                        continue;
+
+                r = sd_bus_wait(bus, (uint64_t) -1);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to wait for bus: %m");
+        }
+
+        elapsed = now(CLOCK_MONOTONIC) - start;
+
+        typesafe_qsort(latencies, b.n_done, usec_compare);
+
+        printf("Calls:       %u (%u failed)\n", b.n_done, b.n_failed);
+        printf("Concurrency: %u\n", arg_concurrency);
+        printf("Time:        %s\n", format_timespan(ts, sizeof(ts), elapsed, 1));
+        printf("Throughput:  %.1f calls/s\n", (double) b.n_done * USEC_PER_SEC / MAX(elapsed, (usec_t) 1));
+        printf("Latency p50: %s\n", format_timespan(ts, sizeof(ts), bench_percentile(&b, 50), 1));
+        printf("Latency p99: %s\n", format_timespan(ts, sizeof(ts), bench_percentile(&b, 99), 1));
+        printf("Latency max: %s\n", format_timespan(ts, sizeof(ts), latencies[b.n_done - 1], 1));
+
+        return b.n_failed > 0 ? -EREMOTEIO : 0;
+}
+
 static int emit_signal(int argc, char **argv, void *userdata) {
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
@@ -2279,6 +2449,8 @@ static int help(void) {
                "  introspect SERVICE OBJECT [INTERFACE]\n"
                "  call SERVICE OBJECT INTERFACE METHOD [SIGNATURE [ARGUMENT...]]\n"
                "                           Call a method\n"
+               "  bench SERVICE OBJECT INTERFACE METHOD [SIGNATURE [ARGUMENT...]]\n"
+               "                           Call a method repeatedly and show call latency\n"
                "  emit OBJECT INTERFACE SIGNAL [SIGNATURE [ARGUMENT...]]\n"
                "                           Emit a signal\n"
                "  get-property SERVICE OBJECT INTERFACE PROPERTY...\n"
@@ -2317,6 +2489,8 @@ static int help(void) {
                "     --watch-bind=BOOL     Wait for bus AF_UNIX socket to be bound in the file\n"
                "                           system\n"
                "     --destination=SERVICE Destination service of a signal\n"
+               "     --count=N             Number of method calls to issue with bench\n"
+               "     --concurrency=N       Number of method calls to keep in flight with bench\n"
                "\nSee the %s for details.\n"
                , program_invocation_short_name
                , ansi_highlight()
@@ -2357,6 +2531,8 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_WATCH_BIND,
                 ARG_JSON,
                 ARG_DESTINATION,
+                ARG_COUNT,
+                ARG_CONCURRENCY,
         };
 
         static const struct option options[] = {
@@ -2388,6 +2564,8 @@ static int parse_argv(int argc, char *argv[]) {
                 { "watch-bind",                      required_argument, NULL, ARG_WATCH_BIND                      },
                 { "json",                            required_argument, NULL, ARG_JSON                            },
                 { "destination",                     required_argument, NULL, ARG_DESTINATION                     },
+                { "count",                           required_argument, NULL, ARG_COUNT                           },
+                { "concurrency",                     required_argument, NULL, ARG_CONCURRENCY                     },
                 {},
         };
 
@@ -2566,6 +2744,24 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_destination = optarg;
                         break;
 
+                case ARG_COUNT:
+                        r = safe_atou(optarg, &arg_count);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --count= parameter '%s': %m", optarg);
+                        if (arg_count == 0)
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "--count= parameter must be positive.");
+
+                        break;
+
+                case ARG_CONCURRENCY:
+                        r = safe_atou(optarg, &arg_concurrency);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --concurrency= parameter '%s': %m", optarg);
+                        if (arg_concurrency == 0)
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "--concurrency= parameter must be positive.");
+
+                        break;
+
                 case '?':
                         return -EINVAL;
 
@@ -2585,6 +2781,7 @@ static int busctl_main(int argc, char *argv[]) {
                 { "tree",         VERB_ANY, VERB_ANY, 0,            tree           },
                 { "introspect",   3,        4,        0,            introspect     },
                 { "call",         5,        VERB_ANY, 0,            call           },
+                { "bench",        5,        VERB_ANY, 0,            bench          },
                 { "emit",         4,        VERB_ANY, 0,            emit_signal    },
                 { "get-property", 5,        VERB_ANY, 0,            get_property   },
                 { "set-property", 6,        VERB_ANY, 0,            set_property   },
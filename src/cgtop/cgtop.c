@@ -419,7 +419,7 @@ static int process(
 }
 
 static int refresh_one(
-                const char *controller,
+                char **controllers,
                 const char *path,
                 Hashmap *a,
                 Hashmap *b,
@@ -429,20 +429,23 @@ static int refresh_one(
 
         _cleanup_closedir_ DIR *d = NULL;
         Group *ours = NULL;
+        char **c;
         int r;
 
-        assert(controller);
+        assert(!strv_isempty(controllers));
         assert(path);
         assert(a);
 
         if (depth > arg_depth)
                 return 0;
 
-        r = process(controller, path, a, b, iteration, &ours);
-        if (r < 0)
-                return r;
+        STRV_FOREACH(c, controllers) {
+                r = process(*c, path, a, b, iteration, &ours);
+                if (r < 0)
+                        return r;
+        }
 
-        r = cg_enumerate_subgroups(controller, path, &d);
+        r = cg_enumerate_subgroups(controllers[0], path, &d);
         if (r == -ENOENT)
                 return 0;
         if (r < 0)
@@ -464,7 +467,7 @@ static int refresh_one(
 
                 path_simplify(p, false);
 
-                r = refresh_one(controller, p, a, b, iteration, depth + 1, &child);
+                r = refresh_one(controllers, p, a, b, iteration, depth + 1, &child);
                 if (r < 0)
                         return r;
 
@@ -472,7 +475,7 @@ static int refresh_one(
                     IN_SET(arg_count, COUNT_ALL_PROCESSES, COUNT_USERSPACE_PROCESSES) &&
                     child &&
                     child->n_tasks_valid &&
-                    streq(controller, SYSTEMD_CGROUP_CONTROLLER)) {
+                    strv_contains(controllers, SYSTEMD_CGROUP_CONTROLLER)) {
 
                         /* Recursively sum up processes */
 
@@ -495,8 +498,17 @@ static int refresh(const char *root, Hashmap *a, Hashmap *b, unsigned iteration)
         const char *c;
         int r;
 
+        r = cg_all_unified();
+        if (r < 0)
+                return r;
+        if (r > 0)
+                /* On the unified hierarchy all controllers share the same tree, hence walk it only once and
+                 * collect everything on the way. The legacy controllers have nothing to offer there. */
+                return refresh_one(STRV_MAKE(SYSTEMD_CGROUP_CONTROLLER, "cpu", "memory", "io", "pids"),
+                                   root, a, b, iteration, 0, NULL);
+
         FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpu", "cpuacct", "memory", "io", "blkio", "pids") {
-                r = refresh_one(c, root, a, b, iteration, 0, NULL);
+                r = refresh_one(STRV_MAKE(c), root, a, b, iteration, 0, NULL);
                 if (r < 0)
                         return r;
         }
@@ -3,18 +3,119 @@
 #include <fnmatch.h>
 #include <linux/bpf_insn.h>
 
+#include "alloc-util.h"
 #include "bpf-devices.h"
 #include "bpf-program.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "hashmap.h"
+#include "hexdecoct.h"
+#include "manager.h"
+#include "memory-util.h"
 #include "nulstr-util.h"
 #include "parse-util.h"
+#include "path-util.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
 
 #define PASS_JUMP_OFF 4096
 
+struct BPFDeviceProgram {
+        unsigned n_ref;
+
+        Manager *manager;
+        char *key;
+
+        int fd;
+};
+
+static BPFDeviceProgram* bpf_device_program_free(BPFDeviceProgram *p) {
+        if (!p)
+                return NULL;
+
+        if (p->manager)
+                hashmap_remove_value(p->manager->bpf_device_programs, p->key, p);
+
+        safe_close(p->fd);
+        free(p->key);
+
+        return mfree(p);
+}
+
+DEFINE_TRIVIAL_REF_UNREF_FUNC(BPFDeviceProgram, bpf_device_program, bpf_device_program_free);
+
+static int bpf_devices_load_shared(Manager *m, BPFProgram *prog, BPFDeviceProgram **ret) {
+        _cleanup_(bpf_device_program_unrefp) BPFDeviceProgram *p = NULL;
+        _cleanup_free_ char *key = NULL;
+        _cleanup_close_ int fd = -1;
+        BPFDeviceProgram *existing;
+        int r;
+
+        assert(m);
+        assert(prog);
+        assert(prog->kernel_fd < 0);
+        assert(ret);
+
+        /* Units with the same device policy end up with the very same instructions. There's no point in
+         * loading a separate copy of the program into the kernel for each of them, hence look programs up by
+         * their instructions and share them. Each unit still attaches its own reference to its cgroup. */
+
+        key = hexmem(prog->instructions, prog->n_instructions * sizeof(struct bpf_insn));
+        if (!key)
+                return -ENOMEM;
+
+        existing = hashmap_get(m->bpf_device_programs, key);
+        if (existing) {
+                fd = fcntl(existing->fd, F_DUPFD_CLOEXEC, 3);
+                if (fd < 0)
+                        return -errno;
+
+                prog->kernel_fd = TAKE_FD(fd);
+                *ret = bpf_device_program_ref(existing);
+                return 0;
+        }
+
+        r = bpf_program_load_kernel(prog, NULL, 0);
+        if (r < 0)
+                return r;
+
+        fd = fcntl(prog->kernel_fd, F_DUPFD_CLOEXEC, 3);
+        if (fd < 0)
+                return -errno;
+
+        r = hashmap_ensure_allocated(&m->bpf_device_programs, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        p = new(BPFDeviceProgram, 1);
+        if (!p)
+                return -ENOMEM;
+
+        *p = (BPFDeviceProgram) {
+                .n_ref = 1,
+                .key = TAKE_PTR(key),
+                .fd = TAKE_FD(fd),
+        };
+
+        r = hashmap_put(m->bpf_device_programs, p->key, p);
+        if (r < 0)
+                return r;
+
+        p->manager = m;
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+static bool bpf_program_same_instructions(const BPFProgram *a, const BPFProgram *b) {
+        assert(a);
+        assert(b);
+
+        return a->n_instructions == b->n_instructions &&
+                memcmp_safe(a->instructions, b->instructions, a->n_instructions * sizeof(struct bpf_insn)) == 0;
+}
+
 static int bpf_access_type(const char *acc) {
         int r = 0;
 
@@ -207,12 +308,15 @@ int bpf_devices_cgroup_init(
 }
 
 int bpf_devices_apply_policy(
+                Manager *m,
                 BPFProgram *prog,
                 CGroupDevicePolicy policy,
                 bool allow_list,
                 const char *cgroup_path,
-                BPFProgram **prog_installed) {
+                BPFProgram **prog_installed,
+                BPFDeviceProgram **shared_installed) {
 
+        _cleanup_(bpf_device_program_unrefp) BPFDeviceProgram *shared = NULL;
         _cleanup_free_ char *controller_path = NULL;
         int r;
 
@@ -257,6 +361,21 @@ int bpf_devices_apply_policy(
         if (r < 0)
                 return log_error_errno(r, "Failed to determine cgroup path: %m");
 
+        /* If the very same program is attached to the cgroup already, e.g. because the unit was
+         * re-realized after a reload without a change in its device policy, leave it in place. */
+        if (prog_installed && *prog_installed && (*prog_installed)->attached_path &&
+            path_equal((*prog_installed)->attached_path, controller_path) &&
+            bpf_program_same_instructions(prog, *prog_installed)) {
+                log_debug("Device control BPF program for cgroup %s is unchanged, not reattaching.", cgroup_path);
+                return 0;
+        }
+
+        if (m && shared_installed) {
+                r = bpf_devices_load_shared(m, prog, &shared);
+                if (r < 0)
+                        return log_error_errno(r, "Loading device control BPF program failed: %m");
+        }
+
         r = bpf_program_cgroup_attach(prog, BPF_CGROUP_DEVICE, controller_path, BPF_F_ALLOW_MULTI);
         if (r < 0)
                 return log_error_errno(r, "Attaching device control BPF program to cgroup %s failed: %m",
@@ -268,6 +387,10 @@ int bpf_devices_apply_policy(
                 bpf_program_unref(*prog_installed);
                 *prog_installed = bpf_program_ref(prog);
         }
+        if (shared_installed) {
+                bpf_device_program_unref(*shared_installed);
+                *shared_installed = TAKE_PTR(shared);
+        }
         return 0;
 }
 
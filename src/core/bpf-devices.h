@@ -3,17 +3,23 @@
 
 #include <inttypes.h>
 
-#include "cgroup.h"
+#include "unit.h"
 
 typedef struct BPFProgram BPFProgram;
 
+BPFDeviceProgram* bpf_device_program_ref(BPFDeviceProgram *p);
+BPFDeviceProgram* bpf_device_program_unref(BPFDeviceProgram *p);
+DEFINE_TRIVIAL_CLEANUP_FUNC(BPFDeviceProgram*, bpf_device_program_unref);
+
 int bpf_devices_cgroup_init(BPFProgram **ret, CGroupDevicePolicy policy, bool allow_list);
 int bpf_devices_apply_policy(
+                Manager *m,
                 BPFProgram *prog,
                 CGroupDevicePolicy policy,
                 bool allow_list,
                 const char *cgroup_path,
-                BPFProgram **prog_installed);
+                BPFProgram **prog_installed,
+                BPFDeviceProgram **shared_installed);
 
 int bpf_devices_supported(void);
 int bpf_devices_allow_list_device(BPFProgram *prog, const char *path, const char *node, const char *acc);
@@ -18,23 +18,32 @@
 #include "bpf-firewall.h"
 #include "bpf-program.h"
 #include "fd-util.h"
+#include "hashmap.h"
+#include "hexdecoct.h"
+#include "in-addr-util.h"
 #include "ip-address-access.h"
+#include "manager.h"
 #include "memory-util.h"
 #include "missing_syscall.h"
+#include "sort-util.h"
 #include "unit.h"
 #include "strv.h"
 #include "virt.h"
 
-enum {
-        MAP_KEY_PACKETS,
-        MAP_KEY_BYTES,
-};
-
 enum {
         ACCESS_ALLOWED = 1,
         ACCESS_DENIED  = 2,
 };
 
+struct BPFAccessMap {
+        unsigned n_ref;
+
+        Manager *manager;
+        char *key;
+
+        int fd;
+};
+
 /* Compile instructions for one list of addresses, one direction and one specific verdict on matches. */
 
 static int add_lookup_instructions(
@@ -199,15 +208,13 @@ static int bpf_firewall_compile_bpf(
         assert(u);
         assert(ret);
 
-        accounting_map_fd = is_ingress ?
-                u->ip_accounting_ingress_map_fd :
-                u->ip_accounting_egress_map_fd;
+        accounting_map_fd = u->ip_accounting_map_fd;
 
         access_enabled =
-                u->ipv4_allow_map_fd >= 0 ||
-                u->ipv6_allow_map_fd >= 0 ||
-                u->ipv4_deny_map_fd >= 0 ||
-                u->ipv6_deny_map_fd >= 0 ||
+                u->ipv4_allow_map ||
+                u->ipv6_allow_map ||
+                u->ipv4_deny_map ||
+                u->ipv6_deny_map ||
                 ip_allow_any ||
                 ip_deny_any;
 
@@ -233,26 +240,26 @@ static int bpf_firewall_compile_bpf(
                  * - Otherwise, access will be granted
                  */
 
-                if (u->ipv4_deny_map_fd >= 0) {
-                        r = add_lookup_instructions(p, u->ipv4_deny_map_fd, ETH_P_IP, is_ingress, ACCESS_DENIED);
+                if (u->ipv4_deny_map) {
+                        r = add_lookup_instructions(p, u->ipv4_deny_map->fd, ETH_P_IP, is_ingress, ACCESS_DENIED);
                         if (r < 0)
                                 return r;
                 }
 
-                if (u->ipv6_deny_map_fd >= 0) {
-                        r = add_lookup_instructions(p, u->ipv6_deny_map_fd, ETH_P_IPV6, is_ingress, ACCESS_DENIED);
+                if (u->ipv6_deny_map) {
+                        r = add_lookup_instructions(p, u->ipv6_deny_map->fd, ETH_P_IPV6, is_ingress, ACCESS_DENIED);
                         if (r < 0)
                                 return r;
                 }
 
-                if (u->ipv4_allow_map_fd >= 0) {
-                        r = add_lookup_instructions(p, u->ipv4_allow_map_fd, ETH_P_IP, is_ingress, ACCESS_ALLOWED);
+                if (u->ipv4_allow_map) {
+                        r = add_lookup_instructions(p, u->ipv4_allow_map->fd, ETH_P_IP, is_ingress, ACCESS_ALLOWED);
                         if (r < 0)
                                 return r;
                 }
 
-                if (u->ipv6_allow_map_fd >= 0) {
-                        r = add_lookup_instructions(p, u->ipv6_allow_map_fd, ETH_P_IPV6, is_ingress, ACCESS_ALLOWED);
+                if (u->ipv6_allow_map) {
+                        r = add_lookup_instructions(p, u->ipv6_allow_map->fd, ETH_P_IPV6, is_ingress, ACCESS_ALLOWED);
                         if (r < 0)
                                 return r;
                 }
@@ -282,27 +289,24 @@ static int bpf_firewall_compile_bpf(
                          */
                         BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 0),
 
-                        /* Count packets */
-                        BPF_MOV64_IMM(BPF_REG_0, MAP_KEY_PACKETS), /* r0 = 0 */
+                        /* Look up the counters, they are all stored in the map's only element */
+                        BPF_MOV64_IMM(BPF_REG_0, 0), /* r0 = 0 */
                         BPF_STX_MEM(BPF_W, BPF_REG_10, BPF_REG_0, -4), /* *(u32 *)(fp - 4) = r0 */
                         BPF_MOV64_REG(BPF_REG_2, BPF_REG_10),
                         BPF_ALU64_IMM(BPF_ADD, BPF_REG_2, -4), /* r2 = fp - 4 */
                         BPF_LD_MAP_FD(BPF_REG_1, accounting_map_fd), /* load map fd to r1 */
                         BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem),
-                        BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 2),
+                        BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 4),
+
+                        /* Count packets */
                         BPF_MOV64_IMM(BPF_REG_1, 1), /* r1 = 1 */
-                        BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_DW, BPF_REG_0, BPF_REG_1, 0, 0), /* xadd r0 += r1 */
+                        BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_DW, BPF_REG_0, BPF_REG_1, /* xadd r0[packets] += r1 */
+                                     sizeof(uint64_t) * (is_ingress ? CGROUP_IP_INGRESS_PACKETS : CGROUP_IP_EGRESS_PACKETS), 0),
 
                         /* Count bytes */
-                        BPF_MOV64_IMM(BPF_REG_0, MAP_KEY_BYTES), /* r0 = 1 */
-                        BPF_STX_MEM(BPF_W, BPF_REG_10, BPF_REG_0, -4), /* *(u32 *)(fp - 4) = r0 */
-                        BPF_MOV64_REG(BPF_REG_2, BPF_REG_10),
-                        BPF_ALU64_IMM(BPF_ADD, BPF_REG_2, -4), /* r2 = fp - 4 */
-                        BPF_LD_MAP_FD(BPF_REG_1, accounting_map_fd),
-                        BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem),
-                        BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 2),
                         BPF_LDX_MEM(BPF_W, BPF_REG_1, BPF_REG_6, offsetof(struct __sk_buff, len)), /* r1 = skb->len */
-                        BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_DW, BPF_REG_0, BPF_REG_1, 0, 0), /* xadd r0 += r1 */
+                        BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_DW, BPF_REG_0, BPF_REG_1, /* xadd r0[bytes] += r1 */
+                                     sizeof(uint64_t) * (is_ingress ? CGROUP_IP_INGRESS_BYTES : CGROUP_IP_EGRESS_BYTES), 0),
 
                         /* Allow the packet to pass */
                         BPF_MOV64_IMM(BPF_REG_0, 1),
@@ -335,91 +339,173 @@ static int bpf_firewall_compile_bpf(
         return 0;
 }
 
-static int bpf_firewall_count_access_items(IPAddressAccessItem *list, size_t *n_ipv4, size_t *n_ipv6) {
-        IPAddressAccessItem *a;
-
-        assert(n_ipv4);
-        assert(n_ipv6);
+static BPFAccessMap* bpf_access_map_free(BPFAccessMap *m) {
+        if (!m)
+                return NULL;
 
-        LIST_FOREACH(items, a, list) {
-                switch (a->family) {
+        if (m->manager)
+                hashmap_remove_value(m->manager->bpf_access_maps, m->key, m);
 
-                case AF_INET:
-                        (*n_ipv4)++;
-                        break;
+        safe_close(m->fd);
+        free(m->key);
 
-                case AF_INET6:
-                        (*n_ipv6)++;
-                        break;
+        return mfree(m);
+}
 
-                default:
-                        return -EAFNOSUPPORT;
-                }
-        }
+DEFINE_TRIVIAL_REF_UNREF_FUNC(BPFAccessMap, bpf_access_map, bpf_access_map_free);
 
-        return 0;
+static int access_map_entry_compare(const void *a, const void *b, void *userdata) {
+        return memcmp(a, b, *(size_t*) userdata);
 }
 
-static int bpf_firewall_add_access_items(
-                IPAddressAccessItem *list,
-                int ipv4_map_fd,
-                int ipv6_map_fd,
-                int verdict) {
-
-        struct bpf_lpm_trie_key *key_ipv4, *key_ipv6;
+static int bpf_firewall_acquire_access_map(Unit *u, int verdict, int family, BPFAccessMap **ret) {
+        _cleanup_(bpf_access_map_unrefp) BPFAccessMap *map = NULL;
+        _cleanup_free_ char *hex = NULL, *key = NULL;
+        BPFAccessMap *existing;
+        _cleanup_free_ uint8_t *entries = NULL;
+        _cleanup_close_ int fd = -1;
+        size_t addr_size, entry_size, n = 0, k = 0;
         uint64_t value = verdict;
         IPAddressAccessItem *a;
+        Unit *p;
         int r;
 
-        key_ipv4 = alloca0(offsetof(struct bpf_lpm_trie_key, data) + sizeof(uint32_t));
-        key_ipv6 = alloca0(offsetof(struct bpf_lpm_trie_key, data) + sizeof(uint32_t) * 4);
+        assert(u);
+        assert(ret);
 
-        LIST_FOREACH(items, a, list) {
-                switch (a->family) {
+        /* The map carries the entries of the unit and all its slices. Units with the same access lists in
+         * effect hence end up with identical maps, and since the contents are never changed after creation
+         * we can share one map between all of them. Maps are looked up by their sorted list of entries,
+         * with duplicates removed. */
 
-                case AF_INET:
-                        key_ipv4->prefixlen = a->prefixlen;
-                        memcpy(key_ipv4->data, &a->address, sizeof(uint32_t));
+        addr_size = FAMILY_ADDRESS_SIZE(family);
+        entry_size = offsetof(struct bpf_lpm_trie_key, data) + addr_size;
 
-                        r = bpf_map_update_element(ipv4_map_fd, key_ipv4, &value);
-                        if (r < 0)
-                                return r;
+        for (p = u; p; p = UNIT_DEREF(p->slice)) {
+                CGroupContext *cc;
 
-                        break;
+                cc = unit_get_cgroup_context(p);
+                if (!cc)
+                        continue;
 
-                case AF_INET6:
-                        key_ipv6->prefixlen = a->prefixlen;
-                        memcpy(key_ipv6->data, &a->address, 4 * sizeof(uint32_t));
+                LIST_FOREACH(items, a, verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny)
+                        if (a->family == family)
+                                n++;
+        }
 
-                        r = bpf_map_update_element(ipv6_map_fd, key_ipv6, &value);
-                        if (r < 0)
-                                return r;
+        if (n == 0) {
+                *ret = NULL;
+                return 0;
+        }
+
+        entries = calloc(n, entry_size);
+        if (!entries)
+                return -ENOMEM;
+
+        for (p = u; p; p = UNIT_DEREF(p->slice)) {
+                CGroupContext *cc;
+
+                cc = unit_get_cgroup_context(p);
+                if (!cc)
+                        continue;
+
+                LIST_FOREACH(items, a, verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny) {
+                        struct bpf_lpm_trie_key *e;
+                        union in_addr_union masked;
+
+                        if (a->family != family)
+                                continue;
 
-                        break;
+                        /* Bits beyond the prefix are ignored by the trie, drop them so that they don't
+                         * make otherwise identical maps look different */
+                        masked = a->address;
+                        (void) in_addr_mask(family, &masked, a->prefixlen);
 
-                default:
-                        return -EAFNOSUPPORT;
+                        e = (struct bpf_lpm_trie_key*) (entries + k++ * entry_size);
+                        e->prefixlen = a->prefixlen;
+                        memcpy(e->data, &masked, addr_size);
                 }
         }
 
+        qsort_r_safe(entries, n, entry_size, access_map_entry_compare, &entry_size);
+
+        k = 1;
+        for (size_t i = 1; i < n; i++) {
+                if (memcmp(entries + i * entry_size, entries + (k - 1) * entry_size, entry_size) == 0)
+                        continue;
+
+                if (i != k)
+                        memcpy(entries + k * entry_size, entries + i * entry_size, entry_size);
+                k++;
+        }
+        n = k;
+
+        hex = hexmem(entries, n * entry_size);
+        if (!hex)
+                return -ENOMEM;
+
+        if (asprintf(&key, "%i:%i:%s", verdict, family, hex) < 0)
+                return -ENOMEM;
+
+        existing = hashmap_get(u->manager->bpf_access_maps, key);
+        if (existing) {
+                log_unit_debug(u, "Reusing eBPF access map with %zu entries.", n);
+                *ret = bpf_access_map_ref(existing);
+                return 0;
+        }
+
+        fd = bpf_map_new(
+                        BPF_MAP_TYPE_LPM_TRIE,
+                        entry_size,
+                        sizeof(uint64_t),
+                        n,
+                        BPF_F_NO_PREALLOC);
+        if (fd < 0)
+                return fd;
+
+        for (size_t i = 0; i < n; i++) {
+                r = bpf_map_update_element(fd, entries + i * entry_size, &value);
+                if (r < 0)
+                        return r;
+        }
+
+        r = hashmap_ensure_allocated(&u->manager->bpf_access_maps, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        map = new(BPFAccessMap, 1);
+        if (!map)
+                return -ENOMEM;
+
+        *map = (BPFAccessMap) {
+                .n_ref = 1,
+                .key = TAKE_PTR(key),
+                .fd = TAKE_FD(fd),
+        };
+
+        r = hashmap_put(u->manager->bpf_access_maps, map->key, map);
+        if (r < 0)
+                return r;
+
+        map->manager = u->manager;
+
+        *ret = TAKE_PTR(map);
         return 0;
 }
 
 static int bpf_firewall_prepare_access_maps(
                 Unit *u,
                 int verdict,
-                int *ret_ipv4_map_fd,
-                int *ret_ipv6_map_fd,
+                BPFAccessMap **ret_ipv4_map,
+                BPFAccessMap **ret_ipv6_map,
                 bool *ret_has_any) {
 
-        _cleanup_close_ int ipv4_map_fd = -1, ipv6_map_fd = -1;
-        size_t n_ipv4 = 0, n_ipv6 = 0;
-        IPAddressAccessItem *list;
+        _cleanup_(bpf_access_map_unrefp) BPFAccessMap *ipv4_map = NULL, *ipv6_map = NULL;
         Unit *p;
         int r;
 
-        assert(ret_ipv4_map_fd);
-        assert(ret_ipv6_map_fd);
+        assert(ret_ipv4_map);
+        assert(ret_ipv6_map);
         assert(ret_has_any);
 
         for (p = u; p; p = UNIT_DEREF(p->slice)) {
@@ -429,87 +515,51 @@ static int bpf_firewall_prepare_access_maps(
                 if (!cc)
                         continue;
 
-                list = verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny;
-
-                bpf_firewall_count_access_items(list, &n_ipv4, &n_ipv6);
-
                 /* Skip making the LPM trie map in cases where we are using "any" in order to hack around
                  * needing CAP_SYS_ADMIN for allocating LPM trie map. */
-                if (ip_address_access_item_is_any(list)) {
+                if (ip_address_access_item_is_any(verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny)) {
+                        *ret_ipv4_map = *ret_ipv6_map = NULL;
                         *ret_has_any = true;
                         return 0;
                 }
         }
 
-        if (n_ipv4 > 0) {
-                ipv4_map_fd = bpf_map_new(
-                                BPF_MAP_TYPE_LPM_TRIE,
-                                offsetof(struct bpf_lpm_trie_key, data) + sizeof(uint32_t),
-                                sizeof(uint64_t),
-                                n_ipv4,
-                                BPF_F_NO_PREALLOC);
-                if (ipv4_map_fd < 0)
-                        return ipv4_map_fd;
-        }
-
-        if (n_ipv6 > 0) {
-                ipv6_map_fd = bpf_map_new(
-                                BPF_MAP_TYPE_LPM_TRIE,
-                                offsetof(struct bpf_lpm_trie_key, data) + sizeof(uint32_t)*4,
-                                sizeof(uint64_t),
-                                n_ipv6,
-                                BPF_F_NO_PREALLOC);
-                if (ipv6_map_fd < 0)
-                        return ipv6_map_fd;
-        }
-
-        for (p = u; p; p = UNIT_DEREF(p->slice)) {
-                CGroupContext *cc;
-
-                cc = unit_get_cgroup_context(p);
-                if (!cc)
-                        continue;
+        r = bpf_firewall_acquire_access_map(u, verdict, AF_INET, &ipv4_map);
+        if (r < 0)
+                return r;
 
-                r = bpf_firewall_add_access_items(verdict == ACCESS_ALLOWED ? cc->ip_address_allow : cc->ip_address_deny,
-                                                  ipv4_map_fd, ipv6_map_fd, verdict);
-                if (r < 0)
-                        return r;
-        }
+        r = bpf_firewall_acquire_access_map(u, verdict, AF_INET6, &ipv6_map);
+        if (r < 0)
+                return r;
 
-        *ret_ipv4_map_fd = TAKE_FD(ipv4_map_fd);
-        *ret_ipv6_map_fd = TAKE_FD(ipv6_map_fd);
+        *ret_ipv4_map = TAKE_PTR(ipv4_map);
+        *ret_ipv6_map = TAKE_PTR(ipv6_map);
         *ret_has_any = false;
         return 0;
 }
 
-static int bpf_firewall_prepare_accounting_maps(Unit *u, bool enabled, int *fd_ingress, int *fd_egress) {
+static int bpf_firewall_prepare_accounting_map(Unit *u, bool enabled, int *fd) {
         int r;
 
         assert(u);
-        assert(fd_ingress);
-        assert(fd_egress);
-
-        if (enabled) {
-                if (*fd_ingress < 0) {
-                        r = bpf_map_new(BPF_MAP_TYPE_ARRAY, sizeof(int), sizeof(uint64_t), 2, 0);
-                        if (r < 0)
-                                return r;
-
-                        *fd_ingress = r;
-                }
+        assert(fd);
 
-                if (*fd_egress < 0) {
+        /* Both the ingress and the egress program count into the same map, which has a single element
+         * carrying all counters. That way we need one map per unit instead of two, and all counters can be
+         * read with a single lookup. */
 
-                        r = bpf_map_new(BPF_MAP_TYPE_ARRAY, sizeof(int), sizeof(uint64_t), 2, 0);
+        if (enabled) {
+                if (*fd < 0) {
+                        r = bpf_map_new(BPF_MAP_TYPE_ARRAY, sizeof(int),
+                                        sizeof(uint64_t) * _CGROUP_IP_ACCOUNTING_METRIC_MAX, 1, 0);
                         if (r < 0)
                                 return r;
 
-                        *fd_egress = r;
+                        *fd = r;
                 }
 
         } else {
-                *fd_ingress = safe_close(*fd_ingress);
-                *fd_egress = safe_close(*fd_egress);
+                *fd = safe_close(*fd);
 
                 zero(u->ip_accounting_extra);
         }
@@ -517,7 +567,18 @@ static int bpf_firewall_prepare_accounting_maps(Unit *u, bool enabled, int *fd_i
         return 0;
 }
 
+void bpf_firewall_flush_access_maps(Unit *u) {
+        assert(u);
+
+        u->ipv4_allow_map = bpf_access_map_unref(u->ipv4_allow_map);
+        u->ipv6_allow_map = bpf_access_map_unref(u->ipv6_allow_map);
+        u->ipv4_deny_map = bpf_access_map_unref(u->ipv4_deny_map);
+        u->ipv6_deny_map = bpf_access_map_unref(u->ipv6_deny_map);
+}
+
 int bpf_firewall_compile(Unit *u) {
+        _cleanup_(bpf_access_map_unrefp) BPFAccessMap *ipv4_allow_map = NULL, *ipv6_allow_map = NULL,
+                *ipv4_deny_map = NULL, *ipv6_deny_map = NULL;
         CGroupContext *cc;
         int r, supported;
         bool ip_allow_any = false, ip_deny_any = false;
@@ -545,17 +606,13 @@ int bpf_firewall_compile(Unit *u) {
 
         /* Note that when we compile a new firewall we first flush out the access maps and the BPF programs themselves,
          * but we reuse the accounting maps. That way the firewall in effect always maps to the actual
-         * configuration, but we don't flush out the accounting unnecessarily */
+         * configuration, but we don't flush out the accounting unnecessarily. The new access maps are acquired
+         * before the old ones are released, so that a recompilation with unchanged access lists (e.g. when
+         * the unit is restarted) picks up the existing maps instead of building them anew. */
 
         u->ip_bpf_ingress = bpf_program_unref(u->ip_bpf_ingress);
         u->ip_bpf_egress = bpf_program_unref(u->ip_bpf_egress);
 
-        u->ipv4_allow_map_fd = safe_close(u->ipv4_allow_map_fd);
-        u->ipv4_deny_map_fd = safe_close(u->ipv4_deny_map_fd);
-
-        u->ipv6_allow_map_fd = safe_close(u->ipv6_allow_map_fd);
-        u->ipv6_deny_map_fd = safe_close(u->ipv6_deny_map_fd);
-
         if (u->type != UNIT_SLICE) {
                 /* In inner nodes we only do accounting, we do not actually bother with access control. However, leaf
                  * nodes will incorporate all IP access rules set on all their parent nodes. This has the benefit that
@@ -563,18 +620,29 @@ int bpf_firewall_compile(Unit *u) {
                  * means that all configure IP access rules *will* take effect on processes, even though we never
                  * compile them for inner nodes. */
 
-                r = bpf_firewall_prepare_access_maps(u, ACCESS_ALLOWED, &u->ipv4_allow_map_fd, &u->ipv6_allow_map_fd, &ip_allow_any);
-                if (r < 0)
+                r = bpf_firewall_prepare_access_maps(u, ACCESS_ALLOWED, &ipv4_allow_map, &ipv6_allow_map, &ip_allow_any);
+                if (r < 0) {
+                        bpf_firewall_flush_access_maps(u);
                         return log_unit_error_errno(u, r, "Preparation of eBPF allow maps failed: %m");
+                }
 
-                r = bpf_firewall_prepare_access_maps(u, ACCESS_DENIED, &u->ipv4_deny_map_fd, &u->ipv6_deny_map_fd, &ip_deny_any);
-                if (r < 0)
+                r = bpf_firewall_prepare_access_maps(u, ACCESS_DENIED, &ipv4_deny_map, &ipv6_deny_map, &ip_deny_any);
+                if (r < 0) {
+                        bpf_firewall_flush_access_maps(u);
                         return log_unit_error_errno(u, r, "Preparation of eBPF deny maps failed: %m");
+                }
         }
 
-        r = bpf_firewall_prepare_accounting_maps(u, cc->ip_accounting, &u->ip_accounting_ingress_map_fd, &u->ip_accounting_egress_map_fd);
+        bpf_firewall_flush_access_maps(u);
+
+        u->ipv4_allow_map = TAKE_PTR(ipv4_allow_map);
+        u->ipv6_allow_map = TAKE_PTR(ipv6_allow_map);
+        u->ipv4_deny_map = TAKE_PTR(ipv4_deny_map);
+        u->ipv6_deny_map = TAKE_PTR(ipv6_deny_map);
+
+        r = bpf_firewall_prepare_accounting_map(u, cc->ip_accounting, &u->ip_accounting_map_fd);
         if (r < 0)
-                return log_unit_error_errno(u, r, "Preparation of eBPF accounting maps failed: %m");
+                return log_unit_error_errno(u, r, "Preparation of eBPF accounting map failed: %m");
 
         r = bpf_firewall_compile_bpf(u, true, &u->ip_bpf_ingress, ip_allow_any, ip_deny_any);
         if (r < 0)
@@ -741,47 +809,23 @@ int bpf_firewall_install(Unit *u) {
         return 0;
 }
 
-int bpf_firewall_read_accounting(int map_fd, uint64_t *ret_bytes, uint64_t *ret_packets) {
-        uint64_t key, packets;
-        int r;
+int bpf_firewall_read_accounting(int map_fd, uint64_t ret[static _CGROUP_IP_ACCOUNTING_METRIC_MAX]) {
+        uint32_t key = 0;
 
         if (map_fd < 0)
                 return -EBADF;
 
-        if (ret_packets) {
-                key = MAP_KEY_PACKETS;
-                r = bpf_map_lookup_element(map_fd, &key, &packets);
-                if (r < 0)
-                        return r;
-        }
-
-        if (ret_bytes) {
-                key = MAP_KEY_BYTES;
-                r = bpf_map_lookup_element(map_fd, &key, ret_bytes);
-                if (r < 0)
-                        return r;
-        }
-
-        if (ret_packets)
-                *ret_packets = packets;
-
-        return 0;
+        return bpf_map_lookup_element(map_fd, &key, ret);
 }
 
 int bpf_firewall_reset_accounting(int map_fd) {
-        uint64_t key, value = 0;
-        int r;
+        uint64_t value[_CGROUP_IP_ACCOUNTING_METRIC_MAX] = {};
+        uint32_t key = 0;
 
         if (map_fd < 0)
                 return -EBADF;
 
-        key = MAP_KEY_PACKETS;
-        r = bpf_map_update_element(map_fd, &key, &value);
-        if (r < 0)
-                return r;
-
-        key = MAP_KEY_BYTES;
-        return bpf_map_update_element(map_fd, &key, &value);
+        return bpf_map_update_element(map_fd, &key, value);
 }
 
 static int bpf_firewall_unsupported_reason = 0;
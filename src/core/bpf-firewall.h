@@ -13,11 +13,17 @@ enum {
 
 int bpf_firewall_supported(void);
 
+BPFAccessMap* bpf_access_map_ref(BPFAccessMap *m);
+BPFAccessMap* bpf_access_map_unref(BPFAccessMap *m);
+DEFINE_TRIVIAL_CLEANUP_FUNC(BPFAccessMap*, bpf_access_map_unref);
+
+void bpf_firewall_flush_access_maps(Unit *u);
+
 int bpf_firewall_compile(Unit *u);
 int bpf_firewall_install(Unit *u);
 int bpf_firewall_load_custom(Unit *u);
 
-int bpf_firewall_read_accounting(int map_fd, uint64_t *ret_bytes, uint64_t *ret_packets);
+int bpf_firewall_read_accounting(int map_fd, uint64_t ret[static _CGROUP_IP_ACCOUNTING_METRIC_MAX]);
 int bpf_firewall_reset_accounting(int map_fd);
 
 void emit_bpf_firewall_warning(Unit *u);
@@ -18,6 +18,7 @@
 #include "fs-util.h"
 #include "io-util.h"
 #include "limits-util.h"
+#include "missing_syscall.h"
 #include "nulstr-util.h"
 #include "parse-util.h"
 #include "path-util.h"
@@ -73,9 +74,12 @@ bool unit_has_host_root_cgroup(Unit *u) {
         return unit_has_name(u, SPECIAL_ROOT_SLICE);
 }
 
-static int set_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
+static int set_device_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
         int r;
 
+        /* Per-device attributes take one line per device, so the last value we wrote doesn't tell us what
+         * the kernel has set. Hence these are always written. */
+
         r = cg_set_attribute(controller, u->cgroup_path, attribute, value);
         if (r < 0)
                 log_unit_full(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%.*s': %m",
@@ -84,6 +88,47 @@ static int set_attribute_and_warn(Unit *u, const char *controller, const char *a
         return r;
 }
 
+static int set_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
+        _cleanup_free_ char *a = NULL, *v = NULL;
+        int r;
+
+        /* Like set_device_attribute_and_warn(), but for attributes whose value as a whole is replaced by
+         * each write. We remember what we wrote last, and skip writing the same value again: realizing a
+         * cgroup applies all attributes of its controllers, and most of them are unchanged most of the
+         * time. The cache is flushed whenever the cgroup is created or its controllers change, since the
+         * kernel resets the attributes then, see unit_update_cgroup(). */
+
+        if (streq_ptr(hashmap_get(u->cgroup_attributes, attribute), value))
+                return 0;
+
+        /* Forget the old value first, so that we write again next time if anything below fails. */
+        free(hashmap_remove2(u->cgroup_attributes, attribute, (void**) &a));
+
+        r = set_device_attribute_and_warn(u, controller, attribute, value);
+        if (r < 0)
+                return r;
+
+        if (!a) {
+                a = strdup(attribute);
+                if (!a)
+                        return 0;
+        }
+
+        v = strdup(value);
+        if (!v)
+                return 0;
+
+        if (hashmap_ensure_allocated(&u->cgroup_attributes, &string_hash_ops_free_free) < 0)
+                return 0;
+
+        if (hashmap_put(u->cgroup_attributes, a, v) < 0)
+                return 0;
+
+        TAKE_PTR(a);
+        TAKE_PTR(v);
+        return 0;
+}
+
 static void cgroup_compat_warn(void) {
         static bool cgroup_compat_warned = false;
 
@@ -853,7 +898,7 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
                 return;
 
         xsprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), io_weight);
-        (void) set_attribute_and_warn(u, "io", "io.weight", buf);
+        (void) set_device_attribute_and_warn(u, "io", "io.weight", buf);
 }
 
 static void cgroup_apply_blkio_device_weight(Unit *u, const char *dev_path, uint64_t blkio_weight) {
@@ -866,7 +911,7 @@ static void cgroup_apply_blkio_device_weight(Unit *u, const char *dev_path, uint
                 return;
 
         xsprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), blkio_weight);
-        (void) set_attribute_and_warn(u, "blkio", "blkio.weight_device", buf);
+        (void) set_device_attribute_and_warn(u, "blkio", "blkio.weight_device", buf);
 }
 
 static void cgroup_apply_io_device_latency(Unit *u, const char *dev_path, usec_t target) {
@@ -883,7 +928,7 @@ static void cgroup_apply_io_device_latency(Unit *u, const char *dev_path, usec_t
         else
                 xsprintf(buf, "%u:%u target=max\n", major(dev), minor(dev));
 
-        (void) set_attribute_and_warn(u, "io", "io.latency", buf);
+        (void) set_device_attribute_and_warn(u, "io", "io.latency", buf);
 }
 
 static void cgroup_apply_io_device_limit(Unit *u, const char *dev_path, uint64_t *limits) {
@@ -906,7 +951,7 @@ static void cgroup_apply_io_device_limit(Unit *u, const char *dev_path, uint64_t
         xsprintf(buf, "%u:%u rbps=%s wbps=%s riops=%s wiops=%s\n", major(dev), minor(dev),
                  limit_bufs[CGROUP_IO_RBPS_MAX], limit_bufs[CGROUP_IO_WBPS_MAX],
                  limit_bufs[CGROUP_IO_RIOPS_MAX], limit_bufs[CGROUP_IO_WIOPS_MAX]);
-        (void) set_attribute_and_warn(u, "io", "io.max", buf);
+        (void) set_device_attribute_and_warn(u, "io", "io.max", buf);
 }
 
 static void cgroup_apply_blkio_device_limit(Unit *u, const char *dev_path, uint64_t rbps, uint64_t wbps) {
@@ -919,10 +964,10 @@ static void cgroup_apply_blkio_device_limit(Unit *u, const char *dev_path, uint6
                 return;
 
         sprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), rbps);
-        (void) set_attribute_and_warn(u, "blkio", "blkio.throttle.read_bps_device", buf);
+        (void) set_device_attribute_and_warn(u, "blkio", "blkio.throttle.read_bps_device", buf);
 
         sprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), wbps);
-        (void) set_attribute_and_warn(u, "blkio", "blkio.throttle.write_bps_device", buf);
+        (void) set_device_attribute_and_warn(u, "blkio", "blkio.throttle.write_bps_device", buf);
 }
 
 static bool unit_has_unified_memory_config(Unit *u) {
@@ -1034,7 +1079,8 @@ static int cgroup_apply_devices(Unit *u) {
                 policy = CGROUP_DEVICE_POLICY_STRICT;
         }
 
-        r = bpf_devices_apply_policy(prog, policy, any, path, &u->bpf_device_control_installed);
+        r = bpf_devices_apply_policy(u->manager, prog, policy, any, path,
+                                     &u->bpf_device_control_installed, &u->bpf_device_control_shared);
         if (r < 0) {
                 static bool warned = false;
 
@@ -1676,6 +1722,9 @@ int unit_set_cgroup_path(Unit *u, const char *path) {
                 r = hashmap_put(u->manager->cgroup_unit, p, u);
                 if (r < 0)
                         return r;
+
+                /* Processes in this cgroup might have been attributed to a parent slice so far */
+                manager_flush_pid_cgroup_cache(u->manager);
         }
 
         unit_release_cgroup(u);
@@ -1870,6 +1919,10 @@ static int unit_update_cgroup(
                 migrate_mask = u->cgroup_realized_mask ^ target_mask;
         }
 
+        /* If the cgroup is new or a controller appeared or disappeared, the kernel reset its attributes. */
+        if (created || !u->cgroup_realized || u->cgroup_realized_mask != target_mask)
+                u->cgroup_attributes = hashmap_free(u->cgroup_attributes);
+
         /* Keep track that this is now realized */
         u->cgroup_realized = true;
         u->cgroup_realized_mask = target_mask;
@@ -1974,6 +2027,8 @@ int unit_attach_pids_to_cgroup(Unit *u, Set *pids, const char *suffix_path) {
                 pid_t pid = PTR_TO_PID(pidp);
                 CGroupController c;
 
+                manager_forget_pid_cgroup(u->manager, pid);
+
                 /* First, attach the PID to the main cgroup hierarchy */
                 q = cg_attach(SYSTEMD_CGROUP_CONTROLLER, p, pid);
                 if (q < 0) {
@@ -2287,6 +2342,7 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
 unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
         ManagerState state;
         unsigned n = 0;
+        usec_t begin;
         Unit *i;
         int r;
 
@@ -2303,10 +2359,14 @@ unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
                         continue;
                 }
 
+                begin = manager_trace_begin(m);
+
                 r = unit_realize_cgroup_now(i, state);
                 if (r < 0)
                         log_warning_errno(r, "Failed to realize cgroups for queued unit %s, ignoring: %m", i->id);
 
+                manager_trace_end(m, TRACE_CGROUP_REALIZE, i->id, begin);
+
                 n++;
         }
 
@@ -2368,6 +2428,9 @@ void unit_add_family_to_cgroup_realize_queue(Unit *u) {
 }
 
 int unit_realize_cgroup(Unit *u) {
+        usec_t begin;
+        int r;
+
         assert(u);
 
         if (!UNIT_HAS_CGROUP_CONTEXT(u))
@@ -2386,7 +2449,11 @@ int unit_realize_cgroup(Unit *u) {
                 unit_add_family_to_cgroup_realize_queue(UNIT_DEREF(u->slice));
 
         /* And realize this one now (and apply the values) */
-        return unit_realize_cgroup_now(u, manager_state(u->manager));
+        begin = manager_trace_begin(u->manager);
+        r = unit_realize_cgroup_now(u, manager_state(u->manager));
+        manager_trace_end(u->manager, TRACE_CGROUP_REALIZE, u->id, begin);
+
+        return r;
 }
 
 void unit_release_cgroup(Unit *u) {
@@ -2398,8 +2465,11 @@ void unit_release_cgroup(Unit *u) {
         if (u->cgroup_path) {
                 (void) hashmap_remove(u->manager->cgroup_unit, u->cgroup_path);
                 u->cgroup_path = mfree(u->cgroup_path);
+                manager_flush_pid_cgroup_cache(u->manager);
         }
 
+        u->cgroup_attributes = hashmap_free(u->cgroup_attributes);
+
         if (u->cgroup_control_inotify_wd >= 0) {
                 if (inotify_rm_watch(u->manager->cgroup_inotify_fd, u->cgroup_control_inotify_wd) < 0)
                         log_unit_debug_errno(u, errno, "Failed to remove cgroup control inotify watch %i for %s, ignoring: %m", u->cgroup_control_inotify_wd, u->id);
@@ -2451,6 +2521,7 @@ void unit_prune_cgroup(Unit *u) {
         u->cgroup_enabled_mask = 0;
 
         u->bpf_device_control_installed = bpf_program_unref(u->bpf_device_control_installed);
+        u->bpf_device_control_shared = bpf_device_program_unref(u->bpf_device_control_shared);
 }
 
 int unit_search_main_pid(Unit *u, pid_t *ret) {
@@ -2782,6 +2853,9 @@ static int unit_check_cgroup_events(Unit *u) {
 
         assert(u);
 
+        if (!u->cgroup_path)
+                return 0;
+
         r = cg_get_keyed_attribute_graceful(SYSTEMD_CGROUP_CONTROLLER, u->cgroup_path, "cgroup.events",
                                             STRV_MAKE("populated", "frozen"), values);
         if (r < 0)
@@ -2811,6 +2885,68 @@ static int unit_check_cgroup_events(Unit *u) {
         return 0;
 }
 
+static int on_cgroup_events_event(sd_event_source *s, void *userdata) {
+        Manager *m = userdata;
+        Unit *u;
+
+        assert(s);
+        assert(m);
+
+        /* Every process exiting in a cgroup may trigger a notification, and inotify doesn't merge them for us
+         * unless they are still queued. Hence, the inotify handler just marks the units, and we read
+         * cgroup.events only once for each of them here, after the whole inotify queue was processed. */
+
+        while ((u = m->cgroup_events_queue)) {
+                assert(u->in_cgroup_events_queue);
+                u->in_cgroup_events_queue = false;
+                LIST_REMOVE(cgroup_events_queue, m->cgroup_events_queue, u);
+
+                (void) unit_check_cgroup_events(u);
+        }
+
+        return 0;
+}
+
+static void unit_add_to_cgroup_events_queue(Unit *u) {
+        int r;
+
+        assert(u);
+
+        if (u->in_cgroup_events_queue)
+                return;
+        if (!u->cgroup_path)
+                return;
+
+        LIST_PREPEND(cgroup_events_queue, u->manager->cgroup_events_queue, u);
+        u->in_cgroup_events_queue = true;
+
+        /* Trigger the defer event */
+        if (!u->manager->cgroup_events_event_source) {
+                _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+
+                r = sd_event_add_defer(u->manager->event, &s, on_cgroup_events_event, u->manager);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to create cgroup events event source: %m");
+                        return;
+                }
+
+                /* Same priority as the inotify event source, so that this runs before the cgroup empty
+                 * queue is dispatched. */
+                r = sd_event_source_set_priority(s, SD_EVENT_PRIORITY_NORMAL-9);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to set priority of cgroup events event source: %m");
+                        return;
+                }
+
+                (void) sd_event_source_set_description(s, "cgroup-events");
+                u->manager->cgroup_events_event_source = TAKE_PTR(s);
+        }
+
+        r = sd_event_source_set_enabled(u->manager->cgroup_events_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                log_error_errno(r, "Failed to enable cgroup events event source: %m");
+}
+
 static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         Manager *m = userdata;
 
@@ -2847,7 +2983,7 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
 
                         u = hashmap_get(m->cgroup_control_inotify_wd_unit, INT_TO_PTR(e->wd));
                         if (u)
-                                unit_check_cgroup_events(u);
+                                unit_add_to_cgroup_events_queue(u);
 
                         u = hashmap_get(m->cgroup_memory_inotify_wd_unit, INT_TO_PTR(e->wd));
                         if (u)
@@ -3040,6 +3176,8 @@ void manager_shutdown_cgroup(Manager *m, bool delete) {
                 (void) cg_trim(SYSTEMD_CGROUP_CONTROLLER, m->cgroup_root, false);
 
         m->cgroup_empty_event_source = sd_event_source_unref(m->cgroup_empty_event_source);
+        m->cgroup_events_event_source = sd_event_source_unref(m->cgroup_events_event_source);
+        m->cgroup_oom_event_source = sd_event_source_unref(m->cgroup_oom_event_source);
 
         m->cgroup_control_inotify_wd_unit = hashmap_free(m->cgroup_control_inotify_wd_unit);
         m->cgroup_memory_inotify_wd_unit = hashmap_free(m->cgroup_memory_inotify_wd_unit);
@@ -3093,6 +3231,96 @@ Unit *manager_get_unit_by_pid_cgroup(Manager *m, pid_t pid) {
         return manager_get_unit_by_cgroup(m, cgroup);
 }
 
+typedef struct PidCgroupCacheEntry {
+        Unit *unit;
+        int pidfd;
+} PidCgroupCacheEntry;
+
+static PidCgroupCacheEntry* pid_cgroup_cache_entry_free(PidCgroupCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        safe_close(e->pidfd);
+        return mfree(e);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(pid_cgroup_cache_hash_ops, void, trivial_hash_func, trivial_compare_func,
+                                              PidCgroupCacheEntry, pid_cgroup_cache_entry_free);
+
+/* Upper bound for the number of processes we keep a pidfd for in the cache. */
+#define PID_CGROUP_CACHE_MAX 4096U
+
+Unit *manager_get_unit_by_pid_cgroup_cached(Manager *m, pid_t pid, bool populate) {
+        _cleanup_close_ int pidfd = -1;
+        PidCgroupCacheEntry *e;
+        Unit *u;
+
+        assert(m);
+
+        /* Like manager_get_unit_by_pid_cgroup(), but remembers the result, so that processes that send us
+         * lots of notification messages don't cause a /proc/$PID/cgroup read each time. Each entry pins a
+         * pidfd of the process it was created for: as long as that process is still around (zombies
+         * included) its PID cannot have been recycled. Processes only change units if we migrate them
+         * ourselves or if a unit's cgroup goes away or shows up, and in all those cases we flush the cache
+         * (see manager_flush_pid_cgroup_cache()). Processes moved around behind our back within a delegated
+         * subtree stay in the same unit, which is all we look at here. */
+
+        if (!pid_is_valid(pid))
+                return NULL;
+
+        e = hashmap_get(m->pid_cgroup_cache, PID_TO_PTR(pid));
+        if (e) {
+                if (pidfd_send_signal(e->pidfd, 0, NULL, 0) >= 0)
+                        return e->unit;
+
+                manager_forget_pid_cgroup(m, pid);
+        }
+
+        if (populate) {
+                pidfd = pidfd_open(pid, 0);
+                if (pidfd < 0 && errno != ESRCH && !ERRNO_IS_NOT_SUPPORTED(errno) && !ERRNO_IS_PRIVILEGE(errno))
+                        log_debug_errno(errno, "Failed to open pidfd for process " PID_FMT ", not caching its unit: %m", pid);
+        }
+
+        /* Look up the cgroup only after we have the pidfd, so that the entry can't end up describing a
+         * process that has been replaced in the meantime. */
+        u = manager_get_unit_by_pid_cgroup(m, pid);
+        if (!u || pidfd < 0)
+                return u;
+
+        if (hashmap_size(m->pid_cgroup_cache) >= PID_CGROUP_CACHE_MAX)
+                manager_flush_pid_cgroup_cache(m);
+
+        if (hashmap_ensure_allocated(&m->pid_cgroup_cache, &pid_cgroup_cache_hash_ops) < 0)
+                return u;
+
+        e = new(PidCgroupCacheEntry, 1);
+        if (!e)
+                return u;
+
+        *e = (PidCgroupCacheEntry) {
+                .unit = u,
+                .pidfd = TAKE_FD(pidfd),
+        };
+
+        if (hashmap_put(m->pid_cgroup_cache, PID_TO_PTR(pid), e) < 0)
+                pid_cgroup_cache_entry_free(e);
+
+        return u;
+}
+
+void manager_forget_pid_cgroup(Manager *m, pid_t pid) {
+        assert(m);
+
+        pid_cgroup_cache_entry_free(hashmap_remove(m->pid_cgroup_cache, PID_TO_PTR(pid)));
+}
+
+void manager_flush_pid_cgroup_cache(Manager *m) {
+        assert(m);
+
+        hashmap_clear(m->pid_cgroup_cache);
+}
+
 Unit *manager_get_unit_by_pid(Manager *m, pid_t pid) {
         Unit *u, **array;
 
@@ -3106,7 +3334,7 @@ Unit *manager_get_unit_by_pid(Manager *m, pid_t pid) {
                 return NULL;
 
         if (pid == getpid_cached())
-                return hashmap_get(m->units, SPECIAL_INIT_SCOPE);
+                return manager_get_unit(m, SPECIAL_INIT_SCOPE);
 
         u = manager_get_unit_by_pid_cgroup(m, pid);
         if (u)
@@ -3142,7 +3370,54 @@ int manager_notify_cgroup_empty(Manager *m, const char *cgroup) {
         return 1;
 }
 
-int unit_get_memory_current(Unit *u, uint64_t *ret) {
+static int unit_cgroup_read_attribute(Unit *u, int dfd, const char *controller, const char *attribute, char **ret) {
+        _cleanup_free_ char *p = NULL;
+        int r;
+
+        assert(u);
+        assert(attribute);
+        assert(ret);
+
+        /* Reads a cgroup attribute of the unit. If we have an fd of the unit's cgroup directory (only on the
+         * unified hierarchy, see unit_get_accounting()), it is opened relative to that, otherwise the path
+         * is built and resolved from scratch. */
+
+        if (dfd >= 0)
+                r = read_full_file_full(dfd, attribute, 0, ret, NULL);
+        else {
+                r = cg_get_path(controller, u->cgroup_path, attribute, &p);
+                if (r < 0)
+                        return r;
+
+                r = read_full_file(p, ret, NULL);
+        }
+        if (r == -ENOENT)
+                return -ENODATA;
+
+        return r;
+}
+
+static int unit_cgroup_read_attribute_as_uint64(Unit *u, int dfd, const char *controller, const char *attribute, uint64_t *ret) {
+        _cleanup_free_ char *v = NULL;
+        int r;
+
+        assert(ret);
+
+        r = unit_cgroup_read_attribute(u, dfd, controller, attribute, &v);
+        if (r < 0)
+                return r;
+
+        delete_trailing_chars(v, NEWLINE);
+
+        if (streq(v, "max")) {
+                *ret = CGROUP_LIMIT_MAX;
+                return 0;
+        }
+
+        return safe_atou64(v, ret);
+}
+
+static int unit_get_memory_current_at(Unit *u, int dfd, uint64_t *ret) {
         int r;
 
         assert(u);
@@ -3165,10 +3440,14 @@ int unit_get_memory_current(Unit *u, uint64_t *ret) {
         if (r < 0)
                 return r;
 
-        return cg_get_attribute_as_uint64("memory", u->cgroup_path, r > 0 ? "memory.current" : "memory.usage_in_bytes", ret);
+        return unit_cgroup_read_attribute_as_uint64(u, dfd, "memory", r > 0 ? "memory.current" : "memory.usage_in_bytes", ret);
 }
 
-int unit_get_tasks_current(Unit *u, uint64_t *ret) {
+int unit_get_memory_current(Unit *u, uint64_t *ret) {
+        return unit_get_memory_current_at(u, -1, ret);
+}
+
+static int unit_get_tasks_current_at(Unit *u, int dfd, uint64_t *ret) {
         assert(u);
         assert(ret);
 
@@ -3185,10 +3464,14 @@ int unit_get_tasks_current(Unit *u, uint64_t *ret) {
         if ((u->cgroup_realized_mask & CGROUP_MASK_PIDS) == 0)
                 return -ENODATA;
 
-        return cg_get_attribute_as_uint64("pids", u->cgroup_path, "pids.current", ret);
+        return unit_cgroup_read_attribute_as_uint64(u, dfd, "pids", "pids.current", ret);
+}
+
+int unit_get_tasks_current(Unit *u, uint64_t *ret) {
+        return unit_get_tasks_current_at(u, -1, ret);
 }
 
-static int unit_get_cpu_usage_raw(Unit *u, nsec_t *ret) {
+static int unit_get_cpu_usage_raw(Unit *u, int dfd, nsec_t *ret) {
         uint64_t ns;
         int r;
 
@@ -3210,28 +3493,34 @@ static int unit_get_cpu_usage_raw(Unit *u, nsec_t *ret) {
         if (r < 0)
                 return r;
         if (r > 0) {
-                _cleanup_free_ char *val = NULL;
+                _cleanup_free_ char *contents = NULL;
+                const char *p, *w;
                 uint64_t us;
 
-                r = cg_get_keyed_attribute("cpu", u->cgroup_path, "cpu.stat", STRV_MAKE("usage_usec"), &val);
-                if (IN_SET(r, -ENOENT, -ENXIO))
-                        return -ENODATA;
+                r = unit_cgroup_read_attribute(u, dfd, "cpu", "cpu.stat", &contents);
                 if (r < 0)
                         return r;
 
-                r = safe_atou64(val, &us);
+                for (p = contents, w = NULL; *p && !w; p += strspn(p, NEWLINE)) {
+                        w = first_word(p, "usage_usec");
+                        p += strcspn(p, NEWLINE);
+                }
+                if (!w)
+                        return -ENODATA;
+
+                r = safe_atou64(strndupa(w, strcspn(w, NEWLINE)), &us);
                 if (r < 0)
                         return r;
 
                 ns = us * NSEC_PER_USEC;
         } else
-                return cg_get_attribute_as_uint64("cpuacct", u->cgroup_path, "cpuacct.usage", ret);
+                return unit_cgroup_read_attribute_as_uint64(u, dfd, "cpuacct", "cpuacct.usage", ret);
 
         *ret = ns;
         return 0;
 }
 
-int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
+static int unit_get_cpu_usage_at(Unit *u, int dfd, nsec_t *ret) {
         nsec_t ns;
         int r;
 
@@ -3244,7 +3533,7 @@ int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
         if (!UNIT_CGROUP_BOOL(u, cpu_accounting))
                 return -ENODATA;
 
-        r = unit_get_cpu_usage_raw(u, &ns);
+        r = unit_get_cpu_usage_raw(u, dfd, &ns);
         if (r == -ENODATA && u->cpu_usage_last != NSEC_INFINITY) {
                 /* If we can't get the CPU usage anymore (because the cgroup was already removed, for example), use our
                  * cached value. */
@@ -3268,32 +3557,24 @@ int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
         return 0;
 }
 
-int unit_get_ip_accounting(
-                Unit *u,
-                CGroupIPAccountingMetric metric,
-                uint64_t *ret) {
+int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
+        return unit_get_cpu_usage_at(u, -1, ret);
+}
 
-        uint64_t value;
-        int fd, r;
+int unit_get_ip_accounting_all(Unit *u, uint64_t ret[static _CGROUP_IP_ACCOUNTING_METRIC_MAX]) {
+        uint64_t values[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
+        int r;
 
         assert(u);
-        assert(metric >= 0);
-        assert(metric < _CGROUP_IP_ACCOUNTING_METRIC_MAX);
         assert(ret);
 
         if (!UNIT_CGROUP_BOOL(u, ip_accounting))
                 return -ENODATA;
 
-        fd = IN_SET(metric, CGROUP_IP_INGRESS_BYTES, CGROUP_IP_INGRESS_PACKETS) ?
-                u->ip_accounting_ingress_map_fd :
-                u->ip_accounting_egress_map_fd;
-        if (fd < 0)
+        if (u->ip_accounting_map_fd < 0)
                 return -ENODATA;
 
-        if (IN_SET(metric, CGROUP_IP_INGRESS_BYTES, CGROUP_IP_EGRESS_BYTES))
-                r = bpf_firewall_read_accounting(fd, &value, NULL);
-        else
-                r = bpf_firewall_read_accounting(fd, NULL, &value);
+        r = bpf_firewall_read_accounting(u->ip_accounting_map_fd, values);
         if (r < 0)
                 return r;
 
@@ -3301,12 +3582,34 @@ int unit_get_ip_accounting(
          * all BPF programs and maps anew, but serialize the old counters. When deserializing we store them in the
          * ip_accounting_extra[] field, and add them in here transparently. */
 
-        *ret = value + u->ip_accounting_extra[metric];
+        for (CGroupIPAccountingMetric i = 0; i < _CGROUP_IP_ACCOUNTING_METRIC_MAX; i++)
+                ret[i] = values[i] + u->ip_accounting_extra[i];
 
-        return r;
+        return 0;
 }
 
-static int unit_get_io_accounting_raw(Unit *u, uint64_t ret[static _CGROUP_IO_ACCOUNTING_METRIC_MAX]) {
+int unit_get_ip_accounting(
+                Unit *u,
+                CGroupIPAccountingMetric metric,
+                uint64_t *ret) {
+
+        uint64_t values[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
+        int r;
+
+        assert(u);
+        assert(metric >= 0);
+        assert(metric < _CGROUP_IP_ACCOUNTING_METRIC_MAX);
+        assert(ret);
+
+        r = unit_get_ip_accounting_all(u, values);
+        if (r < 0)
+                return r;
+
+        *ret = values[metric];
+        return 0;
+}
+
+static int unit_get_io_accounting_raw(Unit *u, int dfd, uint64_t ret[static _CGROUP_IO_ACCOUNTING_METRIC_MAX]) {
         static const char *const field_names[_CGROUP_IO_ACCOUNTING_METRIC_MAX] = {
                 [CGROUP_IO_READ_BYTES]       = "rbytes=",
                 [CGROUP_IO_WRITE_BYTES]      = "wbytes=",
@@ -3314,8 +3617,8 @@ static int unit_get_io_accounting_raw(Unit *u, uint64_t ret[static _CGROUP_IO_AC
                 [CGROUP_IO_WRITE_OPERATIONS] = "wios=",
         };
         uint64_t acc[_CGROUP_IO_ACCOUNTING_METRIC_MAX] = {};
-        _cleanup_free_ char *path = NULL;
-        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *contents = NULL;
+        char *line, *eol;
         int r;
 
         assert(u);
@@ -3335,23 +3638,18 @@ static int unit_get_io_accounting_raw(Unit *u, uint64_t ret[static _CGROUP_IO_AC
         if (!FLAGS_SET(u->cgroup_realized_mask, CGROUP_MASK_IO))
                 return -ENODATA;
 
-        r = cg_get_path("io", u->cgroup_path, "io.stat", &path);
+        r = unit_cgroup_read_attribute(u, dfd, "io", "io.stat", &contents);
+        if (r == -ENODATA)
+                return -ENOENT;
         if (r < 0)
                 return r;
 
-        f = fopen(path, "re");
-        if (!f)
-                return -errno;
-
-        for (;;) {
-                _cleanup_free_ char *line = NULL;
+        for (line = contents; line && *line; line = eol) {
                 const char *p;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
-                if (r < 0)
-                        return r;
-                if (r == 0)
-                        break;
+                eol = strchr(line, '\n');
+                if (eol)
+                        *(eol++) = 0;
 
                 p = line;
                 p += strcspn(p, WHITESPACE); /* Skip over device major/minor */
@@ -3389,8 +3687,9 @@ static int unit_get_io_accounting_raw(Unit *u, uint64_t ret[static _CGROUP_IO_AC
         return 0;
 }
 
-int unit_get_io_accounting(
+static int unit_get_io_accounting_at(
                 Unit *u,
+                int dfd,
                 CGroupIOAccountingMetric metric,
                 bool allow_cache,
                 uint64_t *ret) {
@@ -3406,7 +3705,7 @@ int unit_get_io_accounting(
         if (allow_cache && u->io_accounting_last[metric] != UINT64_MAX)
                 goto done;
 
-        r = unit_get_io_accounting_raw(u, raw);
+        r = unit_get_io_accounting_raw(u, dfd, raw);
         if (r == -ENODATA && u->io_accounting_last[metric] != UINT64_MAX)
                 goto done;
         if (r < 0)
@@ -3427,6 +3726,66 @@ done:
         return 0;
 }
 
+int unit_get_io_accounting(
+                Unit *u,
+                CGroupIOAccountingMetric metric,
+                bool allow_cache,
+                uint64_t *ret) {
+
+        return unit_get_io_accounting_at(u, -1, metric, allow_cache, ret);
+}
+
+int unit_get_accounting(Unit *u, CGroupAccounting *ret) {
+        _cleanup_close_ int dfd = -1;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        /* Collects all accounting data of a unit at once. On the unified hierarchy all attributes are in
+         * the same directory, hence we open it once and read the attributes relative to it, instead of
+         * resolving the full path for each of them. Data that is not available is set to UINT64_MAX, like
+         * the respective unit properties do. */
+
+        *ret = (CGroupAccounting) {
+                .cpu_usage = NSEC_INFINITY,
+                .memory_current = UINT64_MAX,
+                .tasks_current = UINT64_MAX,
+        };
+        for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++)
+                ret->io[i] = UINT64_MAX;
+        for (CGroupIPAccountingMetric i = 0; i < _CGROUP_IP_ACCOUNTING_METRIC_MAX; i++)
+                ret->ip[i] = UINT64_MAX;
+
+        if (u->cgroup_path && !unit_has_host_root_cgroup(u) && cg_all_unified() > 0) {
+                _cleanup_free_ char *p = NULL;
+
+                /* If this fails, the individual reads below will fail the same way */
+                if (cg_get_path(SYSTEMD_CGROUP_CONTROLLER, u->cgroup_path, NULL, &p) >= 0)
+                        dfd = open(p, O_PATH|O_DIRECTORY|O_CLOEXEC);
+        }
+
+        r = unit_get_cpu_usage_at(u, dfd, &ret->cpu_usage);
+        if (r < 0 && r != -ENODATA)
+                log_unit_debug_errno(u, r, "Failed to get CPU usage, ignoring: %m");
+
+        r = unit_get_memory_current_at(u, dfd, &ret->memory_current);
+        if (r < 0 && r != -ENODATA)
+                log_unit_debug_errno(u, r, "Failed to get current memory usage, ignoring: %m");
+
+        r = unit_get_tasks_current_at(u, dfd, &ret->tasks_current);
+        if (r < 0 && r != -ENODATA)
+                log_unit_debug_errno(u, r, "Failed to get current number of tasks, ignoring: %m");
+
+        /* The first call reads io.stat and updates all counters, the others are served from that */
+        for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++)
+                (void) unit_get_io_accounting_at(u, dfd, i, i > 0, &ret->io[i]);
+
+        (void) unit_get_ip_accounting_all(u, ret->ip);
+
+        return 0;
+}
+
 int unit_reset_cpu_accounting(Unit *u) {
         int r;
 
@@ -3434,7 +3793,7 @@ int unit_reset_cpu_accounting(Unit *u) {
 
         u->cpu_usage_last = NSEC_INFINITY;
 
-        r = unit_get_cpu_usage_raw(u, &u->cpu_usage_base);
+        r = unit_get_cpu_usage_raw(u, -1, &u->cpu_usage_base);
         if (r < 0) {
                 u->cpu_usage_base = 0;
                 return r;
@@ -3444,19 +3803,16 @@ int unit_reset_cpu_accounting(Unit *u) {
 }
 
 int unit_reset_ip_accounting(Unit *u) {
-        int r = 0, q = 0;
+        int r = 0;
 
         assert(u);
 
-        if (u->ip_accounting_ingress_map_fd >= 0)
-                r = bpf_firewall_reset_accounting(u->ip_accounting_ingress_map_fd);
-
-        if (u->ip_accounting_egress_map_fd >= 0)
-                q = bpf_firewall_reset_accounting(u->ip_accounting_egress_map_fd);
+        if (u->ip_accounting_map_fd >= 0)
+                r = bpf_firewall_reset_accounting(u->ip_accounting_map_fd);
 
         zero(u->ip_accounting_extra);
 
-        return r < 0 ? r : q;
+        return r;
 }
 
 int unit_reset_io_accounting(Unit *u) {
@@ -3467,7 +3823,7 @@ int unit_reset_io_accounting(Unit *u) {
         for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++)
                 u->io_accounting_last[i] = UINT64_MAX;
 
-        r = unit_get_io_accounting_raw(u, u->io_accounting_base);
+        r = unit_get_io_accounting_raw(u, -1, u->io_accounting_base);
         if (r < 0) {
                 zero(u->io_accounting_base);
                 return r;
@@ -181,6 +181,15 @@ typedef enum CGroupIOAccountingMetric {
         _CGROUP_IO_ACCOUNTING_METRIC_INVALID = -1,
 } CGroupIOAccountingMetric;
 
+/* All accounting data of a unit, as collected by unit_get_accounting() */
+typedef struct CGroupAccounting {
+        nsec_t cpu_usage;
+        uint64_t memory_current;
+        uint64_t tasks_current;
+        uint64_t io[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
+        uint64_t ip[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
+} CGroupAccounting;
+
 typedef struct Unit Unit;
 typedef struct Manager Manager;
 
@@ -235,6 +244,9 @@ unsigned manager_dispatch_cgroup_realize_queue(Manager *m);
 
 Unit *manager_get_unit_by_cgroup(Manager *m, const char *cgroup);
 Unit *manager_get_unit_by_pid_cgroup(Manager *m, pid_t pid);
+Unit *manager_get_unit_by_pid_cgroup_cached(Manager *m, pid_t pid, bool populate);
+void manager_forget_pid_cgroup(Manager *m, pid_t pid);
+void manager_flush_pid_cgroup_cache(Manager *m);
 Unit* manager_get_unit_by_pid(Manager *m, pid_t pid);
 
 uint64_t unit_get_ancestor_memory_min(Unit *u);
@@ -250,6 +262,8 @@ int unit_get_tasks_current(Unit *u, uint64_t *ret);
 int unit_get_cpu_usage(Unit *u, nsec_t *ret);
 int unit_get_io_accounting(Unit *u, CGroupIOAccountingMetric metric, bool allow_cache, uint64_t *ret);
 int unit_get_ip_accounting(Unit *u, CGroupIPAccountingMetric metric, uint64_t *ret);
+int unit_get_ip_accounting_all(Unit *u, uint64_t ret[static _CGROUP_IP_ACCOUNTING_METRIC_MAX]);
+int unit_get_accounting(Unit *u, CGroupAccounting *ret);
 
 int unit_reset_cpu_accounting(Unit *u);
 int unit_reset_ip_accounting(Unit *u);
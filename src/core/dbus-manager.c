@@ -11,6 +11,7 @@
 #include "bus-common-errors.h"
 #include "bus-get-properties.h"
 #include "bus-log-control-api.h"
+#include "bus-objects.h"
 #include "dbus-cgroup.h"
 #include "dbus-execute.h"
 #include "dbus-job.h"
@@ -959,6 +960,110 @@ static int method_start_transient_unit(sd_bus_message *message, void *userdata,
         return bus_unit_queue_job(message, u, JOB_START, mode, 0, error);
 }
 
+static int method_start_transient_units(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_free_ Unit **units = NULL;
+        size_t n_units = 0, n_allocated = 0;
+        Manager *m = userdata;
+        const char *smode;
+        JobMode mode;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Like StartTransientUnit(), but for many units at once, so that container managers can set up a
+         * batch of scopes with one method call and one authorization check, instead of one for each. All
+         * units are created first, then a start job is enqueued for each of them, in order. */
+
+        r = mac_selinux_access_check(message, "start", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "s", &smode);
+        if (r < 0)
+                return r;
+
+        mode = job_mode_from_string(smode);
+        if (mode < 0)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Job mode %s is invalid.", smode);
+        if (mode == JOB_ISOLATE)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Job mode %s is not supported for multiple units.", smode);
+
+        r = bus_verify_manage_units_async(m, message, error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        r = sd_bus_message_enter_container(message, 'a', "(sa(sv)a(sa(sv)))");
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_enter_container(message, 'r', "sa(sv)a(sa(sv))")) > 0) {
+                const char *name;
+                Unit *u;
+
+                r = sd_bus_message_read(message, "s", &name);
+                if (r < 0)
+                        return r;
+
+                r = transient_unit_from_message(m, message, name, &u, error);
+                if (r < 0)
+                        return r;
+
+                r = transient_aux_units_from_message(m, message, error);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_exit_container(message);
+                if (r < 0)
+                        return r;
+
+                if (!GREEDY_REALLOC(units, n_allocated, n_units + 1))
+                        return -ENOMEM;
+
+                units[n_units++] = u;
+        }
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_exit_container(message);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "o");
+        if (r < 0)
+                return r;
+
+        for (size_t i = 0; i < n_units; i++) {
+                _cleanup_free_ char *job_path = NULL;
+                Job *j;
+
+                r = bus_unit_queue_job_one(message, units[i], JOB_START, mode, 0, NULL, &j, error);
+                if (r < 0)
+                        return r;
+
+                job_path = job_dbus_path(j);
+                if (!job_path)
+                        return -ENOMEM;
+
+                r = sd_bus_message_append(reply, "o", job_path);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_get_job(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_free_ char *path = NULL;
         Manager *m = userdata;
@@ -1054,6 +1159,22 @@ static int method_reset_failed(sd_bus_message *message, void *userdata, sd_bus_e
         return sd_bus_reply_method_return(message, NULL);
 }
 
+static bool unit_matches_filter(Unit *u, char **states, char **patterns) {
+        assert(u);
+
+        if (!strv_isempty(states) &&
+            !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
+            !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
+            !strv_contains(states, unit_sub_state_to_string(u)))
+                return false;
+
+        if (!strv_isempty(patterns) &&
+            !strv_fnmatch_or_empty(patterns, u->id, FNM_NOESCAPE))
+                return false;
+
+        return true;
+}
+
 static int list_units_filtered(sd_bus_message *message, void *userdata, sd_bus_error *error, char **states, char **patterns) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -1083,14 +1204,7 @@ static int list_units_filtered(sd_bus_message *message, void *userdata, sd_bus_e
                 if (k != u->id)
                         continue;
 
-                if (!strv_isempty(states) &&
-                    !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
-                    !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
-                    !strv_contains(states, unit_sub_state_to_string(u)))
-                        continue;
-
-                if (!strv_isempty(patterns) &&
-                    !strv_fnmatch_or_empty(patterns, u->id, FNM_NOESCAPE))
+                if (!unit_matches_filter(u, states, patterns))
                         continue;
 
                 r = reply_unit_info(reply, u);
@@ -1136,6 +1250,329 @@ static int method_list_units_by_patterns(sd_bus_message *message, void *userdata
         return list_units_filtered(message, userdata, error, states, patterns);
 }
 
+static int method_list_units_with_properties(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **states = NULL, **patterns = NULL, **properties = NULL;
+        Manager *m = userdata;
+        const char *interface, *k;
+        Iterator i;
+        Unit *u;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method. It returns what GetAll() on each matching unit would, in a single
+         * reply, so that clients don't need one round trip per unit. */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &states);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "s", &interface);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &properties);
+        if (r < 0)
+                return r;
+
+        if (isempty(interface))
+                interface = NULL;
+        else if (!interface_name_is_valid(interface))
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Invalid interface name '%s'.", interface);
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sa{sv})");
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                _cleanup_free_ char *path = NULL;
+
+                if (k != u->id)
+                        continue;
+
+                if (!unit_matches_filter(u, states, patterns))
+                        continue;
+
+                /* Skip units the caller couldn't query with GetAll() either */
+                if (mac_selinux_unit_access_check(u, message, "status", NULL) < 0)
+                        continue;
+
+                path = unit_dbus_path(u);
+                if (!path)
+                        return -ENOMEM;
+
+                r = sd_bus_message_open_container(reply, 'r', "sa{sv}");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(reply, "s", u->id);
+                if (r < 0)
+                        return r;
+
+                r = bus_append_object_properties(sd_bus_message_get_bus(message), reply, path, interface, properties, error);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
+static int method_get_units_accounting(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **patterns = NULL;
+        Manager *m = userdata;
+        const char *k;
+        Iterator i;
+        Unit *u;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method. It returns the accounting data of all units with a cgroup matching
+         * the patterns, collecting each unit's data in one go (see unit_get_accounting()), rather than
+         * reading the attributes separately for each property as GetAll() would. */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sttttttttttt)");
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                CGroupAccounting a;
+
+                if (k != u->id)
+                        continue;
+
+                if (!UNIT_HAS_CGROUP_CONTEXT(u) || !u->cgroup_path)
+                        continue;
+
+                if (!unit_matches_filter(u, NULL, patterns))
+                        continue;
+
+                if (mac_selinux_unit_access_check(u, message, "status", NULL) < 0)
+                        continue;
+
+                (void) unit_get_accounting(u, &a);
+
+                r = sd_bus_message_append(
+                                reply, "(sttttttttttt)",
+                                u->id,
+                                a.cpu_usage,
+                                a.memory_current,
+                                a.tasks_current,
+                                a.io[CGROUP_IO_READ_BYTES],
+                                a.io[CGROUP_IO_WRITE_BYTES],
+                                a.io[CGROUP_IO_READ_OPERATIONS],
+                                a.io[CGROUP_IO_WRITE_OPERATIONS],
+                                a.ip[CGROUP_IP_INGRESS_BYTES],
+                                a.ip[CGROUP_IP_INGRESS_PACKETS],
+                                a.ip[CGROUP_IP_EGRESS_BYTES],
+                                a.ip[CGROUP_IP_EGRESS_PACKETS]);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
+static int dependency_graph_enqueue(Set **seen, Unit ***queue, size_t *n_queue, size_t *n_allocated, Unit *u) {
+        int r;
+
+        assert(seen);
+        assert(queue);
+        assert(n_queue);
+        assert(n_allocated);
+        assert(u);
+
+        r = set_ensure_put(seen, NULL, u);
+        if (r <= 0)
+                return r;
+
+        if (!GREEDY_REALLOC(*queue, *n_allocated, *n_queue + 1))
+                return -ENOMEM;
+
+        (*queue)[(*n_queue)++] = u;
+        return 1;
+}
+
+static int method_list_unit_dependency_graph(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **names = NULL, **dependencies = NULL;
+        UnitDependency types[_UNIT_DEPENDENCY_MAX];
+        size_t n_types = 0, n_queue = 0, n_allocated = 0;
+        _cleanup_free_ Unit **queue = NULL;
+        _cleanup_set_free_ Set *seen = NULL;
+        Manager *m = userdata;
+        char **name;
+        Unit *u;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method. It walks the dependencies of the specified types starting from the
+         * specified units, or from all units if none are specified, and returns every unit reached along
+         * with its state and outgoing dependencies, so that clients don't have to query each unit's
+         * dependency properties one by one. */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &names);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &dependencies);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(name, dependencies) {
+                UnitDependency d;
+                bool found = false;
+
+                d = unit_dependency_from_string(*name);
+                if (d < 0)
+                        return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Unknown dependency type: %s", *name);
+
+                for (size_t t = 0; t < n_types; t++)
+                        if (types[t] == d)
+                                found = true;
+                if (!found)
+                        types[n_types++] = d;
+        }
+
+        if (n_types == 0)
+                for (UnitDependency d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
+                        types[n_types++] = d;
+
+        if (strv_isempty(names)) {
+                const char *k;
+                Iterator i;
+
+                HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                        if (k != u->id)
+                                continue;
+
+                        r = dependency_graph_enqueue(&seen, &queue, &n_queue, &n_allocated, u);
+                        if (r < 0)
+                                return r;
+                }
+        } else
+                STRV_FOREACH(name, names) {
+                        if (!unit_name_is_valid(*name, UNIT_NAME_ANY))
+                                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Invalid unit name: %s", *name);
+
+                        r = bus_load_unit_by_name(m, message, *name, &u, error);
+                        if (r < 0)
+                                return r;
+
+                        r = dependency_graph_enqueue(&seen, &queue, &n_queue, &n_allocated, u);
+                        if (r < 0)
+                                return r;
+                }
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sssa(ss))");
+        if (r < 0)
+                return r;
+
+        /* The queue grows while we walk it, until no new units are reached */
+        for (size_t q = 0; q < n_queue; q++) {
+                u = queue[q];
+
+                if (mac_selinux_unit_access_check(u, message, "status", NULL) < 0)
+                        continue;
+
+                r = sd_bus_message_open_container(reply, 'r', "sssa(ss)");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(
+                                reply, "sss",
+                                u->id,
+                                unit_load_state_to_string(u->load_state),
+                                unit_active_state_to_string(unit_active_state(u)));
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_open_container(reply, 'a', "(ss)");
+                if (r < 0)
+                        return r;
+
+                for (size_t t = 0; t < n_types; t++) {
+                        Unit *other;
+                        Iterator i;
+                        void *v;
+
+                        HASHMAP_FOREACH_KEY(v, other, u->dependencies[types[t]], i) {
+                                r = sd_bus_message_append(reply, "(ss)", unit_dependency_to_string(types[t]), other->id);
+                                if (r < 0)
+                                        return r;
+
+                                r = dependency_graph_enqueue(&seen, &queue, &n_queue, &n_allocated, other);
+                                if (r < 0)
+                                        return r;
+                        }
+                }
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_list_jobs(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -1190,6 +1627,49 @@ static int method_list_jobs(sd_bus_message *message, void *userdata, sd_bus_erro
         return sd_bus_send(NULL, reply, NULL);
 }
 
+static int method_get_trace(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *m = userdata;
+        size_t i;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sstt)");
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < m->trace.n_events; i++) {
+                const TraceEvent *e = trace_get(&m->trace, i);
+
+                r = sd_bus_message_append(
+                                reply, "(sstt)",
+                                trace_event_type_to_string(e->type),
+                                e->name,
+                                e->timestamp,
+                                e->duration);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_subscribe(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         Manager *m = userdata;
         int r;
@@ -1365,6 +1845,46 @@ static int method_reload(sd_bus_message *message, void *userdata, sd_bus_error *
         return 1;
 }
 
+static int method_reload_incremental(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        Manager *m = userdata;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        r = verify_run_space("Refusing to reload", error);
+        if (r < 0)
+                return r;
+
+        r = mac_selinux_access_check(message, "reload", error);
+        if (r < 0)
+                return r;
+
+        r = bus_verify_reload_daemon_async(m, message, error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        r = manager_reload_incremental(m);
+        if (r < 0)
+                return r;
+        if (r > 0)
+                return sd_bus_reply_method_return(message, NULL);
+
+        /* Some of the changed units are in use, do a full reload instead, with the reply sent after it
+         * finished, as in method_reload() */
+
+        assert(!m->pending_reload_message);
+        r = sd_bus_message_new_method_return(message, &m->pending_reload_message);
+        if (r < 0)
+                return r;
+
+        m->objective = MANAGER_RELOAD;
+
+        return 1;
+}
+
 static int method_reexecute(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         Manager *m = userdata;
         int r;
@@ -2502,6 +3022,7 @@ const sd_bus_vtable bus_manager_vtable[] = {
         BUS_PROPERTY_DUAL_TIMESTAMP("InitRDUnitsLoadFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_INITRD_UNITS_LOAD_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_WRITABLE_PROPERTY("LogLevel", "s", bus_property_get_log_level, property_set_log_level, 0, 0),
         SD_BUS_WRITABLE_PROPERTY("LogTarget", "s", bus_property_get_log_target, property_set_log_target, 0, 0),
+        SD_BUS_WRITABLE_PROPERTY("EventStatistics", "b", bus_property_get_event_statistics, bus_property_set_event_statistics, 0, 0),
         SD_BUS_PROPERTY("NNames", "u", property_get_hashmap_size, offsetof(Manager, units), 0),
         SD_BUS_PROPERTY("NFailedUnits", "u", property_get_set_size, offsetof(Manager, failed_units), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
         SD_BUS_PROPERTY("NJobs", "u", property_get_hashmap_size, offsetof(Manager, jobs), 0),
@@ -2750,6 +3271,14 @@ const sd_bus_vtable bus_manager_vtable[] = {
                                  SD_BUS_PARAM(job),
                                  method_start_transient_unit,
                                  SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("StartTransientUnits",
+                                 "sa(sa(sv)a(sa(sv)))",
+                                 SD_BUS_PARAM(mode)
+                                 SD_BUS_PARAM(units),
+                                 "ao",
+                                 SD_BUS_PARAM(jobs),
+                                 method_start_transient_units,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_NAMES("GetUnitProcesses",
                                  "s",
                                  SD_BUS_PARAM(name),
@@ -2842,12 +3371,49 @@ const sd_bus_vtable bus_manager_vtable[] = {
                                  SD_BUS_PARAM(units),
                                  method_list_units_by_names,
                                  SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("ListUnitsWithProperties",
+                                 "asassas",
+                                 SD_BUS_PARAM(states)
+                                 SD_BUS_PARAM(patterns)
+                                 SD_BUS_PARAM(interface)
+                                 SD_BUS_PARAM(properties),
+                                 "a(sa{sv})",
+                                 SD_BUS_PARAM(units),
+                                 method_list_units_with_properties,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("GetUnitsAccounting",
+                                 "as",
+                                 SD_BUS_PARAM(patterns),
+                                 "a(sttttttttttt)",
+                                 SD_BUS_PARAM(units),
+                                 method_get_units_accounting,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("ListUnitDependencyGraph",
+                                 "asas",
+                                 SD_BUS_PARAM(names)
+                                 SD_BUS_PARAM(dependencies),
+                                 "a(sssa(ss))",
+                                 SD_BUS_PARAM(units),
+                                 method_list_unit_dependency_graph,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_NAMES("ListJobs",
                                  NULL,,
                                  "a(usssoo)",
                                  SD_BUS_PARAM(jobs),
                                  method_list_jobs,
                                  SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("GetTrace",
+                                 NULL,,
+                                 "a(sstt)",
+                                 SD_BUS_PARAM(events),
+                                 method_get_trace,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("GetEventStatistics",
+                                 NULL,,
+                                 "a(sttttt)",
+                                 SD_BUS_PARAM(statistics),
+                                 bus_method_get_event_statistics,
+                                 0),
         SD_BUS_METHOD("Subscribe",
                       NULL,
                       NULL,
@@ -2889,6 +3455,11 @@ const sd_bus_vtable bus_manager_vtable[] = {
                       NULL,
                       method_reload,
                       SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ReloadIncremental",
+                      NULL,
+                      NULL,
+                      method_reload_incremental,
+                      SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Reexecute",
                       NULL,
                       NULL,
@@ -3169,6 +3740,14 @@ const sd_bus_vtable bus_manager_log_control_vtable[] = {
         SD_BUS_WRITABLE_PROPERTY("LogLevel", "s", bus_property_get_log_level, property_set_log_level, 0, 0),
         SD_BUS_WRITABLE_PROPERTY("LogTarget", "s", bus_property_get_log_target, property_set_log_target, 0, 0),
         SD_BUS_PROPERTY("SyslogIdentifier", "s", bus_property_get_syslog_identifier, 0, 0),
+        SD_BUS_WRITABLE_PROPERTY("EventStatistics", "b", bus_property_get_event_statistics, bus_property_set_event_statistics, 0, 0),
+
+        SD_BUS_METHOD_WITH_NAMES("GetEventStatistics",
+                                 NULL,,
+                                 "a(sttttt)",
+                                 SD_BUS_PARAM(statistics),
+                                 bus_method_get_event_statistics,
+                                 0),
 
         SD_BUS_VTABLE_END,
 };
@@ -46,6 +46,9 @@ static int property_get_listen(
                 _cleanup_free_ char *address = NULL;
                 const char *a;
 
+                if (p->instance > 0)
+                        continue;
+
                 switch (p->type) {
                         case SOCKET_SOCKET: {
                                 r = socket_address_print(&p->address, &address);
@@ -115,6 +118,8 @@ const sd_bus_vtable bus_socket_vtable[] = {
         SD_BUS_PROPERTY("MessageQueueMessageSize", "x", bus_property_get_long, offsetof(Socket, mq_msgsize), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("TCPCongestion", "s", NULL, offsetof(Socket, tcp_congestion), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("ReusePort", "b",  bus_property_get_bool, offsetof(Socket, reuse_port), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("ReusePortInstances", "u", bus_property_get_unsigned, offsetof(Socket, reuse_port_instances), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("ReusePortCPUSteering", "b", bus_property_get_bool, offsetof(Socket, reuse_port_cpu_steering), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("SmackLabel", "s", NULL, offsetof(Socket, smack), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("SmackLabelIPIn", "s", NULL, offsetof(Socket, smack_ip_in), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("SmackLabelIPOut", "s", NULL, offsetof(Socket, smack_ip_out), SD_BUS_VTABLE_PROPERTY_CONST),
@@ -209,6 +214,9 @@ static int bus_socket_set_transient_property(
         if (streq(name, "ReusePort"))
                 return bus_set_transient_bool(u, name, &s->reuse_port, message, flags, error);
 
+        if (streq(name, "ReusePortCPUSteering"))
+                return bus_set_transient_bool(u, name, &s->reuse_port_cpu_steering, message, flags, error);
+
         if (streq(name, "RemoveOnStop"))
                 return bus_set_transient_bool(u, name, &s->remove_on_stop, message, flags, error);
 
@@ -233,6 +241,9 @@ static int bus_socket_set_transient_property(
         if (streq(name, "MaxConnectionsPerSource"))
                 return bus_set_transient_unsigned(u, name, &s->max_connections_per_source, message, flags, error);
 
+        if (streq(name, "ReusePortInstances"))
+                return bus_set_transient_unsigned(u, name, &s->reuse_port_instances, message, flags, error);
+
         if (streq(name, "KeepAliveProbes"))
                 return bus_set_transient_unsigned(u, name, &s->keep_alive_cnt, message, flags, error);
 
@@ -1718,25 +1718,24 @@ void bus_unit_send_removed_signal(Unit *u) {
                 log_unit_debug_errno(u, r, "Failed to send unit remove signal for %s: %m", u->id);
 }
 
-int bus_unit_queue_job(
+int bus_unit_queue_job_one(
                 sd_bus_message *message,
                 Unit *u,
                 JobType type,
                 JobMode mode,
                 BusUnitQueueFlags flags,
+                Set *affected,
+                Job **ret,
                 sd_bus_error *error) {
 
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
-        _cleanup_free_ char *job_path = NULL, *unit_path = NULL;
-        _cleanup_set_free_ Set *affected = NULL;
-        Iterator i;
-        Job *j, *a;
+        Job *j;
         int r;
 
         assert(message);
         assert(u);
         assert(type >= 0 && type < _JOB_TYPE_MAX);
         assert(mode >= 0 && mode < _JOB_MODE_MAX);
+        assert(ret);
 
         r = mac_selinux_unit_access_check(
                         u, message,
@@ -1763,12 +1762,6 @@ int bus_unit_queue_job(
             (type == JOB_RELOAD_OR_START && job_type_collapse(type, u) == JOB_START && u->refuse_manual_start))
                 return sd_bus_error_setf(error, BUS_ERROR_ONLY_BY_DEPENDENCY, "Operation refused, unit %s may be requested by dependency only (it is configured to refuse manual start/stop).", u->id);
 
-        if (FLAGS_SET(flags, BUS_UNIT_QUEUE_VERBOSE_REPLY)) {
-                affected = set_new(NULL);
-                if (!affected)
-                        return -ENOMEM;
-        }
-
         r = manager_add_job(u->manager, type, u, mode, affected, error, &j);
         if (r < 0)
                 return r;
@@ -1780,6 +1773,38 @@ int bus_unit_queue_job(
         /* Before we send the method reply, force out the announcement JobNew for this job */
         bus_job_send_pending_change_signal(j, true);
 
+        *ret = j;
+        return 0;
+}
+
+int bus_unit_queue_job(
+                sd_bus_message *message,
+                Unit *u,
+                JobType type,
+                JobMode mode,
+                BusUnitQueueFlags flags,
+                sd_bus_error *error) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_free_ char *job_path = NULL, *unit_path = NULL;
+        _cleanup_set_free_ Set *affected = NULL;
+        Iterator i;
+        Job *j, *a;
+        int r;
+
+        assert(message);
+        assert(u);
+
+        if (FLAGS_SET(flags, BUS_UNIT_QUEUE_VERBOSE_REPLY)) {
+                affected = set_new(NULL);
+                if (!affected)
+                        return -ENOMEM;
+        }
+
+        r = bus_unit_queue_job_one(message, u, type, mode, flags, affected, &j, error);
+        if (r < 0)
+                return r;
+
         job_path = job_dbus_path(j);
         if (!job_path)
                 return -ENOMEM;
@@ -14,8 +14,10 @@
 #include "parse-util.h"
 #include "path-util.h"
 #include "serialize.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "string-util.h"
+#include "strv.h"
 #include "swap.h"
 #include "udev-util.h"
 #include "unit-name.h"
@@ -27,6 +29,10 @@ static const UnitActiveState state_translation_table[_DEVICE_STATE_MAX] = {
         [DEVICE_PLUGGED] = UNIT_ACTIVE,
 };
 
+/* Key for hashing the udev properties we care about. This is not exposed anywhere, it's just used to detect
+ * "change" uevents that carry nothing new for us, hence a fixed key is fine. */
+#define DEVICE_PROPERTIES_HASH_KEY SD_ID128_MAKE(2d,84,1f,e6,b1,0a,4f,33,9c,05,d5,7e,63,6a,c1,04)
+
 static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata);
 static void device_update_found_one(Device *d, DeviceFound found, DeviceFound mask);
 
@@ -573,9 +579,73 @@ fail:
         return r;
 }
 
+static uint64_t device_properties_hash(sd_device *dev) {
+        struct siphash state;
+        const char *p, *v;
+
+        assert(dev);
+
+        /* Hashes everything device_process_new() looks at, so that we can tell whether a uevent for a device we
+         * already know changed anything relevant for us. Each value is hashed including its trailing NUL, and
+         * prefixed by whether it is set at all, so that different combinations can't be confused. */
+
+        siphash24_init(&state, DEVICE_PROPERTIES_HASH_KEY.bytes);
+
+        FOREACH_STRING(p,
+                       "SYSTEMD_WANTS",
+                       "SYSTEMD_USER_WANTS",
+                       "SYSTEMD_ALIAS",
+                       "SYSTEMD_MOUNT_DEVICE_BOUND",
+                       "ID_MODEL_FROM_DATABASE",
+                       "ID_MODEL",
+                       "ID_FS_LABEL",
+                       "ID_PART_ENTRY_NAME",
+                       "ID_PART_ENTRY_NUMBER") {
+                bool b;
+
+                b = sd_device_get_property_value(dev, p, &v) >= 0;
+                siphash24_compress_boolean(b, &state);
+                if (b)
+                        siphash24_compress(v, strlen(v) + 1, &state);
+        }
+
+        if (sd_device_get_devname(dev, &v) >= 0)
+                siphash24_compress(v, strlen(v) + 1, &state);
+        siphash24_compress_byte(0, &state);
+
+        FOREACH_DEVICE_DEVLINK(dev, v)
+                siphash24_compress(v, strlen(v) + 1, &state);
+
+        return siphash24_finalize(&state);
+}
+
+static Device *device_get_main(Manager *m, const char *sysfs) {
+        Device *d, *l;
+
+        assert(m);
+        assert(sysfs);
+
+        /* Returns the unit named after the sysfs path itself, if there is one */
+
+        l = hashmap_get(m->devices_by_sysfs, sysfs);
+        LIST_FOREACH(same_sysfs, d, l) {
+                _cleanup_free_ char *p = NULL;
+
+                if (unit_name_to_path(UNIT(d)->id, &p) < 0)
+                        continue;
+
+                if (path_equal(p, sysfs))
+                        return d;
+        }
+
+        return NULL;
+}
+
 static int device_process_new(Manager *m, sd_device *dev) {
         const char *sysfs, *dn, *alias;
+        uint64_t properties_hash;
         dev_t devnum;
+        Device *d;
         int r;
 
         assert(m);
@@ -583,11 +653,33 @@ static int device_process_new(Manager *m, sd_device *dev) {
         if (sd_device_get_syspath(dev, &sysfs) < 0)
                 return 0;
 
+        /* During coldplug and for devices that are retriggered a lot (think SR-IOV VFs, large JBODs), most
+         * uevents are for devices we already set up, and carry no new information for us. Setting up all
+         * units of such a device again means dropping and re-adding its dependencies, stat()ing all its
+         * symlinks and re-parsing its properties, hence skip that if none of the properties we look at changed
+         * since we last did it, and the device is still plugged. */
+        properties_hash = device_properties_hash(dev);
+
+        d = device_get_main(m, sysfs);
+        if (d &&
+            d->properties_hash_valid &&
+            d->properties_hash == properties_hash &&
+            FLAGS_SET(d->found, DEVICE_FOUND_UDEV)) {
+                log_unit_debug(UNIT(d), "Relevant udev properties of %s didn't change, skipping.", sysfs);
+                return 0;
+        }
+
         /* Add the main unit named after the sysfs path */
         r = device_setup_unit(m, dev, sysfs, true);
         if (r < 0)
                 return r;
 
+        d = device_get_main(m, sysfs);
+        if (d) {
+                d->properties_hash = properties_hash;
+                d->properties_hash_valid = true;
+        }
+
         /* Add an additional unit for the device node */
         if (sd_device_get_devname(dev, &dn) >= 0)
                 (void) device_setup_unit(m, dev, dn, false);
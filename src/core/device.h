@@ -33,6 +33,11 @@ struct Device {
 
         /* The SYSTEMD_WANTS udev property for this device the last time we saw it */
         char **wants_property;
+
+        /* Hash of the udev properties we looked at the last time we set up the units for this device. Only
+         * maintained on the unit named after the sysfs path. */
+        uint64_t properties_hash;
+        bool properties_hash_valid;
 };
 
 extern const UnitVTable device_vtable;
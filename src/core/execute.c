@@ -80,8 +80,10 @@
 #include "securebits-util.h"
 #include "selinux-util.h"
 #include "signal-util.h"
+#include "siphash24.h"
 #include "smack-util.h"
 #include "socket-util.h"
+#include "sort-util.h"
 #include "special.h"
 #include "stat-util.h"
 #include "string-table.h"
@@ -92,6 +94,7 @@
 #include "tmpfile-util.h"
 #include "umask-util.h"
 #include "unit.h"
+#include "usdt.h"
 #include "user-util.h"
 #include "utmp-wtmp.h"
 
@@ -1441,8 +1444,158 @@ static bool skip_seccomp_unavailable(const Unit* u, const char* msg) {
         return true;
 }
 
+/* Compiled syscall filters are cached in the manager, keyed by everything that goes into the filter. The
+ * filter is compiled by the manager before forking, and the child finds it in its copy of the cache, so
+ * that it only needs to load it. */
+#define SYSCALL_FILTER_CACHE_MAX 128U
+
+typedef struct SyscallFilterKey {
+        uint32_t default_action;
+        uint32_t action;
+        size_t n_syscalls;
+        struct SyscallFilterKeyItem {
+                int id;
+                int error;
+        } syscalls[];
+} SyscallFilterKey;
+
+static size_t syscall_filter_key_size(const SyscallFilterKey *k) {
+        return offsetof(SyscallFilterKey, syscalls) + k->n_syscalls * sizeof(struct SyscallFilterKeyItem);
+}
+
+static void syscall_filter_key_hash_func(const SyscallFilterKey *k, struct siphash *state) {
+        siphash24_compress(k, syscall_filter_key_size(k), state);
+}
+
+static int syscall_filter_key_compare_func(const SyscallFilterKey *a, const SyscallFilterKey *b) {
+        int r;
+
+        r = CMP(a->n_syscalls, b->n_syscalls);
+        if (r != 0)
+                return r;
+
+        return memcmp(a, b, syscall_filter_key_size(a));
+}
+
+DEFINE_PRIVATE_HASH_OPS_FULL(syscall_filter_cache_hash_ops,
+                             SyscallFilterKey, syscall_filter_key_hash_func, syscall_filter_key_compare_func, free,
+                             SeccompProgram, seccomp_program_free);
+
+static int syscall_filter_key_item_compare(const struct SyscallFilterKeyItem *a, const struct SyscallFilterKeyItem *b) {
+        return CMP(a->id, b->id);
+}
+
+static void syscall_filter_actions(const ExecContext *c, uint32_t *ret_default_action, uint32_t *ret_action) {
+        uint32_t negative_action;
+
+        assert(c);
+        assert(ret_default_action);
+        assert(ret_action);
+
+        negative_action = c->syscall_errno == 0 ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
+
+        if (c->syscall_allow_list) {
+                *ret_default_action = negative_action;
+                *ret_action = SCMP_ACT_ALLOW;
+        } else {
+                *ret_default_action = SCMP_ACT_ALLOW;
+                *ret_action = negative_action;
+        }
+}
+
+static SyscallFilterKey* syscall_filter_key_new(const ExecContext *c) {
+        SyscallFilterKey *k;
+        void *syscall_id, *val;
+        Iterator i;
+        size_t n;
+
+        assert(c);
+
+        n = hashmap_size(c->syscall_filter);
+        k = malloc0(offsetof(SyscallFilterKey, syscalls) + n * sizeof(struct SyscallFilterKeyItem));
+        if (!k)
+                return NULL;
+
+        syscall_filter_actions(c, &k->default_action, &k->action);
+
+        HASHMAP_FOREACH_KEY(val, syscall_id, c->syscall_filter, i)
+                k->syscalls[k->n_syscalls++] = (struct SyscallFilterKeyItem) {
+                        .id = PTR_TO_INT(syscall_id) - 1,
+                        .error = PTR_TO_INT(val),
+                };
+
+        /* The iteration order of the hashmap is not stable, hence sort to make equivalent filters match */
+        typesafe_qsort(k->syscalls, k->n_syscalls, syscall_filter_key_item_compare);
+
+        return k;
+}
+
+static const SeccompProgram* syscall_filter_cache_get(Manager *m, const ExecContext *c) {
+        _cleanup_free_ SyscallFilterKey *k = NULL;
+
+        assert(m);
+        assert(c);
+
+        if (hashmap_isempty(m->syscall_filter_cache))
+                return NULL;
+
+        k = syscall_filter_key_new(c);
+        if (!k)
+                return NULL;
+
+        return hashmap_get(m->syscall_filter_cache, k);
+}
+
+static void syscall_filter_cache_prepare(Unit *u, const ExecContext *c) {
+        _cleanup_(seccomp_program_freep) SeccompProgram *p = NULL;
+        _cleanup_free_ SyscallFilterKey *k = NULL;
+        Manager *m;
+        int r;
+
+        assert(u);
+        assert(c);
+
+        /* Called in the manager before forking off the child. Failures are not fatal here, the child will
+         * then build the filter itself, and report any errors properly. */
+
+        m = u->manager;
+
+        if (!context_has_syscall_filters(c) || !is_seccomp_available())
+                return;
+
+        k = syscall_filter_key_new(c);
+        if (!k)
+                return;
+
+        if (hashmap_get(m->syscall_filter_cache, k))
+                return;
+
+        if (hashmap_size(m->syscall_filter_cache) >= SYSCALL_FILTER_CACHE_MAX) {
+                log_unit_debug(u, "Syscall filter cache is full, not caching filter.");
+                return;
+        }
+
+        r = seccomp_compile_syscall_filter_set_raw(k->default_action, c->syscall_filter, k->action, false, &p);
+        if (r < 0) {
+                log_unit_debug_errno(u, r, "Failed to compile syscall filter, ignoring: %m");
+                return;
+        }
+
+        r = hashmap_ensure_allocated(&m->syscall_filter_cache, &syscall_filter_cache_hash_ops);
+        if (r >= 0)
+                r = hashmap_put(m->syscall_filter_cache, k, p);
+        if (r < 0) {
+                log_unit_debug_errno(u, r, "Failed to cache syscall filter, ignoring: %m");
+                return;
+        }
+
+        TAKE_PTR(k);
+        TAKE_PTR(p);
+}
+
 static int apply_syscall_filter(const Unit* u, const ExecContext *c, bool needs_ambient_hack) {
-        uint32_t negative_action, default_action, action;
+        uint32_t default_action, action;
+        const SeccompProgram *p;
         int r;
 
         assert(u);
@@ -1454,16 +1607,14 @@ static int apply_syscall_filter(const Unit* u, const ExecContext *c, bool needs_
         if (skip_seccomp_unavailable(u, "SystemCallFilter="))
                 return 0;
 
-        negative_action = c->syscall_errno == 0 ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
-
-        if (c->syscall_allow_list) {
-                default_action = negative_action;
-                action = SCMP_ACT_ALLOW;
-        } else {
-                default_action = SCMP_ACT_ALLOW;
-                action = negative_action;
+        if (!needs_ambient_hack) {
+                p = syscall_filter_cache_get(u->manager, c);
+                if (p)
+                        return seccomp_program_load(p);
         }
 
+        syscall_filter_actions(c, &default_action, &action);
+
         if (needs_ambient_hack) {
                 r = seccomp_filter_set_add(c->syscall_filter, c->syscall_allow_list, syscall_filter_sets + SYSCALL_FILTER_SET_SETUID);
                 if (r < 0)
@@ -4530,6 +4681,7 @@ int exec_spawn(Unit *unit,
         _cleanup_strv_free_ char **files_env = NULL;
         size_t n_storage_fds = 0, n_socket_fds = 0;
         _cleanup_free_ char *line = NULL;
+        usec_t begin;
         pid_t pid;
 
         assert(unit);
@@ -4539,6 +4691,8 @@ int exec_spawn(Unit *unit,
         assert(params);
         assert(params->fds || (params->n_socket_fds + params->n_storage_fds <= 0));
 
+        begin = manager_trace_begin(unit->manager);
+
         if (context->std_input == EXEC_INPUT_SOCKET ||
             context->std_output == EXEC_OUTPUT_SOCKET ||
             context->std_error == EXEC_OUTPUT_SOCKET) {
@@ -4579,6 +4733,18 @@ int exec_spawn(Unit *unit,
                    LOG_UNIT_ID(unit),
                    LOG_UNIT_INVOCATION_ID(unit));
 
+        USDT(systemd, exec_spawn, unit->id, command->path);
+
+#if HAVE_SECCOMP
+        /* Compile the syscall filter here rather than in the child, so that it is done only once for
+         * all processes sharing the same filter. Not for the ambient capability hack though, which alters
+         * the filter in the child. */
+        if ((params->flags & EXEC_APPLY_SANDBOXING) &&
+            !(command->flags & EXEC_COMMAND_FULLY_PRIVILEGED) &&
+            !((command->flags & EXEC_COMMAND_AMBIENT_MAGIC) && !ambient_capabilities_supported()))
+                syscall_filter_cache_prepare(unit, context);
+#endif
+
         if (params->cgroup_path) {
                 r = exec_parameters_get_cgroup_path(params, &subcgroup_path);
                 if (r < 0)
@@ -4639,6 +4805,12 @@ int exec_spawn(Unit *unit,
 
         exec_status_start(&command->exec_status, pid);
 
+        USDT(systemd, exec_spawn_done, unit->id, command->path, pid);
+
+        /* This only covers our side of it, the child's setup work until it executes the binary is not traced */
+        if (begin > 0)
+                manager_trace_end(unit->manager, TRACE_SPAWN, strjoina(unit->id, ": ", command->path), begin);
+
         *ret = pid;
         return 0;
 }
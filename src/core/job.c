@@ -26,6 +26,7 @@
 #include "strv.h"
 #include "terminal-util.h"
 #include "unit.h"
+#include "usdt.h"
 #include "virt.h"
 
 Job* job_new_raw(Unit *unit) {
@@ -115,6 +116,8 @@ static void job_set_state(Job *j, JobState state) {
         if (j->state == state)
                 return;
 
+        USDT(systemd, job_state, j->id, j->unit->id, j->type, state);
+
         j->state = state;
 
         if (!j->installed)
@@ -239,6 +242,10 @@ Job* job_install(Job *j) {
                        "Installed new job %s/%s as %u",
                        j->unit->id, job_type_to_string(j->type), (unsigned) j->id);
 
+        if (manager_trace_enabled(j->manager))
+                manager_trace_instant(j->manager, TRACE_JOB_ENQUEUE,
+                                      strjoina(j->unit->id, "/", job_type_to_string(j->type)));
+
         job_add_to_gc_queue(j);
 
         job_add_to_dbus_queue(j); /* announce this job to clients */
@@ -990,9 +997,16 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive, bool alr
 
         j->result = result;
 
+        USDT(systemd, job_finish, j->id, u->id, t, result);
+
         log_unit_debug(u, "Job %" PRIu32 " %s/%s finished, result=%s",
                        j->id, u->id, job_type_to_string(t), job_result_to_string(result));
 
+        if (j->begin_running_usec > 0 && manager_trace_enabled(u->manager))
+                manager_trace_end(u->manager, TRACE_JOB_RUN,
+                                  strjoina(u->id, "/", job_type_to_string(t), " (", job_result_to_string(result), ")"),
+                                  j->begin_running_usec);
+
         /* If this job did nothing to the respective unit we don't log the status message */
         if (!already)
                 job_emit_done_status_message(u, j->id, t, result);
@@ -1238,9 +1252,9 @@ int job_deserialize(Job *j, FILE *f) {
                 char *l, *v;
                 size_t k;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0)
                         return 0;
 
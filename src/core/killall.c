@@ -4,6 +4,7 @@
 ***/
 
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -13,10 +14,11 @@
 #include "dirent-util.h"
 #include "fd-util.h"
 #include "format-util.h"
+#include "hashmap.h"
 #include "killall.h"
+#include "missing_syscall.h"
 #include "parse-util.h"
 #include "process-util.h"
-#include "set.h"
 #include "string-util.h"
 #include "terminal-util.h"
 #include "util.h"
@@ -77,12 +79,77 @@ static bool ignore_proc(pid_t pid, bool warn_rootfs) {
         return true;
 }
 
-static void log_children_no_yet_killed(Set *pids) {
+/* The processes we wait for are kept in a Hashmap, mapping the PID to a pidfd, if we could get one */
+
+static void pids_remove(Hashmap *pids, pid_t pid) {
+        safe_close(PTR_TO_FD(hashmap_remove(pids, PID_TO_PTR(pid))));
+}
+
+static Hashmap *pids_free(Hashmap *pids) {
+        void *v;
+
+        while (hashmap_steal_first_key_and_value(pids, &v))
+                safe_close(PTR_TO_FD(v));
+
+        return hashmap_free(pids);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(Hashmap*, pids_free);
+
+static int pids_poll(Hashmap *pids, usec_t timeout) {
+        _cleanup_free_ struct pollfd *pollfds = NULL;
+        _cleanup_free_ pid_t *pollpids = NULL;
+        size_t n = 0, k;
+        struct timespec ts;
+        int n_removed = 0;
+        Iterator i;
+        void *p, *v;
+
+        /* Waits until at least one of the processes we have a pidfd for exits, and removes the ones that
+         * exited. Note that a pidfd becomes readable when the process exits, not when it is reaped.
+         * Returns the number of processes removed. */
+
+        pollfds = new(struct pollfd, hashmap_size(pids));
+        pollpids = new(pid_t, hashmap_size(pids));
+        if (!pollfds || !pollpids)
+                return log_oom();
+
+        HASHMAP_FOREACH_KEY(v, p, pids, i) {
+                if (PTR_TO_FD(v) < 0)
+                        continue;
+
+                pollpids[n] = PTR_TO_PID(p);
+                pollfds[n++] = (struct pollfd) {
+                        .fd = PTR_TO_FD(v),
+                        .events = POLLIN,
+                };
+        }
+
+        if (n == 0)
+                return 0;
+
+        if (ppoll(pollfds, n, timeout == USEC_INFINITY ? NULL : timespec_store(&ts, timeout), NULL) < 0) {
+                if (errno == EINTR)
+                        return 0;
+
+                return log_error_errno(errno, "ppoll() failed: %m");
+        }
+
+        for (k = 0; k < n; k++)
+                if (pollfds[k].revents != 0) {
+                        pids_remove(pids, pollpids[k]);
+                        n_removed++;
+                }
+
+        return n_removed;
+}
+
+static void log_children_no_yet_killed(Hashmap *pids) {
         _cleanup_free_ char *lst_child = NULL;
         Iterator i;
-        void *p;
+        void *p, *v;
 
-        SET_FOREACH(p, pids, i) {
+        HASHMAP_FOREACH_KEY(v, p, pids, i) {
                 _cleanup_free_ char *s = NULL;
 
                 if (get_process_comm(PTR_TO_PID(p), &s) < 0)
@@ -100,7 +167,7 @@ static void log_children_no_yet_killed(Set *pids) {
         log_warning("Waiting for process: %s", lst_child + 2);
 }
 
-static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
+static int wait_for_children(Hashmap *pids, sigset_t *mask, usec_t timeout) {
         usec_t until, date_log_child, n;
 
         assert(mask);
@@ -108,7 +175,7 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
         /* Return the number of children remaining in the pids set: That correspond to the number
          * of processes still "alive" after the timeout */
 
-        if (set_isempty(pids))
+        if (hashmap_isempty(pids))
                 return 0;
 
         n = now(CLOCK_MONOTONIC);
@@ -119,8 +186,9 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
 
         for (;;) {
                 struct timespec ts;
+                size_t n_pidfds = 0;
                 int k;
-                void *p;
+                void *p, *v;
                 Iterator i;
 
                 /* First, let the kernel inform us about killed
@@ -140,12 +208,17 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
                                 return log_error_errno(errno, "waitpid() failed: %m");
                         }
 
-                        (void) set_remove(pids, PID_TO_PTR(pid));
+                        pids_remove(pids, pid);
                 }
 
                 /* Now explicitly check who might be remaining, who
                  * might not be our child. */
-                SET_FOREACH(p, pids, i) {
+                HASHMAP_FOREACH_KEY(v, p, pids, i) {
+
+                        if (PTR_TO_FD(v) >= 0) {
+                                n_pidfds++;
+                                continue;
+                        }
 
                         /* kill(pid, 0) sends no signal, but it tells
                          * us whether the process still exists. */
@@ -155,10 +228,21 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
                         if (errno != ESRCH)
                                 continue;
 
-                        set_remove(pids, p);
+                        pids_remove(pids, PTR_TO_PID(p));
                 }
 
-                if (set_isempty(pids))
+                /* For those we have a pidfd for, we can see directly if they are gone. Keep the count of
+                 * pidfds in sync, as it decides below whether we can wait on the pidfds alone. */
+                if (n_pidfds > 0) {
+                        k = pids_poll(pids, 0);
+                        if (k < 0)
+                                return k;
+
+                        assert((size_t) k <= n_pidfds);
+                        n_pidfds -= k;
+                }
+
+                if (hashmap_isempty(pids))
                         return 0;
 
                 n = now(CLOCK_MONOTONIC);
@@ -169,7 +253,17 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
                 }
 
                 if (n >= until)
-                        return set_size(pids);
+                        return hashmap_size(pids);
+
+                /* If we have a pidfd for every process, wait on them directly. This also catches processes
+                 * that are not our children, and hence don't result in SIGCHLD. */
+                if (n_pidfds == hashmap_size(pids)) {
+                        k = pids_poll(pids, date_log_child > 0 ? MIN(until - n, date_log_child - n) : until - n);
+                        if (k < 0)
+                                return k;
+
+                        continue;
+                }
 
                 if (date_log_child > 0)
                         timespec_store(&ts, MIN(until - n, date_log_child - n));
@@ -188,7 +282,7 @@ static int wait_for_children(Set *pids, sigset_t *mask, usec_t timeout) {
         }
 }
 
-static int killall(int sig, Set *pids, bool send_sighup) {
+static int killall(int sig, Hashmap *pids, bool send_sighup) {
         _cleanup_closedir_ DIR *dir = NULL;
         struct dirent *d;
         int n_killed = 0;
@@ -201,6 +295,8 @@ static int killall(int sig, Set *pids, bool send_sighup) {
                 return log_warning_errno(errno, "opendir(/proc) failed: %m");
 
         FOREACH_DIRENT_ALL(d, dir, break) {
+                _cleanup_close_ int pidfd = -1;
+                bool pinned = false;
                 pid_t pid;
                 int r;
 
@@ -220,14 +316,22 @@ static int killall(int sig, Set *pids, bool send_sighup) {
                         log_notice("Sending SIGKILL to PID "PID_FMT" (%s).", pid, strna(s));
                 }
 
-                if (kill(pid, sig) >= 0) {
+                /* Pin the process with a pidfd, so that we can send the signal without racing against PID
+                 * reuse, and wait for it to exit. If this isn't supported, fall back to the PID. */
+                pidfd = pidfd_open(pid, 0);
+                if (pidfd < 0 && errno == ESRCH)
+                        continue;
+
+                if ((pidfd >= 0 ? pidfd_send_signal(pidfd, sig, NULL, 0) : kill(pid, sig)) >= 0) {
                         n_killed++;
                         if (pids) {
-                                r = set_put(pids, PID_TO_PTR(pid));
+                                r = hashmap_put(pids, PID_TO_PTR(pid), FD_TO_PTR(pidfd));
                                 if (r < 0)
                                         log_oom();
+                                else
+                                        pinned = true;
                         }
-                } else if (errno != ENOENT)
+                } else if (!IN_SET(errno, ENOENT, ESRCH))
                         log_warning_errno(errno, "Could not kill %d: %m", pid);
 
                 if (send_sighup) {
@@ -243,8 +347,12 @@ static int killall(int sig, Set *pids, bool send_sighup) {
 
                         if (get_ctty_devnr(pid, NULL) >= 0)
                                 /* it's OK if the process is gone, just ignore the result */
-                                (void) kill(pid, SIGHUP);
+                                (void) (pidfd >= 0 ? pidfd_send_signal(pidfd, SIGHUP, NULL, 0) : kill(pid, SIGHUP));
                 }
+
+                /* The pidfd is owned by the pids hashmap now */
+                if (pinned)
+                        TAKE_FD(pidfd);
         }
 
         return n_killed;
@@ -253,7 +361,7 @@ static int killall(int sig, Set *pids, bool send_sighup) {
 int broadcast_signal(int sig, bool wait_for_exit, bool send_sighup, usec_t timeout) {
         int n_children_left;
         sigset_t mask, oldmask;
-        _cleanup_set_free_ Set *pids = NULL;
+        _cleanup_(pids_freep) Hashmap *pids = NULL;
 
         /* Send the specified signal to all remaining processes, if not excluded by ignore_proc().
          * Return:
@@ -262,7 +370,7 @@ int broadcast_signal(int sig, bool wait_for_exit, bool send_sighup, usec_t timeo
          *  - Otherwise, the number of processes to which the specified signal was sent */
 
         if (wait_for_exit)
-                pids = set_new(NULL);
+                pids = hashmap_new(NULL);
 
         assert_se(sigemptyset(&mask) == 0);
         assert_se(sigaddset(&mask, SIGCHLD) == 0);
@@ -415,6 +415,8 @@ Socket.PassSecurity,             config_parse_bool,                  0,
 Socket.PassPacketInfo,           config_parse_bool,                  0,                             offsetof(Socket, pass_pktinfo)
 Socket.TCPCongestion,            config_parse_string,                0,                             offsetof(Socket, tcp_congestion)
 Socket.ReusePort,                config_parse_bool,                  0,                             offsetof(Socket, reuse_port)
+Socket.ReusePortInstances,       config_parse_unsigned,              0,                             offsetof(Socket, reuse_port_instances)
+Socket.ReusePortCPUSteering,     config_parse_bool,                  0,                             offsetof(Socket, reuse_port_cpu_steering)
 Socket.MessageQueueMaxMessages,  config_parse_long,                  0,                             offsetof(Socket, mq_maxmsg)
 Socket.MessageQueueMessageSize,  config_parse_long,                  0,                             offsetof(Socket, mq_msgsize)
 Socket.RemoveOnStop,             config_parse_bool,                  0,                             offsetof(Socket, remove_on_stop)
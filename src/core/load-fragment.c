@@ -5274,6 +5274,8 @@ int unit_load_fragment(Unit *u) {
                                      &u->manager->unit_path_cache);
         if (r < 0)
                 return log_error_errno(r, "Failed to rebuild name map: %m");
+        if (r > 0)
+                manager_prefetch_unit_files(u->manager);
 
         r = unit_file_find_fragment(u->manager->unit_id_map,
                                     u->manager->unit_name_map,
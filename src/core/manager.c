@@ -21,6 +21,7 @@
 
 #include "all-units.h"
 #include "alloc-util.h"
+#include "async.h"
 #include "audit-fd.h"
 #include "boot-timestamps.h"
 #include "bus-common-errors.h"
@@ -45,6 +46,7 @@
 #include "fileio.h"
 #include "fs-util.h"
 #include "generator-setup.h"
+#include "hashed-string.h"
 #include "hashmap.h"
 #include "install.h"
 #include "io-util.h"
@@ -86,6 +88,9 @@
 #define NOTIFY_RCVBUF_SIZE (8*1024*1024)
 #define CGROUPS_AGENT_RCVBUF_SIZE (8*1024*1024)
 
+/* Read up to this many notification datagrams with a single recvmmsg() call */
+#define NOTIFY_BATCH_MAX 16U
+
 /* Initial delay and the interval for printing status messages about running jobs */
 #define JOBS_IN_PROGRESS_WAIT_USEC (2*USEC_PER_SEC)
 #define JOBS_IN_PROGRESS_QUIET_WAIT_USEC (25*USEC_PER_SEC)
@@ -839,7 +844,7 @@ int manager_new(UnitFileScope scope, ManagerTestRunFlags test_run_flags, Manager
         if (r < 0)
                 return r;
 
-        r = hashmap_ensure_allocated(&m->units, &string_hash_ops);
+        r = hashmap_ensure_allocated(&m->units, &hashed_string_hash_ops);
         if (r < 0)
                 return r;
 
@@ -1327,11 +1332,15 @@ static void manager_clear_jobs_and_units(Manager *m) {
 
         assert(m);
 
+        m->clearing_units = true;
+
         while ((u = hashmap_first(m->units)))
                 unit_free(u);
 
         manager_dispatch_cleanup_queue(m);
 
+        m->clearing_units = false;
+
         assert(!m->load_queue);
         assert(prioq_isempty(m->run_queue));
         assert(!m->dbus_unit_queue);
@@ -1376,6 +1385,8 @@ Manager* manager_free(Manager *m) {
 
         hashmap_free(m->units);
         hashmap_free(m->units_by_invocation_id);
+        hashmap_free(m->syscall_filter_cache);
+        specifier_cache_clear(&m->specifier_cache);
         hashmap_free(m->jobs);
         hashmap_free(m->watch_pids);
         hashmap_free(m->watch_bus);
@@ -1393,10 +1404,13 @@ Manager* manager_free(Manager *m) {
         sd_event_source_unref(m->timezone_change_event_source);
         sd_event_source_unref(m->jobs_in_progress_event_source);
         sd_event_source_unref(m->run_queue_event_source);
+        sd_event_source_unref(m->dbus_queue_event_source);
         sd_event_source_unref(m->user_lookup_event_source);
 
         safe_close(m->signal_fd);
         safe_close(m->notify_fd);
+        free(m->notify_batch);
+        trace_done(&m->trace);
         safe_close(m->cgroups_agent_fd);
         safe_close(m->time_change_fd);
         safe_close_pair(m->user_lookup_fds);
@@ -1414,6 +1428,9 @@ Manager* manager_free(Manager *m) {
         strv_free(m->client_environment);
 
         hashmap_free(m->cgroup_unit);
+        hashmap_free(m->pid_cgroup_cache);
+        hashmap_free(m->bpf_access_maps);
+        hashmap_free(m->bpf_device_programs);
         manager_free_unit_name_maps(m);
 
         free(m->switch_root);
@@ -1877,7 +1894,12 @@ Unit *manager_get_unit(Manager *m, const char *name) {
         assert(m);
         assert(name);
 
-        return hashmap_get(m->units, name);
+        /* The keys of the unit hashmap are hashed strings, see unit_add_name(). Names that long can't be
+         * valid, so don't bother copying them. */
+        if (strlen(name) >= UNIT_NAME_MAX)
+                return NULL;
+
+        return hashmap_get(m->units, hashed_string_onstack(name));
 }
 
 static int manager_dispatch_target_deps_queue(Manager *m) {
@@ -1932,10 +1954,21 @@ unsigned manager_dispatch_load_queue(Manager *m) {
          * tries to load its data until the queue is empty */
 
         while ((u = m->load_queue)) {
+                _cleanup_free_ char *id = NULL;
+                usec_t begin;
+
                 assert(u->in_load_queue);
 
+                /* Loading might merge the unit into another one, hence remember its name */
+                begin = manager_trace_begin(m);
+                if (begin > 0)
+                        id = strdup(u->id);
+
                 unit_load(u);
                 n++;
+
+                if (id)
+                        manager_trace_end(m, TRACE_UNIT_LOAD, id, begin);
         }
 
         m->dispatching_load_queue = false;
@@ -1947,6 +1980,84 @@ unsigned manager_dispatch_load_queue(Manager *m) {
         return n;
 }
 
+#define PREFETCH_THREADS 4U
+
+static void *prefetch_unit_files_thread(void *p) {
+        _cleanup_strv_free_ char **paths = p;
+        char **i;
+
+        STRV_FOREACH(i, paths) {
+                _cleanup_close_ int fd = -1;
+
+                fd = open(*i, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NONBLOCK);
+                if (fd < 0)
+                        continue;
+
+                /* Opening the file already brought in its inode, now also get the contents into the page
+                 * cache. Unit files are small, hence just ask for all of it. */
+                (void) readahead(fd, 0, SIZE_MAX);
+        }
+
+        return NULL;
+}
+
+void manager_prefetch_unit_files(Manager *m) {
+        _cleanup_set_free_ Set *seen = NULL;
+        const char *path;
+        size_t n;
+        Iterator i;
+        int r;
+
+        assert(m);
+
+        /* Parsing unit files has to happen on the main thread, as the parsers apply their results to the
+         * units right away. But on a cold cache most of the time loading units is spent waiting for the
+         * inodes and contents of the unit files to be read in, one after the other. Hence, bring all unit
+         * files we know about into the page cache from a few threads in the background, so that this
+         * overlaps with the loading done by the main thread. This is only useful when the files are not
+         * cached yet, i.e. when the system manager starts up during boot, and not on reloads or
+         * reexecution, or for user managers. */
+
+        if (!MANAGER_IS_SYSTEM(m) || MANAGER_IS_TEST_RUN(m) || MANAGER_IS_RELOADING(m))
+                return;
+
+        /* Aliases usually point to the same file */
+        HASHMAP_FOREACH(path, m->unit_id_map, i) {
+                r = set_ensure_put(&seen, &path_hash_ops, path);
+                if (r < 0)
+                        return (void) log_oom();
+        }
+
+        n = set_size(seen);
+
+        for (size_t k = 0; k < MIN(n, PREFETCH_THREADS); k++) {
+                _cleanup_strv_free_ char **paths = NULL;
+                size_t j = 0, c = 0;
+
+                paths = new0(char*, n / PREFETCH_THREADS + 2);
+                if (!paths)
+                        return (void) log_oom();
+
+                SET_FOREACH(path, seen, i) {
+                        if (j++ % PREFETCH_THREADS != k)
+                                continue;
+
+                        paths[c] = strdup(path);
+                        if (!paths[c])
+                                return (void) log_oom();
+                        c++;
+                }
+
+                r = asynchronous_job(prefetch_unit_files_thread, paths);
+                if (r < 0)
+                        return (void) log_debug_errno(r, "Failed to start unit file prefetch thread, ignoring: %m");
+
+                TAKE_PTR(paths);
+        }
+
+        log_debug("Prefetching %zu unit files.", n);
+}
+
 bool manager_unit_file_maybe_loadable_from_cache(Unit *u) {
         assert(u);
 
@@ -2193,6 +2304,10 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
         assert(source);
         assert(m);
 
+        /* Many of the units started in one go typically test the same conditions, cache the results of
+         * those which can't be affected by starting other units for the duration of this. */
+        condition_cache_enable(true);
+
         while ((j = prioq_peek(m->run_queue))) {
                 assert(j->installed);
                 assert(j->in_run_queue);
@@ -2200,6 +2315,8 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
                 (void) job_run_and_invalidate(j);
         }
 
+        condition_cache_enable(false);
+
         if (m->n_running_jobs > 0)
                 manager_watch_jobs_in_progress(m);
 
@@ -2209,6 +2326,51 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
         return 1;
 }
 
+static int manager_dispatch_dbus_queue_timer(sd_event_source *source, usec_t usec, void *userdata) {
+        /* Nothing to do here, manager_loop() flushes the D-Bus queues after each event loop iteration. */
+        return 0;
+}
+
+static int manager_coalesce_dbus_queue(Manager *m) {
+        usec_t next;
+        int r;
+
+        assert(m);
+
+        /* Returns > 0 if flushing the D-Bus queues shall be delayed, in which case a timer has been set up
+         * to wake us up once the coalescing window is over. */
+
+        if (m->dbus_queue_coalesce_usec == 0)
+                return 0;
+
+        next = usec_add(m->dbus_queue_drained_usec, m->dbus_queue_coalesce_usec);
+        if (now(CLOCK_MONOTONIC) >= next)
+                return 0;
+
+        if (m->dbus_queue_event_source) {
+                r = sd_event_source_set_time(m->dbus_queue_event_source, next);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_enabled(m->dbus_queue_event_source, SD_EVENT_ONESHOT);
+                if (r < 0)
+                        return r;
+        } else {
+                r = sd_event_add_time(
+                                m->event,
+                                &m->dbus_queue_event_source,
+                                CLOCK_MONOTONIC,
+                                next, 1,
+                                manager_dispatch_dbus_queue_timer, m);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(m->dbus_queue_event_source, "manager-dbus-queue");
+        }
+
+        return 1;
+}
+
 static unsigned manager_dispatch_dbus_queue(Manager *m) {
         unsigned n = 0, budget;
         Unit *u;
@@ -2230,6 +2392,12 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                 if (manager_bus_n_queued_write(m) > MANAGER_BUS_BUSY_THRESHOLD)
                         return 0;
 
+                /* If configured, don't start flushing the queues again right after they were drained, but
+                 * give units changing state repeatedly a chance to do so before we announce it. Once we
+                 * started, we continue in the next iterations until the queues are empty. */
+                if (m->dbus_queue_drained_usec != USEC_INFINITY && manager_coalesce_dbus_queue(m) > 0)
+                        return 0;
+
                 /* Only process a certain number of units/jobs per event loop iteration. Even if the bus queue wasn't
                  * overly full before this call we shouldn't increase it in size too wildly in one step, and we
                  * shouldn't monopolize CPU time with generating these messages. Note the difference in counting of
@@ -2265,6 +2433,11 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                         budget--;
         }
 
+        /* Remember when we drained the queues, or that we are in the middle of doing so. */
+        if (m->dbus_queue_coalesce_usec > 0)
+                m->dbus_queue_drained_usec = m->dbus_unit_queue || m->dbus_job_queue ?
+                        USEC_INFINITY : now(CLOCK_MONOTONIC);
+
         if (m->send_reloading_done) {
                 m->send_reloading_done = false;
                 bus_manager_send_reloading(m, false);
@@ -2357,24 +2530,18 @@ static void manager_invoke_notify_message(
         }
 }
 
-static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+typedef CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
+                         CMSG_SPACE(sizeof(int) * NOTIFY_FD_MAX)) NotifyControl;
 
-        _cleanup_fdset_free_ FDSet *fds = NULL;
-        Manager *m = userdata;
-        char buf[NOTIFY_BUFFER_MAX+1];
-        struct iovec iovec = {
-                .iov_base = buf,
-                .iov_len = sizeof(buf)-1,
-        };
-        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
-                         CMSG_SPACE(sizeof(int) * NOTIFY_FD_MAX)) control;
-        struct msghdr msghdr = {
-                .msg_iov = &iovec,
-                .msg_iovlen = 1,
-                .msg_control = &control,
-                .msg_controllen = sizeof(control),
-        };
+struct NotifyBatch {
+        struct mmsghdr msgs[NOTIFY_BATCH_MAX];
+        struct iovec iovecs[NOTIFY_BATCH_MAX];
+        NotifyControl controls[NOTIFY_BATCH_MAX];
+        char buffers[NOTIFY_BATCH_MAX][NOTIFY_BUFFER_MAX+1];
+};
 
+static void manager_process_notify_message(Manager *m, char *buf, size_t n, struct msghdr *msghdr) {
+        _cleanup_fdset_free_ FDSet *fds = NULL;
         struct cmsghdr *cmsg;
         struct ucred *ucred = NULL;
         _cleanup_free_ Unit **array_copy = NULL;
@@ -2383,27 +2550,15 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         int r, *fd_array = NULL;
         size_t n_fds = 0;
         bool found = false;
-        ssize_t n;
 
         assert(m);
-        assert(m->notify_fd == fd);
+        assert(buf);
+        assert(msghdr);
 
-        if (revents != EPOLLIN) {
-                log_warning("Got unexpected poll event for notify fd.");
-                return 0;
-        }
-
-        n = recvmsg_safe(m->notify_fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC);
-        if (IN_SET(n, -EAGAIN, -EINTR))
-                return 0; /* Spurious wakeup, try again */
-        if (n < 0)
-                /* If this is any other, real error, then let's stop processing this socket. This of course
-                 * means we won't take notification messages anymore, but that's still better than busy
-                 * looping around this: being woken up over and over again but being unable to actually read
-                 * the message off the socket. */
-                return log_error_errno(n, "Failed to receive notification message: %m");
+        /* Processes a single datagram received on the notification socket. 'buf' must have room for one
+         * more byte than 'n', for the trailing NUL we add. */
 
-        CMSG_FOREACH(cmsg, &msghdr) {
+        CMSG_FOREACH(cmsg, msghdr) {
                 if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
 
                         assert(!fd_array);
@@ -2426,25 +2581,25 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
                 if (r < 0) {
                         close_many(fd_array, n_fds);
                         log_oom();
-                        return 0;
+                        return;
                 }
         }
 
         if (!ucred || !pid_is_valid(ucred->pid)) {
                 log_warning("Received notify message without valid credentials. Ignoring.");
-                return 0;
+                return;
         }
 
-        if ((size_t) n >= sizeof(buf) || (msghdr.msg_flags & MSG_TRUNC)) {
+        if (n > NOTIFY_BUFFER_MAX || (msghdr->msg_flags & MSG_TRUNC)) {
                 log_warning("Received notify message exceeded maximum size. Ignoring.");
-                return 0;
+                return;
         }
 
         /* As extra safety check, let's make sure the string we get doesn't contain embedded NUL bytes. We permit one
          * trailing NUL byte in the message, but don't expect it. */
         if (n > 1 && memchr(buf, 0, n-1)) {
                 log_warning("Received notify message with embedded NUL bytes. Ignoring.");
-                return 0;
+                return;
         }
 
         /* Make sure it's NUL-terminated, then parse it to obtain the tags list */
@@ -2452,18 +2607,18 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         tags = strv_split_newlines(buf);
         if (!tags) {
                 log_oom();
-                return 0;
+                return;
         }
 
         /* possibly a barrier fd, let's see */
         if (manager_process_barrier_fd(tags, fds))
-                return 0;
+                return;
 
         /* Increase the generation counter used for filtering out duplicate unit invocations. */
         m->notifygen++;
 
         /* Notify every unit that might be interested, which might be multiple. */
-        u1 = manager_get_unit_by_pid_cgroup(m, ucred->pid);
+        u1 = manager_get_unit_by_pid_cgroup_cached(m, ucred->pid, true);
         u2 = hashmap_get(m->watch_pids, PID_TO_PTR(ucred->pid));
         array = hashmap_get(m->watch_pids, PID_TO_PTR(-ucred->pid));
         if (array) {
@@ -2497,7 +2652,121 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
 
         if (fdset_size(fds) > 0)
                 log_warning("Got extra auxiliary fds with notification message, closing them.");
+}
+
+static bool notify_message_is_repeat(struct mmsghdr *a, struct mmsghdr *b) {
+        struct ucred *ca, *cb;
+
+        assert(a);
+        assert(b);
+
+        /* Checks whether message 'b' is an exact repetition of message 'a' by the same sender. Processing
+         * such a message again has no effect (think WATCHDOG=1 or an unchanged STATUS= sent in a tight
+         * loop), hence we can skip it, as long as it doesn't carry any fds. */
+
+        if (a->msg_len != b->msg_len)
+                return false;
+        if ((a->msg_hdr.msg_flags | b->msg_hdr.msg_flags) & (MSG_TRUNC|MSG_CTRUNC))
+                return false;
+        if (cmsg_find(&a->msg_hdr, SOL_SOCKET, SCM_RIGHTS, (socklen_t) -1) ||
+            cmsg_find(&b->msg_hdr, SOL_SOCKET, SCM_RIGHTS, (socklen_t) -1))
+                return false;
+
+        ca = CMSG_FIND_DATA(&a->msg_hdr, SOL_SOCKET, SCM_CREDENTIALS, struct ucred);
+        cb = CMSG_FIND_DATA(&b->msg_hdr, SOL_SOCKET, SCM_CREDENTIALS, struct ucred);
+        if (!ca || !cb || memcmp(ca, cb, sizeof(struct ucred)) != 0)
+                return false;
+
+        return memcmp(a->msg_hdr.msg_iov->iov_base, b->msg_hdr.msg_iov->iov_base, a->msg_len) == 0;
+}
+
+static int manager_dispatch_notify_batch(Manager *m, NotifyBatch *b) {
+        int n;
+
+        assert(m);
+        assert(b);
+
+        for (unsigned i = 0; i < NOTIFY_BATCH_MAX; i++) {
+                b->iovecs[i] = IOVEC_MAKE(b->buffers[i], sizeof(b->buffers[i]) - 1);
+                b->msgs[i] = (struct mmsghdr) {
+                        .msg_hdr = {
+                                .msg_iov = b->iovecs + i,
+                                .msg_iovlen = 1,
+                                .msg_control = b->controls + i,
+                                .msg_controllen = sizeof(b->controls[i]),
+                        },
+                };
+        }
+
+        n = recvmmsg(m->notify_fd, b->msgs, NOTIFY_BATCH_MAX, MSG_DONTWAIT|MSG_CMSG_CLOEXEC, NULL);
+        if (n < 0) {
+                if (IN_SET(errno, EAGAIN, EINTR))
+                        return 0; /* Spurious wakeup, try again */
+
+                return log_error_errno(errno, "Failed to receive notification messages: %m");
+        }
+
+        for (int i = 0; i < n; i++) {
+                struct msghdr *msghdr = &b->msgs[i].msg_hdr;
+
+                if (msghdr->msg_flags & MSG_CTRUNC) {
+                        cmsg_close_all(msghdr);
+                        log_warning("Got notification message with truncated control data (too many fds sent?), ignoring.");
+                        continue;
+                }
+
+                if (i > 0 && notify_message_is_repeat(b->msgs + i - 1, b->msgs + i))
+                        continue;
+
+                manager_process_notify_message(m, b->buffers[i], b->msgs[i].msg_len, msghdr);
+        }
+
+        return 0;
+}
+
+static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = userdata;
+        char buf[NOTIFY_BUFFER_MAX+1];
+        struct iovec iovec = {
+                .iov_base = buf,
+                .iov_len = sizeof(buf)-1,
+        };
+        NotifyControl control;
+        struct msghdr msghdr = {
+                .msg_iov = &iovec,
+                .msg_iovlen = 1,
+                .msg_control = &control,
+                .msg_controllen = sizeof(control),
+        };
+        ssize_t n;
+
+        assert(m);
+        assert(m->notify_fd == fd);
+
+        if (revents != EPOLLIN) {
+                log_warning("Got unexpected poll event for notify fd.");
+                return 0;
+        }
+
+        /* Services pinging the watchdog or updating their status frequently can make this socket pretty
+         * busy, hence read as many queued datagrams as we can with a single recvmmsg() call. If we can't
+         * allocate the buffers for that, read them one by one. */
+        if (!m->notify_batch)
+                m->notify_batch = new(NotifyBatch, 1);
+        if (m->notify_batch)
+                return manager_dispatch_notify_batch(m, m->notify_batch);
+
+        n = recvmsg_safe(m->notify_fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC);
+        if (IN_SET(n, -EAGAIN, -EINTR))
+                return 0; /* Spurious wakeup, try again */
+        if (n < 0)
+                /* If this is any other, real error, then let's stop processing this socket. This of course
+                 * means we won't take notification messages anymore, but that's still better than busy
+                 * looping around this: being woken up over and over again but being unable to actually read
+                 * the message off the socket. */
+                return log_error_errno(n, "Failed to receive notification message: %m");
 
+        manager_process_notify_message(m, buf, n, &msghdr);
         return 0;
 }
 
@@ -2549,7 +2818,8 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                 _cleanup_free_ char *name = NULL;
                 Unit *u1, *u2, **array;
 
-                (void) get_process_comm(si.si_pid, &name);
+                if (DEBUG_LOGGING)
+                        (void) get_process_comm(si.si_pid, &name);
 
                 log_debug("Child "PID_FMT" (%s) died (code=%s, status=%i/%s)",
                           si.si_pid, strna(name),
@@ -2563,7 +2833,7 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                 m->sigchldgen++;
 
                 /* And now figure out the unit this belongs to, it might be multiple... */
-                u1 = manager_get_unit_by_pid_cgroup(m, si.si_pid);
+                u1 = manager_get_unit_by_pid_cgroup_cached(m, si.si_pid, false);
                 u2 = hashmap_get(m->watch_pids, PID_TO_PTR(si.si_pid));
                 array = hashmap_get(m->watch_pids, PID_TO_PTR(-si.si_pid));
                 if (array) {
@@ -2596,7 +2866,8 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                                 manager_invoke_sigchld_event(m, array_copy[i], &si);
         }
 
-        /* And now, we actually reap the zombie. */
+        /* And now, we actually reap the zombie. After this the PID may be recycled, hence forget about it. */
+        manager_forget_pid_cgroup(m, si.si_pid);
         if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0) {
                 log_error_errno(errno, "Failed to dequeue child, ignoring: %m");
                 return 0;
@@ -3371,9 +3642,9 @@ static int manager_deserialize_units(Manager *m, FILE *f, FDSet *fds) {
         for (;;) {
                 _cleanup_free_ char *line = NULL;
                 /* Start marker */
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0)
                         break;
 
@@ -3517,9 +3788,9 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
                 _cleanup_free_ char *line = NULL;
                 const char *val, *l;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0)
                         break;
 
@@ -3769,6 +4040,7 @@ int manager_reload(Manager *m) {
         dynamic_user_vacuum(m, false);
         m->uid_refs = hashmap_free(m->uid_refs);
         m->gid_refs = hashmap_free(m->gid_refs);
+        specifier_cache_clear(&m->specifier_cache);
 
         r = lookup_paths_init(&m->lookup_paths, m->unit_file_scope, 0, NULL);
         if (r < 0)
@@ -3820,6 +4092,227 @@ int manager_reload(Manager *m) {
         return 0;
 }
 
+typedef struct IncomingDependency {
+        Unit *other;
+        UnitDependency dependency;
+        UnitDependencyMask mask;
+        size_t target; /* index into the list of reloaded units */
+} IncomingDependency;
+
+static bool unit_changed_on_disk(Manager *m, Unit *u) {
+        _cleanup_set_free_free_ Set *names = NULL;
+        const char *fragment = NULL, *n;
+        Iterator i;
+        int r;
+
+        assert(m);
+        assert(u);
+
+        if (unit_need_daemon_reload(u))
+                return true;
+
+        /* Also catch a different file taking precedence now, and new aliases. Note that unit_need_daemon_reload()
+         * only looks at the files already in use. */
+        r = unit_file_find_fragment(m->unit_id_map, m->unit_name_map, u->id, &fragment, &names);
+        if (r < 0 && r != -ENOENT)
+                return true;
+
+        if (!path_equal_ptr(fragment, u->fragment_path))
+                return true;
+
+        SET_FOREACH(n, names, i)
+                if (!streq(n, u->id) && !set_contains(u->aliases, n))
+                        return true;
+
+        return false;
+}
+
+static bool unit_may_reload_incrementally(Unit *u) {
+        assert(u);
+
+        /* Only units that have no runtime state beyond what is serialized, and that nobody holds a direct
+         * reference to, can be flushed out and loaded again on their own. */
+
+        return !u->job &&
+                !u->nop_job &&
+                !u->perpetual &&
+                !u->transient &&
+                !u->cgroup_path &&
+                !u->refs_by_target &&
+                UNIT_IS_INACTIVE_OR_FAILED(unit_active_state(u));
+}
+
+int manager_reload_incremental(Manager *m) {
+        _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
+        _cleanup_free_ IncomingDependency *incoming = NULL;
+        size_t n_incoming = 0, n_incoming_allocated = 0;
+        _cleanup_set_free_ Set *changed = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        Iterator i;
+        char **name;
+        Unit *u;
+        char *k;
+        int r;
+
+        assert(m);
+
+        /* Reloads only the units whose unit files changed since they were loaded, and retries loading the ones
+         * that were not found. Generators are not run again. Returns 0 if this is not possible because some
+         * changed unit has runtime state that is not covered by its serialization, in which case nothing was
+         * touched and a full manager_reload() needs to be done. Returns > 0 on success. */
+
+        reloading = manager_reloading_start(m);
+
+        r = unit_file_build_name_map(&m->lookup_paths, &m->unit_cache_mtime, &m->unit_id_map, &m->unit_name_map, &m->unit_path_cache);
+        if (r < 0)
+                return log_error_errno(r, "Failed to rebuild name map: %m");
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+
+                /* ignore aliases */
+                if (u->id != k)
+                        continue;
+
+                if (IN_SET(u->load_state, UNIT_STUB, UNIT_MERGED, UNIT_NOT_FOUND))
+                        continue;
+
+                if (!unit_changed_on_disk(m, u))
+                        continue;
+
+                if (!unit_may_reload_incrementally(u)) {
+                        log_unit_debug(u, "Unit file changed, but unit is in use, incremental reload not possible.");
+                        return 0;
+                }
+
+                log_unit_debug(u, "Unit file changed, reloading unit.");
+
+                r = set_ensure_put(&changed, NULL, u);
+                if (r < 0)
+                        return log_oom();
+
+                r = strv_extend(&names, u->id);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        /* Remember the dependencies other units have on the ones we flush out because of their own
+         * configuration, as those would be lost otherwise. And give units that were not found another
+         * chance, like manager_load_unit_prepare() would do. */
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                if (u->id != k || set_contains(changed, u))
+                        continue;
+
+                if (manager_unit_file_maybe_loadable_from_cache(u)) {
+                        u->load_state = UNIT_STUB;
+                        unit_add_to_load_queue(u);
+                }
+
+                for (UnitDependency d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
+                        STRV_FOREACH(name, names) {
+                                UnitDependencyInfo di;
+
+                                di.data = hashmap_get(u->dependencies[d], manager_get_unit(m, *name));
+                                if (di.origin_mask == 0)
+                                        continue;
+
+                                if (!GREEDY_REALLOC(incoming, n_incoming_allocated, n_incoming + 1))
+                                        return log_oom();
+
+                                incoming[n_incoming++] = (IncomingDependency) {
+                                        .other = u,
+                                        .dependency = d,
+                                        .mask = di.origin_mask,
+                                        .target = name - names,
+                                };
+                        }
+        }
+
+        if (strv_isempty(names)) {
+                (void) manager_dispatch_load_queue(m);
+                return 1;
+        }
+
+        r = manager_open_serialization(m, &f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create serialization file: %m");
+
+        fds = fdset_new();
+        if (!fds)
+                return log_oom();
+
+        STRV_FOREACH(name, names) {
+                u = manager_get_unit(m, *name);
+
+                fprintf(f, "%s\n", u->id);
+                r = unit_serialize(u, f, fds, true);
+                if (r < 0)
+                        return r;
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to flush serialization: %m");
+
+        if (fseeko(f, 0, SEEK_SET) < 0)
+                return log_error_errno(errno, "Failed to seek to beginning of serialization: %m");
+
+        /* From here on there is no way back, as with manager_reload(). */
+
+        bus_manager_send_reloading(m, true);
+
+        SET_FOREACH(u, changed, i)
+                unit_free(u);
+        changed = set_free(changed);
+
+        STRV_FOREACH(name, names) {
+                r = manager_load_unit_prepare(m, *name, NULL, NULL, &u);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to prepare loading of unit %s, ignoring: %m", *name);
+                        continue;
+                }
+
+                for (size_t j = 0; j < n_incoming; j++) {
+                        if (incoming[j].target != (size_t) (name - names))
+                                continue;
+
+                        r = unit_add_dependency(incoming[j].other, incoming[j].dependency, u, false, incoming[j].mask);
+                        if (r < 0)
+                                log_unit_warning_errno(incoming[j].other, r, "Failed to restore dependency on %s, ignoring: %m", *name);
+                }
+        }
+
+        (void) manager_dispatch_load_queue(m);
+
+        r = manager_deserialize_units(m, f, fds);
+        if (r < 0)
+                log_warning_errno(r, "Deserialization failed, proceeding anyway: %m");
+
+        STRV_FOREACH(name, names) {
+                u = manager_get_unit(m, *name);
+                if (!u)
+                        continue;
+
+                r = unit_coldplug(u);
+                if (r < 0)
+                        log_unit_warning_errno(u, r, "We couldn't coldplug unit, proceeding anyway: %m");
+        }
+
+        reloading = NULL;
+        assert(m->n_reloading > 0);
+        m->n_reloading--;
+
+        STRV_FOREACH(name, names) {
+                u = manager_get_unit(m, *name);
+                if (u)
+                        unit_catchup(u);
+        }
+
+        m->send_reloading_done = true;
+        return 1;
+}
+
 void manager_reset_failed(Manager *m) {
         Unit *u;
         Iterator i;
@@ -3983,6 +4476,37 @@ static void manager_check_basic_target(Manager *m) {
         log_taint_string(m);
 }
 
+bool manager_trace_enabled(Manager *m) {
+        assert(m);
+
+        /* We only trace the startup phase, so that the buffer isn't filled up with unrelated events by the
+         * time somebody looks at it. */
+        return !MANAGER_IS_FINISHED(m);
+}
+
+usec_t manager_trace_begin(Manager *m) {
+        /* Returns the start time for manager_trace_end(), or 0 if we don't trace anyway */
+        return manager_trace_enabled(m) ? now(CLOCK_MONOTONIC) : 0;
+}
+
+void manager_trace_end(Manager *m, TraceEventType type, const char *name, usec_t begin) {
+        assert(m);
+
+        if (begin == 0 || !manager_trace_enabled(m))
+                return;
+
+        trace_add(&m->trace, type, name, begin, usec_sub_unsigned(now(CLOCK_MONOTONIC), begin));
+}
+
+void manager_trace_instant(Manager *m, TraceEventType type, const char *name) {
+        assert(m);
+
+        if (!manager_trace_enabled(m))
+                return;
+
+        trace_add(&m->trace, type, name, now(CLOCK_MONOTONIC), USEC_INFINITY);
+}
+
 void manager_check_finished(Manager *m) {
         assert(m);
 
@@ -4073,9 +4597,19 @@ static int manager_run_environment_generators(Manager *m) {
         return r;
 }
 
+static void generator_runtime(const char *path, usec_t begin, usec_t duration, void *userdata) {
+        Manager *m = userdata;
+
+        assert(m);
+
+        if (manager_trace_enabled(m))
+                trace_add(&m->trace, TRACE_GENERATOR, basename(path), begin, duration);
+}
+
 static int manager_run_generators(Manager *m) {
         _cleanup_strv_free_ char **paths = NULL;
         const char *argv[5];
+        usec_t begin;
         int r;
 
         assert(m);
@@ -4102,9 +4636,14 @@ static int manager_run_generators(Manager *m) {
         argv[3] = m->lookup_paths.generator_late;
         argv[4] = NULL;
 
+        begin = manager_trace_begin(m);
+
         RUN_WITH_UMASK(0022)
-                (void) execute_directories((const char* const*) paths, DEFAULT_TIMEOUT_USEC, NULL, NULL,
-                                           (char**) argv, m->transient_environment, EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS);
+                (void) execute_directories_full((const char* const*) paths, DEFAULT_TIMEOUT_USEC, NULL, NULL,
+                                                (char**) argv, m->transient_environment, EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS,
+                                                generator_runtime, m);
+
+        manager_trace_end(m, TRACE_GENERATORS, "generators", begin);
 
         r = 0;
 
@@ -25,6 +25,7 @@ typedef struct Unit Unit;
 #define MANAGER_MAX_NAMES 131072 /* 128K */
 
 typedef struct Manager Manager;
+typedef struct NotifyBatch NotifyBatch;
 
 /* An externally visible state. We don't actually maintain this as state variable, but derive it from various fields
  * when requested */
@@ -125,6 +126,8 @@ typedef enum WatchdogType {
 #include "job.h"
 #include "path-lookup.h"
 #include "show-status.h"
+#include "specifier.h"
+#include "trace.h"
 #include "unit-name.h"
 
 typedef enum ManagerTestRunFlags {
@@ -146,6 +149,13 @@ struct Manager {
         /* Active jobs and units */
         Hashmap *units;  /* name string => Unit object n:1 */
         Hashmap *units_by_invocation_id;
+
+        /* Compiled SystemCallFilter= programs, shared between all units with the same filter */
+        Hashmap *syscall_filter_cache;
+
+        /* Host-wide specifier values, looked up on first use and flushed on reload, see unit-printf.c */
+        SpecifierCache specifier_cache;
+
         Hashmap *jobs;   /* job id => Job object 1:1 */
 
         /* To make it easy to iterate through the units of a specific
@@ -165,6 +175,13 @@ struct Manager {
         LIST_HEAD(Unit, dbus_unit_queue);
         LIST_HEAD(Job, dbus_job_queue);
 
+        /* If non-zero, the D-Bus queues are flushed at most once per this time span, so that units and
+         * jobs changing repeatedly in quick succession result in a single change signal. The timestamp
+         * is when the queues were last drained, the event source wakes us up when the window ends. */
+        usec_t dbus_queue_coalesce_usec;
+        usec_t dbus_queue_drained_usec;
+        sd_event_source *dbus_queue_event_source;
+
         /* Units to remove */
         LIST_HEAD(Unit, cleanup_queue);
 
@@ -178,6 +195,9 @@ struct Manager {
         /* Units whose cgroup ran empty */
         LIST_HEAD(Unit, cgroup_empty_queue);
 
+        /* Units whose cgroup.events fired */
+        LIST_HEAD(Unit, cgroup_events_queue);
+
         /* Units whose memory.event fired */
         LIST_HEAD(Unit, cgroup_oom_queue);
 
@@ -209,6 +229,7 @@ struct Manager {
         char *notify_socket;
         int notify_fd;
         sd_event_source *notify_event_source;
+        NotifyBatch *notify_batch;
 
         int cgroups_agent_fd;
         sd_event_source *cgroups_agent_event_source;
@@ -243,6 +264,9 @@ struct Manager {
 
         dual_timestamp timestamps[_MANAGER_TIMESTAMP_MAX];
 
+        /* Events recorded until startup finished, for systemd-analyze trace */
+        Trace trace;
+
         /* Data specific to the device subsystem */
         sd_device_monitor *device_monitor;
         Hashmap *devices_by_sysfs;
@@ -250,6 +274,8 @@ struct Manager {
         /* Data specific to the mount subsystem */
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
+        RateLimit mount_ratelimit;
+        sd_event_source *mount_ratelimit_event_source;
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -285,9 +311,16 @@ struct Manager {
 
         /* Data specific to the cgroup subsystem */
         Hashmap *cgroup_unit;
+        Hashmap *pid_cgroup_cache; /* pid => unit the pid's cgroup belongs to, see manager_get_unit_by_pid_cgroup_cached() */
         CGroupMask cgroup_supported;
         char *cgroup_root;
 
+        /* eBPF LPM trie maps for IPAddressAllow=/IPAddressDeny=, shared between units with the same lists */
+        Hashmap *bpf_access_maps;
+
+        /* Loaded eBPF device control programs, shared between units with the same device policy */
+        Hashmap *bpf_device_programs;
+
         /* Notifications from cgroups, when the unified hierarchy is used is done via inotify. */
         int cgroup_inotify_fd;
         sd_event_source *cgroup_inotify_event_source;
@@ -299,6 +332,7 @@ struct Manager {
 
         /* A defer event for handling cgroup empty events and processing them after SIGCHLD in all cases. */
         sd_event_source *cgroup_empty_event_source;
+        sd_event_source *cgroup_events_event_source;
         sd_event_source *cgroup_oom_event_source;
 
         /* Make sure the user cannot accidentally unmount our cgroup
@@ -316,6 +350,9 @@ struct Manager {
         /* Flags */
         bool dispatching_load_queue:1;
 
+        /* Are we currently freeing all units, because we are shutting down or reloading? */
+        bool clearing_units:1;
+
         bool taint_usr:1;
 
         /* Have we already sent out the READY=1 notification? */
@@ -465,6 +502,7 @@ Unit *manager_get_unit(Manager *m, const char *name);
 int manager_get_job_from_dbus_path(Manager *m, const char *s, Job **_j);
 
 bool manager_unit_file_maybe_loadable_from_cache(Unit *u);
+void manager_prefetch_unit_files(Manager *m);
 int manager_load_unit_prepare(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **_ret);
 int manager_load_unit(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **_ret);
 int manager_load_startable_unit_or_warn(Manager *m, const char *name, const char *path, Unit **ret);
@@ -501,6 +539,7 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root);
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds);
 
 int manager_reload(Manager *m);
+int manager_reload_incremental(Manager *m);
 
 void manager_reset_failed(Manager *m);
 
@@ -511,6 +550,11 @@ bool manager_unit_inactive_or_pending(Manager *m, const char *name);
 
 void manager_check_finished(Manager *m);
 
+bool manager_trace_enabled(Manager *m);
+usec_t manager_trace_begin(Manager *m);
+void manager_trace_end(Manager *m, TraceEventType type, const char *name, usec_t begin);
+void manager_trace_instant(Manager *m, TraceEventType type, const char *name);
+
 void disable_printk_ratelimit(void);
 void manager_recheck_dbus(Manager *m);
 void manager_recheck_journal(Manager *m);
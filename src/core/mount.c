@@ -34,6 +34,10 @@
 
 #define RETRY_UMOUNT_MAX 32
 
+/* Process at most this many mount table changes per interval right away, see mount_dispatch_io() */
+#define MOUNT_RATELIMIT_INTERVAL_USEC (1 * USEC_PER_SEC)
+#define MOUNT_RATELIMIT_BURST 5U
+
 static const UnitActiveState state_translation_table[_MOUNT_STATE_MAX] = {
         [MOUNT_DEAD] = UNIT_INACTIVE,
         [MOUNT_MOUNTING] = UNIT_ACTIVATING,
@@ -1725,6 +1729,7 @@ static int mount_setup_unit(
 static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
         _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
         _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+        _cleanup_set_free_ Set *devices = NULL;
         int r;
 
         assert(m);
@@ -1751,7 +1756,15 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
                 if (!device || !path)
                         continue;
 
-                device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+                /* Validating the device node is not cheap, and with lots of bind mounts the same device
+                 * shows up over and over again, hence do this only once per device. The strings are owned
+                 * by the table, which outlives the set. */
+                if (!set_contains(devices, device)) {
+                        device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+
+                        if (set_ensure_allocated(&devices, &path_hash_ops) >= 0)
+                                (void) set_put(devices, device);
+                }
 
                 (void) mount_setup_unit(m, device, path, options, fstype, set_flags);
         }
@@ -1763,6 +1776,7 @@ static void mount_shutdown(Manager *m) {
         assert(m);
 
         m->mount_event_source = sd_event_source_unref(m->mount_event_source);
+        m->mount_ratelimit_event_source = sd_event_source_unref(m->mount_ratelimit_event_source);
 
         mnt_unref_monitor(m->mount_monitor);
         m->mount_monitor = NULL;
@@ -1865,6 +1879,8 @@ static void mount_enumerate(Manager *m) {
                 }
 
                 (void) sd_event_source_set_description(m->mount_event_source, "mount-monitor-dispatch");
+
+                m->mount_ratelimit = (RateLimit) { .interval = MOUNT_RATELIMIT_INTERVAL_USEC, .burst = MOUNT_RATELIMIT_BURST };
         }
 
         r = mount_load_proc_self_mountinfo(m, false);
@@ -2012,12 +2028,75 @@ static int mount_process_proc_self_mountinfo(Manager *m) {
         return 0;
 }
 
+static int mount_dispatch_ratelimit(sd_event_source *source, usec_t usec, void *userdata) {
+        Manager *m = userdata;
+        int r;
+
+        assert(m);
+
+        /* The rate limit interval is over, resume watching mount changes and catch up with what we missed */
+
+        r = sd_event_source_set_enabled(m->mount_event_source, SD_EVENT_ON);
+        if (r < 0)
+                return log_error_errno(r, "Failed to resume watching mount changes: %m");
+
+        return mount_process_proc_self_mountinfo(m);
+}
+
+static int mount_delay_processing(Manager *m) {
+        usec_t until;
+        int r;
+
+        assert(m);
+
+        /* Stop watching mount changes until the rate limit interval is over. Everything that changes in the
+         * meantime is then picked up with a single rescan. */
+
+        until = usec_add(m->mount_ratelimit.begin, m->mount_ratelimit.interval);
+
+        if (m->mount_ratelimit_event_source) {
+                r = sd_event_source_set_time(m->mount_ratelimit_event_source, until);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_enabled(m->mount_ratelimit_event_source, SD_EVENT_ONESHOT);
+        } else {
+                r = sd_event_add_time(m->event, &m->mount_ratelimit_event_source, CLOCK_MONOTONIC, until, 0, mount_dispatch_ratelimit, m);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_priority(m->mount_ratelimit_event_source, SD_EVENT_PRIORITY_NORMAL-10);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(m->mount_ratelimit_event_source, "mount-monitor-ratelimit");
+        }
+        if (r < 0)
+                return r;
+
+        return sd_event_source_set_enabled(m->mount_event_source, SD_EVENT_OFF);
+}
+
 static int mount_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
         Manager *m = userdata;
+        int r;
 
         assert(m);
         assert(revents & EPOLLIN);
 
+        /* Parsing /proc/self/mountinfo is expensive on systems with many mounts. If mounts change in quick
+         * succession, e.g. while a container with lots of them is set up, don't rescan on each change, but
+         * wait until the rate limit interval is over and then process everything in one go. */
+        if (!ratelimit_below(&m->mount_ratelimit)) {
+                r = mount_delay_processing(m);
+                if (r >= 0) {
+                        log_debug("Mount table changing too quickly, delaying processing.");
+                        return 0;
+                }
+
+                log_warning_errno(r, "Failed to delay processing of mount changes, processing them right away: %m");
+        }
+
         return mount_process_proc_self_mountinfo(m);
 }
 
@@ -953,10 +953,16 @@ static int mount_images(const MountEntry *m) {
                 return log_debug_errno(r, "Failed to load root hash: %m");
         dissect_image_flags |= verity_data ? DISSECT_IMAGE_NO_PARTITION_TABLE : 0;
 
-        r = loop_device_make_by_path(mount_entry_source(m),
-                                     m->read_only ? O_RDONLY : -1 /* < 0 means writable if possible, read-only as fallback */,
-                                     verity_data ? 0 : LO_FLAGS_PARTSCAN,
-                                     &loop_device);
+        /* Read-only images may be shared between many units, hence reuse any existing loop device for them */
+        if (m->read_only)
+                r = loop_device_make_by_path_shared(mount_entry_source(m),
+                                                    verity_data ? 0 : LO_FLAGS_PARTSCAN,
+                                                    &loop_device);
+        else
+                r = loop_device_make_by_path(mount_entry_source(m),
+                                             -1 /* < 0 means writable if possible, read-only as fallback */,
+                                             verity_data ? 0 : LO_FLAGS_PARTSCAN,
+                                             &loop_device);
         if (r < 0)
                 return log_debug_errno(r, "Failed to create loop device for image: %m");
 
@@ -1432,10 +1438,13 @@ int setup_namespace(
                     strv_isempty(read_write_paths))
                         dissect_image_flags |= DISSECT_IMAGE_READ_ONLY;
 
-                r = loop_device_make_by_path(root_image,
-                                             FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_READ_ONLY) ? O_RDONLY : -1 /* < 0 means writable if possible, read-only as fallback */,
-                                             LO_FLAGS_PARTSCAN,
-                                             &loop_device);
+                if (FLAGS_SET(dissect_image_flags, DISSECT_IMAGE_READ_ONLY))
+                        r = loop_device_make_by_path_shared(root_image, LO_FLAGS_PARTSCAN, &loop_device);
+                else
+                        r = loop_device_make_by_path(root_image,
+                                                     -1 /* < 0 means writable if possible, read-only as fallback */,
+                                                     LO_FLAGS_PARTSCAN,
+                                                     &loop_device);
                 if (r < 0)
                         return log_debug_errno(r, "Failed to create loop device for root image: %m");
 
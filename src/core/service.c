@@ -1289,7 +1289,7 @@ static int service_collect_fds(
 
                         sock = SOCKET(u);
 
-                        cn_fds = socket_collect_fds(sock, &cfds);
+                        cn_fds = socket_collect_fds(sock, UNIT(s), &cfds);
                         if (cn_fds < 0)
                                 return cn_fds;
 
@@ -8,6 +8,7 @@
 #include <sys/epoll.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <linux/filter.h>
 #include <linux/sctp.h>
 
 #include "alloc-util.h"
@@ -38,6 +39,7 @@
 #include "socket.h"
 #include "socket-netlink.h"
 #include "special.h"
+#include "stdio-util.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -70,6 +72,9 @@ static const UnitActiveState state_translation_table[_SOCKET_STATE_MAX] = {
         [SOCKET_CLEANING] = UNIT_MAINTENANCE,
 };
 
+/* Upper limit for ReusePortInstances=, to keep the number of listening sockets and service units in check */
+#define REUSE_PORT_INSTANCES_MAX 1024U
+
 static int socket_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int socket_dispatch_timer(sd_event_source *source, usec_t usec, void *userdata);
 
@@ -226,6 +231,103 @@ static int socket_instantiate_service(Socket *s, int cfd) {
                                          false, UNIT_DEPENDENCY_IMPLICIT);
 }
 
+static bool socket_port_is_replicated(const SocketPort *p) {
+        assert(p);
+
+        /* Only for IP sockets the kernel distributes incoming traffic among all sockets bound to the same
+         * address with SO_REUSEPORT. Hence only those are replicated for ReusePortInstances=, all others are
+         * shared by all instances. */
+
+        return p->type == SOCKET_SOCKET &&
+                IN_SET(socket_address_family(&p->address), AF_INET, AF_INET6) &&
+                IN_SET(p->address.type, SOCK_STREAM, SOCK_DGRAM);
+}
+
+static bool socket_port_is_for_instance(const SocketPort *p, unsigned instance) {
+        assert(p);
+
+        return !socket_port_is_replicated(p) || p->instance == instance;
+}
+
+static int socket_add_instance_ports(Socket *s) {
+        SocketPort *p;
+        unsigned i;
+
+        assert(s);
+
+        /* Adds a copy of each replicated port for every instance but the first. The copies are inserted right
+         * after the original, so that the order in the SO_REUSEPORT group of each address matches the instance
+         * number. */
+
+        LIST_FOREACH(port, p, s->ports) {
+                SocketPort *last = p;
+
+                if (p->instance > 0 || !socket_port_is_replicated(p))
+                        continue;
+
+                for (i = 1; i < s->reuse_port_instances; i++) {
+                        SocketPort *c;
+
+                        c = new(SocketPort, 1);
+                        if (!c)
+                                return -ENOMEM;
+
+                        *c = (SocketPort) {
+                                .socket = s,
+                                .type = p->type,
+                                .fd = -1,
+                                .address = p->address,
+                                .instance = i,
+                        };
+
+                        LIST_INSERT_AFTER(port, s->ports, last, c);
+                        last = c;
+                }
+        }
+
+        return 0;
+}
+
+static int socket_add_instance_services(Socket *s) {
+        _cleanup_free_ char *prefix = NULL;
+        Unit *u = UNIT(s);
+        unsigned i;
+        int r;
+
+        assert(s);
+
+        r = unit_name_to_prefix(u->id, &prefix);
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < s->reuse_port_instances; i++) {
+                _cleanup_free_ char *name = NULL;
+                char instance[DECIMAL_STR_MAX(unsigned)];
+                Unit *x;
+
+                xsprintf(instance, "%u", i);
+
+                r = unit_name_build(prefix, instance, ".service", &name);
+                if (r < 0)
+                        return r;
+
+                r = manager_load_unit(u->manager, name, NULL, NULL, &x);
+                if (r < 0)
+                        return r;
+
+                /* The first instance is the one we use wherever a single service is needed, for example to
+                 * determine the SELinux label. */
+                if (i == 0)
+                        unit_ref_set(&s->service, u, x);
+
+                r = unit_add_two_dependencies(u, UNIT_BEFORE, UNIT_TRIGGERS, x, true, UNIT_DEPENDENCY_IMPLICIT);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 static bool have_non_accept_socket(Socket *s) {
         SocketPort *p;
 
@@ -339,7 +441,33 @@ static int socket_add_extras(Socket *s) {
                         s->trigger_limit.burst = 20;
         }
 
-        if (have_non_accept_socket(s)) {
+        if (s->reuse_port_instances > 0) {
+                /* These are checked here rather than in socket_verify(), as they decide which units we load
+                 * below. */
+                if (s->accept) {
+                        log_unit_error(u, "ReusePortInstances= is not supported for accepting sockets. Refusing.");
+                        return -ENOEXEC;
+                }
+
+                if (UNIT_ISSET(s->service)) {
+                        log_unit_error(u, "Explicit service configuration is not supported with ReusePortInstances=. Refusing.");
+                        return -ENOEXEC;
+                }
+
+                if (s->reuse_port_instances > REUSE_PORT_INSTANCES_MAX) {
+                        log_unit_error(u, "ReusePortInstances= must not be larger than %u. Refusing.", REUSE_PORT_INSTANCES_MAX);
+                        return -ENOEXEC;
+                }
+
+                r = socket_add_instance_ports(s);
+                if (r < 0)
+                        return r;
+
+                r = socket_add_instance_services(s);
+                if (r < 0)
+                        return r;
+
+        } else if (have_non_accept_socket(s)) {
 
                 if (!UNIT_DEREF(s->service)) {
                         Unit *x;
@@ -720,6 +848,13 @@ static void socket_dump(Unit *u, FILE *f, const char *prefix) {
                         "%sReusePort: %s\n",
                          prefix, yes_no(s->reuse_port));
 
+        if (s->reuse_port_instances > 0)
+                fprintf(f,
+                        "%sReusePortInstances: %u\n"
+                        "%sReusePortCPUSteering: %s\n",
+                        prefix, s->reuse_port_instances,
+                        prefix, yes_no(s->reuse_port_cpu_steering));
+
         if (s->smack)
                 fprintf(f,
                         "%sSmackLabel: %s\n",
@@ -764,6 +899,10 @@ static void socket_dump(Unit *u, FILE *f, const char *prefix) {
 
         LIST_FOREACH(port, p, s->ports) {
 
+                /* Don't list the copies made for ReusePortInstances= */
+                if (p->instance > 0)
+                        continue;
+
                 switch (p->type) {
                 case SOCKET_SOCKET: {
                         _cleanup_free_ char *k = NULL;
@@ -1497,7 +1636,7 @@ static int socket_address_listen_do(
                         s->backlog,
                         s->bind_ipv6_only,
                         s->bind_to_device,
-                        s->reuse_port,
+                        s->reuse_port || s->reuse_port_instances > 0,
                         s->free_bind,
                         s->transparent,
                         s->directory_mode,
@@ -1634,6 +1773,35 @@ static int socket_address_listen_in_cgroup(
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(Socket *, socket_close_fds);
 
+static void socket_attach_cpu_steering(Socket *s) {
+        SocketPort *p;
+
+        assert(s);
+
+        /* Steer incoming traffic to the socket of the instance with the number of the CPU it arrives on, modulo the
+         * number of instances. The program returns an index into the SO_REUSEPORT group, and sockets are placed
+         * there in the order they were bound, which is the order of our port list. */
+
+        struct sock_filter code[] = {
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU),
+                BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, s->reuse_port_instances),
+                BPF_STMT(BPF_RET | BPF_A, 0),
+        };
+        struct sock_fprog prog = {
+                .len = ELEMENTSOF(code),
+                .filter = code,
+        };
+
+        LIST_FOREACH(port, p, s->ports) {
+                if (p->fd < 0 || p->instance > 0 || !socket_port_is_replicated(p))
+                        continue;
+
+                /* The program applies to the whole group, hence attaching it to the first socket suffices */
+                if (setsockopt(p->fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0)
+                        log_unit_warning_errno(UNIT(s), errno, "Failed to attach CPU steering program to listening socket, ignoring: %m");
+        }
+}
+
 static int socket_open_fds(Socket *_s) {
         _cleanup_(socket_close_fdsp) Socket *s = _s;
         _cleanup_(mac_selinux_freep) char *label = NULL;
@@ -1741,6 +1909,9 @@ static int socket_open_fds(Socket *_s) {
                 }
         }
 
+        if (s->reuse_port_instances > 1 && s->reuse_port_cpu_steering)
+                socket_attach_cpu_steering(s);
+
         s = NULL;
         return 0;
 }
@@ -2349,14 +2520,28 @@ static void socket_enter_running(Socket *s, int cfd) {
                 Iterator i;
                 void *v;
 
-                /* If there's already a start pending don't bother to
-                 * do anything */
-                HASHMAP_FOREACH_KEY(v, other, UNIT(s)->dependencies[UNIT_TRIGGERS], i)
-                        if (unit_active_or_pending(other)) {
-                                pending = true;
-                                break;
+                if (s->reuse_port_instances > 0) {
+                        /* Start every instance that isn't up yet: the kernel distributes incoming traffic
+                         * among all sockets, hence each one needs somebody to process it. */
+                        HASHMAP_FOREACH_KEY(v, other, UNIT(s)->dependencies[UNIT_TRIGGERS], i) {
+                                if (unit_active_or_pending(other))
+                                        continue;
+
+                                r = manager_add_job(UNIT(s)->manager, JOB_START, other, JOB_REPLACE, NULL, &error, NULL);
+                                if (r < 0)
+                                        goto fail;
                         }
 
+                        pending = true;
+                } else
+                        /* If there's already a start pending don't bother to
+                         * do anything */
+                        HASHMAP_FOREACH_KEY(v, other, UNIT(s)->dependencies[UNIT_TRIGGERS], i)
+                                if (unit_active_or_pending(other)) {
+                                        pending = true;
+                                        break;
+                                }
+
                 if (!pending) {
                         if (!UNIT_ISSET(s->service)) {
                                 log_unit_error(UNIT(s), "Service to activate vanished, refusing activation.");
@@ -2740,7 +2925,10 @@ static int socket_deserialize_item(Unit *u, const char *key, const char *value,
                         log_unit_debug(u, "Failed to parse socket value: %s", value);
                 else
                         LIST_FOREACH(port, p, s->ports)
-                                if (socket_address_is(&p->address, value+skip, type)) {
+                                /* With ReusePortInstances= there are multiple ports with the same address, they
+                                 * were serialized in list order, hence fill them in in order too. */
+                                if (p->fd < 0 &&
+                                    socket_address_is(&p->address, value+skip, type)) {
                                         socket_port_take_fd(p, fds, fd);
                                         break;
                                 }
@@ -3201,17 +3389,26 @@ static int socket_dispatch_timer(sd_event_source *source, usec_t usec, void *use
         return 0;
 }
 
-int socket_collect_fds(Socket *s, int **fds) {
+int socket_collect_fds(Socket *s, Unit *service, int **fds) {
+        unsigned instance = 0;
         size_t k = 0, n = 0;
         SocketPort *p;
         int *rfds;
 
         assert(s);
+        assert(service);
         assert(fds);
 
         /* Called from the service code for requesting our fds */
 
+        /* With ReusePortInstances= each instance only gets its own copy of the replicated sockets */
+        if (s->reuse_port_instances > 0 && service->instance)
+                (void) safe_atou(service->instance, &instance);
+
         LIST_FOREACH(port, p, s->ports) {
+                if (!socket_port_is_for_instance(p, instance))
+                        continue;
+
                 if (p->fd >= 0)
                         n++;
                 n += p->n_auxiliary_fds;
@@ -3229,6 +3426,9 @@ int socket_collect_fds(Socket *s, int **fds) {
         LIST_FOREACH(port, p, s->ports) {
                 size_t i;
 
+                if (!socket_port_is_for_instance(p, instance))
+                        continue;
+
                 if (p->fd >= 0)
                         rfds[k++] = p->fd;
                 for (i = 0; i < p->n_auxiliary_fds; ++i)
@@ -3300,6 +3500,29 @@ static void socket_trigger_notify(Unit *u, Unit *other) {
         if (other->job)
                 return;
 
+        if (s->reuse_port_instances > 0) {
+                Unit *t;
+                Iterator i;
+                void *v;
+
+                /* Watch the sockets again as soon as any instance is gone, since nobody processes the traffic
+                 * the kernel steers to its socket anymore. Only stop watching once all of them are up. */
+                if (IN_SET(SERVICE(other)->state,
+                           SERVICE_DEAD, SERVICE_FAILED,
+                           SERVICE_FINAL_SIGTERM, SERVICE_FINAL_SIGKILL,
+                           SERVICE_AUTO_RESTART)) {
+                        socket_enter_listening(s);
+                        return;
+                }
+
+                HASHMAP_FOREACH_KEY(v, t, u->dependencies[UNIT_TRIGGERS], i)
+                        if (t->job || !UNIT_IS_ACTIVE_OR_RELOADING(unit_active_state(t)))
+                                return;
+
+                socket_set_state(s, SOCKET_RUNNING);
+                return;
+        }
+
         if (IN_SET(SERVICE(other)->state,
                    SERVICE_DEAD, SERVICE_FAILED,
                    SERVICE_FINAL_SIGTERM, SERVICE_FINAL_SIGKILL,
@@ -55,6 +55,10 @@ typedef struct SocketPort {
         char *path;
         sd_event_source *event_source;
 
+        /* For ReusePortInstances=: which service instance this copy of the listening socket is passed to. Ports
+         * which are not replicated have this set to 0 and are passed to all instances. */
+        unsigned instance;
+
         LIST_FIELDS(struct SocketPort, port);
 } SocketPort;
 
@@ -136,6 +140,8 @@ struct Socket {
         char *bind_to_device;
         char *tcp_congestion;
         bool reuse_port;
+        unsigned reuse_port_instances;
+        bool reuse_port_cpu_steering;
         long mq_maxmsg;
         long mq_msgsize;
 
@@ -159,7 +165,7 @@ int socket_acquire_peer(Socket *s, int fd, SocketPeer **p);
 DEFINE_TRIVIAL_CLEANUP_FUNC(SocketPeer*, socket_peer_unref);
 
 /* Called from the service code when collecting fds */
-int socket_collect_fds(Socket *s, int **fds);
+int socket_collect_fds(Socket *s, Unit *service, int **fds);
 
 /* Called from the service code when a per-connection service ended */
 void socket_connection_unref(Socket *s);
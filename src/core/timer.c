@@ -383,10 +383,22 @@ static void timer_enter_waiting(Timer *t, bool time_change) {
                                         b = ts.realtime;
                         }
 
-                        r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
-                        if (r < 0)
+                        /* The next elapse only depends on the base, unless the timezone changed, see
+                         * timer_timezone_change(). Timers are recalculated on every clock change, hence
+                         * avoid redoing the calendar arithmetic if nothing changed for this one. */
+                        if (!v->calendar_cached || v->calendar_base != b) {
+                                r = calendar_spec_next_usec(v->calendar_spec, b, &v->calendar_next);
+                                if (r < 0)
+                                        v->calendar_next = USEC_INFINITY;
+
+                                v->calendar_base = b;
+                                v->calendar_cached = true;
+                        }
+                        if (v->calendar_next == USEC_INFINITY)
                                 continue;
 
+                        v->next_elapse = v->calendar_next;
+
                         /* To make the delay due to RandomizedDelaySec= work even at boot, if the scheduled
                          * time has already passed, set the time when systemd first started as the scheduled
                          * time. Note that we base this on the monotonic timestamp of the boot, not the
@@ -819,9 +831,14 @@ static void timer_time_change(Unit *u) {
 
 static void timer_timezone_change(Unit *u) {
         Timer *t = TIMER(u);
+        TimerValue *v;
 
         assert(u);
 
+        /* Calendar events are evaluated in local time, hence forget what we calculated so far */
+        LIST_FOREACH(value, v, t->values)
+                v->calendar_cached = false;
+
         if (t->state != TIMER_WAITING)
                 return;
 
@@ -25,6 +25,12 @@ typedef struct TimerValue {
         CalendarSpec *calendar_spec; /* only for calendar events */
         usec_t next_elapse;
 
+        /* The last result of calendar_spec_next_usec() for this calendar event and the base time it was
+         * calculated from, so that we don't have to calculate it again if the base didn't change */
+        bool calendar_cached;
+        usec_t calendar_base;
+        usec_t calendar_next;
+
         LIST_FIELDS(struct TimerValue, value);
 } TimerValue;
 
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "string-table.h"
+#include "trace.h"
+
+void trace_add(Trace *t, TraceEventType type, const char *name, usec_t timestamp, usec_t duration) {
+        TraceEvent *e;
+        char *n;
+
+        assert(t);
+        assert(type >= 0 && type < _TRACE_EVENT_TYPE_MAX);
+        assert(name);
+
+        /* Tracing is best effort, hence on allocation failures the event is silently dropped */
+
+        if (!t->events) {
+                t->events = new0(TraceEvent, TRACE_EVENTS_MAX);
+                if (!t->events)
+                        return;
+        }
+
+        n = strdup(name);
+        if (!n)
+                return;
+
+        e = t->events + t->next;
+        free(e->name);
+        *e = (TraceEvent) {
+                .type = type,
+                .name = n,
+                .timestamp = timestamp,
+                .duration = duration,
+        };
+
+        t->next = (t->next + 1) % TRACE_EVENTS_MAX;
+        if (t->n_events < TRACE_EVENTS_MAX)
+                t->n_events++;
+}
+
+void trace_done(Trace *t) {
+        size_t i;
+
+        assert(t);
+
+        if (t->events)
+                for (i = 0; i < TRACE_EVENTS_MAX; i++)
+                        free(t->events[i].name);
+
+        t->events = mfree(t->events);
+        t->n_events = t->next = 0;
+}
+
+static const char* const trace_event_type_table[_TRACE_EVENT_TYPE_MAX] = {
+        [TRACE_JOB_ENQUEUE]    = "job-enqueue",
+        [TRACE_JOB_RUN]        = "job-run",
+        [TRACE_UNIT_LOAD]      = "unit-load",
+        [TRACE_CGROUP_REALIZE] = "cgroup-realize",
+        [TRACE_SPAWN]          = "spawn",
+        [TRACE_GENERATORS]     = "generators",
+        [TRACE_GENERATOR]      = "generator",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(trace_event_type, TraceEventType);
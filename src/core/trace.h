@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* A ring buffer of timed events recorded by the manager during boot, for systemd-analyze trace */
+
+typedef enum TraceEventType {
+        TRACE_JOB_ENQUEUE,      /* a job was installed (instant) */
+        TRACE_JOB_RUN,          /* a job from being dispatched until it finished */
+        TRACE_UNIT_LOAD,        /* loading a unit file and its drop-ins */
+        TRACE_CGROUP_REALIZE,   /* creating and configuring a unit's cgroup */
+        TRACE_SPAWN,            /* forking off a unit process, as seen by the manager */
+        TRACE_GENERATORS,       /* running all generators */
+        TRACE_GENERATOR,        /* running a single generator */
+        _TRACE_EVENT_TYPE_MAX,
+        _TRACE_EVENT_TYPE_INVALID = -1,
+} TraceEventType;
+
+typedef struct TraceEvent {
+        TraceEventType type;
+        char *name;
+        usec_t timestamp;       /* CLOCK_MONOTONIC */
+        usec_t duration;        /* USEC_INFINITY for instant events */
+} TraceEvent;
+
+typedef struct Trace {
+        TraceEvent *events;     /* allocated on first use */
+        size_t n_events;        /* number of valid entries */
+        size_t next;            /* where the next event will be stored */
+} Trace;
+
+/* The oldest events are overwritten once this many have been recorded */
+#define TRACE_EVENTS_MAX 16384U
+
+void trace_add(Trace *t, TraceEventType type, const char *name, usec_t timestamp, usec_t duration);
+void trace_done(Trace *t);
+
+/* Returns the i-th event, counting from the oldest one still stored */
+static inline const TraceEvent *trace_get(const Trace *t, size_t i) {
+        assert(t);
+        assert(i < t->n_events);
+
+        return t->events + (t->next + TRACE_EVENTS_MAX - t->n_events + i) % TRACE_EVENTS_MAX;
+}
+
+const char* trace_event_type_to_string(TraceEventType t) _const_;
+TraceEventType trace_event_type_from_string(const char *s) _pure_;
@@ -348,6 +348,16 @@ static char* merge_unit_ids(const char* unit_log_field, char **pairs) {
         return ans;
 }
 
+static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e);
+
+static int transaction_verify_order_follow(Transaction *tr, Job *j, Job *o, UnitDependency d, unsigned generation, sd_bus_error *e) {
+        /* Cut traversing if the job j is not really *before* o. */
+        if (job_compare(j, o, d) >= 0)
+                return 0;
+
+        return transaction_verify_order_one(tr, o, j, generation, e);
+}
+
 static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e) {
         Iterator i;
         Unit *u;
@@ -453,8 +463,41 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
          * ordering dependencies and we test with job_compare() whether it is the 'before' edge in the job
          * execution ordering. */
         for (d = 0; d < ELEMENTSOF(directions); d++) {
-                HASHMAP_FOREACH_KEY(v, u, j->unit->dependencies[directions[d]], i) {
-                        Job *o;
+                Hashmap *deps = j->unit->dependencies[directions[d]];
+                Job *o;
+
+                if (hashmap_size(deps) > hashmap_size(tr->jobs) + hashmap_size(j->manager->jobs)) {
+                        /* Units like targets are often ordered against a huge number of units (think: instances
+                         * of Accept=yes services), most of which have no job at all. For those it is cheaper
+                         * to go through the jobs and look them up among the dependencies instead. Jobs in the
+                         * transaction take precedence over installed ones, like below. */
+
+                        HASHMAP_FOREACH_KEY(o, u, tr->jobs, i) {
+                                if (!hashmap_contains(deps, u))
+                                        continue;
+
+                                r = transaction_verify_order_follow(tr, j, o, directions[d], generation, e);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        HASHMAP_FOREACH(o, j->manager->jobs, i) {
+                                if (o->unit->job != o)
+                                        continue;
+
+                                if (!hashmap_contains(deps, o->unit) ||
+                                    hashmap_contains(tr->jobs, o->unit))
+                                        continue;
+
+                                r = transaction_verify_order_follow(tr, j, o, directions[d], generation, e);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        continue;
+                }
+
+                HASHMAP_FOREACH_KEY(v, u, deps, i) {
 
                         /* Is there a job for this unit? */
                         o = hashmap_get(tr->jobs, u);
@@ -467,11 +510,7 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
                                         continue;
                         }
 
-                        /* Cut traversing if the job j is not really *before* o. */
-                        if (job_compare(j, o, directions[d]) >= 0)
-                                continue;
-
-                        r = transaction_verify_order_one(tr, o, j, generation, e);
+                        r = transaction_verify_order_follow(tr, j, o, directions[d], generation, e);
                         if (r < 0)
                                 return r;
                 }
@@ -808,6 +847,22 @@ int transaction_activate(
         return 0;
 }
 
+static Job* transaction_find_job(Transaction *tr, JobType type, Unit *unit) {
+        Job *j;
+
+        assert(tr);
+        assert(unit);
+
+        LIST_FOREACH(transaction, j, hashmap_get(tr->jobs, unit)) {
+                assert(j->unit == unit);
+
+                if (j->type == type)
+                        return j;
+        }
+
+        return NULL;
+}
+
 static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, bool *is_new) {
         Job *j, *f;
 
@@ -818,18 +873,15 @@ static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, b
          * it doesn't exist it is created and added to the prospective
          * jobs list. */
 
-        f = hashmap_get(tr->jobs, unit);
-
-        LIST_FOREACH(transaction, j, f) {
-                assert(j->unit == unit);
-
-                if (j->type == type) {
-                        if (is_new)
-                                *is_new = false;
-                        return j;
-                }
+        j = transaction_find_job(tr, type, unit);
+        if (j) {
+                if (is_new)
+                        *is_new = false;
+                return j;
         }
 
+        f = hashmap_get(tr->jobs, unit);
+
         j = job_new(unit, type);
         if (!j)
                 return NULL;
@@ -947,6 +999,26 @@ int transaction_add_job_and_dependencies(
         if (by)
                 log_trace("Pulling in %s/%s from %s/%s", unit->id, job_type_to_string(type), by->unit->id, job_type_to_string(by->type));
 
+        /* Every unit/job type pair is expanded only once per transaction. If there's a job for it already,
+         * the unit state has been validated and its dependencies have been pulled in when it was added,
+         * hence all that's left to do is to link it to the job that pulls it in this time. Shared
+         * dependencies (think basic.target or sysinit.target) are referenced by pretty much every job in
+         * a large transaction, so this saves a lot of redundant work. */
+        ret = transaction_find_job(tr, type, unit);
+        if (ret) {
+                ret->ignore_order = ret->ignore_order || ignore_order;
+
+                if (by) {
+                        if (!job_dependency_new(by, ret, matters, conflicts))
+                                return -ENOMEM;
+                } else {
+                        assert(!tr->anchor_job);
+                        tr->anchor_job = ret;
+                }
+
+                return 0;
+        }
+
         /* Safety check that the unit is a valid state, i.e. not in UNIT_STUB or UNIT_MERGED which should only be set
          * temporarily. */
         if (!IN_SET(unit->load_state, UNIT_LOADED, UNIT_ERROR, UNIT_NOT_FOUND, UNIT_BAD_SETTING, UNIT_MASKED))
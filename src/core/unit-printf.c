@@ -171,6 +171,15 @@ static int specifier_special_directory(char specifier, const void *data, const v
         return 0;
 }
 
+static const SpecifierCache *unit_specifier_cache(const Unit *u) {
+        assert(u);
+
+        /* Template-heavy setups expand specifiers a lot while loading units, hence look up the host-wide
+         * values only once per manager, instead of for every expansion. */
+        specifier_cache_populate(&u->manager->specifier_cache);
+        return &u->manager->specifier_cache;
+}
+
 int unit_name_printf(const Unit *u, const char* format, char **ret) {
 
         /*
@@ -196,6 +205,7 @@ int unit_name_printf(const Unit *u, const char* format, char **ret) {
          * %W: the OS variant ID, according to /etc/os-release
          */
 
+        const SpecifierCache *c = unit_specifier_cache(u);
         const Specifier table[] = {
                 { 'n', specifier_string,              u->id },
                 { 'N', specifier_prefix_and_instance, NULL },
@@ -208,15 +218,15 @@ int unit_name_printf(const Unit *u, const char* format, char **ret) {
                 { 'U', specifier_user_id,             NULL },
                 { 'u', specifier_user_name,           NULL },
 
-                { 'm', specifier_machine_id,          NULL },
-                { 'b', specifier_boot_id,             NULL },
+                SPECIFIER_CACHED('m', c->machine_id,      specifier_machine_id),
+                SPECIFIER_CACHED('b', c->boot_id,         specifier_boot_id),
                 { 'H', specifier_host_name,           NULL },
-                { 'v', specifier_kernel_release,      NULL },
-                { 'a', specifier_architecture,        NULL },
-                { 'o', specifier_os_id,               NULL },
-                { 'w', specifier_os_version_id,       NULL },
-                { 'B', specifier_os_build_id,         NULL },
-                { 'W', specifier_os_variant_id,       NULL },
+                SPECIFIER_CACHED('v', c->kernel_release,  specifier_kernel_release),
+                SPECIFIER_CACHED('a', c->architecture,    specifier_architecture),
+                SPECIFIER_CACHED('o', c->os_id,           specifier_os_id),
+                SPECIFIER_CACHED('w', c->os_version_id,   specifier_os_version_id),
+                SPECIFIER_CACHED('B', c->os_build_id,     specifier_os_build_id),
+                SPECIFIER_CACHED('W', c->os_variant_id,   specifier_os_variant_id),
                 {}
         };
 
@@ -259,6 +269,7 @@ int unit_full_printf(const Unit *u, const char *format, char **ret) {
         assert(format);
         assert(ret);
 
+        const SpecifierCache *c = unit_specifier_cache(u);
         const Specifier table[] = {
                 { 'n', specifier_string,                   u->id },
                 { 'N', specifier_prefix_and_instance,      NULL },
@@ -289,11 +300,11 @@ int unit_full_printf(const Unit *u, const char *format, char **ret) {
                 { 'h', specifier_user_home,                NULL },
                 { 's', specifier_user_shell,               NULL },
 
-                { 'm', specifier_machine_id,               NULL },
+                SPECIFIER_CACHED('m', c->machine_id,            specifier_machine_id),
                 { 'H', specifier_host_name,                NULL },
                 { 'l', specifier_short_host_name,          NULL },
-                { 'b', specifier_boot_id,                  NULL },
-                { 'v', specifier_kernel_release,           NULL },
+                SPECIFIER_CACHED('b', c->boot_id,               specifier_boot_id),
+                SPECIFIER_CACHED('v', c->kernel_release,        specifier_kernel_release),
                 {}
         };
 
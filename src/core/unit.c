@@ -10,6 +10,7 @@
 
 #include "all-units.h"
 #include "alloc-util.h"
+#include "bpf-devices.h"
 #include "bpf-firewall.h"
 #include "bus-common-errors.h"
 #include "bus-util.h"
@@ -25,6 +26,7 @@
 #include "fileio.h"
 #include "format-util.h"
 #include "fs-util.h"
+#include "hashed-string.h"
 #include "id128-util.h"
 #include "io-util.h"
 #include "install.h"
@@ -109,12 +111,7 @@ Unit *unit_new(Manager *m, size_t size) {
         u->cgroup_invalidated_mask |= CGROUP_MASK_BPF_FIREWALL;
         u->failure_action_exit_status = u->success_action_exit_status = -1;
 
-        u->ip_accounting_ingress_map_fd = -1;
-        u->ip_accounting_egress_map_fd = -1;
-        u->ipv4_allow_map_fd = -1;
-        u->ipv6_allow_map_fd = -1;
-        u->ipv4_deny_map_fd = -1;
-        u->ipv6_deny_map_fd = -1;
+        u->ip_accounting_map_fd = -1;
 
         u->last_section_private = -1;
 
@@ -204,12 +201,16 @@ static void unit_init(Unit *u) {
                 UNIT_VTABLE(u)->init(u);
 }
 
+/* The aliases are hashed strings, since they are keys of the manager's unit hashmap too. They are looked
+ * up by regular strings in this set however. */
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(unit_alias_hash_ops, char, string_hash_func, string_compare_func, hashed_string_free);
+
 static int unit_add_alias(Unit *u, char *donated_name) {
         int r;
 
         /* Make sure that u->names is allocated. We may leave u->names
          * empty if we fail later, but this is not a problem. */
-        r = set_ensure_allocated(&u->aliases, &string_hash_ops);
+        r = set_ensure_allocated(&u->aliases, &unit_alias_hash_ops);
         if (r < 0)
                 return r;
 
@@ -222,7 +223,8 @@ static int unit_add_alias(Unit *u, char *donated_name) {
 }
 
 int unit_add_name(Unit *u, const char *text) {
-        _cleanup_free_ char *name = NULL, *instance = NULL;
+        _cleanup_(hashed_string_freep) char *name = NULL;
+        _cleanup_free_ char *instance_name = NULL, *instance = NULL;
         UnitType t;
         int r;
 
@@ -234,16 +236,17 @@ int unit_add_name(Unit *u, const char *text) {
                         return log_unit_debug_errno(u, SYNTHETIC_ERRNO(EINVAL),
                                                     "instance is not set when adding name '%s': %m", text);
 
-                r = unit_name_replace_instance(text, u->instance, &name);
+                r = unit_name_replace_instance(text, u->instance, &instance_name);
                 if (r < 0)
                         return log_unit_debug_errno(u, r,
                                                     "failed to build instance name from '%s': %m", text);
-        } else {
-                name = strdup(text);
-                if (!name)
-                        return -ENOMEM;
         }
 
+        /* Unit names are the keys of the manager's unit hashmap, hence are hashed once here */
+        name = hashed_string_new(instance_name ?: text);
+        if (!name)
+                return -ENOMEM;
+
         if (unit_has_name(u, name))
                 return 0;
 
@@ -662,8 +665,10 @@ void unit_free(Unit *u) {
                 bidi_set_free(u, u->dependencies[d]);
 
         /* A unit is being dropped from the tree, make sure our family is realized properly. Do this after we
-         * detach the unit from slice tree in order to eliminate its effect on controller masks. */
-        if (UNIT_ISSET(u->slice))
+         * detach the unit from slice tree in order to eliminate its effect on controller masks. Not if all
+         * units are dropped though: the family is going away too, and walking all members of the slice for
+         * every single unit would make that quadratic in the number of units per slice. */
+        if (UNIT_ISSET(u->slice) && !u->manager->clearing_units)
                 unit_add_family_to_cgroup_realize_queue(UNIT_DEREF(u->slice));
 
         if (u->on_console)
@@ -703,6 +708,12 @@ void unit_free(Unit *u) {
         if (u->in_cgroup_empty_queue)
                 LIST_REMOVE(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
 
+        if (u->in_cgroup_events_queue)
+                LIST_REMOVE(cgroup_events_queue, u->manager->cgroup_events_queue, u);
+
+        if (u->in_cgroup_oom_queue)
+                LIST_REMOVE(cgroup_oom_queue, u->manager->cgroup_oom_queue, u);
+
         if (u->in_cleanup_queue)
                 LIST_REMOVE(cleanup_queue, u->manager->cleanup_queue, u);
 
@@ -712,13 +723,9 @@ void unit_free(Unit *u) {
         if (u->in_stop_when_unneeded_queue)
                 LIST_REMOVE(stop_when_unneeded_queue, u->manager->stop_when_unneeded_queue, u);
 
-        safe_close(u->ip_accounting_ingress_map_fd);
-        safe_close(u->ip_accounting_egress_map_fd);
+        safe_close(u->ip_accounting_map_fd);
 
-        safe_close(u->ipv4_allow_map_fd);
-        safe_close(u->ipv6_allow_map_fd);
-        safe_close(u->ipv4_deny_map_fd);
-        safe_close(u->ipv6_deny_map_fd);
+        bpf_firewall_flush_access_maps(u);
 
         bpf_program_unref(u->ip_bpf_ingress);
         bpf_program_unref(u->ip_bpf_ingress_installed);
@@ -731,6 +738,7 @@ void unit_free(Unit *u) {
         set_free(u->ip_bpf_custom_egress_installed);
 
         bpf_program_unref(u->bpf_device_control_installed);
+        bpf_device_program_unref(u->bpf_device_control_shared);
 
         condition_free_list(u->conditions);
         condition_free_list(u->asserts);
@@ -745,8 +753,8 @@ void unit_free(Unit *u) {
         free(u->job_timeout_reboot_arg);
         free(u->reboot_arg);
 
-        set_free_free(u->aliases);
-        free(u->id);
+        set_free(u->aliases);
+        hashed_string_free(u->id);
 
         free(u);
 }
@@ -836,7 +844,7 @@ static int merge_names(Unit *u, Unit *other) {
         }
 
         TAKE_PTR(other->id);
-        other->aliases = set_free_free(other->aliases);
+        other->aliases = set_free(other->aliases);
 
         SET_FOREACH(name, u->aliases, i)
                 assert_se(hashmap_replace(u->manager->units, name, u) == 0);
@@ -2250,6 +2258,7 @@ static int unit_log_resources(Unit *u) {
         int log_level = LOG_DEBUG; /* May be raised if resources consumed over a threshold */
         size_t n_message_parts = 0, n_iovec = 0;
         char* message_parts[1 + 2 + 2 + 1], *t;
+        uint64_t ip_accounting[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
         nsec_t nsec = NSEC_INFINITY;
         CGroupIPAccountingMetric m;
         size_t i;
@@ -2364,13 +2373,17 @@ static int unit_log_resources(Unit *u) {
                 }
         }
 
+        for (m = 0; m < _CGROUP_IP_ACCOUNTING_METRIC_MAX; m++)
+                ip_accounting[m] = UINT64_MAX;
+
+        (void) unit_get_ip_accounting_all(u, ip_accounting);
+
         for (m = 0; m < _CGROUP_IP_ACCOUNTING_METRIC_MAX; m++) {
                 char buf[FORMAT_BYTES_MAX] = "";
-                uint64_t value = UINT64_MAX;
+                uint64_t value = ip_accounting[m];
 
                 assert(ip_fields[m]);
 
-                (void) unit_get_ip_accounting(u, m, &value);
                 if (value == UINT64_MAX)
                         continue;
 
@@ -3531,6 +3544,7 @@ static const char *const io_accounting_metric_field_last[_CGROUP_IO_ACCOUNTING_M
 };
 
 int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs) {
+        uint64_t ip_accounting[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
         CGroupIPAccountingMetric m;
         int r;
 
@@ -3603,13 +3617,9 @@ int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs) {
 
         bus_track_serialize(u->bus_track, f, "ref");
 
-        for (m = 0; m < _CGROUP_IP_ACCOUNTING_METRIC_MAX; m++) {
-                uint64_t v;
-
-                r = unit_get_ip_accounting(u, m, &v);
-                if (r >= 0)
-                        (void) serialize_item_format(f, ip_accounting_metric_field[m], "%" PRIu64, v);
-        }
+        if (unit_get_ip_accounting_all(u, ip_accounting) >= 0)
+                for (m = 0; m < _CGROUP_IP_ACCOUNTING_METRIC_MAX; m++)
+                        (void) serialize_item_format(f, ip_accounting_metric_field[m], "%" PRIu64, ip_accounting[m]);
 
         if (serialize_jobs) {
                 if (u->job) {
@@ -3664,9 +3674,9 @@ int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
                 ssize_t m;
                 size_t k;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0) /* eof */
                         break;
 
@@ -4001,9 +4011,9 @@ int unit_deserialize_skip(FILE *f) {
                 _cleanup_free_ char *line = NULL;
                 char *l;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0)
                         return 0;
 
@@ -15,6 +15,8 @@
 #include "cgroup.h"
 
 typedef struct UnitRef UnitRef;
+typedef struct BPFAccessMap BPFAccessMap;
+typedef struct BPFDeviceProgram BPFDeviceProgram;
 
 typedef enum KillOperation {
         KILL_TERMINATE,
@@ -207,6 +209,9 @@ typedef struct Unit {
         /* cgroup empty queue */
         LIST_FIELDS(Unit, cgroup_empty_queue);
 
+        /* cgroup.events queue */
+        LIST_FIELDS(Unit, cgroup_events_queue);
+
         /* cgroup OOM queue */
         LIST_FIELDS(Unit, cgroup_oom_queue);
 
@@ -269,6 +274,7 @@ typedef struct Unit {
         CGroupMask cgroup_enabled_mask;            /* Which controllers are enabled (or more correctly: enabled for the children) for this unit's cgroup? (only relevant on cgroup v2) */
         CGroupMask cgroup_invalidated_mask;        /* A mask specifying controllers which shall be considered invalidated, and require re-realization */
         CGroupMask cgroup_members_mask;            /* A cache for the controllers required by all children of this cgroup (only relevant for slice units) */
+        Hashmap *cgroup_attributes;                /* attribute name → value we last wrote to it */
 
         /* Inotify watch descriptors for watching cgroup.events and memory.events on cgroupv2 */
         int cgroup_control_inotify_wd;
@@ -276,15 +282,15 @@ typedef struct Unit {
 
         /* Device Controller BPF program */
         BPFProgram *bpf_device_control_installed;
+        BPFDeviceProgram *bpf_device_control_shared; /* kernel program, shared between units with the same policy */
 
         /* IP BPF Firewalling/accounting */
-        int ip_accounting_ingress_map_fd;
-        int ip_accounting_egress_map_fd;
+        int ip_accounting_map_fd; /* a single element, with one counter per CGroupIPAccountingMetric */
 
-        int ipv4_allow_map_fd;
-        int ipv6_allow_map_fd;
-        int ipv4_deny_map_fd;
-        int ipv6_deny_map_fd;
+        BPFAccessMap *ipv4_allow_map;
+        BPFAccessMap *ipv6_allow_map;
+        BPFAccessMap *ipv4_deny_map;
+        BPFAccessMap *ipv6_deny_map;
 
         BPFProgram *ip_bpf_ingress, *ip_bpf_ingress_installed;
         BPFProgram *ip_bpf_egress, *ip_bpf_egress_installed;
@@ -344,6 +350,7 @@ typedef struct Unit {
         bool in_gc_queue:1;
         bool in_cgroup_realize_queue:1;
         bool in_cgroup_empty_queue:1;
+        bool in_cgroup_events_queue:1;
         bool in_cgroup_oom_queue:1;
         bool in_target_deps_queue:1;
         bool in_stop_when_unneeded_queue:1;
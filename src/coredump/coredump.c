@@ -380,7 +380,9 @@ static int save_external_coredump(
         if (fd < 0)
                 return log_error_errno(fd, "Failed to create temporary file for coredump %s: %m", fn);
 
-        r = copy_bytes(input_fd, fd, max_size, 0);
+        /* Cores tend to contain a lot of zero pages, which the kernel writes out in full into the pipe. Store
+         * them as holes, that saves disk space and IO both here and when reading the core back in. */
+        r = copy_bytes(input_fd, fd, max_size, COPY_SPARSE);
         if (r < 0) {
                 log_error_errno(r, "Cannot store coredump of %s (%s): %m",
                                 context->meta[META_ARGV_PID], context->meta[META_COMM]);
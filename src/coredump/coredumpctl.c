@@ -658,6 +658,47 @@ static int print_entry(sd_journal *j, unsigned n_found, bool verb_is_info) {
                 return print_list(stdout, j, n_found);
 }
 
+static const char* const list_fields[] = {
+        "MESSAGE_ID",
+        "COREDUMP_PID",
+        "COREDUMP_UID",
+        "COREDUMP_GID",
+        "COREDUMP_SIGNAL",
+        "COREDUMP_EXE",
+        "COREDUMP_COMM",
+        "COREDUMP_CMDLINE",
+        "COREDUMP_FILENAME",
+        "COREDUMP_TRUNCATED",
+        "COREDUMP",
+        NULL
+};
+
+static const char* const info_fields[] = {
+        "MESSAGE_ID",
+        "COREDUMP_PID",
+        "COREDUMP_UID",
+        "COREDUMP_GID",
+        "COREDUMP_SIGNAL",
+        "COREDUMP_EXE",
+        "COREDUMP_COMM",
+        "COREDUMP_CMDLINE",
+        "COREDUMP_UNIT",
+        "COREDUMP_USER_UNIT",
+        "COREDUMP_SESSION",
+        "COREDUMP_OWNER_UID",
+        "COREDUMP_SLICE",
+        "COREDUMP_CGROUP",
+        "COREDUMP_TIMESTAMP",
+        "COREDUMP_FILENAME",
+        "COREDUMP_TRUNCATED",
+        "COREDUMP",
+        "_BOOT_ID",
+        "_MACHINE_ID",
+        "_HOSTNAME",
+        "MESSAGE",
+        NULL
+};
+
 static int dump_list(int argc, char **argv, void *userdata) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
         unsigned n_found = 0;
@@ -677,6 +718,18 @@ static int dump_list(int argc, char **argv, void *userdata) {
          * pick a fairly low data threshold here */
         sd_journal_set_data_threshold(j, 4096);
 
+        /* Coredump entries carry large fields we never show here (the environment, the memory maps, the core
+         * itself), hence tell the journal to skip over everything we don't show, so that it doesn't have to
+         * decompress them only for us to throw them away again. */
+        if (verb_is_info)
+                r = sd_journal_set_data_fields(j, (const char**) info_fields);
+        else if (arg_field)
+                r = sd_journal_set_data_fields(j, (const char**) STRV_MAKE(arg_field));
+        else
+                r = sd_journal_set_data_fields(j, (const char**) list_fields);
+        if (r < 0)
+                log_debug_errno(r, "Failed to restrict enumerated journal fields, ignoring: %m");
+
         /* "info" without pattern implies "-1" */
         if (arg_one || (verb_is_info && argc == 1)) {
                 r = focus(j);
@@ -22,6 +22,7 @@
 #include "homework-mount.h"
 #include "id128-util.h"
 #include "io-util.h"
+#include "ioprio.h"
 #include "memory-util.h"
 #include "missing_magic.h"
 #include "mkdir.h"
@@ -35,6 +36,7 @@
 #include "resize-fs.h"
 #include "stat-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "tmpfile-util.h"
 
 /* Round down to the nearest 1K size. Note that Linux generally handles block devices with 512 blocks only,
@@ -1142,10 +1144,14 @@ int home_prepare_luks(
                         goto fail;
                 }
         } else {
+                char ts_loop[FORMAT_TIMESPAN_MAX], ts_luks[FORMAT_TIMESPAN_MAX], ts_fsck[FORMAT_TIMESPAN_MAX], ts_mount[FORMAT_TIMESPAN_MAX];
                 _cleanup_free_ char *fstype = NULL, *subdir = NULL;
+                usec_t t_start, t_loop, t_luks, t_fsck, t_mount;
                 const char *ip;
                 struct stat st;
 
+                t_start = now(CLOCK_MONOTONIC);
+
                 ip = force_image_path ?: user_record_image_path(h);
 
                 subdir = path_join("/run/systemd/user-home-mount/", user_record_user_name_and_realm(h));
@@ -1187,6 +1193,8 @@ int home_prepare_luks(
 
                 log_info("Setting up loopback device %s completed.", loop->node ?: ip);
 
+                t_loop = now(CLOCK_MONOTONIC);
+
                 r = luks_setup(loop->node ?: ip,
                                setup->dm_name,
                                h->luks_uuid,
@@ -1209,13 +1217,24 @@ int home_prepare_luks(
                 if (r < 0)
                         goto fail;
 
+                t_luks = now(CLOCK_MONOTONIC);
+
                 r = fs_validate(setup->dm_node, h->file_system_uuid, &fstype, &found_fs_uuid);
                 if (r < 0)
                         goto fail;
 
-                r = run_fsck(setup->dm_node, fstype);
-                if (r < 0)
-                        goto fail;
+                /* If we were able to set the dirty flag just now, then it wasn't set before, i.e. the image
+                 * was cleanly deactivated the last time it was used. In that case the file system check is
+                 * a waste of time, skip it. */
+                if (marked_dirty)
+                        log_info("Image was deactivated cleanly, skipping file system check.");
+                else {
+                        r = run_fsck(setup->dm_node, fstype);
+                        if (r < 0)
+                                goto fail;
+                }
+
+                t_fsck = now(CLOCK_MONOTONIC);
 
                 r = home_unshare_and_mount(setup->dm_node, fstype, user_record_luks_discard(h), user_record_mount_flags(h));
                 if (r < 0)
@@ -1223,6 +1242,14 @@ int home_prepare_luks(
 
                 mounted = true;
 
+                t_mount = now(CLOCK_MONOTONIC);
+
+                log_info("Activation phases took: loopback %s, LUKS %s, file system check %s, mount %s.",
+                         format_timespan(ts_loop, sizeof(ts_loop), t_loop - t_start, USEC_PER_MSEC),
+                         format_timespan(ts_luks, sizeof(ts_luks), t_luks - t_loop, USEC_PER_MSEC),
+                         format_timespan(ts_fsck, sizeof(ts_fsck), t_fsck - t_luks, USEC_PER_MSEC),
+                         format_timespan(ts_mount, sizeof(ts_mount), t_mount - t_fsck, USEC_PER_MSEC));
+
                 root_fd = open(subdir, O_RDONLY|O_CLOEXEC|O_DIRECTORY|O_NOFOLLOW);
                 if (root_fd < 0) {
                         r = log_error_errno(r, "Failed to open home directory: %m");
@@ -1419,6 +1446,8 @@ int home_deactivate_luks(UserRecord *h) {
 }
 
 int home_trim_luks(UserRecord *h) {
+        int ioprio;
+
         assert(h);
 
         if (!user_record_luks_offline_discard(h)) {
@@ -1426,7 +1455,19 @@ int home_trim_luks(UserRecord *h) {
                 return 0;
         }
 
+        /* Trimming a large file system on logout might issue a lot of discard requests. Do this at the
+         * lowest best-effort I/O priority, so that we don't slow down other users of the same backing
+         * storage. (We don't use the idle class here, since that might starve us indefinitely and hence
+         * block the logout.) */
+        ioprio = ioprio_get(IOPRIO_WHO_PROCESS, 0);
+        if (ioprio_set(IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 7)) < 0)
+                log_debug_errno(errno, "Failed to lower I/O priority for trimming, ignoring: %m");
+
         (void) run_fitrim_by_path(user_record_home_directory(h));
+
+        if (ioprio >= 0)
+                (void) ioprio_set(IOPRIO_WHO_PROCESS, 0, ioprio);
+
         return 0;
 }
 
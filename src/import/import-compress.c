@@ -4,6 +4,14 @@
 #include "string-table.h"
 #include "util.h"
 
+/* Upper bound for the number of compression threads. Each xz thread needs a couple of dozen MB of memory
+ * for its block buffers, hence don't go overboard on machines with many CPUs. */
+#define IMPORT_COMPRESS_THREADS_MAX 8U
+
+static uint32_t compress_threads(void) {
+        return CLAMP(lzma_cputhreads(), 1U, IMPORT_COMPRESS_THREADS_MAX);
+}
+
 void import_compress_free(ImportCompress *c) {
         assert(c);
 
@@ -20,6 +28,13 @@ void import_compress_free(ImportCompress *c) {
                         BZ2_bzCompressEnd(&c->bzip2);
                 else
                         BZ2_bzDecompressEnd(&c->bzip2);
+#endif
+#if HAVE_ZSTD
+        } else if (c->type == IMPORT_COMPRESS_ZSTD) {
+                if (c->encoding)
+                        ZSTD_freeCCtx(c->zstd_cctx);
+                else
+                        ZSTD_freeDCtx(c->zstd_dctx);
 #endif
         }
 
@@ -36,6 +51,9 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
         static const uint8_t bzip2_signature[] = {
                 'B', 'Z', 'h'
         };
+        static const uint8_t zstd_signature[] = {
+                0x28, 0xb5, 0x2f, 0xfd
+        };
 
         int r;
 
@@ -44,9 +62,10 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
         if (c->type != IMPORT_COMPRESS_UNKNOWN)
                 return 1;
 
-        if (size < MAX3(sizeof(xz_signature),
-                        sizeof(gzip_signature),
-                        sizeof(bzip2_signature)))
+        if (size < MAX(MAX3(sizeof(xz_signature),
+                            sizeof(gzip_signature),
+                            sizeof(bzip2_signature)),
+                       sizeof(zstd_signature)))
                 return 0;
 
         assert(data);
@@ -74,6 +93,14 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
                         return -EIO;
 
                 c->type = IMPORT_COMPRESS_BZIP2;
+#endif
+#if HAVE_ZSTD
+        } else if (memcmp(data, zstd_signature, sizeof(zstd_signature)) == 0) {
+                c->zstd_dctx = ZSTD_createDCtx();
+                if (!c->zstd_dctx)
+                        return -ENOMEM;
+
+                c->type = IMPORT_COMPRESS_ZSTD;
 #endif
         } else
                 c->type = IMPORT_COMPRESS_UNCOMPRESSED;
@@ -176,6 +203,39 @@ int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCo
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {
+                        .src = data,
+                        .size = size,
+                };
+
+                for (;;) {
+                        uint8_t buffer[16 * 1024];
+                        ZSTD_outBuffer output = {
+                                .dst = buffer,
+                                .size = sizeof(buffer),
+                        };
+                        size_t k;
+
+                        k = ZSTD_decompressStream(c->zstd_dctx, &output, &input);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        r = callback(buffer, output.pos, userdata);
+                        if (r < 0)
+                                return r;
+
+                        /* If the output buffer was filled completely, there might be more data pending in
+                         * the decoder, even if all input was consumed. */
+                        if (input.pos >= input.size && output.pos < output.size)
+                                break;
+                }
+
+                break;
+        }
+#endif
+
         default:
                 assert_not_reached("Unknown compression");
         }
@@ -191,9 +251,20 @@ int import_compress_init(ImportCompress *c, ImportCompressType t) {
         switch (t) {
 
         case IMPORT_COMPRESS_XZ: {
+                lzma_mt mt = {
+                        .threads = compress_threads(),
+                        .preset = LZMA_PRESET_DEFAULT,
+                        .check = LZMA_CHECK_CRC64,
+                };
                 lzma_ret xzr;
 
-                xzr = lzma_easy_encoder(&c->xz, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
+                /* The multi-threaded encoder splits the stream into independently compressed blocks, which
+                 * any xz decoder can read. Use the plain encoder if there's only one CPU anyway, as it
+                 * generates a slightly smaller stream. */
+                if (mt.threads > 1)
+                        xzr = lzma_stream_encoder_mt(&c->xz, &mt);
+                else
+                        xzr = lzma_easy_encoder(&c->xz, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
                 if (xzr != LZMA_OK)
                         return -EIO;
 
@@ -219,6 +290,20 @@ int import_compress_init(ImportCompress *c, ImportCompressType t) {
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD:
+                c->zstd_cctx = ZSTD_createCCtx();
+                if (!c->zstd_cctx)
+                        return -ENOMEM;
+
+                /* This fails if libzstd was built without multi-threading support, in which case we
+                 * simply compress in the calling thread. */
+                (void) ZSTD_CCtx_setParameter(c->zstd_cctx, ZSTD_c_nbWorkers, compress_threads());
+
+                c->type = IMPORT_COMPRESS_ZSTD;
+                break;
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
                 c->type = IMPORT_COMPRESS_UNCOMPRESSED;
                 break;
@@ -339,6 +424,37 @@ int import_compress(ImportCompress *c, const void *data, size_t size, void **buf
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {
+                        .src = data,
+                        .size = size,
+                };
+
+                while (input.pos < input.size) {
+                        ZSTD_outBuffer output;
+                        size_t k;
+
+                        r = enlarge_buffer(buffer, buffer_size, buffer_allocated);
+                        if (r < 0)
+                                return r;
+
+                        output = (ZSTD_outBuffer) {
+                                .dst = (uint8_t*) *buffer + *buffer_size,
+                                .size = *buffer_allocated - *buffer_size,
+                        };
+
+                        k = ZSTD_compressStream2(c->zstd_cctx, &output, &input, ZSTD_e_continue);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        *buffer_size += output.pos;
+                }
+
+                break;
+        }
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
 
                 if (*buffer_allocated < size) {
@@ -443,6 +559,35 @@ int import_compress_finish(ImportCompress *c, void **buffer, size_t *buffer_size
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {};
+                size_t k;
+
+                do {
+                        ZSTD_outBuffer output;
+
+                        r = enlarge_buffer(buffer, buffer_size, buffer_allocated);
+                        if (r < 0)
+                                return r;
+
+                        output = (ZSTD_outBuffer) {
+                                .dst = (uint8_t*) *buffer + *buffer_size,
+                                .size = *buffer_allocated - *buffer_size,
+                        };
+
+                        /* Returns the number of bytes still to flush, i.e. 0 once the frame is complete */
+                        k = ZSTD_compressStream2(c->zstd_cctx, &output, &input, ZSTD_e_end);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        *buffer_size += output.pos;
+                } while (k != 0);
+
+                break;
+        }
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
                 break;
 
@@ -461,6 +606,9 @@ static const char* const import_compress_type_table[_IMPORT_COMPRESS_TYPE_MAX] =
 #if HAVE_BZIP2
         [IMPORT_COMPRESS_BZIP2] = "bzip2",
 #endif
+#if HAVE_ZSTD
+        [IMPORT_COMPRESS_ZSTD] = "zstd",
+#endif
 };
 
 DEFINE_STRING_TABLE_LOOKUP(import_compress_type, ImportCompressType);
@@ -1,9 +1,11 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <fcntl.h>
 #include <zlib.h>
 
 #include "alloc-util.h"
 #include "btrfs-util.h"
+#include "missing_syscall.h"
 #include "qcow2-util.h"
 #include "sparse-endian.h"
 #include "util.h"
@@ -61,30 +63,63 @@ static uint32_t HEADER_HEADER_LENGTH(const Header *h) {
         return be32toh(h->header_length);
 }
 
-static int copy_cluster(
+static int copy_clusters(
                 int sfd, uint64_t soffset,
                 int dfd, uint64_t doffset,
+                uint64_t size,
                 uint64_t cluster_size,
                 void *buffer) {
 
         ssize_t l;
         int r;
 
-        r = btrfs_clone_range(sfd, soffset, dfd, doffset, cluster_size);
+        /* Copies a run of clusters that are contiguous both in the source and in the destination. Tries a
+         * reflink first, then copy_file_range(), and finally falls back to copying cluster by cluster. */
+
+        r = btrfs_clone_range(sfd, soffset, dfd, doffset, size);
         if (r >= 0)
                 return r;
 
-        l = pread(sfd, buffer, cluster_size, soffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+        while (size > 0) {
+                loff_t si = soffset, di = doffset;
 
-        l = pwrite(dfd, buffer, cluster_size, doffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+                l = copy_file_range(sfd, &si, dfd, &di, size, 0);
+                if (l < 0) {
+                        if (!IN_SET(errno, EINVAL, ENOSYS, EXDEV, EBADF, EOPNOTSUPP))
+                                return -errno;
+
+                        break; /* use fallback below */
+                }
+                if (l == 0)
+                        return -EIO;
+
+                soffset += l;
+                doffset += l;
+                size -= l;
+        }
+
+        while (size > 0) {
+                uint64_t n;
+
+                /* copy_file_range() might have copied a partial cluster */
+                n = MIN(size, cluster_size);
+
+                l = pread(sfd, buffer, n, soffset);
+                if (l < 0)
+                        return -errno;
+                if ((uint64_t) l != n)
+                        return -EIO;
+
+                l = pwrite(dfd, buffer, n, doffset);
+                if (l < 0)
+                        return -errno;
+                if ((uint64_t) l != n)
+                        return -EIO;
+
+                soffset += n;
+                doffset += n;
+                size -= n;
+        }
 
         return 0;
 }
@@ -229,6 +264,7 @@ static int verify_header(const Header *header) {
 int qcow2_convert(int qcow2_fd, int raw_fd) {
         _cleanup_free_ void *buffer1 = NULL, *buffer2 = NULL;
         _cleanup_free_ be64_t *l1_table = NULL, *l2_table = NULL;
+        uint64_t run_src = 0, run_dst = 0, run_size = 0;
         uint64_t sz, i;
         Header header;
         ssize_t l;
@@ -267,6 +303,9 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
         if (ftruncate(raw_fd, HEADER_SIZE(&header)) < 0)
                 return -errno;
 
+        /* Clusters are usually laid out in order, hence tell the kernel to read ahead */
+        (void) posix_fadvise(qcow2_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
         sz = sizeof(uint64_t) * HEADER_L1_SIZE(&header);
         l = pread(qcow2_fd, l1_table, sz, HEADER_L1_TABLE_OFFSET(&header));
         if (l < 0)
@@ -301,22 +340,51 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
                         if (r == 0)
                                 continue;
 
-                        if (compressed)
+                        /* If this cluster directly continues the current run, both in the source and in
+                         * the destination, just extend the run, and copy it in one go later. */
+                        if (!compressed && run_size > 0 &&
+                            data_begin == run_src + run_size &&
+                            p == run_dst + run_size) {
+                                run_size += HEADER_CLUSTER_SIZE(&header);
+                                continue;
+                        }
+
+                        if (run_size > 0) {
+                                r = copy_clusters(
+                                                qcow2_fd, run_src,
+                                                raw_fd, run_dst,
+                                                run_size, HEADER_CLUSTER_SIZE(&header), buffer1);
+                                if (r < 0)
+                                        return r;
+
+                                run_size = 0;
+                        }
+
+                        if (compressed) {
                                 r = decompress_cluster(
                                                 qcow2_fd, data_begin,
                                                 raw_fd, p,
                                                 compressed_size, HEADER_CLUSTER_SIZE(&header),
                                                 buffer1, buffer2);
-                        else
-                                r = copy_cluster(
-                                                qcow2_fd, data_begin,
-                                                raw_fd, p,
-                                                HEADER_CLUSTER_SIZE(&header), buffer1);
-                        if (r < 0)
-                                return r;
+                                if (r < 0)
+                                        return r;
+                        } else {
+                                run_src = data_begin;
+                                run_dst = p;
+                                run_size = HEADER_CLUSTER_SIZE(&header);
+                        }
                 }
         }
 
+        if (run_size > 0) {
+                r = copy_clusters(
+                                qcow2_fd, run_src,
+                                raw_fd, run_dst,
+                                run_size, HEADER_CLUSTER_SIZE(&header), buffer1);
+                if (r < 0)
+                        return r;
+        }
+
         return 0;
 }
 
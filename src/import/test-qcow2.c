@@ -7,9 +7,12 @@
 #include "fd-util.h"
 #include "log.h"
 #include "qcow2-util.h"
+#include "time-util.h"
 
 int main(int argc, char *argv[]) {
         _cleanup_close_ int sfd = -1, dfd = -1;
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t start;
         int r;
 
         if (argc != 3) {
@@ -29,11 +32,15 @@ int main(int argc, char *argv[]) {
                 return EXIT_FAILURE;
         }
 
+        start = now(CLOCK_MONOTONIC);
+
         r = qcow2_convert(sfd, dfd);
         if (r < 0) {
                 log_error_errno(r, "Failed to unpack: %m");
                 return EXIT_FAILURE;
         }
 
+        log_info("Conversion took %s.", format_timespan(ts, sizeof(ts), now(CLOCK_MONOTONIC) - start, USEC_PER_MSEC));
+
         return EXIT_SUCCESS;
 }
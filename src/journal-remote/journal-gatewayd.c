@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <microhttpd.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -18,6 +20,7 @@
 #include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "hashmap.h"
 #include "hostname-util.h"
 #include "log.h"
 #include "logs-show.h"
@@ -27,11 +30,19 @@
 #include "parse-util.h"
 #include "pretty-print.h"
 #include "sigbus.h"
+#include "strv.h"
 #include "tmpfile-util.h"
 #include "util.h"
 
 #define JOURNAL_WAIT_TIMEOUT (10*USEC_PER_SEC)
 
+/* How many idle journals to keep open for reuse by later requests */
+#define JOURNAL_POOL_MAX 16
+
+/* Responses to bounded requests starting at a cursor that we keep around */
+#define RANGE_CACHE_MAX 64
+#define RANGE_CACHE_SIZE_MAX (256U*1024U)
+
 static char *arg_key_pem = NULL;
 static char *arg_cert_pem = NULL;
 static char *arg_trust_pem = NULL;
@@ -61,8 +72,33 @@ typedef struct RequestMeta {
 
         uint64_t n_fields;
         bool n_fields_set;
+
+        /* Set if the response may be stored in the range cache, which it is once it is complete */
+        char *cache_key;
+        char *cache_data;
+        size_t cache_size, cache_allocated;
 } RequestMeta;
 
+typedef struct RangeCacheEntry {
+        char *key;
+        char *data;
+        size_t size;
+} RangeCacheEntry;
+
+static pthread_mutex_t journal_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static sd_journal *journal_pool[JOURNAL_POOL_MAX];
+static size_t journal_pool_n = 0;
+
+static pthread_mutex_t range_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static OrderedHashmap *range_cache = NULL;
+
+/* A single thread waits for changes of the journal and wakes up all followers. */
+static pthread_once_t follow_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t follow_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t follow_cond;
+static uint64_t follow_generation = 0;
+static bool follow_notifier_running = false;
+
 static const char* const mime_types[_OUTPUT_MODE_MAX] = {
         [OUTPUT_SHORT] = "text/plain",
         [OUTPUT_JSON] = "application/json",
@@ -86,6 +122,265 @@ static RequestMeta *request_meta(void **connection_cls) {
         return m;
 }
 
+static int open_journal_watched(sd_journal **ret) {
+        sd_journal *j;
+        int r;
+
+        assert(ret);
+
+        if (arg_directory)
+                r = sd_journal_open_directory(&j, arg_directory, 0);
+        else
+                r = sd_journal_open(&j, SD_JOURNAL_LOCAL_ONLY|SD_JOURNAL_SYSTEM);
+        if (r < 0)
+                return r;
+
+        /* Watch for added and removed files, so that the journal stays usable after we are done with it */
+        r = sd_journal_get_fd(j);
+        if (r < 0) {
+                sd_journal_close(j);
+                return r;
+        }
+
+        *ret = j;
+        return 0;
+}
+
+static int open_journal(RequestMeta *m) {
+        sd_journal *j = NULL;
+        int r;
+
+        assert(m);
+
+        if (m->journal)
+                return 0;
+
+        /* Reuse a journal a previous request left behind, which has all files open and mapped already */
+        assert_se(pthread_mutex_lock(&journal_pool_lock) == 0);
+        if (journal_pool_n > 0)
+                j = journal_pool[--journal_pool_n];
+        assert_se(pthread_mutex_unlock(&journal_pool_lock) == 0);
+
+        if (j) {
+                r = sd_journal_process(j);
+                if (r >= 0) {
+                        m->journal = j;
+                        return 0;
+                }
+
+                log_debug_errno(r, "Failed to process pooled journal, opening a new one: %m");
+                sd_journal_close(j);
+        }
+
+        return open_journal_watched(&m->journal);
+}
+
+static void close_journal(RequestMeta *m) {
+        assert(m);
+
+        if (!m->journal)
+                return;
+
+        sd_journal_flush_matches(m->journal);
+
+        assert_se(pthread_mutex_lock(&journal_pool_lock) == 0);
+        if (journal_pool_n < JOURNAL_POOL_MAX)
+                journal_pool[journal_pool_n++] = TAKE_PTR(m->journal);
+        assert_se(pthread_mutex_unlock(&journal_pool_lock) == 0);
+
+        sd_journal_close(m->journal);
+        m->journal = NULL;
+}
+
+static RangeCacheEntry* range_cache_entry_free(RangeCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->key);
+        free(e->data);
+        return mfree(e);
+}
+
+static struct MHD_Response* range_cache_get(const char *key) {
+        struct MHD_Response *response = NULL;
+        RangeCacheEntry *e;
+
+        assert(key);
+
+        assert_se(pthread_mutex_lock(&range_cache_lock) == 0);
+
+        e = ordered_hashmap_remove(range_cache, key);
+        if (e) {
+                /* Move it to the end, so that it is evicted last */
+                assert_se(ordered_hashmap_put(range_cache, e->key, e) > 0);
+
+                response = MHD_create_response_from_buffer(e->size, e->data, MHD_RESPMEM_MUST_COPY);
+        }
+
+        assert_se(pthread_mutex_unlock(&range_cache_lock) == 0);
+
+        return response;
+}
+
+static void range_cache_put(RequestMeta *m) {
+        RangeCacheEntry *e;
+
+        assert(m);
+
+        if (!m->cache_key)
+                return;
+
+        e = new(RangeCacheEntry, 1);
+        if (!e)
+                return;
+
+        *e = (RangeCacheEntry) {
+                .key = TAKE_PTR(m->cache_key),
+                .data = TAKE_PTR(m->cache_data),
+                .size = m->cache_size,
+        };
+        m->cache_size = m->cache_allocated = 0;
+
+        assert_se(pthread_mutex_lock(&range_cache_lock) == 0);
+
+        if (ordered_hashmap_ensure_allocated(&range_cache, &string_hash_ops) < 0)
+                goto finish;
+
+        range_cache_entry_free(ordered_hashmap_remove(range_cache, e->key));
+
+        while (ordered_hashmap_size(range_cache) >= RANGE_CACHE_MAX)
+                range_cache_entry_free(ordered_hashmap_steal_first(range_cache));
+
+        if (ordered_hashmap_put(range_cache, e->key, e) > 0)
+                e = NULL;
+
+finish:
+        assert_se(pthread_mutex_unlock(&range_cache_lock) == 0);
+
+        range_cache_entry_free(e);
+}
+
+static void request_meta_cache_append(RequestMeta *m, const char *buf, size_t n) {
+        assert(m);
+
+        if (!m->cache_key)
+                return;
+
+        if (m->cache_size + n > RANGE_CACHE_SIZE_MAX ||
+            !GREEDY_REALLOC(m->cache_data, m->cache_allocated, m->cache_size + n)) {
+                /* Too large to be worth caching, or we ran out of memory. Just don't. */
+                m->cache_key = mfree(m->cache_key);
+                m->cache_data = mfree(m->cache_data);
+                return;
+        }
+
+        memcpy(m->cache_data + m->cache_size, buf, n);
+        m->cache_size += n;
+}
+
+static void* follow_notifier_thread(void *userdata) {
+        sd_journal *j = NULL;
+        int r;
+
+        (void) pthread_setname_np(pthread_self(), "journal-follow");
+
+        /* Open the journal from this thread, so that its hashmaps are allocated and freed by the same thread */
+        r = open_journal_watched(&j);
+        if (r < 0)
+                log_warning_errno(r, "Failed to open journal for change notification, followers will wait on their own: %m");
+
+        while (j) {
+                r = sd_journal_wait(j, (uint64_t) -1);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to wait for journal changes, followers will wait on their own: %m");
+                        break;
+                }
+                if (r == SD_JOURNAL_NOP)
+                        continue;
+
+                assert_se(pthread_mutex_lock(&follow_lock) == 0);
+                follow_generation++;
+                assert_se(pthread_cond_broadcast(&follow_cond) == 0);
+                assert_se(pthread_mutex_unlock(&follow_lock) == 0);
+        }
+
+        assert_se(pthread_mutex_lock(&follow_lock) == 0);
+        follow_notifier_running = false;
+        assert_se(pthread_cond_broadcast(&follow_cond) == 0);
+        assert_se(pthread_mutex_unlock(&follow_lock) == 0);
+
+        if (j)
+                sd_journal_close(j);
+        return NULL;
+}
+
+static void follow_notifier_start(void) {
+        pthread_condattr_t attr;
+        pthread_attr_t thread_attr;
+        sigset_t ss, saved_ss;
+        pthread_t thread;
+        int r;
+
+        assert_se(pthread_condattr_init(&attr) == 0);
+        assert_se(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0);
+        assert_se(pthread_cond_init(&follow_cond, &attr) == 0);
+        assert_se(pthread_condattr_destroy(&attr) == 0);
+
+        assert_se(pthread_attr_init(&thread_attr) == 0);
+        assert_se(pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED) == 0);
+
+        /* Don't block SIGBUS, since the thread accesses memory mapped files */
+        assert_se(sigfillset(&ss) >= 0);
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+        assert_se(pthread_sigmask(SIG_BLOCK, &ss, &saved_ss) == 0);
+
+        follow_notifier_running = true;
+
+        r = pthread_create(&thread, &thread_attr, follow_notifier_thread, NULL);
+        if (r > 0) {
+                log_warning_errno(r, "Failed to start change notification thread, followers will wait on their own: %m");
+                follow_notifier_running = false;
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+        assert_se(pthread_attr_destroy(&thread_attr) == 0);
+}
+
+static int follow_wait(sd_journal *j, usec_t timeout) {
+        uint64_t generation;
+        struct timespec ts;
+        int r;
+
+        assert(j);
+
+        assert_se(pthread_once(&follow_once, follow_notifier_start) == 0);
+
+        assert_se(pthread_mutex_lock(&follow_lock) == 0);
+        generation = follow_generation;
+        assert_se(pthread_mutex_unlock(&follow_lock) == 0);
+
+        /* Anything that happened before we took note of the generation is queued up on our own inotify
+         * fd, so it is caught here. Anything later bumps the generation. */
+        r = sd_journal_process(j);
+        if (r != SD_JOURNAL_NOP)
+                return r;
+
+        timespec_store(&ts, usec_add(now(CLOCK_MONOTONIC), timeout));
+
+        assert_se(pthread_mutex_lock(&follow_lock) == 0);
+        if (!follow_notifier_running) {
+                assert_se(pthread_mutex_unlock(&follow_lock) == 0);
+                return sd_journal_wait(j, timeout);
+        }
+
+        while (follow_notifier_running && follow_generation == generation)
+                if (pthread_cond_timedwait(&follow_cond, &follow_lock, &ts) == ETIMEDOUT)
+                        break;
+        assert_se(pthread_mutex_unlock(&follow_lock) == 0);
+
+        return sd_journal_process(j);
+}
+
 static void request_meta_free(
                 void *cls,
                 struct MHD_Connection *connection,
@@ -97,26 +392,16 @@ static void request_meta_free(
         if (!m)
                 return;
 
-        sd_journal_close(m->journal);
+        close_journal(m);
 
         safe_fclose(m->tmp);
 
+        free(m->cache_key);
+        free(m->cache_data);
         free(m->cursor);
         free(m);
 }
 
-static int open_journal(RequestMeta *m) {
-        assert(m);
-
-        if (m->journal)
-                return 0;
-
-        if (arg_directory)
-                return sd_journal_open_directory(&m->journal, arg_directory, 0);
-        else
-                return sd_journal_open(&m->journal, SD_JOURNAL_LOCAL_ONLY|SD_JOURNAL_SYSTEM);
-}
-
 static int request_meta_ensure_tmp(RequestMeta *m) {
         assert(m);
 
@@ -161,8 +446,11 @@ static ssize_t request_reader_entries(
                  * one */
 
                 if (m->n_entries_set &&
-                    m->n_entries <= 0)
+                    m->n_entries <= 0) {
+                        /* Everything that was asked for has been sent, the response is complete */
+                        range_cache_put(m);
                         return MHD_CONTENT_READER_END_OF_STREAM;
+                }
 
                 if (m->n_skip < 0)
                         r = sd_journal_previous_skip(m->journal, (uint64_t) -m->n_skip + 1);
@@ -177,7 +465,7 @@ static ssize_t request_reader_entries(
                 } else if (r == 0) {
 
                         if (m->follow) {
-                                r = sd_journal_wait(m->journal, (uint64_t) JOURNAL_WAIT_TIMEOUT);
+                                r = follow_wait(m->journal, JOURNAL_WAIT_TIMEOUT);
                                 if (r < 0) {
                                         log_error_errno(r, "Couldn't wait for journal event: %m");
                                         return MHD_CONTENT_READER_END_WITH_ERROR;
@@ -255,6 +543,8 @@ static ssize_t request_reader_entries(
                 return MHD_CONTENT_READER_END_WITH_ERROR;
         }
 
+        request_meta_cache_append(m, buf, k);
+
         return (ssize_t) k;
 }
 
@@ -458,6 +748,59 @@ static int request_parse_arguments(
         return m->argument_parse_error;
 }
 
+static mhd_result request_collect_arguments_iterator(
+                void *cls,
+                enum MHD_ValueKind kind,
+                const char *key,
+                const char *value) {
+
+        char ***l = cls;
+
+        if (strv_extendf(l, "%s=%s", strempty(key), strempty(value)) < 0) {
+                *l = strv_free(*l);
+                return MHD_NO;
+        }
+
+        return MHD_YES;
+}
+
+static int request_make_cache_key(
+                RequestMeta *m,
+                struct MHD_Connection *connection) {
+
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_free_ char *args = NULL;
+
+        assert(m);
+        assert(connection);
+
+        /* Only a bounded range that starts at a cursor always results in the same output. Anything
+         * relative to the head or tail of the journal moves along with it. */
+        if (m->follow || !m->cursor || !m->n_entries_set)
+                return 0;
+
+        l = strv_new(NULL);
+        if (!l)
+                return -ENOMEM;
+
+        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, request_collect_arguments_iterator, &l);
+        if (!l)
+                return -ENOMEM;
+
+        /* Matches are the same regardless of their order */
+        strv_sort(l);
+
+        args = strv_join(l, "&");
+        if (!args)
+                return -ENOMEM;
+
+        if (asprintf(&m->cache_key, "%i %" PRIi64 " %" PRIu64 " %s %s\n%s",
+                     (int) m->mode, m->n_skip, m->n_entries, yes_no(m->discrete), m->cursor, args) < 0)
+                return -ENOMEM;
+
+        return 1;
+}
+
 static int request_handler_entries(
                 struct MHD_Connection *connection,
                 void *connection_cls) {
@@ -499,7 +842,13 @@ static int request_handler_entries(
         if (r < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to seek in journal.");
 
-        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_entries, m, NULL);
+        r = request_make_cache_key(m, connection);
+        if (r < 0)
+                return respond_oom(connection);
+        if (r > 0)
+                response = range_cache_get(m->cache_key);
+        if (!response)
+                response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_entries, m, NULL);
         if (!response)
                 return respond_oom(connection);
 
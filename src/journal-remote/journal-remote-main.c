@@ -40,6 +40,7 @@ static char** arg_gnutls_log = NULL;
 
 static JournalWriteSplitMode arg_split_mode = _JOURNAL_WRITE_SPLIT_INVALID;
 static const char* arg_output = NULL;
+static unsigned arg_workers = 0;
 
 static char *arg_key = NULL;
 static char *arg_cert = NULL;
@@ -147,7 +148,7 @@ static int dispatch_http_event(sd_event_source *event,
                                uint32_t revents,
                                void *userdata);
 
-static int request_meta(void **connection_cls, int fd, char *hostname) {
+static int request_meta(void **connection_cls, int fd, char *hostname, bool zstd) {
         RemoteSource *source;
         Writer *writer;
         int r;
@@ -167,6 +168,18 @@ static int request_meta(void **connection_cls, int fd, char *hostname) {
                 return log_oom();
         }
 
+#if HAVE_ZSTD
+        if (zstd) {
+                source->zstd = ZSTD_createDCtx();
+                source->zstd_buffer = malloc(ZSTD_DStreamOutSize());
+                if (!source->zstd || !source->zstd_buffer) {
+                        source->importer.name = NULL; /* owned by the caller on failure */
+                        source_free(source);
+                        return log_oom();
+                }
+        }
+#endif
+
         log_debug("Added RemoteSource as connection metadata %p", source);
 
         *connection_cls = source;
@@ -189,6 +202,35 @@ static void request_meta_free(void *cls,
         }
 }
 
+static int process_http_entries(
+                struct MHD_Connection *connection,
+                RemoteSource *source) {
+
+        int r;
+
+        assert(source);
+
+        for (;;) {
+                r = process_source(source,
+                                   journal_remote_server_global->compress,
+                                   journal_remote_server_global->seal);
+                if (r == -EAGAIN)
+                        return 0;
+                if (r < 0) {
+                        if (r == -ENOBUFS)
+                                log_warning_errno(r, "Entry is above the maximum of %u, aborting connection %p.",
+                                                  DATA_SIZE_MAX, connection);
+                        else if (r == -E2BIG)
+                                log_warning_errno(r, "Entry with more fields than the maximum of %u, aborting connection %p.",
+                                                  ENTRY_FIELD_COUNT_MAX, connection);
+                        else
+                                log_warning_errno(r, "Failed to process data, aborting connection %p: %m",
+                                                  connection);
+                        return r;
+                }
+        }
+}
+
 static int process_http_upload(
                 struct MHD_Connection *connection,
                 const char *upload_data,
@@ -207,6 +249,46 @@ static int process_http_upload(
         if (*upload_data_size) {
                 log_trace("Received %zu bytes", *upload_data_size);
 
+#if HAVE_ZSTD
+                if (source->zstd) {
+                        ZSTD_inBuffer in = {
+                                .src = upload_data,
+                                .size = *upload_data_size,
+                        };
+
+                        /* Process the entries after every block of output, so that a small upload
+                         * cannot make us buffer a huge amount of decompressed data. */
+                        for (;;) {
+                                ZSTD_outBuffer out = {
+                                        .dst = source->zstd_buffer,
+                                        .size = ZSTD_DStreamOutSize(),
+                                };
+                                size_t k;
+
+                                k = ZSTD_decompressStream(source->zstd, &out, &in);
+                                if (ZSTD_isError(k)) {
+                                        log_warning("Failed to decompress upload, aborting connection %p: %s",
+                                                    connection, ZSTD_getErrorName(k));
+                                        return MHD_NO;
+                                }
+
+                                r = journal_importer_push_data(&source->importer, out.dst, out.pos);
+                                if (r < 0)
+                                        return mhd_respond_oom(connection);
+
+                                r = process_http_entries(connection, source);
+                                if (r < 0)
+                                        return MHD_NO;
+
+                                if (in.pos >= in.size && out.pos < out.size)
+                                        break;
+                        }
+
+                        *upload_data_size = 0;
+                        return MHD_YES;
+                }
+#endif
+
                 r = journal_importer_push_data(&source->importer,
                                                upload_data, *upload_data_size);
                 if (r < 0)
@@ -216,25 +298,9 @@ static int process_http_upload(
         } else
                 finished = true;
 
-        for (;;) {
-                r = process_source(source,
-                                   journal_remote_server_global->compress,
-                                   journal_remote_server_global->seal);
-                if (r == -EAGAIN)
-                        break;
-                if (r < 0) {
-                        if (r == -ENOBUFS)
-                                log_warning_errno(r, "Entry is above the maximum of %u, aborting connection %p.",
-                                                  DATA_SIZE_MAX, connection);
-                        else if (r == -E2BIG)
-                                log_warning_errno(r, "Entry with more fields than the maximum of %u, aborting connection %p.",
-                                                  ENTRY_FIELD_COUNT_MAX, connection);
-                        else
-                                log_warning_errno(r, "Failed to process data, aborting connection %p: %m",
-                                                  connection);
-                        return MHD_NO;
-                }
-        }
+        r = process_http_entries(connection, source);
+        if (r < 0)
+                return MHD_NO;
 
         if (!finished)
                 return MHD_YES;
@@ -266,7 +332,7 @@ static mhd_result request_handler(
         const char *header;
         int r, code, fd;
         _cleanup_free_ char *hostname = NULL;
-        bool chunked = false;
+        bool chunked = false, zstd = false;
 
         assert(connection);
         assert(connection_cls);
@@ -300,6 +366,17 @@ static mhd_result request_handler(
                 chunked = true;
         }
 
+        header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Encoding");
+        if (header && !strcaseeq(header, "identity")) {
+#if HAVE_ZSTD
+                if (!strcaseeq(header, "zstd"))
+#endif
+                        return mhd_respondf(connection, 0, MHD_HTTP_UNSUPPORTED_MEDIA_TYPE,
+                                            "Unsupported Content-Encoding type: %s", header);
+
+                zstd = true;
+        }
+
         header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Length");
         if (header) {
                 size_t len;
@@ -349,7 +426,7 @@ static mhd_result request_handler(
 
         assert(hostname);
 
-        r = request_meta(connection_cls, fd, hostname);
+        r = request_meta(connection_cls, fd, hostname, zstd);
         if (r == -ENOMEM)
                 return respond_oom(connection);
         else if (r < 0)
@@ -604,6 +681,12 @@ static int create_remoteserver(
         if (r < 0)
                 return log_error_errno(r, "Failed to set up signals: %m");
 
+        /* Raw connections are handed off to these. Other sources are refused together with workers, see
+         * parse_argv(). */
+        r = journal_remote_server_start_workers(s, arg_workers);
+        if (r < 0)
+                return r;
+
         n = sd_listen_fds(true);
         if (n < 0)
                 return log_error_errno(n, "Failed to read listening file descriptors from environment: %m");
@@ -633,7 +716,7 @@ static int create_remoteserver(
 
                         log_debug("Received a connection socket (fd:%d) from %s", fd, hostname);
 
-                        r = journal_remote_add_source(s, fd, hostname, true);
+                        r = journal_remote_add_connection(s, fd, hostname);
                 } else
                         return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                "Unknown socket passed on fd:%d", fd);
@@ -756,6 +839,7 @@ static int parse_config(void) {
         const ConfigTableItem items[] = {
                 { "Remote",  "Seal",                   config_parse_bool,             0, &arg_seal       },
                 { "Remote",  "SplitMode",              config_parse_write_split_mode, 0, &arg_split_mode },
+                { "Remote",  "Workers",                config_parse_unsigned,         0, &arg_workers    },
                 { "Remote",  "ServerKeyFile",          config_parse_path,             0, &arg_key        },
                 { "Remote",  "ServerCertificateFile",  config_parse_path,             0, &arg_cert       },
                 { "Remote",  "TrustedCertificateFile", config_parse_path,             0, &arg_trust      },
@@ -801,6 +885,7 @@ static int help(void) {
                "     --gnutls-log=CATEGORY...\n"
                "                            Specify a list of gnutls logging categories\n"
                "     --split-mode=none|host How many output files to create\n"
+               "     --workers=N            Receive raw connections in N worker threads\n"
                "\nNote: file descriptors from sd_listen_fds() will be consumed, too.\n"
                "\nSee the %s for details.\n"
                , program_invocation_short_name
@@ -825,6 +910,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_CERT,
                 ARG_TRUST,
                 ARG_GNUTLS_LOG,
+                ARG_WORKERS,
         };
 
         static const struct option options[] = {
@@ -843,6 +929,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "cert",         required_argument, NULL, ARG_CERT         },
                 { "trust",        required_argument, NULL, ARG_TRUST        },
                 { "gnutls-log",   required_argument, NULL, ARG_GNUTLS_LOG   },
+                { "workers",      required_argument, NULL, ARG_WORKERS      },
                 {}
         };
 
@@ -967,6 +1054,12 @@ static int parse_argv(int argc, char *argv[]) {
                                                        "Invalid split mode: %s", optarg);
                         break;
 
+                case ARG_WORKERS:
+                        r = safe_atou(optarg, &arg_workers);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --workers= parameter: %s", optarg);
+                        break;
+
                 case ARG_COMPRESS:
                         if (optarg) {
                                 r = parse_boolean(optarg);
@@ -1065,8 +1158,21 @@ static int parse_argv(int argc, char *argv[]) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "For SplitMode=host, output must be a directory.");
 
-        log_debug("Full config: SplitMode=%s Key=%s Cert=%s Trust=%s",
+        if (arg_split_mode != JOURNAL_WRITE_SPLIT_HOST && arg_workers > 0) {
+                log_warning("Worker threads are only used for SplitMode=host, ignoring.");
+                arg_workers = 0;
+        }
+
+        /* Only raw connections can be handed off to the worker that owns the writer for their host.
+         * Anything else would write from the main thread, racing with the workers. */
+        if (arg_workers > 0 &&
+            (arg_url || arg_listen_http || arg_listen_https || http_socket >= 0 || https_socket >= 0))
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                       "Worker threads can only be used with raw sources, refusing Workers= together with --url= or HTTP(S) listeners.");
+
+        log_debug("Full config: SplitMode=%s Workers=%u Key=%s Cert=%s Trust=%s",
                   journal_write_split_mode_to_string(arg_split_mode),
+                  arg_workers,
                   strna(arg_key),
                   strna(arg_cert),
                   strna(arg_trust));
@@ -1164,6 +1270,9 @@ static int run(int argc, char **argv) {
                         return log_error_errno(r, "Failed to run event loop: %m");
         }
 
+        /* Make sure the entries written by the workers are accounted for */
+        journal_remote_server_stop_workers(&s);
+
         notify_message = NULL;
         (void) sd_notifyf(false,
                           "STOPPING=1\n"
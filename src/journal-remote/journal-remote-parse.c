@@ -19,6 +19,11 @@ void source_free(RemoteSource *source) {
         sd_event_source_unref(source->event);
         sd_event_source_unref(source->buffer_event);
 
+#if HAVE_ZSTD
+        ZSTD_freeDCtx(source->zstd);
+        free(source->zstd_buffer);
+#endif
+
         free(source);
 }
 
@@ -53,7 +58,11 @@ int process_source(RemoteSource *source, bool compress, bool seal) {
         assert(source);
         assert(source->writer);
 
-        r = journal_importer_process_data(&source->importer);
+        /* Consume lines until we have a complete entry, instead of returning to the event loop after
+         * every single field. */
+        do
+                r = journal_importer_process_data(&source->importer);
+        while (r == 0 && !journal_importer_eof(&source->importer));
         if (r <= 0)
                 return r;
 
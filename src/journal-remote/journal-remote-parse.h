@@ -1,6 +1,10 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 #pragma once
 
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "sd-event.h"
 
 #include "journal-importer.h"
@@ -13,6 +17,12 @@ typedef struct RemoteSource {
 
         sd_event_source *event;
         sd_event_source *buffer_event;
+
+#if HAVE_ZSTD
+        /* Set for HTTP uploads sent with "Content-Encoding: zstd" */
+        ZSTD_DCtx *zstd;
+        void *zstd_buffer;
+#endif
 } RemoteSource;
 
 RemoteSource* source_new(int fd, bool passive_fd, char *name, Writer *writer);
@@ -2,6 +2,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <sys/prctl.h>
 #include <stdint.h>
@@ -20,6 +22,7 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "process-util.h"
+#include "siphash24.h"
 #include "socket-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -27,6 +30,9 @@
 
 #define REMOTE_JOURNAL_PATH "/var/log/journal/remote"
 
+/* How many entries to read from one source before giving the others a turn */
+#define REMOTE_SOURCE_ENTRIES_PER_DISPATCH 64U
+
 #define filename_escape(s) xescape((s), "/ ")
 
 static int open_output(RemoteServer *s, Writer *w, const char* host) {
@@ -347,6 +353,8 @@ static void MHDDaemonWrapper_free(MHDDaemonWrapper *d) {
 void journal_remote_server_destroy(RemoteServer *s) {
         size_t i;
 
+        journal_remote_server_stop_workers(s);
+
 #if HAVE_MICROHTTPD
         hashmap_free_with_destructor(s->daemons, MHDDaemonWrapper_free);
 #endif
@@ -370,6 +378,253 @@ void journal_remote_server_destroy(RemoteServer *s) {
         /* fds that we're listening on remain open... */
 }
 
+/**********************************************************************
+ **********************************************************************
+ **********************************************************************/
+
+struct RemoteShard {
+        RemoteServer server;
+
+        pthread_t thread;
+        bool thread_started;
+
+        /* The main thread writes RemoteShardConnection pointers into pipe_fd[1], and closes it to make
+         * the worker leave its event loop. */
+        int pipe_fd[2];
+        sd_event_source *pipe_event;
+};
+
+typedef struct RemoteShardConnection {
+        int fd;
+        char *name;
+} RemoteShardConnection;
+
+static int dispatch_shard_pipe_event(
+                sd_event_source *event,
+                int fd,
+                uint32_t revents,
+                void *userdata) {
+
+        RemoteShard *shard = userdata;
+
+        for (;;) {
+                _cleanup_free_ RemoteShardConnection *c = NULL;
+                ssize_t n;
+
+                n = read(fd, &c, sizeof(c));
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (errno == EAGAIN)
+                                return 0;
+
+                        return log_error_errno(errno, "Failed to read from worker pipe: %m");
+                }
+                if (n == 0)
+                        /* The main thread closed its end, we are shutting down. */
+                        return sd_event_exit(shard->server.events, 0);
+
+                /* Writes of a single pointer are atomic, so there are no partial reads either */
+                assert(n == sizeof(c));
+
+                (void) journal_remote_add_source(&shard->server, c->fd, c->name, true);
+        }
+}
+
+static void* shard_thread(void *userdata) {
+        RemoteShard *shard = userdata;
+        int r;
+
+        (void) pthread_setname_np(pthread_self(), "journal-remote");
+
+        r = sd_event_loop(shard->server.events);
+        if (r < 0)
+                log_error_errno(r, "Failed to run worker event loop: %m");
+
+        return NULL;
+}
+
+static int shard_init(RemoteShard *shard, RemoteServer *s) {
+        int r;
+
+        assert(shard);
+        assert(s);
+
+        shard->pipe_fd[0] = shard->pipe_fd[1] = -1;
+
+        shard->server.output = s->output;
+        shard->server.split_mode = s->split_mode;
+        shard->server.compress = s->compress;
+        shard->server.seal = s->seal;
+
+        r = sd_event_new(&shard->server.events);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate worker event loop: %m");
+
+        r = init_writer_hashmap(&shard->server);
+        if (r < 0)
+                return r;
+
+        if (pipe2(shard->pipe_fd, O_CLOEXEC|O_NONBLOCK) < 0)
+                return log_error_errno(errno, "Failed to allocate worker pipe: %m");
+
+        r = sd_event_add_io(shard->server.events, &shard->pipe_event,
+                            shard->pipe_fd[0], EPOLLIN,
+                            dispatch_shard_pipe_event, shard);
+        if (r < 0)
+                return log_error_errno(r, "Failed to watch worker pipe: %m");
+
+        return 0;
+}
+
+static int shard_add_connection(RemoteServer *s, int fd, char *name) {
+        _cleanup_free_ RemoteShardConnection *c = NULL;
+        _cleanup_free_ char *name_ = name;
+        _cleanup_close_ int fd_ = fd;
+        RemoteShard *shard;
+        ssize_t n;
+
+        /* This takes ownership of fd and name, even on failure. */
+
+        assert(s);
+        assert(s->n_shards > 0);
+        assert(fd >= 0);
+        assert(name);
+
+        /* One host always has to end up on the same worker, since only that one may write to its
+         * journal file. */
+        shard = s->shards + siphash24_string(name, s->shard_hash_key.bytes) % s->n_shards;
+
+        c = new(RemoteShardConnection, 1);
+        if (!c)
+                return log_oom();
+
+        *c = (RemoteShardConnection) {
+                .fd = fd,
+                .name = name,
+        };
+
+        n = write(shard->pipe_fd[1], &c, sizeof(c));
+        if (n < 0 && errno == EAGAIN) {
+                /* The worker cannot keep up, don't let it queue up more connections. */
+                log_warning("Worker %zu is busy, refusing connection from %s.", shard - s->shards, name);
+                return 0;
+        }
+        if (n < 0)
+                return log_error_errno(errno, "Failed to pass connection to worker: %m");
+        assert(n == sizeof(c));
+
+        TAKE_PTR(c);
+        TAKE_PTR(name_);
+        TAKE_FD(fd_);
+
+        return 0;
+}
+
+int journal_remote_add_connection(RemoteServer *s, int fd, char *name) {
+        assert(s);
+        assert(fd >= 0);
+        assert(name);
+
+        /* Takes ownership of fd and name. If worker threads are running, the connection has to go to the one
+         * owning the writer for the host. */
+
+        if (s->n_shards > 0)
+                return shard_add_connection(s, fd, name);
+
+        return journal_remote_add_source(s, fd, name, true);
+}
+
+int journal_remote_server_start_workers(RemoteServer *s, unsigned n_workers) {
+        sigset_t ss, saved_ss;
+        size_t i;
+        int r;
+
+        assert(s);
+        assert(s->n_shards == 0);
+
+        if (n_workers == 0)
+                return 0;
+
+        /* Entries of one host need to go into one file, which is only written to by a single worker. */
+        assert(s->split_mode == JOURNAL_WRITE_SPLIT_HOST);
+
+        r = sd_id128_randomize(&s->shard_hash_key);
+        if (r < 0)
+                return log_error_errno(r, "Failed to generate hash key: %m");
+
+        s->shards = new0(RemoteShard, n_workers);
+        if (!s->shards)
+                return log_oom();
+
+        for (i = 0; i < n_workers; i++) {
+                s->n_shards++;
+
+                r = shard_init(s->shards + i, s);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Don't block SIGBUS, since the workers access memory mapped files */
+        assert_se(sigfillset(&ss) >= 0);
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return log_error_errno(r, "Failed to block signals: %m");
+
+        for (i = 0; i < s->n_shards; i++) {
+                r = pthread_create(&s->shards[i].thread, NULL, shard_thread, s->shards + i);
+                if (r > 0)
+                        break;
+
+                s->shards[i].thread_started = true;
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        if (r > 0)
+                return log_error_errno(r, "Failed to start worker thread: %m");
+
+        log_debug("Started %zu worker threads.", s->n_shards);
+        return 0;
+}
+
+void journal_remote_server_stop_workers(RemoteServer *s) {
+        size_t i;
+
+        assert(s);
+
+        /* Tell all workers to finish first, so that they shut down in parallel */
+        for (i = 0; i < s->n_shards; i++)
+                s->shards[i].pipe_fd[1] = safe_close(s->shards[i].pipe_fd[1]);
+
+        for (i = 0; i < s->n_shards; i++) {
+                RemoteShard *shard = s->shards + i;
+                RemoteShardConnection *c;
+
+                if (shard->thread_started)
+                        assert_se(pthread_join(shard->thread, NULL) == 0);
+
+                /* Drop connections a worker that failed did not pick up anymore */
+                if (shard->pipe_fd[0] >= 0)
+                        while (read(shard->pipe_fd[0], &c, sizeof(c)) == sizeof(c)) {
+                                safe_close(c->fd);
+                                free(c->name);
+                                free(c);
+                        }
+
+                sd_event_source_unref(shard->pipe_event);
+                safe_close(shard->pipe_fd[0]);
+
+                s->event_count += shard->server.event_count;
+                journal_remote_server_destroy(&shard->server);
+        }
+
+        s->shards = mfree(s->shards);
+        s->n_shards = 0;
+}
+
 /**********************************************************************
  **********************************************************************
  **********************************************************************/
@@ -423,12 +678,16 @@ int journal_remote_handle_raw_source(
 static int dispatch_raw_source_until_block(sd_event_source *event,
                                            void *userdata) {
         RemoteSource *source = userdata;
+        RemoteServer *s = source->writer->server;
+        unsigned n = 0;
         int r;
 
         /* Make sure event stays around even if source is destroyed */
         sd_event_source_ref(event);
 
-        r = journal_remote_handle_raw_source(event, source->importer.fd, EPOLLIN, journal_remote_server_global);
+        do
+                r = journal_remote_handle_raw_source(event, source->importer.fd, EPOLLIN, s);
+        while (r == 1 && ++n < REMOTE_SOURCE_ENTRIES_PER_DISPATCH);
         if (r != 1)
                 /* No more data for now */
                 sd_event_source_set_enabled(event, SD_EVENT_OFF);
@@ -443,12 +702,16 @@ static int dispatch_raw_source_event(sd_event_source *event,
                                      uint32_t revents,
                                      void *userdata) {
         RemoteSource *source = userdata;
+        RemoteServer *s = source->writer->server;
+        unsigned n = 0;
         int r;
 
         assert(source->event);
         assert(source->buffer_event);
 
-        r = journal_remote_handle_raw_source(event, fd, EPOLLIN, journal_remote_server_global);
+        do
+                r = journal_remote_handle_raw_source(event, fd, EPOLLIN, s);
+        while (r == 1 && ++n < REMOTE_SOURCE_ENTRIES_PER_DISPATCH);
         if (r == 1)
                 /* Might have more data. We need to rerun the handler
                  * until we are sure the buffer is exhausted. */
@@ -461,7 +724,7 @@ static int dispatch_blocking_source_event(sd_event_source *event,
                                           void *userdata) {
         RemoteSource *source = userdata;
 
-        return journal_remote_handle_raw_source(event, source->importer.fd, EPOLLIN, journal_remote_server_global);
+        return journal_remote_handle_raw_source(event, source->importer.fd, EPOLLIN, source->writer->server);
 }
 
 static int accept_connection(
@@ -532,5 +795,5 @@ static int dispatch_raw_connection_event(
         if (fd2 < 0)
                 return fd2;
 
-        return journal_remote_add_source(s, fd2, hostname, true);
+        return journal_remote_add_connection(s, fd2, hostname);
 }
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "sd-event.h"
+#include "sd-id128.h"
 
 #include "hashmap.h"
 #include "journal-remote-parse.h"
@@ -21,6 +22,8 @@ struct MHDDaemonWrapper {
 };
 #endif
 
+typedef struct RemoteShard RemoteShard;
+
 struct RemoteServer {
         RemoteSource **sources;
         size_t sources_size;
@@ -33,6 +36,10 @@ struct RemoteServer {
         Writer *_single_writer;
         uint64_t event_count;
 
+        RemoteShard *shards;                   /* worker threads raw connections are handed off to */
+        size_t n_shards;
+        sd_id128_t shard_hash_key;
+
 #if HAVE_MICROHTTPD
         Hashmap *daemons;
 #endif
@@ -55,6 +62,7 @@ int journal_remote_server_init(
 int journal_remote_get_writer(RemoteServer *s, const char *host, Writer **writer);
 
 int journal_remote_add_source(RemoteServer *s, int fd, char* name, bool own_name);
+int journal_remote_add_connection(RemoteServer *s, int fd, char *name);
 int journal_remote_add_raw_socket(RemoteServer *s, int fd);
 int journal_remote_handle_raw_source(
                 sd_event_source *event,
@@ -62,4 +70,7 @@ int journal_remote_handle_raw_source(
                 uint32_t revents,
                 RemoteServer *s);
 
+int journal_remote_server_start_workers(RemoteServer *s, unsigned n_workers);
+void journal_remote_server_stop_workers(RemoteServer *s);
+
 void journal_remote_server_destroy(RemoteServer *s);
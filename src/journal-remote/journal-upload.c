@@ -52,6 +52,7 @@ static const char *arg_machine = NULL;
 static bool arg_merge = false;
 static int arg_follow = -1;
 static const char *arg_save_state = NULL;
+static bool arg_compress = false;
 
 static void close_fd_input(Uploader *u);
 
@@ -59,6 +60,12 @@ static void close_fd_input(Uploader *u);
 
 #define STATE_FILE "/var/lib/systemd/journal-upload/state"
 
+/* Let curl ask for more than the default 16K at a time, so that many small entries go out together */
+#define UPLOAD_BUFFER_SIZE (256U*1024U)
+
+/* The state file is written at most this often, and when we exit */
+#define STATE_SAVE_INTERVAL_USEC (5 * USEC_PER_SEC)
+
 #define easy_setopt(curl, opt, value, level, cmd)                       \
         do {                                                            \
                 code = curl_easy_setopt(curl, opt, value);              \
@@ -138,6 +145,8 @@ static int update_cursor_state(Uploader *u) {
                 goto fail;
         }
 
+        u->state_timestamp = now(CLOCK_MONOTONIC);
+        u->state_dirty = false;
         return 0;
 
 fail:
@@ -167,6 +176,66 @@ static int load_cursor_state(Uploader *u) {
         return 0;
 }
 
+#if HAVE_ZSTD
+static size_t zstd_input_callback(void *buf, size_t size, size_t nmemb, void *userp) {
+        Uploader *u = userp;
+        ZSTD_outBuffer out = {
+                .dst = buf,
+                .size = size * nmemb,
+        };
+
+        assert(u);
+        assert(u->zstd);
+        assert(u->compress_input_callback);
+
+        if (u->compress_done)
+                return 0;
+
+        /* Fill our own buffer from the actual input callback, and compress from there into the buffer
+         * curl gave us. When the input is exhausted, finish the frame, and only then report EOF. */
+        for (;;) {
+                ZSTD_inBuffer in;
+                size_t k;
+
+                if (u->compress_pos >= u->compress_filled && !u->compress_eof) {
+                        size_t n;
+
+                        n = u->compress_input_callback(u->compress_buffer, 1, UPLOAD_BUFFER_SIZE,
+                                                       u->compress_input_data);
+                        if (n == CURL_READFUNC_ABORT)
+                                return n;
+                        if (n == 0)
+                                u->compress_eof = true;
+
+                        u->compress_pos = 0;
+                        u->compress_filled = n;
+                }
+
+                in = (ZSTD_inBuffer) {
+                        .src = u->compress_buffer,
+                        .size = u->compress_filled,
+                        .pos = u->compress_pos,
+                };
+
+                k = ZSTD_compressStream2(u->zstd, &out, &in, u->compress_eof ? ZSTD_e_end : ZSTD_e_continue);
+                if (ZSTD_isError(k)) {
+                        log_error("Failed to compress upload: %s", ZSTD_getErrorName(k));
+                        return CURL_READFUNC_ABORT;
+                }
+
+                u->compress_pos = in.pos;
+
+                if (u->compress_eof && k == 0) {
+                        u->compress_done = true;
+                        return out.pos;
+                }
+
+                if (out.pos >= out.size)
+                        return out.pos;
+        }
+}
+#endif
+
 int start_upload(Uploader *u,
                  size_t (*input_callback)(void *ptr,
                                           size_t size,
@@ -178,6 +247,21 @@ int start_upload(Uploader *u,
         assert(u);
         assert(input_callback);
 
+#if HAVE_ZSTD
+        if (u->zstd) {
+                /* Every upload is a zstd frame of its own */
+                (void) ZSTD_CCtx_reset(u->zstd, ZSTD_reset_session_only);
+
+                u->compress_input_callback = input_callback;
+                u->compress_input_data = data;
+                u->compress_pos = u->compress_filled = 0;
+                u->compress_eof = u->compress_done = false;
+
+                input_callback = zstd_input_callback;
+                data = u;
+        }
+#endif
+
         if (!u->header) {
                 struct curl_slist *h;
 
@@ -185,6 +269,14 @@ int start_upload(Uploader *u,
                 if (!h)
                         return log_oom();
 
+                if (u->compress_buffer) {
+                        h = curl_slist_append(h, "Content-Encoding: zstd");
+                        if (!h) {
+                                curl_slist_free_all(h);
+                                return log_oom();
+                        }
+                }
+
                 h = curl_slist_append(h, "Transfer-Encoding: chunked");
                 if (!h) {
                         curl_slist_free_all(h);
@@ -233,6 +325,12 @@ int start_upload(Uploader *u,
                 easy_setopt(curl, CURLOPT_HTTPHEADER, u->header,
                             LOG_ERR, return -EXFULL);
 
+#if LIBCURL_VERSION_NUM >= 0x073e00
+                /* read many entries per callback */
+                easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, (long) UPLOAD_BUFFER_SIZE,
+                            LOG_WARNING, );
+#endif
+
                 if (DEBUG_LOGGING)
                         /* enable verbose for easier tracing */
                         easy_setopt(curl, CURLOPT_VERBOSE, 1L, LOG_WARNING, );
@@ -440,6 +538,21 @@ static int setup_uploader(Uploader *u, const char *url, const char *state_file)
 
         u->state_file = state_file;
 
+        if (arg_compress) {
+#if HAVE_ZSTD
+                u->zstd = ZSTD_createCCtx();
+                if (!u->zstd)
+                        return log_oom();
+
+                u->compress_buffer = malloc(UPLOAD_BUFFER_SIZE);
+                if (!u->compress_buffer)
+                        return log_oom();
+#else
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                       "Compression of uploads requires zstd support.");
+#endif
+        }
+
         r = sd_event_default(&u->events);
         if (r < 0)
                 return log_error_errno(r, "sd_event_default failed: %m");
@@ -456,6 +569,10 @@ static int setup_uploader(Uploader *u, const char *url, const char *state_file)
 static void destroy_uploader(Uploader *u) {
         assert(u);
 
+        /* Save the position of any uploads that were not checkpointed yet */
+        if (u->state_dirty)
+                (void) update_cursor_state(u);
+
         curl_easy_cleanup(u->easy);
         curl_slist_free_all(u->header);
         free(u->answer);
@@ -465,6 +582,11 @@ static void destroy_uploader(Uploader *u) {
 
         free(u->url);
 
+#if HAVE_ZSTD
+        ZSTD_freeCCtx(u->zstd);
+#endif
+        free(u->compress_buffer);
+
         u->input_event = sd_event_source_unref(u->input_event);
 
         close_fd_input(u);
@@ -512,6 +634,11 @@ static int perform_upload(Uploader *u) {
                           status, strna(u->answer));
 
         free_and_replace(u->last_cursor, u->current_cursor);
+        u->state_dirty = true;
+
+        /* A busy journal results in many small uploads, don't rewrite the state file for each of them. */
+        if (now(CLOCK_MONOTONIC) < usec_add(u->state_timestamp, STATE_SAVE_INTERVAL_USEC))
+                return 0;
 
         return update_cursor_state(u);
 }
@@ -562,6 +689,7 @@ static int parse_config(void) {
                 { "Upload",  "ServerKeyFile",          config_parse_path_or_ignore, 0, &arg_key    },
                 { "Upload",  "ServerCertificateFile",  config_parse_path_or_ignore, 0, &arg_cert   },
                 { "Upload",  "TrustedCertificateFile", config_parse_path_or_ignore, 0, &arg_trust  },
+                { "Upload",  "Compress",               config_parse_bool,           0, &arg_compress },
                 {}
         };
 
@@ -606,6 +734,7 @@ static int help(void) {
                "     --follow[=BOOL]        Do [not] wait for input\n"
                "     --save-state[=FILE]    Save uploaded cursors (default \n"
                "                            " STATE_FILE ")\n"
+               "     --compress[=BOOL]      Compress uploads with zstd (default: no)\n"
                "\nSee the %s for details.\n"
                , program_invocation_short_name
                , link
@@ -627,6 +756,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_AFTER_CURSOR,
                 ARG_FOLLOW,
                 ARG_SAVE_STATE,
+                ARG_COMPRESS,
         };
 
         static const struct option options[] = {
@@ -646,6 +776,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "after-cursor", required_argument, NULL, ARG_AFTER_CURSOR   },
                 { "follow",       optional_argument, NULL, ARG_FOLLOW         },
                 { "save-state",   optional_argument, NULL, ARG_SAVE_STATE     },
+                { "compress",     optional_argument, NULL, ARG_COMPRESS       },
                 {}
         };
 
@@ -764,6 +895,19 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_save_state = optarg ?: STATE_FILE;
                         break;
 
+                case ARG_COMPRESS:
+                        if (optarg) {
+                                r = parse_boolean(optarg);
+                                if (r < 0)
+                                        return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                                               "Failed to parse --compress= parameter.");
+
+                                arg_compress = r;
+                        } else
+                                arg_compress = true;
+
+                        break;
+
                 case '?':
                         return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                "Unknown option %s.",
@@ -2,6 +2,10 @@
 
 #include <inttypes.h>
 
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "sd-event.h"
 #include "sd-journal.h"
 
@@ -35,6 +39,19 @@ typedef struct Uploader {
         sd_event_source *input_event;
         uint64_t timeout;
 
+        /* compression */
+#if HAVE_ZSTD
+        ZSTD_CCtx *zstd;
+#endif
+        size_t (*compress_input_callback)(void *ptr,
+                                          size_t size,
+                                          size_t nmemb,
+                                          void *userdata);
+        void *compress_input_data;
+        char *compress_buffer;
+        size_t compress_pos, compress_filled;
+        bool compress_eof, compress_done;
+
         /* fd stuff */
         int input;
 
@@ -50,6 +67,8 @@ typedef struct Uploader {
 
         size_t entries_sent;
         char *last_cursor, *current_cursor;
+        usec_t state_timestamp;
+        bool state_dirty;
         usec_t watchdog_timestamp;
         usec_t watchdog_usec;
 } Uploader;
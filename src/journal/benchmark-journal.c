@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "chattr-util.h"
+#include "io-util.h"
+#include "journal-file.h"
+#include "journal-internal.h"
+#include "journal-tail.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+#define N_UNITS 16U
+#define N_ENTRIES 20000U
+#define FOLLOW_BATCH 4U
+
+typedef struct Context {
+        JournalFile *file;
+        JournalTail *tail;
+        sd_id128_t boot_id;
+        uint64_t seqnum;
+        sd_journal *journal;
+} Context;
+
+static void append_one(JournalFile *f, JournalTail *tail, const sd_id128_t *boot_id, uint64_t i) {
+        char message[STRLEN("MESSAGE=Something happened, iteration ") + DECIMAL_STR_MAX(uint64_t)],
+                unit[STRLEN("_SYSTEMD_UNIT=unit-.service") + DECIMAL_STR_MAX(unsigned)],
+                pid[STRLEN("_PID=") + DECIMAL_STR_MAX(unsigned)];
+        const char *priority = i % 10 == 0 ? "PRIORITY=4" : "PRIORITY=6";
+        struct iovec iovec[7];
+        dual_timestamp ts;
+        Object *o;
+
+        /* A unique message, and a few fields that are shared with other entries, as usual */
+        xsprintf(message, "MESSAGE=Something happened, iteration %" PRIu64, i);
+        xsprintf(unit, "_SYSTEMD_UNIT=unit-%u.service", (unsigned) (i % N_UNITS));
+        xsprintf(pid, "_PID=%u", (unsigned) (i % N_UNITS) + 100);
+
+        iovec[0] = IOVEC_MAKE_STRING(message);
+        iovec[1] = IOVEC_MAKE_STRING(priority);
+        iovec[2] = IOVEC_MAKE_STRING(unit);
+        iovec[3] = IOVEC_MAKE_STRING(pid);
+        iovec[4] = IOVEC_MAKE_STRING("_UID=0");
+        iovec[5] = IOVEC_MAKE_STRING("_HOSTNAME=benchmark");
+        iovec[6] = IOVEC_MAKE_STRING("_TRANSPORT=journal");
+
+        dual_timestamp_get(&ts);
+        assert_se(journal_file_append_entry(f, &ts, boot_id, iovec, ELEMENTSOF(iovec), NULL, &o, NULL) >= 0);
+
+        /* Like journald does, if it has a tail cache */
+        if (tail)
+                assert_se(journal_tail_append(tail, &(JournalTailEntry) {
+                        .seqnum_id = f->header->seqnum_id,
+                        .seqnum = le64toh(o->entry.seqnum),
+                        .realtime = le64toh(o->entry.realtime),
+                        .monotonic = le64toh(o->entry.monotonic),
+                        .boot_id = o->entry.boot_id,
+                        .xor_hash = le64toh(o->entry.xor_hash),
+                        .fields = iovec,
+                        .n_fields = ELEMENTSOF(iovec),
+                }) > 0);
+}
+
+static void open_file(const char *dn, const char *name, JournalFile **ret) {
+        const char *p;
+
+        p = strjoina(dn, "/", name);
+        assert_se(journal_file_open(-1, p, O_RDWR|O_CREAT, 0644, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, ret) >= 0);
+}
+
+static void bench_append(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++)
+                append_one(c->file, NULL, &c->boot_id, c->seqnum++);
+}
+
+static void bench_follow(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        /* A reader following the tail: a couple of new entries show up, and are read right away. Only the
+         * reading is measured. */
+        for (uint64_t i = 0; i < n; i++) {
+                unsigned k = 0;
+
+                benchmark_pause();
+                /* Only a limited set of messages, so that the file doesn't grow too much, as many entries
+                 * are appended in total */
+                for (unsigned b = 0; b < FOLLOW_BATCH; b++)
+                        append_one(c->file, c->tail, &c->boot_id, c->seqnum++ % 1024);
+                benchmark_resume();
+
+                for (;;) {
+                        const void *d;
+                        size_t l;
+                        int r;
+
+                        r = sd_journal_next(c->journal);
+                        assert_se(r >= 0);
+                        if (r == 0)
+                                break;
+
+                        assert_se(sd_journal_get_data(c->journal, "MESSAGE", &d, &l) >= 0);
+                        k++;
+                }
+
+                assert_se(k == FOLLOW_BATCH);
+        }
+}
+
+static void bench_next(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++)
+                if (sd_journal_next(c->journal) == 0) {
+                        assert_se(sd_journal_seek_head(c->journal) >= 0);
+                        assert_se(sd_journal_next(c->journal) > 0);
+                }
+}
+
+static void bench_next_get_data(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                const void *d;
+                size_t l;
+
+                if (sd_journal_next(c->journal) == 0) {
+                        assert_se(sd_journal_seek_head(c->journal) >= 0);
+                        assert_se(sd_journal_next(c->journal) > 0);
+                }
+
+                assert_se(sd_journal_get_data(c->journal, "MESSAGE", &d, &l) >= 0);
+        }
+}
+
+static void bench_seek_tail(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                assert_se(sd_journal_seek_tail(c->journal) >= 0);
+                assert_se(sd_journal_previous(c->journal) > 0);
+        }
+}
+
+static void bench_seek_realtime(void *userdata, uint64_t n) {
+        Context *c = userdata;
+        uint64_t from, to;
+
+        assert_se(sd_journal_get_cutoff_realtime_usec(c->journal, &from, &to) >= 0);
+
+        for (uint64_t i = 0; i < n; i++) {
+                assert_se(sd_journal_seek_realtime_usec(c->journal, from + (to - from) * (i % 64) / 64) >= 0);
+                assert_se(sd_journal_next(c->journal) > 0);
+        }
+}
+
+static void open_journal(Context *c, const char *dn) {
+        sd_journal_close(c->journal);
+        assert_se(sd_journal_open_directory(&c->journal, dn, 0) >= 0);
+}
+
+static void run_follow(Context *c, const char *name, const char *dn, bool use_tail) {
+        const char *tail_path;
+
+        tail_path = strjoina(dn, "/" JOURNAL_TAIL_FILE);
+
+        open_file(dn, "system.journal", &c->file);
+        assert_se(journal_tail_create(tail_path, 4 * 1024 * 1024, &c->tail) >= 0);
+        append_one(c->file, c->tail, &c->boot_id, c->seqnum++);
+
+        open_journal(c, dn);
+        if (use_tail)
+                assert_se(journal_set_tail_cache(c->journal, tail_path) >= 0);
+        assert_se(sd_journal_seek_tail(c->journal) >= 0);
+        assert_se(sd_journal_previous(c->journal) > 0);
+
+        benchmark_run(name, bench_follow, c);
+
+        sd_journal_close(c->journal);
+        c->journal = NULL;
+        c->tail = journal_tail_close(c->tail);
+        c->file = journal_file_close(c->file);
+        (void) rm_rf(dn, REMOVE_ROOT|REMOVE_PHYSICAL);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *dn = NULL;
+        _cleanup_(journal_file_closep) JournalFile *f = NULL;
+        Context c = {};
+        const char *read_dn, *follow_dn;
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp_malloc("/var/tmp/benchmark-journal-XXXXXX", &dn) >= 0);
+        (void) chattr_path(dn, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
+        assert_se(sd_id128_randomize(&c.boot_id) >= 0);
+
+        /* The file we read from has a fixed size, so that the results don't depend on how many entries
+         * the append benchmark ended up writing. */
+        read_dn = strjoina(dn, "/read");
+        assert_se(mkdir(read_dn, 0755) >= 0);
+        open_file(read_dn, "system.journal", &f);
+        for (unsigned i = 0; i < N_ENTRIES; i++)
+                append_one(f, NULL, &c.boot_id, i);
+        f = journal_file_close(f);
+
+        open_file(dn, "append.journal", &c.file);
+        benchmark_run("journal-append", bench_append, &c);
+        c.file = journal_file_close(c.file);
+
+        open_journal(&c, read_dn);
+        benchmark_run("journal-next", bench_next, &c);
+
+        open_journal(&c, read_dn);
+        benchmark_run("journal-next-get-data", bench_next_get_data, &c);
+
+        open_journal(&c, read_dn);
+        benchmark_run("journal-seek-tail", bench_seek_tail, &c);
+
+        open_journal(&c, read_dn);
+        benchmark_run("journal-seek-realtime", bench_seek_realtime, &c);
+
+        open_journal(&c, read_dn);
+        assert_se(sd_journal_add_match(c.journal, "_SYSTEMD_UNIT=unit-3.service", 0) >= 0);
+        /* Every N_UNITS'th entry */
+        benchmark_run("journal-match-next", bench_next, &c);
+
+        sd_journal_close(c.journal);
+        c.journal = NULL;
+
+        /* The same with and without journald's tail cache, with a fresh file each */
+        follow_dn = strjoina(dn, "/follow");
+        assert_se(mkdir(follow_dn, 0755) >= 0);
+        run_follow(&c, "journal-follow", follow_dn, false);
+        assert_se(mkdir(follow_dn, 0755) >= 0);
+        run_follow(&c, "journal-follow-tail-cache", follow_dn, true);
+
+        return 0;
+}
@@ -17,6 +17,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
+#include "id128-util.h"
 #include "log.h"
 #include "memory-util.h"
 #include "mkdir.h"
@@ -27,6 +28,7 @@
 #include "strbuf.h"
 #include "string-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "tmpfile-util.h"
 
 const char * const catalog_file_dirs[] = {
@@ -373,6 +375,40 @@ int catalog_import_file(OrderedHashmap *h, const char *path) {
         return 0;
 }
 
+/* Formatting catalog entries for many journal entries (e.g. "journalctl -x") would otherwise open and map
+ * the database and look up the message id for every single entry. Keep the database mapped and remember
+ * the parsed templates per thread. Changes of the file are noticed within CATALOG_CACHE_CHECK_USEC. */
+#define CATALOG_CACHE_CHECK_USEC (1 * USEC_PER_SEC)
+
+typedef struct CatalogCache {
+        char *database;
+        char *locale;
+        int fd;
+        struct stat st;
+        void *p;
+        usec_t checked;
+        Hashmap *templates;
+} CatalogCache;
+
+static thread_local CatalogCache catalog_cache = {
+        .fd = -1,
+};
+
+void catalog_cache_flush(void) {
+        CatalogCache *c = &catalog_cache;
+
+        if (c->p)
+                munmap(c->p, c->st.st_size);
+        safe_close(c->fd);
+        free(c->database);
+        free(c->locale);
+        hashmap_free(c->templates);
+
+        *c = (CatalogCache) {
+                .fd = -1,
+        };
+}
+
 static int64_t write_catalog(
                 const char *database,
                 struct strbuf *sb,
@@ -504,6 +540,9 @@ int catalog_update(const char* database, const char* root, const char* const* di
         if (sz < 0)
                 return log_error_errno(sz, "Failed to write %s: %m", database);
 
+        /* Don't serve stale entries from the old file to this thread */
+        catalog_cache_flush();
+
         log_debug("%s: wrote %u items, with %zu bytes of strings, %"PRIi64" total size.",
                   database, n, sb->len, sz);
         return 0;
@@ -606,40 +645,230 @@ static const char *find_id(void *p, sd_id128_t id) {
                 le64toh(f->offset);
 }
 
-int catalog_get(const char* database, sd_id128_t id, char **_text) {
-        _cleanup_close_ int fd = -1;
-        void *p = NULL;
-        struct stat st = {};
-        char *text = NULL;
+typedef struct CatalogSegment {
+        const char *literal;  /* points into the template text, not NUL terminated */
+        size_t length;
+        char *variable;       /* if non-NULL, this segment is a @VARIABLE@ placeholder */
+} CatalogSegment;
+
+struct CatalogTemplate {
+        sd_id128_t id;
+        char *text;           /* NULL if the database has no entry for the id */
+        CatalogSegment *segments;
+        size_t n_segments;
+};
+
+static CatalogTemplate* catalog_template_free(CatalogTemplate *t) {
+        if (!t)
+                return NULL;
+
+        for (size_t i = 0; i < t->n_segments; i++)
+                free(t->segments[i].variable);
+        free(t->segments);
+        free(t->text);
+        return mfree(t);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(CatalogTemplate*, catalog_template_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(catalog_template_hash_ops, sd_id128_t, id128_hash_func, id128_compare_func,
+                                              CatalogTemplate, catalog_template_free);
+
+static int catalog_template_new(sd_id128_t id, const char *text, CatalogTemplate **ret) {
+        _cleanup_(catalog_template_freep) CatalogTemplate *t = NULL;
+        size_t allocated = 0;
+        const char *f, *l;
+
+        assert(ret);
+
+        t = new0(CatalogTemplate, 1);
+        if (!t)
+                return -ENOMEM;
+
+        t->id = id;
+
+        if (!text) {
+                *ret = TAKE_PTR(t);
+                return 0;
+        }
+
+        t->text = strdup(text);
+        if (!t->text)
+                return -ENOMEM;
+
+        /* Split the text into literal runs and @VARIABLE@ placeholders once, so that formatting an entry
+         * is a simple concatenation. The syntax matches replace_var(). */
+        for (f = l = t->text;; ) {
+                size_t k = 0;
+
+                if (*f == '@') {
+                        k = strspn(f + 1, UPPERCASE_LETTERS "_");
+                        if (k > 0 && f[k+1] != '@')
+                                k = 0;
+                }
+
+                if (k == 0 && *f != 0) {
+                        f++;
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(t->segments, allocated, t->n_segments + 2))
+                        return -ENOMEM;
+
+                if (f > l)
+                        t->segments[t->n_segments++] = (CatalogSegment) {
+                                .literal = l,
+                                .length = f - l,
+                        };
+
+                if (*f == 0)
+                        break;
+
+                t->segments[t->n_segments].variable = strndup(f + 1, k);
+                if (!t->segments[t->n_segments].variable)
+                        return -ENOMEM;
+                t->n_segments++;
+
+                f += k + 2;
+                l = f;
+        }
+
+        *ret = TAKE_PTR(t);
+        return 0;
+}
+
+static bool catalog_cache_valid(const char *database, const char *locale) {
+        CatalogCache *c = &catalog_cache;
+        struct stat st;
+        usec_t n;
+
+        if (!c->p || !streq_ptr(c->database, database) || !streq_ptr(c->locale, locale))
+                return false;
+
+        n = now(CLOCK_MONOTONIC);
+        if (n < c->checked + CATALOG_CACHE_CHECK_USEC)
+                return true;
+
+        if (stat(database, &st) < 0)
+                return false;
+
+        if (st.st_dev != c->st.st_dev ||
+            st.st_ino != c->st.st_ino ||
+            st.st_size != c->st.st_size ||
+            timespec_load_nsec(&st.st_mtim) != timespec_load_nsec(&c->st.st_mtim))
+                return false;
+
+        c->checked = n;
+        return true;
+}
+
+int catalog_get_template(const char *database, sd_id128_t id, const CatalogTemplate **ret) {
+        CatalogCache *c = &catalog_cache;
+        CatalogTemplate *t;
+        const char *loc;
         int r;
-        const char *s;
 
-        assert(_text);
+        assert(database);
+        assert(ret);
 
-        r = open_mmap(database, &fd, &st, &p);
-        if (r < 0)
-                return r;
+        loc = setlocale(LC_MESSAGES, NULL);
+
+        if (!catalog_cache_valid(database, loc)) {
+                catalog_cache_flush();
 
-        s = find_id(p, id);
-        if (!s) {
-                r = -ENOENT;
-                goto finish;
+                r = open_mmap(database, &c->fd, &c->st, &c->p);
+                if (r < 0)
+                        return r;
+
+                c->database = strdup(database);
+                if (!c->database || (loc && !(c->locale = strdup(loc)))) {
+                        catalog_cache_flush();
+                        return -ENOMEM;
+                }
+
+                c->checked = now(CLOCK_MONOTONIC);
         }
 
-        text = strdup(s);
-        if (!text) {
-                r = -ENOMEM;
-                goto finish;
+        t = hashmap_get(c->templates, &id);
+        if (!t) {
+                _cleanup_(catalog_template_freep) CatalogTemplate *n = NULL;
+
+                r = hashmap_ensure_allocated(&c->templates, &catalog_template_hash_ops);
+                if (r < 0)
+                        return r;
+
+                /* Negative lookups are cached too, most message ids have no catalog entry */
+                r = catalog_template_new(id, find_id(c->p, id), &n);
+                if (r < 0)
+                        return r;
+
+                r = hashmap_put(c->templates, &n->id, n);
+                if (r < 0)
+                        return r;
+
+                t = TAKE_PTR(n);
         }
 
-        *_text = text;
-        r = 0;
+        if (!t->text)
+                return -ENOENT;
 
-finish:
-        if (p)
-                munmap(p, st.st_size);
+        *ret = t;
+        return 0;
+}
 
-        return r;
+char *catalog_template_format(const CatalogTemplate *t, catalog_lookup_t lookup, void *userdata) {
+        _cleanup_free_ char *buf = NULL;
+        size_t allocated = 0, n = 0;
+
+        assert(t);
+        assert(lookup);
+
+        for (size_t i = 0; i < t->n_segments; i++) {
+                const CatalogSegment *s = t->segments + i;
+                const void *data;
+                size_t size;
+
+                if (!s->variable) {
+                        data = s->literal;
+                        size = s->length;
+                } else if (lookup(s->variable, &data, &size, userdata) <= 0) {
+                        /* Like replace_var(), substitute the variable name if there is no value */
+                        data = s->variable;
+                        size = strlen(s->variable);
+                }
+
+                /* Append right away, the data returned by the lookup is only valid until the next call */
+                if (!GREEDY_REALLOC(buf, allocated, n + size + 1))
+                        return NULL;
+
+                memcpy(buf + n, data, size);
+                n += size;
+        }
+
+        if (!GREEDY_REALLOC(buf, allocated, n + 1))
+                return NULL;
+        buf[n] = 0;
+
+        return TAKE_PTR(buf);
+}
+
+int catalog_get(const char* database, sd_id128_t id, char **_text) {
+        const CatalogTemplate *t;
+        char *text;
+        int r;
+
+        assert(_text);
+
+        r = catalog_get_template(database, id, &t);
+        if (r < 0)
+                return r;
+
+        text = strdup(t->text);
+        if (!text)
+                return -ENOMEM;
+
+        *_text = text;
+        return 0;
 }
 
 static char *find_header(const char *s, const char *header) {
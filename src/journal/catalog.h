@@ -12,6 +12,16 @@
 int catalog_import_file(OrderedHashmap *h, const char *path);
 int catalog_update(const char* database, const char* root, const char* const* dirs);
 int catalog_get(const char* database, sd_id128_t id, char **data);
+
+/* A parsed catalog entry. It is owned by a per-thread cache, and stays valid until the next catalog call
+ * from the same thread. */
+typedef struct CatalogTemplate CatalogTemplate;
+typedef int (*catalog_lookup_t)(const char *variable, const void **ret_data, size_t *ret_size, void *userdata);
+int catalog_get_template(const char *database, sd_id128_t id, const CatalogTemplate **ret);
+char *catalog_template_format(const CatalogTemplate *t, catalog_lookup_t lookup, void *userdata);
+/* Drops the cache of the calling thread, and unmaps the database */
+void catalog_cache_flush(void);
+
 int catalog_list(FILE *f, const char* database, bool oneline);
 int catalog_list_items(FILE *f, const char* database, bool oneline, char **items);
 int catalog_file_lang(const char *filename, char **lang);
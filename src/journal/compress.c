@@ -17,6 +17,7 @@
 #endif
 
 #if HAVE_ZSTD
+#include <zdict.h>
 #include <zstd.h>
 #include <zstd_errors.h>
 #endif
@@ -38,6 +39,23 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(LZ4F_compressionContext_t, LZ4F_freeCompressionConte
 DEFINE_TRIVIAL_CLEANUP_FUNC(LZ4F_decompressionContext_t, LZ4F_freeDecompressionContext);
 #endif
 
+/* Upper bound for the number of threads used for compressing streams, see compress_stream_threads() */
+#define COMPRESS_STREAM_THREADS_MAX 8U
+
+/* Training a dictionary needs a reasonable number of samples to be worth anything */
+#define DICTIONARY_SAMPLES_MIN 64U
+#define DICTIONARY_SIZE_MIN 256U
+
+struct CompressDictionary {
+        uint32_t id;
+        void *data;
+        size_t size;
+#if HAVE_ZSTD
+        ZSTD_CDict *cdict;
+        ZSTD_DDict *ddict;
+#endif
+};
+
 #if HAVE_ZSTD
 DEFINE_TRIVIAL_CLEANUP_FUNC(ZSTD_CCtx *, ZSTD_freeCCtx);
 DEFINE_TRIVIAL_CLEANUP_FUNC(ZSTD_DCtx *, ZSTD_freeDCtx);
@@ -66,6 +84,130 @@ static const char* const object_compressed_table[_OBJECT_COMPRESSED_MAX] = {
 
 DEFINE_STRING_TABLE_LOOKUP(object_compressed, int);
 
+int compress_dictionary_new(const void *data, size_t size, CompressDictionary **ret) {
+#if HAVE_ZSTD
+        _cleanup_(compress_dictionary_freep) CompressDictionary *d = NULL;
+        unsigned id;
+
+        assert(data || size == 0);
+        assert(ret);
+
+        /* Only accept dictionaries in the zstd format, since we need the ID to match them to frames */
+        id = ZSTD_getDictID_fromDict(data, size);
+        if (id == 0)
+                return -EBADMSG;
+
+        d = new(CompressDictionary, 1);
+        if (!d)
+                return -ENOMEM;
+
+        *d = (CompressDictionary) {
+                .id = id,
+                .data = memdup(data, size),
+                .size = size,
+        };
+        if (!d->data)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(d);
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+CompressDictionary* compress_dictionary_free(CompressDictionary *d) {
+        if (!d)
+                return NULL;
+
+#if HAVE_ZSTD
+        ZSTD_freeCDict(d->cdict);
+        ZSTD_freeDDict(d->ddict);
+#endif
+        free(d->data);
+        return mfree(d);
+}
+
+uint32_t compress_dictionary_id(const CompressDictionary *d) {
+        assert(d);
+
+        return d->id;
+}
+
+void compress_dictionary_get_data(const CompressDictionary *d, const void **ret_data, size_t *ret_size) {
+        assert(d);
+        assert(ret_data);
+        assert(ret_size);
+
+        *ret_data = d->data;
+        *ret_size = d->size;
+}
+
+int compress_dictionary_train(
+                const void *samples, const size_t *sample_sizes, size_t n_samples,
+                size_t max_size, void **ret, size_t *ret_size) {
+#if HAVE_ZSTD
+        _cleanup_free_ void *buf = NULL;
+        size_t k;
+
+        assert(samples);
+        assert(sample_sizes);
+        assert(ret);
+        assert(ret_size);
+
+        if (n_samples < DICTIONARY_SAMPLES_MIN || n_samples > UINT_MAX)
+                return -ENODATA;
+        if (max_size < DICTIONARY_SIZE_MIN)
+                return -EINVAL;
+
+        buf = malloc(max_size);
+        if (!buf)
+                return -ENOMEM;
+
+        k = ZDICT_trainFromBuffer(buf, max_size, samples, sample_sizes, (unsigned) n_samples);
+        if (ZDICT_isError(k)) {
+                log_debug("Failed to train ZSTD dictionary: %s", ZDICT_getErrorName(k));
+                return -ENODATA;
+        }
+
+        *ret = TAKE_PTR(buf);
+        *ret_size = k;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+#if HAVE_ZSTD
+static int compress_dictionary_get_ddict(CompressDictionary *d, const void *src, uint64_t src_size, ZSTD_DDict **ret) {
+        unsigned id;
+
+        assert(ret);
+
+        /* Frames compressed without a dictionary must be decompressed without one, too, since the
+         * dictionary also changes the initial state of the entropy coder. */
+        id = ZSTD_getDictID_fromFrame(src, src_size);
+        if (id == 0) {
+                *ret = NULL;
+                return 0;
+        }
+
+        if (!d || d->id != id) {
+                log_debug("ZSTD frame needs dictionary %u, which is not available.", id);
+                return -ENOKEY;
+        }
+
+        if (!d->ddict) {
+                d->ddict = ZSTD_createDDict(d->data, d->size);
+                if (!d->ddict)
+                        return -ENOMEM;
+        }
+
+        *ret = d->ddict;
+        return 0;
+}
+#endif
+
 int compress_blob_xz(const void *src, uint64_t src_size,
                      void *dst, size_t dst_alloc_size, size_t *dst_size) {
 #if HAVE_XZ
@@ -157,6 +299,41 @@ int compress_blob_zstd(
 #endif
 }
 
+int compress_blob_zstd_dict(
+                CompressDictionary *d,
+                const void *src, uint64_t src_size,
+                void *dst, size_t dst_alloc_size, size_t *dst_size) {
+#if HAVE_ZSTD
+        size_t k;
+
+        assert(d);
+        assert(src);
+        assert(src_size > 0);
+        assert(dst);
+        assert(dst_alloc_size > 0);
+        assert(dst_size);
+
+        if (!d->cdict) {
+                d->cdict = ZSTD_createCDict(d->data, d->size, ZSTD_CLEVEL_DEFAULT);
+                if (!d->cdict)
+                        return -ENOMEM;
+        }
+
+        _cleanup_(ZSTD_freeCCtxp) ZSTD_CCtx *cctx = ZSTD_createCCtx();
+        if (!cctx)
+                return -ENOMEM;
+
+        k = ZSTD_compress_usingCDict(cctx, dst, dst_alloc_size, src, src_size, d->cdict);
+        if (ZSTD_isError(k))
+                return zstd_ret_to_errno(k);
+
+        *dst_size = k;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
 int decompress_blob_xz(const void *src, uint64_t src_size,
                        void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
 
@@ -261,8 +438,18 @@ int decompress_blob_zstd(
                 const void *src, uint64_t src_size,
                 void **dst, size_t *dst_alloc_size, size_t *dst_size, size_t dst_max) {
 
+        return decompress_blob_zstd_dict(NULL, src, src_size, dst, dst_alloc_size, dst_size, dst_max);
+}
+
+int decompress_blob_zstd_dict(
+                CompressDictionary *d,
+                const void *src, uint64_t src_size,
+                void **dst, size_t *dst_alloc_size, size_t *dst_size, size_t dst_max) {
+
 #if HAVE_ZSTD
+        ZSTD_DDict *ddict;
         uint64_t size;
+        int r;
 
         assert(src);
         assert(src_size > 0);
@@ -280,6 +467,10 @@ int decompress_blob_zstd(
         if (size > SIZE_MAX)
                 return -E2BIG;
 
+        r = compress_dictionary_get_ddict(d, src, src_size, &ddict);
+        if (r < 0)
+                return r;
+
         if (!(greedy_realloc(dst, dst_alloc_size, MAX(ZSTD_DStreamOutSize(), size), 1)))
                 return -ENOMEM;
 
@@ -287,6 +478,12 @@ int decompress_blob_zstd(
         if (!dctx)
                 return -ENOMEM;
 
+        if (ddict) {
+                size_t k = ZSTD_DCtx_refDDict(dctx, ddict);
+                if (ZSTD_isError(k))
+                        return zstd_ret_to_errno(k);
+        }
+
         ZSTD_inBuffer input = {
                 .src = src,
                 .size = src_size,
@@ -310,8 +507,9 @@ int decompress_blob_zstd(
 #endif
 }
 
-int decompress_blob(
+int decompress_blob_dict(
                 int compression,
+                CompressDictionary *d,
                 const void *src, uint64_t src_size,
                 void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
 
@@ -324,7 +522,8 @@ int decompress_blob(
                                 src, src_size,
                                 dst, dst_alloc_size, dst_size, dst_max);
         else if (compression == OBJECT_COMPRESSED_ZSTD)
-                return decompress_blob_zstd(
+                return decompress_blob_zstd_dict(
+                                d,
                                 src, src_size,
                                 dst, dst_alloc_size, dst_size, dst_max);
         else
@@ -457,7 +656,20 @@ int decompress_startswith_zstd(
                 void **buffer, size_t *buffer_size,
                 const void *prefix, size_t prefix_len,
                 uint8_t extra) {
+
+        return decompress_startswith_zstd_dict(NULL, src, src_size, buffer, buffer_size, prefix, prefix_len, extra);
+}
+
+int decompress_startswith_zstd_dict(
+                CompressDictionary *d,
+                const void *src, uint64_t src_size,
+                void **buffer, size_t *buffer_size,
+                const void *prefix, size_t prefix_len,
+                uint8_t extra) {
 #if HAVE_ZSTD
+        ZSTD_DDict *ddict;
+        int r;
+
         assert(src);
         assert(src_size > 0);
         assert(buffer);
@@ -472,10 +684,20 @@ int decompress_startswith_zstd(
         if (size < prefix_len + 1)
                 return 0; /* Decompressed text too short to match the prefix and extra */
 
+        r = compress_dictionary_get_ddict(d, src, src_size, &ddict);
+        if (r < 0)
+                return r;
+
         _cleanup_(ZSTD_freeDCtxp) ZSTD_DCtx *dctx = ZSTD_createDCtx();
         if (!dctx)
                 return -ENOMEM;
 
+        if (ddict) {
+                size_t k = ZSTD_DCtx_refDDict(dctx, ddict);
+                if (ZSTD_isError(k))
+                        return zstd_ret_to_errno(k);
+        }
+
         if (!(greedy_realloc(buffer, buffer_size, MAX(ZSTD_DStreamOutSize(), prefix_len + 1), 1)))
                 return -ENOMEM;
 
@@ -503,8 +725,9 @@ int decompress_startswith_zstd(
 #endif
 }
 
-int decompress_startswith(
+int decompress_startswith_dict(
                 int compression,
+                CompressDictionary *d,
                 const void *src, uint64_t src_size,
                 void **buffer, size_t *buffer_size,
                 const void *prefix, size_t prefix_len,
@@ -524,7 +747,8 @@ int decompress_startswith(
                                 prefix, prefix_len,
                                 extra);
         else if (compression == OBJECT_COMPRESSED_ZSTD)
-                return decompress_startswith_zstd(
+                return decompress_startswith_zstd_dict(
+                                d,
                                 src, src_size,
                                 buffer, buffer_size,
                                 prefix, prefix_len,
@@ -533,17 +757,41 @@ int decompress_startswith(
                 return -EBADMSG;
 }
 
+#if HAVE_XZ || HAVE_ZSTD
+static uint32_t compress_stream_threads(void) {
+        long n;
+
+        /* Streams are large (think core dumps), hence compress them on all CPUs we have, within reason.
+         * Blobs are small and compressed in the calling thread only. */
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n <= 0)
+                return 1;
+
+        return MIN((uint32_t) n, COMPRESS_STREAM_THREADS_MAX);
+}
+#endif
+
 int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes) {
 #if HAVE_XZ
         _cleanup_(lzma_end) lzma_stream s = LZMA_STREAM_INIT;
         lzma_ret ret;
         uint8_t buf[BUFSIZ], out[BUFSIZ];
         lzma_action action = LZMA_RUN;
+        lzma_mt mt = {
+                .threads = compress_stream_threads(),
+                .preset = LZMA_PRESET_DEFAULT,
+                .check = LZMA_CHECK_CRC64,
+        };
 
         assert(fdf >= 0);
         assert(fdt >= 0);
 
-        ret = lzma_easy_encoder(&s, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
+        /* The multi-threaded encoder splits the stream into independently compressed blocks, which any xz
+         * decoder can read */
+        if (mt.threads > 1)
+                ret = lzma_stream_encoder_mt(&s, &mt);
+        else
+                ret = lzma_easy_encoder(&s, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64);
         if (ret != LZMA_OK) {
                 log_error("Failed to initialize XZ encoder: code %u", ret);
                 return -EINVAL;
@@ -862,6 +1110,12 @@ int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes) {
         if (ZSTD_isError(z))
                 log_debug("Failed to enable ZSTD checksum, ignoring: %s", ZSTD_getErrorName(z));
 
+        /* This fails if libzstd was built without multi-threading support, in which case we compress in
+         * the calling thread */
+        z = ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, compress_stream_threads());
+        if (ZSTD_isError(z))
+                log_debug("Failed to enable ZSTD worker threads, ignoring: %s", ZSTD_getErrorName(z));
+
         /* This loop read from the input file, compresses that entire chunk,
          * and writes all output produced to the output file.
          */
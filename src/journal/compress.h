@@ -4,16 +4,33 @@
 #include <unistd.h>
 
 #include "journal-def.h"
+#include "macro.h"
 
 const char* object_compressed_to_string(int compression);
 int object_compressed_from_string(const char *compression);
 
+/* A zstd dictionary, shared by all blobs of one journal file. The compression and decompression contexts are
+ * set up lazily on first use, hence a dictionary must not be used from more than one thread at a time. */
+typedef struct CompressDictionary CompressDictionary;
+
+int compress_dictionary_new(const void *data, size_t size, CompressDictionary **ret);
+CompressDictionary* compress_dictionary_free(CompressDictionary *d);
+DEFINE_TRIVIAL_CLEANUP_FUNC(CompressDictionary*, compress_dictionary_free);
+uint32_t compress_dictionary_id(const CompressDictionary *d);
+void compress_dictionary_get_data(const CompressDictionary *d, const void **ret_data, size_t *ret_size);
+
+int compress_dictionary_train(const void *samples, const size_t *sample_sizes, size_t n_samples,
+                              size_t max_size, void **ret, size_t *ret_size);
+
 int compress_blob_xz(const void *src, uint64_t src_size,
                      void *dst, size_t dst_alloc_size, size_t *dst_size);
 int compress_blob_lz4(const void *src, uint64_t src_size,
                       void *dst, size_t dst_alloc_size, size_t *dst_size);
 int compress_blob_zstd(const void *src, uint64_t src_size,
                        void *dst, size_t dst_alloc_size, size_t *dst_size);
+int compress_blob_zstd_dict(CompressDictionary *d,
+                            const void *src, uint64_t src_size,
+                            void *dst, size_t dst_alloc_size, size_t *dst_size);
 
 static inline int compress_blob(const void *src, uint64_t src_size,
                                 void *dst, size_t dst_alloc_size, size_t *dst_size) {
@@ -42,9 +59,17 @@ int decompress_blob_lz4(const void *src, uint64_t src_size,
                         void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max);
 int decompress_blob_zstd(const void *src, uint64_t src_size,
                         void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max);
-int decompress_blob(int compression,
-                    const void *src, uint64_t src_size,
-                    void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max);
+int decompress_blob_zstd_dict(CompressDictionary *d,
+                              const void *src, uint64_t src_size,
+                              void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max);
+int decompress_blob_dict(int compression, CompressDictionary *d,
+                         const void *src, uint64_t src_size,
+                         void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max);
+static inline int decompress_blob(int compression,
+                                  const void *src, uint64_t src_size,
+                                  void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
+        return decompress_blob_dict(compression, NULL, src, src_size, dst, dst_alloc_size, dst_size, dst_max);
+}
 
 int decompress_startswith_xz(const void *src, uint64_t src_size,
                              void **buffer, size_t *buffer_size,
@@ -58,11 +83,23 @@ int decompress_startswith_zstd(const void *src, uint64_t src_size,
                                void **buffer, size_t *buffer_size,
                                const void *prefix, size_t prefix_len,
                                uint8_t extra);
-int decompress_startswith(int compression,
-                          const void *src, uint64_t src_size,
-                          void **buffer, size_t *buffer_size,
-                          const void *prefix, size_t prefix_len,
-                          uint8_t extra);
+int decompress_startswith_zstd_dict(CompressDictionary *d,
+                                    const void *src, uint64_t src_size,
+                                    void **buffer, size_t *buffer_size,
+                                    const void *prefix, size_t prefix_len,
+                                    uint8_t extra);
+int decompress_startswith_dict(int compression, CompressDictionary *d,
+                               const void *src, uint64_t src_size,
+                               void **buffer, size_t *buffer_size,
+                               const void *prefix, size_t prefix_len,
+                               uint8_t extra);
+static inline int decompress_startswith(int compression,
+                                        const void *src, uint64_t src_size,
+                                        void **buffer, size_t *buffer_size,
+                                        const void *prefix, size_t prefix_len,
+                                        uint8_t extra) {
+        return decompress_startswith_dict(compression, NULL, src, src_size, buffer, buffer_size, prefix, prefix_len, extra);
+}
 
 int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes);
 int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes);
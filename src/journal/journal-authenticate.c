@@ -260,6 +260,8 @@ int journal_file_hmac_put_object(JournalFile *f, ObjectType type, Object *o, uin
         case OBJECT_FIELD_HASH_TABLE:
         case OBJECT_DATA_HASH_TABLE:
         case OBJECT_ENTRY_ARRAY:
+        case OBJECT_BLOOM_FILTER:
+        case OBJECT_ENTRY_INDEX:
                 /* Nothing: everything is mutable */
                 break;
 
@@ -268,6 +270,11 @@ int journal_file_hmac_put_object(JournalFile *f, ObjectType type, Object *o, uin
                 gcry_md_write(f->hmac, &o->tag.seqnum, sizeof(o->tag.seqnum));
                 gcry_md_write(f->hmac, &o->tag.epoch, sizeof(o->tag.epoch));
                 break;
+
+        case OBJECT_DICTIONARY:
+                /* All */
+                gcry_md_write(f->hmac, &o->dictionary.dictionary_id, le64toh(o->object.size) - offsetof(DictionaryObject, dictionary_id));
+                break;
         default:
                 return -EINVAL;
         }
@@ -23,6 +23,10 @@ typedef struct EntryObject EntryObject;
 typedef struct HashTableObject HashTableObject;
 typedef struct EntryArrayObject EntryArrayObject;
 typedef struct TagObject TagObject;
+typedef struct DictionaryObject DictionaryObject;
+typedef struct BloomFilterObject BloomFilterObject;
+typedef struct EntryIndexItem EntryIndexItem;
+typedef struct EntryIndexObject EntryIndexObject;
 
 typedef struct EntryItem EntryItem;
 typedef struct HashItem HashItem;
@@ -39,6 +43,9 @@ typedef enum ObjectType {
         OBJECT_FIELD_HASH_TABLE,
         OBJECT_ENTRY_ARRAY,
         OBJECT_TAG,
+        OBJECT_DICTIONARY,
+        OBJECT_BLOOM_FILTER,
+        OBJECT_ENTRY_INDEX,
         _OBJECT_TYPE_MAX
 } ObjectType;
 
@@ -130,6 +137,41 @@ struct TagObject {
         uint8_t tag[TAG_LENGTH]; /* SHA-256 HMAC */
 } _packed_;
 
+/* A zstd dictionary, as trained by ZDICT_trainFromBuffer() */
+struct DictionaryObject {
+        ObjectHeader object;
+        le32_t dictionary_id;
+        uint8_t reserved[4];
+        uint8_t payload[];
+} _packed_;
+
+/* A bloom filter of the hashes of all data objects, written when the file is archived */
+struct BloomFilterObject {
+        ObjectHeader object;
+        le64_t n_data;   /* the number of data objects covered */
+        uint8_t n_hashes;
+        uint8_t reserved[7];
+        uint8_t bits[];  /* the size is a power of two */
+} _packed_;
+
+/* A sample of the global entry array, items[index] to items[index + n - 1] of the entry array object at
+ * entry_array_offset, where the first of these entries has the specified seqnum and realtime */
+struct EntryIndexItem {
+        le64_t seqnum;
+        le64_t realtime;
+        le64_t entry_array_offset;
+        le32_t index;
+        le32_t n;
+} _packed_;
+
+/* A sparse index of the global entry array, written when the file is archived */
+struct EntryIndexObject {
+        ObjectHeader object;
+        le64_t n_entries; /* the number of entries covered */
+        le64_t stride;
+        EntryIndexItem items[];
+} _packed_;
+
 union Object {
         ObjectHeader object;
         DataObject data;
@@ -138,6 +180,9 @@ union Object {
         HashTableObject hash_table;
         EntryArrayObject entry_array;
         TagObject tag;
+        DictionaryObject dictionary;
+        BloomFilterObject bloom_filter;
+        EntryIndexObject entry_index;
 };
 
 enum {
@@ -153,41 +198,45 @@ enum {
         HEADER_INCOMPATIBLE_COMPRESSED_LZ4  = 1 << 1,
         HEADER_INCOMPATIBLE_KEYED_HASH      = 1 << 2,
         HEADER_INCOMPATIBLE_COMPRESSED_ZSTD = 1 << 3,
+        HEADER_INCOMPATIBLE_ZSTD_DICTIONARY = 1 << 4,
 };
 
 #define HEADER_INCOMPATIBLE_ANY               \
         (HEADER_INCOMPATIBLE_COMPRESSED_XZ |  \
          HEADER_INCOMPATIBLE_COMPRESSED_LZ4 | \
          HEADER_INCOMPATIBLE_KEYED_HASH |     \
-         HEADER_INCOMPATIBLE_COMPRESSED_ZSTD)
+         HEADER_INCOMPATIBLE_COMPRESSED_ZSTD | \
+         HEADER_INCOMPATIBLE_ZSTD_DICTIONARY)
 
 #if HAVE_XZ && HAVE_LZ4 && HAVE_ZSTD
 #  define HEADER_INCOMPATIBLE_SUPPORTED HEADER_INCOMPATIBLE_ANY
 #elif HAVE_XZ && HAVE_LZ4
 #  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_XZ|HEADER_INCOMPATIBLE_COMPRESSED_LZ4|HEADER_INCOMPATIBLE_KEYED_HASH)
 #elif HAVE_XZ && HAVE_ZSTD
-#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_XZ|HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_KEYED_HASH)
+#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_XZ|HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_ZSTD_DICTIONARY|HEADER_INCOMPATIBLE_KEYED_HASH)
 #elif HAVE_LZ4 && HAVE_ZSTD
-#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_LZ4|HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_KEYED_HASH)
+#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_LZ4|HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_ZSTD_DICTIONARY|HEADER_INCOMPATIBLE_KEYED_HASH)
 #elif HAVE_XZ
 #  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_XZ|HEADER_INCOMPATIBLE_KEYED_HASH)
 #elif HAVE_LZ4
 #  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_LZ4|HEADER_INCOMPATIBLE_KEYED_HASH)
 #elif HAVE_ZSTD
-#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_KEYED_HASH)
+#  define HEADER_INCOMPATIBLE_SUPPORTED (HEADER_INCOMPATIBLE_COMPRESSED_ZSTD|HEADER_INCOMPATIBLE_ZSTD_DICTIONARY|HEADER_INCOMPATIBLE_KEYED_HASH)
 #else
 #  define HEADER_INCOMPATIBLE_SUPPORTED HEADER_INCOMPATIBLE_KEYED_HASH
 #endif
 
 enum {
-        HEADER_COMPATIBLE_SEALED = 1 << 0,
+        HEADER_COMPATIBLE_SEALED       = 1 << 0,
+        HEADER_COMPATIBLE_BLOOM_FILTER = 1 << 1,
+        HEADER_COMPATIBLE_ENTRY_INDEX  = 1 << 2,
 };
 
-#define HEADER_COMPATIBLE_ANY HEADER_COMPATIBLE_SEALED
+#define HEADER_COMPATIBLE_ANY (HEADER_COMPATIBLE_SEALED|HEADER_COMPATIBLE_BLOOM_FILTER|HEADER_COMPATIBLE_ENTRY_INDEX)
 #if HAVE_GCRYPT
-#  define HEADER_COMPATIBLE_SUPPORTED HEADER_COMPATIBLE_SEALED
+#  define HEADER_COMPATIBLE_SUPPORTED HEADER_COMPATIBLE_ANY
 #else
-#  define HEADER_COMPATIBLE_SUPPORTED 0
+#  define HEADER_COMPATIBLE_SUPPORTED (HEADER_COMPATIBLE_BLOOM_FILTER|HEADER_COMPATIBLE_ENTRY_INDEX)
 #endif
 
 #define HEADER_SIGNATURE                                                \
@@ -227,12 +276,18 @@ enum {
         /* Added in 246 */                              \
         le64_t data_hash_chain_depth;                   \
         le64_t field_hash_chain_depth;                  \
+        /* Added in 247 */                              \
+        le64_t dictionary_offset;                       \
+        le32_t dictionary_id;                           \
+        uint8_t reserved2[4];                           \
+        le64_t bloom_filter_offset;                     \
+        le64_t entry_index_offset;                      \
         }
 
 struct Header struct_Header__contents;
 struct Header__packed struct_Header__contents _packed_;
 assert_cc(sizeof(struct Header) == sizeof(struct Header__packed));
-assert_cc(sizeof(struct Header) == 256);
+assert_cc(sizeof(struct Header) == 288);
 
 #define FSS_HEADER_SIGNATURE                                            \
         ((const char[]) { 'K', 'S', 'H', 'H', 'R', 'H', 'L', 'P' })
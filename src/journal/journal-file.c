@@ -32,6 +32,7 @@
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "usdt.h"
 #include "xattr-util.h"
 
 #define DEFAULT_DATA_HASH_TABLE_SIZE (2047ULL*sizeof(HashItem))
@@ -73,6 +74,9 @@
 /* How many entries to keep in the entry array chain cache at max */
 #define CHAIN_CACHE_MAX 20
 
+/* How many entry array chains to remember the tail of when appending */
+#define ENTRY_ARRAY_TAILS_MAX 4096U
+
 /* How much to increase the journal file size at once each time we allocate something new. */
 #define FILE_SIZE_INCREASE (8 * 1024 * 1024ULL)          /* 8MB */
 
@@ -85,6 +89,27 @@
 /* Longest hash chain to rotate after */
 #define HASH_CHAIN_DEPTH_MAX 100
 
+/* Average number of chain links followed per data lookup to rotate after, once we did enough lookups for
+ * the average to mean something */
+#define HASH_CHAIN_DEPTH_AVG_MAX 4
+#define HASH_CHAIN_LOOKUPS_MIN 4096
+
+/* Limits for training the compression dictionary of a new file from the data of the file it replaces */
+#define DICTIONARY_SIZE_MAX (32U * 1024U)                  /* 32 KiB */
+#define DICTIONARY_SAMPLES_SIZE_MAX (2U * 1024U * 1024U)   /* 2 MiB */
+#define DICTIONARY_SAMPLE_SIZE_MAX (16U * 1024U)           /* 16 KiB */
+#define DICTIONARY_SCAN_SIZE_MAX (64U * 1024U * 1024U)     /* 64 MiB */
+
+/* 10 bits per data object and 7 hash functions make for a false positive rate of about 1% */
+#define BLOOM_FILTER_BITS_PER_ITEM 10U
+#define BLOOM_FILTER_N_HASHES 7U
+#define BLOOM_FILTER_N_HASHES_MAX 32U
+#define BLOOM_FILTER_SIZE_MIN 64U
+#define BLOOM_FILTER_SIZE_MAX (16U * 1024U * 1024U)        /* 16 MiB */
+
+/* Sample every this many entries of the global entry array in the entry index */
+#define ENTRY_INDEX_STRIDE 128U
+
 #ifdef __clang__
 #  pragma GCC diagnostic ignored "-Waddress-of-packed-member"
 #endif
@@ -391,10 +416,12 @@ JournalFile* journal_file_close(JournalFile *f) {
         mmap_cache_unref(f->mmap);
 
         ordered_hashmap_free_free(f->chain_cache);
+        hashmap_free_free(f->entry_array_tails);
 
 #if HAVE_COMPRESSION
         free(f->compress_buffer);
 #endif
+        compress_dictionary_free(f->compress_dictionary);
 
 #if HAVE_GCRYPT
         if (f->fss_file)
@@ -492,7 +519,7 @@ static bool warn_wrong_flags(const JournalFile *f, bool compatible) {
                                   f->path, type, flags & ~any);
                 flags = (flags & any) & ~supported;
                 if (flags) {
-                        const char* strv[5];
+                        const char* strv[6];
                         unsigned n = 0;
                         _cleanup_free_ char *t = NULL;
 
@@ -508,6 +535,8 @@ static bool warn_wrong_flags(const JournalFile *f, bool compatible) {
                                         strv[n++] = "zstd-compressed";
                                 if (flags & HEADER_INCOMPATIBLE_KEYED_HASH)
                                         strv[n++] = "keyed-hash";
+                                if (flags & HEADER_INCOMPATIBLE_ZSTD_DICTIONARY)
+                                        strv[n++] = "zstd-dictionary";
                         }
                         strv[n] = NULL;
                         assert(n < ELEMENTSOF(strv));
@@ -566,6 +595,12 @@ static int journal_file_verify_header(JournalFile *f) {
             !VALID64(le64toh(f->header->entry_array_offset)))
                 return -ENODATA;
 
+        if (JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) &&
+            (!JOURNAL_HEADER_CONTAINS(f->header, dictionary_id) ||
+             le64toh(f->header->dictionary_offset) == 0 ||
+             !VALID64(le64toh(f->header->dictionary_offset))))
+                return -EBADMSG;
+
         if (f->writable) {
                 sd_id128_t machine_id;
                 uint8_t state;
@@ -764,6 +799,9 @@ static uint64_t minimum_header_size(Object *o) {
                 [OBJECT_FIELD_HASH_TABLE] = sizeof(HashTableObject),
                 [OBJECT_ENTRY_ARRAY] = sizeof(EntryArrayObject),
                 [OBJECT_TAG] = sizeof(TagObject),
+                [OBJECT_DICTIONARY] = sizeof(DictionaryObject),
+                [OBJECT_BLOOM_FILTER] = sizeof(BloomFilterObject),
+                [OBJECT_ENTRY_INDEX] = sizeof(EntryIndexObject),
         };
 
         if (o->object.type >= ELEMENTSOF(table) || table[o->object.type] <= 0)
@@ -915,6 +953,60 @@ static int journal_file_check_object(JournalFile *f, uint64_t offset, Object *o)
                                                le64toh(o->tag.epoch), offset);
 
                 break;
+
+        case OBJECT_DICTIONARY:
+                if (le64toh(o->object.size) <= offsetof(DictionaryObject, payload))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Bad dictionary size (<= %zu): %" PRIu64 ": %" PRIu64,
+                                               offsetof(DictionaryObject, payload),
+                                               le64toh(o->object.size),
+                                               offset);
+
+                if (le32toh(o->dictionary.dictionary_id) == 0)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid dictionary ID 0: %" PRIu64,
+                                               offset);
+
+                break;
+
+        case OBJECT_BLOOM_FILTER: {
+                uint64_t sz;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                if (sz <= offsetof(BloomFilterObject, bits) ||
+                    ((sz - offsetof(BloomFilterObject, bits)) & (sz - offsetof(BloomFilterObject, bits) - 1)) != 0)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid bloom filter size: %" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               offset);
+
+                if (o->bloom_filter.n_hashes <= 0 || o->bloom_filter.n_hashes > BLOOM_FILTER_N_HASHES_MAX)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid number of bloom filter hashes %u: %" PRIu64,
+                                               o->bloom_filter.n_hashes,
+                                               offset);
+
+                break;
+        }
+
+        case OBJECT_ENTRY_INDEX: {
+                uint64_t sz;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                if (sz <= offsetof(EntryIndexObject, items) ||
+                    (sz - offsetof(EntryIndexObject, items)) % sizeof(EntryIndexItem) != 0)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid entry index size: %" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               offset);
+
+                if (le64toh(o->entry_index.stride) <= 0)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid entry index stride: %" PRIu64,
+                                               offset);
+
+                break;
+        }
         }
 
         return 0;
@@ -1084,7 +1176,7 @@ int journal_file_append_object(
         return 0;
 }
 
-static int journal_file_setup_data_hash_table(JournalFile *f) {
+static int journal_file_setup_data_hash_table(JournalFile *f, JournalFile *template) {
         uint64_t s, p;
         Object *o;
         int r;
@@ -1101,6 +1193,24 @@ static int journal_file_setup_data_hash_table(JournalFile *f) {
         if (s < DEFAULT_DATA_HASH_TABLE_SIZE)
                 s = DEFAULT_DATA_HASH_TABLE_SIZE;
 
+        /* If the file we replace ended up with more data objects than that estimate accounts for (i.e. its
+         * fields have a high cardinality), assume the new file will be similar, and size the table so that
+         * the same number of objects stays below the 75% fill level. But never reserve room for more data
+         * objects than fit into a file of the maximum size, in case the limit has been lowered since. */
+        if (template && JOURNAL_HEADER_CONTAINS(template->header, n_data)) {
+                uint64_t n;
+
+                n = le64toh(template->header->n_data);
+                if (f->metrics.max_size > 0)
+                        n = MIN(n, f->metrics.max_size / offsetof(Object, data.payload));
+
+                if (n > s / sizeof(HashItem) * 3 / 4) {
+                        s = MIN(n * 4 / 3 + 1, (uint64_t) UINT32_MAX) * sizeof(HashItem);
+                        log_debug("%s has %"PRIu64" data objects, enlarging the data hash table of %s.",
+                                  template->path, n, f->path);
+                }
+        }
+
         log_debug("Reserving %"PRIu64" entries in data hash table.", s / sizeof(HashItem));
 
         r = journal_file_append_object(f,
@@ -1399,6 +1509,195 @@ uint64_t journal_file_hash_data(
         return jenkins_hash64(data, sz);
 }
 
+static uint64_t bloom_filter_bit(uint64_t hash, unsigned i, uint64_t n_bits) {
+        /* Derive the k hash functions from the two halves of the one we have, as described by Kirsch and
+         * Mitzenmacher. n_bits is a power of two. */
+        return ((hash & UINT32_MAX) + (uint64_t) i * (hash >> 32)) & (n_bits - 1);
+}
+
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash) {
+        uint64_t p, n_bits;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Returns 0 if no data object with the specified hash is in the file, > 0 if there might be one */
+
+        if (!JOURNAL_HEADER_BLOOM_FILTER(f->header) ||
+            !JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                return 1;
+
+        p = le64toh(READ_NOW(f->header->bloom_filter_offset));
+        if (p == 0)
+                return 1;
+
+        r = journal_file_move_to_object(f, OBJECT_BLOOM_FILTER, p, &o);
+        if (r < 0)
+                return r;
+
+        /* Don't trust a filter that doesn't cover all data objects */
+        if (le64toh(o->bloom_filter.n_data) != le64toh(f->header->n_data))
+                return 1;
+
+        n_bits = (le64toh(o->object.size) - offsetof(Object, bloom_filter.bits)) * 8;
+
+        for (unsigned i = 0; i < o->bloom_filter.n_hashes; i++) {
+                uint64_t b;
+
+                b = bloom_filter_bit(hash, i, n_bits);
+                if (!(o->bloom_filter.bits[b / 8] & (1U << (b % 8))))
+                        return 0;
+        }
+
+        return 1;
+}
+
+static int journal_file_append_bloom_filter(JournalFile *f) {
+        uint64_t n_data, n = 0, size, n_bits, m, p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                return 0;
+
+        n_data = le64toh(f->header->n_data);
+        if (n_data == 0)
+                return 0;
+
+        size = DIV_ROUND_UP(n_data * BLOOM_FILTER_BITS_PER_ITEM, 8);
+        if (size > BLOOM_FILTER_SIZE_MAX)
+                return -E2BIG;
+        size = MAX((uint64_t) BLOOM_FILTER_SIZE_MIN, (uint64_t) ALIGN_POWER2(size));
+        n_bits = size * 8;
+
+        r = journal_file_map_data_hash_table(f);
+        if (r < 0)
+                return r;
+
+        r = journal_file_append_object(f, OBJECT_BLOOM_FILTER, offsetof(Object, bloom_filter.bits) + size, &o, &p);
+        if (r < 0)
+                return r;
+
+        o->bloom_filter.n_hashes = BLOOM_FILTER_N_HASHES;
+        memzero(o->bloom_filter.bits, size);
+
+        m = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
+        for (uint64_t i = 0; i < m; i++) {
+                uint64_t q;
+
+                q = le64toh(f->data_hash_table[i].head_hash_offset);
+                while (q != 0) {
+                        Object *d;
+
+                        /* Refuse hash chains with loops */
+                        if (n >= n_data)
+                                return -EBADMSG;
+
+                        r = journal_file_move_to_object(f, OBJECT_DATA, q, &d);
+                        if (r < 0)
+                                return r;
+
+                        for (unsigned k = 0; k < BLOOM_FILTER_N_HASHES; k++) {
+                                uint64_t b;
+
+                                b = bloom_filter_bit(le64toh(d->data.hash), k, n_bits);
+                                o->bloom_filter.bits[b / 8] |= 1U << (b % 8);
+                        }
+
+                        n++;
+                        q = le64toh(d->data.next_hash_offset);
+                }
+        }
+
+        if (n != n_data)
+                return -EBADMSG;
+
+        o->bloom_filter.n_data = htole64(n);
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_BLOOM_FILTER, o, p);
+        if (r < 0)
+                return r;
+#endif
+
+        f->header->bloom_filter_offset = htole64(p);
+        f->header->compatible_flags |= htole32(HEADER_COMPATIBLE_BLOOM_FILTER);
+
+        log_debug("Wrote %"PRIu64" byte bloom filter for %"PRIu64" data objects to %s.", size, n, f->path);
+        return 0;
+}
+
+CompressDictionary* journal_file_get_dictionary(JournalFile *f) {
+        CompressDictionary *d = NULL;
+        uint64_t p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        if (f->compress_dictionary || f->compress_dictionary_broken)
+                return f->compress_dictionary;
+
+        /* The dictionary is referenced from the header only after it has been written completely, hence if a
+         * writer adds it after we opened the file, we'll find it here later. */
+        if (!JOURNAL_HEADER_CONTAINS(f->header, dictionary_id))
+                return NULL;
+
+        p = le64toh(READ_NOW(f->header->dictionary_offset));
+        if (p == 0)
+                return NULL;
+
+        r = journal_file_move_to_object(f, OBJECT_DICTIONARY, p, &o);
+        if (r >= 0)
+                r = compress_dictionary_new(o->dictionary.payload,
+                                            le64toh(o->object.size) - offsetof(Object, dictionary.payload),
+                                            &d);
+        if (r >= 0 && compress_dictionary_id(d) != le32toh(o->dictionary.dictionary_id)) {
+                d = compress_dictionary_free(d);
+                r = -EBADMSG;
+        }
+        if (r < 0) {
+                log_debug_errno(r, "Failed to load compression dictionary of %s, ignoring: %m", f->path);
+                f->compress_dictionary_broken = true;
+                return NULL;
+        }
+
+        return (f->compress_dictionary = d);
+}
+
+#if HAVE_COMPRESSION
+static int journal_file_compress_blob(
+                JournalFile *f,
+                const void *src, uint64_t src_size,
+                void *dst, size_t dst_alloc_size, size_t *dst_size) {
+
+        CompressDictionary *d;
+        int r;
+
+        assert(f);
+
+        /* Dictionaries only exist for zstd */
+        if (f->compress_zstd) {
+                d = journal_file_get_dictionary(f);
+                if (d) {
+                        r = compress_blob_zstd_dict(d, src, src_size, dst, dst_alloc_size, dst_size);
+                        if (r < 0)
+                                return r;
+
+                        return OBJECT_COMPRESSED_ZSTD;
+                }
+        }
+
+        return compress_blob(src, src_size, dst, dst_alloc_size, dst_size);
+}
+#endif
+
 int journal_file_find_field_object(
                 JournalFile *f,
                 const void *field, uint64_t size,
@@ -1414,6 +1713,17 @@ int journal_file_find_field_object(
                         ret, ret_offset);
 }
 
+static void journal_file_account_data_lookup(JournalFile *f, uint64_t depth) {
+        assert(f);
+
+        /* Only writers act on this, see journal_file_rotate_suggested() */
+        if (!f->writable)
+                return;
+
+        f->data_hash_lookups++;
+        f->data_hash_lookup_steps += depth;
+}
+
 int journal_file_find_data_object_with_hash(
                 JournalFile *f,
                 const void *data, uint64_t size, uint64_t hash,
@@ -1430,6 +1740,11 @@ int journal_file_find_data_object_with_hash(
         if (le64toh(f->header->data_hash_table_size) <= 0)
                 return 0;
 
+        /* Archived files may carry a bloom filter, which lets us skip walking the hash chain. */
+        r = journal_file_bloom_filter_test(f, hash);
+        if (r == 0)
+                return 0;
+
         /* Map the data hash table, if it isn't mapped yet. */
         r = journal_file_map_data_hash_table(f);
         if (r < 0)
@@ -1465,14 +1780,17 @@ int journal_file_find_data_object_with_hash(
 
                         l -= offsetof(Object, data.payload);
 
-                        r = decompress_blob(o->object.flags & OBJECT_COMPRESSION_MASK,
-                                            o->data.payload, l, &f->compress_buffer, &f->compress_buffer_size, &rsize, 0);
+                        r = decompress_blob_dict(o->object.flags & OBJECT_COMPRESSION_MASK,
+                                                 journal_file_get_dictionary(f),
+                                                 o->data.payload, l, &f->compress_buffer, &f->compress_buffer_size, &rsize, 0);
                         if (r < 0)
                                 return r;
 
                         if (rsize == size &&
                             memcmp(f->compress_buffer, data, size) == 0) {
 
+                                journal_file_account_data_lookup(f, depth);
+
                                 if (ret)
                                         *ret = o;
 
@@ -1487,6 +1805,8 @@ int journal_file_find_data_object_with_hash(
                 } else if (le64toh(o->object.size) == osize &&
                            memcmp(o->data.payload, data, size) == 0) {
 
+                        journal_file_account_data_lookup(f, depth);
+
                         if (ret)
                                 *ret = o;
 
@@ -1507,6 +1827,7 @@ int journal_file_find_data_object_with_hash(
                         return r;
         }
 
+        journal_file_account_data_lookup(f, depth);
         return 0;
 }
 
@@ -1590,6 +1911,7 @@ static int journal_file_append_field(
 static int journal_file_append_data(
                 JournalFile *f,
                 const void *data, uint64_t size,
+                const JournalPrecompressed *precompressed,
                 Object **ret, uint64_t *ret_offset) {
 
         uint64_t hash, p;
@@ -1628,7 +1950,18 @@ static int journal_file_append_data(
         if (JOURNAL_FILE_COMPRESS(f) && size >= f->compress_threshold_bytes) {
                 size_t rsize = 0;
 
-                compression = compress_blob(data, size, o->data.payload, size - 1, &rsize);
+                if (precompressed && precompressed->compression < 0)
+                        /* The caller already tried, don't bother again */
+                        compression = -EAGAIN;
+                else if (precompressed &&
+                         JOURNAL_FILE_COMPRESSION_ENABLED(f, precompressed->compression) &&
+                         precompressed->size < size) {
+                        /* The caller compressed it for us with an algorithm this file supports */
+                        memcpy(o->data.payload, precompressed->data, precompressed->size);
+                        rsize = precompressed->size;
+                        compression = precompressed->compression;
+                } else
+                        compression = journal_file_compress_blob(f, data, size, o->data.payload, size - 1, &rsize);
 
                 if (compression >= 0) {
                         o->object.size = htole64(offsetof(Object, data.payload) + rsize);
@@ -1732,12 +2065,56 @@ uint64_t journal_file_hash_table_n_items(Object *o) {
         return (sz - offsetof(Object, hash_table.items)) / sizeof(HashItem);
 }
 
+typedef struct EntryArrayTail {
+        uint64_t first; /* the array at the beginning of the chain */
+        uint64_t array; /* the last array of the chain we know of */
+        uint64_t total; /* the total number of items in all arrays before that one */
+} EntryArrayTail;
+
+static void entry_array_tail_put(JournalFile *f, uint64_t first, uint64_t array, uint64_t total) {
+        EntryArrayTail *t;
+
+        assert(f);
+
+        /* Remembers where a chain ends, so that the next append doesn't have to walk the chain from the
+         * beginning. Chains of popular data objects grow long, and the writer would touch each of their
+         * arrays for every single entry otherwise. Entry arrays are only ever appended to, hence this
+         * remains valid for as long as we are the writer of the file, even if the chain grows past it. */
+
+        if (array == first)
+                return;
+
+        t = hashmap_get(f->entry_array_tails, &first);
+        if (!t) {
+                if (hashmap_size(f->entry_array_tails) >= ENTRY_ARRAY_TAILS_MAX)
+                        hashmap_clear_free(f->entry_array_tails);
+
+                if (hashmap_ensure_allocated(&f->entry_array_tails, &uint64_hash_ops) < 0)
+                        return;
+
+                t = new(EntryArrayTail, 1);
+                if (!t)
+                        return;
+
+                t->first = first;
+
+                if (hashmap_put(f->entry_array_tails, &t->first, t) < 0) {
+                        free(t);
+                        return;
+                }
+        }
+
+        t->array = array;
+        t->total = total;
+}
+
 static int link_entry_into_array(JournalFile *f,
                                  le64_t *first,
                                  le64_t *idx,
                                  uint64_t p) {
         int r;
-        uint64_t n = 0, ap = 0, q, i, a, hidx;
+        uint64_t n = 0, ap = 0, q, i, a, hidx, fa, total = 0;
+        EntryArrayTail *t;
         Object *o;
 
         assert(f);
@@ -1746,8 +2123,17 @@ static int link_entry_into_array(JournalFile *f,
         assert(idx);
         assert(p > 0);
 
-        a = le64toh(*first);
+        a = fa = le64toh(*first);
         i = hidx = le64toh(READ_NOW(*idx));
+
+        /* Start with the last array we know of, if there's one */
+        t = a > 0 ? hashmap_get(f->entry_array_tails, &fa) : NULL;
+        if (t && t->total <= i) {
+                a = t->array;
+                i -= t->total;
+                total = t->total;
+        }
+
         while (a > 0) {
 
                 r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &o);
@@ -1758,10 +2144,13 @@ static int link_entry_into_array(JournalFile *f,
                 if (i < n) {
                         o->entry_array.items[i] = htole64(p);
                         *idx = htole64(hidx + 1);
+
+                        entry_array_tail_put(f, fa, a, total);
                         return 0;
                 }
 
                 i -= n;
+                total += n;
                 ap = a;
                 a = le64toh(o->entry_array.next_entry_array_offset);
         }
@@ -1803,6 +2192,9 @@ static int link_entry_into_array(JournalFile *f,
 
         *idx = htole64(hidx + 1);
 
+        if (ap != 0)
+                entry_array_tail_put(f, fa, q, total);
+
         return 0;
 }
 
@@ -2038,11 +2430,37 @@ static int entry_item_cmp(const EntryItem *a, const EntryItem *b) {
         return CMP(le64toh(a->object_offset), le64toh(b->object_offset));
 }
 
-int journal_file_append_entry(
+typedef struct EntryDataCacheItem {
+        /* Points to the caller's memory, which stays valid for the whole batch */
+        struct iovec iovec;
+
+        le64_t object_offset;
+        le64_t hash;
+        uint64_t xor_hash;
+} EntryDataCacheItem;
+
+static void entry_data_cache_item_hash_func(const EntryDataCacheItem *i, struct siphash *state) {
+        assert(i);
+
+        siphash24_compress(&i->iovec.iov_len, sizeof(i->iovec.iov_len), state);
+        siphash24_compress(i->iovec.iov_base, i->iovec.iov_len, state);
+}
+
+static int entry_data_cache_item_compare_func(const EntryDataCacheItem *a, const EntryDataCacheItem *b) {
+        return memcmp_nn(a->iovec.iov_base, a->iovec.iov_len, b->iovec.iov_base, b->iovec.iov_len);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(entry_data_cache_hash_ops,
+                                            EntryDataCacheItem, entry_data_cache_item_hash_func,
+                                            entry_data_cache_item_compare_func, free);
+
+static int journal_file_append_entry_full(
                 JournalFile *f,
                 const dual_timestamp *ts,
                 const sd_id128_t *boot_id,
                 const struct iovec iovec[], unsigned n_iovec,
+                const JournalPrecompressed precompressed[],
+                Set **data_cache,
                 uint64_t *seqnum,
                 Object **ret, uint64_t *ret_offset) {
 
@@ -2080,10 +2498,30 @@ int journal_file_append_entry(
         items = newa(EntryItem, MAX(1u, n_iovec));
 
         for (i = 0; i < n_iovec; i++) {
-                uint64_t p;
+                _cleanup_free_ EntryDataCacheItem *c = NULL;
+                uint64_t p, h;
                 Object *o;
 
-                r = journal_file_append_data(f, iovec[i].iov_base, iovec[i].iov_len, &o, &p);
+                /* If we are appending a batch of entries, the same fields tend to show up in many of them
+                 * (think _PID=, _SYSTEMD_UNIT=, …). Remember what we found for each of them, so that we
+                 * only need to go to the data hash table once per distinct field in the batch. */
+                if (data_cache) {
+                        EntryDataCacheItem *cached;
+
+                        cached = set_get(*data_cache, &(EntryDataCacheItem) { .iovec = iovec[i] });
+                        if (cached) {
+                                items[i] = (EntryItem) {
+                                        .object_offset = cached->object_offset,
+                                        .hash = cached->hash,
+                                };
+                                xor_hash ^= cached->xor_hash;
+                                continue;
+                        }
+                }
+
+                r = journal_file_append_data(f, iovec[i].iov_base, iovec[i].iov_len,
+                                             precompressed ? precompressed + i : NULL,
+                                             &o, &p);
                 if (r < 0)
                         return r;
 
@@ -2097,19 +2535,42 @@ int journal_file_append_entry(
                  * files things are easier, we can just take the value from the stored record directly. */
 
                 if (JOURNAL_HEADER_KEYED_HASH(f->header))
-                        xor_hash ^= jenkins_hash64(iovec[i].iov_base, iovec[i].iov_len);
+                        h = jenkins_hash64(iovec[i].iov_base, iovec[i].iov_len);
                 else
-                        xor_hash ^= le64toh(o->data.hash);
+                        h = le64toh(o->data.hash);
+
+                xor_hash ^= h;
 
                 items[i].object_offset = htole64(p);
                 items[i].hash = o->data.hash;
+
+                if (data_cache) {
+                        c = new(EntryDataCacheItem, 1);
+                        if (!c)
+                                return -ENOMEM;
+
+                        *c = (EntryDataCacheItem) {
+                                .iovec = iovec[i],
+                                .object_offset = items[i].object_offset,
+                                .hash = items[i].hash,
+                                .xor_hash = h,
+                        };
+
+                        r = set_ensure_consume(data_cache, &entry_data_cache_hash_ops, TAKE_PTR(c));
+                        if (r < 0)
+                                return r;
+                }
         }
 
         /* Order by the position on disk, in order to improve seek
          * times for rotating media. */
         typesafe_qsort(items, n_iovec, entry_item_cmp);
 
-        r = journal_file_append_entry_internal(f, ts, boot_id, xor_hash, items, n_iovec, seqnum, ret, ret_offset);
+        return journal_file_append_entry_internal(f, ts, boot_id, xor_hash, items, n_iovec, seqnum, ret, ret_offset);
+}
+
+static int journal_file_append_finish(JournalFile *f, int r) {
+        assert(f);
 
         /* If the memory mapping triggered a SIGBUS then we return an
          * IO error and ignore the error code passed down to us, since
@@ -2127,6 +2588,71 @@ int journal_file_append_entry(
         return r;
 }
 
+int journal_file_append_entry(
+                JournalFile *f,
+                const dual_timestamp *ts,
+                const sd_id128_t *boot_id,
+                const struct iovec iovec[], unsigned n_iovec,
+                uint64_t *seqnum,
+                Object **ret, uint64_t *ret_offset) {
+
+        int r;
+
+        USDT(journal, append_entry, f, f->path, n_iovec);
+
+        r = journal_file_append_entry_full(f, ts, boot_id, iovec, n_iovec, NULL, NULL, seqnum, ret, ret_offset);
+        r = journal_file_append_finish(f, r);
+
+        USDT(journal, append_entry_done, f, r);
+
+        return r;
+}
+
+int journal_file_append_entries(
+                JournalFile *f,
+                const JournalEntryInput entries[], size_t n_entries,
+                const sd_id128_t *boot_id,
+                uint64_t *seqnum,
+                uint64_t ret_offsets[],
+                size_t *ret_n_appended) {
+
+        _cleanup_set_free_ Set *data_cache = NULL;
+        size_t i;
+        int r = 0;
+
+        assert(f);
+        assert(entries || n_entries == 0);
+
+        /* Appends a number of entries in one go. This is equivalent to calling journal_file_append_entry()
+         * for each of them, except that data objects shared between the entries are looked up only once,
+         * and that the SIGBUS check and change notification is done only once for the whole batch. On
+         * failure the number of entries that made it into the file is returned in ret_n_appended, so that
+         * the caller can retry the rest (e.g. after rotating). If ret_offsets is non-NULL it has to have
+         * room for n_entries items, and receives the offset of each entry appended. */
+
+        USDT(journal, append_entries, f, f->path, n_entries);
+
+        for (i = 0; i < n_entries; i++) {
+                r = journal_file_append_entry_full(f, &entries[i].ts, boot_id,
+                                                   entries[i].iovec, entries[i].n_iovec,
+                                                   entries[i].precompressed,
+                                                   &data_cache, seqnum, NULL,
+                                                   ret_offsets ? ret_offsets + i : NULL);
+                if (r < 0)
+                        break;
+        }
+
+        if (ret_n_appended)
+                *ret_n_appended = i;
+
+        if (n_entries > 0)
+                r = journal_file_append_finish(f, r);
+
+        USDT(journal, append_entries_done, f, i, r);
+
+        return r;
+}
+
 typedef struct ChainCacheItem {
         uint64_t first; /* the array at the beginning of the chain */
         uint64_t array; /* the cached array */
@@ -2572,6 +3098,261 @@ _pure_ static int test_object_offset(JournalFile *f, uint64_t p, uint64_t needle
                 return TEST_RIGHT;
 }
 
+static int journal_file_append_entry_index(JournalFile *f) {
+        uint64_t n_entries, n_items = 0, i, k, a, q;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, entry_index_offset))
+                return 0;
+
+        n_entries = le64toh(f->header->n_entries);
+        if (n_entries == 0)
+                return 0;
+
+        /* First count the samples we need: one per started stride in each entry array, so that the entries
+         * between two samples are always in the same array. */
+        for (a = le64toh(f->header->entry_array_offset), i = 0; i < n_entries; ) {
+                Object *array;
+                uint64_t m;
+
+                if (a == 0)
+                        return -EBADMSG;
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &array);
+                if (r < 0)
+                        return r;
+
+                m = MIN(journal_file_entry_array_n_items(array), n_entries - i);
+                if (m == 0 || m > UINT32_MAX)
+                        return -EBADMSG;
+
+                n_items += DIV_ROUND_UP(m, ENTRY_INDEX_STRIDE);
+                i += m;
+                a = le64toh(array->entry_array.next_entry_array_offset);
+        }
+
+        r = journal_file_append_object(f, OBJECT_ENTRY_INDEX,
+                                       offsetof(Object, entry_index.items) + n_items * sizeof(EntryIndexItem),
+                                       &o, &q);
+        if (r < 0)
+                return r;
+
+        o->entry_index.n_entries = htole64(n_entries);
+        o->entry_index.stride = htole64(ENTRY_INDEX_STRIDE);
+
+        for (a = le64toh(f->header->entry_array_offset), i = 0, k = 0; i < n_entries; ) {
+                Object *array;
+                uint64_t m;
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &array);
+                if (r < 0)
+                        return r;
+
+                m = MIN(journal_file_entry_array_n_items(array), n_entries - i);
+
+                for (uint64_t j = 0; j < m; j += ENTRY_INDEX_STRIDE) {
+                        Object *e;
+
+                        if (k >= n_items)
+                                return -EBADMSG;
+
+                        r = journal_file_move_to_object(f, OBJECT_ENTRY, le64toh(array->entry_array.items[j]), &e);
+                        if (r < 0)
+                                return r;
+
+                        o->entry_index.items[k++] = (EntryIndexItem) {
+                                .seqnum = e->entry.seqnum,
+                                .realtime = e->entry.realtime,
+                                .entry_array_offset = htole64(a),
+                                .index = htole32(j),
+                                .n = htole32(MIN((uint64_t) ENTRY_INDEX_STRIDE, m - j)),
+                        };
+                }
+
+                i += m;
+                a = le64toh(array->entry_array.next_entry_array_offset);
+        }
+
+        if (k != n_items)
+                return -EBADMSG;
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_ENTRY_INDEX, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        f->header->entry_index_offset = htole64(q);
+        f->header->compatible_flags |= htole32(HEADER_COMPATIBLE_ENTRY_INDEX);
+
+        log_debug("Wrote entry index with %"PRIu64" samples for %"PRIu64" entries to %s.", n_items, n_entries, f->path);
+        return 0;
+}
+
+static int entry_index_item_entry(JournalFile *f, const EntryIndexItem *item, uint64_t *ret) {
+        Object *array;
+        int r;
+
+        assert(f);
+        assert(item);
+        assert(ret);
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, le64toh(item->entry_array_offset), &array);
+        if (r < 0)
+                return r;
+
+        if (le32toh(item->n) <= 0 ||
+            (uint64_t) le32toh(item->index) + le32toh(item->n) > journal_file_entry_array_n_items(array))
+                return -EBADMSG;
+
+        *ret = le64toh(array->entry_array.items[le32toh(item->index)]);
+        return 0;
+}
+
+static uint64_t entry_index_item_seqnum(const EntryIndexItem *item) {
+        return le64toh(item->seqnum);
+}
+
+static uint64_t entry_index_item_realtime(const EntryIndexItem *item) {
+        return le64toh(item->realtime);
+}
+
+static int journal_file_move_to_entry_by_index(
+                JournalFile *f,
+                uint64_t needle,
+                uint64_t (*item_key)(const EntryIndexItem *item),
+                int (*test_object)(JournalFile *f, uint64_t p, uint64_t needle),
+                direction_t direction,
+                Object **ret,
+                uint64_t *ret_offset) {
+
+        uint64_t q, n, left, right, p, first, end;
+        const EntryIndexItem *item;
+        Object *o, *array;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(item_key);
+        assert(test_object);
+
+        /* Looks up an entry like generic_array_bisect() on the global entry array does, but uses the entry
+         * index of archived files to narrow the search down to a single stride of one entry array
+         * first. Since the index is stored contiguously this touches far fewer pages. Returns -EOPNOTSUPP
+         * if the file has no usable index. */
+
+        if (!JOURNAL_HEADER_ENTRY_INDEX(f->header) ||
+            !JOURNAL_HEADER_CONTAINS(f->header, entry_index_offset))
+                return -EOPNOTSUPP;
+
+        q = le64toh(READ_NOW(f->header->entry_index_offset));
+        if (q == 0)
+                return -EOPNOTSUPP;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY_INDEX, q, &o);
+        if (r < 0)
+                return r;
+
+        if (le64toh(o->entry_index.n_entries) != le64toh(f->header->n_entries))
+                return -EOPNOTSUPP;
+
+        n = (le64toh(o->object.size) - offsetof(Object, entry_index.items)) / sizeof(EntryIndexItem);
+
+        /* Count the samples left of the needle. When looking for the first entry at or after the needle the
+         * ones matching it exactly are right of it, when looking for the last entry at or before the needle
+         * they are left of it. */
+        left = 0;
+        right = n;
+        while (left < right) {
+                uint64_t i = (left + right) / 2, k;
+
+                k = item_key(o->entry_index.items + i);
+                if (k < needle || (direction == DIRECTION_UP && k == needle))
+                        left = i + 1;
+                else
+                        right = i;
+        }
+
+        if (left == 0) {
+                /* Everything is right of the needle */
+                if (direction == DIRECTION_UP)
+                        return 0;
+
+                r = entry_index_item_entry(f, o->entry_index.items, &p);
+                if (r < 0)
+                        return r;
+
+                goto found;
+        }
+
+        /* The entry we are looking for is within the stride of this sample, or it is the first entry of the
+         * next sample */
+        item = o->entry_index.items + left - 1;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, le64toh(item->entry_array_offset), &array);
+        if (r < 0)
+                return r;
+
+        first = le32toh(item->index);
+        end = first + le32toh(item->n);
+        if (end <= first || end > journal_file_entry_array_n_items(array))
+                return -EBADMSG;
+
+        /* The sample itself is left of the needle, bisect the rest of the stride */
+        left = first + 1;
+        right = end;
+        while (left < right) {
+                uint64_t i = (left + right) / 2;
+
+                p = le64toh(array->entry_array.items[i]);
+                if (p <= 0)
+                        return -EBADMSG;
+
+                r = test_object(f, p, needle);
+                if (r < 0)
+                        return r;
+
+                if (r == TEST_FOUND)
+                        r = direction == DIRECTION_DOWN ? TEST_RIGHT : TEST_LEFT;
+
+                if (r == TEST_RIGHT)
+                        right = i;
+                else
+                        left = i + 1;
+        }
+
+        if (direction == DIRECTION_UP)
+                p = le64toh(array->entry_array.items[left - 1]);
+        else if (left < end)
+                p = le64toh(array->entry_array.items[left]);
+        else if (item + 1 < o->entry_index.items + n) {
+                r = entry_index_item_entry(f, item + 1, &p);
+                if (r < 0)
+                        return r;
+        } else
+                return 0;
+
+found:
+        if (p <= 0)
+                return -EBADMSG;
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY, p, &o);
+        if (r < 0)
+                return r;
+
+        if (ret)
+                *ret = o;
+
+        if (ret_offset)
+                *ret_offset = p;
+
+        return 1;
+}
+
 static int test_object_seqnum(JournalFile *f, uint64_t p, uint64_t needle) {
         uint64_t sq;
         Object *o;
@@ -2599,9 +3380,18 @@ int journal_file_move_to_entry_by_seqnum(
                 direction_t direction,
                 Object **ret,
                 uint64_t *ret_offset) {
+
+        int r;
+
         assert(f);
         assert(f->header);
 
+        r = journal_file_move_to_entry_by_index(f, seqnum, entry_index_item_seqnum, test_object_seqnum, direction, ret, ret_offset);
+        if (r >= 0)
+                return r;
+        if (r != -EOPNOTSUPP)
+                log_debug_errno(r, "Failed to look up seqnum in entry index of %s, ignoring: %m", f->path);
+
         return generic_array_bisect(
                         f,
                         le64toh(f->header->entry_array_offset),
@@ -2639,9 +3429,18 @@ int journal_file_move_to_entry_by_realtime(
                 direction_t direction,
                 Object **ret,
                 uint64_t *ret_offset) {
+
+        int r;
+
         assert(f);
         assert(f->header);
 
+        r = journal_file_move_to_entry_by_index(f, realtime, entry_index_item_realtime, test_object_realtime, direction, ret, ret_offset);
+        if (r >= 0)
+                return r;
+        if (r != -EOPNOTSUPP)
+                log_debug_errno(r, "Failed to look up realtime in entry index of %s, ignoring: %m", f->path);
+
         return generic_array_bisect(
                         f,
                         le64toh(f->header->entry_array_offset),
@@ -3176,6 +3975,26 @@ void journal_file_dump(JournalFile *f) {
                                le64toh(o->tag.epoch));
                         break;
 
+                case OBJECT_DICTIONARY:
+                        printf("Type: OBJECT_DICTIONARY id=%"PRIu32" size=%"PRIu64"\n",
+                               le32toh(o->dictionary.dictionary_id),
+                               le64toh(o->object.size) - offsetof(Object, dictionary.payload));
+                        break;
+
+                case OBJECT_BLOOM_FILTER:
+                        printf("Type: OBJECT_BLOOM_FILTER n_data=%"PRIu64" n_hashes=%u size=%"PRIu64"\n",
+                               le64toh(o->bloom_filter.n_data),
+                               o->bloom_filter.n_hashes,
+                               le64toh(o->object.size) - offsetof(Object, bloom_filter.bits));
+                        break;
+
+                case OBJECT_ENTRY_INDEX:
+                        printf("Type: OBJECT_ENTRY_INDEX n_entries=%"PRIu64" stride=%"PRIu64" n_items=%"PRIu64"\n",
+                               le64toh(o->entry_index.n_entries),
+                               le64toh(o->entry_index.stride),
+                               (le64toh(o->object.size) - offsetof(Object, entry_index.items)) / sizeof(EntryIndexItem));
+                        break;
+
                 default:
                         printf("Type: unknown (%i)\n", o->object.type);
                         break;
@@ -3220,8 +4039,8 @@ void journal_file_print_header(JournalFile *f) {
                "Boot ID: %s\n"
                "Sequential number ID: %s\n"
                "State: %s\n"
-               "Compatible flags:%s%s\n"
-               "Incompatible flags:%s%s%s%s%s\n"
+               "Compatible flags:%s%s%s%s\n"
+               "Incompatible flags:%s%s%s%s%s%s\n"
                "Header size: %"PRIu64"\n"
                "Arena size: %"PRIu64"\n"
                "Data hash table size: %"PRIu64"\n"
@@ -3243,11 +4062,14 @@ void journal_file_print_header(JournalFile *f) {
                f->header->state == STATE_ONLINE ? "ONLINE" :
                f->header->state == STATE_ARCHIVED ? "ARCHIVED" : "UNKNOWN",
                JOURNAL_HEADER_SEALED(f->header) ? " SEALED" : "",
+               JOURNAL_HEADER_BLOOM_FILTER(f->header) ? " BLOOM-FILTER" : "",
+               JOURNAL_HEADER_ENTRY_INDEX(f->header) ? " ENTRY-INDEX" : "",
                (le32toh(f->header->compatible_flags) & ~HEADER_COMPATIBLE_ANY) ? " ???" : "",
                JOURNAL_HEADER_COMPRESSED_XZ(f->header) ? " COMPRESSED-XZ" : "",
                JOURNAL_HEADER_COMPRESSED_LZ4(f->header) ? " COMPRESSED-LZ4" : "",
                JOURNAL_HEADER_COMPRESSED_ZSTD(f->header) ? " COMPRESSED-ZSTD" : "",
                JOURNAL_HEADER_KEYED_HASH(f->header) ? " KEYED-HASH" : "",
+               JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) ? " ZSTD-DICTIONARY" : "",
                (le32toh(f->header->incompatible_flags) & ~HEADER_INCOMPATIBLE_ANY) ? " ???" : "",
                le64toh(f->header->header_size),
                le64toh(f->header->arena_size),
@@ -3289,6 +4111,22 @@ void journal_file_print_header(JournalFile *f) {
                 printf("Deepest data hash chain: %" PRIu64"\n",
                        f->header->data_hash_chain_depth);
 
+        if (JOURNAL_HEADER_CONTAINS(f->header, dictionary_id) &&
+            le64toh(f->header->dictionary_offset) != 0)
+                printf("Compression dictionary: %"PRIu32" (at "OFSfmt")\n",
+                       le32toh(f->header->dictionary_id),
+                       le64toh(f->header->dictionary_offset));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            le64toh(f->header->bloom_filter_offset) != 0)
+                printf("Bloom filter: "OFSfmt"\n",
+                       le64toh(f->header->bloom_filter_offset));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, entry_index_offset) &&
+            le64toh(f->header->entry_index_offset) != 0)
+                printf("Entry index: "OFSfmt"\n",
+                       le64toh(f->header->entry_index_offset));
+
         if (fstat(f->fd, &st) >= 0)
                 printf("Disk usage: %s\n", format_bytes(bytes, sizeof(bytes), (uint64_t) st.st_blocks * 512ULL));
 }
@@ -3328,6 +4166,170 @@ static int journal_file_warn_btrfs(JournalFile *f) {
         return 1;
 }
 
+static bool journal_file_use_dictionary(void) {
+        static int cached = -1;
+        int r;
+
+        if (!HAVE_ZSTD)
+                return false;
+
+        if (cached >= 0)
+                return cached;
+
+        r = getenv_bool("SYSTEMD_JOURNAL_COMPRESS_DICTIONARY");
+        if (r < 0) {
+                if (r != -ENXIO)
+                        log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_COMPRESS_DICTIONARY environment variable, ignoring.");
+                cached = true;
+        } else
+                cached = r;
+
+        return cached;
+}
+
+static int journal_file_train_dictionary(JournalFile *f, JournalFile *template, void **ret, size_t *ret_size) {
+        _cleanup_free_ uint8_t *samples = NULL;
+        _cleanup_free_ size_t *sizes = NULL;
+        size_t n_samples = 0, sizes_allocated = 0, samples_size = 0, samples_allocated = 0;
+        uint64_t p, end;
+        int r;
+
+        assert(f);
+        assert(template);
+        assert(ret);
+        assert(ret_size);
+
+        /* Collect the payload of data objects that would be compressed in the new file, from the start of
+         * the old one, until we have enough of them or looked far enough. */
+        p = le64toh(template->header->header_size);
+        end = le64toh(template->header->tail_object_offset);
+        if (end == 0)
+                return -ENODATA;
+        end = MIN(end, p + DICTIONARY_SCAN_SIZE_MAX);
+
+        while (p <= end && samples_size < DICTIONARY_SAMPLES_SIZE_MAX) {
+                const void *data;
+                uint64_t l;
+                Object *o;
+
+                r = journal_file_move_to_object(template, OBJECT_UNUSED, p, &o);
+                if (r < 0)
+                        return r;
+
+                p += ALIGN64(le64toh(o->object.size));
+
+                if (o->object.type != OBJECT_DATA)
+                        continue;
+
+                l = le64toh(o->object.size) - offsetof(Object, data.payload);
+
+                if (o->object.flags & OBJECT_COMPRESSION_MASK) {
+#if HAVE_COMPRESSION
+                        size_t rsize = 0;
+
+                        r = decompress_blob_dict(o->object.flags & OBJECT_COMPRESSION_MASK,
+                                                 journal_file_get_dictionary(template),
+                                                 o->data.payload, l,
+                                                 &template->compress_buffer, &template->compress_buffer_size, &rsize, 0);
+                        if (r < 0)
+                                continue;
+
+                        data = template->compress_buffer;
+                        l = rsize;
+#else
+                        continue;
+#endif
+                } else
+                        data = o->data.payload;
+
+                if (l < f->compress_threshold_bytes || l > DICTIONARY_SAMPLE_SIZE_MAX)
+                        continue;
+
+                if (!GREEDY_REALLOC(sizes, sizes_allocated, n_samples + 1) ||
+                    !GREEDY_REALLOC(samples, samples_allocated, samples_size + l))
+                        return -ENOMEM;
+
+                memcpy(samples + samples_size, data, l);
+                samples_size += l;
+                sizes[n_samples++] = l;
+        }
+
+        log_debug("Training compression dictionary from %zu samples (%zu bytes) of %s.",
+                  n_samples, samples_size, template->path);
+
+        if (n_samples == 0)
+                return -ENODATA;
+
+        return compress_dictionary_train(samples, sizes, n_samples, DICTIONARY_SIZE_MAX, ret, ret_size);
+}
+
+static int journal_file_setup_dictionary(JournalFile *f, JournalFile *template) {
+        _cleanup_(compress_dictionary_freep) CompressDictionary *d = NULL;
+        _cleanup_free_ void *trained = NULL;
+        const void *data;
+        size_t size;
+        uint64_t p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(template);
+
+        /* Short messages hardly compress on their own, but do a lot better with a dictionary trained on
+         * what this system usually logs. Train one from the file we are replacing, and if it doesn't carry
+         * enough data for that, inherit its dictionary, if it has one. */
+        r = journal_file_train_dictionary(f, template, &trained, &size);
+        if (r >= 0)
+                data = trained;
+        else {
+                CompressDictionary *old;
+
+                old = journal_file_get_dictionary(template);
+                if (!old)
+                        return r;
+
+                log_debug_errno(r, "Failed to train compression dictionary, reusing the one of %s: %m", template->path);
+                compress_dictionary_get_data(old, &data, &size);
+        }
+
+        r = compress_dictionary_new(data, size, &d);
+        if (r < 0)
+                return r;
+
+        r = journal_file_append_object(f, OBJECT_DICTIONARY, offsetof(Object, dictionary.payload) + size, &o, &p);
+        if (r < 0)
+                return r;
+
+        o->dictionary.dictionary_id = htole32(compress_dictionary_id(d));
+        memcpy(o->dictionary.payload, data, size);
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_DICTIONARY, o, p);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Only link it up once it is fully written */
+        f->header->dictionary_id = htole32(compress_dictionary_id(d));
+        f->header->dictionary_offset = htole64(p);
+        f->header->incompatible_flags |= htole32(HEADER_INCOMPATIBLE_ZSTD_DICTIONARY);
+
+        log_debug("Using %zu byte compression dictionary %"PRIu32" for %s.",
+                  size, compress_dictionary_id(d), f->path);
+
+        f->compress_dictionary = TAKE_PTR(d);
+        return 0;
+}
+
+uint64_t journal_file_compress_threshold(uint64_t compress_threshold_bytes) {
+        /* Maps the configured threshold, (uint64_t) -1 for the default, to the one actually used */
+        if (compress_threshold_bytes == (uint64_t) -1)
+                return DEFAULT_COMPRESS_THRESHOLD;
+
+        return MAX(MIN_COMPRESS_THRESHOLD, compress_threshold_bytes);
+}
+
 int journal_file_open(
                 int fd,
                 const char *fname,
@@ -3375,9 +4377,7 @@ int journal_file_open(
 #elif HAVE_XZ
                 .compress_xz = compress,
 #endif
-                .compress_threshold_bytes = compress_threshold_bytes == (uint64_t) -1 ?
-                                            DEFAULT_COMPRESS_THRESHOLD :
-                                            MAX(MIN_COMPRESS_THRESHOLD, compress_threshold_bytes),
+                .compress_threshold_bytes = journal_file_compress_threshold(compress_threshold_bytes),
 #if HAVE_GCRYPT
                 .seal = seal,
 #endif
@@ -3563,7 +4563,7 @@ int journal_file_open(
                 if (r < 0)
                         goto fail;
 
-                r = journal_file_setup_data_hash_table(f);
+                r = journal_file_setup_data_hash_table(f, template);
                 if (r < 0)
                         goto fail;
 
@@ -3572,6 +4572,12 @@ int journal_file_open(
                 if (r < 0)
                         goto fail;
 #endif
+
+                if (template && f->compress_zstd && journal_file_use_dictionary()) {
+                        r = journal_file_setup_dictionary(f, template);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to set up compression dictionary for %s, ignoring: %m", f->path);
+                }
         }
 
         if (mmap_cache_got_sigbus(f->mmap, f->cache_fd)) {
@@ -3606,6 +4612,7 @@ fail:
 
 int journal_file_archive(JournalFile *f) {
         _cleanup_free_ char *p = NULL;
+        int r;
 
         assert(f);
 
@@ -3635,6 +4642,16 @@ int journal_file_archive(JournalFile *f) {
         /* Sync the rename to disk */
         (void) fsync_directory_of_file(f->fd);
 
+        /* No more data is going to be added, hence let readers skip the file quickly when looking for data
+         * that isn't in it */
+        r = journal_file_append_bloom_filter(f);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write bloom filter to %s, ignoring: %m", p);
+
+        r = journal_file_append_entry_index(f);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write entry index to %s, ignoring: %m", p);
+
         /* Set as archive so offlining commits w/state=STATE_ARCHIVED. Previously we would set old_file->header->state
          * to STATE_ARCHIVED directly here, but journal_file_set_offline() short-circuits when state != STATE_ONLINE,
          * which would result in the rotated journal never getting fsync() called before closing.  Now we simply queue
@@ -3848,8 +4865,9 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
 #if HAVE_COMPRESSION
                         size_t rsize = 0;
 
-                        r = decompress_blob(o->object.flags & OBJECT_COMPRESSION_MASK,
-                                            o->data.payload, l, &from->compress_buffer, &from->compress_buffer_size, &rsize, 0);
+                        r = decompress_blob_dict(o->object.flags & OBJECT_COMPRESSION_MASK,
+                                                 journal_file_get_dictionary(from),
+                                                 o->data.payload, l, &from->compress_buffer, &from->compress_buffer_size, &rsize, 0);
                         if (r < 0)
                                 return r;
 
@@ -3861,7 +4879,7 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
                 } else
                         data = o->data.payload;
 
-                r = journal_file_append_data(to, data, l, &u, &h);
+                r = journal_file_append_data(to, data, l, NULL, &u, &h);
                 if (r < 0)
                         return r;
 
@@ -4098,6 +5116,15 @@ bool journal_file_rotate_suggested(JournalFile *f, usec_t max_file_usec) {
                 return true;
         }
 
+        /* A single long chain is tolerable, but if lookups have to follow many links on average the hash
+         * table is too small for the data in this file, and every write pays for it. */
+        if (f->data_hash_lookups >= HASH_CHAIN_LOOKUPS_MIN &&
+            f->data_hash_lookup_steps > f->data_hash_lookups * HASH_CHAIN_DEPTH_AVG_MAX) {
+                log_debug("Data hash table lookups in %s follow %.1f chain links on average (%"PRIu64" lookups), suggesting rotation.",
+                          f->path, (double) f->data_hash_lookup_steps / (double) f->data_hash_lookups, f->data_hash_lookups);
+                return true;
+        }
+
         /* Are the data objects properly indexed by field objects? */
         if (JOURNAL_HEADER_CONTAINS(f->header, n_data) &&
             JOURNAL_HEADER_CONTAINS(f->header, n_fields) &&
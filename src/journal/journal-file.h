@@ -11,6 +11,7 @@
 #include "sd-event.h"
 #include "sd-id128.h"
 
+#include "compress.h"
 #include "hashmap.h"
 #include "journal-def.h"
 #include "mmap-cache.h"
@@ -73,10 +74,12 @@ typedef struct JournalFile {
         bool close_fd:1;
         bool archive:1;
         bool keyed_hash:1;
+        bool compress_dictionary_broken:1;
 
         direction_t last_direction;
         LocationType location_type;
         uint64_t last_n_entries;
+        unsigned location_prioq_idx;
 
         char *path;
         struct stat last_stat;
@@ -100,6 +103,11 @@ typedef struct JournalFile {
         usec_t post_change_timer_period;
 
         OrderedHashmap *chain_cache;
+        Hashmap *entry_array_tails; /* writers only: first entry array of a chain → its last one */
+
+        /* Data hash table lookups done through this object, and the chain links they followed in total */
+        uint64_t data_hash_lookups;
+        uint64_t data_hash_lookup_steps;
 
         pthread_t offline_thread;
         volatile OfflineState offline_state;
@@ -111,6 +119,8 @@ typedef struct JournalFile {
         void *compress_buffer;
         size_t compress_buffer_size;
 #endif
+        /* Loaded on first use, see journal_file_get_dictionary() */
+        CompressDictionary *compress_dictionary;
 
 #if HAVE_GCRYPT
         gcry_md_hd_t hmac;
@@ -191,6 +201,12 @@ static inline bool VALID_EPOCH(uint64_t u) {
 #define JOURNAL_HEADER_SEALED(h) \
         FLAGS_SET(le32toh((h)->compatible_flags), HEADER_COMPATIBLE_SEALED)
 
+#define JOURNAL_HEADER_BLOOM_FILTER(h) \
+        FLAGS_SET(le32toh((h)->compatible_flags), HEADER_COMPATIBLE_BLOOM_FILTER)
+
+#define JOURNAL_HEADER_ENTRY_INDEX(h) \
+        FLAGS_SET(le32toh((h)->compatible_flags), HEADER_COMPATIBLE_ENTRY_INDEX)
+
 #define JOURNAL_HEADER_COMPRESSED_XZ(h) \
         FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_COMPRESSED_XZ)
 
@@ -203,6 +219,9 @@ static inline bool VALID_EPOCH(uint64_t u) {
 #define JOURNAL_HEADER_KEYED_HASH(h) \
         FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_KEYED_HASH)
 
+#define JOURNAL_HEADER_ZSTD_DICTIONARY(h) \
+        FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_ZSTD_DICTIONARY)
+
 int journal_file_move_to_object(JournalFile *f, ObjectType type, uint64_t offset, Object **ret);
 
 uint64_t journal_file_entry_n_items(Object *o) _pure_;
@@ -219,6 +238,32 @@ int journal_file_append_entry(
                 Object **ret,
                 uint64_t *offset);
 
+/* A data payload that was already compressed by the caller, e.g. in a worker thread. compression is one of
+ * OBJECT_COMPRESSED_XZ, _LZ4, _ZSTD, or negative if compressing was attempted and didn't help, in which case
+ * the payload is stored uncompressed without trying again. 0 means nothing is known. */
+typedef struct JournalPrecompressed {
+        int compression;
+        const void *data;
+        size_t size;
+} JournalPrecompressed;
+
+typedef struct JournalEntryInput {
+        dual_timestamp ts;
+        const struct iovec *iovec;
+        unsigned n_iovec;
+
+        /* Optional, if non-NULL an array with one item for each iovec */
+        const JournalPrecompressed *precompressed;
+} JournalEntryInput;
+
+int journal_file_append_entries(
+                JournalFile *f,
+                const JournalEntryInput entries[], size_t n_entries,
+                const sd_id128_t *boot_id,
+                uint64_t *seqno,
+                uint64_t ret_offsets[],
+                size_t *ret_n_appended);
+
 int journal_file_find_data_object(JournalFile *f, const void *data, uint64_t size, Object **ret, uint64_t *offset);
 int journal_file_find_data_object_with_hash(JournalFile *f, const void *data, uint64_t size, uint64_t hash, Object **ret, uint64_t *offset);
 
@@ -250,6 +295,8 @@ int journal_file_archive(JournalFile *f);
 JournalFile* journal_initiate_close(JournalFile *f, Set *deferred_closes);
 int journal_file_rotate(JournalFile **f, bool compress, uint64_t compress_threshold_bytes, bool seal, Set *deferred_closes);
 
+uint64_t journal_file_compress_threshold(uint64_t compress_threshold_bytes);
+
 int journal_file_dispose(int dir_fd, const char *fname);
 
 void journal_file_post_change(JournalFile *f);
@@ -271,4 +318,23 @@ static inline bool JOURNAL_FILE_COMPRESS(JournalFile *f) {
         return f->compress_xz || f->compress_lz4 || f->compress_zstd;
 }
 
+static inline bool JOURNAL_FILE_COMPRESSION_ENABLED(JournalFile *f, int compression) {
+        assert(f);
+
+        switch (compression) {
+        case OBJECT_COMPRESSED_XZ:
+                return f->compress_xz;
+        case OBJECT_COMPRESSED_LZ4:
+                return f->compress_lz4;
+        case OBJECT_COMPRESSED_ZSTD:
+                return f->compress_zstd;
+        default:
+                return false;
+        }
+}
+
 uint64_t journal_file_hash_data(JournalFile *f, const void *data, size_t sz);
+
+CompressDictionary* journal_file_get_dictionary(JournalFile *f);
+
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash);
@@ -11,7 +11,9 @@
 #include "hashmap.h"
 #include "journal-def.h"
 #include "journal-file.h"
+#include "journal-tail.h"
 #include "list.h"
+#include "prioq.h"
 #include "set.h"
 
 typedef struct Match Match;
@@ -80,8 +82,22 @@ struct sd_journal {
         JournalFile *current_file;
         uint64_t current_field;
 
+        /* All files that have a candidate entry for the next iteration step, ordered by that entry's location
+         * in files_by_location_direction. Files that hit the end and may still grow are kept in
+         * files_at_tail instead. Only trustworthy while files_by_location_valid is set. */
+        Prioq *files_by_location;
+        Set *files_at_tail;
+        direction_t files_by_location_direction;
+        bool files_by_location_valid;
+
         Match *level0, *level1, *level2;
 
+        /* journald's cache of the most recent entries, to follow the tail without going through the files.
+         * If tail_entry is set, the current entry came from there rather than from current_file. */
+        JournalTail *tail;
+        const JournalTailEntry *tail_entry;
+        usec_t tail_checked_usec;
+
         pid_t original_pid;
 
         int inotify_fd;
@@ -113,8 +129,11 @@ struct sd_journal {
         bool fields_file_lost:1;
         bool has_runtime_files:1;
         bool has_persistent_files:1;
+        bool tail_used:1;   /* Entries were taken from the tail cache since the files were moved last */
+        bool tail_forced:1; /* The tail cache was set with journal_set_tail_cache() */
 
         size_t data_threshold;
+        Set *data_fields; /* If not empty, only these fields are returned by sd_journal_enumerate_data() */
 
         Hashmap *directories_by_path;
         Hashmap *directories_by_wd;
@@ -125,9 +144,16 @@ struct sd_journal {
 char *journal_make_match_string(sd_journal *j);
 void journal_print_header(sd_journal *j);
 
+int journal_enumerate_data_filtered(sd_journal *j, const Set *fields, const void **data, size_t *size);
+
+int journal_set_tail_cache(sd_journal *j, const char *path);
+
 #define JOURNAL_FOREACH_DATA_RETVAL(j, data, l, retval)                     \
         for (sd_journal_restart_data(j); ((retval) = sd_journal_enumerate_data((j), &(data), &(l))) > 0; )
 
+#define JOURNAL_FOREACH_DATA_FILTERED_RETVAL(j, fields, data, l, retval)     \
+        for (sd_journal_restart_data(j); ((retval) = journal_enumerate_data_filtered((j), (fields), &(data), &(l))) > 0; )
+
 /* All errors that we might encounter while extracting a field that are not real errors,
  * but only mean that the field is too large or we don't support the compression. */
 static inline bool JOURNAL_ERRNO_IS_UNAVAILABLE_FIELD(int r) {
@@ -0,0 +1,577 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "journal-tail.h"
+#include "memory-util.h"
+#include "string-util.h"
+#include "tmpfile-util.h"
+#include "unaligned.h"
+
+/* The tail cache file consists of a header followed by a ring buffer of records, one for each entry. The
+ * file never leaves the machine, hence everything is in host byte order.
+ *
+ * There's a single writer (journald) and any number of readers, without any locking. Positions in the ring
+ * are given as logical offsets that only ever grow, the physical position is the offset modulo the size of
+ * the ring. Records never wrap around the end of the ring, the space left there is skipped. Before the
+ * writer overwrites the oldest records it moves 'begin' beyond them, and it moves 'end' only after the new
+ * record is complete. Readers copy a record out first and check that it's still after 'begin'
+ * afterwards, and otherwise disregard what they read. */
+
+#define TAIL_SIGNATURE ((const uint8_t[]) { 'J', 'R', 'N', 'L', 'T', 'A', 'I', 'L' })
+
+/* Entries larger than this fraction of the ring are not added, readers get them from the journal files.
+ * Instead, a record without payload is left in their place, with payload_size set to TAIL_PAYLOAD_MISSING,
+ * so that readers notice the gap right away, rather than only once the next entry is added. */
+#define TAIL_RECORD_SIZE_MAX(ring_size) ((ring_size) / 4)
+#define TAIL_PAYLOAD_MISSING UINT64_MAX
+
+#define TAIL_SIZE_MIN (64U * 1024U)
+#define TAIL_SIZE_MAX (256U * 1024U * 1024U)
+
+enum {
+        TAIL_OFFLINE,
+        TAIL_ONLINE,
+};
+
+typedef struct TailHeader {
+        uint8_t signature[8];
+        uint32_t state;
+        uint32_t header_size;
+        uint64_t ring_size;
+        uint64_t begin;         /* offset of the oldest record */
+        uint64_t end;           /* offset after the newest record */
+} TailHeader;
+
+typedef struct TailRecord {
+        uint64_t size;          /* of the whole record, including padding */
+        uint64_t seqnum;        /* 0 if this is just padding up to the end of the ring */
+        sd_id128_t seqnum_id;
+        uint64_t realtime;
+        uint64_t monotonic;
+        sd_id128_t boot_id;
+        uint64_t xor_hash;
+        uint64_t payload_size;
+        uint8_t payload[];      /* the fields, in journal export format */
+} TailRecord;
+
+typedef struct TailBuffer {
+        struct iovec *fields;
+        size_t fields_allocated;
+        uint8_t *data;
+        size_t data_allocated;
+} TailBuffer;
+
+struct JournalTail {
+        int fd;
+        bool writable;
+
+        TailHeader *header;
+        uint8_t *ring;
+        uint64_t ring_size;
+        size_t map_size;
+
+        /* Reader: to notice when the file got replaced */
+        char *path;
+        dev_t st_dev;
+        ino_t st_ino;
+
+        /* Reader: where to look for the entry after the one we returned last */
+        sd_id128_t next_seqnum_id;
+        uint64_t next_seqnum;
+        uint64_t next_offset;
+
+        /* Reader: the last entry we didn't find, where the end of the ring was then, and what we returned */
+        sd_id128_t miss_seqnum_id;
+        uint64_t miss_seqnum;
+        uint64_t miss_end;
+        int miss_result;
+
+        /* Reader: the entry we returned last, with its fields in buffers[current]. The other buffer is used
+         * for parsing the next one, so that the last entry stays valid if that fails. */
+        JournalTailEntry entry;
+        TailBuffer buffers[2];
+        unsigned current;
+};
+
+static bool field_is_binary(const struct iovec *iovec, size_t *ret_name_len) {
+        const char *eq;
+
+        eq = memchr(iovec->iov_base, '=', iovec->iov_len);
+        if (!eq)
+                return false;
+
+        *ret_name_len = eq - (const char*) iovec->iov_base;
+        return memchr(eq + 1, '\n', iovec->iov_len - *ret_name_len - 1);
+}
+
+static uint64_t export_size(const JournalTailEntry *entry) {
+        uint64_t sz = 0;
+
+        for (size_t i = 0; i < entry->n_fields; i++) {
+                size_t name_len;
+
+                if (field_is_binary(entry->fields + i, &name_len))
+                        /* FIELD\n, 64bit little endian size, value, \n */
+                        sz += entry->fields[i].iov_len + sizeof(uint64_t) + 1;
+                else
+                        /* FIELD=value\n */
+                        sz += entry->fields[i].iov_len + 1;
+        }
+
+        return sz;
+}
+
+static uint8_t* export_fields(uint8_t *p, const JournalTailEntry *entry) {
+
+        for (size_t i = 0; i < entry->n_fields; i++) {
+                const struct iovec *iovec = entry->fields + i;
+                size_t name_len;
+
+                if (field_is_binary(iovec, &name_len)) {
+                        p = mempcpy(p, iovec->iov_base, name_len);
+                        *(p++) = '\n';
+                        unaligned_write_le64(p, iovec->iov_len - name_len - 1);
+                        p += sizeof(uint64_t);
+                        p = mempcpy(p, (const uint8_t*) iovec->iov_base + name_len + 1, iovec->iov_len - name_len - 1);
+                } else if (memchr(iovec->iov_base, '=', iovec->iov_len))
+                        p = mempcpy(p, iovec->iov_base, iovec->iov_len);
+                else
+                        continue;
+
+                *(p++) = '\n';
+        }
+
+        return p;
+}
+
+static int tail_init(int fd, uint64_t size, JournalTail **ret) {
+        _cleanup_(journal_tail_closep) JournalTail *tail = NULL;
+        TailHeader *h;
+        size_t sz;
+        int r;
+
+        assert(fd >= 0);
+        assert(ret);
+
+        sz = sizeof(TailHeader) + size;
+
+        r = posix_fallocate(fd, 0, sz);
+        if (r != 0)
+                return -r;
+
+        h = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (h == MAP_FAILED)
+                return -errno;
+
+        tail = new(JournalTail, 1);
+        if (!tail) {
+                (void) munmap(h, sz);
+                return -ENOMEM;
+        }
+
+        *tail = (JournalTail) {
+                .fd = -1,
+                .writable = true,
+                .header = h,
+                .ring = (uint8_t*) h + sizeof(TailHeader),
+                .ring_size = size,
+                .map_size = sz,
+        };
+
+        *h = (TailHeader) {
+                .state = TAIL_ONLINE,
+                .header_size = sizeof(TailHeader),
+                .ring_size = size,
+        };
+        memcpy(h->signature, TAIL_SIGNATURE, sizeof(h->signature));
+
+        *ret = TAKE_PTR(tail);
+        return 0;
+}
+
+int journal_tail_create(const char *path, uint64_t size, JournalTail **ret) {
+        _cleanup_(journal_tail_closep) JournalTail *tail = NULL;
+        _cleanup_close_ int fd = -1;
+        _cleanup_free_ char *t = NULL;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        /* Creates a new tail cache and puts it in place atomically, so that readers of the one of a previous
+         * journald instance keep reading theirs until they notice it went away. */
+
+        size = PAGE_ALIGN(CLAMP(size, (uint64_t) TAIL_SIZE_MIN, (uint64_t) TAIL_SIZE_MAX));
+
+        r = tempfn_random(path, NULL, &t);
+        if (r < 0)
+                return r;
+
+        fd = open(t, O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, 0640);
+        if (fd < 0)
+                return -errno;
+
+        r = tail_init(fd, size, &tail);
+        if (r >= 0 && rename(t, path) < 0)
+                r = -errno;
+        if (r < 0) {
+                (void) unlink(t);
+                return r;
+        }
+
+        tail->fd = TAKE_FD(fd);
+
+        *ret = TAKE_PTR(tail);
+        return 0;
+}
+
+static uint64_t tail_skip_record(JournalTail *t, uint64_t offset) {
+        uint64_t pos;
+
+        pos = offset % t->ring_size;
+        if (t->ring_size - pos < sizeof(TailRecord))
+                return offset + t->ring_size - pos;
+
+        return offset + ((const TailRecord*) (t->ring + pos))->size;
+}
+
+int journal_tail_append(JournalTail *t, const JournalTailEntry *entry) {
+        uint64_t size, pos, pad, begin, end, new_end;
+        TailRecord *record;
+        bool missing;
+
+        assert(t);
+        assert(t->writable);
+        assert(entry);
+
+        size = ALIGN8(offsetof(TailRecord, payload) + export_size(entry));
+        missing = size > TAIL_RECORD_SIZE_MAX(t->ring_size);
+        if (missing)
+                size = sizeof(TailRecord);
+
+        begin = t->header->begin;
+        end = t->header->end;
+
+        pos = end % t->ring_size;
+        pad = t->ring_size - pos < size ? t->ring_size - pos : 0;
+        new_end = end + pad + size;
+
+        /* Make room first, and tell readers about it before we overwrite anything */
+        if (new_end - begin > t->ring_size) {
+                while (new_end - begin > t->ring_size)
+                        begin = tail_skip_record(t, begin);
+
+                t->header->begin = begin;
+                __sync_synchronize();
+        }
+
+        if (pad >= sizeof(TailRecord))
+                *(TailRecord*) (t->ring + pos) = (TailRecord) {
+                        .size = pad,
+                };
+
+        record = (TailRecord*) (t->ring + (end + pad) % t->ring_size);
+        *record = (TailRecord) {
+                .size = size,
+                .seqnum = entry->seqnum,
+                .seqnum_id = entry->seqnum_id,
+                .realtime = entry->realtime,
+                .monotonic = entry->monotonic,
+                .boot_id = entry->boot_id,
+                .xor_hash = entry->xor_hash,
+        };
+
+        if (missing)
+                record->payload_size = TAIL_PAYLOAD_MISSING;
+        else
+                record->payload_size = export_fields(record->payload, entry) - record->payload;
+
+        __sync_synchronize();
+        t->header->end = new_end;
+
+        return !missing;
+}
+
+int journal_tail_open(const char *path, JournalTail **ret) {
+        _cleanup_(journal_tail_closep) JournalTail *tail = NULL;
+        _cleanup_close_ int fd = -1;
+        const TailHeader *h;
+        struct stat st;
+
+        assert(path);
+        assert(ret);
+
+        fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (!S_ISREG(st.st_mode))
+                return -EBADMSG;
+        if ((uint64_t) st.st_size < sizeof(TailHeader) + TAIL_SIZE_MIN ||
+            (uint64_t) st.st_size > sizeof(TailHeader) + TAIL_SIZE_MAX)
+                return -EBADMSG;
+
+        h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (h == MAP_FAILED)
+                return -errno;
+
+        tail = new(JournalTail, 1);
+        if (!tail) {
+                (void) munmap((void*) h, st.st_size);
+                return -ENOMEM;
+        }
+
+        *tail = (JournalTail) {
+                .fd = TAKE_FD(fd),
+                .header = (TailHeader*) h,
+                .ring = (uint8_t*) h + sizeof(TailHeader),
+                .ring_size = st.st_size - sizeof(TailHeader),
+                .map_size = st.st_size,
+                .st_dev = st.st_dev,
+                .st_ino = st.st_ino,
+        };
+
+        if (memcmp(h->signature, TAIL_SIGNATURE, sizeof(h->signature)) != 0 ||
+            h->header_size != sizeof(TailHeader) ||
+            h->ring_size != tail->ring_size ||
+            tail->ring_size % 8 != 0)
+                return -EBADMSG;
+
+        if (h->state != TAIL_ONLINE)
+                return -ESTALE;
+
+        tail->path = strdup(path);
+        if (!tail->path)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(tail);
+        return 0;
+}
+
+static int tail_parse_record(TailBuffer *b, const TailRecord *record, const uint8_t *payload, JournalTailEntry *ret) {
+        const uint8_t *p, *e;
+        uint8_t *q;
+        size_t n = 0;
+
+        assert(b);
+        assert(record);
+        assert(payload);
+        assert(ret);
+
+        /* Turns the fields in export format back into FIELD=value form, in the buffer b. Note that this
+         * has to cope with anything, as the ring might get overwritten under our feet. The result is thrown
+         * away in that case, see journal_tail_find_next(). 'record' is the copy of the header we made
+         * before, 'payload' is still in the ring. */
+
+        if (record->payload_size > record->size - offsetof(TailRecord, payload))
+                return -EBADMSG;
+
+        if (!GREEDY_REALLOC(b->data, b->data_allocated, record->payload_size + 1))
+                return -ENOMEM;
+
+        p = payload;
+        e = p + record->payload_size;
+        q = b->data;
+
+        while (p < e) {
+                const uint8_t *nl, *field = q;
+                uint64_t l;
+
+                nl = memchr(p, '\n', e - p);
+                if (!nl)
+                        return -EBADMSG;
+
+                if (!GREEDY_REALLOC(b->fields, b->fields_allocated, n + 1))
+                        return -ENOMEM;
+
+                if (memchr(p, '=', nl - p)) {
+                        q = mempcpy(q, p, nl - p);
+                        p = nl + 1;
+                } else {
+                        q = mempcpy(q, p, nl - p);
+                        *(q++) = '=';
+                        p = nl + 1;
+
+                        if ((size_t) (e - p) < sizeof(uint64_t))
+                                return -EBADMSG;
+                        l = unaligned_read_le64(p);
+                        p += sizeof(uint64_t);
+
+                        if (l >= (uint64_t) (e - p) || p[l] != '\n')
+                                return -EBADMSG;
+
+                        q = mempcpy(q, p, l);
+                        p += l + 1;
+                }
+
+                b->fields[n++] = IOVEC_MAKE((void*) field, q - field);
+        }
+
+        *ret = (JournalTailEntry) {
+                .seqnum_id = record->seqnum_id,
+                .seqnum = record->seqnum,
+                .realtime = record->realtime,
+                .monotonic = record->monotonic,
+                .boot_id = record->boot_id,
+                .xor_hash = record->xor_hash,
+                .fields = b->fields,
+                .n_fields = n,
+        };
+
+        return 0;
+}
+
+int journal_tail_find_next(JournalTail *t, sd_id128_t seqnum_id, uint64_t seqnum, const JournalTailEntry **ret) {
+        uint64_t offset, end;
+        unsigned n_retries = 0;
+        bool newest = false;
+
+        assert(t);
+        assert(!t->writable);
+        assert(ret);
+
+        /* Looks for the entry following the specified one, i.e. the one with the next sequence number.
+         * Returns 1 if it was found, 0 if the specified entry is the newest one in the ring, i.e. there is
+         * no next entry yet, and -ENOENT if the next entry is not in the ring for any other reason, i.e.
+         * it has to be read from the journal files. The returned entry stays valid until the next
+         * successful call. */
+
+        __sync_synchronize();
+        end = t->header->end;
+
+        if (end == t->miss_end && seqnum == t->miss_seqnum && sd_id128_equal(seqnum_id, t->miss_seqnum_id))
+                return t->miss_result;
+
+        if (seqnum + 1 == t->next_seqnum && sd_id128_equal(seqnum_id, t->next_seqnum_id) &&
+            t->next_offset >= t->header->begin) {
+                /* Right after the entry we returned last */
+                offset = t->next_offset;
+                newest = true;
+        } else
+                offset = t->header->begin;
+
+        while (offset < end) {
+                const TailRecord *record;
+                TailRecord copy;
+                uint64_t pos;
+
+                pos = offset % t->ring_size;
+                if (t->ring_size - pos < sizeof(TailRecord)) {
+                        offset += t->ring_size - pos;
+                        continue;
+                }
+
+                record = (const TailRecord*) (t->ring + pos);
+                copy = *record;
+
+                __sync_synchronize();
+                if (offset < t->header->begin) {
+                        /* The writer overtook us, start over from what's left */
+                        if (++n_retries > 3)
+                                break;
+
+                        offset = t->header->begin;
+                        newest = false;
+                        continue;
+                }
+
+                if (copy.size < sizeof(TailRecord) || copy.size % 8 != 0 || copy.size > t->ring_size - pos)
+                        break;
+
+                if (copy.seqnum != 0)
+                        newest = copy.seqnum == seqnum && sd_id128_equal(copy.seqnum_id, seqnum_id);
+
+                if (copy.seqnum != 0 && sd_id128_equal(copy.seqnum_id, seqnum_id)) {
+                        /* Sequence numbers only grow, so we went past it already, it's not in here */
+                        if (copy.seqnum > seqnum + 1)
+                                break;
+
+                        if (copy.seqnum == seqnum + 1) {
+                                JournalTailEntry entry;
+                                int r;
+
+                                /* Too large for the ring, it's only in the files */
+                                if (copy.payload_size == TAIL_PAYLOAD_MISSING)
+                                        break;
+
+                                r = tail_parse_record(&t->buffers[!t->current], &copy, record->payload, &entry);
+
+                                __sync_synchronize();
+                                if (offset < t->header->begin)
+                                        break;
+                                if (r == -ENOMEM)
+                                        return r;
+                                if (r < 0)
+                                        break;
+
+                                t->current = !t->current;
+                                t->entry = entry;
+
+                                t->next_seqnum_id = seqnum_id;
+                                t->next_seqnum = seqnum + 2;
+                                t->next_offset = offset + copy.size;
+
+                                *ret = &t->entry;
+                                return 1;
+                        }
+                }
+
+                offset += copy.size;
+        }
+
+        t->miss_seqnum_id = seqnum_id;
+        t->miss_seqnum = seqnum;
+        t->miss_end = end;
+        t->miss_result = offset >= end && newest ? 0 : -ENOENT;
+
+        return t->miss_result;
+}
+
+bool journal_tail_is_stale(JournalTail *t) {
+        struct stat st;
+
+        assert(t);
+        assert(t->path);
+
+        /* journald went away, or it was restarted and created a new cache? */
+
+        if (t->header->state != TAIL_ONLINE)
+                return true;
+
+        if (stat(t->path, &st) < 0)
+                return true;
+
+        return st.st_dev != t->st_dev || st.st_ino != t->st_ino;
+}
+
+JournalTail* journal_tail_close(JournalTail *t) {
+        if (!t)
+                return NULL;
+
+        if (t->writable) {
+                t->header->state = TAIL_OFFLINE;
+                __sync_synchronize();
+        }
+
+        if (t->header)
+                (void) munmap(t->header, t->map_size);
+
+        safe_close(t->fd);
+        free(t->path);
+        for (size_t i = 0; i < ELEMENTSOF(t->buffers); i++) {
+                free(t->buffers[i].fields);
+                free(t->buffers[i].data);
+        }
+
+        return mfree(t);
+}
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "sd-id128.h"
+
+#include "macro.h"
+#include "time-util.h"
+
+/* A ring of the most recently written entries, in shared memory. journald appends every entry it writes to
+ * a journal file to it too, and readers that follow the journal at the tail can take entries from there
+ * rather than from the journal files themselves. See journal-tail.c for the layout. */
+
+typedef struct JournalTail JournalTail;
+
+typedef struct JournalTailEntry {
+        sd_id128_t seqnum_id;
+        uint64_t seqnum;
+        uint64_t realtime;
+        uint64_t monotonic;
+        sd_id128_t boot_id;
+        uint64_t xor_hash;
+
+        /* The fields of the entry in FIELD=value form, as for journal_file_append_entry() */
+        const struct iovec *fields;
+        size_t n_fields;
+} JournalTailEntry;
+
+#define JOURNAL_TAIL_FILE "tail.cache"
+
+/* Used by journald */
+int journal_tail_create(const char *path, uint64_t size, JournalTail **ret);
+int journal_tail_append(JournalTail *t, const JournalTailEntry *entry);
+
+/* Used by sd-journal */
+int journal_tail_open(const char *path, JournalTail **ret);
+int journal_tail_find_next(JournalTail *t, sd_id128_t seqnum_id, uint64_t seqnum, const JournalTailEntry **ret);
+bool journal_tail_is_stale(JournalTail *t);
+
+JournalTail* journal_tail_close(JournalTail *t);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalTail*, journal_tail_close);
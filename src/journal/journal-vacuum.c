@@ -9,20 +9,144 @@
 #include "alloc-util.h"
 #include "dirent-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "format-util.h"
 #include "fs-util.h"
+#include "hashmap.h"
 #include "journal-def.h"
 #include "journal-file.h"
 #include "journal-vacuum.h"
+#include "path-util.h"
 #include "sort-util.h"
 #include "string-util.h"
 #include "time-util.h"
+#include "tmpfile-util.h"
 #include "xattr-util.h"
 
+/* Next to the archived journal files of a directory we keep a manifest, which records for each of them what we'd
+ * otherwise have to open the file for: its disk usage and its (patched) realtime timestamp. Archived files are never
+ * modified again, hence an entry remains valid as long as a file of that name and inode number exists. The manifest
+ * is merely a cache: entries that don't match the directory contents are ignored, and it is rewritten by the next
+ * vacuuming run whenever it turned out to be incomplete or outdated. */
+
+#define MANIFEST_FILENAME ".journal-manifest"
+#define MANIFEST_HEADER "# journal vacuum manifest v1"
+
+struct manifest_entry {
+        ino_t inode;
+        uint64_t usage;
+        uint64_t realtime;
+};
+
+static int manifest_load(int dir_fd, Hashmap **ret) {
+        _cleanup_hashmap_free_free_free_ Hashmap *m = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *line = NULL;
+        _cleanup_close_ int fd = -1;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(ret);
+
+        fd = openat(dir_fd, MANIFEST_FILENAME, O_RDONLY|O_CLOEXEC|O_NOFOLLOW|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        f = take_fdopen(&fd, "r");
+        if (!f)
+                return -errno;
+
+        r = read_line(f, LONG_LINE_MAX, &line);
+        if (r < 0)
+                return r;
+        if (!streq(line, MANIFEST_HEADER))
+                return -EBADMSG;
+
+        m = hashmap_new(&string_hash_ops);
+        if (!m)
+                return -ENOMEM;
+
+        for (;;) {
+                _cleanup_free_ struct manifest_entry *e = NULL;
+                _cleanup_free_ char *fn = NULL;
+                uint64_t inode, usage, realtime;
+                int k = 0;
+
+                line = mfree(line);
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                if (sscanf(line, "%" SCNx64 " %" SCNx64 " %" SCNx64 " %n", &inode, &usage, &realtime, &k) != 3 || k == 0)
+                        return -EBADMSG;
+                if (!filename_is_valid(line + k))
+                        return -EBADMSG;
+
+                fn = strdup(line + k);
+                if (!fn)
+                        return -ENOMEM;
+
+                e = new(struct manifest_entry, 1);
+                if (!e)
+                        return -ENOMEM;
+
+                *e = (struct manifest_entry) {
+                        .inode = (ino_t) inode,
+                        .usage = usage,
+                        .realtime = realtime,
+                };
+
+                r = hashmap_put(m, fn, e);
+                if (r == -EEXIST)
+                        return -EBADMSG;
+                if (r < 0)
+                        return r;
+
+                TAKE_PTR(fn);
+                TAKE_PTR(e);
+        }
+
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
+static Hashmap* manifest_load_or_warn(int dir_fd, const char *directory) {
+        Hashmap *m = NULL;
+        int r;
+
+        r = manifest_load(dir_fd, &m);
+        if (r < 0 && r != -ENOENT)
+                log_debug_errno(r, "Failed to read journal manifest in %s, ignoring: %m", directory);
+
+        return m;
+}
+
+static const struct manifest_entry* manifest_find(Hashmap *m, const struct dirent *de) {
+        const struct manifest_entry *e;
+
+        assert(de);
+
+        /* Only trust the entry if the directory still lists the very same file. If the file system doesn't tell
+         * us the file type, we have to stat the file anyway. */
+        if (de->d_type != DT_REG)
+                return NULL;
+
+        e = hashmap_get(m, de->d_name);
+        if (!e || e->inode != de->d_ino)
+                return NULL;
+
+        return e;
+}
+
 struct vacuum_info {
         uint64_t usage;
         char *filename;
 
+        ino_t inode;
+        bool deleted;
+
         uint64_t realtime;
 
         sd_id128_t seqnum_id;
@@ -47,6 +171,44 @@ static int vacuum_compare(const struct vacuum_info *a, const struct vacuum_info
         return strcmp(a->filename, b->filename);
 }
 
+static int manifest_save(const char *directory, const struct vacuum_info *list, size_t n_list) {
+        _cleanup_(unlink_and_freep) char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *p = NULL;
+        size_t i;
+        int r;
+
+        assert(directory);
+        assert(list || n_list == 0);
+
+        p = path_join(directory, MANIFEST_FILENAME);
+        if (!p)
+                return -ENOMEM;
+
+        r = fopen_temporary(p, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        (void) fchmod(fileno(f), 0640);
+
+        fputs(MANIFEST_HEADER "\n", f);
+
+        for (i = 0; i < n_list; i++)
+                if (!list[i].deleted && !strchr(list[i].filename, '\n'))
+                        fprintf(f, "%" PRIx64 " %" PRIx64 " %" PRIx64 " %s\n",
+                                (uint64_t) list[i].inode, list[i].usage, list[i].realtime, list[i].filename);
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (rename(temp_path, p) < 0)
+                return -errno;
+
+        temp_path = mfree(temp_path);
+        return 0;
+}
+
 static void patch_realtime(
                 int fd,
                 const char *fn,
@@ -127,8 +289,10 @@ int journal_directory_vacuum(
                 bool verbose) {
 
         uint64_t sum = 0, freed = 0, n_active_files = 0;
-        size_t n_list = 0, n_allocated = 0, i;
+        size_t n_list = 0, n_allocated = 0, n_cached = 0, i;
+        _cleanup_hashmap_free_free_free_ Hashmap *manifest = NULL;
         _cleanup_closedir_ DIR *d = NULL;
+        bool manifest_dirty = false;
         struct vacuum_info *list = NULL;
         usec_t retention_limit = 0;
         char sbytes[FORMAT_BYTES_MAX];
@@ -147,9 +311,12 @@ int journal_directory_vacuum(
         if (!d)
                 return -errno;
 
+        manifest = manifest_load_or_warn(dirfd(d), directory);
+
         FOREACH_DIRENT_ALL(de, d, r = -errno; goto finish) {
 
                 unsigned long long seqnum = 0, realtime;
+                const struct manifest_entry *e;
                 _cleanup_free_ char *p = NULL;
                 sd_id128_t seqnum_id;
                 bool have_seqnum;
@@ -157,13 +324,20 @@ int journal_directory_vacuum(
                 struct stat st;
                 size_t q;
 
-                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
-                        log_debug_errno(errno, "Failed to stat file %s while vacuuming, ignoring: %m", de->d_name);
+                if (streq(de->d_name, MANIFEST_FILENAME))
                         continue;
-                }
 
-                if (!S_ISREG(st.st_mode))
-                        continue;
+                /* Files we know from the manifest need not be looked at again */
+                e = manifest_find(manifest, de);
+                if (!e) {
+                        if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                                log_debug_errno(errno, "Failed to stat file %s while vacuuming, ignoring: %m", de->d_name);
+                                continue;
+                        }
+
+                        if (!S_ISREG(st.st_mode))
+                                continue;
+                }
 
                 q = strlen(de->d_name);
 
@@ -237,30 +411,37 @@ int journal_directory_vacuum(
                         continue;
                 }
 
-                size = 512UL * (uint64_t) st.st_blocks;
+                if (e) {
+                        size = e->usage;
+                        realtime = e->realtime;
+                        n_cached++;
+                } else {
+                        size = 512UL * (uint64_t) st.st_blocks;
 
-                r = journal_file_empty(dirfd(d), p);
-                if (r < 0) {
-                        log_debug_errno(r, "Failed check if %s is empty, ignoring: %m", p);
-                        continue;
-                }
-                if (r > 0) {
-                        /* Always vacuum empty non-online files. */
+                        r = journal_file_empty(dirfd(d), p);
+                        if (r < 0) {
+                                log_debug_errno(r, "Failed check if %s is empty, ignoring: %m", p);
+                                continue;
+                        }
+                        if (r > 0) {
+                                /* Always vacuum empty non-online files. */
 
-                        r = unlinkat_deallocate(dirfd(d), p, 0);
-                        if (r >= 0) {
+                                r = unlinkat_deallocate(dirfd(d), p, 0);
+                                if (r >= 0) {
 
-                                log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                         "Deleted empty archived journal %s/%s (%s).", directory, p, format_bytes(sbytes, sizeof(sbytes), size));
+                                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
+                                                 "Deleted empty archived journal %s/%s (%s).", directory, p, format_bytes(sbytes, sizeof(sbytes), size));
 
-                                freed += size;
-                        } else if (r != -ENOENT)
-                                log_warning_errno(r, "Failed to delete empty archived journal %s/%s: %m", directory, p);
+                                        freed += size;
+                                } else if (r != -ENOENT)
+                                        log_warning_errno(r, "Failed to delete empty archived journal %s/%s: %m", directory, p);
 
-                        continue;
-                }
+                                continue;
+                        }
 
-                patch_realtime(dirfd(d), p, &st, &realtime);
+                        patch_realtime(dirfd(d), p, &st, &realtime);
+                        manifest_dirty = true;
+                }
 
                 if (!GREEDY_REALLOC(list, n_allocated, n_list + 1)) {
                         r = -ENOMEM;
@@ -269,6 +450,7 @@ int journal_directory_vacuum(
 
                 list[n_list++] = (struct vacuum_info) {
                         .filename = TAKE_PTR(p),
+                        .inode = e ? e->inode : st.st_ino,
                         .usage = size,
                         .seqnum = seqnum,
                         .realtime = realtime,
@@ -292,6 +474,10 @@ int journal_directory_vacuum(
                         break;
 
                 r = unlinkat_deallocate(dirfd(d), list[i].filename, 0);
+                if (r >= 0 || r == -ENOENT) {
+                        list[i].deleted = true;
+                        manifest_dirty = true;
+                }
                 if (r >= 0) {
                         log_full(verbose ? LOG_INFO : LOG_DEBUG, "Deleted archived journal %s/%s (%s).", directory, list[i].filename, format_bytes(sbytes, sizeof(sbytes), list[i].usage));
                         freed += list[i].usage;
@@ -308,6 +494,13 @@ int journal_directory_vacuum(
         if (oldest_usec && i < n_list && (*oldest_usec == 0 || list[i].realtime < *oldest_usec))
                 *oldest_usec = list[i].realtime;
 
+        /* Update the manifest if we learnt something new, or if it lists files that are gone */
+        if (manifest_dirty || n_cached != hashmap_size(manifest)) {
+                r = manifest_save(directory, list, n_list);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to write journal manifest in %s, ignoring: %m", directory);
+        }
+
         r = 0;
 
 finish:
@@ -319,3 +512,46 @@ finish:
 
         return r;
 }
+
+int journal_directory_usage(DIR *d, const char *directory, uint64_t *ret) {
+        _cleanup_hashmap_free_free_free_ Hashmap *manifest = NULL;
+        struct dirent *de;
+        uint64_t sum = 0;
+
+        assert(d);
+        assert(directory);
+        assert(ret);
+
+        /* Sums up the disk usage of all journal files in the directory, taking the usage of archived files from
+         * the manifest where we can. */
+
+        manifest = manifest_load_or_warn(dirfd(d), directory);
+
+        FOREACH_DIRENT_ALL(de, d, break) {
+                const struct manifest_entry *e;
+                struct stat st;
+
+                if (!endswith(de->d_name, ".journal") &&
+                    !endswith(de->d_name, ".journal~"))
+                        continue;
+
+                e = manifest_find(manifest, de);
+                if (e) {
+                        sum += e->usage;
+                        continue;
+                }
+
+                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                        log_debug_errno(errno, "Failed to stat %s/%s, ignoring: %m", directory, de->d_name);
+                        continue;
+                }
+
+                if (!S_ISREG(st.st_mode))
+                        continue;
+
+                sum += (uint64_t) st.st_blocks * 512UL;
+        }
+
+        *ret = sum;
+        return 0;
+}
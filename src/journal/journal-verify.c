@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stddef.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -20,6 +22,10 @@
 #include "tmpfile-util.h"
 #include "util.h"
 
+/* Checking the hash table is spread over threads of their own, in ranges of at least this many buckets */
+#define VERIFY_HASH_BUCKETS_PER_THREAD_MIN 4096U
+#define VERIFY_THREADS_MAX 16U
+
 static void draw_progress(uint64_t p, usec_t *last_usec) {
         unsigned n, i, j, k;
         usec_t z, x;
@@ -153,10 +159,10 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         _cleanup_free_ void *b = NULL;
                         size_t alloc = 0, b_size;
 
-                        r = decompress_blob(compression,
-                                            o->data.payload,
-                                            le64toh(o->object.size) - offsetof(Object, data.payload),
-                                            &b, &alloc, &b_size, 0);
+                        r = decompress_blob_dict(compression, journal_file_get_dictionary(f),
+                                                 o->data.payload,
+                                                 le64toh(o->object.size) - offsetof(Object, data.payload),
+                                                 &b, &alloc, &b_size, 0);
                         if (r < 0) {
                                 error_errno(offset, r, "%s decompression failed: %m",
                                             object_compressed_to_string(compression));
@@ -344,9 +350,71 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
+                break;
+
+        case OBJECT_DICTIONARY:
+                if (le64toh(o->object.size) <= offsetof(DictionaryObject, payload)) {
+                        error(offset,
+                              "Bad dictionary size (<= %zu): %"PRIu64,
+                              offsetof(DictionaryObject, payload),
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                break;
+
+        case OBJECT_BLOOM_FILTER: {
+                uint64_t sz;
+
+                sz = le64toh(o->object.size);
+                if (sz <= offsetof(BloomFilterObject, bits)) {
+                        error(offset,
+                              "Bad bloom filter size (<= %zu): %"PRIu64,
+                              offsetof(BloomFilterObject, bits),
+                              sz);
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->bloom_filter.n_data) != le64toh(f->header->n_data)) {
+                        error(offset,
+                              "Bloom filter covers %"PRIu64" data objects, but there are %"PRIu64,
+                              le64toh(o->bloom_filter.n_data),
+                              le64toh(f->header->n_data));
+                        return -EBADMSG;
+                }
+
                 break;
         }
 
+        case OBJECT_ENTRY_INDEX: {
+                uint64_t sz;
+
+                sz = le64toh(o->object.size);
+                if (sz <= offsetof(EntryIndexObject, items) ||
+                    (sz - offsetof(EntryIndexObject, items)) % sizeof(EntryIndexItem) != 0) {
+                        error(offset,
+                              "Invalid entry index size: %"PRIu64,
+                              sz);
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->entry_index.stride) <= 0) {
+                        error(offset, "Invalid entry index stride");
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->entry_index.n_entries) != le64toh(f->header->n_entries)) {
+                        error(offset,
+                              "Entry index covers %"PRIu64" entries, but there are %"PRIu64,
+                              le64toh(o->entry_index.n_entries),
+                              le64toh(f->header->n_entries));
+                        return -EBADMSG;
+                }
+
+                break;
+        }
+        }
+
         return 0;
 }
 
@@ -571,6 +639,8 @@ static int verify_hash_table(
                 MMapFileDescriptor *cache_data_fd, uint64_t n_data,
                 MMapFileDescriptor *cache_entry_fd, uint64_t n_entries,
                 MMapFileDescriptor *cache_entry_array_fd, uint64_t n_entry_arrays,
+                uint64_t begin, uint64_t end,
+                int *cancel,
                 usec_t *last_usec,
                 bool show_progress) {
 
@@ -581,21 +651,29 @@ static int verify_hash_table(
         assert(cache_data_fd);
         assert(cache_entry_fd);
         assert(cache_entry_array_fd);
+        assert(begin <= end);
         assert(last_usec);
 
+        /* Checks the hash buckets in the range [begin, end), and gives up early if some other thread asks us
+         * to via 'cancel' */
+
         n = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
-        if (n <= 0)
+        end = MIN(end, n);
+        if (begin >= end)
                 return 0;
 
         r = journal_file_map_data_hash_table(f);
         if (r < 0)
                 return log_error_errno(r, "Failed to map data hash table: %m");
 
-        for (i = 0; i < n; i++) {
+        for (i = begin; i < end; i++) {
                 uint64_t last = 0, p;
 
+                if (cancel && __sync_fetch_and_add(cancel, 0) != 0)
+                        return -ECANCELED;
+
                 if (show_progress)
-                        draw_progress(0xC000 + scale_progress(0x3FFF, i, n), last_usec);
+                        draw_progress(0xC000 + scale_progress(0x3FFF, i - begin, end - begin), last_usec);
 
                 p = le64toh(f->data_hash_table[i].head_hash_offset);
                 while (p != 0) {
@@ -799,11 +877,292 @@ static int verify_entry_array(
         return 0;
 }
 
-int journal_file_verify(
+static int verify_entry_index(JournalFile *f, uint64_t q) {
+        uint64_t n_entries, n_items, stride, a, i = 0, k = 0;
+        Object *o;
+        int r;
+
+        assert(f);
+
+        /* The entry array chain has been verified already, check that the index samples it exactly the way
+         * journal_file_append_entry_index() does */
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY_INDEX, q, &o);
+        if (r < 0)
+                return r;
+
+        n_entries = le64toh(o->entry_index.n_entries);
+        n_items = (le64toh(o->object.size) - offsetof(Object, entry_index.items)) / sizeof(EntryIndexItem);
+        stride = le64toh(o->entry_index.stride);
+
+        a = le64toh(f->header->entry_array_offset);
+        while (i < n_entries) {
+                Object *array;
+                uint64_t m;
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &array);
+                if (r < 0)
+                        return r;
+
+                m = MIN(journal_file_entry_array_n_items(array), n_entries - i);
+
+                for (uint64_t j = 0; j < m; j += stride, k++) {
+                        const EntryIndexItem *item;
+                        Object *e;
+
+                        if (k >= n_items) {
+                                error(q, "Entry index too short at %"PRIu64" of %"PRIu64, i + j, n_entries);
+                                return -EBADMSG;
+                        }
+
+                        item = o->entry_index.items + k;
+                        if (le64toh(item->entry_array_offset) != a ||
+                            le32toh(item->index) != j ||
+                            le32toh(item->n) != MIN(stride, m - j)) {
+                                error(q, "Entry index item %"PRIu64" does not match entry array", k);
+                                return -EBADMSG;
+                        }
+
+                        r = journal_file_move_to_object(f, OBJECT_ENTRY, le64toh(array->entry_array.items[j]), &e);
+                        if (r < 0)
+                                return r;
+
+                        if (item->seqnum != e->entry.seqnum ||
+                            item->realtime != e->entry.realtime) {
+                                error(q, "Entry index item %"PRIu64" does not match entry", k);
+                                return -EBADMSG;
+                        }
+                }
+
+                i += m;
+                a = le64toh(array->entry_array.next_entry_array_offset);
+        }
+
+        if (k != n_items) {
+                error(q, "Entry index has %"PRIu64" items, expected %"PRIu64, n_items, k);
+                return -EBADMSG;
+        }
+
+        return 0;
+}
+
+typedef struct VerifyHashTableJob {
+        JournalFile *f;
+        MMapFileDescriptor *cache_data_fd, *cache_entry_fd, *cache_entry_array_fd;
+        uint64_t n_data, n_entries, n_entry_arrays;
+        uint64_t begin, end;
+        int *cancel;
+        pthread_t thread;
+        bool running;
+        int r;
+} VerifyHashTableJob;
+
+static void* verify_hash_table_thread(void *userdata) {
+        VerifyHashTableJob *job = userdata;
+        usec_t last_usec = 0;
+
+        (void) pthread_setname_np(pthread_self(), "journal-verify");
+
+        job->r = verify_hash_table(job->f,
+                                   job->cache_data_fd, job->n_data,
+                                   job->cache_entry_fd, job->n_entries,
+                                   job->cache_entry_array_fd, job->n_entry_arrays,
+                                   job->begin, job->end,
+                                   job->cancel,
+                                   &last_usec,
+                                   false);
+        if (job->r < 0)
+                (void) __sync_bool_compare_and_swap(job->cancel, 0, 1);
+
+        return NULL;
+}
+
+static int verify_hash_table_job_start(
+                VerifyHashTableJob *job,
+                JournalFile *f,
+                int data_fd, int entry_fd, int entry_array_fd) {
+
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(job);
+        assert(f);
+
+        /* Each thread gets a handle on the file of its own, since the mmap cache contexts and the hash table
+         * mapping of a JournalFile object must not be shared between threads */
+
+        r = journal_file_open(-1, f->path, O_RDONLY, 0, false, 0, false, NULL, NULL, NULL, NULL, &job->f);
+        if (r < 0)
+                return r;
+
+        job->cache_data_fd = mmap_cache_add_fd(job->f->mmap, data_fd);
+        job->cache_entry_fd = mmap_cache_add_fd(job->f->mmap, entry_fd);
+        job->cache_entry_array_fd = mmap_cache_add_fd(job->f->mmap, entry_array_fd);
+        if (!job->cache_data_fd || !job->cache_entry_fd || !job->cache_entry_array_fd)
+                return -ENOMEM;
+
+        /* Don't block SIGBUS, since the thread accesses memory mapped files, see journal_file_set_offline() */
+        assert_se(sigfillset(&ss) >= 0);
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        r = pthread_create(&job->thread, NULL, verify_hash_table_thread, job);
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+
+        job->running = true;
+
+        return k > 0 ? -k : 0;
+}
+
+static void verify_hash_table_job_done(VerifyHashTableJob *job) {
+        assert(job);
+
+        if (job->running) {
+                assert_se(pthread_join(job->thread, NULL) == 0);
+                job->running = false;
+        }
+
+        if (!job->f)
+                return;
+
+        if (job->cache_data_fd)
+                mmap_cache_free_fd(job->f->mmap, job->cache_data_fd);
+        if (job->cache_entry_fd)
+                mmap_cache_free_fd(job->f->mmap, job->cache_entry_fd);
+        if (job->cache_entry_array_fd)
+                mmap_cache_free_fd(job->f->mmap, job->cache_entry_array_fd);
+
+        job->f = journal_file_close(job->f);
+}
+
+static unsigned verify_n_threads(unsigned n_threads) {
+        long n;
+
+        if (n_threads > 0)
+                return MIN(n_threads, VERIFY_THREADS_MAX);
+
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n <= 0)
+                return 1;
+
+        return MIN((unsigned long) n, VERIFY_THREADS_MAX);
+}
+
+static int verify_references(
+                JournalFile *f,
+                int data_fd, MMapFileDescriptor *cache_data_fd, uint64_t n_data,
+                int entry_fd, MMapFileDescriptor *cache_entry_fd, uint64_t n_entries,
+                int entry_array_fd, MMapFileDescriptor *cache_entry_array_fd, uint64_t n_entry_arrays,
+                bool verify_index,
+                unsigned n_threads,
+                usec_t *last_usec,
+                bool show_progress) {
+
+        _cleanup_free_ VerifyHashTableJob *jobs = NULL;
+        uint64_t n_buckets;
+        size_t n_jobs = 0, i;
+        int cancel = 0, r;
+
+        assert(f);
+        assert(last_usec);
+
+        /* Following the entry array and following the hash table are independent of each other, both only
+         * read from the file and from the offset lists we collected. Hence, if there are enough hash buckets to
+         * make it worthwhile, split the hash table into ranges and check them in threads of their own, while
+         * we follow the entry array here. */
+
+        n_buckets = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
+        n_threads = verify_n_threads(n_threads);
+        if (n_threads > 1)
+                n_jobs = MIN(n_threads - 1, n_buckets / VERIFY_HASH_BUCKETS_PER_THREAD_MIN);
+
+        if (n_jobs > 0) {
+                jobs = new0(VerifyHashTableJob, n_jobs);
+                if (!jobs)
+                        n_jobs = 0;
+        }
+
+        for (i = 0; i < n_jobs; i++) {
+                jobs[i] = (VerifyHashTableJob) {
+                        .n_data = n_data,
+                        .n_entries = n_entries,
+                        .n_entry_arrays = n_entry_arrays,
+                        .begin = n_buckets * i / n_jobs,
+                        .end = n_buckets * (i + 1) / n_jobs,
+                        .cancel = &cancel,
+                };
+
+                r = verify_hash_table_job_start(jobs + i, f, data_fd, entry_fd, entry_array_fd);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to start verification thread, checking hash buckets %"PRIu64"…%"PRIu64" ourselves: %m",
+                                        jobs[i].begin, jobs[i].end);
+        }
+
+        r = verify_entry_array(f,
+                               cache_data_fd, n_data,
+                               cache_entry_fd, n_entries,
+                               cache_entry_array_fd, n_entry_arrays,
+                               last_usec,
+                               show_progress);
+        if (r >= 0 && verify_index)
+                r = verify_entry_index(f, le64toh(f->header->entry_index_offset));
+        if (r < 0)
+                (void) __sync_bool_compare_and_swap(&cancel, 0, 1);
+
+        for (i = 0; i < n_jobs; i++) {
+                bool ran = jobs[i].running;
+
+                verify_hash_table_job_done(jobs + i);
+
+                if (r < 0)
+                        continue;
+
+                if (ran)
+                        r = jobs[i].r;
+                else
+                        r = verify_hash_table(f,
+                                              cache_data_fd, n_data,
+                                              cache_entry_fd, n_entries,
+                                              cache_entry_array_fd, n_entry_arrays,
+                                              jobs[i].begin, jobs[i].end,
+                                              NULL,
+                                              last_usec,
+                                              show_progress);
+        }
+
+        /* A thread that gave up because another one failed doesn't tell us anything, but the failing one
+         * does, pick its error */
+        if (r == -ECANCELED)
+                for (i = 0; i < n_jobs; i++)
+                        if (jobs[i].r < 0 && jobs[i].r != -ECANCELED) {
+                                r = jobs[i].r;
+                                break;
+                        }
+        if (r < 0 || n_jobs > 0)
+                return r;
+
+        return verify_hash_table(f,
+                                 cache_data_fd, n_data,
+                                 cache_entry_fd, n_entries,
+                                 cache_entry_array_fd, n_entry_arrays,
+                                 0, n_buckets,
+                                 NULL,
+                                 last_usec,
+                                 show_progress);
+}
+
+int journal_file_verify_full(
                 JournalFile *f,
                 const char *key,
                 usec_t *first_contained, usec_t *last_validated, usec_t *last_contained,
-                bool show_progress) {
+                bool show_progress,
+                unsigned n_threads) {
         int r;
         Object *o;
         uint64_t p = 0, last_epoch = 0, last_tag_realtime = 0, last_sealed_realtime = 0;
@@ -816,7 +1175,7 @@ int journal_file_verify(
         int data_fd = -1, entry_fd = -1, entry_array_fd = -1;
         MMapFileDescriptor *cache_data_fd = NULL, *cache_entry_fd = NULL, *cache_entry_array_fd = NULL;
         unsigned i;
-        bool found_last = false;
+        bool found_last = false, found_dictionary = false, found_bloom_filter = false, found_entry_index = false;
         const char *tmp_dir = NULL;
 
 #if HAVE_GCRYPT
@@ -953,13 +1312,22 @@ int journal_file_verify(
 
                 switch (o->object.type) {
 
-                case OBJECT_DATA:
+                case OBJECT_DATA: {
+                        uint64_t h = le64toh(o->data.hash);
+
                         r = write_uint64(data_fd, p);
                         if (r < 0)
                                 goto fail;
 
+                        if (journal_file_bloom_filter_test(f, h) == 0) {
+                                error(p, "Data object missing from bloom filter");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
                         n_data++;
                         break;
+                }
 
                 case OBJECT_FIELD:
                         n_fields++;
@@ -1164,6 +1532,63 @@ int journal_file_verify(
                         n_tags++;
                         break;
 
+                case OBJECT_DICTIONARY:
+                        if (!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) ||
+                            le64toh(f->header->dictionary_offset) != p) {
+                                error(p, "Dictionary object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (found_dictionary) {
+                                error(p, "More than one dictionary object");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (le32toh(f->header->dictionary_id) != le32toh(o->dictionary.dictionary_id)) {
+                                error(p, "Dictionary ID does not match header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_dictionary = true;
+                        break;
+
+                case OBJECT_BLOOM_FILTER:
+                        if (!JOURNAL_HEADER_BLOOM_FILTER(f->header) ||
+                            le64toh(f->header->bloom_filter_offset) != p) {
+                                error(p, "Bloom filter object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (found_bloom_filter) {
+                                error(p, "More than one bloom filter object");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_bloom_filter = true;
+                        break;
+
+                case OBJECT_ENTRY_INDEX:
+                        if (!JOURNAL_HEADER_ENTRY_INDEX(f->header) ||
+                            le64toh(f->header->entry_index_offset) != p) {
+                                error(p, "Entry index object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (found_entry_index) {
+                                error(p, "More than one entry index object");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_entry_index = true;
+                        break;
+
                 default:
                         n_weird++;
                 }
@@ -1182,6 +1607,24 @@ int journal_file_verify(
                 goto fail;
         }
 
+        if (JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) && !found_dictionary) {
+                error(offsetof(Header, dictionary_offset), "Dictionary object pointer dead");
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_BLOOM_FILTER(f->header) && !found_bloom_filter) {
+                error(offsetof(Header, bloom_filter_offset), "Bloom filter object pointer dead");
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_ENTRY_INDEX(f->header) && !found_entry_index) {
+                error(offsetof(Header, entry_index_offset), "Entry index object pointer dead");
+                r = -EBADMSG;
+                goto fail;
+        }
+
         if (n_objects != le64toh(f->header->n_objects)) {
                 error(offsetof(Header, n_objects), "Object number mismatch");
                 r = -EBADMSG;
@@ -1257,19 +1700,12 @@ int journal_file_verify(
          * unreferenced objects. We only care that everything that is
          * referenced is consistent. */
 
-        r = verify_entry_array(f,
-                               cache_data_fd, n_data,
-                               cache_entry_fd, n_entries,
-                               cache_entry_array_fd, n_entry_arrays,
-                               &last_usec,
-                               show_progress);
-        if (r < 0)
-                goto fail;
-
-        r = verify_hash_table(f,
-                              cache_data_fd, n_data,
-                              cache_entry_fd, n_entries,
-                              cache_entry_array_fd, n_entry_arrays,
+        r = verify_references(f,
+                              data_fd, cache_data_fd, n_data,
+                              entry_fd, cache_entry_fd, n_entries,
+                              entry_array_fd, cache_entry_array_fd, n_entry_arrays,
+                              found_entry_index,
+                              n_threads,
                               &last_usec,
                               show_progress);
         if (r < 0)
@@ -3,4 +3,7 @@
 
 #include "journal-file.h"
 
-int journal_file_verify(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress);
+int journal_file_verify_full(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress, unsigned n_threads);
+static inline int journal_file_verify(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress) {
+        return journal_file_verify_full(f, key, first_contained, last_validated, last_contained, show_progress, 0);
+}
@@ -6,6 +6,7 @@
 #include <getopt.h>
 #include <linux/fs.h>
 #include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -29,6 +30,7 @@
 #include "bus-util.h"
 #include "catalog.h"
 #include "chattr-util.h"
+#include "cpu-set-util.h"
 #include "def.h"
 #include "device-private.h"
 #include "dissect-image.h"
@@ -133,6 +135,7 @@ static char **arg_output_fields = NULL;
 #if HAVE_PCRE2
 static const char *arg_pattern = NULL;
 static pcre2_code *arg_compiled_pattern = NULL;
+static bool arg_pattern_is_literal = false; /* no special characters, and matched case sensitively */
 static int arg_case_sensitive = -1; /* -1 means be smart */
 #endif
 
@@ -188,6 +191,57 @@ static int pattern_compile(const char *pattern, unsigned flags, pcre2_code **out
         *out = p;
         return 0;
 }
+
+static int pattern_match(pcre2_match_data **md, const char *message, size_t len, size_t ret_highlight[static 2]) {
+        PCRE2_SIZE *ovec;
+        int r;
+
+        assert(md);
+        assert(message || len == 0);
+
+        /* Returns > 0 if the message matches arg_pattern, 0 if not */
+
+        if (arg_pattern_is_literal) {
+                const char *found;
+
+                found = memmem(message, len, arg_pattern, strlen(arg_pattern));
+                if (!found)
+                        return 0;
+
+                ret_highlight[0] = found - message;
+                ret_highlight[1] = ret_highlight[0] + strlen(arg_pattern);
+                return 1;
+        }
+
+        if (!*md) {
+                *md = sym_pcre2_match_data_create(1, NULL);
+                if (!*md)
+                        return log_oom();
+        }
+
+        r = sym_pcre2_match(arg_compiled_pattern,
+                            (PCRE2_SPTR8) message,
+                            len,
+                            0,      /* start at offset 0 in the subject */
+                            0,      /* default options */
+                            *md,
+                            NULL);
+        if (r == PCRE2_ERROR_NOMATCH)
+                return 0;
+        if (r < 0) {
+                unsigned char buf[LINE_MAX];
+                int r2;
+
+                r2 = sym_pcre2_get_error_message(r, buf, sizeof buf);
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Pattern matching failed: %s",
+                                       r2 < 0 ? "unknown error" : (char*) buf);
+        }
+
+        ovec = sym_pcre2_get_ovector_pointer(*md);
+        ret_highlight[0] = ovec[0];
+        ret_highlight[1] = ovec[1];
+        return 1;
+}
 #endif
 
 static int add_matches_for_device(sd_journal *j, const char *devpath) {
@@ -365,8 +419,9 @@ static int help(void) {
                "                               short-iso, short-iso-precise, short-full,\n"
                "                               short-monotonic, short-unix, verbose, export,\n"
                "                               json, json-pretty, json-sse, json-seq, cat,\n"
-               "                               with-unit)\n"
-               "     --output-fields=LIST    Select fields to print in verbose/export/json modes\n"
+               "                               with-unit, columnar)\n"
+               "     --output-fields=LIST    Select fields to print in verbose/export/json/columnar\n"
+               "                               modes\n"
                "     --utc                   Express time in Coordinated Universal Time (UTC)\n"
                "  -x --catalog               Add message explanations where available\n"
                "     --no-full               Ellipsize fields\n"
@@ -567,7 +622,7 @@ static int parse_argv(int argc, char *argv[]) {
                         if (arg_output < 0)
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Unknown output format '%s'.", optarg);
 
-                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT))
+                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT, OUTPUT_COLUMNAR))
                                 arg_quiet = true;
 
                         break;
@@ -1132,6 +1187,16 @@ static int parse_argv(int argc, char *argv[]) {
                 r = pattern_compile(arg_pattern, flags, &arg_compiled_pattern);
                 if (r < 0)
                         return r;
+
+                /* The JIT is a lot faster than the interpreter. If libpcre2 was built without it, matching
+                 * falls back to the interpreter transparently. */
+                r = sym_pcre2_jit_compile(arg_compiled_pattern, PCRE2_JIT_COMPLETE);
+                if (r < 0)
+                        log_debug("JIT compilation of pattern not available, using the interpreter.");
+
+                /* A pattern without any special characters that is matched case sensitively is just a
+                 * substring, which we can look for without going through PCRE2 at all. */
+                arg_pattern_is_literal = !(flags & PCRE2_CASELESS) && !strpbrk(arg_pattern, "\\^$.|?*+()[]{}");
         }
 #endif
 
@@ -1958,44 +2023,161 @@ static int setup_keys(void) {
 #endif
 }
 
+typedef struct VerifyJob {
+        JournalFile *f;
+        usec_t first, validated, last;
+        int r;
+} VerifyJob;
+
+typedef struct VerifyPool {
+        VerifyJob *jobs;
+        size_t n_jobs;
+        size_t next;
+        unsigned n_threads_per_file;
+} VerifyPool;
+
+static void verify_job_run(VerifyJob *job, bool show_progress, unsigned n_threads) {
+        JournalFile *copy = NULL, *f;
+
+        assert(job);
+
+        /* When running in a thread of our own, don't share the JournalFile object (and its mmap cache) with
+         * anybody else, but open the file once more. */
+        if (n_threads > 0 &&
+            journal_file_open(-1, job->f->path, O_RDONLY, 0, false, 0, false, NULL, NULL, NULL, NULL, &copy) >= 0)
+                f = copy;
+        else
+                f = job->f;
+
+        job->r = journal_file_verify_full(f, arg_verify_key, &job->first, &job->validated, &job->last, show_progress, n_threads);
+
+        if (copy)
+                (void) journal_file_close(copy);
+}
+
+static void* verify_thread(void *userdata) {
+        VerifyPool *pool = userdata;
+        size_t i;
+
+        (void) pthread_setname_np(pthread_self(), "journal-verify");
+
+        while ((i = __sync_fetch_and_add(&pool->next, 1)) < pool->n_jobs)
+                verify_job_run(pool->jobs + i, false, pool->n_threads_per_file);
+
+        return NULL;
+}
+
+static int verify_jobs_run(VerifyJob *jobs, size_t n_jobs) {
+        _cleanup_free_ pthread_t *threads = NULL;
+        VerifyPool pool = {
+                .jobs = jobs,
+                .n_jobs = n_jobs,
+        };
+        size_t n_threads, n_started = 0, i;
+        sigset_t ss, saved_ss;
+        int ncpus, r;
+
+        assert(jobs || n_jobs == 0);
+
+        ncpus = cpus_in_affinity_mask();
+        n_threads = ncpus > 1 ? MIN(n_jobs, (size_t) ncpus) : 1;
+
+        if (n_threads <= 1) {
+                /* Nothing to parallelize over files, hence let the verification of each file use all CPUs
+                 * itself, and show progress while doing so. */
+                for (i = 0; i < n_jobs; i++)
+                        verify_job_run(jobs + i, true, 0);
+                return 0;
+        }
+
+        /* Spread the CPUs over the files verified concurrently, the rest is used within each file. */
+        pool.n_threads_per_file = MAX(1U, (unsigned) (ncpus / n_threads));
+
+        threads = new(pthread_t, n_threads);
+        if (!threads)
+                return log_oom();
+
+        /* Don't block SIGBUS, since the threads access memory mapped files */
+        assert_se(sigfillset(&ss) >= 0);
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return log_error_errno(r, "Failed to block signals: %m");
+
+        for (i = 0; i < n_threads; i++) {
+                r = pthread_create(threads + n_started, NULL, verify_thread, &pool);
+                if (r > 0) {
+                        log_debug_errno(r, "Failed to start verification thread, ignoring: %m");
+                        break;
+                }
+
+                n_started++;
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        /* Help out, which also makes sure we make progress if no thread could be started. */
+        (void) verify_thread(&pool);
+
+        for (i = 0; i < n_started; i++)
+                assert_se(pthread_join(threads[i], NULL) == 0);
+
+        return 0;
+}
+
 static int verify(sd_journal *j) {
+        _cleanup_free_ VerifyJob *jobs = NULL;
+        size_t n_jobs = 0, i;
         int r = 0;
-        Iterator i;
+        Iterator it;
         JournalFile *f;
 
         assert(j);
 
         log_show_color(true);
 
-        ORDERED_HASHMAP_FOREACH(f, j->files, i) {
-                int k;
-                usec_t first = 0, validated = 0, last = 0;
+        jobs = new0(VerifyJob, ordered_hashmap_size(j->files));
+        if (!jobs && ordered_hashmap_size(j->files) > 0)
+                return log_oom();
 
+        ORDERED_HASHMAP_FOREACH(f, j->files, it) {
 #if HAVE_GCRYPT
                 if (!arg_verify_key && JOURNAL_HEADER_SEALED(f->header))
                         log_notice("Journal file %s has sealing enabled but verification key has not been passed using --verify-key=.", f->path);
 #endif
 
-                k = journal_file_verify(f, arg_verify_key, &first, &validated, &last, true);
-                if (k == -EINVAL) {
+                jobs[n_jobs++].f = f;
+        }
+
+        r = verify_jobs_run(jobs, n_jobs);
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < n_jobs; i++) {
+                VerifyJob *job = jobs + i;
+
+                f = job->f;
+
+                if (job->r == -EINVAL) {
                         /* If the key was invalid give up right-away. */
-                        return k;
-                } else if (k < 0) {
-                        log_warning_errno(k, "FAIL: %s (%m)", f->path);
-                        r = k;
+                        return job->r;
+                } else if (job->r < 0) {
+                        log_warning_errno(job->r, "FAIL: %s (%m)", f->path);
+                        r = job->r;
                 } else {
                         char a[FORMAT_TIMESTAMP_MAX], b[FORMAT_TIMESTAMP_MAX], c[FORMAT_TIMESPAN_MAX];
                         log_info("PASS: %s", f->path);
 
                         if (arg_verify_key && JOURNAL_HEADER_SEALED(f->header)) {
-                                if (validated > 0) {
+                                if (job->validated > 0) {
                                         log_info("=> Validated from %s to %s, final %s entries not sealed.",
-                                                 format_timestamp_maybe_utc(a, sizeof(a), first),
-                                                 format_timestamp_maybe_utc(b, sizeof(b), validated),
-                                                 format_timespan(c, sizeof(c), last > validated ? last - validated : 0, 0));
-                                } else if (last > 0)
+                                                 format_timestamp_maybe_utc(a, sizeof(a), job->first),
+                                                 format_timestamp_maybe_utc(b, sizeof(b), job->validated),
+                                                 format_timespan(c, sizeof(c), job->last > job->validated ? job->last - job->validated : 0, 0));
+                                } else if (job->last > 0)
                                         log_info("=> No sealing yet, %s of entries not sealed.",
-                                                 format_timespan(c, sizeof(c), last - first, 0));
+                                                 format_timespan(c, sizeof(c), job->last - job->first, 0));
                                 else
                                         log_info("=> No sealing yet, no entries in file.");
                         }
@@ -2099,6 +2281,10 @@ int main(int argc, char *argv[]) {
         bool previous_boot_id_valid = false, first_line = true, ellipsized = false, need_seek = false;
         bool use_cursor = false, after_cursor = false;
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_(output_columns_freep) OutputColumns *columns = NULL;
+#if HAVE_PCRE2
+        _cleanup_(sym_pcre2_match_data_freep) pcre2_match_data *md = NULL;
+#endif
         sd_id128_t previous_boot_id;
         int n_shown = 0, r, poll_fd = -1;
 
@@ -2582,6 +2768,15 @@ int main(int argc, char *argv[]) {
                 }
         }
 
+        if (arg_output == OUTPUT_COLUMNAR) {
+                /* Collect entries into batches, rather than writing them out one by one */
+                r = output_columns_new(arg_output_fields, &columns);
+                if (r < 0) {
+                        log_oom();
+                        goto finish;
+                }
+        }
+
         for (;;) {
                 while (arg_lines < 0 || n_shown < arg_lines || (arg_follow && !first_line)) {
                         int flags;
@@ -2641,14 +2836,8 @@ int main(int argc, char *argv[]) {
 
 #if HAVE_PCRE2
                         if (arg_compiled_pattern) {
-                                _cleanup_(sym_pcre2_match_data_freep) pcre2_match_data *md = NULL;
                                 const void *message;
                                 size_t len;
-                                PCRE2_SIZE *ovec;
-
-                                md = sym_pcre2_match_data_create(1, NULL);
-                                if (!md)
-                                        return log_oom();
 
                                 r = sd_journal_get_data(j, "MESSAGE", &message, &len);
                                 if (r < 0) {
@@ -2663,31 +2852,13 @@ int main(int argc, char *argv[]) {
 
                                 assert_se(message = startswith(message, "MESSAGE="));
 
-                                r = sym_pcre2_match(arg_compiled_pattern,
-                                                    message,
-                                                    len - strlen("MESSAGE="),
-                                                    0,      /* start at offset 0 in the subject */
-                                                    0,      /* default options */
-                                                    md,
-                                                    NULL);
-                                if (r == PCRE2_ERROR_NOMATCH) {
+                                r = pattern_match(&md, message, len - strlen("MESSAGE="), highlight);
+                                if (r < 0)
+                                        goto finish;
+                                if (r == 0) {
                                         need_seek = true;
                                         continue;
                                 }
-                                if (r < 0) {
-                                        unsigned char buf[LINE_MAX];
-                                        int r2;
-
-                                        r2 = sym_pcre2_get_error_message(r, buf, sizeof buf);
-                                        log_error("Pattern matching failed: %s",
-                                                  r2 < 0 ? "unknown error" : (char*) buf);
-                                        r = -EINVAL;
-                                        goto finish;
-                                }
-
-                                ovec = sym_pcre2_get_ovector_pointer(md);
-                                highlight[0] = ovec[0];
-                                highlight[1] = ovec[1];
                         }
 #endif
 
@@ -2699,8 +2870,13 @@ int main(int argc, char *argv[]) {
                                 arg_utc * OUTPUT_UTC |
                                 arg_no_hostname * OUTPUT_NO_HOSTNAME;
 
-                        r = show_journal_entry(stdout, j, arg_output, 0, flags,
-                                               arg_output_fields, highlight, &ellipsized);
+                        if (columns) {
+                                r = output_columns_add_entry(columns, j);
+                                if (r > 0)
+                                        r = output_columns_flush(columns, stdout);
+                        } else
+                                r = show_journal_entry(stdout, j, arg_output, 0, flags,
+                                                       arg_output_fields, highlight, &ellipsized);
                         need_seek = true;
                         if (r == -EADDRNOTAVAIL)
                                 break;
@@ -2724,6 +2900,12 @@ int main(int argc, char *argv[]) {
                         }
                 }
 
+                if (columns) {
+                        r = output_columns_flush(columns, stdout);
+                        if (r < 0)
+                                goto finish;
+                }
+
                 if (!arg_follow) {
                         if (n_shown == 0 && !arg_quiet)
                                 printf("-- No entries --\n");
@@ -0,0 +1,455 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include "alloc-util.h"
+#include "compress.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "journald-compress.h"
+#include "journald-server.h"
+#include "list.h"
+
+/* Data fields above the compression threshold may be compressed in worker threads rather than on the event
+ * loop, so that a client logging huge messages does not stall everybody else. To keep the order of entries
+ * intact, every entry that is logged while older entries are still being compressed is queued up behind them,
+ * and entries are only written out from the head of that queue, once all of their fields are done. */
+
+#define WRITE_ENTRIES_MAX 64U
+
+typedef struct CompressJob CompressJob;
+typedef struct PendingEntry PendingEntry;
+
+struct CompressJob {
+        PendingEntry *entry;
+        size_t field;
+
+        LIST_FIELDS(CompressJob, jobs);
+};
+
+struct PendingEntry {
+        uid_t uid;
+        int priority;
+        dual_timestamp ts;
+
+        /* The iovec array and the payload are stored in the same allocation */
+        struct iovec *iovec;
+        size_t n_iovec;
+
+        JournalPrecompressed *precompressed;
+
+        CompressJob *jobs;
+        unsigned n_jobs_left; /* protected by CompressWorkers.mutex */
+
+        LIST_FIELDS(PendingEntry, pending);
+};
+
+struct CompressWorkers {
+        pthread_t *threads;
+        unsigned n_threads;
+
+        pthread_mutex_t mutex;
+        pthread_cond_t work_cond;
+        pthread_cond_t done_cond;
+        bool exiting;
+
+        /* Both protected by the mutex */
+        LIST_HEAD(CompressJob, jobs);
+        CompressJob *jobs_tail;
+
+        /* Only accessed from the event loop thread */
+        LIST_HEAD(PendingEntry, pending);
+        PendingEntry *pending_tail;
+
+        int notify_fd;
+        sd_event_source *notify_event_source;
+};
+
+static PendingEntry* pending_entry_free(PendingEntry *e) {
+        if (!e)
+                return NULL;
+
+        if (e->precompressed)
+                for (size_t i = 0; i < e->n_iovec; i++)
+                        if (e->precompressed[i].compression > 0)
+                                free((void*) e->precompressed[i].data);
+
+        free(e->precompressed);
+        free(e->jobs);
+        free(e->iovec);
+        return mfree(e);
+}
+
+static void compress_job_run(CompressJob *j, JournalPrecompressed *ret) {
+        const struct iovec *v;
+        size_t rsize = 0;
+        void *buffer;
+        int r;
+
+        assert(j);
+        assert(ret);
+
+        v = j->entry->iovec + j->field;
+
+        /* Like journal_file_append_data(), only accept results that are actually smaller */
+        buffer = malloc(v->iov_len - 1);
+        if (!buffer) {
+                *ret = (JournalPrecompressed) {};
+                return;
+        }
+
+        r = compress_blob(v->iov_base, v->iov_len, buffer, v->iov_len - 1, &rsize);
+        if (r <= 0) {
+                free(buffer);
+                *ret = (JournalPrecompressed) { .compression = -1 };
+                return;
+        }
+
+        *ret = (JournalPrecompressed) {
+                .compression = r,
+                .data = buffer,
+                .size = rsize,
+        };
+}
+
+static void* compress_worker_thread(void *p) {
+        CompressWorkers *w = p;
+        static const uint64_t one = 1;
+
+        assert(w);
+
+        (void) pthread_setname_np(pthread_self(), "journal-compress");
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        for (;;) {
+                JournalPrecompressed result;
+                CompressJob *j;
+
+                while (!w->jobs && !w->exiting)
+                        assert_se(pthread_cond_wait(&w->work_cond, &w->mutex) == 0);
+
+                /* Finish all queued jobs before exiting, the event loop waits for them */
+                j = w->jobs;
+                if (!j)
+                        break;
+
+                LIST_REMOVE(jobs, w->jobs, j);
+                if (w->jobs_tail == j)
+                        w->jobs_tail = NULL;
+
+                assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+                compress_job_run(j, &result);
+
+                assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+                j->entry->precompressed[j->field] = result;
+                assert(j->entry->n_jobs_left > 0);
+                j->entry->n_jobs_left--;
+
+                assert_se(pthread_cond_broadcast(&w->done_cond) == 0);
+
+                (void) write(w->notify_fd, &one, sizeof(one));
+        }
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        return NULL;
+}
+
+static void compress_workers_write_ready(Server *s, bool wait) {
+        CompressWorkers *w;
+
+        assert(s);
+
+        w = s->compress_workers;
+        if (!w)
+                return;
+
+        for (;;) {
+                JournalEntryInput entries[WRITE_ENTRIES_MAX];
+                PendingEntry *e, *batch[WRITE_ENTRIES_MAX];
+                size_t n = 0;
+                int priority = LOG_DEBUG;
+
+                /* Collect consecutive entries from the head of the queue that are ready and go to the same
+                 * file, so that they can be written in one go. */
+                assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+                for (e = w->pending; e && n < WRITE_ENTRIES_MAX; e = e->pending_next) {
+                        if (n > 0 && e->uid != batch[0]->uid)
+                                break;
+
+                        if (wait && n == 0)
+                                while (e->n_jobs_left > 0)
+                                        assert_se(pthread_cond_wait(&w->done_cond, &w->mutex) == 0);
+                        else if (e->n_jobs_left > 0)
+                                break;
+
+                        batch[n++] = e;
+                }
+
+                assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+                if (n == 0)
+                        return;
+
+                for (size_t i = 0; i < n; i++) {
+                        LIST_REMOVE(pending, w->pending, batch[i]);
+                        if (w->pending_tail == batch[i])
+                                w->pending_tail = NULL;
+
+                        entries[i] = (JournalEntryInput) {
+                                .ts = batch[i]->ts,
+                                .iovec = batch[i]->iovec,
+                                .n_iovec = batch[i]->n_iovec,
+                                .precompressed = batch[i]->precompressed,
+                        };
+                        priority = MIN(priority, batch[i]->priority);
+                }
+
+                server_write_entries(s, batch[0]->uid, entries, n, priority);
+
+                for (size_t i = 0; i < n; i++)
+                        pending_entry_free(batch[i]);
+        }
+}
+
+static int on_compress_done(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
+        Server *s = userdata;
+
+        assert(s);
+
+        (void) flush_fd(fd);
+
+        compress_workers_write_ready(s, false);
+        return 0;
+}
+
+static bool server_compress_wants_field(Server *s, const struct iovec *iovec) {
+        assert(s);
+        assert(iovec);
+
+        return s->compress.enabled &&
+                iovec->iov_len >= journal_file_compress_threshold(s->compress.threshold_bytes);
+}
+
+bool server_compress_wants_entry(Server *s, const struct iovec *iovec, size_t n) {
+        assert(s);
+        assert(iovec || n == 0);
+
+        if (!s->compress_workers)
+                return false;
+
+        /* If anything is still queued, this entry needs to go behind it */
+        if (s->compress_workers->pending)
+                return true;
+
+        for (size_t i = 0; i < n; i++)
+                if (server_compress_wants_field(s, iovec + i))
+                        return true;
+
+        return false;
+}
+
+int server_compress_queue_entry(Server *s, uid_t uid, const dual_timestamp *ts, const struct iovec *iovec, size_t n, int priority) {
+        PendingEntry *e = NULL;
+        CompressWorkers *w;
+        size_t i, sz, n_jobs = 0;
+        uint8_t *p;
+
+        assert(s);
+        assert(s->compress_workers);
+        assert(ts);
+        assert(iovec);
+        assert(n > 0);
+
+        w = s->compress_workers;
+
+        e = new(PendingEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (PendingEntry) {
+                .uid = uid,
+                .priority = priority,
+                .ts = *ts,
+                .n_iovec = n,
+        };
+
+        sz = n * sizeof(struct iovec);
+        for (i = 0; i < n; i++)
+                sz += iovec[i].iov_len;
+
+        e->iovec = malloc(sz);
+        e->precompressed = new0(JournalPrecompressed, n);
+        e->jobs = new(CompressJob, n);
+        if (!e->iovec || !e->precompressed || !e->jobs) {
+                pending_entry_free(e);
+                return -ENOMEM;
+        }
+
+        p = (uint8_t*) (e->iovec + n);
+        for (i = 0; i < n; i++) {
+                e->iovec[i] = IOVEC_MAKE(p, iovec[i].iov_len);
+                p = mempcpy(p, iovec[i].iov_base, iovec[i].iov_len);
+
+                if (server_compress_wants_field(s, iovec + i))
+                        e->jobs[n_jobs++] = (CompressJob) {
+                                .entry = e,
+                                .field = i,
+                        };
+        }
+
+        e->n_jobs_left = n_jobs;
+
+        LIST_INSERT_AFTER(pending, w->pending, w->pending_tail, e);
+        w->pending_tail = e;
+
+        if (n_jobs == 0)
+                return 0;
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        for (i = 0; i < n_jobs; i++) {
+                LIST_INSERT_AFTER(jobs, w->jobs, w->jobs_tail, e->jobs + i);
+                w->jobs_tail = e->jobs + i;
+        }
+
+        assert_se(pthread_cond_broadcast(&w->work_cond) == 0);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        return (int) n_jobs;
+}
+
+void server_compress_flush(Server *s) {
+        assert(s);
+
+        /* Blocks until everything queued so far is compressed and written */
+        compress_workers_write_ready(s, true);
+}
+
+int server_compress_workers_start(Server *s) {
+        _cleanup_free_ CompressWorkers *w = NULL;
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(s);
+        assert(!s->compress_workers);
+
+        if (s->compress_threads == 0)
+                return 0;
+
+        if (!HAVE_COMPRESSION) {
+                log_warning("Compression support not compiled in, ignoring CompressThreads=%u.", s->compress_threads);
+                return 0;
+        }
+
+        w = new(CompressWorkers, 1);
+        if (!w)
+                return log_oom();
+
+        *w = (CompressWorkers) {
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
+                .work_cond = PTHREAD_COND_INITIALIZER,
+                .done_cond = PTHREAD_COND_INITIALIZER,
+                .notify_fd = -1,
+        };
+
+        w->threads = new(pthread_t, s->compress_threads);
+        if (!w->threads)
+                return log_oom();
+
+        w->notify_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (w->notify_fd < 0) {
+                r = log_error_errno(errno, "Failed to allocate eventfd for compression threads: %m");
+                goto fail;
+        }
+
+        r = sd_event_add_io(s->event, &w->notify_event_source, w->notify_fd, EPOLLIN, on_compress_done, s);
+        if (r < 0) {
+                log_error_errno(r, "Failed to add compression notification event source: %m");
+                goto fail;
+        }
+
+        /* Write out completed entries before dealing with new messages, so that the queue stays short */
+        r = sd_event_source_set_priority(w->notify_event_source, SD_EVENT_PRIORITY_NORMAL-5);
+        if (r < 0) {
+                log_error_errno(r, "Failed to adjust compression notification event source priority: %m");
+                goto fail;
+        }
+
+        (void) sd_event_source_set_description(w->notify_event_source, "compress-done");
+
+        /* Make sure the worker threads don't steal any signals from us */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0) {
+                r = log_error_errno(r, "Failed to block signals: %m");
+                goto fail;
+        }
+
+        for (; w->n_threads < s->compress_threads; w->n_threads++) {
+                r = pthread_create(w->threads + w->n_threads, NULL, compress_worker_thread, w);
+                if (r > 0)
+                        break;
+        }
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0) {
+                r = log_error_errno(r, "Failed to start compression thread: %m");
+                goto fail;
+        }
+        if (k > 0) {
+                r = log_error_errno(k, "Failed to restore signal mask: %m");
+                goto fail;
+        }
+
+        log_debug("Started %u compression threads.", w->n_threads);
+
+        s->compress_workers = TAKE_PTR(w);
+        return 0;
+
+fail:
+        s->compress_workers = TAKE_PTR(w);
+        server_compress_workers_stop(s);
+        return r;
+}
+
+void server_compress_workers_stop(Server *s) {
+        CompressWorkers *w;
+
+        assert(s);
+
+        w = s->compress_workers;
+        if (!w)
+                return;
+
+        /* Write out everything we still have, so that nothing is lost */
+        if (w->n_threads > 0)
+                server_compress_flush(s);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+        w->exiting = true;
+        assert_se(pthread_cond_broadcast(&w->work_cond) == 0);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        for (unsigned i = 0; i < w->n_threads; i++)
+                (void) pthread_join(w->threads[i], NULL);
+
+        while (w->pending) {
+                PendingEntry *e = w->pending;
+
+                LIST_REMOVE(pending, w->pending, e);
+                pending_entry_free(e);
+        }
+
+        sd_event_source_unref(w->notify_event_source);
+        safe_close(w->notify_fd);
+
+        free(w->threads);
+        s->compress_workers = mfree(w);
+}
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <sys/uio.h>
+
+#include "journald-server.h"
+#include "time-util.h"
+
+typedef struct CompressWorkers CompressWorkers;
+
+int server_compress_workers_start(Server *s);
+void server_compress_workers_stop(Server *s);
+
+bool server_compress_wants_entry(Server *s, const struct iovec *iovec, size_t n);
+/* Returns the number of fields handed to the worker threads */
+int server_compress_queue_entry(Server *s, uid_t uid, const dual_timestamp *ts, const struct iovec *iovec, size_t n, int priority);
+void server_compress_flush(Server *s);
@@ -4,16 +4,20 @@
 #include <selinux/selinux.h>
 #endif
 
+#include <poll.h>
+
 #include "alloc-util.h"
 #include "audit-util.h"
 #include "cgroup-util.h"
 #include "env-util.h"
+#include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
 #include "io-util.h"
 #include "journal-util.h"
 #include "journald-context.h"
+#include "missing_syscall.h"
 #include "parse-util.h"
 #include "path-util.h"
 #include "process-util.h"
@@ -48,6 +52,14 @@
  *    stream connection. This should improve cases where a service process logs immediately before exiting and we
  *    previously had trouble associating the log message with the service.
  *
+ * The metadata that is derived from the cgroup of a client (i.e. the unit and everything read from the unit's files in
+ * /run/systemd/units/) is the same for all processes of a unit. It is kept in a second cache, indexed by the cgroup
+ * path, which is consulted whenever a client context is created or refreshed, so that processes which log only once
+ * before exiting only pay for the per-process data in /proc.
+ *
+ * Where available, each cache entry also holds a pidfd for its process. As long as the pidfd reports the process as
+ * running, its PID cannot have been reused, hence the entry does not have to be flushed after 5s in that case.
+ *
  * NB: With and without the metadata cache: the implicitly added entry metadata in the journal (with the exception of
  *     UID/PID/GID and SELinux label) must be understood as possibly slightly out of sync (i.e. sometimes slightly older
  *     and sometimes slightly newer than what was current at the log event).
@@ -90,6 +102,35 @@ static size_t cache_max(void) {
         return cached;
 }
 
+typedef struct ClientUnitContext {
+        char *key; /* Either a cgroup path (if it starts with a "/"), or a unit name */
+        unsigned lru_index;
+        usec_t timestamp;
+        uint64_t generation;
+
+        char *session;
+        uid_t owner_uid;
+
+        char *unit;
+        char *user_unit;
+
+        char *slice;
+        char *user_slice;
+
+        sd_id128_t invocation_id;
+
+        int log_level_max;
+
+        struct iovec *extra_fields_iovec;
+        size_t extra_fields_n_iovec;
+        void *extra_fields_data;
+        size_t extra_fields_size;
+        nsec_t extra_fields_mtime;
+
+        usec_t log_ratelimit_interval;
+        unsigned log_ratelimit_burst;
+} ClientUnitContext;
+
 static int client_context_compare(const void *a, const void *b) {
         const ClientContext *x = a, *y = b;
         int r;
@@ -101,6 +142,39 @@ static int client_context_compare(const void *a, const void *b) {
         return CMP(x->pid, y->pid);
 }
 
+static void client_context_open_pidfd(ClientContext *c) {
+        assert(c);
+        assert(c->pidfd < 0);
+
+        /* Pin the process, if we can. If the process is already gone or pidfds are not supported we fall back
+         * to the PID alone. */
+        c->pidfd = pidfd_open(c->pid, 0);
+        if (c->pidfd < 0 && errno != ESRCH && !ERRNO_IS_NOT_SUPPORTED(errno) && !ERRNO_IS_PRIVILEGE(errno))
+                log_debug_errno(errno, "Failed to open pidfd for PID " PID_FMT ", ignoring: %m", c->pid);
+}
+
+static int client_context_pid_alive(ClientContext *c) {
+        struct pollfd pollfd;
+
+        assert(c);
+
+        /* Returns > 0 if the process is still running, 0 if it exited, and < 0 if we can't tell without
+         * resorting to the PID. A pidfd becomes readable when its process exits. */
+
+        if (c->pidfd < 0)
+                return -EBADF;
+
+        pollfd = (struct pollfd) {
+                .fd = c->pidfd,
+                .events = POLLIN,
+        };
+
+        if (poll(&pollfd, 1, 0) < 0)
+                return -errno;
+
+        return !(pollfd.revents & POLLIN);
+}
+
 static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
         ClientContext *c;
         int r;
@@ -123,6 +197,7 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
 
         *c = (ClientContext) {
                 .pid = pid,
+                .pidfd = -1,
                 .uid = UID_INVALID,
                 .gid = GID_INVALID,
                 .auditid = AUDIT_SESSION_INVALID,
@@ -142,6 +217,8 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
                 return r;
         }
 
+        client_context_open_pidfd(c);
+
         *ret = c;
         return 0;
 }
@@ -185,6 +262,8 @@ static void client_context_reset(Server *s, ClientContext *c) {
 
         c->log_ratelimit_interval = s->ratelimit_interval;
         c->log_ratelimit_burst = s->ratelimit_burst;
+
+        c->unit_generation = 0;
 }
 
 static ClientContext* client_context_free(Server *s, ClientContext *c) {
@@ -200,6 +279,8 @@ static ClientContext* client_context_free(Server *s, ClientContext *c) {
 
         client_context_reset(s, c);
 
+        safe_close(c->pidfd);
+
         return mfree(c);
 }
 
@@ -274,77 +355,136 @@ static int client_context_read_label(
         return 0;
 }
 
-static int client_context_read_cgroup(Server *s, ClientContext *c, const char *unit_id) {
-        _cleanup_free_ char *t = NULL;
+static int client_unit_context_compare(const void *a, const void *b) {
+        const ClientUnitContext *x = a, *y = b;
         int r;
 
-        assert(c);
+        r = CMP(x->timestamp, y->timestamp);
+        if (r != 0)
+                return r;
 
-        /* Try to acquire the current cgroup path */
-        r = cg_pid_get_path_shifted(c->pid, s->cgroup_root, &t);
-        if (r < 0 || empty_or_root(t)) {
-                /* We use the unit ID passed in as fallback if we have nothing cached yet and cg_pid_get_path_shifted()
-                 * failed or process is running in a root cgroup. Zombie processes are automatically migrated to root cgroup
-                 * on cgroup v1 and we want to be able to map log messages from them too. */
-                if (unit_id && !c->unit) {
-                        c->unit = strdup(unit_id);
-                        if (c->unit)
-                                return 0;
-                }
+        return strcmp(x->key, y->key);
+}
+
+static ClientUnitContext* client_unit_context_free(Server *s, ClientUnitContext *u) {
+        assert(s);
 
+        if (!u)
+                return NULL;
+
+        assert_se(hashmap_remove(s->client_unit_contexts, u->key) == u);
+
+        if (u->lru_index != PRIOQ_IDX_NULL)
+                assert_se(prioq_remove(s->client_unit_contexts_lru, u, &u->lru_index) >= 0);
+
+        free(u->key);
+        free(u->session);
+        free(u->unit);
+        free(u->user_unit);
+        free(u->slice);
+        free(u->user_slice);
+        free(u->extra_fields_iovec);
+        free(u->extra_fields_data);
+
+        return mfree(u);
+}
+
+static void client_unit_context_try_shrink_to(Server *s, size_t limit, usec_t older_than) {
+        ClientUnitContext *u;
+
+        assert(s);
+
+        /* Drop the oldest entries until there are at most 'limit' left, and any that weren't refreshed since
+         * 'older_than'. */
+
+        while ((u = prioq_peek(s->client_unit_contexts_lru)) &&
+               (hashmap_size(s->client_unit_contexts) > limit || u->timestamp < older_than))
+                client_unit_context_free(s, u);
+}
+
+static int client_unit_context_new(Server *s, const char *key, ClientUnitContext **ret) {
+        _cleanup_free_ ClientUnitContext *u = NULL;
+        int r;
+
+        assert(s);
+        assert(key);
+        assert(ret);
+
+        r = hashmap_ensure_allocated(&s->client_unit_contexts, &string_hash_ops);
+        if (r < 0)
                 return r;
-        }
 
-        /* Let's shortcut this if the cgroup path didn't change */
-        if (streq_ptr(c->cgroup, t))
-                return 0;
+        r = prioq_ensure_allocated(&s->client_unit_contexts_lru, client_unit_context_compare);
+        if (r < 0)
+                return r;
 
-        free_and_replace(c->cgroup, t);
+        u = new(ClientUnitContext, 1);
+        if (!u)
+                return -ENOMEM;
 
-        (void) cg_path_get_session(c->cgroup, &t);
-        free_and_replace(c->session, t);
+        *u = (ClientUnitContext) {
+                .lru_index = PRIOQ_IDX_NULL,
+                .timestamp = USEC_INFINITY,
+                .owner_uid = UID_INVALID,
+                .extra_fields_mtime = NSEC_INFINITY,
+                .log_level_max = -1,
+                .log_ratelimit_interval = s->ratelimit_interval,
+                .log_ratelimit_burst = s->ratelimit_burst,
+        };
 
-        if (cg_path_get_owner_uid(c->cgroup, &c->owner_uid) < 0)
-                c->owner_uid = UID_INVALID;
+        u->key = strdup(key);
+        if (!u->key)
+                return -ENOMEM;
 
-        (void) cg_path_get_unit(c->cgroup, &t);
-        free_and_replace(c->unit, t);
+        r = hashmap_put(s->client_unit_contexts, u->key, u);
+        if (r < 0) {
+                free(u->key);
+                return r;
+        }
 
-        (void) cg_path_get_user_unit(c->cgroup, &t);
-        free_and_replace(c->user_unit, t);
+        /* From here on the entry is registered, hence release it through client_unit_context_free() */
+        if (key[0] == '/') {
+                (void) cg_path_get_session(key, &u->session);
 
-        (void) cg_path_get_slice(c->cgroup, &t);
-        free_and_replace(c->slice, t);
+                if (cg_path_get_owner_uid(key, &u->owner_uid) < 0)
+                        u->owner_uid = UID_INVALID;
 
-        (void) cg_path_get_user_slice(c->cgroup, &t);
-        free_and_replace(c->user_slice, t);
+                (void) cg_path_get_unit(key, &u->unit);
+                (void) cg_path_get_user_unit(key, &u->user_unit);
+                (void) cg_path_get_slice(key, &u->slice);
+                (void) cg_path_get_user_slice(key, &u->user_slice);
+        } else {
+                u->unit = strdup(key);
+                if (!u->unit) {
+                        client_unit_context_free(s, TAKE_PTR(u));
+                        return -ENOMEM;
+                }
+        }
 
+        *ret = TAKE_PTR(u);
         return 0;
 }
 
-static int client_context_read_invocation_id(
-                Server *s,
-                ClientContext *c) {
-
+static int client_unit_context_get_invocation_id(ClientUnitContext *u, sd_id128_t *ret) {
         _cleanup_free_ char *p = NULL, *value = NULL;
         int r;
 
-        assert(s);
-        assert(c);
+        assert(u);
+        assert(ret);
 
         /* Read the invocation ID of a unit off a unit.
          * PID 1 stores it in a per-unit symlink in /run/systemd/units/
          * User managers store it in a per-unit symlink under /run/user/<uid>/systemd/units/ */
 
-        if (!c->unit)
+        if (!u->unit)
                 return 0;
 
-        if (c->user_unit) {
-                r = asprintf(&p, "/run/user/" UID_FMT "/systemd/units/invocation:%s", c->owner_uid, c->user_unit);
+        if (u->user_unit) {
+                r = asprintf(&p, "/run/user/" UID_FMT "/systemd/units/invocation:%s", u->owner_uid, u->user_unit);
                 if (r < 0)
                         return r;
         } else {
-                p = strjoin("/run/systemd/units/invocation:", c->unit);
+                p = strjoin("/run/systemd/units/invocation:", u->unit);
                 if (!p)
                         return -ENOMEM;
         }
@@ -353,21 +493,47 @@ static int client_context_read_invocation_id(
         if (r < 0)
                 return r;
 
-        return sd_id128_from_string(value, &c->invocation_id);
+        r = sd_id128_from_string(value, ret);
+        if (r < 0)
+                return r;
+
+        return 1;
 }
 
-static int client_context_read_log_level_max(
-                Server *s,
-                ClientContext *c) {
+static int client_unit_context_read_invocation_id(ClientUnitContext *u) {
+        assert(u);
+
+        return client_unit_context_get_invocation_id(u, &u->invocation_id);
+}
+
+static bool client_unit_context_is_current(ClientUnitContext *u, usec_t timestamp) {
+        sd_id128_t id;
 
+        assert(u);
+
+        if (u->timestamp + REFRESH_USEC < timestamp)
+                return false;
+
+        /* PID 1 updates the invocation ID and all other per-unit files before it forks off the processes
+         * of a new invocation. If the unit was restarted since we last looked, the first messages of its
+         * new processes hence must not get the old invocation's metadata, but all of it must be reread. */
+        if (client_unit_context_get_invocation_id(u, &id) <= 0)
+                return true;
+
+        return sd_id128_equal(id, u->invocation_id);
+}
+
+static int client_unit_context_read_log_level_max(ClientUnitContext *u) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r, ll;
 
-        if (!c->unit)
+        assert(u);
+
+        if (!u->unit)
                 return 0;
 
-        p = strjoina("/run/systemd/units/log-level-max:", c->unit);
+        p = strjoina("/run/systemd/units/log-level-max:", u->unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
@@ -376,14 +542,11 @@ static int client_context_read_log_level_max(
         if (ll < 0)
                 return -EINVAL;
 
-        c->log_level_max = ll;
+        u->log_level_max = ll;
         return 0;
 }
 
-static int client_context_read_extra_fields(
-                Server *s,
-                ClientContext *c) {
-
+static int client_unit_context_read_extra_fields(ClientUnitContext *u) {
         size_t size = 0, n_iovec = 0, n_allocated = 0, left;
         _cleanup_free_ struct iovec *iovec = NULL;
         _cleanup_free_ void *data = NULL;
@@ -393,12 +556,14 @@ static int client_context_read_extra_fields(
         uint8_t *q;
         int r;
 
-        if (!c->unit)
+        assert(u);
+
+        if (!u->unit)
                 return 0;
 
-        p = strjoina("/run/systemd/units/log-extra-fields:", c->unit);
+        p = strjoina("/run/systemd/units/log-extra-fields:", u->unit);
 
-        if (c->extra_fields_mtime != NSEC_INFINITY) {
+        if (u->extra_fields_mtime != NSEC_INFINITY) {
                 if (stat(p, &st) < 0) {
                         if (errno == ENOENT)
                                 return 0;
@@ -406,7 +571,7 @@ static int client_context_read_extra_fields(
                         return -errno;
                 }
 
-                if (timespec_load_nsec(&st.st_mtim) == c->extra_fields_mtime)
+                if (timespec_load_nsec(&st.st_mtim) == u->extra_fields_mtime)
                         return 0;
         }
 
@@ -459,51 +624,211 @@ static int client_context_read_extra_fields(
                 left -= n, q += n;
         }
 
-        free(c->extra_fields_iovec);
-        free(c->extra_fields_data);
+        free(u->extra_fields_iovec);
+        free(u->extra_fields_data);
 
-        c->extra_fields_iovec = TAKE_PTR(iovec);
-        c->extra_fields_n_iovec = n_iovec;
-        c->extra_fields_data = TAKE_PTR(data);
-        c->extra_fields_mtime = timespec_load_nsec(&st.st_mtim);
+        u->extra_fields_iovec = TAKE_PTR(iovec);
+        u->extra_fields_n_iovec = n_iovec;
+        u->extra_fields_data = TAKE_PTR(data);
+        u->extra_fields_size = size;
+        u->extra_fields_mtime = timespec_load_nsec(&st.st_mtim);
 
         return 0;
 }
 
-static int client_context_read_log_ratelimit_interval(ClientContext *c) {
+static int client_unit_context_read_log_ratelimit_interval(ClientUnitContext *u) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
-        assert(c);
+        assert(u);
 
-        if (!c->unit)
+        if (!u->unit)
                 return 0;
 
-        p = strjoina("/run/systemd/units/log-rate-limit-interval:", c->unit);
+        p = strjoina("/run/systemd/units/log-rate-limit-interval:", u->unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, &c->log_ratelimit_interval);
+        return safe_atou64(value, &u->log_ratelimit_interval);
 }
 
-static int client_context_read_log_ratelimit_burst(ClientContext *c) {
+static int client_unit_context_read_log_ratelimit_burst(ClientUnitContext *u) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
-        assert(c);
+        assert(u);
 
-        if (!c->unit)
+        if (!u->unit)
                 return 0;
 
-        p = strjoina("/run/systemd/units/log-rate-limit-burst:", c->unit);
+        p = strjoina("/run/systemd/units/log-rate-limit-burst:", u->unit);
         r = readlink_malloc(p, &value);
         if (r < 0)
                 return r;
 
-        return safe_atou(value, &c->log_ratelimit_burst);
+        return safe_atou(value, &u->log_ratelimit_burst);
+}
+
+static int client_unit_context_get(Server *s, const char *key, usec_t timestamp, ClientUnitContext **ret) {
+        ClientUnitContext *u;
+        int r;
+
+        assert(s);
+        assert(key);
+        assert(ret);
+
+        u = hashmap_get(s->client_unit_contexts, key);
+        if (u && client_unit_context_is_current(u, timestamp)) {
+                s->client_context_stats.unit_hit++;
+                *ret = u;
+                return 0;
+        }
+
+        s->client_context_stats.unit_miss++;
+
+        if (!u) {
+                client_unit_context_try_shrink_to(s, cache_max() - 1, 0);
+
+                r = client_unit_context_new(s, key, &u);
+                if (r < 0)
+                        return r;
+        }
+
+        /* As for the per-process data, keep whatever we can't reread */
+        (void) client_unit_context_read_invocation_id(u);
+        (void) client_unit_context_read_log_level_max(u);
+        (void) client_unit_context_read_extra_fields(u);
+        (void) client_unit_context_read_log_ratelimit_interval(u);
+        (void) client_unit_context_read_log_ratelimit_burst(u);
+
+        u->timestamp = timestamp;
+        u->generation = ++s->client_unit_contexts_generation;
+
+        if (u->lru_index == PRIOQ_IDX_NULL) {
+                r = prioq_put(s->client_unit_contexts_lru, u, &u->lru_index);
+                if (r < 0) {
+                        client_unit_context_free(s, u);
+                        return r;
+                }
+        } else
+                assert_se(prioq_reshuffle(s->client_unit_contexts_lru, u, &u->lru_index) >= 0);
+
+        *ret = u;
+        return 0;
+}
+
+static int client_context_copy_extra_fields(ClientContext *c, const ClientUnitContext *u) {
+        _cleanup_free_ struct iovec *iovec = NULL;
+        _cleanup_free_ void *data = NULL;
+
+        assert(c);
+        assert(u);
+
+        if (c->extra_fields_mtime == u->extra_fields_mtime)
+                return 0;
+
+        if (u->extra_fields_n_iovec > 0) {
+                data = memdup(u->extra_fields_data, u->extra_fields_size);
+                if (!data)
+                        return -ENOMEM;
+
+                iovec = new(struct iovec, u->extra_fields_n_iovec);
+                if (!iovec)
+                        return -ENOMEM;
+
+                /* The fields point into the data blob, so rebase them onto our copy */
+                for (size_t i = 0; i < u->extra_fields_n_iovec; i++)
+                        iovec[i] = IOVEC_MAKE((uint8_t*) data + ((uint8_t*) u->extra_fields_iovec[i].iov_base - (uint8_t*) u->extra_fields_data),
+                                              u->extra_fields_iovec[i].iov_len);
+        }
+
+        free_and_replace(c->extra_fields_iovec, iovec);
+        free_and_replace(c->extra_fields_data, data);
+        c->extra_fields_n_iovec = u->extra_fields_n_iovec;
+        c->extra_fields_mtime = u->extra_fields_mtime;
+
+        return 0;
+}
+
+static int client_context_apply_unit(ClientContext *c, const ClientUnitContext *u) {
+        int r;
+
+        assert(c);
+        assert(u);
+
+        if (c->unit_generation == u->generation)
+                return 0;
+
+        /* Only entries for a cgroup know anything about the cgroup, don't override what we have otherwise */
+        if (u->key[0] == '/') {
+                if (free_and_strdup(&c->session, u->session) < 0 ||
+                    free_and_strdup(&c->unit, u->unit) < 0 ||
+                    free_and_strdup(&c->user_unit, u->user_unit) < 0 ||
+                    free_and_strdup(&c->slice, u->slice) < 0 ||
+                    free_and_strdup(&c->user_slice, u->user_slice) < 0)
+                        return -ENOMEM;
+
+                c->owner_uid = u->owner_uid;
+        }
+
+        if (!sd_id128_is_null(u->invocation_id))
+                c->invocation_id = u->invocation_id;
+
+        if (u->log_level_max >= 0)
+                c->log_level_max = u->log_level_max;
+
+        r = client_context_copy_extra_fields(c, u);
+        if (r < 0)
+                return r;
+
+        c->log_ratelimit_interval = u->log_ratelimit_interval;
+        c->log_ratelimit_burst = u->log_ratelimit_burst;
+
+        c->unit_generation = u->generation;
+        return 0;
+}
+
+static int client_context_read_cgroup(Server *s, ClientContext *c, const char *unit_id, usec_t timestamp) {
+        _cleanup_free_ char *t = NULL;
+        ClientUnitContext *u;
+        const char *key;
+        int r;
+
+        assert(c);
+
+        /* Try to acquire the current cgroup path */
+        r = cg_pid_get_path_shifted(c->pid, s->cgroup_root, &t);
+        if (r < 0 || empty_or_root(t)) {
+                /* We use the unit ID passed in as fallback if we have nothing cached yet and cg_pid_get_path_shifted()
+                 * failed or process is running in a root cgroup. Zombie processes are automatically migrated to root cgroup
+                 * on cgroup v1 and we want to be able to map log messages from them too. */
+                if (unit_id && !c->unit) {
+                        c->unit = strdup(unit_id);
+                        if (!c->unit)
+                                return -ENOMEM;
+
+                        key = c->unit;
+                } else if (c->cgroup)
+                        key = c->cgroup;
+                else if (c->unit)
+                        key = c->unit;
+                else
+                        return r;
+        } else {
+                if (!streq_ptr(c->cgroup, t))
+                        free_and_replace(c->cgroup, t);
+
+                key = c->cgroup;
+        }
+
+        r = client_unit_context_get(s, key, timestamp, &u);
+        if (r < 0)
+                return r;
+
+        return client_context_apply_unit(c, u);
 }
 
 static void client_context_really_refresh(
@@ -528,12 +853,7 @@ static void client_context_really_refresh(
         (void) audit_session_from_pid(c->pid, &c->auditid);
         (void) audit_loginuid_from_pid(c->pid, &c->loginuid);
 
-        (void) client_context_read_cgroup(s, c, unit_id);
-        (void) client_context_read_invocation_id(s, c);
-        (void) client_context_read_log_level_max(s, c);
-        (void) client_context_read_extra_fields(s, c);
-        (void) client_context_read_log_ratelimit_interval(c);
-        (void) client_context_read_log_ratelimit_burst(c);
+        (void) client_context_read_cgroup(s, c, unit_id, timestamp);
 
         c->timestamp = timestamp;
 
@@ -562,9 +882,14 @@ void client_context_maybe_refresh(
                 goto refresh;
 
         /* If the data isn't pinned and if the cashed data is older than the upper limit, we flush it out
-         * entirely. This follows the logic that as long as an entry is pinned the PID reuse is unlikely. */
-        if (c->n_ref == 0 && c->timestamp + MAX_USEC < timestamp) {
+         * entirely. This follows the logic that as long as an entry is pinned the PID reuse is unlikely. If
+         * our pidfd tells us the process is still around the PID wasn't reused either, and we just refresh. */
+        if (c->n_ref == 0 && c->timestamp + MAX_USEC < timestamp && client_context_pid_alive(c) <= 0) {
                 client_context_reset(s, c);
+
+                /* The PID might belong to a different process by now, pin that one instead */
+                c->pidfd = safe_close(c->pidfd);
+                client_context_open_pidfd(c);
                 goto refresh;
         }
 
@@ -582,15 +907,18 @@ void client_context_maybe_refresh(
         if (label_size > 0 && (label_size != c->label_size || memcmp(label, c->label, label_size) != 0))
                 goto refresh;
 
+        s->client_context_stats.hit++;
         return;
 
 refresh:
+        s->client_context_stats.refresh++;
         client_context_really_refresh(s, c, ucred, label, label_size, unit_id, timestamp);
 }
 
 static void client_context_try_shrink_to(Server *s, size_t limit) {
         ClientContext *c;
         usec_t t;
+        int r;
 
         assert(s);
 
@@ -608,12 +936,19 @@ static void client_context_try_shrink_to(Server *s, size_t limit) {
 
                         assert(c->n_ref == 0);
 
-                        if (!pid_is_unwaited(c->pid))
+                        r = client_context_pid_alive(c);
+                        if (r < 0)
+                                r = pid_is_unwaited(c->pid);
+                        if (r == 0) {
                                 client_context_free(s, c);
-                        else
+                                s->client_context_stats.evict++;
+                        } else
                                 idx ++;
                 }
 
+                /* Per-unit data nobody asked for in a while is likely not going to be needed anymore */
+                client_unit_context_try_shrink_to(s, SIZE_MAX, usec_sub_unsigned(t, MAX_USEC));
+
                 s->last_cache_pid_flush = t;
         }
 
@@ -632,9 +967,20 @@ static void client_context_try_shrink_to(Server *s, size_t limit) {
                 c->in_lru = false;
 
                 client_context_free(s, c);
+                s->client_context_stats.evict++;
         }
 }
 
+void client_context_trim(Server *s) {
+        assert(s);
+
+        /* Drop all cache entries that aren't pinned, for example because we are under memory pressure. They
+         * are recreated on demand. */
+
+        client_context_try_shrink_to(s, 0);
+        client_unit_context_try_shrink_to(s, 0, USEC_INFINITY);
+}
+
 void client_context_flush_all(Server *s) {
         assert(s);
 
@@ -643,13 +989,33 @@ void client_context_flush_all(Server *s) {
         s->my_context = client_context_release(s, s->my_context);
         s->pid1_context = client_context_release(s, s->pid1_context);
 
+        client_context_log_stats(s);
+
         client_context_try_shrink_to(s, 0);
+        client_unit_context_try_shrink_to(s, 0, USEC_INFINITY);
 
         assert(prioq_size(s->client_contexts_lru) == 0);
         assert(hashmap_size(s->client_contexts) == 0);
+        assert(hashmap_size(s->client_unit_contexts) == 0);
 
         s->client_contexts_lru = prioq_free(s->client_contexts_lru);
         s->client_contexts = hashmap_free(s->client_contexts);
+        s->client_unit_contexts_lru = prioq_free(s->client_unit_contexts_lru);
+        s->client_unit_contexts = hashmap_free(s->client_unit_contexts);
+}
+
+void client_context_log_stats(Server *s) {
+        const ClientContextStats *st;
+
+        assert(s);
+
+        st = &s->client_context_stats;
+
+        log_debug("Client context cache statistics: %" PRIu64 " hit, %" PRIu64 " refresh, %" PRIu64 " miss, %" PRIu64 " evicted, "
+                  "%" PRIu64 " unit hit, %" PRIu64 " unit miss, %u entries, %u unit entries",
+                  st->hit, st->refresh, st->miss, st->evict,
+                  st->unit_hit, st->unit_miss,
+                  hashmap_size(s->client_contexts), hashmap_size(s->client_unit_contexts));
 }
 
 static int client_context_get_internal(
@@ -692,6 +1058,8 @@ static int client_context_get_internal(
 
         client_context_try_shrink_to(s, cache_max()-1);
 
+        s->client_context_stats.miss++;
+
         r = client_context_new(s, pid, &c);
         if (r < 0)
                 return r;
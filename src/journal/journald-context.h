@@ -11,6 +11,15 @@
 
 typedef struct ClientContext ClientContext;
 
+typedef struct ClientContextStats {
+        uint64_t hit;        /* cached entry used as is */
+        uint64_t refresh;    /* cached entry found, but reread */
+        uint64_t miss;       /* no cached entry, new one created */
+        uint64_t evict;      /* unpinned entry removed, because of cache pressure or because the process is gone */
+        uint64_t unit_hit;   /* per-unit metadata taken from the cache shared between a unit's processes */
+        uint64_t unit_miss;  /* per-unit metadata reread */
+} ClientContextStats;
+
 #include "journald-server.h"
 
 struct ClientContext {
@@ -20,6 +29,7 @@ struct ClientContext {
         bool in_lru;
 
         pid_t pid;
+        int pidfd;
         uid_t uid;
         gid_t gid;
 
@@ -55,6 +65,9 @@ struct ClientContext {
 
         usec_t log_ratelimit_interval;
         unsigned log_ratelimit_burst;
+
+        /* The generation of the per-unit cache entry the fields above were last copied from */
+        uint64_t unit_generation;
 };
 
 int client_context_get(
@@ -84,7 +97,9 @@ void client_context_maybe_refresh(
                 usec_t tstamp);
 
 void client_context_acquire_default(Server *s);
+void client_context_trim(Server *s);
 void client_context_flush_all(Server *s);
+void client_context_log_stats(Server *s);
 
 static inline size_t client_context_extra_fields_n_iovec(const ClientContext *c) {
         return c ? c->extra_fields_n_iovec : 0;
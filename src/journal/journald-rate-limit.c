@@ -6,13 +6,11 @@
 #include "hashmap.h"
 #include "journald-rate-limit.h"
 #include "list.h"
-#include "random-util.h"
 #include "string-util.h"
 #include "time-util.h"
 
 #define POOLS_MAX 5
-#define BUCKETS_MAX 127
-#define GROUPS_MAX 2047
+#define GROUPS_MAX 65535
 
 static const int priority_map[] = {
         [LOG_EMERG]   = 0,
@@ -43,47 +41,31 @@ struct JournalRateLimitGroup {
         usec_t interval;
 
         JournalRateLimitPool pools[POOLS_MAX];
-        uint64_t hash;
 
-        LIST_FIELDS(JournalRateLimitGroup, bucket);
         LIST_FIELDS(JournalRateLimitGroup, lru);
 };
 
 struct JournalRateLimit {
+        /* id → JournalRateLimitGroup */
+        Hashmap *groups;
 
-        JournalRateLimitGroup* buckets[BUCKETS_MAX];
+        /* Most recently used groups first */
         JournalRateLimitGroup *lru, *lru_tail;
-
-        unsigned n_groups;
-
-        uint8_t hash_key[16];
 };
 
 JournalRateLimit *journal_ratelimit_new(void) {
-        JournalRateLimit *r;
-
-        r = new0(JournalRateLimit, 1);
-        if (!r)
-                return NULL;
-
-        random_bytes(r->hash_key, sizeof(r->hash_key));
-
-        return r;
+        return new0(JournalRateLimit, 1);
 }
 
 static void journal_ratelimit_group_free(JournalRateLimitGroup *g) {
         assert(g);
 
         if (g->parent) {
-                assert(g->parent->n_groups > 0);
-
                 if (g->parent->lru_tail == g)
                         g->parent->lru_tail = g->lru_prev;
 
                 LIST_REMOVE(lru, g->parent->lru, g);
-                LIST_REMOVE(bucket, g->parent->buckets[g->hash % BUCKETS_MAX], g);
-
-                g->parent->n_groups--;
+                hashmap_remove_value(g->parent->groups, g->id, g);
         }
 
         free(g->id);
@@ -96,6 +78,7 @@ void journal_ratelimit_free(JournalRateLimit *r) {
         while (r->lru)
                 journal_ratelimit_group_free(r->lru);
 
+        hashmap_free(r->groups);
         free(r);
 }
 
@@ -117,7 +100,7 @@ static void journal_ratelimit_vacuum(JournalRateLimit *r, usec_t ts) {
         /* Makes room for at least one new item, but drop all
          * expored items too. */
 
-        while (r->n_groups >= GROUPS_MAX ||
+        while (hashmap_size(r->groups) >= GROUPS_MAX ||
                (r->lru_tail && journal_ratelimit_group_expired(r->lru_tail, ts)))
                 journal_ratelimit_group_free(r->lru_tail);
 }
@@ -136,17 +119,19 @@ static JournalRateLimitGroup* journal_ratelimit_group_new(JournalRateLimit *r, c
         if (!g->id)
                 goto fail;
 
-        g->hash = siphash24_string(g->id, r->hash_key);
-
         g->interval = interval;
 
         journal_ratelimit_vacuum(r, ts);
 
-        LIST_PREPEND(bucket, r->buckets[g->hash % BUCKETS_MAX], g);
+        if (hashmap_ensure_allocated(&r->groups, &string_hash_ops) < 0)
+                goto fail;
+
+        if (hashmap_put(r->groups, g->id, g) < 0)
+                goto fail;
+
         LIST_PREPEND(lru, r->lru, g);
         if (!g->lru_next)
                 r->lru_tail = g;
-        r->n_groups++;
 
         g->parent = r;
         return g;
@@ -184,8 +169,27 @@ static unsigned burst_modulate(unsigned burst, uint64_t available) {
         return burst;
 }
 
+static void journal_ratelimit_group_touch(JournalRateLimitGroup *g) {
+        JournalRateLimit *r;
+
+        assert(g);
+        assert(g->parent);
+
+        /* Moves the group to the front of the LRU list, so that groups that are still in use are evicted
+         * last when we run out of space */
+
+        r = g->parent;
+        if (r->lru == g)
+                return;
+
+        if (r->lru_tail == g)
+                r->lru_tail = g->lru_prev;
+
+        LIST_REMOVE(lru, r->lru, g);
+        LIST_PREPEND(lru, r->lru, g);
+}
+
 int journal_ratelimit_test(JournalRateLimit *r, const char *id, usec_t rl_interval, unsigned rl_burst, int priority, uint64_t available) {
-        uint64_t h;
         JournalRateLimitGroup *g;
         JournalRateLimitPool *p;
         unsigned burst;
@@ -205,19 +209,15 @@ int journal_ratelimit_test(JournalRateLimit *r, const char *id, usec_t rl_interv
 
         ts = now(CLOCK_MONOTONIC);
 
-        h = siphash24_string(id, r->hash_key);
-        g = r->buckets[h % BUCKETS_MAX];
-
-        LIST_FOREACH(bucket, g, g)
-                if (streq(g->id, id))
-                        break;
-
+        g = hashmap_get(r->groups, id);
         if (!g) {
                 g = journal_ratelimit_group_new(r, id, rl_interval, ts);
                 if (!g)
                         return -ENOMEM;
-        } else
+        } else {
                 g->interval = rl_interval;
+                journal_ratelimit_group_touch(g);
+        }
 
         if (rl_interval == 0 || rl_burst == 0)
                 return 1;
@@ -30,9 +30,11 @@
 #include "io-util.h"
 #include "journal-authenticate.h"
 #include "journal-file.h"
+#include "journal-importer.h"
 #include "journal-internal.h"
 #include "journal-vacuum.h"
 #include "journald-audit.h"
+#include "journald-compress.h"
 #include "journald-context.h"
 #include "journald-kmsg.h"
 #include "journald-native.h"
@@ -68,6 +70,16 @@
 
 #define NOTIFY_SNDBUF_SIZE (8*1024*1024)
 
+/* Read up to this many datagrams with a single recvmmsg() call. Each of them gets a slot of
+ * DATAGRAM_SLOT_SIZE bytes of address space, of which we keep at most DATAGRAM_SLOT_KEEP bytes populated
+ * between calls. Only the size of the first datagram is known before reading, and any later one that
+ * doesn't fit its slot is truncated and lost. Hence slots are larger than the largest entry the native
+ * protocol accepts, so that only datagrams that would be refused anyway can be lost that way. Slots are
+ * kept a multiple of the page size, as we release their pages individually. */
+#define DATAGRAM_BATCH_MAX 16U
+#define DATAGRAM_SLOT_SIZE ((size_t) ENTRY_SIZE_MAX + 1024U*1024U)
+#define DATAGRAM_SLOT_KEEP (64U*1024U)
+
 /* The period to insert between posting changes for coalescing */
 #define POST_CHANGE_TIMER_INTERVAL_USEC (250*USEC_PER_MSEC)
 
@@ -86,7 +98,6 @@ static int determine_path_usage(
                 uint64_t *ret_free) {
 
         _cleanup_closedir_ DIR *d = NULL;
-        struct dirent *de;
         struct statvfs ss;
 
         assert(s);
@@ -103,26 +114,8 @@ static int determine_path_usage(
                 return log_error_errno(errno, "Failed to fstatvfs(%s): %m", path);
 
         *ret_free = ss.f_bsize * ss.f_bavail;
-        *ret_used = 0;
-        FOREACH_DIRENT_ALL(de, d, break) {
-                struct stat st;
-
-                if (!endswith(de->d_name, ".journal") &&
-                    !endswith(de->d_name, ".journal~"))
-                        continue;
-
-                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
-                        log_debug_errno(errno, "Failed to stat %s/%s, ignoring: %m", path, de->d_name);
-                        continue;
-                }
-
-                if (!S_ISREG(st.st_mode))
-                        continue;
-
-                *ret_used += (uint64_t) st.st_blocks * 512UL;
-        }
 
-        return 0;
+        return journal_directory_usage(d, path, ret_used);
 }
 
 static void cache_space_invalidate(JournalStorageSpace *space) {
@@ -792,23 +785,71 @@ static bool shall_try_append_again(JournalFile *f, int r) {
         }
 }
 
-static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n, int priority) {
+static void server_open_tail_cache(Server *s) {
+        const char *fn;
+        int r;
+
+        assert(s);
+
+        if (s->tail_cache_size == 0 || s->storage == STORAGE_NONE)
+                return;
+
+        /* The cache lives next to the runtime journal, so that it is readable by the same users */
+        (void) mkdir_parents(s->runtime_storage.path, 0755);
+        (void) mkdir(s->runtime_storage.path, 0750);
+
+        fn = strjoina(s->runtime_storage.path, "/" JOURNAL_TAIL_FILE);
+        r = journal_tail_create(fn, s->tail_cache_size, &s->tail_cache);
+        if (r < 0)
+                log_warning_errno(r, "Failed to create journal tail cache %s, ignoring: %m", fn);
+}
+
+static void server_tail_cache_append(Server *s, JournalFile *f, const JournalEntryInput *entries, const uint64_t *offsets, size_t n_entries) {
+        int r;
+
+        assert(s);
+        assert(f);
+
+        if (!s->tail_cache || !offsets)
+                return;
+
+        /* Readers take entries from the cache instead of f, hence record them with exactly what ended up
+         * in f, so that cursors and locations match. */
+
+        for (size_t i = 0; i < n_entries; i++) {
+                Object *o;
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY, offsets[i], &o);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to read back entry for the tail cache, ignoring: %m");
+                        return;
+                }
+
+                (void) journal_tail_append(s->tail_cache, &(JournalTailEntry) {
+                        .seqnum_id = f->header->seqnum_id,
+                        .seqnum = le64toh(o->entry.seqnum),
+                        .realtime = le64toh(o->entry.realtime),
+                        .monotonic = le64toh(o->entry.monotonic),
+                        .boot_id = o->entry.boot_id,
+                        .xor_hash = le64toh(o->entry.xor_hash),
+                        .fields = entries[i].iovec,
+                        .n_fields = entries[i].n_iovec,
+                });
+        }
+}
+
+void server_write_entries(Server *s, uid_t uid, const JournalEntryInput *entries, size_t n_entries, int priority) {
+        _cleanup_free_ uint64_t *offsets = NULL;
         bool vacuumed = false, rotate = false;
-        struct dual_timestamp ts;
+        size_t n_done;
         JournalFile *f;
         int r;
 
         assert(s);
-        assert(iovec);
-        assert(n > 0);
-
-        /* Get the closest, linearized time we have for this log event from the event loop. (Note that we do not use
-         * the source time, and not even the time the event was originally seen, but instead simply the time we started
-         * processing it, as we want strictly linear ordering in what we write out.) */
-        assert_se(sd_event_now(s->event, CLOCK_REALTIME, &ts.realtime) >= 0);
-        assert_se(sd_event_now(s->event, CLOCK_MONOTONIC, &ts.monotonic) >= 0);
+        assert(entries);
+        assert(n_entries > 0);
 
-        if (ts.realtime < s->last_realtime_clock) {
+        if (entries[0].ts.realtime < s->last_realtime_clock) {
                 /* When the time jumps backwards, let's immediately rotate. Of course, this should not happen during
                  * regular operation. However, when it does happen, then we should make sure that we start fresh files
                  * to ensure that the entries in the journal files are strictly ordered by time, in order to ensure
@@ -838,19 +879,37 @@ static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n
                         return;
         }
 
-        s->last_realtime_clock = ts.realtime;
+        s->last_realtime_clock = entries[n_entries - 1].ts.realtime;
 
-        r = journal_file_append_entry(f, &ts, NULL, iovec, n, &s->seqnum, NULL, NULL);
+        if (s->tail_cache)
+                offsets = new(uint64_t, n_entries);
+
+        r = journal_file_append_entries(f, entries, n_entries, NULL, &s->seqnum, offsets, &n_done);
+        server_tail_cache_append(s, f, entries, offsets, n_done);
         if (r >= 0) {
                 server_schedule_sync(s, priority);
                 return;
         }
 
+        assert(n_done < n_entries);
+
+        if (n_done > 0)
+                server_schedule_sync(s, priority);
+
         if (vacuumed || !shall_try_append_again(f, r)) {
-                log_error_errno(r, "Failed to write entry (%zu items, %zu bytes), ignoring: %m", n, IOVEC_TOTAL_SIZE(iovec, n));
+                log_error_errno(r, "Failed to write entry (%u items, %zu bytes), ignoring: %m",
+                                entries[n_done].n_iovec, IOVEC_TOTAL_SIZE(entries[n_done].iovec, entries[n_done].n_iovec));
+                n_done++;
+
+                /* Don't drop the rest of the batch along with the entry that failed */
+                if (n_done < n_entries)
+                        server_write_entries(s, uid, entries + n_done, n_entries - n_done, priority);
                 return;
         }
 
+        entries += n_done;
+        n_entries -= n_done;
+
         server_rotate(s);
         server_vacuum(s, false);
 
@@ -859,13 +918,156 @@ static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n
                 return;
 
         log_debug("Retrying write.");
-        r = journal_file_append_entry(f, &ts, NULL, iovec, n, &s->seqnum, NULL, NULL);
+        r = journal_file_append_entries(f, entries, n_entries, NULL, &s->seqnum, offsets, &n_done);
+        server_tail_cache_append(s, f, entries, offsets, n_done);
         if (r < 0)
-                log_error_errno(r, "Failed to write entry (%zu items, %zu bytes) despite vacuuming, ignoring: %m", n, IOVEC_TOTAL_SIZE(iovec, n));
-        else
+                log_error_errno(r, "Failed to write entry (%u items, %zu bytes) despite vacuuming, ignoring %zu entries: %m",
+                                entries[n_done].n_iovec, IOVEC_TOTAL_SIZE(entries[n_done].iovec, entries[n_done].n_iovec),
+                                n_entries - n_done);
+        if (n_done > 0)
                 server_schedule_sync(s, priority);
 }
 
+static void server_batch_free_entries(JournalEntryInput *entries, size_t n_entries) {
+        for (size_t i = 0; i < n_entries; i++)
+                free((struct iovec*) entries[i].iovec);
+
+        free(entries);
+}
+
+static void server_flush_batch(Server *s) {
+        JournalEntryInput *entries;
+        size_t n_entries;
+
+        assert(s);
+
+        if (s->n_batch_entries == 0)
+                return;
+
+        /* Take ownership of the queued entries first: writing them might rotate and vacuum, which in turn
+         * might log a message of its own. */
+        entries = TAKE_PTR(s->batch_entries);
+        n_entries = s->n_batch_entries;
+        s->n_batch_entries = s->n_batch_entries_allocated = 0;
+
+        server_write_entries(s, s->batch_uid, entries, n_entries, s->batch_priority);
+
+        server_batch_free_entries(entries, n_entries);
+}
+
+static int server_queue_entry(Server *s, uid_t uid, const dual_timestamp *ts, const struct iovec *iovec, size_t n, int priority) {
+        struct iovec *copy;
+        size_t i, sz;
+        uint8_t *p;
+
+        assert(s);
+        assert(ts);
+        assert(iovec);
+        assert(n > 0);
+
+        if (s->n_batch_entries > 0 && (s->batch_uid != uid || s->n_batch_entries >= BATCH_ENTRIES_MAX))
+                server_flush_batch(s);
+
+        /* The fields passed in live on the stack of our caller, hence copy them, the iovec array and the
+         * data in one allocation. */
+        sz = n * sizeof(struct iovec);
+        for (i = 0; i < n; i++)
+                sz += iovec[i].iov_len;
+
+        copy = malloc(sz);
+        if (!copy)
+                return -ENOMEM;
+
+        p = (uint8_t*) (copy + n);
+        for (i = 0; i < n; i++) {
+                copy[i] = IOVEC_MAKE(p, iovec[i].iov_len);
+                p = mempcpy(p, iovec[i].iov_base, iovec[i].iov_len);
+        }
+
+        if (!GREEDY_REALLOC(s->batch_entries, s->n_batch_entries_allocated, s->n_batch_entries + 1)) {
+                free(copy);
+                return -ENOMEM;
+        }
+
+        if (s->n_batch_entries == 0) {
+                s->batch_uid = uid;
+                s->batch_priority = priority;
+        } else
+                s->batch_priority = MIN(s->batch_priority, priority);
+
+        s->batch_entries[s->n_batch_entries++] = (JournalEntryInput) {
+                .ts = *ts,
+                .iovec = copy,
+                .n_iovec = n,
+        };
+
+        return 0;
+}
+
+void server_begin_batch(Server *s) {
+        assert(s);
+
+        /* Between server_begin_batch() and server_end_batch() entries are not written right away, but
+         * queued up and then written in one go with journal_file_append_entries(). Use this around code
+         * that is likely to generate a burst of messages for the same client, like a stdout stream that
+         * has many lines buffered. */
+        s->batch_depth++;
+}
+
+void server_end_batch(Server *s) {
+        assert(s);
+        assert(s->batch_depth > 0);
+
+        if (--s->batch_depth > 0)
+                return;
+
+        server_flush_batch(s);
+}
+
+static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n, int priority) {
+        struct dual_timestamp ts;
+        int r;
+
+        assert(s);
+        assert(iovec);
+        assert(n > 0);
+
+        /* Get the closest, linearized time we have for this log event from the event loop. (Note that we do not use
+         * the source time, and not even the time the event was originally seen, but instead simply the time we started
+         * processing it, as we want strictly linear ordering in what we write out.) */
+        assert_se(sd_event_now(s->event, CLOCK_REALTIME, &ts.realtime) >= 0);
+        assert_se(sd_event_now(s->event, CLOCK_MONOTONIC, &ts.monotonic) >= 0);
+
+        if (server_compress_wants_entry(s, iovec, n)) {
+                /* Keep the order with anything we batched up so far */
+                server_flush_batch(s);
+
+                r = server_compress_queue_entry(s, uid, &ts, iovec, n, priority);
+                if (r >= 0)
+                        return;
+
+                /* Write out everything queued before, so that ordering is kept */
+                log_debug_errno(r, "Failed to queue entry for compression, writing it directly: %m");
+                server_compress_flush(s);
+
+        } else if (s->batch_depth > 0) {
+                r = server_queue_entry(s, uid, &ts, iovec, n, priority);
+                if (r >= 0)
+                        return;
+
+                /* If we can't queue the entry, write everything out right away, so that ordering is kept */
+                log_debug_errno(r, "Failed to queue entry, writing it directly: %m");
+                server_flush_batch(s);
+        }
+
+        server_write_entries(s, uid,
+                             &(JournalEntryInput) {
+                                     .ts = ts,
+                                     .iovec = iovec,
+                                     .n_iovec = n,
+                             }, 1, priority);
+}
+
 #define IOVEC_ADD_NUMERIC_FIELD(iovec, n, value, type, isset, format, field)  \
         if (isset(value)) {                                             \
                 char *k;                                                \
@@ -1251,76 +1453,36 @@ static int server_relinquish_var(Server *s) {
         return 0;
 }
 
-int server_process_datagram(
-                sd_event_source *es,
-                int fd,
-                uint32_t revents,
-                void *userdata) {
+/* We use NAME_MAX space for the SELinux label here. The kernel currently enforces no limit, but according to
+ * suggestions from the SELinux people this will change and it will probably be identical to NAME_MAX. For now
+ * we use that, but this should be updated one day when the final limit is known. */
+typedef CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
+                         CMSG_SPACE(sizeof(struct timeval)) +
+                         CMSG_SPACE(sizeof(int)) + /* fd */
+                         CMSG_SPACE(NAME_MAX) /* selinux label */) DatagramControl;
+
+struct DatagramBatch {
+        uint8_t *buffers; /* DATAGRAM_BATCH_MAX slots of DATAGRAM_SLOT_SIZE bytes each */
+        struct mmsghdr msgs[DATAGRAM_BATCH_MAX];
+        struct iovec iovecs[DATAGRAM_BATCH_MAX];
+        union sockaddr_union addrs[DATAGRAM_BATCH_MAX];
+        DatagramControl controls[DATAGRAM_BATCH_MAX];
+};
 
-        Server *s = userdata;
+static void server_dispatch_datagram(Server *s, int fd, char *buffer, size_t n, struct msghdr *msghdr) {
         struct ucred *ucred = NULL;
         struct timeval *tv = NULL;
         struct cmsghdr *cmsg;
         char *label = NULL;
-        size_t label_len = 0, m;
-        struct iovec iovec;
-        ssize_t n;
-        int *fds = NULL, v = 0;
+        size_t label_len = 0;
+        int *fds = NULL;
         size_t n_fds = 0;
 
-        /* We use NAME_MAX space for the SELinux label here. The kernel currently enforces no limit, but
-         * according to suggestions from the SELinux people this will change and it will probably be
-         * identical to NAME_MAX. For now we use that, but this should be updated one day when the final
-         * limit is known. */
-        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
-                         CMSG_SPACE(sizeof(struct timeval)) +
-                         CMSG_SPACE(sizeof(int)) + /* fd */
-                         CMSG_SPACE(NAME_MAX) /* selinux label */) control;
-
-        union sockaddr_union sa = {};
-
-        struct msghdr msghdr = {
-                .msg_iov = &iovec,
-                .msg_iovlen = 1,
-                .msg_control = &control,
-                .msg_controllen = sizeof(control),
-                .msg_name = &sa,
-                .msg_namelen = sizeof(sa),
-        };
-
         assert(s);
-        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
+        assert(buffer);
+        assert(msghdr);
 
-        if (revents != EPOLLIN)
-                return log_error_errno(SYNTHETIC_ERRNO(EIO),
-                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
-                                       revents);
-
-        /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
-         * it.) */
-        (void) ioctl(fd, SIOCINQ, &v);
-
-        /* Fix it up, if it is too small. We use the same fixed value as auditd here. Awful! */
-        m = PAGE_ALIGN(MAX3((size_t) v + 1,
-                            (size_t) LINE_MAX,
-                            ALIGN(sizeof(struct nlmsghdr)) + ALIGN((size_t) MAX_AUDIT_MESSAGE_LENGTH)) + 1);
-
-        if (!GREEDY_REALLOC(s->buffer, s->buffer_size, m))
-                return log_oom();
-
-        iovec = IOVEC_MAKE(s->buffer, s->buffer_size - 1); /* Leave room for trailing NUL we add later */
-
-        n = recvmsg_safe(fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
-        if (IN_SET(n, -EINTR, -EAGAIN))
-                return 0;
-        if (n == -EXFULL) {
-                log_warning("Got message with truncated control data (too many fds sent?), ignoring.");
-                return 0;
-        }
-        if (n < 0)
-                return log_error_errno(n, "recvmsg() failed: %m");
-
-        CMSG_FOREACH(cmsg, &msghdr)
+        CMSG_FOREACH(cmsg, msghdr)
                 if (cmsg->cmsg_level == SOL_SOCKET &&
                     cmsg->cmsg_type == SCM_CREDENTIALS &&
                     cmsg->cmsg_len == CMSG_LEN(sizeof(struct ucred))) {
@@ -1344,17 +1506,17 @@ int server_process_datagram(
                 }
 
         /* And a trailing NUL, just in case */
-        s->buffer[n] = 0;
+        buffer[n] = 0;
 
         if (fd == s->syslog_fd) {
                 if (n > 0 && n_fds == 0)
-                        server_process_syslog_message(s, s->buffer, n, ucred, tv, label, label_len);
+                        server_process_syslog_message(s, buffer, n, ucred, tv, label, label_len);
                 else if (n_fds > 0)
                         log_warning("Got file descriptors via syslog socket. Ignoring.");
 
         } else if (fd == s->native_fd) {
                 if (n > 0 && n_fds == 0)
-                        server_process_native_message(s, s->buffer, n, ucred, tv, label, label_len);
+                        server_process_native_message(s, buffer, n, ucred, tv, label, label_len);
                 else if (n == 0 && n_fds == 1)
                         server_process_native_file(s, fds[0], ucred, tv, label, label_len);
                 else if (n_fds > 0)
@@ -1364,12 +1526,186 @@ int server_process_datagram(
                 assert(fd == s->audit_fd);
 
                 if (n > 0 && n_fds == 0)
-                        server_process_audit_message(s, s->buffer, n, ucred, &sa, msghdr.msg_namelen);
+                        server_process_audit_message(s, buffer, n, ucred, msghdr->msg_name, msghdr->msg_namelen);
                 else if (n_fds > 0)
                         log_warning("Got file descriptors via audit socket. Ignoring.");
         }
 
         close_many(fds, n_fds);
+}
+
+static DatagramBatch* datagram_batch_free(DatagramBatch *b) {
+        if (!b)
+                return NULL;
+
+        if (b->buffers)
+                (void) munmap(b->buffers, DATAGRAM_BATCH_MAX * DATAGRAM_SLOT_SIZE);
+
+        return mfree(b);
+}
+
+static DatagramBatch* server_get_datagram_batch(Server *s) {
+        DatagramBatch *b;
+        void *p;
+
+        assert(s);
+
+        if (s->datagram_batch || s->datagram_batch_broken)
+                return s->datagram_batch;
+
+        /* Reserve address space for the largest datagrams we expect in every slot. Pages are only populated
+         * once a datagram is written to them, and we release them again right after large datagrams. */
+        p = mmap(NULL, DATAGRAM_BATCH_MAX * DATAGRAM_SLOT_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+                log_debug_errno(errno, "Failed to allocate datagram batch buffers, reading datagrams one by one: %m");
+                s->datagram_batch_broken = true;
+                return NULL;
+        }
+
+        b = new0(DatagramBatch, 1);
+        if (!b) {
+                (void) munmap(p, DATAGRAM_BATCH_MAX * DATAGRAM_SLOT_SIZE);
+                return NULL;
+        }
+
+        b->buffers = p;
+        return s->datagram_batch = b;
+}
+
+static int server_process_datagram_one(Server *s, int fd, int v) {
+        DatagramControl control;
+        union sockaddr_union sa = {};
+        struct iovec iovec;
+        ssize_t n;
+        size_t m;
+
+        struct msghdr msghdr = {
+                .msg_iov = &iovec,
+                .msg_iovlen = 1,
+                .msg_control = &control,
+                .msg_controllen = sizeof(control),
+                .msg_name = &sa,
+                .msg_namelen = sizeof(sa),
+        };
+
+        assert(s);
+
+        /* Fix it up, if it is too small. We use the same fixed value as auditd here. Awful! */
+        m = PAGE_ALIGN(MAX3((size_t) v + 1,
+                            (size_t) LINE_MAX,
+                            ALIGN(sizeof(struct nlmsghdr)) + ALIGN((size_t) MAX_AUDIT_MESSAGE_LENGTH)) + 1);
+
+        if (!GREEDY_REALLOC(s->buffer, s->buffer_size, m))
+                return log_oom();
+
+        iovec = IOVEC_MAKE(s->buffer, s->buffer_size - 1); /* Leave room for trailing NUL we add later */
+
+        n = recvmsg_safe(fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
+        if (IN_SET(n, -EINTR, -EAGAIN))
+                return 0;
+        if (n == -EXFULL) {
+                log_warning("Got message with truncated control data (too many fds sent?), ignoring.");
+                return 0;
+        }
+        if (n < 0)
+                return log_error_errno(n, "recvmsg() failed: %m");
+
+        server_dispatch_datagram(s, fd, s->buffer, n, &msghdr);
+        return 0;
+}
+
+static int server_process_datagram_batch(Server *s, int fd, DatagramBatch *b) {
+        int n;
+
+        assert(s);
+        assert(b);
+
+        for (unsigned i = 0; i < DATAGRAM_BATCH_MAX; i++) {
+                b->iovecs[i] = IOVEC_MAKE(b->buffers + i * DATAGRAM_SLOT_SIZE, DATAGRAM_SLOT_SIZE - 1); /* Leave room for trailing NUL */
+                b->addrs[i] = (union sockaddr_union) {};
+                b->msgs[i] = (struct mmsghdr) {
+                        .msg_hdr = {
+                                .msg_iov = b->iovecs + i,
+                                .msg_iovlen = 1,
+                                .msg_control = b->controls + i,
+                                .msg_controllen = sizeof(b->controls[i]),
+                                .msg_name = b->addrs + i,
+                                .msg_namelen = sizeof(b->addrs[i]),
+                        },
+                };
+        }
+
+        n = recvmmsg(fd, b->msgs, DATAGRAM_BATCH_MAX, MSG_DONTWAIT|MSG_CMSG_CLOEXEC, NULL);
+        if (n < 0) {
+                if (IN_SET(errno, EINTR, EAGAIN))
+                        return 0;
+
+                return log_error_errno(errno, "recvmmsg() failed: %m");
+        }
+
+        /* Queue up what we get from the same client, and write it out in one go */
+        server_begin_batch(s);
+
+        for (int i = 0; i < n; i++) {
+                struct msghdr *msghdr = &b->msgs[i].msg_hdr;
+                size_t len = b->msgs[i].msg_len;
+                char *buffer = (char*) b->buffers + i * DATAGRAM_SLOT_SIZE;
+
+                if (msghdr->msg_flags & MSG_CTRUNC) {
+                        cmsg_close_all(msghdr);
+                        log_warning("Got message with truncated control data (too many fds sent?), ignoring.");
+                        continue;
+                }
+
+                if (msghdr->msg_flags & MSG_TRUNC) {
+                        cmsg_close_all(msghdr);
+                        log_warning("Got datagram larger than the maximum entry size of %zu bytes, ignoring.", (size_t) ENTRY_SIZE_MAX);
+                        continue;
+                }
+
+                server_dispatch_datagram(s, fd, buffer, len, msghdr);
+
+                /* Don't keep the memory of large datagrams around */
+                if (len >= DATAGRAM_SLOT_KEEP)
+                        (void) madvise(buffer + DATAGRAM_SLOT_KEEP, PAGE_ALIGN(len + 1) - DATAGRAM_SLOT_KEEP, MADV_DONTNEED);
+        }
+
+        server_end_batch(s);
+
+        return 0;
+}
+
+int server_process_datagram(
+                sd_event_source *es,
+                int fd,
+                uint32_t revents,
+                void *userdata) {
+
+        Server *s = userdata;
+        DatagramBatch *b;
+        int v = 0, r;
+
+        assert(s);
+        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
+
+        if (revents != EPOLLIN)
+                return log_error_errno(SYNTHETIC_ERRNO(EIO),
+                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
+                                       revents);
+
+        /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
+         * it.) */
+        (void) ioctl(fd, SIOCINQ, &v);
+
+        /* Unless the next datagram is too large for a batch slot, read as many datagrams as are queued with
+         * one recvmmsg() call, instead of one syscall per message. */
+        b = (size_t) v < DATAGRAM_SLOT_SIZE ? server_get_datagram_batch(s) : NULL;
+        if (b)
+                r = server_process_datagram_batch(s, fd, b);
+        else
+                r = server_process_datagram_one(s, fd, v);
+        if (r < 0)
+                return r;
 
         server_refresh_idle_timer(s);
         return 0;
@@ -1452,6 +1788,9 @@ static void server_full_sync(Server *s) {
 
         assert(s);
 
+        /* Make sure entries still being compressed are written before we report back */
+        server_compress_flush(s);
+
         server_sync(s);
 
         /* Let clients know when the most recent sync happened. */
@@ -1474,6 +1813,29 @@ static int dispatch_sigrtmin1(sd_event_source *es, const struct signalfd_siginfo
         return 0;
 }
 
+static int dispatch_memory_pressure(sd_event_source *es, void *userdata) {
+        Server *s = userdata;
+
+        assert(s);
+
+        log_debug("Under memory pressure, flushing caches.");
+        client_context_trim(s);
+
+        return 0;
+}
+
+static int setup_memory_pressure(Server *s) {
+        int r;
+
+        assert(s);
+
+        r = sd_event_add_memory_pressure(s->event, &s->memory_pressure_event_source, dispatch_memory_pressure, s);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to watch for memory pressure, ignoring: %m");
+
+        return 0;
+}
+
 static int setup_signals(Server *s) {
         int r;
 
@@ -2271,6 +2633,10 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return log_error_errno(r, "Failed to create event loop: %m");
 
+        r = server_compress_workers_start(s);
+        if (r < 0)
+                return r;
+
         n = sd_listen_fds(true);
         if (n < 0)
                 return log_error_errno(n, "Failed to read listening file descriptors from environment: %m");
@@ -2390,6 +2756,8 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return r;
 
+        (void) setup_memory_pressure(s);
+
         s->ratelimit = journal_ratelimit_new();
         if (!s->ratelimit)
                 return log_oom();
@@ -2427,6 +2795,8 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return r;
 
+        server_open_tail_cache(s);
+
         server_start_or_stop_idle_timer(s);
         return 0;
 }
@@ -2453,6 +2823,11 @@ void server_done(Server *s) {
         free(s->namespace);
         free(s->namespace_field);
 
+        server_flush_batch(s);
+        server_compress_workers_stop(s);
+
+        journal_tail_close(s->tail_cache);
+
         set_free_with_destructor(s->deferred_closes, journal_file_close);
 
         while (s->stdout_streams)
@@ -2479,6 +2854,7 @@ void server_done(Server *s) {
         sd_event_source_unref(s->sigint_event_source);
         sd_event_source_unref(s->sigrtmin1_event_source);
         sd_event_source_unref(s->hostname_event_source);
+        sd_event_source_unref(s->memory_pressure_event_source);
         sd_event_source_unref(s->notify_event_source);
         sd_event_source_unref(s->watchdog_event_source);
         sd_event_source_unref(s->idle_event_source);
@@ -2499,6 +2875,7 @@ void server_done(Server *s) {
                 munmap(s->kernel_seqnum, sizeof(uint64_t));
 
         free(s->buffer);
+        datagram_batch_free(s->datagram_batch);
         free(s->tty_path);
         free(s->cgroup_root);
         free(s->hostname_field);
@@ -7,10 +7,13 @@
 #include "sd-event.h"
 
 typedef struct Server Server;
+typedef struct CompressWorkers CompressWorkers;
+typedef struct DatagramBatch DatagramBatch;
 
 #include "conf-parser.h"
 #include "hashmap.h"
 #include "journal-file.h"
+#include "journal-tail.h"
 #include "journald-context.h"
 #include "journald-rate-limit.h"
 #include "journald-stream.h"
@@ -84,6 +87,7 @@ struct Server {
         sd_event_source *sigint_event_source;
         sd_event_source *sigrtmin1_event_source;
         sd_event_source *hostname_event_source;
+        sd_event_source *memory_pressure_event_source;
         sd_event_source *notify_event_source;
         sd_event_source *watchdog_event_source;
         sd_event_source *idle_event_source;
@@ -97,6 +101,10 @@ struct Server {
         char *buffer;
         size_t buffer_size;
 
+        /* Buffers for reading multiple datagrams at once, allocated on first use */
+        DatagramBatch *datagram_batch;
+        bool datagram_batch_broken;
+
         JournalRateLimit *ratelimit;
         usec_t sync_interval_usec;
         usec_t ratelimit_interval;
@@ -106,6 +114,7 @@ struct Server {
         JournalStorage system_storage;
 
         JournalCompressOptions compress;
+        unsigned compress_threads;
         bool seal;
         bool read_kmsg;
         int set_audit;
@@ -167,11 +176,32 @@ struct Server {
         Hashmap *client_contexts;
         Prioq *client_contexts_lru;
 
+        /* Metadata shared by all processes of a cgroup, see journald-context.c */
+        Hashmap *client_unit_contexts;
+        Prioq *client_unit_contexts_lru;
+        uint64_t client_unit_contexts_generation;
+
         usec_t last_cache_pid_flush;
 
+        ClientContextStats client_context_stats;
+
         ClientContext *my_context; /* the context of journald itself */
         ClientContext *pid1_context; /* the context of PID 1 */
 
+        /* Entries queued up between server_begin_batch() and server_end_batch() */
+        unsigned batch_depth;
+        uid_t batch_uid;
+        int batch_priority;
+        JournalEntryInput *batch_entries;
+        size_t n_batch_entries, n_batch_entries_allocated;
+
+        /* Threads compressing large data fields, see journald-compress.c */
+        CompressWorkers *compress_workers;
+
+        /* Recently written entries, for readers following the journal, see journal-tail.c */
+        uint64_t tail_cache_size;
+        JournalTail *tail_cache;
+
         VarlinkServer *varlink_server;
 };
 
@@ -189,11 +219,17 @@ struct Server {
 /* kmsg: Maximum number of extra fields we'll import from the kernel's /dev/kmsg */
 #define N_IOVEC_KERNEL_FIELDS 64
 
+/* Maximum number of entries we queue up before writing them out, see server_begin_batch() */
+#define BATCH_ENTRIES_MAX 256
+
 /* kmsg: Maximum number of extra fields we'll import from udev's devices */
 #define N_IOVEC_UDEV_FIELDS 32
 
 void server_dispatch_message(Server *s, struct iovec *iovec, size_t n, size_t m, ClientContext *c, const struct timeval *tv, int priority, pid_t object_pid);
 void server_driver_message(Server *s, pid_t object_pid, const char *message_id, const char *format, ...) _sentinel_ _printf_(4,0);
+void server_begin_batch(Server *s);
+void server_end_batch(Server *s);
+void server_write_entries(Server *s, uid_t uid, const JournalEntryInput *entries, size_t n_entries, int priority);
 
 /* gperf lookup function */
 const struct ConfigPerfItem* journald_gperf_lookup(const char *key, GPERF_LEN_TYPE length);
@@ -39,6 +39,10 @@
 
 #define STDOUT_STREAMS_MAX 4096
 
+/* Room we keep in front of the data in the stream buffer, so that the field name can be written right before a
+ * line, instead of copying each line into a new allocation */
+#define STDOUT_STREAM_HEADROOM STRLEN("MESSAGE=")
+
 typedef enum StdoutStreamState {
         STDOUT_STREAM_IDENTIFIER,
         STDOUT_STREAM_UNIT_ID,
@@ -72,6 +76,7 @@ struct StdoutStream {
         struct ucred ucred;
         char *label;
         char *identifier;
+        char *syslog_identifier_field;
         char *unit_id;
         int priority;
         bool level_prefix:1;
@@ -82,6 +87,8 @@ struct StdoutStream {
         bool fdstore:1;
         bool in_notify_queue:1;
 
+        /* The first STDOUT_STREAM_HEADROOM bytes of the buffer are not used for data, 'length' counts only the
+         * bytes following them */
         char *buffer;
         size_t length;
         size_t allocated;
@@ -125,6 +132,7 @@ void stdout_stream_free(StdoutStream *s) {
         safe_close(s->fd);
         free(s->label);
         free(s->identifier);
+        free(s->syslog_identifier_field);
         free(s->unit_id);
         free(s->state_file);
         free(s->buffer);
@@ -250,12 +258,14 @@ static int stdout_stream_log(
         int priority;
         char syslog_priority[] = "PRIORITY=\0";
         char syslog_facility[STRLEN("SYSLOG_FACILITY=") + DECIMAL_STR_MAX(int) + 1];
-        _cleanup_free_ char *message = NULL, *syslog_identifier = NULL;
+        char saved[STDOUT_STREAM_HEADROOM], *message;
         size_t n = 0, m;
         int r;
 
         assert(s);
         assert(p);
+        assert(p >= s->buffer + STDOUT_STREAM_HEADROOM);
+        assert(p < s->buffer + s->allocated);
 
         assert(line_break >= 0);
         assert(line_break < _LINE_BREAK_MAX);
@@ -306,9 +316,10 @@ static int stdout_stream_log(
         }
 
         if (s->identifier) {
-                syslog_identifier = strjoin("SYSLOG_IDENTIFIER=", s->identifier);
-                if (syslog_identifier)
-                        iovec[n++] = IOVEC_MAKE_STRING(syslog_identifier);
+                if (!s->syslog_identifier_field)
+                        s->syslog_identifier_field = strjoin("SYSLOG_IDENTIFIER=", s->identifier);
+                if (s->syslog_identifier_field)
+                        iovec[n++] = IOVEC_MAKE_STRING(s->syslog_identifier_field);
         }
 
         static const char * const line_break_field_table[_LINE_BREAK_MAX] = {
@@ -326,11 +337,17 @@ static int stdout_stream_log(
         if (c)
                 iovec[n++] = IOVEC_MAKE_STRING(c);
 
-        message = strjoin("MESSAGE=", p);
-        if (message)
-                iovec[n++] = IOVEC_MAKE_STRING(message);
+        /* The line is located in our stream buffer, preceded by at least STDOUT_STREAM_HEADROOM bytes that are
+         * either the headroom or already processed data. Temporarily put the field name there, so that the line
+         * can be passed on without copying it. */
+        message = s->buffer + (p - s->buffer) - STDOUT_STREAM_HEADROOM;
+        memcpy(saved, message, STDOUT_STREAM_HEADROOM);
+        memcpy(message, "MESSAGE=", STDOUT_STREAM_HEADROOM);
+        iovec[n++] = IOVEC_MAKE_STRING(message);
 
         server_dispatch_message(s->server, iovec, n, m, s->context, NULL, priority, 0);
+
+        memcpy(message, saved, STDOUT_STREAM_HEADROOM);
         return 0;
 }
 
@@ -462,43 +479,55 @@ static int stdout_stream_scan(
                 StdoutStream *s,
                 char *p,
                 size_t remaining,
+                size_t scanned,
                 LineBreak force_flush,
                 size_t *ret_consumed) {
 
         size_t consumed = 0;
-        int r;
+        char *e, saved;
+        int r = 0;
 
         assert(s);
         assert(p);
+        assert(scanned <= remaining);
+
+        /* The first 'scanned' bytes are already known not to contain any terminator, as they are what was
+         * left over from the previous pass. Also, temporarily NUL terminate the buffer, so that a single strchrnul()
+         * pass finds the next \n or NUL, whichever comes first. The buffer always has room for that byte. */
+        e = p + remaining;
+        saved = *e;
+        *e = 0;
 
         for (;;) {
                 LineBreak line_break;
                 size_t skip, found;
-                char *end1, *end2;
+                char *end;
 
-                end1 = memchr(p, '\n', remaining);
-                end2 = memchr(p, 0, end1 ? (size_t) (end1 - p) : remaining);
+                end = strchrnul(p + scanned, '\n');
 
-                if (end2) {
+                if (end < e && *end == 0) {
                         /* We found a NUL terminator */
-                        found = end2 - p;
+                        found = end - p;
                         skip = found + 1;
                         line_break = LINE_BREAK_NUL;
-                } else if (end1) {
+                        scanned = 0;
+                } else if (end < e) {
                         /* We found a \n terminator */
-                        found = end1 - p;
+                        found = end - p;
                         skip = found + 1;
                         line_break = LINE_BREAK_NEWLINE;
+                        scanned = 0;
                 } else if (remaining >= s->server->line_max) {
                         /* Force a line break after the maximum line length */
                         found = skip = s->server->line_max;
                         line_break = LINE_BREAK_LINE_MAX;
+                        scanned = remaining - skip;
                 } else
                         break;
 
                 r = stdout_stream_found(s, p, found, line_break);
                 if (r < 0)
-                        return r;
+                        goto finish;
 
                 p += skip;
                 consumed += skip;
@@ -508,7 +537,7 @@ static int stdout_stream_scan(
         if (force_flush >= 0 && remaining > 0) {
                 r = stdout_stream_found(s, p, remaining, force_flush);
                 if (r < 0)
-                        return r;
+                        goto finish;
 
                 consumed += remaining;
         }
@@ -516,17 +545,19 @@ static int stdout_stream_scan(
         if (ret_consumed)
                 *ret_consumed = consumed;
 
-        return 0;
+finish:
+        *e = saved;
+        return r < 0 ? r : 0;
 }
 
 static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
         CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred))) control;
         StdoutStream *s = userdata;
-        size_t limit, consumed;
+        size_t limit, consumed, scanned;
         struct ucred *ucred;
         struct iovec iovec;
+        char *data, *p;
         ssize_t l;
-        char *p;
         int r;
 
         struct msghdr msghdr = {
@@ -544,18 +575,20 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         }
 
         /* If the buffer is almost full, add room for another 1K */
-        if (s->length + 512 >= s->allocated) {
-                if (!GREEDY_REALLOC(s->buffer, s->allocated, s->length + 1 + 1024)) {
+        if (STDOUT_STREAM_HEADROOM + s->length + 512 >= s->allocated) {
+                if (!GREEDY_REALLOC(s->buffer, s->allocated, STDOUT_STREAM_HEADROOM + s->length + 1 + 1024)) {
                         log_oom();
                         goto terminate;
                 }
         }
 
+        data = s->buffer + STDOUT_STREAM_HEADROOM;
+
         /* Try to make use of the allocated buffer in full, but never read more than the configured line size. Also,
          * always leave room for a terminating NUL we might need to add. */
-        limit = MIN(s->allocated - 1, s->server->line_max);
+        limit = MIN(s->allocated - STDOUT_STREAM_HEADROOM - 1, s->server->line_max);
         assert(s->length <= limit);
-        iovec = IOVEC_MAKE(s->buffer + s->length, limit - s->length);
+        iovec = IOVEC_MAKE(data + s->length, limit - s->length);
 
         l = recvmsg(s->fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
         if (l < 0) {
@@ -568,7 +601,7 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         cmsg_close_all(&msghdr);
 
         if (l == 0) {
-                (void) stdout_stream_scan(s, s->buffer, s->length, /* force_flush = */ LINE_BREAK_EOF, NULL);
+                (void) stdout_stream_scan(s, data, s->length, s->length, /* force_flush = */ LINE_BREAK_EOF, NULL);
                 goto terminate;
         }
 
@@ -579,15 +612,17 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         if (ucred && ucred->pid != s->ucred.pid) {
                 /* Force out any previously half-written lines from a different process, before we switch to
                  * the new ucred structure for everything we just added */
-                r = stdout_stream_scan(s, s->buffer, s->length, /* force_flush = */ LINE_BREAK_PID_CHANGE, NULL);
+                r = stdout_stream_scan(s, data, s->length, s->length, /* force_flush = */ LINE_BREAK_PID_CHANGE, NULL);
                 if (r < 0)
                         goto terminate;
 
                 s->context = client_context_release(s->server, s->context);
 
-                p = s->buffer + s->length;
+                p = data + s->length;
+                scanned = 0;
         } else {
-                p = s->buffer;
+                p = data;
+                scanned = s->length;
                 l += s->length;
         }
 
@@ -595,14 +630,17 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         if (ucred)
                 s->ucred = *ucred;
 
-        r = stdout_stream_scan(s, p, l, _LINE_BREAK_INVALID, &consumed);
+        server_begin_batch(s->server);
+        r = stdout_stream_scan(s, p, l, scanned, _LINE_BREAK_INVALID, &consumed);
+        server_end_batch(s->server);
         if (r < 0)
                 goto terminate;
 
-        /* Move what wasn't consumed to the front of the buffer */
+        /* Move what wasn't consumed to the front of the buffer, unless it is there already */
         assert(consumed <= (size_t) l);
         s->length = l - consumed;
-        memmove(s->buffer, p + consumed, s->length);
+        if (p + consumed != data)
+                memmove(data, p + consumed, s->length);
 
         return 1;
 
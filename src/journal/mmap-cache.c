@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 
@@ -17,9 +19,11 @@
 
 typedef struct Window Window;
 typedef struct Context Context;
+typedef struct MMapPool MMapPool;
+typedef struct FileKey FileKey;
 
 struct Window {
-        MMapCache *cache;
+        MMapPool *pool;
 
         bool invalidated:1;
         bool keep_always:1;
@@ -46,43 +50,188 @@ struct Context {
         LIST_FIELDS(Context, by_window);
 };
 
+struct FileKey {
+        dev_t dev;
+        ino_t ino;
+        int accmode;
+};
+
 struct MMapFileDescriptor {
-        MMapCache *cache;
+        MMapPool *pool;
         int fd;
         bool sigbus;
+
+        /* In shared pools, descriptors are looked up by inode, refcounted, and own a duplicate of the fd
+         * they were first added with, since the original one might be closed while others still use it */
+        unsigned n_ref;
+        FileKey key;
+
+        /* Access pattern tracking: the size used for the next window we map for this file, and where the
+         * last window we mapped ended. Misses that land right after the previous window are considered
+         * a sequential scan and grow the window, everything else shrinks it again. */
+        uint64_t window_size;
+        uint64_t last_window_end;
+
         LIST_HEAD(Window, windows);
 };
 
-struct MMapCache {
+/* The windows and file descriptors, which may be shared between multiple caches, see
+ * mmap_cache_new_shared(). When shared, all accesses are serialized through the lock. */
+struct MMapPool {
         unsigned n_ref;
+        bool shared;
+        pthread_mutex_t lock;
+
         unsigned n_windows;
+        unsigned n_unmapped;
+        unsigned n_sequential, n_random;
 
-        unsigned n_hit, n_missed;
+        uint64_t windows_mapped;
 
         Hashmap *fds;
-        Context *contexts[MMAP_CACHE_MAX_CONTEXTS];
 
         LIST_HEAD(Window, unused);
         Window *last_unused;
 };
 
+/* The contexts, i.e. the windows a user of the cache currently looks at. These are never shared, so that
+ * users don't invalidate each other's pointers. */
+struct MMapCache {
+        unsigned n_ref;
+
+        unsigned n_context_cache_hit, n_window_list_hit, n_missed;
+
+        MMapPool *pool;
+        Context *contexts[MMAP_CACHE_MAX_CONTEXTS];
+};
+
 #define WINDOWS_MIN 64
 
 #if ENABLE_DEBUG_MMAP_CACHE
 /* Tiny windows increase mmap activity and the chance of exposing unsafe use. */
-# define WINDOW_SIZE (page_size())
+# define WINDOW_SIZE_MIN (page_size())
+# define WINDOW_SIZE_DEFAULT (page_size())
+# define WINDOW_SIZE_MAX (page_size())
 #else
-# define WINDOW_SIZE (8ULL*1024ULL*1024ULL)
+# define WINDOW_SIZE_MIN (1ULL*1024ULL*1024ULL)
+# define WINDOW_SIZE_DEFAULT (8ULL*1024ULL*1024ULL)
+# define WINDOW_SIZE_MAX (32ULL*1024ULL*1024ULL)
 #endif
 
-MMapCache* mmap_cache_new(void) {
+/* Once this much address space is mapped we recycle unused windows rather than allocating new ones, even
+ * if we are below WINDOWS_MIN. This keeps the address space bounded now that windows may grow. */
+#define WINDOWS_MAPPED_MAX (WINDOWS_MIN * WINDOW_SIZE_DEFAULT)
+
+static pthread_mutex_t shared_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static MMapPool *shared_pool = NULL;
+
+static void file_key_hash_func(const FileKey *k, struct siphash *state) {
+        siphash24_compress(&k->dev, sizeof(k->dev), state);
+        siphash24_compress(&k->ino, sizeof(k->ino), state);
+        siphash24_compress(&k->accmode, sizeof(k->accmode), state);
+}
+
+static int file_key_compare_func(const FileKey *a, const FileKey *b) {
+        int r;
+
+        r = CMP(a->dev, b->dev);
+        if (r != 0)
+                return r;
+
+        r = CMP(a->ino, b->ino);
+        if (r != 0)
+                return r;
+
+        return CMP(a->accmode, b->accmode);
+}
+
+DEFINE_PRIVATE_HASH_OPS(file_key_hash_ops, FileKey, file_key_hash_func, file_key_compare_func);
+
+static void pool_lock(MMapPool *p) {
+        assert(p);
+
+        if (p->shared)
+                assert_se(pthread_mutex_lock(&p->lock) == 0);
+}
+
+static void pool_unlock(MMapPool *p) {
+        assert(p);
+
+        if (p->shared)
+                assert_se(pthread_mutex_unlock(&p->lock) == 0);
+}
+
+static MMapPool* pool_new(bool shared) {
+        MMapPool *p;
+
+        p = new(MMapPool, 1);
+        if (!p)
+                return NULL;
+
+        *p = (MMapPool) {
+                .n_ref = 1,
+                .shared = shared,
+                .lock = PTHREAD_MUTEX_INITIALIZER,
+        };
+
+        return p;
+}
+
+static MMapCache* cache_new(MMapPool *p) {
         MMapCache *m;
 
+        assert(p);
+
         m = new0(MMapCache, 1);
         if (!m)
                 return NULL;
 
         m->n_ref = 1;
+        m->pool = p;
+        return m;
+}
+
+MMapCache* mmap_cache_new(void) {
+        MMapCache *m;
+        MMapPool *p;
+
+        p = pool_new(false);
+        if (!p)
+                return NULL;
+
+        m = cache_new(p);
+        if (!m)
+                return mfree(p);
+
+        return m;
+}
+
+MMapCache* mmap_cache_new_shared(void) {
+        MMapCache *m = NULL;
+
+        /* Returns a new cache, whose windows and file descriptors are shared with all other caches created
+         * this way in this process. Each cache still has its own contexts, hence pointers returned by
+         * mmap_cache_get() stay valid just like for unshared caches, and different caches may be used from
+         * different threads at the same time. A single cache must not be used by multiple threads at the
+         * same time however. */
+
+        assert_se(pthread_mutex_lock(&shared_pool_lock) == 0);
+
+        if (shared_pool) {
+                m = cache_new(shared_pool);
+                if (m)
+                        shared_pool->n_ref++;
+        } else {
+                shared_pool = pool_new(true);
+                if (shared_pool) {
+                        m = cache_new(shared_pool);
+                        if (!m)
+                                shared_pool = mfree(shared_pool);
+                }
+        }
+
+        assert_se(pthread_mutex_unlock(&shared_pool_lock) == 0);
+
         return m;
 }
 
@@ -91,17 +240,20 @@ static void window_unlink(Window *w) {
 
         assert(w);
 
-        if (w->ptr)
+        if (w->ptr) {
                 munmap(w->ptr, w->size);
+                w->pool->windows_mapped -= w->size;
+                w->pool->n_unmapped++;
+        }
 
         if (w->fd)
                 LIST_REMOVE(by_fd, w->fd->windows, w);
 
         if (w->in_unused) {
-                if (w->cache->last_unused == w)
-                        w->cache->last_unused = w->unused_prev;
+                if (w->pool->last_unused == w)
+                        w->pool->last_unused = w->unused_prev;
 
-                LIST_REMOVE(unused, w->cache->unused, w);
+                LIST_REMOVE(unused, w->pool->unused, w);
         }
 
         LIST_FOREACH(by_window, c, w->contexts) {
@@ -129,7 +281,7 @@ static void window_free(Window *w) {
         assert(w);
 
         window_unlink(w);
-        w->cache->n_windows--;
+        w->pool->n_windows--;
         free(w);
 }
 
@@ -148,33 +300,32 @@ _pure_ static bool window_matches_fd(Window *w, MMapFileDescriptor *f, int prot,
         assert(f);
 
         return
-                w->fd &&
-                f->fd == w->fd->fd &&
+                w->fd == f &&
                 window_matches(w, prot, offset, size);
 }
 
-static Window *window_add(MMapCache *m, MMapFileDescriptor *f, int prot, bool keep_always, uint64_t offset, size_t size, void *ptr) {
+static Window *window_add(MMapPool *p, MMapFileDescriptor *f, int prot, bool keep_always, uint64_t offset, size_t size, void *ptr) {
         Window *w;
 
-        assert(m);
+        assert(p);
         assert(f);
 
-        if (!m->last_unused || m->n_windows <= WINDOWS_MIN) {
+        if (!p->last_unused || (p->n_windows <= WINDOWS_MIN && p->windows_mapped < WINDOWS_MAPPED_MAX)) {
 
                 /* Allocate a new window */
                 w = new(Window, 1);
                 if (!w)
                         return NULL;
-                m->n_windows++;
+                p->n_windows++;
         } else {
 
                 /* Reuse an existing one */
-                w = m->last_unused;
+                w = p->last_unused;
                 window_unlink(w);
         }
 
         *w = (Window) {
-                .cache = m,
+                .pool = p,
                 .fd = f,
                 .prot = prot,
                 .keep_always = keep_always,
@@ -183,6 +334,7 @@ static Window *window_add(MMapCache *m, MMapFileDescriptor *f, int prot, bool ke
                 .ptr = ptr,
         };
 
+        p->windows_mapped += size;
         LIST_PREPEND(by_fd, f->windows, w);
 
         return w;
@@ -206,9 +358,9 @@ static void context_detach_window(Context *c) {
                  * by SIGSEGV. */
                 window_free(w);
 #else
-                LIST_PREPEND(unused, c->cache->unused, w);
-                if (!c->cache->last_unused)
-                        c->cache->last_unused = w;
+                LIST_PREPEND(unused, c->cache->pool->unused, w);
+                if (!c->cache->pool->last_unused)
+                        c->cache->pool->last_unused = w;
 
                 w->in_unused = true;
 #endif
@@ -226,9 +378,9 @@ static void context_attach_window(Context *c, Window *w) {
 
         if (w->in_unused) {
                 /* Used again? */
-                LIST_REMOVE(unused, c->cache->unused, w);
-                if (c->cache->last_unused == w)
-                        c->cache->last_unused = w->unused_prev;
+                LIST_REMOVE(unused, c->cache->pool->unused, w);
+                if (c->cache->pool->last_unused == w)
+                        c->cache->pool->last_unused = w->unused_prev;
 
                 w->in_unused = false;
         }
@@ -272,32 +424,70 @@ static void context_free(Context *c) {
         free(c);
 }
 
+static MMapPool *pool_free(MMapPool *p) {
+        assert(p);
+
+        hashmap_free(p->fds);
+
+        while (p->unused)
+                window_free(p->unused);
+
+        return mfree(p);
+}
+
+static void pool_unref(MMapPool *p) {
+        bool last;
+
+        assert(p);
+
+        if (!p->shared) {
+                pool_free(p);
+                return;
+        }
+
+        /* Take the global lock, so that mmap_cache_new_shared() can't pick up the pool while we free it */
+        assert_se(pthread_mutex_lock(&shared_pool_lock) == 0);
+
+        assert(p->n_ref > 0);
+        last = --p->n_ref == 0;
+        if (last) {
+                assert(shared_pool == p);
+                shared_pool = NULL;
+        }
+
+        assert_se(pthread_mutex_unlock(&shared_pool_lock) == 0);
+
+        if (last)
+                pool_free(p);
+}
+
 static MMapCache *mmap_cache_free(MMapCache *m) {
         int i;
 
         assert(m);
 
+        pool_lock(m->pool);
+
         for (i = 0; i < MMAP_CACHE_MAX_CONTEXTS; i++)
                 if (m->contexts[i])
                         context_free(m->contexts[i]);
 
-        hashmap_free(m->fds);
+        pool_unlock(m->pool);
 
-        while (m->unused)
-                window_free(m->unused);
+        pool_unref(m->pool);
 
         return mfree(m);
 }
 
 DEFINE_TRIVIAL_REF_UNREF_FUNC(MMapCache, mmap_cache, mmap_cache_free);
 
-static int make_room(MMapCache *m) {
-        assert(m);
+static int make_room(MMapPool *p) {
+        assert(p);
 
-        if (!m->last_unused)
+        if (!p->last_unused)
                 return 0;
 
-        window_free(m->last_unused);
+        window_free(p->last_unused);
         return 1;
 }
 
@@ -391,10 +581,10 @@ static int find_mmap(
         return 1;
 }
 
-static int mmap_try_harder(MMapCache *m, void *addr, MMapFileDescriptor *f, int prot, int flags, uint64_t offset, size_t size, void **res) {
+static int mmap_try_harder(MMapPool *p, void *addr, MMapFileDescriptor *f, int prot, int flags, uint64_t offset, size_t size, void **res) {
         void *ptr;
 
-        assert(m);
+        assert(p);
         assert(f);
         assert(res);
 
@@ -407,7 +597,7 @@ static int mmap_try_harder(MMapCache *m, void *addr, MMapFileDescriptor *f, int
                 if (errno != ENOMEM)
                         return negative_errno();
 
-                r = make_room(m);
+                r = make_room(p);
                 if (r < 0)
                         return r;
                 if (r == 0)
@@ -418,6 +608,36 @@ static int mmap_try_harder(MMapCache *m, void *addr, MMapFileDescriptor *f, int
         return 0;
 }
 
+static bool fd_update_access_pattern(MMapPool *p, MMapFileDescriptor *f, uint64_t offset) {
+        bool sequential;
+
+        assert(p);
+        assert(f);
+
+        /* Called on every miss. If the miss is located within one window size after the end of the window we
+         * mapped last, we are most likely scanning forward through the file, hence double the window size, so
+         * that we need fewer mmap() calls and page faults are served by readahead. Otherwise we are
+         * bisecting or jumping around, and large windows only waste address space, hence halve it. */
+
+        /* Nothing to learn from the very first miss */
+        if (f->last_window_end == 0)
+                return false;
+
+        sequential =
+                offset >= f->last_window_end &&
+                offset - f->last_window_end < f->window_size;
+
+        if (sequential) {
+                f->window_size = MIN(f->window_size * 2, WINDOW_SIZE_MAX);
+                p->n_sequential++;
+        } else {
+                f->window_size = MAX(f->window_size / 2, WINDOW_SIZE_MIN);
+                p->n_random++;
+        }
+
+        return sequential;
+}
+
 static int add_mmap(
                 MMapCache *m,
                 MMapFileDescriptor *f,
@@ -431,6 +651,7 @@ static int add_mmap(
                 size_t *ret_size) {
 
         uint64_t woffset, wsize;
+        bool sequential;
         Context *c;
         Window *w;
         void *d;
@@ -442,21 +663,27 @@ static int add_mmap(
         assert(size > 0);
         assert(ret);
 
+        sequential = fd_update_access_pattern(m->pool, f, offset);
+
         woffset = offset & ~((uint64_t) page_size() - 1ULL);
         wsize = size + (offset - woffset);
         wsize = PAGE_ALIGN(wsize);
 
-        if (wsize < WINDOW_SIZE) {
+        if (wsize < f->window_size) {
                 uint64_t delta;
 
-                delta = PAGE_ALIGN((WINDOW_SIZE - wsize) / 2);
+                /* For sequential scans map the window ahead of the requested offset, since that's where the
+                 * next accesses will be. Otherwise center the window around the requested offset. */
+                if (!sequential) {
+                        delta = PAGE_ALIGN((f->window_size - wsize) / 2);
 
-                if (delta > offset)
-                        woffset = 0;
-                else
-                        woffset -= delta;
+                        if (delta > offset)
+                                woffset = 0;
+                        else
+                                woffset -= delta;
+                }
 
-                wsize = WINDOW_SIZE;
+                wsize = f->window_size;
         }
 
         if (st) {
@@ -471,15 +698,24 @@ static int add_mmap(
                         wsize = PAGE_ALIGN(st->st_size - woffset);
         }
 
-        r = mmap_try_harder(m, NULL, f, prot, MAP_SHARED, woffset, wsize, &d);
+        r = mmap_try_harder(m->pool, NULL, f, prot, MAP_SHARED, woffset, wsize, &d);
         if (r < 0)
                 return r;
 
+        f->last_window_end = woffset + wsize;
+
+        /* The window we just mapped is the one we predict to be read next, let the kernel know to start
+         * reading it in right away. This is merely a hint, hence ignore errors. */
+        if (sequential) {
+                (void) madvise(d, wsize, MADV_SEQUENTIAL);
+                (void) madvise(d, wsize, MADV_WILLNEED);
+        }
+
         c = context_add(m, context);
         if (!c)
                 goto outofmem;
 
-        w = window_add(m, f, prot, keep_always, woffset, wsize, d);
+        w = window_add(m->pool, f, prot, keep_always, woffset, wsize, d);
         if (!w)
                 goto outofmem;
 
@@ -516,31 +752,38 @@ int mmap_cache_get(
         assert(size > 0);
         assert(ret);
         assert(context < MMAP_CACHE_MAX_CONTEXTS);
+        assert(f->pool == m->pool);
+
+        pool_lock(m->pool);
 
         /* Check whether the current context is the right one already */
         r = try_context(m, f, prot, context, keep_always, offset, size, ret, ret_size);
         if (r != 0) {
-                m->n_hit++;
-                return r;
+                m->n_context_cache_hit++;
+                goto finish;
         }
 
         /* Search for a matching mmap */
         r = find_mmap(m, f, prot, context, keep_always, offset, size, ret, ret_size);
         if (r != 0) {
-                m->n_hit++;
-                return r;
+                m->n_window_list_hit++;
+                goto finish;
         }
 
         m->n_missed++;
 
         /* Create a new mmap */
-        return add_mmap(m, f, prot, context, keep_always, offset, size, st, ret, ret_size);
+        r = add_mmap(m, f, prot, context, keep_always, offset, size, st, ret, ret_size);
+
+finish:
+        pool_unlock(m->pool);
+        return r;
 }
 
 unsigned mmap_cache_get_hit(MMapCache *m) {
         assert(m);
 
-        return m->n_hit;
+        return m->n_context_cache_hit + m->n_window_list_hit;
 }
 
 unsigned mmap_cache_get_missed(MMapCache *m) {
@@ -549,13 +792,30 @@ unsigned mmap_cache_get_missed(MMapCache *m) {
         return m->n_missed;
 }
 
-static void mmap_cache_process_sigbus(MMapCache *m) {
+void mmap_cache_stats_log_debug(MMapCache *m) {
+        MMapPool *p;
+
+        assert(m);
+
+        p = m->pool;
+        pool_lock(p);
+
+        log_debug("mmap cache statistics: %u context cache hit, %u window list hit, %u miss, %u unmap, "
+                  "%u sequential, %u random, %u windows, %" PRIu64 " bytes mapped%s",
+                  m->n_context_cache_hit, m->n_window_list_hit, m->n_missed, p->n_unmapped,
+                  p->n_sequential, p->n_random, p->n_windows, p->windows_mapped,
+                  p->shared ? " (shared)" : "");
+
+        pool_unlock(p);
+}
+
+static void pool_process_sigbus(MMapPool *p) {
         bool found = false;
         MMapFileDescriptor *f;
         Iterator i;
         int r;
 
-        assert(m);
+        assert(p);
 
         /* Iterate through all triggered pages and mark their files as
          * invalidated */
@@ -572,7 +832,7 @@ static void mmap_cache_process_sigbus(MMapCache *m) {
                 }
 
                 ours = false;
-                HASHMAP_FOREACH(f, m->fds, i) {
+                HASHMAP_FOREACH(f, p->fds, i) {
                         Window *w;
 
                         LIST_FOREACH(by_fd, w, f->windows) {
@@ -601,7 +861,7 @@ static void mmap_cache_process_sigbus(MMapCache *m) {
         if (_likely_(!found))
                 return;
 
-        HASHMAP_FOREACH(f, m->fds, i) {
+        HASHMAP_FOREACH(f, p->fds, i) {
                 Window *w;
 
                 if (!f->sigbus)
@@ -613,58 +873,141 @@ static void mmap_cache_process_sigbus(MMapCache *m) {
 }
 
 bool mmap_cache_got_sigbus(MMapCache *m, MMapFileDescriptor *f) {
+        bool b;
+
         assert(m);
         assert(f);
 
-        mmap_cache_process_sigbus(m);
+        pool_lock(m->pool);
+
+        pool_process_sigbus(m->pool);
+        b = f->sigbus;
 
-        return f->sigbus;
+        pool_unlock(m->pool);
+
+        return b;
 }
 
-MMapFileDescriptor* mmap_cache_add_fd(MMapCache *m, int fd) {
-        MMapFileDescriptor *f;
+static MMapFileDescriptor* pool_add_fd(MMapPool *p, int fd) {
+        _cleanup_free_ MMapFileDescriptor *f = NULL;
+        MMapFileDescriptor *existing;
+        FileKey key = {};
         int r;
 
-        assert(m);
+        assert(p);
         assert(fd >= 0);
 
-        f = hashmap_get(m->fds, FD_TO_PTR(fd));
-        if (f)
-                return f;
+        if (p->shared) {
+                struct stat st;
+                int flags;
+
+                if (fstat(fd, &st) < 0)
+                        return NULL;
+
+                flags = fcntl(fd, F_GETFL);
+                if (flags < 0)
+                        return NULL;
+
+                key = (FileKey) {
+                        .dev = st.st_dev,
+                        .ino = st.st_ino,
+                        .accmode = flags & O_ACCMODE,
+                };
+
+                existing = hashmap_get(p->fds, &key);
+                if (existing) {
+                        existing->n_ref++;
+                        return existing;
+                }
+
+                r = hashmap_ensure_allocated(&p->fds, &file_key_hash_ops);
+        } else {
+                existing = hashmap_get(p->fds, FD_TO_PTR(fd));
+                if (existing)
+                        return existing;
 
-        r = hashmap_ensure_allocated(&m->fds, NULL);
+                r = hashmap_ensure_allocated(&p->fds, NULL);
+        }
         if (r < 0)
                 return NULL;
 
-        f = new0(MMapFileDescriptor, 1);
+        f = new(MMapFileDescriptor, 1);
         if (!f)
                 return NULL;
 
-        f->cache = m;
-        f->fd = fd;
+        *f = (MMapFileDescriptor) {
+                .pool = p,
+                .fd = -1,
+                .n_ref = 1,
+                .key = key,
+                .window_size = WINDOW_SIZE_DEFAULT,
+        };
 
-        r = hashmap_put(m->fds, FD_TO_PTR(fd), f);
-        if (r < 0)
-                return mfree(f);
+        if (p->shared) {
+                f->fd = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+                if (f->fd < 0)
+                        return NULL;
+
+                r = hashmap_put(p->fds, &f->key, f);
+                if (r < 0) {
+                        safe_close(f->fd);
+                        return NULL;
+                }
+        } else {
+                f->fd = fd;
+
+                r = hashmap_put(p->fds, FD_TO_PTR(fd), f);
+                if (r < 0)
+                        return NULL;
+        }
+
+        return TAKE_PTR(f);
+}
+
+MMapFileDescriptor* mmap_cache_add_fd(MMapCache *m, int fd) {
+        MMapFileDescriptor *f;
+
+        assert(m);
+        assert(fd >= 0);
+
+        pool_lock(m->pool);
+        f = pool_add_fd(m->pool, fd);
+        pool_unlock(m->pool);
 
         return f;
 }
 
 void mmap_cache_free_fd(MMapCache *m, MMapFileDescriptor *f) {
+        MMapPool *p;
+
         assert(m);
         assert(f);
+        assert(f->pool == m->pool);
+
+        p = m->pool;
+        pool_lock(p);
+
+        assert(f->n_ref > 0);
+        if (--f->n_ref > 0)
+                goto finish;
 
         /* Make sure that any queued SIGBUS are first dispatched, so
          * that we don't end up with a SIGBUS entry we cannot relate
          * to any existing memory map */
 
-        mmap_cache_process_sigbus(m);
+        pool_process_sigbus(p);
 
         while (f->windows)
                 window_free(f->windows);
 
-        if (f->cache)
-                assert_se(hashmap_remove(f->cache->fds, FD_TO_PTR(f->fd)));
+        if (p->shared) {
+                assert_se(hashmap_remove(p->fds, &f->key));
+                safe_close(f->fd);
+        } else
+                assert_se(hashmap_remove(p->fds, FD_TO_PTR(f->fd)));
 
         free(f);
+
+finish:
+        pool_unlock(p);
 }
@@ -14,6 +14,7 @@ pcre2_code* (*sym_pcre2_compile)(PCRE2_SPTR, PCRE2_SIZE, uint32_t, int *, PCRE2_
 int (*sym_pcre2_get_error_message)(int, PCRE2_UCHAR *, PCRE2_SIZE);
 int (*sym_pcre2_match)(const pcre2_code *, PCRE2_SPTR, PCRE2_SIZE, PCRE2_SIZE, uint32_t, pcre2_match_data *, pcre2_match_context *);
 PCRE2_SIZE* (*sym_pcre2_get_ovector_pointer)(pcre2_match_data *);
+int (*sym_pcre2_jit_compile)(pcre2_code *, uint32_t);
 
 int dlopen_pcre2(void) {
         _cleanup_(dlclosep) void *dl = NULL;
@@ -37,6 +38,7 @@ int dlopen_pcre2(void) {
                         &sym_pcre2_get_error_message, "pcre2_get_error_message_8",
                         &sym_pcre2_match, "pcre2_match_8",
                         &sym_pcre2_get_ovector_pointer, "pcre2_get_ovector_pointer_8",
+                        &sym_pcre2_jit_compile, "pcre2_jit_compile_8",
                         NULL);
         if (r < 0)
                 return r;
@@ -17,6 +17,7 @@
 #include "compress.h"
 #include "dirent-util.h"
 #include "env-file.h"
+#include "env-util.h"
 #include "escape.h"
 #include "fd-util.h"
 #include "fileio.h"
@@ -34,7 +35,6 @@
 #include "nulstr-util.h"
 #include "path-util.h"
 #include "process-util.h"
-#include "replace-var.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -104,17 +104,42 @@ static int journal_put_error(sd_journal *j, int r, const char *path) {
         return 0;
 }
 
-static void detach_location(sd_journal *j) {
+static void files_by_location_invalidate(sd_journal *j) {
+        JournalFile *f;
+
+        assert(j);
+
+        while ((f = prioq_pop(j->files_by_location)))
+                f->location_prioq_idx = PRIOQ_IDX_NULL;
+
+        set_clear(j->files_at_tail);
+        j->files_by_location_valid = false;
+}
+
+static void reset_files_location(sd_journal *j) {
         Iterator i;
         JournalFile *f;
 
         assert(j);
 
-        j->current_file = NULL;
-        j->current_field = 0;
+        /* Makes all files seek to the current location from scratch next time */
+
+        files_by_location_invalidate(j);
 
         ORDERED_HASHMAP_FOREACH(f, j->files, i)
                 journal_file_reset_location(f);
+
+        j->tail_used = false;
+}
+
+static void detach_location(sd_journal *j) {
+        assert(j);
+
+        j->current_file = NULL;
+        j->current_field = 0;
+        j->tail_entry = NULL;
+
+        reset_files_location(j);
 }
 
 static void init_location(Location *l, LocationType type, JournalFile *f, Object *o) {
@@ -146,6 +171,7 @@ static void set_location(sd_journal *j, JournalFile *f, Object *o) {
 
         j->current_file = f;
         j->current_field = 0;
+        j->tail_entry = NULL;
 
         /* Let f know its candidate entry was picked. */
         assert(f->location_type == LOCATION_SEEK);
@@ -817,50 +843,304 @@ static int next_beyond_location(sd_journal *j, JournalFile *f, direction_t direc
         }
 }
 
-static int real_journal_next(sd_journal *j, direction_t direction) {
-        JournalFile *new_file = NULL;
+static int files_by_location_compare_down(const void *a, const void *b) {
+        return journal_file_compare_locations((JournalFile*) a, (JournalFile*) b);
+}
+
+static int files_by_location_compare_up(const void *a, const void *b) {
+        return journal_file_compare_locations((JournalFile*) b, (JournalFile*) a);
+}
+
+static int file_advance_location(sd_journal *j, JournalFile *f, direction_t direction) {
+        int r;
+
+        assert(j);
+        assert(f);
+
+        /* Moves f to its next candidate entry beyond the current location, and files it either in the
+         * priority queue or, if it hit the end, in the set of files to check again for new entries. Returns
+         * > 0 if f has a candidate entry, 0 if not, and < 0 if f got removed because it couldn't be read. */
+
+        r = next_beyond_location(j, f, direction);
+        if (r < 0) {
+                log_debug_errno(r, "Can't iterate through %s, ignoring: %m", f->path);
+                remove_file_real(j, f);
+                return r;
+        }
+        if (r == 0) {
+                f->location_type = LOCATION_TAIL;
+
+                if (prioq_remove(j->files_by_location, f, &f->location_prioq_idx) > 0)
+                        f->location_prioq_idx = PRIOQ_IDX_NULL;
+
+                /* Archived files never grow, no need to look at them again until the location changes. */
+                if (f->header->state != STATE_ARCHIVED) {
+                        r = set_ensure_put(&j->files_at_tail, NULL, f);
+                        if (r < 0)
+                                return r;
+                }
+
+                return 0;
+        }
+
+        (void) set_remove(j->files_at_tail, f);
+
+        if (f->location_prioq_idx == PRIOQ_IDX_NULL)
+                r = prioq_put(j->files_by_location, f, &f->location_prioq_idx);
+        else
+                r = prioq_reshuffle(j->files_by_location, f, &f->location_prioq_idx);
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
+static int files_by_location_rebuild(sd_journal *j, direction_t direction) {
         unsigned i, n_files;
         const void **files;
-        Object *o;
         int r;
 
-        assert_return(j, -EINVAL);
-        assert_return(!journal_pid_changed(j), -ECHILD);
+        assert(j);
+
+        files_by_location_invalidate(j);
+
+        if (!j->files_by_location || j->files_by_location_direction != direction) {
+                j->files_by_location = prioq_free(j->files_by_location);
+                j->files_by_location = prioq_new(direction == DIRECTION_DOWN ? files_by_location_compare_down
+                                                                             : files_by_location_compare_up);
+                if (!j->files_by_location)
+                        return -ENOMEM;
+
+                j->files_by_location_direction = direction;
+        }
 
         r = iterated_cache_get(j->files_cache, NULL, &files, &n_files);
         if (r < 0)
                 return r;
 
         for (i = 0; i < n_files; i++) {
-                JournalFile *f = (JournalFile *)files[i];
-                bool found;
+                r = file_advance_location(j, (JournalFile*) files[i], direction);
+                if (r == -ENOMEM)
+                        return r;
+        }
 
-                r = next_beyond_location(j, f, direction);
-                if (r < 0) {
-                        log_debug_errno(r, "Can't iterate through %s, ignoring: %m", f->path);
-                        remove_file_real(j, f);
-                        continue;
-                } else if (r == 0) {
-                        f->location_type = LOCATION_TAIL;
+        j->files_by_location_valid = true;
+        return 0;
+}
+
+static int files_by_location_update(sd_journal *j, direction_t direction) {
+        JournalFile *f;
+        Iterator i;
+        int r;
+
+        assert(j);
+
+        /* Only the file we picked last time moved on, and only files that were at their end and got new
+         * entries since can have new candidates, hence only look at those. */
+
+        if (j->current_file) {
+                r = file_advance_location(j, j->current_file, direction);
+                if (r == -ENOMEM)
+                        return r;
+        }
+
+        SET_FOREACH(f, j->files_at_tail, i) {
+                if (le64toh(f->header->n_entries) == f->last_n_entries)
                         continue;
-                }
 
-                if (!new_file)
-                        found = true;
-                else {
-                        int k;
+                /* This removes f from the set if it got new candidates, which is safe while iterating */
+                r = file_advance_location(j, f, direction);
+                if (r == -ENOMEM)
+                        return r;
+        }
+
+        return 0;
+}
+
+static bool tail_cache_applies(sd_journal *j) {
+        assert(j);
 
-                        k = journal_file_compare_locations(f, new_file);
+        /* journald's tail cache has every entry it wrote recently, in the order of their sequence numbers.
+         * Hence the entry following the current one is the next one in the cache only if we look at exactly
+         * what the local journald writes, i.e. all of its files and nothing else, and without matches. */
 
-                        found = direction == DIRECTION_DOWN ? k < 0 : k > 0;
-                }
+        if (j->tail_forced)
+                return !j->level0;
 
-                if (found)
-                        new_file = f;
+        return j->flags == SD_JOURNAL_LOCAL_ONLY &&
+                !j->level0 &&
+                !j->path &&
+                !j->prefix &&
+                j->toplevel_fd < 0 &&
+                !j->no_new_files;
+}
+
+static void tail_cache_refresh(sd_journal *j) {
+        char sid[SD_ID128_STRING_MAX];
+        const char *fn;
+        sd_id128_t machine;
+        usec_t n;
+        int r;
+
+        assert(j);
+
+        if (j->tail_forced)
+                return;
+
+        /* Don't check for a new cache, or a journald restart, on every single step */
+        n = now(CLOCK_MONOTONIC);
+        if (n < usec_add(j->tail_checked_usec, USEC_PER_SEC))
+                return;
+        j->tail_checked_usec = n;
+
+        /* The current entry might still point into the old cache, keep it around until we move on */
+        if (j->tail && !j->tail_entry && journal_tail_is_stale(j->tail))
+                j->tail = journal_tail_close(j->tail);
+
+        if (j->tail)
+                return;
+
+        r = sd_id128_get_machine(&machine);
+        if (r < 0)
+                return;
+
+        fn = strjoina("/run/log/journal/", sd_id128_to_string(machine, sid),
+                      j->namespace ? "." : "", strempty(j->namespace),
+                      "/" JOURNAL_TAIL_FILE);
+
+        r = journal_tail_open(fn, &j->tail);
+        if (r < 0 && !IN_SET(r, -ENOENT, -EACCES, -ESTALE))
+                log_debug_errno(r, "Failed to open journal tail cache %s, ignoring: %m", fn);
+}
+
+static int tail_cache_next(sd_journal *j) {
+        const JournalTailEntry *e;
+        int r;
+
+        assert(j);
+
+        /* Returns 1 if the next entry was taken from the cache, 0 if the cache says there is no next entry
+         * yet, and -ENOENT if the files have to be consulted. */
+
+        if (!tail_cache_applies(j))
+                return -ENOENT;
+
+        if (j->current_location.type != LOCATION_DISCRETE || !j->current_location.seqnum_set)
+                return -ENOENT;
+
+        tail_cache_refresh(j);
+        if (!j->tail)
+                return -ENOENT;
+
+        /* For anything but the most recent entries this fails right away, as the oldest entry in the cache
+         * already has a larger sequence number. */
+        r = journal_tail_find_next(j->tail, j->current_location.seqnum_id, j->current_location.seqnum, &e);
+        if (r <= 0)
+                return r;
+
+        /* The files are not moved along while we take entries from the cache, see real_journal_next(). */
+        j->tail_used = true;
+
+        j->current_location = (Location) {
+                .type = LOCATION_DISCRETE,
+                .seqnum = e->seqnum,
+                .seqnum_id = e->seqnum_id,
+                .realtime = e->realtime,
+                .monotonic = e->monotonic,
+                .boot_id = e->boot_id,
+                .xor_hash = e->xor_hash,
+                .seqnum_set = true,
+                .realtime_set = true,
+                .monotonic_set = true,
+                .xor_hash_set = true,
+        };
+
+        j->current_file = NULL;
+        j->current_field = 0;
+        j->tail_entry = e;
+
+        return 1;
+}
+
+int journal_set_tail_cache(sd_journal *j, const char *path) {
+        _cleanup_(journal_tail_closep) JournalTail *t = NULL;
+        int r;
+
+        assert(j);
+        assert(path);
+
+        /* Uses the specified tail cache, rather than the one of the local journald. The caller has to
+         * make sure that it has every entry of the files opened in j that it has in its range. Only for
+         * tests and benchmarks. */
+
+        r = journal_tail_open(path, &t);
+        if (r < 0)
+                return r;
+
+        journal_tail_close(j->tail);
+        j->tail = TAKE_PTR(t);
+        j->tail_forced = true;
+
+        detach_location(j);
+        return 0;
+}
+
+static int real_journal_next(sd_journal *j, direction_t direction) {
+        JournalFile *new_file;
+        Object *o;
+        int r;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+
+        if (direction == DIRECTION_DOWN) {
+                r = tail_cache_next(j);
+                if (r != -ENOENT)
+                        return r;
         }
 
-        if (!new_file)
-                return 0;
+        /* While following the tail, the files are left alone, as long as the cache has every entry. Only
+         * once we need them again, make them seek to the location from scratch, rather than step through
+         * everything we took from the cache in the meantime. The current entry stays, in case there's
+         * nothing new in the files either. */
+        if (j->tail_used)
+                reset_files_location(j);
+
+        /* Rather than looking at every file in each step, we keep the files in a priority queue ordered by
+         * their candidate entries, so that picking the next entry is O(log n) in the number of files. The
+         * queue is rebuilt from scratch whenever the location, direction or the set of files changes. */
+
+        if (j->files_by_location_valid && j->files_by_location_direction == direction)
+                r = files_by_location_update(j, direction);
+        else
+                r = files_by_location_rebuild(j, direction);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                uint64_t offset;
+
+                new_file = prioq_peek(j->files_by_location);
+                if (!new_file) {
+                        /* Everything is at the end, make sure we look at all files again next time. */
+                        j->files_by_location_valid = false;
+                        return 0;
+                }
+
+                if (new_file == j->current_file)
+                        break;
+
+                /* Other files may carry a copy of the entry we just returned, in which case they need to
+                 * skip over it. This only moves the file if its candidate is not beyond the current
+                 * location anymore. */
+                offset = new_file->current_offset;
+
+                r = file_advance_location(j, new_file, direction);
+                if (r == -ENOMEM)
+                        return r;
+                if (r > 0 && new_file->current_offset == offset)
+                        break;
+        }
 
         r = journal_file_move_to_object(new_file, OBJECT_ENTRY, new_file->current_offset, &o);
         if (r < 0)
@@ -920,14 +1200,19 @@ _public_ int sd_journal_previous_skip(sd_journal *j, uint64_t skip) {
         return real_journal_next_skip(j, DIRECTION_UP, skip);
 }
 
-_public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
+static int get_current_entry(sd_journal *j, JournalTailEntry *ret) {
         Object *o;
         int r;
-        char bid[SD_ID128_STRING_MAX], sid[SD_ID128_STRING_MAX];
 
-        assert_return(j, -EINVAL);
-        assert_return(!journal_pid_changed(j), -ECHILD);
-        assert_return(cursor, -EINVAL);
+        assert(j);
+        assert(ret);
+
+        /* Returns the header fields of the current entry, wherever it came from */
+
+        if (j->tail_entry) {
+                *ret = *j->tail_entry;
+                return 0;
+        }
 
         if (!j->current_file || j->current_file->current_offset <= 0)
                 return -EADDRNOTAVAIL;
@@ -936,15 +1221,40 @@ _public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
         if (r < 0)
                 return r;
 
-        sd_id128_to_string(j->current_file->header->seqnum_id, sid);
-        sd_id128_to_string(o->entry.boot_id, bid);
+        *ret = (JournalTailEntry) {
+                .seqnum_id = j->current_file->header->seqnum_id,
+                .seqnum = le64toh(o->entry.seqnum),
+                .realtime = le64toh(o->entry.realtime),
+                .monotonic = le64toh(o->entry.monotonic),
+                .boot_id = o->entry.boot_id,
+                .xor_hash = le64toh(o->entry.xor_hash),
+        };
+
+        return 0;
+}
+
+_public_ int sd_journal_get_cursor(sd_journal *j, char **cursor) {
+        JournalTailEntry e;
+        int r;
+        char bid[SD_ID128_STRING_MAX], sid[SD_ID128_STRING_MAX];
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+        assert_return(cursor, -EINVAL);
+
+        r = get_current_entry(j, &e);
+        if (r < 0)
+                return r;
+
+        sd_id128_to_string(e.seqnum_id, sid);
+        sd_id128_to_string(e.boot_id, bid);
 
         if (asprintf(cursor,
                      "s=%s;i=%"PRIx64";b=%s;m=%"PRIx64";t=%"PRIx64";x=%"PRIx64,
-                     sid, le64toh(o->entry.seqnum),
-                     bid, le64toh(o->entry.monotonic),
-                     le64toh(o->entry.realtime),
-                     le64toh(o->entry.xor_hash)) < 0)
+                     sid, e.seqnum,
+                     bid, e.monotonic,
+                     e.realtime,
+                     e.xor_hash) < 0)
                 return -ENOMEM;
 
         return 0;
@@ -1057,17 +1367,14 @@ _public_ int sd_journal_seek_cursor(sd_journal *j, const char *cursor) {
 }
 
 _public_ int sd_journal_test_cursor(sd_journal *j, const char *cursor) {
+        JournalTailEntry e;
         int r;
-        Object *o;
 
         assert_return(j, -EINVAL);
         assert_return(!journal_pid_changed(j), -ECHILD);
         assert_return(!isempty(cursor), -EINVAL);
 
-        if (!j->current_file || j->current_file->current_offset <= 0)
-                return -EADDRNOTAVAIL;
-
-        r = journal_file_move_to_object(j->current_file, OBJECT_ENTRY, j->current_file->current_offset, &o);
+        r = get_current_entry(j, &e);
         if (r < 0)
                 return r;
 
@@ -1093,14 +1400,14 @@ _public_ int sd_journal_test_cursor(sd_journal *j, const char *cursor) {
                         k = sd_id128_from_string(item+2, &id);
                         if (k < 0)
                                 return k;
-                        if (!sd_id128_equal(id, j->current_file->header->seqnum_id))
+                        if (!sd_id128_equal(id, e.seqnum_id))
                                 return 0;
                         break;
 
                 case 'i':
                         if (sscanf(item+2, "%llx", &ll) != 1)
                                 return -EINVAL;
-                        if (ll != le64toh(o->entry.seqnum))
+                        if (ll != e.seqnum)
                                 return 0;
                         break;
 
@@ -1108,28 +1415,28 @@ _public_ int sd_journal_test_cursor(sd_journal *j, const char *cursor) {
                         k = sd_id128_from_string(item+2, &id);
                         if (k < 0)
                                 return k;
-                        if (!sd_id128_equal(id, o->entry.boot_id))
+                        if (!sd_id128_equal(id, e.boot_id))
                                 return 0;
                         break;
 
                 case 'm':
                         if (sscanf(item+2, "%llx", &ll) != 1)
                                 return -EINVAL;
-                        if (ll != le64toh(o->entry.monotonic))
+                        if (ll != e.monotonic)
                                 return 0;
                         break;
 
                 case 't':
                         if (sscanf(item+2, "%llx", &ll) != 1)
                                 return -EINVAL;
-                        if (ll != le64toh(o->entry.realtime))
+                        if (ll != e.realtime)
                                 return 0;
                         break;
 
                 case 'x':
                         if (sscanf(item+2, "%llx", &ll) != 1)
                                 return -EINVAL;
-                        if (ll != le64toh(o->entry.xor_hash))
+                        if (ll != e.xor_hash)
                                 return 0;
                         break;
                 }
@@ -1353,6 +1660,8 @@ static int add_any_file(
 
         /* journal_file_dump(f); */
 
+        f->location_prioq_idx = PRIOQ_IDX_NULL;
+
         r = ordered_hashmap_put(j->files, f->path, f);
         if (r < 0) {
                 f->close_fd = false; /* make sure journal_file_close() doesn't close the caller's fd (or our own). We'll let the caller do that, or ourselves */
@@ -1360,6 +1669,9 @@ static int add_any_file(
                 goto finish;
         }
 
+        /* The new file needs to be taken into account in the next iteration step */
+        files_by_location_invalidate(j);
+
         close_fd = false; /* the fd is now owned by the JournalFile object */
 
         f->last_seen_generation = j->generation;
@@ -1407,6 +1719,18 @@ static int add_file_by_name(
         return add_any_file(j, -1, path);
 }
 
+static bool file_is_tracked(
+                sd_journal *j,
+                const char *prefix,
+                const char *filename) {
+
+        assert(j);
+        assert(prefix);
+        assert(filename);
+
+        return ordered_hashmap_contains(j->files, prefix_roota(prefix, filename));
+}
+
 static void remove_file_by_name(
                 sd_journal *j,
                 const char *prefix,
@@ -1435,6 +1759,10 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
 
         log_debug("File %s removed.", f->path);
 
+        if (prioq_remove(j->files_by_location, f, &f->location_prioq_idx) > 0)
+                f->location_prioq_idx = PRIOQ_IDX_NULL;
+        (void) set_remove(j->files_at_tail, f);
+
         if (j->current_file == f) {
                 j->current_file = NULL;
                 j->current_field = 0;
@@ -1896,6 +2224,22 @@ static int allocate_inotify(sd_journal *j) {
         return hashmap_ensure_allocated(&j->directories_by_wd, NULL);
 }
 
+static bool journal_use_shared_mmap_cache(void) {
+        int r;
+
+        /* Processes that open many journals at once may want to share the mappings of the files between
+         * them, see mmap_cache_new_shared() */
+
+        r = getenv_bool_secure("SYSTEMD_JOURNAL_SHARED_MMAP_CACHE");
+        if (r < 0) {
+                if (r != -ENXIO)
+                        log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_SHARED_MMAP_CACHE, ignoring: %m");
+                return false;
+        }
+
+        return r;
+}
+
 static sd_journal *journal_new(int flags, const char *path, const char *namespace) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
 
@@ -1934,7 +2278,7 @@ static sd_journal *journal_new(int flags, const char *path, const char *namespac
 
         j->files_cache = ordered_hashmap_iterated_cache_new(j->files);
         j->directories_by_path = hashmap_new(&path_hash_ops);
-        j->mmap = mmap_cache_new();
+        j->mmap = journal_use_shared_mmap_cache() ? mmap_cache_new_shared() : mmap_cache_new();
         if (!j->files_cache || !j->directories_by_path || !j->mmap)
                 return NULL;
 
@@ -2162,6 +2506,9 @@ _public_ void sd_journal_close(sd_journal *j) {
 
         sd_journal_flush_matches(j);
 
+        prioq_free(j->files_by_location);
+        set_free(j->files_at_tail);
+
         ordered_hashmap_free_with_destructor(j->files, journal_file_close);
         iterated_cache_free(j->files_cache);
 
@@ -2177,11 +2524,18 @@ _public_ void sd_journal_close(sd_journal *j) {
         safe_close(j->inotify_fd);
 
         if (j->mmap) {
-                log_debug("mmap cache statistics: %u hit, %u miss", mmap_cache_get_hit(j->mmap), mmap_cache_get_missed(j->mmap));
+                mmap_cache_stats_log_debug(j->mmap);
                 mmap_cache_unref(j->mmap);
         }
 
         hashmap_free_free(j->errors);
+        set_free_free(j->data_fields);
+
+        journal_tail_close(j->tail);
+
+        /* sd_journal_get_catalog() keeps the catalog database mapped, release it with the last user we
+         * know of */
+        catalog_cache_flush();
 
         free(j->path);
         free(j->prefix);
@@ -2192,50 +2546,34 @@ _public_ void sd_journal_close(sd_journal *j) {
 }
 
 _public_ int sd_journal_get_realtime_usec(sd_journal *j, uint64_t *ret) {
-        Object *o;
-        JournalFile *f;
+        JournalTailEntry e;
         int r;
 
         assert_return(j, -EINVAL);
         assert_return(!journal_pid_changed(j), -ECHILD);
         assert_return(ret, -EINVAL);
 
-        f = j->current_file;
-        if (!f)
-                return -EADDRNOTAVAIL;
-
-        if (f->current_offset <= 0)
-                return -EADDRNOTAVAIL;
-
-        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+        r = get_current_entry(j, &e);
         if (r < 0)
                 return r;
 
-        *ret = le64toh(o->entry.realtime);
+        *ret = e.realtime;
         return 0;
 }
 
 _public_ int sd_journal_get_monotonic_usec(sd_journal *j, uint64_t *ret, sd_id128_t *ret_boot_id) {
-        Object *o;
-        JournalFile *f;
+        JournalTailEntry e;
         int r;
 
         assert_return(j, -EINVAL);
         assert_return(!journal_pid_changed(j), -ECHILD);
 
-        f = j->current_file;
-        if (!f)
-                return -EADDRNOTAVAIL;
-
-        if (f->current_offset <= 0)
-                return -EADDRNOTAVAIL;
-
-        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+        r = get_current_entry(j, &e);
         if (r < 0)
                 return r;
 
         if (ret_boot_id)
-                *ret_boot_id = o->entry.boot_id;
+                *ret_boot_id = e.boot_id;
         else {
                 sd_id128_t id;
 
@@ -2243,12 +2581,12 @@ _public_ int sd_journal_get_monotonic_usec(sd_journal *j, uint64_t *ret, sd_id12
                 if (r < 0)
                         return r;
 
-                if (!sd_id128_equal(id, o->entry.boot_id))
+                if (!sd_id128_equal(id, e.boot_id))
                         return -ESTALE;
         }
 
         if (ret)
-                *ret = le64toh(o->entry.monotonic);
+                *ret = e.monotonic;
 
         return 0;
 }
@@ -2295,6 +2633,26 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
         assert_return(size, -EINVAL);
         assert_return(field_is_valid(field), -EINVAL);
 
+        field_length = strlen(field);
+
+        if (j->tail_entry) {
+                for (i = 0; i < j->tail_entry->n_fields; i++) {
+                        const struct iovec *iovec = j->tail_entry->fields + i;
+
+                        if (iovec->iov_len >= field_length+1 &&
+                            memcmp(iovec->iov_base, field, field_length) == 0 &&
+                            ((const char*) iovec->iov_base)[field_length] == '=') {
+
+                                *data = iovec->iov_base;
+                                *size = iovec->iov_len;
+
+                                return 0;
+                        }
+                }
+
+                return -ENOENT;
+        }
+
         f = j->current_file;
         if (!f)
                 return -EADDRNOTAVAIL;
@@ -2306,8 +2664,6 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
         if (r < 0)
                 return r;
 
-        field_length = strlen(field);
-
         n = journal_file_entry_n_items(o);
         for (i = 0; i < n; i++) {
                 uint64_t p, l;
@@ -2329,10 +2685,10 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
                 compression = o->object.flags & OBJECT_COMPRESSION_MASK;
                 if (compression) {
 #if HAVE_COMPRESSION
-                        r = decompress_startswith(compression,
-                                                  o->data.payload, l,
-                                                  &f->compress_buffer, &f->compress_buffer_size,
-                                                  field, field_length, '=');
+                        r = decompress_startswith_dict(compression, journal_file_get_dictionary(f),
+                                                       o->data.payload, l,
+                                                       &f->compress_buffer, &f->compress_buffer_size,
+                                                       field, field_length, '=');
                         if (r < 0)
                                 log_debug_errno(r, "Cannot decompress %s object of length %"PRIu64" at offset "OFSfmt": %m",
                                                 object_compressed_to_string(compression), l, p);
@@ -2340,10 +2696,10 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
 
                                 size_t rsize;
 
-                                r = decompress_blob(compression,
-                                                    o->data.payload, l,
-                                                    &f->compress_buffer, &f->compress_buffer_size, &rsize,
-                                                    j->data_threshold);
+                                r = decompress_blob_dict(compression, journal_file_get_dictionary(f),
+                                                         o->data.payload, l,
+                                                         &f->compress_buffer, &f->compress_buffer_size, &rsize,
+                                                         j->data_threshold);
                                 if (r < 0)
                                         return r;
 
@@ -2399,9 +2755,9 @@ static int return_data(sd_journal *j, JournalFile *f, Object *o, const void **da
                 size_t rsize;
                 int r;
 
-                r = decompress_blob(compression,
-                                    o->data.payload, l, &f->compress_buffer,
-                                    &f->compress_buffer_size, &rsize, j->data_threshold);
+                r = decompress_blob_dict(compression, journal_file_get_dictionary(f),
+                                         o->data.payload, l, &f->compress_buffer,
+                                         &f->compress_buffer_size, &rsize, j->data_threshold);
                 if (r < 0)
                         return r;
 
@@ -2418,17 +2774,85 @@ static int return_data(sd_journal *j, JournalFile *f, Object *o, const void **da
         return 0;
 }
 
-_public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t *size) {
+static bool field_in_set(const void *data, size_t size, const Set *fields) {
+        const char *eq;
+
+        /* Field names are never longer than 64 chars, see journal_field_valid() */
+        eq = memchr(data, '=', MIN(size, (size_t) 65));
+        if (!eq)
+                return false;
+
+        return set_contains(fields, strndupa(data, eq - (const char*) data));
+}
+
+static int data_object_in_set(JournalFile *f, Object *o, const Set *fields) {
+        uint64_t l;
+        int compression;
+
+        assert(f);
+        assert(o);
+
+        l = le64toh(READ_NOW(o->object.size));
+        if (l < offsetof(Object, data.payload))
+                return -EBADMSG;
+        l -= offsetof(Object, data.payload);
+
+        compression = o->object.flags & OBJECT_COMPRESSION_MASK;
+        if (compression) {
+#if HAVE_COMPRESSION
+                const char *field;
+                Iterator i;
+
+                /* Only decompress as much as is needed to compare the field name, for each field we look for */
+                SET_FOREACH(field, fields, i) {
+                        int r;
+
+                        r = decompress_startswith_dict(compression, journal_file_get_dictionary(f),
+                                                       o->data.payload, l,
+                                                       &f->compress_buffer, &f->compress_buffer_size,
+                                                       field, strlen(field), '=');
+                        if (r != 0)
+                                return r;
+                }
+
+                return 0;
+#else
+                return -EPROTONOSUPPORT;
+#endif
+        } else {
+                return field_in_set(o->data.payload, l, fields);
+        }
+}
+
+static int enumerate_data(sd_journal *j, const Set *fields, const void **data, size_t *size) {
         JournalFile *f;
-        uint64_t p, n;
-        le64_t le_hash;
+        uint64_t n;
         int r;
         Object *o;
 
-        assert_return(j, -EINVAL);
-        assert_return(!journal_pid_changed(j), -ECHILD);
-        assert_return(data, -EINVAL);
-        assert_return(size, -EINVAL);
+        assert(j);
+        assert(data);
+        assert(size);
+
+        /* Returns the next data object of the current entry, skipping over all fields not listed in 'fields',
+         * if that's not empty, without decompressing them first. */
+
+        if (j->tail_entry) {
+                for (; j->current_field < j->tail_entry->n_fields; j->current_field++) {
+                        const struct iovec *iovec = j->tail_entry->fields + j->current_field;
+
+                        if (!set_isempty(fields) && !field_in_set(iovec->iov_base, iovec->iov_len, fields))
+                                continue;
+
+                        *data = iovec->iov_base;
+                        *size = iovec->iov_len;
+
+                        j->current_field++;
+                        return 1;
+                }
+
+                return 0;
+        }
 
         f = j->current_file;
         if (!f)
@@ -2437,22 +2861,38 @@ _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t
         if (f->current_offset <= 0)
                 return -EADDRNOTAVAIL;
 
-        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
-        if (r < 0)
-                return r;
+        for (;;) {
+                uint64_t p;
+                le64_t le_hash;
 
-        n = journal_file_entry_n_items(o);
-        if (j->current_field >= n)
-                return 0;
+                r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+                if (r < 0)
+                        return r;
 
-        p = le64toh(o->entry.items[j->current_field].object_offset);
-        le_hash = o->entry.items[j->current_field].hash;
-        r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
-        if (r < 0)
-                return r;
+                n = journal_file_entry_n_items(o);
+                if (j->current_field >= n)
+                        return 0;
 
-        if (le_hash != o->data.hash)
-                return -EBADMSG;
+                p = le64toh(o->entry.items[j->current_field].object_offset);
+                le_hash = o->entry.items[j->current_field].hash;
+                r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+                if (r < 0)
+                        return r;
+
+                if (le_hash != o->data.hash)
+                        return -EBADMSG;
+
+                if (set_isempty(fields))
+                        break;
+
+                r = data_object_in_set(f, o, fields);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        break;
+
+                j->current_field++;
+        }
 
         r = return_data(j, f, o, data, size);
         if (r < 0)
@@ -2463,6 +2903,49 @@ _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t
         return 1;
 }
 
+_public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t *size) {
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+        assert_return(data, -EINVAL);
+        assert_return(size, -EINVAL);
+
+        return enumerate_data(j, j->data_fields, data, size);
+}
+
+int journal_enumerate_data_filtered(sd_journal *j, const Set *fields, const void **data, size_t *size) {
+        assert(j);
+        assert(data);
+        assert(size);
+
+        /* Like sd_journal_enumerate_data(), but with an explicit set of fields to return, instead of the one
+         * configured with sd_journal_set_data_fields() */
+
+        return enumerate_data(j, set_isempty(fields) ? j->data_fields : fields, data, size);
+}
+
+_public_ int sd_journal_set_data_fields(sd_journal *j, const char **fields) {
+        _cleanup_set_free_free_ Set *s = NULL;
+        const char **i;
+        int r;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+
+        STRV_FOREACH(i, fields) {
+                if (!field_is_valid(*i))
+                        return -EINVAL;
+
+                r = set_put_strdup(&s, *i);
+                if (r < 0)
+                        return r;
+        }
+
+        set_free_free(j->data_fields);
+        j->data_fields = TAKE_PTR(s);
+
+        return 0;
+}
+
 _public_ int sd_journal_enumerate_available_data(sd_journal *j, const void **data, size_t *size) {
         for (;;) {
                 int r;
@@ -2624,7 +3107,14 @@ static void process_inotify_event(sd_journal *j, const struct inotify_event *e)
 
                         /* Event for a journal file */
 
-                        if (e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB))
+                        if ((e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB)) == IN_MODIFY &&
+                            file_is_tracked(j, d->path, e->name))
+                                /* The file we already have open was written to. That doesn't change which
+                                 * inode the name refers to, hence there's no point in opening and checking
+                                 * it again: the new entries are picked up through the file we have open.
+                                 * Writers trigger this for every batch of entries they append. */
+                                ;
+                        else if (e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB))
                                 (void) add_file_by_name(j, d->path, e->name);
                         else if (e->mask & (IN_DELETE|IN_MOVED_FROM|IN_UNMOUNT))
                                 remove_file_by_name(j, d->path, e->name);
@@ -3195,31 +3685,35 @@ _public_ int sd_journal_reliable_fd(sd_journal *j) {
         return !j->on_network;
 }
 
-static char *lookup_field(const char *field, void *userdata) {
+static int lookup_field(const char *field, const void **ret_data, size_t *ret_size, void *userdata) {
         sd_journal *j = userdata;
         const void *data;
         size_t size, d;
         int r;
 
         assert(field);
+        assert(ret_data);
+        assert(ret_size);
         assert(j);
 
         r = sd_journal_get_data(j, field, &data, &size);
         if (r < 0 ||
             size > REPLACE_VAR_MAX)
-                return strdup(field);
+                return 0;
 
         d = strlen(field) + 1;
 
-        return strndup((const char*) data + d, size - d);
+        *ret_data = (const char*) data + d;
+        *ret_size = size - d;
+        return 1;
 }
 
 _public_ int sd_journal_get_catalog(sd_journal *j, char **ret) {
+        const CatalogTemplate *template;
         const void *data;
         size_t size;
         sd_id128_t id;
-        _cleanup_free_ char *text = NULL, *cid = NULL;
-        char *t;
+        char cid[SD_ID128_STRING_MAX + 4], *t;
         int r;
 
         assert_return(j, -EINVAL);
@@ -3230,19 +3724,22 @@ _public_ int sd_journal_get_catalog(sd_journal *j, char **ret) {
         if (r < 0)
                 return r;
 
-        cid = strndup((const char*) data + 11, size - 11);
-        if (!cid)
-                return -ENOMEM;
+        /* Large enough for the UUID formatted variant too */
+        if (size - 11 >= sizeof(cid))
+                return -EINVAL;
+
+        memcpy(cid, (const char*) data + 11, size - 11);
+        cid[size - 11] = 0;
 
         r = sd_id128_from_string(cid, &id);
         if (r < 0)
                 return r;
 
-        r = catalog_get(CATALOG_DATABASE, id, &text);
+        r = catalog_get_template(CATALOG_DATABASE, id, &template);
         if (r < 0)
                 return r;
 
-        t = replace_var(text, lookup_field, j);
+        t = catalog_template_format(template, lookup_field, j);
         if (!t)
                 return -ENOMEM;
 
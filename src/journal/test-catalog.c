@@ -10,10 +10,12 @@
 #include "alloc-util.h"
 #include "catalog.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "log.h"
 #include "macro.h"
 #include "path-util.h"
+#include "rm-rf.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -169,6 +171,61 @@ static void test_catalog_update(const char *database) {
         assert_se(r == 0);
 }
 
+static int test_lookup(const char *variable, const void **ret_data, size_t *ret_size, void *userdata) {
+        const char *v;
+
+        v = streq(variable, "UNIT") ? "foo.service" : streq(variable, "RESULT") ? "done" : NULL;
+        if (!v)
+                return 0;
+
+        *ret_data = v;
+        *ret_size = strlen(v);
+        return 1;
+}
+
+static void test_catalog_template(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *d = NULL;
+        _cleanup_free_ char *db = NULL, *f = NULL, *text = NULL, *formatted = NULL;
+        const CatalogTemplate *t, *t2;
+        const char *input =
+"-- 0027229ca0644181a76c4e92458afaff\n" \
+"Subject: @UNIT@ is @RESULT@\n" \
+"\n" \
+"user@example.com @ @lower@ @MISSING@ @@ @UNIT@@\n";
+
+        assert_se(mkdtemp_malloc("/tmp/test-catalog-template-XXXXXX", &d) >= 0);
+        assert_se(f = path_join(d, "test.catalog"));
+        assert_se(db = path_join(d, "database"));
+        assert_se(write_string_file(f, input, WRITE_STRING_FILE_CREATE) >= 0);
+        assert_se(catalog_update(db, NULL, (const char* const*) STRV_MAKE(d)) >= 0);
+
+        assert_se(catalog_get_template(db, SD_ID128_MAKE(00,27,22,9c,a0,64,41,81,a7,6c,4e,92,45,8a,fa,ff), &t) >= 0);
+        assert_se(catalog_get_template(db, SD_ID128_MAKE(00,27,22,9c,a0,64,41,81,a7,6c,4e,92,45,8a,fa,ff), &t2) >= 0);
+        assert_se(t == t2);
+
+        assert_se(formatted = catalog_template_format(t, test_lookup, NULL));
+        assert_se(catalog_get(db, SD_ID128_MAKE(00,27,22,9c,a0,64,41,81,a7,6c,4e,92,45,8a,fa,ff), &text) >= 0);
+
+        /* Must match what replace_var() produces */
+        assert_se(streq(formatted,
+                        "Subject: foo.service is done\n"
+                        "\n"
+                        "user@example.com @ @lower@ MISSING @@ foo.service@\n"));
+        assert_se(streq(text,
+                        "Subject: @UNIT@ is @RESULT@\n"
+                        "\n"
+                        "user@example.com @ @lower@ @MISSING@ @@ @UNIT@@\n"));
+
+        /* Negative lookups are cached, and still fail */
+        assert_se(catalog_get_template(db, SD_MESSAGE_COREDUMP, &t) == -ENOENT);
+        assert_se(catalog_get_template(db, SD_MESSAGE_COREDUMP, &t) == -ENOENT);
+
+        /* After releasing the cache, the database is mapped again on demand */
+        catalog_cache_flush();
+        assert_se(catalog_get_template(db, SD_ID128_MAKE(00,27,22,9c,a0,64,41,81,a7,6c,4e,92,45,8a,fa,ff), &t) >= 0);
+        catalog_cache_flush();
+}
+
 static void test_catalog_file_lang(void) {
         _cleanup_free_ char *lang = NULL, *lang2 = NULL, *lang3 = NULL, *lang4 = NULL;
 
@@ -220,6 +277,7 @@ int main(int argc, char *argv[]) {
         test_catalog_import_one();
         test_catalog_import_merge();
         test_catalog_import_merge_no_body();
+        test_catalog_template();
 
         assert_se(mkostemp_safe(database) >= 0);
 
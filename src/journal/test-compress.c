@@ -266,6 +266,67 @@ static void test_lz4_decompress_partial(void) {
 }
 #endif
 
+#if HAVE_ZSTD
+static void test_zstd_dictionary(void) {
+        _cleanup_(compress_dictionary_freep) CompressDictionary *d = NULL;
+        _cleanup_free_ size_t *sizes = NULL;
+        _cleanup_free_ char *samples = NULL, *buf = NULL;
+        _cleanup_free_ void *dict = NULL;
+        size_t n = 0, dict_size, csize, csize_plain, usize = 0, buf_size = 0;
+        char compressed[512], compressed_plain[512], msg[256];
+        const size_t n_samples = 2000;
+        int r;
+
+        log_info("/* testing ZSTD dictionary compression */");
+
+        assert_se(sizes = new(size_t, n_samples));
+        assert_se(samples = malloc(n_samples * sizeof(msg)));
+
+        for (size_t i = 0; i < n_samples; i++) {
+                r = snprintf(msg, sizeof(msg), "MESSAGE=pam_unix(sshd:session): session opened for user u%zu(uid=%zu) by (uid=0), pid %"PRIu64,
+                             i % 37, 1000 + i % 37, random_u64() % 100000);
+                assert_se(r > 0 && (size_t) r < sizeof(msg));
+                sizes[i] = r;
+                memcpy(samples + n, msg, sizes[i]);
+                n += sizes[i];
+        }
+
+        r = compress_dictionary_train(samples, sizes, n_samples, 4096, &dict, &dict_size);
+        if (r < 0) {
+                log_info_errno(r, "Failed to train dictionary, skipping test: %m");
+                return;
+        }
+
+        assert_se(compress_dictionary_new(dict, dict_size, &d) >= 0);
+        assert_se(compress_dictionary_id(d) != 0);
+
+        /* Too few samples */
+        assert_se(compress_dictionary_train(samples, sizes, 3, 4096, &dict, &dict_size) == -ENODATA);
+
+        strcpy(msg, "MESSAGE=pam_unix(sshd:session): session opened for user u12(uid=1012) by (uid=0), pid 4711");
+
+        assert_se(compress_blob_zstd_dict(d, msg, strlen(msg), compressed, sizeof(compressed), &csize) >= 0);
+        assert_se(compress_blob_zstd(msg, strlen(msg), compressed_plain, sizeof(compressed_plain), &csize_plain) >= 0);
+        log_info("Compressed %zu bytes to %zu with dictionary, %zu without", strlen(msg), csize, csize_plain);
+        assert_se(csize < csize_plain);
+
+        /* Needs the dictionary */
+        assert_se(decompress_blob_zstd(compressed, csize, (void**) &buf, &buf_size, &usize, 0) == -ENOKEY);
+
+        assert_se(decompress_blob_zstd_dict(d, compressed, csize, (void**) &buf, &buf_size, &usize, 0) >= 0);
+        assert_se(usize == strlen(msg));
+        assert_se(memcmp(buf, msg, usize) == 0);
+
+        assert_se(decompress_startswith_zstd_dict(d, compressed, csize, (void**) &buf, &buf_size,
+                                                  "MESSAGE", STRLEN("MESSAGE"), '=') > 0);
+
+        /* Frames without a dictionary ID still work with a dictionary around */
+        assert_se(decompress_blob_zstd_dict(d, compressed_plain, csize_plain, (void**) &buf, &buf_size, &usize, 0) >= 0);
+        assert_se(usize == strlen(msg));
+        assert_se(memcmp(buf, msg, usize) == 0);
+}
+#endif
+
 int main(int argc, char *argv[]) {
 #if HAVE_COMPRESSION
         _unused_ const char text[] =
@@ -360,6 +421,8 @@ int main(int argc, char *argv[]) {
                              compress_stream_zstd, decompress_stream_zstd, srcfile);
 
         test_decompress_startswith_short("ZSTD", compress_blob_zstd, decompress_startswith_zstd);
+
+        test_zstd_dictionary();
 #else
         log_info("/* ZSTD test skipped */");
 #endif
@@ -0,0 +1,301 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "chattr-util.h"
+#include "io-util.h"
+#include "journal-file.h"
+#include "log.h"
+#include "parse-util.h"
+#include "process-util.h"
+#include "rm-rf.h"
+#include "sort-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* End-to-end benchmark of the journal write and read paths: appends entries with a field distribution
+ * resembling a real system journal to a set of files through journal_file_append_entry(), and then runs
+ * seek, match and iteration workloads over them through sd_journal. */
+
+#define N_FILES 4
+#define N_UNITS 24
+#define MAX_ENTRIES (4U*1024U*1024U)
+
+static usec_t arg_duration;
+static uint64_t arg_seed;
+static bool arg_keep = false;
+
+static uint64_t next_random(void) {
+        /* xorshift64*, cheap and reproducible, so that every run sees the same data for a given seed */
+        arg_seed ^= arg_seed >> 12;
+        arg_seed ^= arg_seed << 25;
+        arg_seed ^= arg_seed >> 27;
+        return arg_seed * UINT64_C(2685821657736338717);
+}
+
+static unsigned pick_unit(void) {
+        unsigned u = 0;
+
+        /* Skewed towards the first few units: a handful of services produce most of the log traffic */
+        while (u < N_UNITS - 1 && next_random() % 3 == 0)
+                u++;
+
+        return u;
+}
+
+static int cmp_usec(const usec_t *a, const usec_t *b) {
+        return CMP(*a, *b);
+}
+
+static void log_latencies(const char *label, usec_t *l, size_t n, usec_t total) {
+        assert(l);
+
+        if (n == 0) {
+                log_info("%s: no operations", label);
+                return;
+        }
+
+        typesafe_qsort(l, n, cmp_usec);
+
+        log_info("%s: %zu ops in %.2fs (%.0f ops/s), p50 %" PRIu64 "us, p99 %" PRIu64 "us, max %" PRIu64 "us",
+                 label, n, (double) total / USEC_PER_SEC,
+                 n / ((double) MAX(total, 1U) / USEC_PER_SEC),
+                 l[n / 2], l[(n - 1) * 99 / 100], l[n - 1]);
+}
+
+static void test_append(const char *dn, uint64_t *ret_first, uint64_t *ret_last) {
+        JournalFile *f[N_FILES] = {};
+        _cleanup_free_ usec_t *latencies = NULL;
+        size_t allocated = 0, n = 0, i;
+        uint64_t size = 0, bytes = 0;
+        dual_timestamp ts;
+        sd_id128_t boot_id;
+        usec_t start, end;
+
+        for (i = 0; i < N_FILES; i++) {
+                char fn[STRLEN("/bench-.journal") + DECIMAL_STR_MAX(size_t)];
+                _cleanup_free_ char *p = NULL;
+
+                xsprintf(fn, "/bench-%zu.journal", i);
+                assert_se(p = strjoin(dn, fn));
+                assert_se(journal_file_open(-1, p, O_RDWR|O_CREAT, 0644, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f[i]) >= 0);
+        }
+
+        assert_se(sd_id128_randomize(&boot_id) >= 0);
+        dual_timestamp_get(&ts);
+        *ret_first = ts.realtime;
+
+        start = now(CLOCK_MONOTONIC);
+        for (end = start; n < MAX_ENTRIES && end - start < arg_duration; n++) {
+                char message[LINE_MAX], unit[STRLEN("_SYSTEMD_UNIT=unit-.service") + DECIMAL_STR_MAX(unsigned)],
+                        comm[STRLEN("_COMM=unit-") + DECIMAL_STR_MAX(unsigned)],
+                        pid[STRLEN("_PID=") + DECIMAL_STR_MAX(unsigned)],
+                        priority[STRLEN("PRIORITY=") + DECIMAL_STR_MAX(int)],
+                        line[STRLEN("CODE_LINE=") + DECIMAL_STR_MAX(unsigned)];
+                struct iovec iovec[10];
+                unsigned u, k = 0;
+                uint64_t r;
+                usec_t t;
+
+                r = next_random();
+                u = pick_unit();
+
+                /* Mostly informational messages, with a few warnings and errors and the occasional debug burst */
+                xsprintf(priority, "PRIORITY=%i", r % 100 < 80 ? 6 : r % 100 < 90 ? 5 : r % 100 < 97 ? 4 : r % 100 < 99 ? 3 : 7);
+                xsprintf(unit, "_SYSTEMD_UNIT=unit-%u.service", u);
+                xsprintf(comm, "_COMM=unit-%u", u);
+                xsprintf(pid, "_PID=%u", 1000 + u * 7 + (unsigned) (r >> 32) % 3);
+                xsprintf(line, "CODE_LINE=%u", (unsigned) (r >> 16) % 2000);
+
+                /* Messages repeat a few formats with varying numbers, with occasional long ones */
+                if (r % 16 == 0)
+                        (void) snprintf(message, sizeof message,
+                                        "MESSAGE=Request %" PRIu64 " from client %u failed after %u retries: %.*s",
+                                        r >> 20, (unsigned) (r >> 8) % 512, (unsigned) r % 5,
+                                        (int) ((r >> 40) % 400),
+                                        "Connection reset by peer while reading the response body from the upstream server, "
+                                        "the request will be retried with exponential backoff until the deadline is reached; "
+                                        "payload follows: 0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef "
+                                        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+                else
+                        (void) snprintf(message, sizeof message,
+                                        "MESSAGE=Processed %u items in %u.%03us",
+                                        (unsigned) (r >> 24) % 10000, (unsigned) (r >> 12) % 10, (unsigned) r % 1000);
+
+                iovec[k++] = IOVEC_MAKE_STRING(message);
+                iovec[k++] = IOVEC_MAKE_STRING(priority);
+                iovec[k++] = IOVEC_MAKE_STRING(unit);
+                iovec[k++] = IOVEC_MAKE_STRING(comm);
+                iovec[k++] = IOVEC_MAKE_STRING(pid);
+                iovec[k++] = IOVEC_MAKE_STRING("_UID=0");
+                iovec[k++] = IOVEC_MAKE_STRING("_HOSTNAME=benchmark");
+                iovec[k++] = IOVEC_MAKE_STRING("_TRANSPORT=journal");
+                iovec[k++] = IOVEC_MAKE_STRING(line);
+                if (r % 64 == 0)
+                        iovec[k++] = IOVEC_MAKE_STRING("MESSAGE_ID=fc2e22bc6ee647b6b90729ab34a250b1");
+
+                ts.realtime++;
+                ts.monotonic++;
+
+                assert_se(GREEDY_REALLOC(latencies, allocated, n + 1));
+
+                t = now(CLOCK_MONOTONIC);
+                assert_se(journal_file_append_entry(f[n % N_FILES], &ts, &boot_id, iovec, k, NULL, NULL, NULL) >= 0);
+                end = now(CLOCK_MONOTONIC);
+
+                latencies[n] = end - t;
+                for (i = 0; i < k; i++)
+                        bytes += iovec[i].iov_len;
+        }
+
+        *ret_last = ts.realtime;
+
+        for (i = 0; i < N_FILES; i++) {
+                struct stat st;
+
+                assert_se(fstat(f[i]->fd, &st) >= 0);
+                size += st.st_blocks * 512;
+
+                (void) journal_file_close(f[i]);
+        }
+
+        log_latencies("append", latencies, n, end - start);
+        log_info("append: %zu entries, %" PRIu64 " payload bytes/entry, %" PRIu64 " file bytes/entry",
+                 n, bytes / MAX(n, 1U), size / MAX(n, 1U));
+}
+
+static void test_iterate(const char *dn, bool backwards) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        usec_t start, end;
+        size_t n = 0;
+        int r;
+
+        assert_se(sd_journal_open_directory(&j, dn, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        if (backwards)
+                assert_se(sd_journal_seek_tail(j) >= 0);
+
+        for (;;) {
+                r = backwards ? sd_journal_previous(j) : sd_journal_next(j);
+                assert_se(r >= 0);
+                if (r == 0)
+                        break;
+                n++;
+        }
+        end = now(CLOCK_MONOTONIC);
+
+        log_info("iterate%s: %zu entries in %.2fs (%.0f entries/s)",
+                 backwards ? " backwards" : "", n, (double) (end - start) / USEC_PER_SEC,
+                 n / ((double) MAX(end - start, 1U) / USEC_PER_SEC));
+}
+
+static void test_match(const char *dn) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        usec_t start, end;
+        size_t n = 0, bytes = 0;
+        const void *data;
+        size_t size;
+        int r;
+
+        assert_se(sd_journal_open_directory(&j, dn, 0) >= 0);
+
+        /* A rarely logging unit OR'ed with warnings and worse for a busy one, and only read the message */
+        assert_se(sd_journal_add_match(j, "_SYSTEMD_UNIT=unit-5.service", 0) >= 0);
+        assert_se(sd_journal_add_disjunction(j) >= 0);
+        assert_se(sd_journal_add_match(j, "_SYSTEMD_UNIT=unit-0.service", 0) >= 0);
+        assert_se(sd_journal_add_match(j, "PRIORITY=4", 0) >= 0);
+        assert_se(sd_journal_add_match(j, "PRIORITY=3", 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        SD_JOURNAL_FOREACH(j) {
+                r = sd_journal_get_data(j, "MESSAGE", &data, &size);
+                assert_se(r >= 0);
+                bytes += size;
+                n++;
+        }
+        end = now(CLOCK_MONOTONIC);
+
+        log_info("match: %zu entries (%zu message bytes) in %.2fs (%.0f entries/s)",
+                 n, bytes, (double) (end - start) / USEC_PER_SEC,
+                 n / ((double) MAX(end - start, 1U) / USEC_PER_SEC));
+}
+
+static void test_seek(const char *dn, uint64_t first, uint64_t last) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_free_ usec_t *latencies = NULL;
+        size_t allocated = 0, n = 0;
+        usec_t start, end;
+
+        assert_se(sd_journal_open_directory(&j, dn, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        for (end = start; end - start < arg_duration; n++) {
+                uint64_t realtime;
+                usec_t t;
+
+                realtime = first + next_random() % MAX(last - first, UINT64_C(1));
+
+                assert_se(GREEDY_REALLOC(latencies, allocated, n + 1));
+
+                t = now(CLOCK_MONOTONIC);
+                assert_se(sd_journal_seek_realtime_usec(j, realtime) >= 0);
+                assert_se(sd_journal_next(j) >= 0);
+                end = now(CLOCK_MONOTONIC);
+
+                latencies[n] = end - t;
+        }
+
+        log_latencies("seek", latencies, n, end - start);
+}
+
+int main(int argc, char *argv[]) {
+        char dn[] = "/var/tmp/test-journal-benchmark.XXXXXX";
+        uint64_t first, last;
+
+        test_setup_logging(LOG_INFO);
+
+        /* Usage: test-journal-benchmark [SECONDS [SEED]]. Each timed phase runs for SECONDS. */
+        if (argc >= 2) {
+                unsigned x;
+
+                assert_se(safe_atou(argv[1], &x) >= 0);
+                arg_duration = x * USEC_PER_SEC;
+        } else
+                arg_duration = slow_tests_enabled() ?
+                        2 * USEC_PER_SEC : USEC_PER_SEC / 50;
+
+        if (argc >= 3)
+                assert_se(safe_atou64(argv[2], &arg_seed) >= 0);
+        else
+                arg_seed = getpid_cached();
+        if (arg_seed == 0)
+                arg_seed = 1;
+
+        arg_keep = argc >= 4 && streq(argv[3], "--keep");
+
+        log_info("seed %" PRIu64 ", %.2fs per phase", arg_seed, (double) arg_duration / USEC_PER_SEC);
+
+        assert_se(mkdtemp(dn));
+        (void) chattr_path(dn, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
+
+        test_append(dn, &first, &last);
+        test_iterate(dn, false);
+        test_iterate(dn, true);
+        test_match(dn);
+        test_seek(dn, first, last);
+
+        if (arg_keep)
+                log_info("Not removing %s", dn);
+        else
+                assert_se(rm_rf(dn, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        return 0;
+}
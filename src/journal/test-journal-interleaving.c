@@ -13,6 +13,7 @@
 #include "log.h"
 #include "parse-util.h"
 #include "rm-rf.h"
+#include "stdio-util.h"
 #include "tests.h"
 #include "util.h"
 
@@ -131,6 +132,26 @@ static void setup_interleaved(void) {
         test_close(two);
 }
 
+static void setup_many(void) {
+        JournalFile *f[5];
+        unsigned i;
+
+        /* Spread the entries over more files than there are in the other setups, in an irregular pattern,
+         * so that picking the next entry takes more than a simple comparison between two files. */
+        for (i = 0; i < ELEMENTSOF(f); i++) {
+                char name[STRLEN("many-.journal") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(name, "many-%u.journal", i);
+                f[i] = test_open(name);
+        }
+
+        for (i = 1; i <= 16; i++)
+                append_number(f[(i * 3 + i / 4) % ELEMENTSOF(f)], i, NULL);
+
+        for (i = 0; i < ELEMENTSOF(f); i++)
+                test_close(f[i]);
+}
+
 static void mkdtemp_chdir_chattr(char *path) {
         assert_se(mkdtemp(path));
         assert_se(chdir(path) >= 0);
@@ -140,7 +161,7 @@ static void mkdtemp_chdir_chattr(char *path) {
         (void) chattr_path(path, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
 }
 
-static void test_skip(void (*setup)(void)) {
+static void test_skip(void (*setup)(void), int n) {
         char t[] = "/var/tmp/journal-skip-XXXXXX";
         sd_journal *j;
         int r;
@@ -154,7 +175,7 @@ static void test_skip(void (*setup)(void)) {
         assert_ret(sd_journal_open_directory(&j, t, 0));
         assert_ret(sd_journal_seek_head(j));
         assert_ret(sd_journal_next(j));
-        test_check_numbers_down(j, 4);
+        test_check_numbers_down(j, n);
         sd_journal_close(j);
 
         /* Seek to tail, iterate up.
@@ -162,25 +183,25 @@ static void test_skip(void (*setup)(void)) {
         assert_ret(sd_journal_open_directory(&j, t, 0));
         assert_ret(sd_journal_seek_tail(j));
         assert_ret(sd_journal_previous(j));
-        test_check_numbers_up(j, 4);
+        test_check_numbers_up(j, n);
         sd_journal_close(j);
 
         /* Seek to tail, skip to head, iterate down.
          */
         assert_ret(sd_journal_open_directory(&j, t, 0));
         assert_ret(sd_journal_seek_tail(j));
-        assert_ret(r = sd_journal_previous_skip(j, 4));
-        assert_se(r == 4);
-        test_check_numbers_down(j, 4);
+        assert_ret(r = sd_journal_previous_skip(j, n));
+        assert_se(r == n);
+        test_check_numbers_down(j, n);
         sd_journal_close(j);
 
         /* Seek to head, skip to tail, iterate up.
          */
         assert_ret(sd_journal_open_directory(&j, t, 0));
         assert_ret(sd_journal_seek_head(j));
-        assert_ret(r = sd_journal_next_skip(j, 4));
-        assert_se(r == 4);
-        test_check_numbers_up(j, 4);
+        assert_ret(r = sd_journal_next_skip(j, n));
+        assert_se(r == n);
+        test_check_numbers_up(j, n);
         sd_journal_close(j);
 
         log_info("Done...");
@@ -287,8 +308,9 @@ int main(int argc, char *argv[]) {
 
         arg_keep = argc > 1;
 
-        test_skip(setup_sequential);
-        test_skip(setup_interleaved);
+        test_skip(setup_sequential, 4);
+        test_skip(setup_interleaved, 4);
+        test_skip(setup_many, 16);
 
         test_sequence_numbers();
 
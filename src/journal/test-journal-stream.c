@@ -13,6 +13,9 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "rm-rf.h"
+#include "set.h"
+#include "string-util.h"
+#include "strv.h"
 #include "tests.h"
 #include "util.h"
 
@@ -63,6 +66,7 @@ static void run_test(void) {
         char t[] = "/var/tmp/journal-stream-XXXXXX";
         unsigned i;
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_set_free_free_ Set *fields = NULL;
         char *z;
         const void *data;
         size_t l;
@@ -144,6 +148,36 @@ static void run_test(void) {
 
         verify_contents(j, 1);
 
+        assert_se(set_put_strdup(&fields, "NUMBER") >= 0);
+        SD_JOURNAL_FOREACH(j) {
+                unsigned n = 0;
+                int r;
+
+                JOURNAL_FOREACH_DATA_FILTERED_RETVAL(j, fields, data, l, r) {
+                        assert_se(memory_startswith(data, l, "NUMBER="));
+                        n++;
+                }
+                assert_se(r == 0);
+                assert_se(n == 1);
+        }
+
+        assert_se(sd_journal_set_data_fields(j, (const char**) STRV_MAKE("MAGIC", "NUMBER")) >= 0);
+        assert_se(sd_journal_set_data_fields(j, (const char**) STRV_MAKE("MAGIC", "number")) == -EINVAL);
+        SD_JOURNAL_FOREACH(j) {
+                bool magic = false, number = false;
+
+                SD_JOURNAL_FOREACH_DATA(j, data, l) {
+                        if (memory_startswith(data, l, "MAGIC="))
+                                magic = true;
+                        else {
+                                assert_se(memory_startswith(data, l, "NUMBER="));
+                                number = true;
+                        }
+                }
+                assert_se(magic && number);
+        }
+        assert_se(sd_journal_set_data_fields(j, NULL) >= 0);
+
         printf("NEXT TEST\n");
         assert_se(sd_journal_add_match(j, "MAGIC=quux", 0) >= 0);
 
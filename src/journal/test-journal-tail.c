@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "io-util.h"
+#include "journal-tail.h"
+#include "macro.h"
+#include "memory-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static void append(JournalTail *t, sd_id128_t seqnum_id, uint64_t seqnum, const char *message) {
+        _cleanup_free_ char *m = NULL;
+        struct iovec iovec[3];
+        int r;
+
+        assert_se(m = strjoin("MESSAGE=", message));
+
+        iovec[0] = IOVEC_MAKE_STRING(m);
+        iovec[1] = IOVEC_MAKE_STRING("PRIORITY=6");
+        iovec[2] = IOVEC_MAKE_STRING("BINARY=with\nnewline");
+
+        r = journal_tail_append(t, &(JournalTailEntry) {
+                .seqnum_id = seqnum_id,
+                .seqnum = seqnum,
+                .realtime = seqnum * 1000,
+                .monotonic = seqnum * 10,
+                .xor_hash = seqnum ^ 0xdead,
+                .fields = iovec,
+                .n_fields = ELEMENTSOF(iovec),
+        });
+        assert_se(r == 1);
+}
+
+static void check(const JournalTailEntry *e, sd_id128_t seqnum_id, uint64_t seqnum, const char *message) {
+        const char *m;
+
+        assert_se(sd_id128_equal(e->seqnum_id, seqnum_id));
+        assert_se(e->seqnum == seqnum);
+        assert_se(e->realtime == seqnum * 1000);
+        assert_se(e->monotonic == seqnum * 10);
+        assert_se(e->xor_hash == (seqnum ^ 0xdead));
+        assert_se(e->n_fields == 3);
+
+        m = strjoina("MESSAGE=", message);
+        assert_se(memcmp_nn(e->fields[0].iov_base, e->fields[0].iov_len, m, strlen(m)) == 0);
+        assert_se(memcmp_nn(e->fields[1].iov_base, e->fields[1].iov_len, "PRIORITY=6", 10) == 0);
+        assert_se(memcmp_nn(e->fields[2].iov_base, e->fields[2].iov_len, "BINARY=with\nnewline", 19) == 0);
+}
+
+static void test_tail(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *d = NULL;
+        _cleanup_(journal_tail_closep) JournalTail *w = NULL, *r = NULL;
+        const JournalTailEntry *e;
+        _cleanup_free_ char *large = NULL;
+        sd_id128_t id, other;
+        const char *fn;
+        uint64_t i;
+
+        assert_se(mkdtemp_malloc("/tmp/test-journal-tail-XXXXXX", &d) >= 0);
+        fn = strjoina(d, "/" JOURNAL_TAIL_FILE);
+
+        assert_se(sd_id128_randomize(&id) >= 0);
+        assert_se(sd_id128_randomize(&other) >= 0);
+
+        assert_se(journal_tail_open(fn, &r) == -ENOENT);
+
+        /* Sizes below the minimum are bumped up */
+        assert_se(journal_tail_create(fn, 1, &w) >= 0);
+        assert_se(journal_tail_open(fn, &r) >= 0);
+        assert_se(!journal_tail_is_stale(r));
+
+        assert_se(journal_tail_find_next(r, id, 0, &e) == -ENOENT);
+
+        append(w, id, 1, "one");
+        append(w, id, 2, "two");
+
+        assert_se(journal_tail_find_next(r, id, 0, &e) == 1);
+        check(e, id, 1, "one");
+        assert_se(journal_tail_find_next(r, id, 1, &e) == 1);
+        check(e, id, 2, "two");
+        /* 2 is the newest entry, while the entries of another journald just aren't there */
+        assert_se(journal_tail_find_next(r, id, 2, &e) == 0);
+        assert_se(journal_tail_find_next(r, other, 0, &e) == -ENOENT);
+
+        /* The last entry we returned stays valid when we don't find the next one */
+        check(e, id, 2, "two");
+
+        append(w, id, 3, "three");
+        assert_se(journal_tail_find_next(r, id, 2, &e) == 1);
+        check(e, id, 3, "three");
+
+        /* Entries that don't fit are left out, and readers need to notice the gap, even before the next
+         * entry is added */
+        assert_se(large = malloc(64 * 1024));
+        memset(large, 'x', 64 * 1024 - 1);
+        large[64 * 1024 - 1] = 0;
+        assert_se(journal_tail_append(w, &(JournalTailEntry) {
+                .seqnum_id = id,
+                .seqnum = 4,
+                .fields = &IOVEC_MAKE_STRING(large),
+                .n_fields = 1,
+        }) == 0);
+        assert_se(journal_tail_find_next(r, id, 3, &e) == -ENOENT);
+        assert_se(journal_tail_find_next(r, id, 4, &e) == 0);
+        append(w, id, 5, "five");
+        assert_se(journal_tail_find_next(r, id, 3, &e) == -ENOENT);
+        assert_se(journal_tail_find_next(r, id, 4, &e) == 1);
+        check(e, id, 5, "five");
+
+        /* Go around the ring a couple of times, the oldest entries are gone then */
+        for (i = 6; i < 10000; i++) {
+                char buf[DECIMAL_STR_MAX(uint64_t)];
+
+                xsprintf(buf, "%" PRIu64, i);
+                append(w, id, i, buf);
+
+                if (i % 7 == 0) {
+                        assert_se(journal_tail_find_next(r, id, i - 1, &e) == 1);
+                        check(e, id, i, buf);
+                }
+        }
+
+        assert_se(journal_tail_find_next(r, id, 1, &e) == -ENOENT);
+        assert_se(journal_tail_find_next(r, id, 9990, &e) == 1);
+        check(e, id, 9991, "9991");
+        for (i = 9991; i < 9999; i++)
+                assert_se(journal_tail_find_next(r, id, i, &e) == 1);
+        check(e, id, 9999, "9999");
+        assert_se(journal_tail_find_next(r, id, 9999, &e) == 0);
+
+        /* Readers notice when journald goes away */
+        w = journal_tail_close(w);
+        assert_se(journal_tail_is_stale(r));
+        assert_se(journal_tail_open(fn, &w) == -ESTALE);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_DEBUG);
+
+        test_tail();
+
+        return 0;
+}
@@ -51,6 +51,73 @@ static int raw_verify(const char *fn, const char *verification_key) {
         return r;
 }
 
+static void test_verify_threads(void) {
+        JournalMetrics metrics = {
+                /* Big enough hash table to verify it in several threads */
+                .max_size = 16 * 1024 * 1024,
+                .min_size = (uint64_t) -1,
+                .max_use = (uint64_t) -1,
+                .min_use = (uint64_t) -1,
+                .keep_free = (uint64_t) -1,
+                .n_max_files = (uint64_t) -1,
+        };
+        uint64_t offset, n_buckets, i;
+        HashItem item;
+        JournalFile *f;
+        unsigned n;
+        int fd;
+
+        log_info("Verifying in threads...");
+
+        assert_se(journal_file_open(-1, "threads.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, &metrics, NULL, NULL, NULL, &f) == 0);
+
+        for (n = 0; n < N_ENTRIES; n++) {
+                struct iovec iovec;
+                struct dual_timestamp ts;
+                char *test;
+
+                dual_timestamp_get(&ts);
+
+                assert_se(asprintf(&test, "NUMBER=%u", n));
+
+                iovec = IOVEC_MAKE_STRING(test);
+
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+
+                free(test);
+        }
+
+        offset = le64toh(f->header->data_hash_table_offset);
+        n_buckets = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
+        assert_se(n_buckets >= 4096 * 4);
+
+        (void) journal_file_close(f);
+
+        assert_se(journal_file_open(-1, "threads.journal", O_RDONLY, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+        assert_se(journal_file_verify_full(f, NULL, NULL, NULL, NULL, false, 1) >= 0);
+        assert_se(journal_file_verify_full(f, NULL, NULL, NULL, NULL, false, 4) >= 0);
+        (void) journal_file_close(f);
+
+        /* Make the last bucket point to a data object of another bucket, which only the last
+         * thread gets to see */
+        fd = open("threads.journal", O_RDWR|O_CLOEXEC);
+        assert_se(fd >= 0);
+        for (i = 0; i < n_buckets - 1; i++) {
+                assert_se(pread(fd, &item, sizeof(item), offset + i * sizeof(HashItem)) == sizeof(item));
+                if (item.head_hash_offset != 0)
+                        break;
+        }
+        assert_se(i < n_buckets - 1);
+        item.tail_hash_offset = item.head_hash_offset;
+        assert_se(pwrite(fd, &item, sizeof(item), offset + (n_buckets - 1) * sizeof(HashItem)) == sizeof(item));
+        safe_close(fd);
+
+        assert_se(journal_file_open(-1, "threads.journal", O_RDONLY, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+        assert_se(journal_file_verify_full(f, NULL, NULL, NULL, NULL, false, 1) == -EBADMSG);
+        assert_se(journal_file_verify_full(f, NULL, NULL, NULL, NULL, false, 4) == -EBADMSG);
+        (void) journal_file_close(f);
+}
+
 int main(int argc, char *argv[]) {
         char t[] = "/var/tmp/journal-XXXXXX";
         unsigned n;
@@ -128,6 +195,8 @@ int main(int argc, char *argv[]) {
                 }
         }
 
+        test_verify_threads();
+
         log_info("Exiting...");
 
         assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
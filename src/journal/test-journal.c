@@ -3,13 +3,20 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "alloc-util.h"
 #include "chattr-util.h"
+#include "dirent-util.h"
+#include "fd-util.h"
+#include "fileio.h"
 #include "io-util.h"
 #include "journal-authenticate.h"
 #include "journal-file.h"
 #include "journal-vacuum.h"
+#include "journal-verify.h"
 #include "log.h"
 #include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
 #include "tests.h"
 
 static bool arg_keep = false;
@@ -116,6 +123,294 @@ static void test_non_empty(void) {
         puts("------------------------------------------------------------");
 }
 
+static void test_append_entries(void) {
+        static const char test[] = "TEST1=1", test2[] = "TEST2=2", test3[] = "TEST3=3";
+        JournalEntryInput entries[3];
+        struct iovec iovec[3][2];
+        JournalFile *f, *g;
+        dual_timestamp ts;
+        Object *o, *q;
+        uint64_t p, r;
+        size_t n;
+        char t[] = "/var/tmp/journal-XXXXXX";
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-1, "batch.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+        assert_se(journal_file_open(-1, "single.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &g) == 0);
+
+        assert_se(dual_timestamp_get(&ts));
+
+        /* The first field is the same for all entries and hence should be shared */
+        for (unsigned i = 0; i < ELEMENTSOF(entries); i++) {
+                const char *v = i == 1 ? test3 : test2;
+
+                iovec[i][0] = IOVEC_MAKE_STRING(test);
+                iovec[i][1] = IOVEC_MAKE_STRING(v);
+                entries[i] = (JournalEntryInput) {
+                        .ts = ts,
+                        .iovec = iovec[i],
+                        .n_iovec = 2,
+                };
+
+                assert_se(journal_file_append_entry(g, &ts, NULL, iovec[i], 2, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(journal_file_append_entries(f, entries, ELEMENTSOF(entries), NULL, NULL, NULL, &n) == 0);
+        assert_se(n == ELEMENTSOF(entries));
+
+        journal_file_dump(f);
+
+        assert_se(le64toh(f->header->n_entries) == 3);
+        assert_se(le64toh(f->header->n_data) == 3);
+
+        /* Entries appended in a batch must be indistinguishable from ones appended one by one */
+        p = r = 0;
+        for (unsigned i = 0; i < ELEMENTSOF(entries); i++) {
+                assert_se(journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p) == 1);
+                assert_se(journal_file_next_entry(g, r, DIRECTION_DOWN, &q, &r) == 1);
+                assert_se(le64toh(o->entry.seqnum) == i + 1);
+                assert_se(o->entry.xor_hash == q->entry.xor_hash);
+                assert_se(journal_file_entry_n_items(o) == 2);
+        }
+        assert_se(journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p) == 0);
+
+        assert_se(journal_file_find_data_object(f, test, strlen(test), NULL, &p) == 1);
+        assert_se(journal_file_next_entry_for_data(f, NULL, 0, p, DIRECTION_UP, &o, NULL) == 1);
+        assert_se(le64toh(o->entry.seqnum) == 3);
+
+        assert_se(journal_file_find_data_object(f, test3, strlen(test3), NULL, &p) == 1);
+        assert_se(journal_file_next_entry_for_data(f, NULL, 0, p, DIRECTION_DOWN, &o, NULL) == 1);
+        assert_se(le64toh(o->entry.seqnum) == 2);
+
+        (void) journal_file_close(f);
+        (void) journal_file_close(g);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else {
+                journal_directory_vacuum(".", 3000000, 0, 0, NULL, true);
+
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+        }
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_bloom_filter(void) {
+        char t[] = "/var/tmp/journal-XXXXXX", buf[32];
+        unsigned n_positive = 0;
+        dual_timestamp ts;
+        struct iovec iovec;
+        JournalFile *f;
+        Object *o;
+        uint64_t p;
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-1, "bloom.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+
+        assert_se(dual_timestamp_get(&ts));
+
+        for (unsigned i = 0; i < 100; i++) {
+                xsprintf(buf, "NUMBER=%u", i);
+                iovec = IOVEC_MAKE_STRING(buf);
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(!JOURNAL_HEADER_BLOOM_FILTER(f->header));
+        assert_se(journal_file_archive(f) == 0);
+        assert_se(JOURNAL_HEADER_BLOOM_FILTER(f->header));
+        assert_se(le64toh(f->header->bloom_filter_offset) != 0);
+
+        journal_file_dump(f);
+
+        /* Everything that is in the file must be found */
+        for (unsigned i = 0; i < 100; i++) {
+                xsprintf(buf, "NUMBER=%u", i);
+                assert_se(journal_file_bloom_filter_test(f, journal_file_hash_data(f, buf, strlen(buf))) > 0);
+                assert_se(journal_file_find_data_object(f, buf, strlen(buf), &o, &p) == 1);
+        }
+
+        /* And most of what isn't should be filtered out */
+        for (unsigned i = 100; i < 1100; i++) {
+                xsprintf(buf, "NUMBER=%u", i);
+                if (journal_file_bloom_filter_test(f, journal_file_hash_data(f, buf, strlen(buf))) > 0)
+                        n_positive++;
+                assert_se(journal_file_find_data_object(f, buf, strlen(buf), &o, &p) == 0);
+        }
+        log_info("Bloom filter false positives: %u/1000", n_positive);
+        assert_se(n_positive < 100);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else {
+                journal_directory_vacuum(".", 3000000, 0, 0, NULL, true);
+
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+        }
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_entry_index(void) {
+        char t[] = "/var/tmp/journal-XXXXXX";
+        dual_timestamp ts;
+        struct iovec iovec;
+        JournalFile *f;
+        Object *o;
+        uint64_t p;
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-1, "index.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+
+        assert_se(dual_timestamp_get(&ts));
+
+        /* Three entries share each timestamp, so that runs of equal timestamps cross strides */
+        iovec = IOVEC_MAKE_STRING("TEST=1");
+        for (unsigned i = 0; i < 1000; i++) {
+                dual_timestamp e = {
+                        .realtime = 1000000 + (i / 3) * 10,
+                        .monotonic = ts.monotonic + i,
+                };
+
+                assert_se(journal_file_append_entry(f, &e, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(journal_file_archive(f) == 0);
+        assert_se(JOURNAL_HEADER_ENTRY_INDEX(f->header));
+
+        for (uint64_t seqnum = 0; seqnum <= 1001; seqnum++) {
+                int r;
+
+                r = journal_file_move_to_entry_by_seqnum(f, seqnum, DIRECTION_DOWN, &o, &p);
+                assert_se(r == (seqnum <= 1000));
+                if (r > 0)
+                        assert_se(le64toh(o->entry.seqnum) == MAX(seqnum, 1u));
+
+                r = journal_file_move_to_entry_by_seqnum(f, seqnum, DIRECTION_UP, &o, &p);
+                assert_se(r == (seqnum >= 1));
+                if (r > 0)
+                        assert_se(le64toh(o->entry.seqnum) == MIN(seqnum, 1000u));
+        }
+
+        for (uint64_t realtime = 999995; realtime <= 1003340; realtime += 5) {
+                uint64_t first = 0, last = 0;
+                int r;
+
+                /* The first entry at or after the timestamp, and the last one at or before it */
+                for (unsigned i = 0; i < 1000; i++) {
+                        uint64_t rt = 1000000 + (i / 3) * 10;
+
+                        if (first == 0 && rt >= realtime)
+                                first = i + 1;
+                        if (rt <= realtime)
+                                last = i + 1;
+                }
+
+                r = journal_file_move_to_entry_by_realtime(f, realtime, DIRECTION_DOWN, &o, &p);
+                assert_se(r == (first > 0));
+                if (r > 0)
+                        assert_se(le64toh(o->entry.seqnum) == first);
+
+                r = journal_file_move_to_entry_by_realtime(f, realtime, DIRECTION_UP, &o, &p);
+                assert_se(r == (last > 0));
+                if (r > 0)
+                        assert_se(le64toh(o->entry.seqnum) == last);
+        }
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else {
+                journal_directory_vacuum(".", 3000000, 0, 0, NULL, true);
+
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+        }
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_vacuum_manifest(void) {
+        char t[] = "/var/tmp/journal-XXXXXX", *archived = NULL;
+        _cleanup_free_ char *manifest = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        uint64_t usage, expected = 0;
+        dual_timestamp ts;
+        struct iovec iovec;
+        struct dirent *de;
+        JournalFile *f;
+        unsigned n = 0;
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+
+        iovec = IOVEC_MAKE_STRING("TEST=1");
+        for (unsigned i = 0; i < 3; i++) {
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+                assert_se(journal_file_rotate(&f, true, (uint64_t) -1, true, NULL) >= 0);
+        }
+
+        /* Nothing to delete, but the manifest gets written */
+        assert_se(journal_directory_vacuum(".", UINT64_MAX, 0, 0, NULL, true) >= 0);
+        assert_se(read_full_file(".journal-manifest", &manifest, NULL) >= 0);
+
+        assert_se(d = opendir("."));
+        FOREACH_DIRENT(de, d, assert_not_reached("readdir failed")) {
+                struct stat st;
+
+                if (!endswith(de->d_name, ".journal"))
+                        continue;
+
+                assert_se(stat(de->d_name, &st) >= 0);
+                expected += (uint64_t) st.st_blocks * 512UL;
+
+                if (!streq(de->d_name, "test.journal")) {
+                        assert_se(strstr(manifest, de->d_name));
+                        if (!archived)
+                                assert_se(archived = strdupa(de->d_name));
+                        n++;
+                }
+        }
+        assert_se(n == 3);
+
+        rewinddir(d);
+        assert_se(journal_directory_usage(d, ".", &usage) >= 0);
+        assert_se(usage == expected);
+
+        /* A file that went away behind our back is dropped from the manifest */
+        assert_se(unlink(archived) >= 0);
+        assert_se(journal_directory_vacuum(".", UINT64_MAX, 0, 0, NULL, true) >= 0);
+        manifest = mfree(manifest);
+        assert_se(read_full_file(".journal-manifest", &manifest, NULL) >= 0);
+        assert_se(!strstr(manifest, archived));
+
+        /* Only the active file is left after this */
+        assert_se(journal_directory_vacuum(".", 0, 1, 0, NULL, true) >= 0);
+        manifest = mfree(manifest);
+        assert_se(read_full_file(".journal-manifest", &manifest, NULL) >= 0);
+        assert_se(!strchr(manifest, '@'));
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
 static void test_empty(void) {
         JournalFile *f1, *f2, *f3, *f4;
         char t[] = "/var/tmp/journal-XXXXXX";
@@ -250,6 +545,10 @@ int main(int argc, char *argv[]) {
                 return log_tests_skipped("/etc/machine-id not found");
 
         test_non_empty();
+        test_append_entries();
+        test_bloom_filter();
+        test_entry_index();
+        test_vacuum_manifest();
         test_empty();
 #if HAVE_COMPRESSION
         test_min_compress_size();
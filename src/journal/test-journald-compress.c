@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "sd-event.h"
+
+#include "io-util.h"
+#include "journald-compress.h"
+#include "journald-server.h"
+#include "tests.h"
+
+static void test_compress_threshold(uint64_t threshold_bytes, size_t size, int n_jobs) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_free_ char *payload = NULL;
+        struct iovec iovec[2];
+        dual_timestamp ts;
+        Server s;
+
+        log_info("/* %s(%" PRIu64 ", %zu) */", __func__, threshold_bytes, size);
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        /* Nothing is ever written with STORAGE_NONE, hence we don't need any journal files */
+        s = (Server) {
+                .event = e,
+                .storage = STORAGE_NONE,
+                .compress.enabled = true,
+                .compress.threshold_bytes = threshold_bytes,
+                .compress_threads = 1,
+        };
+
+        assert_se(server_compress_workers_start(&s) >= 0);
+        if (!s.compress_workers) {
+                log_info("Compression support not compiled in, skipping.");
+                return;
+        }
+
+        assert_se(payload = malloc(size + 1));
+        memcpy(payload, "MESSAGE=", 8);
+        memset(payload + 8, 'x', size - 8);
+        payload[size] = 0;
+
+        iovec[0] = IOVEC_MAKE_STRING("PRIORITY=6");
+        iovec[1] = IOVEC_MAKE(payload, size);
+
+        assert_se(server_compress_wants_entry(&s, iovec, ELEMENTSOF(iovec)) == (n_jobs > 0));
+
+        if (n_jobs > 0) {
+                dual_timestamp_get(&ts);
+                assert_se(server_compress_queue_entry(&s, 0, &ts, iovec, ELEMENTSOF(iovec), LOG_INFO) == n_jobs);
+
+                /* Anything logged in the meantime has to queue up behind it */
+                assert_se(server_compress_wants_entry(&s, iovec, 1));
+        }
+
+        server_compress_workers_stop(&s);
+        assert_se(!s.compress_workers);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_DEBUG);
+
+        /* The default threshold, as with Compress=yes */
+        test_compress_threshold((uint64_t) -1, 1024, 1);
+        test_compress_threshold((uint64_t) -1, 64 * 1024, 1);
+        test_compress_threshold((uint64_t) -1, 100, 0);
+
+        /* Explicit thresholds. Journal files raise the one below the minimum to 8 bytes, which the
+         * 10 bytes of PRIORITY=6 are above too. */
+        test_compress_threshold(4096, 1024, 0);
+        test_compress_threshold(4096, 8192, 1);
+        test_compress_threshold(1, 16, 2);
+
+        return 0;
+}
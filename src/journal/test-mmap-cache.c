@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -8,16 +9,112 @@
 #include "fd-util.h"
 #include "macro.h"
 #include "mmap-cache.h"
+#include "random-util.h"
+#include "tests.h"
 #include "tmpfile-util.h"
+#include "unaligned.h"
 #include "util.h"
 
+#define SHARED_FILE_SIZE (4ULL*1024ULL*1024ULL)
+#define SHARED_N_THREADS 4
+
+static void* shared_thread(void *userdata) {
+        int fd = PTR_TO_FD(userdata);
+        MMapFileDescriptor *f;
+        struct stat st;
+        MMapCache *m;
+
+        assert_se(m = mmap_cache_new_shared());
+        assert_se(f = mmap_cache_add_fd(m, fd));
+        assert_se(fstat(fd, &st) >= 0);
+
+        for (unsigned i = 0; i < 1000; i++) {
+                uint64_t offset = (random_u64() % (SHARED_FILE_SIZE / 8)) * 8;
+                void *p;
+
+                assert_se(mmap_cache_get(m, f, PROT_READ, i % MMAP_CACHE_MAX_CONTEXTS, false, offset, 8, &st, &p, NULL) > 0);
+                assert_se(unaligned_read_le64(p) == offset);
+        }
+
+        mmap_cache_free_fd(m, f);
+        mmap_cache_unref(m);
+
+        return NULL;
+}
+
+static void test_shared(void) {
+        char path[] = "/tmp/testmmapsharedXXXXXX";
+        MMapFileDescriptor *fa, *fb;
+        pthread_t threads[SHARED_N_THREADS];
+        MMapCache *a, *b;
+        int fd, x, y;
+        struct stat st;
+        void *p, *q;
+
+        fd = mkostemp_safe(path);
+        assert_se(fd >= 0);
+
+        /* Write the offset of each 64bit word to the word itself */
+        for (uint64_t offset = 0; offset < SHARED_FILE_SIZE; offset += 8) {
+                uint8_t buf[8];
+
+                unaligned_write_le64(buf, offset);
+                assert_se(write(fd, buf, sizeof(buf)) == sizeof(buf));
+        }
+        safe_close(fd);
+
+        x = open(path, O_RDONLY|O_CLOEXEC);
+        assert_se(x >= 0);
+        y = open(path, O_RDONLY|O_CLOEXEC);
+        assert_se(y >= 0);
+        unlink(path);
+        assert_se(fstat(x, &st) >= 0);
+
+        assert_se(a = mmap_cache_new_shared());
+        assert_se(b = mmap_cache_new_shared());
+
+        /* Different fds referring to the same file share the descriptor and its windows */
+        assert_se(fa = mmap_cache_add_fd(a, x));
+        assert_se(fb = mmap_cache_add_fd(b, y));
+        assert_se(fa == fb);
+
+        assert_se(mmap_cache_get(a, fa, PROT_READ, 0, false, 4096, 8, &st, &p, NULL) > 0);
+        assert_se(mmap_cache_get(b, fb, PROT_READ, 0, false, 4096, 8, &st, &q, NULL) > 0);
+        assert_se(p == q);
+        assert_se(unaligned_read_le64(p) == 4096);
+
+        /* The descriptor stays usable after the fd it was added with is closed */
+        mmap_cache_free_fd(a, fa);
+        mmap_cache_unref(a);
+        safe_close(x);
+
+        assert_se(mmap_cache_get(b, fb, PROT_READ, 1, false, SHARED_FILE_SIZE - 8, 8, &st, &q, NULL) > 0);
+        assert_se(unaligned_read_le64(q) == SHARED_FILE_SIZE - 8);
+
+        /* Caches may be used from different threads at the same time */
+        for (unsigned i = 0; i < SHARED_N_THREADS; i++)
+                assert_se(pthread_create(threads + i, NULL, shared_thread, FD_TO_PTR(y)) == 0);
+        for (unsigned i = 0; i < SHARED_N_THREADS; i++)
+                assert_se(pthread_join(threads[i], NULL) == 0);
+
+        mmap_cache_stats_log_debug(b);
+
+        mmap_cache_free_fd(b, fb);
+        mmap_cache_unref(b);
+        safe_close(y);
+}
+
 int main(int argc, char *argv[]) {
-        MMapFileDescriptor *fx;
+        MMapFileDescriptor *fx, *fy;
+        size_t l, max_l = 0;
+        struct stat st;
         int x, y, z, r;
         char px[] = "/tmp/testmmapXXXXXXX", py[] = "/tmp/testmmapYXXXXXX", pz[] = "/tmp/testmmapZXXXXXX";
         MMapCache *m;
         void *p, *q;
 
+        test_setup_logging(LOG_DEBUG);
+
         assert_se(m = mmap_cache_new());
 
         x = mkostemp_safe(px);
@@ -55,6 +152,25 @@ int main(int argc, char *argv[]) {
 
         assert_se((uint8_t*) p + 1 == (uint8_t*) q);
 
+        /* Scan a sparse file sequentially, the windows should grow beyond the default size */
+        assert_se(ftruncate(y, 256ULL*1024ULL*1024ULL) >= 0);
+        assert_se(fy = mmap_cache_add_fd(m, y));
+        assert_se(fstat(y, &st) >= 0);
+
+        for (uint64_t offset = 0; offset < 256ULL*1024ULL*1024ULL; offset += 64ULL*1024ULL) {
+                r = mmap_cache_get(m, fy, PROT_READ, 2, false, offset, 2, &st, &p, &l);
+                assert_se(r >= 0);
+                assert_se(*(uint8_t*) p == 0);
+                max_l = MAX(max_l, l);
+        }
+
+#if !ENABLE_DEBUG_MMAP_CACHE
+        assert_se(max_l > 8ULL*1024ULL*1024ULL);
+#endif
+
+        mmap_cache_stats_log_debug(m);
+
+        mmap_cache_free_fd(m, fy);
         mmap_cache_free_fd(m, fx);
         mmap_cache_unref(m);
 
@@ -62,5 +178,7 @@ int main(int argc, char *argv[]) {
         safe_close(y);
         safe_close(z);
 
+        test_shared();
+
         return 0;
 }
@@ -65,6 +65,7 @@ struct sd_dhcp_server {
 
         Hashmap *leases_by_client_id;
         DHCPLease **bound_leases;
+        uint64_t *bound_leases_bitmap; /* one bit per pool address, set if bound_leases[] has an entry */
         DHCPLease invalid_lease;
 
         uint32_t max_lease_time, default_lease_time;
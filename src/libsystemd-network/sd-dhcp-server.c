@@ -30,6 +30,49 @@ static DHCPLease *dhcp_lease_free(DHCPLease *lease) {
         return mfree(lease);
 }
 
+static void server_set_bound_lease(sd_dhcp_server *server, uint32_t offset, DHCPLease *lease) {
+        assert(server);
+        assert(offset < server->pool_size);
+
+        server->bound_leases[offset] = lease;
+
+        if (lease)
+                server->bound_leases_bitmap[offset / 64] |= UINT64_C(1) << (offset % 64);
+        else
+                server->bound_leases_bitmap[offset / 64] &= ~(UINT64_C(1) << (offset % 64));
+}
+
+/* Returns the first free offset in the pool at or after start, wrapping around at the end of the pool */
+static int server_find_free_offset(sd_dhcp_server *server, uint32_t start) {
+        size_t i, n_words;
+        uint32_t word;
+
+        assert(server);
+        assert(start < server->pool_size);
+
+        n_words = DIV_ROUND_UP(server->pool_size, 64);
+        word = start / 64;
+
+        /* Visit the word containing start twice, first for the bits after start, finally for those before */
+        for (i = 0; i <= n_words; i++) {
+                uint64_t free_bits = ~server->bound_leases_bitmap[word];
+                uint32_t offset;
+
+                if (i == 0)
+                        free_bits &= UINT64_MAX << (start % 64);
+
+                if (free_bits != 0) {
+                        offset = word * 64 + __builtin_ctzll(free_bits);
+                        if (offset < server->pool_size)
+                                return offset;
+                }
+
+                word = (word + 1) % n_words;
+        }
+
+        return -ENOSPC;
+}
+
 /* configures the server's address and subnet, and optionally the pool's size and offset into the subnet
  * the whole pool must fit into the subnet, and may not contain the first (any) nor last (broadcast) address
  * moreover, the server's own address may be in the pool, and is in that case reserved in order not to
@@ -86,6 +129,11 @@ int sd_dhcp_server_configure_pool(
                 if (!server->bound_leases)
                         return -ENOMEM;
 
+                free(server->bound_leases_bitmap);
+                server->bound_leases_bitmap = new0(uint64_t, DIV_ROUND_UP(size, 64));
+                if (!server->bound_leases_bitmap)
+                        return -ENOMEM;
+
                 server->pool_offset = offset;
                 server->pool_size = size;
 
@@ -94,7 +142,7 @@ int sd_dhcp_server_configure_pool(
                 server->subnet = address->s_addr & netmask;
 
                 if (server_off >= offset && server_off - offset < size)
-                        server->bound_leases[server_off - offset] = &server->invalid_lease;
+                        server_set_bound_lease(server, server_off - offset, &server->invalid_lease);
 
                 /* Drop any leases associated with the old address range */
                 hashmap_clear(server->leases_by_client_id);
@@ -157,6 +205,7 @@ static sd_dhcp_server *dhcp_server_free(sd_dhcp_server *server) {
         ordered_hashmap_free(server->vendor_options);
 
         free(server->bound_leases);
+        free(server->bound_leases_bitmap);
         return mfree(server);
 }
 
@@ -705,6 +754,31 @@ static int get_pool_offset(sd_dhcp_server *server, be32_t requested_ip) {
         return be32toh(requested_ip & ~server->netmask) - server->pool_offset;
 }
 
+static void server_drop_expired_leases(sd_dhcp_server *server) {
+        DHCPLease *lease;
+        Iterator i;
+        usec_t time_now;
+
+        assert(server);
+
+        if (sd_event_now(server->event, clock_boottime_or_monotonic(), &time_now) < 0)
+                return;
+
+        HASHMAP_FOREACH(lease, server->leases_by_client_id, i) {
+                int pool_offset;
+
+                if (lease->expiration > time_now)
+                        continue;
+
+                pool_offset = get_pool_offset(server, lease->address);
+                if (pool_offset >= 0 && server->bound_leases[pool_offset] == lease)
+                        server_set_bound_lease(server, pool_offset, NULL);
+
+                hashmap_remove(server->leases_by_client_id, lease);
+                dhcp_lease_free(lease);
+        }
+}
+
 #define HASH_KEY SD_ID128_MAKE(0d,1d,fe,bd,f1,24,bd,b3,47,f1,dd,6e,73,21,93,30)
 
 int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
@@ -742,7 +816,6 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
 
         case DHCP_DISCOVER: {
                 be32_t address = INADDR_ANY;
-                unsigned i;
 
                 log_dhcp_server(server, "DISCOVER (0x%x)",
                                 be32toh(req->message->xid));
@@ -757,7 +830,6 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                 else {
                         struct siphash state;
                         uint64_t hash;
-                        uint32_t next_offer;
 
                         /* even with no persistence of leases, we try to offer the same client
                            the same IP address. we do this by using the hash of the client id
@@ -766,16 +838,15 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                         siphash24_init(&state, HASH_KEY.bytes);
                         client_id_hash_func(&req->client_id, &state);
                         hash = htole64(siphash24_finalize(&state));
-                        next_offer = hash % server->pool_size;
-
-                        for (i = 0; i < server->pool_size; i++) {
-                                if (!server->bound_leases[next_offer]) {
-                                        address = server->subnet | htobe32(server->pool_offset + next_offer);
-                                        break;
-                                }
 
-                                next_offer = (next_offer + 1) % server->pool_size;
+                        r = server_find_free_offset(server, hash % server->pool_size);
+                        if (r == -ENOSPC) {
+                                /* the pool is exhausted, make room by forgetting about leases that expired */
+                                server_drop_expired_leases(server);
+                                r = server_find_free_offset(server, hash % server->pool_size);
                         }
+                        if (r >= 0)
+                                address = server->subnet | htobe32(server->pool_offset + r);
                 }
 
                 if (address == INADDR_ANY)
@@ -898,7 +969,7 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                                 log_dhcp_server(server, "ACK (0x%x)",
                                                 be32toh(req->message->xid));
 
-                                server->bound_leases[pool_offset] = lease;
+                                server_set_bound_lease(server, pool_offset, lease);
                                 hashmap_put(server->leases_by_client_id,
                                             &lease->client_id, lease);
 
@@ -938,7 +1009,7 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                         return 0;
 
                 if (server->bound_leases[pool_offset] == existing_lease) {
-                        server->bound_leases[pool_offset] = NULL;
+                        server_set_bound_lease(server, pool_offset, NULL);
                         hashmap_remove(server->leases_by_client_id, existing_lease);
                         dhcp_lease_free(existing_lease);
 
@@ -152,7 +152,7 @@ static int lldp_add_neighbor(sd_lldp *lldp, sd_lldp_neighbor *n) {
         if (r < 0)
                 goto finish;
 
-        r = prioq_put(lldp->neighbor_by_expiry, n, &n->prioq_idx);
+        r = prioq_put_with_key(lldp->neighbor_by_expiry, n, &n->prioq_idx, n->until);
         if (r < 0) {
                 assert_se(hashmap_remove(lldp->neighbor_by_id, &n->id) == n);
                 goto finish;
@@ -379,7 +379,8 @@ _public_ int sd_lldp_new(sd_lldp **ret) {
         if (!lldp->neighbor_by_id)
                 return -ENOMEM;
 
-        r = prioq_ensure_allocated(&lldp->neighbor_by_expiry, lldp_neighbor_prioq_compare_func);
+        /* Ordered by the expiry time, which is passed as key on insertion */
+        r = prioq_ensure_allocated(&lldp->neighbor_by_expiry, NULL);
         if (r < 0)
                 return r;
 
@@ -181,6 +181,79 @@ static void test_message_handler(void) {
         assert_se(dhcp_server_handle_message(server, (DHCPMessage*)&test, sizeof(test)) == 0);
 }
 
+static void test_pool_exhaustion(void) {
+        _cleanup_(sd_dhcp_server_unrefp) sd_dhcp_server *server = NULL;
+        struct {
+                DHCPMessage message;
+                struct {
+                        uint8_t code;
+                        uint8_t length;
+                        uint8_t type;
+                } _packed_ option_type;
+                struct {
+                        uint8_t code;
+                        uint8_t length;
+                        be32_t address;
+                } _packed_ option_requested_ip;
+                struct {
+                        uint8_t code;
+                        uint8_t length;
+                        be32_t address;
+                } _packed_ option_server_id;
+                uint8_t end;
+        } _packed_ test = {
+                .message.op = BOOTREQUEST,
+                .message.htype = ARPHRD_ETHER,
+                .message.hlen = ETHER_ADDR_LEN,
+                .message.xid = htobe32(0x12345678),
+                .message.chaddr = { 'A', 'B', 'C', 'D', 0, 0 },
+                .option_type.code = SD_DHCP_OPTION_MESSAGE_TYPE,
+                .option_type.length = 1,
+                .option_requested_ip.code = SD_DHCP_OPTION_REQUESTED_IP_ADDRESS,
+                .option_requested_ip.length = 4,
+                .option_server_id.code = SD_DHCP_OPTION_SERVER_IDENTIFIER,
+                .option_server_id.length = 4,
+                .option_server_id.address = htobe32(INADDR_LOOPBACK),
+                .end = SD_DHCP_OPTION_END,
+        };
+        struct in_addr address_lo = {
+                .s_addr = htonl(INADDR_LOOPBACK),
+        };
+        unsigned i;
+
+        /* A pool spanning several bitmap words, with the server's own address as first entry */
+        assert_se(sd_dhcp_server_new(&server, 1) >= 0);
+        assert_se(sd_dhcp_server_configure_pool(server, &address_lo, 8, 0, 130) >= 0);
+        assert_se(sd_dhcp_server_attach_event(server, NULL, 0) >= 0);
+        assert_se(sd_dhcp_server_start(server) >= 0);
+
+        for (i = 1; i < 130; i++) {
+                test.message.chaddr[5] = i;
+                test.option_type.type = DHCP_REQUEST;
+                test.option_requested_ip.address = htobe32(INADDR_LOOPBACK + i);
+                assert_se(dhcp_server_handle_message(server, (DHCPMessage*)&test, sizeof(test)) == DHCP_ACK);
+        }
+
+        /* Every address is taken now, a new client gets no offer */
+        test.message.chaddr[4] = 1;
+        test.message.chaddr[5] = 0;
+        test.option_type.type = DHCP_DISCOVER;
+        assert_se(dhcp_server_handle_message(server, (DHCPMessage*)&test, sizeof(test)) == 0);
+
+        /* Release one address in the last word, and the new client gets an offer again */
+        test.message.chaddr[4] = 0;
+        test.message.chaddr[5] = 129;
+        test.message.ciaddr = htobe32(INADDR_LOOPBACK + 129);
+        test.option_type.type = DHCP_RELEASE;
+        assert_se(dhcp_server_handle_message(server, (DHCPMessage*)&test, sizeof(test)) == 0);
+
+        test.message.chaddr[4] = 1;
+        test.message.chaddr[5] = 0;
+        test.message.ciaddr = 0;
+        test.option_type.type = DHCP_DISCOVER;
+        assert_se(dhcp_server_handle_message(server, (DHCPMessage*)&test, sizeof(test)) == DHCP_OFFER);
+}
+
 static uint64_t client_id_hash_helper(DHCPClientId *id, uint8_t key[HASH_KEY_SIZE]) {
         struct siphash state;
 
@@ -239,6 +312,7 @@ int main(int argc, char *argv[]) {
                 return log_tests_skipped("cannot start dhcp server");
 
         test_message_handler();
+        test_pool_exhaustion();
         test_client_id_hash();
 
         return 0;
@@ -0,0 +1,227 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "bus-internal.h"
+#include "bus-match.h"
+#include "bus-message.h"
+#include "bus-slot.h"
+#include "memory-util.h"
+#include "tests.h"
+
+#define TEST_INTERFACE "org.freedesktop.systemd.test"
+
+typedef struct Context {
+        sd_bus *bus;
+        void *blob;
+        size_t blob_size;
+        uint64_t cookie;
+} Context;
+
+typedef struct MatchContext {
+        struct bus_match_node root;
+        sd_bus_message *message;
+} MatchContext;
+
+#define N_MATCHES 10000U
+
+static void *server(void *p) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        int fd = PTR_TO_INT(p);
+        sd_id128_t id;
+
+        assert_se(sd_id128_randomize(&id) >= 0);
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_fd(bus, fd, fd) >= 0);
+        assert_se(sd_bus_set_server(bus, 1, id) >= 0);
+        assert_se(sd_bus_start(bus) >= 0);
+
+        for (;;) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+                uint32_t u;
+                int r;
+
+                r = sd_bus_process(bus, &m);
+                assert_se(r >= 0);
+                if (r == 0) {
+                        assert_se(sd_bus_wait(bus, UINT64_MAX) >= 0);
+                        continue;
+                }
+                if (!m)
+                        continue;
+
+                if (sd_bus_message_is_method_call(m, TEST_INTERFACE, "Exit")) {
+                        assert_se(sd_bus_reply_method_return(m, NULL) >= 0);
+                        break;
+                }
+
+                assert_se(sd_bus_message_is_method_call(m, TEST_INTERFACE, "Ping"));
+                assert_se(sd_bus_message_read(m, "u", &u) >= 0);
+                assert_se(sd_bus_message_new_method_return(m, &reply) >= 0);
+                assert_se(sd_bus_message_append(reply, "u", u) >= 0);
+                assert_se(sd_bus_send(bus, reply, NULL) >= 0);
+        }
+
+        return NULL;
+}
+
+static void build_message(Context *c, sd_bus_message **ret) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        static const uint32_t array[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+        /* Roughly the shape of a typical property change notification */
+        assert_se(sd_bus_message_new_signal(c->bus, &m, "/org/freedesktop/systemd1/unit/foo_2eservice",
+                                            "org.freedesktop.DBus.Properties", "PropertiesChanged") >= 0);
+        assert_se(sd_bus_message_append(m, "s", "org.freedesktop.systemd1.Unit") >= 0);
+        assert_se(sd_bus_message_append(m, "a{sv}", 8,
+                                        "ActiveState", "s", "active",
+                                        "SubState", "s", "running",
+                                        "StateChangeTimestamp", "t", UINT64_C(1600000000000000),
+                                        "StateChangeTimestampMonotonic", "t", UINT64_C(1234567),
+                                        "InactiveExitTimestamp", "t", UINT64_C(1600000000000000),
+                                        "ActiveEnterTimestamp", "t", UINT64_C(1600000000000000),
+                                        "Job", "(uo)", 0, "/",
+                                        "ConditionResult", "b", true) >= 0);
+        assert_se(sd_bus_message_append_array(m, 'u', array, sizeof(array)) >= 0);
+        assert_se(sd_bus_message_seal(m, ++c->cookie, 0) >= 0);
+
+        *ret = TAKE_PTR(m);
+}
+
+static void bench_marshal(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                build_message(c, &m);
+        }
+}
+
+static void bench_demarshal(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+                const char *s;
+                void *b;
+
+                assert_se(b = memdup(c->blob, c->blob_size));
+                assert_se(bus_message_from_malloc(c->bus, b, c->blob_size, NULL, 0, NULL, &m) >= 0);
+                assert_se(sd_bus_message_read(m, "s", &s) >= 0);
+                assert_se(sd_bus_message_skip(m, "a{sv}au") >= 0);
+        }
+}
+
+static void bench_round_trip(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+                uint32_t u;
+
+                assert_se(sd_bus_call_method(c->bus, NULL, "/", TEST_INTERFACE, "Ping", NULL, &reply, "u", (uint32_t) i) >= 0);
+                assert_se(sd_bus_message_read(reply, "u", &u) >= 0);
+                assert_se(u == (uint32_t) i);
+        }
+}
+
+static int match_filter(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        return 0;
+}
+
+static void bench_match_run(void *userdata, uint64_t n) {
+        MatchContext *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++)
+                assert_se(bus_match_run(NULL, &c->root, c->message) == 0);
+}
+
+static void run_match(Context *c, const char *name, enum bus_match_node_type type) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ sd_bus_slot *slots = NULL;
+        MatchContext mc = {
+                .root.type = BUS_MATCH_ROOT,
+        };
+
+        /* Lots of matches which all differ in their last label, like PID 1 and logind install them for
+         * their units and sessions, and a signal that is dispatched to (at most) one of them */
+
+        assert_se(slots = new0(sd_bus_slot, N_MATCHES));
+
+        for (unsigned i = 0; i < N_MATCHES; i++) {
+                struct bus_match_component *components = NULL;
+                unsigned n_components = 0;
+                _cleanup_free_ char *match = NULL;
+
+                switch (type) {
+                case BUS_MATCH_PATH_NAMESPACE:
+                        assert_se(asprintf(&match, "type='signal',path_namespace='/org/freedesktop/unit/u%u'", i) >= 0);
+                        break;
+                case BUS_MATCH_ARG_NAMESPACE:
+                        assert_se(asprintf(&match, "type='signal',arg0namespace='org.freedesktop.unit.u%u'", i) >= 0);
+                        break;
+                case BUS_MATCH_ARG_PATH:
+                        assert_se(asprintf(&match, "type='signal',arg1path='/org/freedesktop/unit/u%u/'", i) >= 0);
+                        break;
+                default:
+                        assert_se(asprintf(&match, "type='signal',path='/org/freedesktop/unit/u%u'", i) >= 0);
+                }
+
+                assert_se(bus_match_parse(match, &components, &n_components) >= 0);
+                slots[i].match_callback.callback = match_filter;
+                assert_se(bus_match_add(&mc.root, components, n_components, &slots[i].match_callback) >= 0);
+                bus_match_parse_free(components, n_components);
+        }
+
+        assert_se(sd_bus_message_new_signal(c->bus, &m, "/org/freedesktop/unit/u42/sub", "org.test", "Test") >= 0);
+        assert_se(sd_bus_message_append(m, "ss", "org.freedesktop.unit.u42.sub", "/org/freedesktop/unit/u42/sub") >= 0);
+        assert_se(sd_bus_message_seal(m, ++c->cookie, 0) >= 0);
+
+        mc.message = m;
+
+        benchmark_run(name, bench_match_run, &mc);
+
+        bus_match_free(&mc.root);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        Context c = {};
+        int fds[2];
+        pthread_t t;
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, fds) >= 0);
+        assert_se(pthread_create(&t, NULL, server, INT_TO_PTR(fds[0])) == 0);
+
+        assert_se(sd_bus_new(&c.bus) >= 0);
+        assert_se(sd_bus_set_fd(c.bus, fds[1], fds[1]) >= 0);
+        assert_se(sd_bus_start(c.bus) >= 0);
+
+        build_message(&c, &m);
+        assert_se(bus_message_get_blob(m, &c.blob, &c.blob_size) >= 0);
+
+        benchmark_run("bus-marshal", bench_marshal, &c);
+        benchmark_run("bus-demarshal", bench_demarshal, &c);
+        benchmark_run("bus-round-trip", bench_round_trip, &c);
+
+        run_match(&c, "bus-match-path-10k", BUS_MATCH_PATH);
+        run_match(&c, "bus-match-path-namespace-10k", BUS_MATCH_PATH_NAMESPACE);
+        run_match(&c, "bus-match-arg-namespace-10k", BUS_MATCH_ARG_NAMESPACE);
+        run_match(&c, "bus-match-arg-path-10k", BUS_MATCH_ARG_PATH);
+
+        assert_se(sd_bus_call_method(c.bus, NULL, "/", TEST_INTERFACE, "Exit", NULL, NULL, NULL) >= 0);
+        assert_se(pthread_join(t, NULL) == 0);
+
+        sd_bus_flush_close_unref(c.bus);
+        free(c.blob);
+
+        return 0;
+}
@@ -712,7 +712,7 @@ _public_ int sd_bus_get_name_creds(
                         }
                 }
 
-                r = bus_creds_add_more(c, mask, pid, 0);
+                r = bus_creds_add_more_cached(&bus->creds_cache, c, mask, pid, 0);
                 if (r < 0)
                         return r;
         }
@@ -787,7 +787,7 @@ _public_ int sd_bus_get_owner_creds(sd_bus *bus, uint64_t mask, sd_bus_creds **r
                 c->mask |= SD_BUS_CREDS_SUPPLEMENTARY_GIDS;
         }
 
-        r = bus_creds_add_more(c, mask, pid, 0);
+        r = bus_creds_add_more_cached(&bus->creds_cache, c, mask, pid, 0);
         if (r < 0)
                 return r;
 
@@ -637,7 +637,7 @@ _public_ int sd_bus_query_sender_creds(sd_bus_message *call, uint64_t mask, sd_b
                         return sd_bus_get_owner_creds(call->bus, mask, creds);
         }
 
-        return bus_creds_extend_by_pid(c, mask, creds);
+        return bus_creds_extend_by_pid(&call->bus->creds_cache, c, mask, creds);
 }
 
 _public_ int sd_bus_query_sender_privilege(sd_bus_message *call, int capability) {
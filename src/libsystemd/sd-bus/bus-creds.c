@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <linux/capability.h>
+#include <poll.h>
 #include <stdlib.h>
 
 #include "alloc-util.h"
@@ -15,6 +16,7 @@
 #include "fileio.h"
 #include "format-util.h"
 #include "hexdecoct.h"
+#include "missing_syscall.h"
 #include "parse-util.h"
 #include "process-util.h"
 #include "string-util.h"
@@ -1102,31 +1104,16 @@ int bus_creds_add_more(sd_bus_creds *c, uint64_t mask, pid_t pid, pid_t tid) {
         if (tid > 0 && tid != pid && !pid_is_unwaited(tid))
                 return -ESRCH;
 
-        c->augmented = missing & c->mask;
+        c->augmented |= missing & c->mask;
 
         return 0;
 }
 
-int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret) {
-        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *n = NULL;
-        int r;
-
+static int creds_copy_fields(sd_bus_creds *n, const sd_bus_creds *c, uint64_t mask) {
+        assert(n);
         assert(c);
-        assert(ret);
-
-        if ((mask & ~c->mask) == 0 || (!(mask & SD_BUS_CREDS_AUGMENT))) {
-                /* There's already all data we need, or augmentation
-                 * wasn't turned on. */
 
-                *ret = sd_bus_creds_ref(c);
-                return 0;
-        }
-
-        n = bus_creds_new();
-        if (!n)
-                return -ENOMEM;
-
-        /* Copy the original data over */
+        /* Copies the fields selected by "mask" that "c" has over to "n", which must not have them yet */
 
         if (c->mask & mask & SD_BUS_CREDS_PID) {
                 n->pid = c->pid;
@@ -1243,7 +1230,7 @@ int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret)
                 n->mask |= SD_BUS_CREDS_CMDLINE;
         }
 
-        if (c->mask & mask & (SD_BUS_CREDS_CGROUP|SD_BUS_CREDS_SESSION|SD_BUS_CREDS_UNIT|SD_BUS_CREDS_USER_UNIT|SD_BUS_CREDS_SLICE|SD_BUS_CREDS_USER_SLICE|SD_BUS_CREDS_OWNER_UID)) {
+        if (c->mask & mask & (SD_BUS_CREDS_CGROUP|SD_BUS_CREDS_SESSION|SD_BUS_CREDS_UNIT|SD_BUS_CREDS_USER_UNIT|SD_BUS_CREDS_SLICE|SD_BUS_CREDS_USER_SLICE|SD_BUS_CREDS_OWNER_UID) && !n->cgroup) {
                 assert(c->cgroup);
 
                 n->cgroup = strdup(c->cgroup);
@@ -1257,7 +1244,7 @@ int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret)
                 n->mask |= mask & (SD_BUS_CREDS_CGROUP|SD_BUS_CREDS_SESSION|SD_BUS_CREDS_UNIT|SD_BUS_CREDS_USER_UNIT|SD_BUS_CREDS_SLICE|SD_BUS_CREDS_USER_SLICE|SD_BUS_CREDS_OWNER_UID);
         }
 
-        if (c->mask & mask & (SD_BUS_CREDS_EFFECTIVE_CAPS|SD_BUS_CREDS_PERMITTED_CAPS|SD_BUS_CREDS_INHERITABLE_CAPS|SD_BUS_CREDS_BOUNDING_CAPS)) {
+        if (c->mask & mask & (SD_BUS_CREDS_EFFECTIVE_CAPS|SD_BUS_CREDS_PERMITTED_CAPS|SD_BUS_CREDS_INHERITABLE_CAPS|SD_BUS_CREDS_BOUNDING_CAPS) && !n->capability) {
                 assert(c->capability);
 
                 n->capability = memdup(c->capability, DIV_ROUND_UP(cap_last_cap()+1, 32U) * 4 * 4);
@@ -1325,11 +1312,39 @@ int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret)
                 n->mask |= SD_BUS_CREDS_DESCRIPTION;
         }
 
+        return 0;
+}
+
+int bus_creds_extend_by_pid(Hashmap **cache, sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret) {
+        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *n = NULL;
+        int r;
+
+        assert(cache);
+        assert(c);
+        assert(ret);
+
+        if ((mask & ~c->mask) == 0 || (!(mask & SD_BUS_CREDS_AUGMENT))) {
+                /* There's already all data we need, or augmentation
+                 * wasn't turned on. */
+
+                *ret = sd_bus_creds_ref(c);
+                return 0;
+        }
+
+        n = bus_creds_new();
+        if (!n)
+                return -ENOMEM;
+
+        /* Copy the original data over */
+        r = creds_copy_fields(n, c, mask);
+        if (r < 0)
+                return r;
+
         n->augmented = c->augmented & n->mask;
 
         /* Get more data */
 
-        r = bus_creds_add_more(n, mask, 0, 0);
+        r = bus_creds_add_more_cached(cache, n, mask, 0, 0);
         if (r < 0)
                 return r;
 
@@ -1337,3 +1352,190 @@ int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret)
 
         return 0;
 }
+
+/* Augmented fields that are read from /proc for a process as a whole, and that may hence be reused for later
+ * messages from the same process. Everything related to threads is not. */
+#define CREDS_CACHE_MASK                                                \
+        (_SD_BUS_CREDS_ALL &                                            \
+         ~(SD_BUS_CREDS_PID|SD_BUS_CREDS_TID|SD_BUS_CREDS_TID_COMM|     \
+           SD_BUS_CREDS_UNIQUE_NAME|SD_BUS_CREDS_WELL_KNOWN_NAMES|SD_BUS_CREDS_DESCRIPTION))
+
+/* How long we reuse data read from /proc at most. Processes may change their credentials, cgroup or command
+ * line at any time, hence don't keep it around for longer than that, even if the process is still running. */
+#define CREDS_CACHE_MAX_AGE_USEC (1*USEC_PER_SEC)
+
+#define CREDS_CACHE_MAX 64U
+
+/* The cache is keyed by PID. Each entry pins its process with a pidfd, so that we notice when the process
+ * exits and its PID might get reused. Without pidfd support we don't cache anything. */
+typedef struct CredsCacheEntry {
+        pid_t pid;
+        int pidfd;
+        usec_t timestamp;
+        sd_bus_creds *creds;
+} CredsCacheEntry;
+
+static CredsCacheEntry* creds_cache_entry_free(CredsCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        safe_close(e->pidfd);
+        sd_bus_creds_unref(e->creds);
+        return mfree(e);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(creds_cache_hash_ops, void, trivial_hash_func, trivial_compare_func, CredsCacheEntry, creds_cache_entry_free);
+
+static bool creds_cache_entry_valid(CredsCacheEntry *e, usec_t n) {
+        struct pollfd pollfd;
+
+        assert(e);
+
+        if (e->timestamp + CREDS_CACHE_MAX_AGE_USEC <= n)
+                return false;
+
+        /* A pidfd becomes readable when its process exits */
+        pollfd = (struct pollfd) {
+                .fd = e->pidfd,
+                .events = POLLIN,
+        };
+
+        if (poll(&pollfd, 1, 0) < 0)
+                return false;
+
+        return !(pollfd.revents & POLLIN);
+}
+
+static void creds_cache_evict(Hashmap *cache) {
+        CredsCacheEntry *e, *oldest = NULL;
+        Iterator i;
+
+        HASHMAP_FOREACH(e, cache, i)
+                if (!oldest || e->timestamp < oldest->timestamp)
+                        oldest = e;
+
+        if (oldest) {
+                hashmap_remove(cache, PID_TO_PTR(oldest->pid));
+                creds_cache_entry_free(oldest);
+        }
+}
+
+static int creds_cache_store(Hashmap **cache, CredsCacheEntry *e, int pidfd, const sd_bus_creds *c, pid_t pid, usec_t n) {
+        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *copy = NULL;
+        _cleanup_close_ int fd = pidfd;
+        int r;
+
+        assert(cache);
+        assert(c);
+
+        copy = bus_creds_new();
+        if (!copy)
+                return -ENOMEM;
+
+        r = creds_copy_fields(copy, c, c->augmented & CREDS_CACHE_MASK);
+        if (r < 0)
+                return r;
+
+        if (e) {
+                /* Keep what we knew before, but not for longer than the oldest data was read */
+                r = creds_copy_fields(copy, e->creds, e->creds->mask & ~copy->mask);
+                if (r < 0)
+                        return r;
+
+                sd_bus_creds_unref(e->creds);
+                e->creds = TAKE_PTR(copy);
+                return 0;
+        }
+
+        if (fd < 0)
+                return 0;
+
+        if (hashmap_size(*cache) >= CREDS_CACHE_MAX)
+                creds_cache_evict(*cache);
+
+        r = hashmap_ensure_allocated(cache, &creds_cache_hash_ops);
+        if (r < 0)
+                return r;
+
+        e = new(CredsCacheEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (CredsCacheEntry) {
+                .pid = pid,
+                .pidfd = TAKE_FD(fd),
+                .timestamp = n,
+                .creds = TAKE_PTR(copy),
+        };
+
+        r = hashmap_put(*cache, PID_TO_PTR(pid), e);
+        if (r < 0) {
+                creds_cache_entry_free(e);
+                return r;
+        }
+
+        return 0;
+}
+
+int bus_creds_add_more_cached(Hashmap **cache, sd_bus_creds *c, uint64_t mask, pid_t pid, pid_t tid) {
+        _cleanup_close_ int pidfd = -1;
+        CredsCacheEntry *e;
+        uint64_t missing;
+        usec_t n;
+        int r;
+
+        assert(cache);
+        assert(c);
+        assert(c->allocated);
+
+        /* Like bus_creds_add_more(), but reuses what was read from /proc for the same process recently, so
+         * that repeated calls from the same client don't each rescan /proc. */
+
+        if (!(mask & SD_BUS_CREDS_AUGMENT))
+                return 0;
+
+        if (pid <= 0 && (c->mask & SD_BUS_CREDS_PID))
+                pid = c->pid;
+
+        missing = mask & ~c->mask & CREDS_CACHE_MASK;
+        if (pid <= 0 || missing == 0)
+                return bus_creds_add_more(c, mask, pid, tid);
+
+        n = now(CLOCK_MONOTONIC);
+
+        e = hashmap_get(*cache, PID_TO_PTR(pid));
+        if (e && !creds_cache_entry_valid(e, n)) {
+                hashmap_remove(*cache, PID_TO_PTR(pid));
+                e = creds_cache_entry_free(e);
+        }
+
+        if (e) {
+                uint64_t old_mask = c->mask;
+
+                r = creds_copy_fields(c, e->creds, missing);
+                if (r < 0)
+                        return r;
+
+                c->augmented |= c->mask & ~old_mask;
+
+                if ((missing & ~c->mask) == 0)
+                        /* Everything cacheable we need was cached, only the per-thread data might be left */
+                        return bus_creds_add_more(c, mask, pid, tid);
+        } else {
+                /* Pin the process before reading its data, so that we never cache data of one process under
+                 * the pidfd of another one that got its PID later. If that fails we just don't cache. */
+                pidfd = pidfd_open(pid, 0);
+        }
+
+        r = bus_creds_add_more(c, mask, pid, tid);
+        if (r < 0)
+                return r;
+
+        (void) creds_cache_store(cache, e, TAKE_FD(pidfd), c, pid, n);
+
+        return 0;
+}
+
+Hashmap* bus_creds_cache_free(Hashmap *cache) {
+        return hashmap_free(cache);
+}
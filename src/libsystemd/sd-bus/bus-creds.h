@@ -5,6 +5,8 @@
 
 #include "sd-bus.h"
 
+#include "hashmap.h"
+
 struct sd_bus_creds {
         bool allocated;
         unsigned n_ref;
@@ -69,4 +71,7 @@ void bus_creds_done(sd_bus_creds *c);
 
 int bus_creds_add_more(sd_bus_creds *c, uint64_t mask, pid_t pid, pid_t tid);
 
-int bus_creds_extend_by_pid(sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret);
+int bus_creds_add_more_cached(Hashmap **cache, sd_bus_creds *c, uint64_t mask, pid_t pid, pid_t tid);
+Hashmap* bus_creds_cache_free(Hashmap *cache);
+
+int bus_creds_extend_by_pid(Hashmap **cache, sd_bus_creds *c, uint64_t mask, sd_bus_creds **ret);
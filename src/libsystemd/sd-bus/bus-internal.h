@@ -102,6 +102,13 @@ struct node_vtable {
         const sd_bus_vtable *vtable;
         sd_bus_object_find_t find;
 
+        /* The properties included in generic dumps such as GetAll(), in vtable order */
+        const sd_bus_vtable **properties;
+        size_t n_properties;
+
+        /* The introspection XML of the vtable for untrusted and trusted connections, generated on first use */
+        char *introspection[2];
+
         LIST_FIELDS(struct node_vtable, vtables);
 };
 
@@ -180,6 +187,16 @@ enum bus_auth {
         BUS_AUTH_ANONYMOUS
 };
 
+/* How many released message objects and buffers of each kind we keep around per bus for reuse */
+#define BUS_MESSAGE_POOL_MAX 32
+
+typedef enum BusPoolType {
+        BUS_POOL_MESSAGE,
+        BUS_POOL_HEADER,
+        BUS_POOL_BODY,
+        _BUS_POOL_MAX,
+} BusPoolType;
+
 struct sd_bus {
         unsigned n_ref;
 
@@ -190,6 +207,7 @@ struct sd_bus {
         int message_endian;
 
         bool can_fds:1;
+        bool can_memfd:1;
         bool bus_client:1;
         bool ucred_valid:1;
         bool is_server:1;
@@ -211,6 +229,7 @@ struct sd_bus {
         bool watch_bind:1;
         bool is_monitor:1;
         bool accept_fd:1;
+        bool accept_memfd:1;
         bool attach_timestamp:1;
         bool connected_signal:1;
         bool close_on_exit:1;
@@ -259,7 +278,7 @@ struct sd_bus {
 
         enum bus_auth auth;
         unsigned auth_index;
-        struct iovec auth_iovec[3];
+        struct iovec auth_iovec[4];
         size_t auth_rbegin;
         char *auth_buffer;
         usec_t auth_timeout;
@@ -271,6 +290,9 @@ struct sd_bus {
 
         uint64_t creds_mask;
 
+        /* Data read from /proc about peers, by PID, see bus_creds_add_more_cached() */
+        Hashmap *creds_cache;
+
         int *fds;
         size_t n_fds;
 
@@ -287,6 +309,12 @@ struct sd_bus {
         struct memfd_cache memfd_cache[MEMFD_CACHE_MAX];
         unsigned n_memfd_cache;
 
+        /* Released message objects and small header and body buffers, kept for reuse by the next messages
+         * we allocate, see bus-message.c. Protected by a mutex for the same reason as the memfd cache. */
+        pthread_mutex_t message_pool_mutex;
+        void *message_pool[_BUS_POOL_MAX][BUS_MESSAGE_POOL_MAX];
+        unsigned n_message_pool[_BUS_POOL_MAX];
+
         pid_t original_pid;
         pid_t busexec_pid;
 
@@ -317,6 +345,11 @@ struct sd_bus {
         LIST_HEAD(sd_bus_slot, slots);
         LIST_HEAD(sd_bus_track, tracks);
 
+        /* Names tracked by any of the sd_bus_track objects above, and the match covering all of them if
+         * there are too many for a match each, see bus-track.c */
+        Hashmap *track_names;
+        sd_bus_slot *track_match;
+
         int *inotify_watches;
         size_t n_inotify_watches;
 
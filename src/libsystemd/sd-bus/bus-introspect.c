@@ -187,23 +187,13 @@ static int introspect_write_arguments(struct introspect *i, const char *signatur
         }
 }
 
-int introspect_write_interface(
-                struct introspect *i,
-                const char *interface_name,
-                const sd_bus_vtable *v) {
-
+static void introspect_write_vtable(struct introspect *i, const sd_bus_vtable *v) {
         const sd_bus_vtable *vtable = v;
         const char *names = "";
-        int r;
 
         assert(i);
-        assert(interface_name);
         assert(v);
 
-        r = set_interface_name(i, interface_name);
-        if (r < 0)
-                return r;
-
         for (; v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(vtable, v)) {
 
                 /* Ignore methods, signals and properties that are
@@ -251,6 +241,65 @@ int introspect_write_interface(
                 }
 
         }
+}
+
+int introspect_write_interface(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v) {
+
+        int r;
+
+        assert(i);
+        assert(interface_name);
+        assert(v);
+
+        r = set_interface_name(i, interface_name);
+        if (r < 0)
+                return r;
+
+        introspect_write_vtable(i, v);
+
+        return 0;
+}
+
+int introspect_write_interface_cached(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v,
+                char **cache) {
+
+        int r;
+
+        assert(i);
+        assert(interface_name);
+        assert(v);
+        assert(cache);
+
+        r = set_interface_name(i, interface_name);
+        if (r < 0)
+                return r;
+
+        if (!*cache) {
+                _cleanup_(introspect_free) struct introspect c = {
+                        .trusted = i->trusted,
+                };
+
+                c.f = open_memstream_unlocked(&c.introspection, &c.size);
+                if (!c.f)
+                        return -ENOMEM;
+
+                introspect_write_vtable(&c, v);
+
+                r = fflush_and_check(c.f);
+                if (r < 0)
+                        return r;
+
+                c.f = safe_fclose(c.f);
+                *cache = TAKE_PTR(c.introspection);
+        }
+
+        fputs(*cache, i->f);
 
         return 0;
 }
@@ -22,5 +22,11 @@ int introspect_write_interface(
                 struct introspect *i,
                 const char *interface_name,
                 const sd_bus_vtable *v);
+/* Like introspect_write_interface(), but the XML for the vtable is generated only once, and kept in *cache */
+int introspect_write_interface_cached(
+                struct introspect *i,
+                const char *interface_name,
+                const sd_bus_vtable *v,
+                char **cache);
 int introspect_finish(struct introspect *i, char **ret);
 void introspect_free(struct introspect *i);
@@ -53,9 +53,15 @@ static bool BUS_MATCH_IS_COMPARE(enum bus_match_node_type t) {
 }
 
 static bool BUS_MATCH_CAN_HASH(enum bus_match_node_type t) {
-        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH) ||
-                (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_LAST) ||
-                (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST);
+        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH_NAMESPACE) ||
+                (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_HAS_LAST);
+}
+
+/* Namespace and path matches are hashed by their pattern too, but need to be looked up by all prefixes of
+ * the value that might match them */
+static bool BUS_MATCH_IS_PREFIX(enum bus_match_node_type t) {
+        return t == BUS_MATCH_PATH_NAMESPACE ||
+                (t >= BUS_MATCH_ARG_PATH && t <= BUS_MATCH_ARG_NAMESPACE_LAST);
 }
 
 static void bus_match_node_free(struct bus_match_node *node) {
@@ -239,6 +245,107 @@ static bool value_node_same(
         }
 }
 
+static int bus_match_run_found(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *key,
+                sd_bus_message *m) {
+
+        struct bus_match_node *found;
+
+        found = hashmap_get(node->compare.children, key);
+        if (!found)
+                return 0;
+
+        return bus_match_run(bus, found, m);
+}
+
+static int bus_match_run_prefixes(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *test_str,
+                sd_bus_message *m) {
+
+        _cleanup_free_ char *k = NULL;
+        char separator;
+        bool simple;
+        size_t n;
+        int r;
+
+        assert(node);
+        assert(BUS_MATCH_IS_PREFIX(node->type));
+
+        /* Rather than testing every pattern against the value, look up the value itself and each of its
+         * prefixes ending at a label boundary, since only those can match. For path_namespace= and
+         * argNnamespace= that's the prefixes before a separator and those including it, for argNpath= only
+         * the latter. */
+
+        if (!test_str)
+                return 0;
+
+        separator = node->type >= BUS_MATCH_ARG_NAMESPACE ? '.' : '/';
+        simple = node->type == BUS_MATCH_PATH_NAMESPACE || node->type >= BUS_MATCH_ARG_NAMESPACE;
+
+        k = strdup(test_str);
+        if (!k)
+                return -ENOMEM;
+        n = strlen(k);
+
+        for (size_t i = 0; i < n; i++) {
+                char saved;
+
+                if (k[i] != separator)
+                        continue;
+
+                if (simple) {
+                        k[i] = 0;
+                        r = bus_match_run_found(bus, node, k, m);
+                        k[i] = separator;
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
+
+                /* With two separators in a row this is the same prefix as the one before the next one */
+                if (i + 1 < n && !(simple && k[i + 1] == separator)) {
+                        saved = k[i + 1];
+                        k[i + 1] = 0;
+                        r = bus_match_run_found(bus, node, k, m);
+                        k[i + 1] = saved;
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
+        }
+
+        r = bus_match_run_found(bus, node, test_str, m);
+        if (r != 0)
+                return r;
+
+        /* For argNpath= a value ending in the separator also matches all longer patterns it is a prefix
+         * of. That's the only case we can't look up directly. */
+        if (!simple && n > 0 && test_str[n - 1] == separator) {
+                struct bus_match_node *c;
+                Iterator i;
+
+                HASHMAP_FOREACH(c, node->compare.children, i) {
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+
+                        if (strlen(c->value.str) <= n || !startswith(c->value.str, test_str))
+                                continue;
+
+                        r = bus_match_run(bus, c, m);
+                        if (r != 0)
+                                return r;
+                }
+        }
+
+        return 0;
+}
+
 int bus_match_run(
                 sd_bus *bus,
                 struct bus_match_node *node,
@@ -384,7 +491,13 @@ int bus_match_run(
 
                 /* Lookup via hash table, nice! So let's jump directly. */
 
-                if (test_str)
+                if (BUS_MATCH_IS_PREFIX(node->type)) {
+                        r = bus_match_run_prefixes(bus, node, test_str, m);
+                        if (r != 0)
+                                return r;
+
+                        found = NULL;
+                } else if (test_str)
                         found = hashmap_get(node->compare.children, test_str);
                 else if (test_strv) {
                         char **i;
@@ -41,7 +41,74 @@ static void *adjust_pointer(const void *p, void *old_base, size_t sz, void *new_
         return (uint8_t*) new_base + ((uint8_t*) p - (uint8_t*) old_base);
 }
 
-static void message_free_part(sd_bus_message *m, struct bus_body_part *part) {
+/* Messages allocated by us, with the initial header embedded, are kept in a per-bus pool when released,
+ * together with header and body buffers of the following sizes, which are what we allocate for messages
+ * that are small enough, i.e. most method calls, replies and signals. */
+#define MESSAGE_SIZE (ALIGN(sizeof(sd_bus_message)) + sizeof(struct bus_header))
+#define MESSAGE_POOL_HEADER_SIZE 256U
+#define MESSAGE_POOL_BODY_SIZE 512U
+
+static void* message_pool_take(sd_bus *bus, BusPoolType type) {
+        void *p = NULL;
+
+        if (!bus)
+                return NULL;
+
+        assert_se(pthread_mutex_lock(&bus->message_pool_mutex) == 0);
+        if (bus->n_message_pool[type] > 0)
+                p = bus->message_pool[type][--bus->n_message_pool[type]];
+        assert_se(pthread_mutex_unlock(&bus->message_pool_mutex) == 0);
+
+        return p;
+}
+
+static bool message_pool_put(sd_bus *bus, BusPoolType type, void *p) {
+        bool added = false;
+
+        if (!bus)
+                return false;
+
+        assert_se(pthread_mutex_lock(&bus->message_pool_mutex) == 0);
+        if (bus->n_message_pool[type] < BUS_MESSAGE_POOL_MAX) {
+                bus->message_pool[type][bus->n_message_pool[type]++] = p;
+                added = true;
+        }
+        assert_se(pthread_mutex_unlock(&bus->message_pool_mutex) == 0);
+
+        return added;
+}
+
+void bus_message_pool_flush(sd_bus *bus) {
+        BusPoolType type;
+
+        assert(bus);
+
+        assert_se(pthread_mutex_lock(&bus->message_pool_mutex) == 0);
+
+        for (type = 0; type < _BUS_POOL_MAX; type++)
+                while (bus->n_message_pool[type] > 0)
+                        free(bus->message_pool[type][--bus->n_message_pool[type]]);
+
+        assert_se(pthread_mutex_unlock(&bus->message_pool_mutex) == 0);
+}
+
+static sd_bus_message* message_allocate(sd_bus *bus) {
+        sd_bus_message *m;
+
+        m = message_pool_take(bus, BUS_POOL_MESSAGE);
+        if (m)
+                memzero(m, MESSAGE_SIZE);
+        else {
+                m = malloc0(MESSAGE_SIZE);
+                if (!m)
+                        return NULL;
+        }
+
+        m->poolable = true;
+        return m;
+}
+
+static void message_free_part(sd_bus_message *m, struct bus_body_part *part, sd_bus *pool) {
         assert(m);
         assert(part);
 
@@ -60,7 +127,8 @@ static void message_free_part(sd_bus_message *m, struct bus_body_part *part) {
                 if (m->sensitive)
                         explicit_bzero_safe(part->data, part->size);
 
-                if (part->free_this)
+                if (part->free_this &&
+                    !(part->allocated == MESSAGE_POOL_BODY_SIZE && message_pool_put(pool, BUS_POOL_BODY, part->data)))
                         free(part->data);
         }
 
@@ -68,7 +136,7 @@ static void message_free_part(sd_bus_message *m, struct bus_body_part *part) {
                 free(part);
 }
 
-static void message_reset_parts(sd_bus_message *m) {
+static void message_reset_parts(sd_bus_message *m, sd_bus *pool) {
         struct bus_body_part *part;
 
         assert(m);
@@ -76,7 +144,7 @@ static void message_reset_parts(sd_bus_message *m) {
         part = &m->body;
         while (m->n_body_parts > 0) {
                 struct bus_body_part *next = part->next;
-                message_free_part(m, part);
+                message_free_part(m, part, pool);
                 part = next;
                 m->n_body_parts--;
         }
@@ -122,12 +190,19 @@ static void message_reset_containers(sd_bus_message *m) {
         m->root_container.index = 0;
 }
 
-static sd_bus_message* message_free(sd_bus_message *m) {
+static sd_bus_message* message_free(sd_bus_message *m, sd_bus *bus) {
+        sd_bus *pool;
+
         assert(m);
 
-        message_reset_parts(m);
+        /* If "bus" is set, memory worth keeping is returned to its pool. Not for sensitive messages though,
+         * to keep their memory around no longer than necessary. */
+        pool = m->sensitive ? NULL : bus;
+
+        message_reset_parts(m, pool);
 
-        if (m->free_header)
+        if (m->free_header &&
+            !(m->header_allocated == MESSAGE_POOL_HEADER_SIZE && message_pool_put(pool, BUS_POOL_HEADER, m->header)))
                 free(m->header);
 
         /* Note that we don't unref m->bus here. That's already done by sd_bus_message_unref() as each user
@@ -141,11 +216,18 @@ static sd_bus_message* message_free(sd_bus_message *m) {
         if (m->iovec != m->iovec_fixed)
                 free(m->iovec);
 
+        if (m->memfd_body)
+                safe_close(m->body_memfd);
+
         message_reset_containers(m);
         assert(m->n_containers == 0);
         message_free_last_container(m);
 
         bus_creds_done(&m->creds);
+
+        if (m->poolable && message_pool_put(pool, BUS_POOL_MESSAGE, m))
+                return NULL;
+
         return mfree(m);
 }
 
@@ -170,15 +252,30 @@ static void *message_extend_fields(sd_bus_message *m, size_t align, size_t sz, b
                 return (uint8_t*) m->header + old_size;
 
         if (m->free_header) {
-                np = realloc(m->header, ALIGN8(new_size));
-                if (!np)
-                        goto poison;
+                if (ALIGN8(new_size) <= m->header_allocated)
+                        np = m->header;
+                else {
+                        np = realloc(m->header, ALIGN8(new_size));
+                        if (!np)
+                                goto poison;
+
+                        m->header_allocated = ALIGN8(new_size);
+                }
         } else {
                 /* Initially, the header is allocated as part of
                  * the sd_bus_message itself, let's replace it by
-                 * dynamic data */
-
-                np = malloc(ALIGN8(new_size));
+                 * dynamic data. If it's small, let's allocate a bit
+                 * more right-away, so that the following fields fit
+                 * without reallocation, and the buffer may be
+                 * recycled. */
+
+                if (ALIGN8(new_size) <= MESSAGE_POOL_HEADER_SIZE) {
+                        np = message_pool_take(m->bus, BUS_POOL_HEADER) ?: malloc(MESSAGE_POOL_HEADER_SIZE);
+                        m->header_allocated = MESSAGE_POOL_HEADER_SIZE;
+                } else {
+                        np = malloc(ALIGN8(new_size));
+                        m->header_allocated = ALIGN8(new_size);
+                }
                 if (!np)
                         goto poison;
 
@@ -466,7 +563,10 @@ int bus_message_from_header(
                 a += label_sz + 1;
         }
 
-        m = malloc0(a);
+        if (a == ALIGN(sizeof(sd_bus_message)))
+                m = message_allocate(bus);
+        else
+                m = malloc0(a);
         if (!m)
                 return -ENOMEM;
 
@@ -580,6 +680,100 @@ int bus_message_from_malloc(
         return 0;
 }
 
+int bus_message_from_malloc_and_memfd(
+                sd_bus *bus,
+                void *buffer,
+                size_t length,
+                int memfd,
+                int *fds,
+                size_t n_fds,
+                const char *label,
+                sd_bus_message **ret) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        struct bus_header *h = buffer;
+        uint32_t body_size;
+        uint64_t sz;
+        int r;
+
+        assert(memfd >= 0);
+
+        /* Like bus_message_from_malloc(), but the buffer only contains the header and the fields, and the
+         * body is in the memfd. Ownership of the memfd is only taken on success. */
+
+        if (length < sizeof(struct bus_header))
+                return -EBADMSG;
+        if (h->version != 1 || !FLAGS_SET(h->flags, BUS_MESSAGE_MEMFD_BODY))
+                return -EBADMSG;
+
+        /* The peer must not be able to modify the body after we validated it */
+        r = memfd_get_sealed(memfd);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return -EBADMSG;
+
+        r = memfd_get_size(memfd, &sz);
+        if (r < 0)
+                return r;
+
+        if (h->endian == BUS_LITTLE_ENDIAN)
+                body_size = le32toh(h->dbus1.body_size);
+        else if (h->endian == BUS_BIG_ENDIAN)
+                body_size = be32toh(h->dbus1.body_size);
+        else
+                return -EBADMSG;
+        if (body_size > sz)
+                return -EBADMSG;
+
+        /* From now on this is a regular message, hide where the body came from */
+        h->flags &= ~BUS_MESSAGE_MEMFD_BODY;
+
+        r = bus_message_from_header(
+                        bus,
+                        buffer, length,
+                        buffer, length,
+                        length + body_size,
+                        fds, n_fds,
+                        label,
+                        0, &m);
+        if (r < 0)
+                return r;
+
+        if (body_size > 0) {
+                m->n_body_parts = 1;
+                m->body = (struct bus_body_part) {
+                        .memfd = memfd,
+                        .size = body_size,
+                        .sealed = true,
+                };
+
+                r = bus_body_part_map(&m->body);
+                if (r < 0) {
+                        m->body.memfd = -1;
+                        return r;
+                }
+        } else
+                m->body.memfd = -1;
+
+        r = bus_message_parse_fields(m);
+        if (r < 0) {
+                /* Leave the memfd to the caller, but drop the mapping */
+                bus_body_part_unmap(&m->body);
+                m->body.memfd = -1;
+                return r;
+        }
+
+        m->free_header = true;
+        m->free_fds = true;
+
+        if (body_size == 0)
+                safe_close(memfd);
+
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
 _public_ int sd_bus_message_new(
                 sd_bus *bus,
                 sd_bus_message **m,
@@ -592,7 +786,7 @@ _public_ int sd_bus_message_new(
         /* Creation of messages with _SD_BUS_MESSAGE_TYPE_INVALID is allowed. */
         assert_return(type < _SD_BUS_MESSAGE_TYPE_MAX, -EINVAL);
 
-        sd_bus_message *t = malloc0(ALIGN(sizeof(sd_bus_message)) + sizeof(struct bus_header));
+        sd_bus_message *t = message_allocate(bus);
         if (!t)
                 return -ENOMEM;
 
@@ -931,6 +1125,19 @@ _public_ sd_bus_message* sd_bus_message_unref(sd_bus_message *m) {
 
         assert(m->n_ref > 0);
 
+        if (m->n_ref == 1 && m->n_queued == 0) {
+                sd_bus *bus;
+
+                /* This is the last reference, and the message is not queued anywhere, hence we can free it
+                 * right-away, while we still hold the reference on the bus connection, so that the memory
+                 * can be returned to its pool. */
+                m->n_ref = 0;
+                bus = TAKE_PTR(m->bus);
+                message_free(m, bus);
+                sd_bus_unref(bus);
+                return NULL;
+        }
+
         sd_bus_unref(m->bus); /* Each regular ref is also a ref on the bus connection. Let's hence drop it
                                * here. Note we have to do this before decrementing our own n_ref here, since
                                * otherwise, if this message is currently queued sd_bus_unref() might call
@@ -946,7 +1153,7 @@ _public_ sd_bus_message* sd_bus_message_unref(sd_bus_message *m) {
          * multiple references to the bus, once for each reference kept on ourselves. */
         m->bus = NULL;
 
-        return message_free(m);
+        return message_free(m, NULL);
 }
 
 sd_bus_message* bus_message_ref_queued(sd_bus_message *m, sd_bus *bus) {
@@ -981,7 +1188,7 @@ sd_bus_message* bus_message_unref_queued(sd_bus_message *m, sd_bus *bus) {
 
         m->bus = NULL;
 
-        return message_free(m);
+        return message_free(m, bus);
 }
 
 _public_ int sd_bus_message_get_type(sd_bus_message *m, uint8_t *type) {
@@ -1258,8 +1465,14 @@ static int part_make_space(
         if (part->allocated == 0 || sz > part->allocated) {
                 size_t new_allocated;
 
-                new_allocated = sz > 0 ? 2 * sz : 64;
-                n = realloc(part->data, new_allocated);
+                /* Small bodies get a buffer of the size we keep in the pool */
+                if (!part->data && sz <= MESSAGE_POOL_BODY_SIZE) {
+                        new_allocated = MESSAGE_POOL_BODY_SIZE;
+                        n = message_pool_take(m->bus, BUS_POOL_BODY) ?: malloc(new_allocated);
+                } else {
+                        new_allocated = sz > 0 ? 2 * sz : 64;
+                        n = realloc(part->data, new_allocated);
+                }
                 if (!n) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -5464,9 +5677,13 @@ int bus_message_parse_fields(sd_bus_message *m) {
                 i++;
         }
 
-        if (m->n_fds != unix_fds)
+        if (m->n_fds < unix_fds)
                 return -EBADMSG;
 
+        /* When reading ahead on a stream socket we might have received the fds of the following messages
+         * too. They remain with the caller, the message only takes the ones it declares. */
+        m->n_fds = unix_fds;
+
         switch (m->header->type) {
 
         case SD_BUS_MESSAGE_SIGNAL:
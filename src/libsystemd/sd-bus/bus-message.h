@@ -85,6 +85,8 @@ struct sd_bus_message {
         bool free_fds:1;
         bool poisoned:1;
         bool sensitive:1;
+        bool memfd_body:1;
+        bool poolable:1;
 
         /* The first and last bytes of the message */
         struct bus_header *header;
@@ -94,6 +96,9 @@ struct sd_bus_message {
         size_t header_accessible;
         size_t footer_accessible;
 
+        /* How much is allocated for the header, if we allocated it ourselves */
+        size_t header_allocated;
+
         size_t fields_size;
         size_t body_size;
         size_t user_body_size;
@@ -117,6 +122,11 @@ struct sd_bus_message {
         struct iovec iovec_fixed[2];
         unsigned n_iovec;
 
+        /* If memfd_body is set, the body is sent as memfd instead of inline, and the iovec refers to this
+         * copy of the header, which has BUS_MESSAGE_MEMFD_BODY set */
+        struct bus_header wire_header;
+        int body_memfd;
+
         char *peeked_signature;
 
         /* If set replies to this message must carry the signature
@@ -168,6 +178,11 @@ static inline size_t BUS_MESSAGE_BODY_BEGIN(sd_bus_message *m) {
                 ALIGN8(m->fields_size);
 }
 
+/* The number of bytes actually written to the socket */
+static inline size_t BUS_MESSAGE_WIRE_SIZE(sd_bus_message *m) {
+        return m->memfd_body ? BUS_MESSAGE_BODY_BEGIN(m) : BUS_MESSAGE_SIZE(m);
+}
+
 static inline void* BUS_MESSAGE_FIELDS(sd_bus_message *m) {
         return (uint8_t*) m->header + sizeof(struct bus_header);
 }
@@ -201,6 +216,16 @@ int bus_message_from_malloc(
                 const char *label,
                 sd_bus_message **ret);
 
+int bus_message_from_malloc_and_memfd(
+                sd_bus *bus,
+                void *buffer,
+                size_t length,
+                int memfd,
+                int *fds,
+                size_t n_fds,
+                const char *label,
+                sd_bus_message **ret);
+
 int bus_message_get_arg(sd_bus_message *m, unsigned i, const char **str);
 int bus_message_get_arg_strv(sd_bus_message *m, unsigned i, char ***strv);
 
@@ -216,6 +241,8 @@ void bus_body_part_unmap(struct bus_body_part *part);
 
 int bus_message_to_errno(sd_bus_message *m);
 
+void bus_message_pool_flush(sd_bus *bus);
+
 int bus_message_new_synthetic_error(sd_bus *bus, uint64_t serial, const sd_bus_error *e, sd_bus_message **m);
 
 int bus_message_remarshal(sd_bus *bus, sd_bus_message **m);
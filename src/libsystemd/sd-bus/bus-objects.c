@@ -13,6 +13,7 @@
 #include "set.h"
 #include "string-util.h"
 #include "strv.h"
+#include "usdt.h"
 
 static int node_vtable_get_userdata(
                 sd_bus *bus,
@@ -412,7 +413,9 @@ static int method_callbacks_run(
                 bus->current_slot = sd_bus_slot_ref(slot);
                 bus->current_handler = c->vtable->x.method.handler;
                 bus->current_userdata = u;
+                USDT(sd_bus, method_dispatch, bus, m, m->path, c->interface, c->member);
                 r = c->vtable->x.method.handler(m, u, &error);
+                USDT(sd_bus, method_dispatch_done, bus, m, r);
                 bus->current_userdata = NULL;
                 bus->current_handler = NULL;
                 bus->current_slot = sd_bus_slot_unref(slot);
@@ -761,7 +764,7 @@ static int vtable_append_all_properties(
                 void *userdata,
                 sd_bus_error *error) {
 
-        const sd_bus_vtable *v;
+        size_t i;
         int r;
 
         assert(bus);
@@ -772,18 +775,10 @@ static int vtable_append_all_properties(
         if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
                 return 1;
 
-        v = c->vtable;
-        for (v = bus_vtable_next(c->vtable, v); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
-                if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
-                        continue;
-
-                if (v->flags & SD_BUS_VTABLE_HIDDEN)
-                        continue;
-
-                /* Let's not include properties marked as "explicit" in any message that contains a generic
-                 * dump of properties, but only in those generated as a response to an explicit request. */
-                if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
-                        continue;
+        /* Hidden and "explicit" properties are already filtered out of c->properties, see
+         * add_object_vtable_internal() */
+        for (i = 0; i < c->n_properties; i++) {
+                const sd_bus_vtable *v = c->properties[i];
 
                 /* Let's not include properties marked only for invalidation on change (i.e. in contrast to
                  * those whose new values are included in PropertiesChanges message) in any signals. This is
@@ -885,6 +880,152 @@ static int property_get_all_callbacks_run(
         return 1;
 }
 
+static int vtable_append_named_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                struct node_vtable *c,
+                void *userdata,
+                char **names,
+                sd_bus_error *error) {
+
+        const sd_bus_vtable *v;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(path);
+        assert(c);
+
+        if (strv_isempty(names))
+                return vtable_append_all_properties(bus, reply, path, c, userdata, error);
+
+        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+                return 1;
+
+        /* Properties asked for by name are returned even if they are marked "explicit", like for Get() */
+        for (v = bus_vtable_next(c->vtable, c->vtable); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
+                if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
+                        continue;
+
+                if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                        continue;
+
+                if (!strv_contains(names, v->x.property.member))
+                        continue;
+
+                r = vtable_append_one_property(bus, reply, path, c, v, userdata, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return 0;
+        }
+
+        return 1;
+}
+
+static int object_append_properties_prefix(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *prefix,
+                const char *path,
+                bool require_fallback,
+                const char *interface,
+                char **names,
+                bool *found_object,
+                sd_bus_error *error) {
+
+        struct node_vtable *c;
+        struct node *n;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(prefix);
+        assert(path);
+        assert(found_object);
+
+        n = hashmap_get(bus->nodes, prefix);
+        if (!n)
+                return 0;
+
+        LIST_FOREACH(vtables, c, n->vtables) {
+                void *u;
+
+                if (require_fallback && !c->is_fallback)
+                        continue;
+
+                r = node_vtable_get_userdata(bus, path, c, &u, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return -EAGAIN;
+                if (r == 0)
+                        continue;
+
+                *found_object = true;
+
+                if (interface && !streq(c->interface, interface))
+                        continue;
+
+                r = vtable_append_named_properties(bus, reply, path, c, u, names, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return -EAGAIN;
+        }
+
+        return 0;
+}
+
+int bus_append_object_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                const char *interface,
+                char **names,
+                sd_bus_error *error) {
+
+        _cleanup_free_ char *prefix = NULL;
+        bool found_object = false;
+        size_t pl;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(object_path_is_valid(path));
+
+        /* Appends the same "a{sv}" array a GetAll() call on the object would return, optionally limited to
+         * the properties listed in "names", so that a single method call may return the properties of many
+         * objects. Like GetAll(), the first node that has any vtable matching the path wins. */
+
+        r = sd_bus_message_open_container(reply, 'a', "{sv}");
+        if (r < 0)
+                return r;
+
+        r = object_append_properties_prefix(bus, reply, path, path, false, interface, names, &found_object, error);
+        if (r < 0)
+                return r;
+
+        if (!found_object) {
+                pl = strlen(path);
+                assert(pl <= BUS_PATH_SIZE_MAX);
+                prefix = new(char, pl + 1);
+                if (!prefix)
+                        return -ENOMEM;
+
+                OBJECT_PATH_FOREACH_PREFIX(prefix, path) {
+                        r = object_append_properties_prefix(bus, reply, prefix, path, true, interface, names, &found_object, error);
+                        if (r < 0)
+                                return r;
+                        if (found_object)
+                                break;
+                }
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
 static int bus_node_exists(
                 sd_bus *bus,
                 struct node *n,
@@ -983,7 +1124,7 @@ int introspect_path(
                 if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
                         continue;
 
-                r = introspect_write_interface(&intro, c->interface, c->vtable);
+                r = introspect_write_interface_cached(&intro, c->interface, c->vtable, &c->introspection[intro.trusted]);
                 if (r < 0)
                         return r;
         }
@@ -1794,6 +1935,7 @@ static int add_object_vtable_internal(
         sd_bus_slot *s = NULL;
         struct node_vtable *i, *existing = NULL;
         const sd_bus_vtable *v;
+        size_t n_properties_allocated = 0;
         struct node *n;
         int r;
         const char *names = "";
@@ -1948,6 +2090,18 @@ static int add_object_vtable_internal(
                                 goto fail;
                         }
 
+                        /* Let's not include properties marked as "explicit" in any message that contains a
+                         * generic dump of properties, but only in those generated as a response to an
+                         * explicit request. */
+                        if (!(v->flags & (SD_BUS_VTABLE_HIDDEN|SD_BUS_VTABLE_PROPERTY_EXPLICIT))) {
+                                if (!GREEDY_REALLOC(s->node_vtable.properties, n_properties_allocated, s->node_vtable.n_properties + 1)) {
+                                        r = -ENOMEM;
+                                        goto fail;
+                                }
+
+                                s->node_vtable.properties[s->node_vtable.n_properties++] = v;
+                        }
+
                         break;
                 }
 
@@ -9,6 +9,15 @@ bool bus_vtable_has_names(const sd_bus_vtable *vtable);
 int bus_process_object(sd_bus *bus, sd_bus_message *m);
 void bus_node_gc(sd_bus *b, struct node *n);
 
+/* Returns -EAGAIN if the registered objects changed while the properties were collected */
+int bus_append_object_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                const char *interface,
+                char **names,
+                sd_bus_error *error);
+
 int introspect_path(
                 sd_bus *bus,
                 const char *path,
@@ -57,6 +57,10 @@ enum {
         BUS_MESSAGE_NO_REPLY_EXPECTED               = 1 << 0,
         BUS_MESSAGE_NO_AUTO_START                   = 1 << 1,
         BUS_MESSAGE_ALLOW_INTERACTIVE_AUTHORIZATION = 1 << 2,
+
+        /* sd-bus specific, only used on connections that negotiated it: the body isn't sent inline, but
+         * as sealed memfd passed as the first fd of the message */
+        BUS_MESSAGE_MEMFD_BODY                      = 1 << 7,
 };
 
 /* Header fields */
@@ -3,6 +3,7 @@
 #include <endian.h>
 #include <poll.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "sd-bus.h"
@@ -10,6 +11,7 @@
 
 #include "alloc-util.h"
 #include "bus-internal.h"
+#include "bus-kernel.h"
 #include "bus-message.h"
 #include "bus-socket.h"
 #include "fd-util.h"
@@ -18,6 +20,7 @@
 #include "hexdecoct.h"
 #include "io-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "memory-util.h"
 #include "path-util.h"
 #include "process-util.h"
@@ -26,11 +29,15 @@
 #include "signal-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "utf8.h"
 
 #define SNDBUF_SIZE (8*1024*1024)
 
+/* How much to read at least in one go, if there are more messages queued on the socket */
+#define READ_AHEAD_SIZE (64U*1024U)
+
 static void iovec_advance(struct iovec iov[], unsigned *idx, size_t size) {
 
         while (size > 0) {
@@ -60,11 +67,61 @@ static int append_iovec(sd_bus_message *m, const void *p, size_t sz) {
         return 0;
 }
 
-static int bus_message_setup_iovec(sd_bus_message *m) {
+static int bus_message_setup_memfd_body(sd_bus_message *m) {
+        _cleanup_close_ int fd = -1;
+        struct bus_body_part *part;
+        void *p;
+        uint8_t *q;
+        unsigned i;
+        int r;
+
+        assert(m);
+        assert(!m->memfd_body);
+
+        if (m->n_body_parts == 1 && m->body.memfd >= 0 && m->body.memfd_offset == 0 &&
+            memfd_get_sealed(m->body.memfd) > 0) {
+                /* The body is a sealed memfd already, e.g. because we received it that way, pass it on as is */
+                fd = fcntl(m->body.memfd, F_DUPFD_CLOEXEC, 3);
+                if (fd < 0)
+                        return -errno;
+        } else {
+                fd = memfd_new_and_map("sd-bus-body", m->body_size, &p);
+                if (fd < 0)
+                        return fd;
+
+                q = p;
+                MESSAGE_FOREACH_PART(part, i, m) {
+                        r = bus_body_part_map(part);
+                        if (r < 0) {
+                                (void) munmap(p, m->body_size);
+                                return r;
+                        }
+
+                        q = mempcpy(q, part->data, part->size);
+                }
+
+                /* The mapping needs to go before we can seal the memfd for writing */
+                (void) munmap(p, m->body_size);
+
+                r = memfd_set_sealed(fd);
+                if (r < 0)
+                        return r;
+        }
+
+        m->wire_header = *m->header;
+        m->wire_header.flags |= BUS_MESSAGE_MEMFD_BODY;
+        m->body_memfd = TAKE_FD(fd);
+        m->memfd_body = true;
+
+        return 0;
+}
+
+static int bus_message_setup_iovec(sd_bus *bus, sd_bus_message *m) {
         struct bus_body_part *part;
         unsigned n, i;
         int r;
 
+        assert(bus);
         assert(m);
         assert(m->sealed);
 
@@ -73,6 +130,34 @@ static int bus_message_setup_iovec(sd_bus_message *m) {
 
         assert(!m->iovec);
 
+        /* On connections where both sides agreed to it, larger bodies are passed as sealed memfd, which the
+         * receiver can map instead of copying them through the socket. */
+        if (bus->can_memfd &&
+            !BUS_MESSAGE_IS_GVARIANT(m) &&
+            m->body_size >= MEMFD_MIN_SIZE &&
+            m->n_fds < BUS_FDS_MAX) {
+                r = bus_message_setup_memfd_body(m);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to pass message body as memfd, sending it inline: %m");
+        }
+
+        if (m->memfd_body) {
+                m->iovec = m->iovec_fixed;
+
+                /* Send the header with the memfd flag set, followed by the fields, but not the body */
+                r = append_iovec(m, &m->wire_header, sizeof(struct bus_header));
+                if (r < 0)
+                        goto fail;
+
+                if (BUS_MESSAGE_BODY_BEGIN(m) > sizeof(struct bus_header)) {
+                        r = append_iovec(m, BUS_MESSAGE_FIELDS(m), BUS_MESSAGE_BODY_BEGIN(m) - sizeof(struct bus_header));
+                        if (r < 0)
+                                goto fail;
+                }
+
+                return 0;
+        }
+
         n = 1 + m->n_body_parts;
         if (n < ELEMENTSOF(m->iovec_fixed))
                 m->iovec = m->iovec_fixed;
@@ -156,17 +241,18 @@ static int bus_socket_write_auth(sd_bus *b) {
 }
 
 static int bus_socket_auth_verify_client(sd_bus *b) {
-        char *d, *e, *f, *start;
+        char *d, *e, *f, *g, *start;
         sd_id128_t peer;
         int r;
 
         assert(b);
 
         /*
-         * We expect three response lines:
+         * We expect up to four response lines:
          *   "DATA\r\n"
          *   "OK <server-id>\r\n"
          *   "AGREE_UNIX_FD\r\n"        (optional)
+         *   "AGREE_MEMFD\r\n"          (optional)
          */
 
         d = memmem_safe(b->rbuffer, b->rbuffer_size, "\r\n", 2);
@@ -188,6 +274,17 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
                 start = e + 2;
         }
 
+        if (b->accept_memfd) {
+                assert(f);
+
+                g = memmem(f + 2, b->rbuffer_size - (f - (char*) b->rbuffer) - 2, "\r\n", 2);
+                if (!g)
+                        return 0;
+
+                start = g + 2;
+        } else
+                g = NULL;
+
         /* Nice! We got all the lines we need. First check the DATA line. */
 
         if (d - (char*) b->rbuffer == 4) {
@@ -241,6 +338,15 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
                         memcmp(e + 2, "AGREE_UNIX_FD",
                                STRLEN("AGREE_UNIX_FD")) == 0;
 
+        /* The memfds are passed as fds, hence this is only useful if we may pass those. Note that servers
+         * not implementing this reply with an error line here, which we'll take as refusal. */
+        if (g)
+                b->can_memfd =
+                        b->can_fds &&
+                        (g - f == STRLEN("\r\nAGREE_MEMFD")) &&
+                        memcmp(f + 2, "AGREE_MEMFD",
+                               STRLEN("AGREE_MEMFD")) == 0;
+
         b->rbuffer_size -= (start - (char*) b->rbuffer);
         memmove(b->rbuffer, start, b->rbuffer_size);
 
@@ -490,6 +596,13 @@ static int bus_socket_auth_verify_server(sd_bus *b) {
                                 b->can_fds = true;
                                 r = bus_socket_auth_write(b, "AGREE_UNIX_FD\r\n");
                         }
+                } else if (line_equals(line, l, "NEGOTIATE_MEMFD")) {
+                        if (b->auth == _BUS_AUTH_INVALID || !b->can_fds || !b->accept_memfd)
+                                r = bus_socket_auth_write(b, "ERROR\r\n");
+                        else {
+                                b->can_memfd = true;
+                                r = bus_socket_auth_write(b, "AGREE_MEMFD\r\n");
+                        }
                 } else
                         r = bus_socket_auth_write(b, "ERROR\r\n");
 
@@ -656,6 +769,9 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         static const char sasl_negotiate_unix_fd[] = {
                 "NEGOTIATE_UNIX_FD\r\n"
         };
+        static const char sasl_negotiate_memfd[] = {
+                "NEGOTIATE_MEMFD\r\n"
+        };
         static const char sasl_begin[] = {
                 "BEGIN\r\n"
         };
@@ -671,6 +787,13 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         if (b->accept_fd)
                 b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_unix_fd);
 
+        /* Passing the body as memfd is a private extension of ours, which message brokers don't know how to
+         * forward, hence only ask for it on direct connections. */
+        if (!b->accept_fd || b->bus_client)
+                b->accept_memfd = false;
+        if (b->accept_memfd)
+                b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_memfd);
+
         b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_begin);
 
         return bus_socket_write_auth(b);
@@ -999,56 +1122,84 @@ int bus_socket_take_fd(sd_bus *b) {
         return bus_socket_start_auth(b);
 }
 
-int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+int bus_socket_write_messages(sd_bus *bus, sd_bus_message **messages, size_t n_messages, size_t *idx) {
         struct iovec *iov;
+        sd_bus_message *m;
         ssize_t k;
-        size_t n;
+        size_t i, n_iovec = 0;
         unsigned j;
         int r;
 
         assert(bus);
-        assert(m);
+        assert(messages);
+        assert(n_messages > 0);
         assert(idx);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (*idx >= BUS_MESSAGE_SIZE(m))
+        m = messages[0];
+
+        if (*idx >= BUS_MESSAGE_WIRE_SIZE(m))
                 return 0;
 
-        r = bus_message_setup_iovec(m);
-        if (r < 0)
-                return r;
+        /* Writes the first message from *idx on, followed by as many of the following messages as we can
+         * combine into the same sendmsg(). Fds are attached to the first byte of a write, and the
+         * receiver attributes them to the message starting there, hence a message that passes fds can
+         * only ever start a batch. *idx is advanced by the number of bytes written, which might reach
+         * into the following messages. */
+        for (i = 0; i < n_messages; i++) {
+                r = bus_message_setup_iovec(bus, messages[i]);
+                if (r < 0) {
+                        if (i > 0)
+                                break; /* Let's at least write what we have, the error is seen again later */
+                        return r;
+                }
 
-        n = m->n_iovec * sizeof(struct iovec);
-        iov = newa(struct iovec, n);
-        memcpy_safe(iov, m->iovec, n);
+                if (i > 0 &&
+                    (messages[i]->n_fds > 0 || messages[i]->memfd_body ||
+                     n_iovec + messages[i]->n_iovec > IOV_MAX))
+                        break;
+
+                n_iovec += messages[i]->n_iovec;
+        }
+        n_messages = i;
+
+        iov = newa(struct iovec, n_iovec);
+        for (i = 0, j = 0; i < n_messages; j += messages[i]->n_iovec, i++)
+                memcpy_safe(iov + j, messages[i]->iovec, messages[i]->n_iovec * sizeof(struct iovec));
 
         j = 0;
         iovec_advance(iov, &j, *idx);
 
         if (bus->prefer_writev)
-                k = writev(bus->output_fd, iov, m->n_iovec);
+                k = writev(bus->output_fd, iov, n_iovec);
         else {
                 struct msghdr mh = {
                         .msg_iov = iov,
-                        .msg_iovlen = m->n_iovec,
+                        .msg_iovlen = n_iovec,
                 };
 
-                if (m->n_fds > 0 && *idx == 0) {
+                if ((m->n_fds > 0 || m->memfd_body) && *idx == 0) {
                         struct cmsghdr *control;
+                        size_t n_fds;
 
-                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * m->n_fds);
+                        /* The body memfd always goes first */
+                        n_fds = m->n_fds + m->memfd_body;
+
+                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
                         mh.msg_control = alloca0(mh.msg_controllen);
                         control = CMSG_FIRSTHDR(&mh);
-                        control->cmsg_len = CMSG_LEN(sizeof(int) * m->n_fds);
+                        control->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
                         control->cmsg_level = SOL_SOCKET;
                         control->cmsg_type = SCM_RIGHTS;
-                        memcpy(CMSG_DATA(control), m->fds, sizeof(int) * m->n_fds);
+                        if (m->memfd_body)
+                                ((int*) CMSG_DATA(control))[0] = m->body_memfd;
+                        memcpy_safe((int*) CMSG_DATA(control) + m->memfd_body, m->fds, sizeof(int) * m->n_fds);
                 }
 
                 k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
                 if (k < 0 && errno == ENOTSOCK) {
                         bus->prefer_writev = true;
-                        k = writev(bus->output_fd, iov, m->n_iovec);
+                        k = writev(bus->output_fd, iov, n_iovec);
                 }
         }
 
@@ -1059,16 +1210,21 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         return 1;
 }
 
-static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
+int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+        return bus_socket_write_messages(bus, &m, 1, idx);
+}
+
+static int bus_socket_read_message_need(sd_bus *bus, const void *p, size_t size, size_t *need) {
         uint32_t a, b;
-        uint8_t e;
+        uint8_t e, f;
         uint64_t sum;
 
         assert(bus);
+        assert(p || size == 0);
         assert(need);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (bus->rbuffer_size < sizeof(struct bus_header)) {
+        if (size < sizeof(struct bus_header)) {
                 *need = sizeof(struct bus_header) + 8;
 
                 /* Minimum message size:
@@ -1090,10 +1246,11 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
                 return 0;
         }
 
-        a = ((const uint32_t*) bus->rbuffer)[1];
-        b = ((const uint32_t*) bus->rbuffer)[3];
+        a = unaligned_read_ne32((const uint8_t*) p + 4);
+        b = unaligned_read_ne32((const uint8_t*) p + 12);
 
-        e = ((const uint8_t*) bus->rbuffer)[0];
+        e = ((const uint8_t*) p)[0];
+        f = ((const uint8_t*) p)[2];
         if (e == BUS_LITTLE_ENDIAN) {
                 a = le32toh(a);
                 b = le32toh(b);
@@ -1107,65 +1264,157 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
         if (sum >= BUS_MESSAGE_SIZE_MAX)
                 return -ENOBUFS;
 
+        /* If the body is passed as memfd, it's not in the stream */
+        if (bus->can_memfd && FLAGS_SET(f, BUS_MESSAGE_MEMFD_BODY))
+                sum -= a;
+
         *need = (size_t) sum;
         return 0;
 }
 
-static int bus_socket_make_message(sd_bus *bus, size_t size) {
+static int bus_socket_make_message(sd_bus *bus, size_t offset, size_t size) {
+        _cleanup_free_ int *fds = NULL;
         sd_bus_message *t = NULL;
+        size_t n_fds, n_used = 0;
+        int memfd = -1;
         void *b;
         int r;
 
         assert(bus);
-        assert(bus->rbuffer_size >= size);
+        assert(bus->rbuffer_size >= offset + size);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         r = bus_rqueue_make_room(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size > size) {
-                b = memdup((const uint8_t*) bus->rbuffer + size,
-                           bus->rbuffer_size - size);
+        /* The fds we received so far are attributed in order to the messages that declare them. The
+         * message gets its own copy of the array, the fds beyond what it uses stay with us for the
+         * following messages. */
+        n_fds = bus->n_fds;
+        if (bus->can_memfd && FLAGS_SET(((const uint8_t*) bus->rbuffer + offset)[2], BUS_MESSAGE_MEMFD_BODY)) {
+                /* The body memfd is the first fd passed along */
+                if (n_fds == 0) {
+                        r = -EBADMSG;
+                        goto invalid;
+                }
+
+                memfd = bus->fds[0];
+                n_used = 1;
+        }
+
+        if (n_fds > n_used) {
+                fds = newdup(int, bus->fds + n_used, n_fds - n_used);
+                if (!fds)
+                        return -ENOMEM;
+        }
+
+        /* If the message is all that's in the buffer, hand over the buffer, otherwise copy it out */
+        if (offset == 0 && size == bus->rbuffer_size) {
+                b = realloc(bus->rbuffer, size) ?: bus->rbuffer;
+                bus->rbuffer = NULL;
+                bus->rbuffer_size = 0;
+        } else {
+                b = memdup((const uint8_t*) bus->rbuffer + offset, size);
                 if (!b)
                         return -ENOMEM;
-        } else
-                b = NULL;
-
-        r = bus_message_from_malloc(bus,
-                                    bus->rbuffer, size,
-                                    bus->fds, bus->n_fds,
-                                    NULL,
-                                    &t);
-        if (r == -EBADMSG) {
-                log_debug_errno(r, "Received invalid message from connection %s, dropping.", strna(bus->description));
-                free(bus->rbuffer); /* We want to drop current rbuffer and proceed with whatever remains in b */
-        } else if (r < 0) {
+        }
+
+        if (memfd >= 0)
+                r = bus_message_from_malloc_and_memfd(bus, b, size, memfd, fds, n_fds - n_used, NULL, &t);
+        else
+                r = bus_message_from_malloc(bus, b, size, fds, n_fds - n_used, NULL, &t);
+        if (r < 0) {
+                /* The buffer was not taken over by the message */
                 free(b);
-                return r;
+                if (r != -EBADMSG)
+                        return r;
+
+                goto invalid;
         }
 
-        /* rbuffer ownership was either transferred to t, or we got EBADMSG and dropped it. */
-        bus->rbuffer = b;
-        bus->rbuffer_size -= size;
+        TAKE_PTR(fds);
+        n_used += t->n_fds;
+
+        memmove(bus->fds, bus->fds + n_used, sizeof(int) * (n_fds - n_used));
+        bus->n_fds -= n_used;
+        if (bus->n_fds == 0)
+                bus->fds = mfree(bus->fds);
+
+        t->read_counter = ++bus->read_counter;
+        bus->rqueue[bus->rqueue_size++] = bus_message_ref_queued(t, bus);
+        sd_bus_message_unref(t);
+
+        return 1;
+
+invalid:
+        /* We can't tell which of the fds were meant for the message, hence drop them all, together with
+         * the message. */
+        log_debug_errno(r, "Received invalid message from connection %s, dropping.", strna(bus->description));
 
-        bus->fds = NULL;
+        close_many(bus->fds, bus->n_fds);
+        bus->fds = mfree(bus->fds);
         bus->n_fds = 0;
 
-        if (t) {
-                t->read_counter = ++bus->read_counter;
-                bus->rqueue[bus->rqueue_size++] = bus_message_ref_queued(t, bus);
-                sd_bus_message_unref(t);
+        if (offset == 0 && size == bus->rbuffer_size) {
+                bus->rbuffer = mfree(bus->rbuffer);
+                bus->rbuffer_size = 0;
         }
 
         return 1;
 }
 
+static int bus_socket_make_messages(sd_bus *bus) {
+        size_t offset = 0, need;
+        int r, ret = 0;
+
+        assert(bus);
+
+        /* We read ahead, hence the buffer might contain several complete messages, let's queue all of them
+         * right-away, so that everybody looking at the read queue sees them. */
+        for (;;) {
+                if (!bus->rbuffer)
+                        break;
+
+                r = bus_socket_read_message_need(bus, (const uint8_t*) bus->rbuffer + offset, bus->rbuffer_size - offset, &need);
+                if (r < 0) {
+                        ret = r;
+                        break;
+                }
+
+                if (bus->rbuffer_size - offset < need)
+                        break;
+
+                /* Leave the rest in the buffer if the queue is full, instead of failing */
+                if (ret > 0 && bus->rqueue_size >= BUS_RQUEUE_MAX)
+                        break;
+
+                r = bus_socket_make_message(bus, offset, need);
+                if (r < 0) {
+                        ret = r;
+                        break;
+                }
+
+                offset += need;
+                ret = 1;
+        }
+
+        if (bus->rbuffer && offset > 0) {
+                bus->rbuffer_size -= offset;
+                memmove(bus->rbuffer, (uint8_t*) bus->rbuffer + offset, bus->rbuffer_size);
+        }
+
+        if (bus->rbuffer && bus->rbuffer_size == 0)
+                bus->rbuffer = mfree(bus->rbuffer);
+
+        return ret;
+}
+
 int bus_socket_read_message(sd_bus *bus) {
         struct msghdr mh;
         struct iovec iov = {};
         ssize_t k;
-        size_t need;
+        size_t need, size;
         int r;
         void *b;
         CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(int) * BUS_FDS_MAX)) control;
@@ -1174,20 +1423,25 @@ int bus_socket_read_message(sd_bus *bus) {
         assert(bus);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        r = bus_socket_read_message_need(bus, &need);
+        r = bus_socket_make_messages(bus);
+        if (r != 0)
+                return r;
+
+        r = bus_socket_read_message_need(bus, bus->rbuffer, bus->rbuffer_size, &need);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
+        /* Read at least what the current message needs, but if it's small, also whatever might follow it,
+         * so that bursts of small messages don't cost one syscall each. */
+        size = MAX(need, (size_t) READ_AHEAD_SIZE);
 
-        b = realloc(bus->rbuffer, need);
+        b = realloc(bus->rbuffer, size);
         if (!b)
                 return -ENOMEM;
 
         bus->rbuffer = b;
 
-        iov = IOVEC_MAKE((uint8_t *)bus->rbuffer + bus->rbuffer_size, need - bus->rbuffer_size);
+        iov = IOVEC_MAKE((uint8_t *)bus->rbuffer + bus->rbuffer_size, size - bus->rbuffer_size);
 
         if (bus->prefer_readv) {
                 k = readv(bus->input_fd, &iov, 1);
@@ -1255,13 +1509,10 @@ int bus_socket_read_message(sd_bus *bus) {
                                           cmsg->cmsg_level, cmsg->cmsg_type);
         }
 
-        r = bus_socket_read_message_need(bus, &need);
+        r = bus_socket_make_messages(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
-
         return 1;
 }
 
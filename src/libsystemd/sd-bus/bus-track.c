@@ -8,10 +8,20 @@
 #include "bus-util.h"
 #include "string-util.h"
 
+/* A name tracked on a bus, shared by all sd_bus_track objects on the bus that track it, so that there's
+ * only one match for it, however many of them there are. */
+struct track_name {
+        char *name;
+        sd_bus *bus;
+        sd_bus_slot *slot; /* NULL while bus->track_match covers all names */
+        LIST_HEAD(struct track_item, items);
+};
+
 struct track_item {
         unsigned n_ref;
-        char *name;
-        sd_bus_slot *slot;
+        sd_bus_track *track;
+        struct track_name *shared;
+        LIST_FIELDS(struct track_item, items);
 };
 
 struct sd_bus_track {
@@ -32,21 +42,247 @@ struct sd_bus_track {
         LIST_FIELDS(sd_bus_track, tracks);
 };
 
+#define MATCH_FOR_ALL                                   \
+        "type='signal',"                                \
+        "sender='org.freedesktop.DBus',"                \
+        "path='/org/freedesktop/DBus',"                 \
+        "interface='org.freedesktop.DBus',"             \
+        "member='NameOwnerChanged'"
+
 #define MATCH_FOR_NAME(name)                            \
-        strjoina("type='signal',"                       \
-                 "sender='org.freedesktop.DBus',"       \
-                 "path='/org/freedesktop/DBus',"        \
-                 "interface='org.freedesktop.DBus',"    \
-                 "member='NameOwnerChanged',"           \
-                 "arg0='", name, "'")
+        strjoina(MATCH_FOR_ALL ",arg0='", name, "'")
+
+/* Once this many names are tracked on a bus, a single match for all NameOwnerChanged signals is installed
+ * instead of one match per name, which keeps the AddMatch/RemoveMatch traffic for many short-lived peers
+ * down. We go back to a match per name once the number of names dropped well below that again. */
+#define TRACK_NAMES_MATCH_ALL 32U
+#define TRACK_NAMES_MATCH_EACH (TRACK_NAMES_MATCH_ALL / 4)
+
+static int on_name_owner_changed(sd_bus_message *message, void *userdata, sd_bus_error *error);
+static void bus_track_drop_name(sd_bus *bus, const char *name);
+
+static bool bus_track_match_each_active(sd_bus *bus) {
+        struct track_name *n;
+
+        assert(bus);
+
+        /* Either all tracked names have a match of their own, or none has and the match for all names is
+         * in charge of them. While switching over, both kinds of matches are around. */
+
+        n = hashmap_first(bus->track_names);
+        return !bus->track_match || (n && n->slot);
+}
+
+static int on_match_each_installed(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        sd_bus *bus = sd_bus_message_get_bus(message);
+        struct track_name *n;
+        Iterator i;
+
+        assert(bus);
+
+        if (sd_bus_message_is_method_error(message, NULL)) {
+                log_debug_errno(sd_bus_message_get_errno(message),
+                                "Failed to add match for tracked name: %s", sd_bus_message_get_error(message)->message);
+
+                if (!bus->track_match) {
+                        sd_bus_slot *slot = sd_bus_get_current_slot(bus);
+
+                        /* No fallback, hence we'd never learn that the name went away. Treat it as gone
+                         * right away instead, so that the track objects don't wait for it forever. */
+                        HASHMAP_FOREACH(n, bus->track_names, i)
+                                if (n->slot == slot) {
+                                        bus_track_drop_name(bus, strdupa(n->name));
+                                        break;
+                                }
+
+                        return 0;
+                }
+
+                HASHMAP_FOREACH(n, bus->track_names, i)
+                        n->slot = sd_bus_slot_unref(n->slot);
+                return 0;
+        }
+
+        /* Still waiting for the match for all names itself? Then it will take care of this one. */
+        if (!bus->track_match || bus->track_match->match_callback.install_slot)
+                return 0;
+
+        /* The match for all names has to stay until the bus daemon confirmed every single one of the new
+         * matches, as sd-bus only dispatches messages read after that to them. Note that the match we are
+         * called for is only marked as installed after we return. */
+        HASHMAP_FOREACH(n, bus->track_names, i)
+                if (n->slot && n->slot->match_callback.install_slot && n->slot != sd_bus_get_current_slot(bus))
+                        return 0;
+
+        bus->track_match = sd_bus_slot_unref(bus->track_match);
+        return 0;
+}
+
+static int on_match_all_installed(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        sd_bus *bus = sd_bus_message_get_bus(message);
+        struct track_name *n;
+        Iterator i;
+
+        assert(bus);
+
+        if (sd_bus_message_is_method_error(message, NULL)) {
+                log_debug_errno(sd_bus_message_get_errno(message),
+                                "Failed to add match for all names, keeping a match per tracked name: %s",
+                                sd_bus_message_get_error(message)->message);
+
+                bus->track_match = sd_bus_slot_unref(bus->track_match);
+                return 0;
+        }
+
+        /* Now that the match for all names is in effect, the ones for the individual names are redundant,
+         * unless so many names went away in the meantime that we'd rather keep them. */
+        if (hashmap_size(bus->track_names) < TRACK_NAMES_MATCH_EACH)
+                bus->track_match = sd_bus_slot_unref(bus->track_match);
+        else
+                HASHMAP_FOREACH(n, bus->track_names, i)
+                        n->slot = sd_bus_slot_unref(n->slot);
+
+        return 0;
+}
+
+static int track_name_add_match(struct track_name *n) {
+        assert(n);
+        assert(!n->slot);
+
+        return sd_bus_add_match_async(n->bus, &n->slot, MATCH_FOR_NAME(n->name), on_name_owner_changed,
+                                      n->bus->track_match ? on_match_each_installed : NULL, NULL);
+}
+
+static void bus_track_match_each(sd_bus *bus) {
+        struct track_name *n;
+        Iterator i;
+        int r;
+
+        assert(bus);
+        assert(bus->track_match);
+
+        /* Install the matches for the individual names first, the one for all of them is dropped once they
+         * are in effect, see on_match_each_installed() above. */
+
+        HASHMAP_FOREACH(n, bus->track_names, i) {
+                r = track_name_add_match(n);
+                if (r < 0) {
+                        Iterator j;
+
+                        log_debug_errno(r, "Failed to add match for tracked name, keeping match for all names: %m");
+
+                        HASHMAP_FOREACH(n, bus->track_names, j)
+                                n->slot = sd_bus_slot_unref(n->slot);
+                        return;
+                }
+        }
+}
+
+static void bus_track_match_all(sd_bus *bus) {
+        int r;
+
+        assert(bus);
+        assert(!bus->track_match);
+
+        /* The matches for the individual names are dropped once this one is in effect, see
+         * on_match_all_installed() above. */
+
+        r = sd_bus_add_match_async(bus, &bus->track_match, MATCH_FOR_ALL, on_name_owner_changed, on_match_all_installed, NULL);
+        if (r < 0)
+                log_debug_errno(r, "Failed to add match for all names, keeping a match per tracked name: %m");
+}
+
+static struct track_name* track_name_free(struct track_name *n) {
+        sd_bus *bus;
+
+        if (!n)
+                return NULL;
+
+        assert(!n->items);
+
+        bus = n->bus;
+        assert_se(hashmap_remove(bus->track_names, n->name) == n);
+
+        sd_bus_slot_unref(n->slot);
+        free(n->name);
+        free(n);
+
+        if (hashmap_isempty(bus->track_names)) {
+                bus->track_names = hashmap_free(bus->track_names);
+                bus->track_match = sd_bus_slot_unref(bus->track_match);
+        } else if (!bus_track_match_each_active(bus) && hashmap_size(bus->track_names) < TRACK_NAMES_MATCH_EACH)
+                bus_track_match_each(bus);
+
+        return NULL;
+}
+
+static int track_name_get(sd_bus *bus, const char *name, struct track_name **ret) {
+        struct track_name *n;
+        bool each;
+        int r;
+
+        assert(bus);
+        assert(name);
+        assert(ret);
+
+        n = hashmap_get(bus->track_names, name);
+        if (n) {
+                *ret = n;
+                return 0;
+        }
+
+        each = bus_track_match_each_active(bus);
+
+        r = hashmap_ensure_allocated(&bus->track_names, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        n = new(struct track_name, 1);
+        if (!n)
+                return -ENOMEM;
+
+        *n = (struct track_name) {
+                .name = strdup(name),
+                .bus = bus,
+        };
+        if (!n->name) {
+                free(n);
+                return -ENOMEM;
+        }
+
+        r = hashmap_put(bus->track_names, n->name, n);
+        if (r < 0) {
+                free(n->name);
+                free(n);
+                return r;
+        }
+
+        if (each) {
+                r = track_name_add_match(n);
+                if (r < 0) {
+                        track_name_free(n);
+                        return r;
+                }
+        }
+
+        if (!bus->track_match && hashmap_size(bus->track_names) >= TRACK_NAMES_MATCH_ALL)
+                bus_track_match_all(bus);
+
+        *ret = n;
+        return 1;
+}
 
 static struct track_item* track_item_free(struct track_item *i) {
 
         if (!i)
                 return NULL;
 
-        sd_bus_slot_unref(i->slot);
-        free(i->name);
+        if (i->shared) {
+                LIST_REMOVE(items, i->shared->items, i);
+                if (!i->shared->items)
+                        track_name_free(i->shared);
+        }
+
         return mfree(i);
 }
 
@@ -164,26 +400,42 @@ static sd_bus_track *track_free(sd_bus_track *track) {
 
 DEFINE_PUBLIC_TRIVIAL_REF_UNREF_FUNC(sd_bus_track, sd_bus_track, track_free);
 
+static void bus_track_drop_name(sd_bus *bus, const char *name) {
+        struct track_name *n;
+
+        assert(bus);
+        assert(name);
+
+        /* Drop the name from every track object on this bus. Note that the shared entry goes away together
+         * with its last item, hence look it up again each time. */
+        while ((n = hashmap_get(bus->track_names, name)))
+                bus_track_remove_name_fully(n->items->track, name);
+}
+
 static int on_name_owner_changed(sd_bus_message *message, void *userdata, sd_bus_error *error) {
-        sd_bus_track *track = userdata;
+        sd_bus *bus = sd_bus_message_get_bus(message);
         const char *name, *old, *new;
         int r;
 
         assert(message);
-        assert(track);
+        assert(bus);
 
         r = sd_bus_message_read(message, "sss", &name, &old, &new);
         if (r < 0)
                 return 0;
 
-        bus_track_remove_name_fully(track, name);
+        /* We only track names that exist, hence a name appearing is about an earlier owner we never saw,
+         * which the match for all names might still deliver to us after the name was added. */
+        if (isempty(old))
+                return 0;
+
+        bus_track_drop_name(bus, name);
         return 0;
 }
 
 _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
         _cleanup_(track_item_freep) struct track_item *n = NULL;
         struct track_item *i;
-        const char *match;
         int r;
 
         assert_return(track, -EINVAL);
@@ -211,22 +463,20 @@ _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
         n = new0(struct track_item, 1);
         if (!n)
                 return -ENOMEM;
-        n->name = strdup(name);
-        if (!n->name)
-                return -ENOMEM;
-
-        /* First, subscribe to this name */
-        match = MATCH_FOR_NAME(name);
+        n->track = track;
 
         bus_track_remove_from_queue(track); /* don't dispatch this while we work in it */
 
-        r = sd_bus_add_match_async(track->bus, &n->slot, match, on_name_owner_changed, NULL, track);
+        /* First, subscribe to this name, unless some other track object on this bus already did */
+        r = track_name_get(track->bus, name, &n->shared);
         if (r < 0) {
                 bus_track_add_to_queue(track);
                 return r;
         }
 
-        r = hashmap_put(track->names, n->name, n);
+        LIST_PREPEND(items, n->shared->items, n);
+
+        r = hashmap_put(track->names, n->shared->name, n);
         if (r < 0) {
                 bus_track_add_to_queue(track);
                 return r;
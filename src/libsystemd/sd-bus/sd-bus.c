@@ -41,6 +41,7 @@
 #include "process-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "usdt.h"
 
 #define log_debug_bus_message(m)                                         \
         do {                                                             \
@@ -167,6 +168,8 @@ static sd_bus* bus_free(sd_bus *b) {
         assert(b);
         assert(!b->track_queue);
         assert(!b->tracks);
+        assert(!b->track_names);
+        assert(!b->track_match);
 
         b->state = BUS_CLOSED;
 
@@ -190,6 +193,8 @@ static sd_bus* bus_free(sd_bus *b) {
         bus_close_io_fds(b);
         bus_close_inotify_fd(b);
 
+        b->creds_cache = bus_creds_cache_free(b->creds_cache);
+
         free(b->label);
         free(b->groups);
         free(b->rbuffer);
@@ -221,8 +226,10 @@ static sd_bus* bus_free(sd_bus *b) {
         hashmap_free(b->nodes);
 
         bus_flush_memfd(b);
+        bus_message_pool_flush(b);
 
         assert_se(pthread_mutex_destroy(&b->memfd_cache_mutex) == 0);
+        assert_se(pthread_mutex_destroy(&b->message_pool_mutex) == 0);
 
         return mfree(b);
 }
@@ -246,6 +253,7 @@ _public_ int sd_bus_new(sd_bus **ret) {
                 .message_version = 1,
                 .creds_mask = SD_BUS_CREDS_WELL_KNOWN_NAMES|SD_BUS_CREDS_UNIQUE_NAME,
                 .accept_fd = true,
+                .accept_memfd = true,
                 .original_pid = getpid_cached(),
                 .n_groups = (size_t) -1,
                 .close_on_exit = true,
@@ -256,6 +264,7 @@ _public_ int sd_bus_new(sd_bus **ret) {
                 return -ENOMEM;
 
         assert_se(pthread_mutex_init(&b->memfd_cache_mutex, NULL) == 0);
+        assert_se(pthread_mutex_init(&b->message_pool_mutex, NULL) == 0);
 
         *ret = TAKE_PTR(b);
         return 0;
@@ -1777,6 +1786,23 @@ int bus_seal_synthetic_message(sd_bus *b, sd_bus_message *m) {
         return sd_bus_message_seal(m, 0xFFFFFFFFULL, 0);
 }
 
+static void bus_log_sent_message(sd_bus_message *m) {
+        assert(m);
+
+        log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s cookie=%" PRIu64 " reply_cookie=%" PRIu64 " signature=%s error-name=%s error-message=%s",
+                  bus_message_type_to_string(m->header->type),
+                  strna(sd_bus_message_get_sender(m)),
+                  strna(sd_bus_message_get_destination(m)),
+                  strna(sd_bus_message_get_path(m)),
+                  strna(sd_bus_message_get_interface(m)),
+                  strna(sd_bus_message_get_member(m)),
+                  BUS_MESSAGE_COOKIE(m),
+                  m->reply_cookie,
+                  strna(m->root_container.signature),
+                  strna(m->error.name),
+                  strna(m->error.message));
+}
+
 static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         int r;
 
@@ -1787,19 +1813,8 @@ static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         if (r <= 0)
                 return r;
 
-        if (*idx >= BUS_MESSAGE_SIZE(m))
-                log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s cookie=%" PRIu64 " reply_cookie=%" PRIu64 " signature=%s error-name=%s error-message=%s",
-                          bus_message_type_to_string(m->header->type),
-                          strna(sd_bus_message_get_sender(m)),
-                          strna(sd_bus_message_get_destination(m)),
-                          strna(sd_bus_message_get_path(m)),
-                          strna(sd_bus_message_get_interface(m)),
-                          strna(sd_bus_message_get_member(m)),
-                          BUS_MESSAGE_COOKIE(m),
-                          m->reply_cookie,
-                          strna(m->root_container.signature),
-                          strna(m->error.name),
-                          strna(m->error.message));
+        if (*idx >= BUS_MESSAGE_WIRE_SIZE(m))
+                bus_log_sent_message(m);
 
         return r;
 }
@@ -1811,29 +1826,27 @@ static int dispatch_wqueue(sd_bus *bus) {
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         while (bus->wqueue_size > 0) {
+                size_t n = 0;
 
-                r = bus_write_message(bus, bus->wqueue[0], &bus->windex);
+                /* Write as many of the queued messages as possible in one go */
+                r = bus_socket_write_messages(bus, bus->wqueue, bus->wqueue_size, &bus->windex);
                 if (r < 0)
                         return r;
                 else if (r == 0)
                         /* Didn't do anything this time */
                         return ret;
-                else if (bus->windex >= BUS_MESSAGE_SIZE(bus->wqueue[0])) {
-                        /* Fully written. Let's drop the entry from
-                         * the queue.
-                         *
-                         * This isn't particularly optimized, but
-                         * well, this is supposed to be our worst-case
-                         * buffer only, and the socket buffer is
-                         * supposed to be our primary buffer, and if
-                         * it got full, then all bets are off
-                         * anyway. */
-
-                        bus->wqueue_size--;
-                        bus_message_unref_queued(bus->wqueue[0], bus);
-                        memmove(bus->wqueue, bus->wqueue + 1, sizeof(sd_bus_message*) * bus->wqueue_size);
-                        bus->windex = 0;
 
+                while (n < bus->wqueue_size && bus->windex >= BUS_MESSAGE_WIRE_SIZE(bus->wqueue[n])) {
+                        /* Fully written. Let's drop the entry from the queue. */
+                        bus->windex -= BUS_MESSAGE_WIRE_SIZE(bus->wqueue[n]);
+                        bus_log_sent_message(bus->wqueue[n]);
+                        bus_message_unref_queued(bus->wqueue[n], bus);
+                        n++;
+                }
+
+                if (n > 0) {
+                        bus->wqueue_size -= n;
+                        memmove(bus->wqueue, bus->wqueue + n, sizeof(sd_bus_message*) * bus->wqueue_size);
                         ret = 1;
                 }
         }
@@ -1939,7 +1952,11 @@ _public_ int sd_bus_send(sd_bus *bus, sd_bus_message *_m, uint64_t *cookie) {
         if (m->dont_send)
                 goto finish;
 
-        if (IN_SET(bus->state, BUS_RUNNING, BUS_HELLO) && bus->wqueue_size <= 0) {
+        USDT(sd_bus, message_send, bus, m, m->header->type, BUS_MESSAGE_COOKIE(m), m->path, m->interface, m->member);
+
+        /* If we are attached to an event loop, we queue the message and leave the writing to the next
+         * iteration, so that bursts of messages are written in one go. Otherwise write it right-away. */
+        if (IN_SET(bus->state, BUS_RUNNING, BUS_HELLO) && bus->wqueue_size <= 0 && !bus->event) {
                 size_t idx = 0;
 
                 r = bus_write_message(bus, m, &idx);
@@ -1952,7 +1969,7 @@ _public_ int sd_bus_send(sd_bus *bus, sd_bus_message *_m, uint64_t *cookie) {
                         return r;
                 }
 
-                if (idx < BUS_MESSAGE_SIZE(m))  {
+                if (idx < BUS_MESSAGE_WIRE_SIZE(m))  {
                         /* Wasn't fully written. So let's remember how
                          * much was written. Note that the first entry
                          * of the wqueue array is always allocated so
@@ -2739,6 +2756,8 @@ static int process_message(sd_bus *bus, sd_bus_message *m) {
 
         log_debug_bus_message(m);
 
+        USDT(sd_bus, message_process, bus, m, m->header->type, BUS_MESSAGE_COOKIE(m), m->path, m->interface, m->member);
+
         r = process_hello(bus, m);
         if (r != 0)
                 goto finish;
@@ -2766,6 +2785,8 @@ static int process_message(sd_bus *bus, sd_bus_message *m) {
         r = bus_process_object(bus, m);
 
 finish:
+        USDT(sd_bus, message_process_done, bus, m, r);
+
         bus->current_message = NULL;
         return r;
 }
@@ -16,9 +16,32 @@
 #include "util.h"
 
 #define MAX_SIZE (2*1024*1024)
+#define N_ALLOC_ROUNDS 10000U
 
 static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
 
+/* To report how many allocations a round trip takes, we interpose the glibc allocator and count the calls */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+static uint64_t n_allocations = 0;
+
+void *malloc(size_t size) {
+        n_allocations++;
+        return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+        n_allocations++;
+        return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *p, size_t size) {
+        n_allocations++;
+        return __libc_realloc(p, size);
+}
+
 typedef enum Type {
         TYPE_LEGACY,
         TYPE_DIRECT,
@@ -206,10 +229,60 @@ static void client_chart(Type type, const char *address, const char *server_name
         sd_bus_unref(b);
 }
 
+static void client_alloc(Type type, const char *address, const char *server_name, int fd) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *x = NULL;
+        uint64_t n;
+        unsigned i;
+        sd_bus *b;
+        int r;
+
+        r = sd_bus_new(&b);
+        assert_se(r >= 0);
+
+        if (type == TYPE_DIRECT) {
+                r = sd_bus_set_fd(b, fd, fd);
+                assert_se(r >= 0);
+        } else {
+                r = sd_bus_set_address(b, address);
+                assert_se(r >= 0);
+
+                r = sd_bus_set_bus_client(b, true);
+                assert_se(r >= 0);
+        }
+
+        r = sd_bus_start(b);
+        assert_se(r >= 0);
+
+        /* Warm up, so that we measure the steady state */
+        for (i = 0; i < 100; i++) {
+                r = sd_bus_call_method(b, server_name, "/", "benchmark.server", "Ping", NULL, NULL, NULL);
+                assert_se(r >= 0);
+        }
+
+        n = n_allocations;
+        for (i = 0; i < N_ALLOC_ROUNDS; i++) {
+                r = sd_bus_call_method(b, server_name, "/", "benchmark.server", "Ping", NULL, NULL, NULL);
+                assert_se(r >= 0);
+        }
+        n = n_allocations - n;
+
+        printf("%s: %.2f allocations per round trip\n",
+               type == TYPE_DIRECT ? "DIRECT" : "LEGACY",
+               (double) n / N_ALLOC_ROUNDS);
+        fflush(stdout);
+
+        assert_se(sd_bus_message_new_method_call(b, &x, server_name, "/", "benchmark.server", "Exit") >= 0);
+        assert_se(sd_bus_message_append(x, "t", (uint64_t) n) >= 0);
+        assert_se(sd_bus_send(b, x, NULL) >= 0);
+
+        sd_bus_unref(b);
+}
+
 int main(int argc, char *argv[]) {
         enum {
                 MODE_BISECT,
                 MODE_CHART,
+                MODE_ALLOC,
         } mode = MODE_BISECT;
         Type type = TYPE_LEGACY;
         int i, pair[2] = { -1, -1 };
@@ -226,6 +299,9 @@ int main(int argc, char *argv[]) {
                 if (streq(argv[i], "chart")) {
                         mode = MODE_CHART;
                         continue;
+                } else if (streq(argv[i], "alloc")) {
+                        mode = MODE_ALLOC;
+                        continue;
                 } else if (streq(argv[i], "legacy")) {
                         type = TYPE_LEGACY;
                         continue;
@@ -301,6 +377,10 @@ int main(int argc, char *argv[]) {
                 case MODE_CHART:
                         client_chart(type, address, server_name, pair[1]);
                         break;
+
+                case MODE_ALLOC:
+                        client_alloc(type, address, server_name, pair[1]);
+                        break;
                 }
 
                 _exit(EXIT_SUCCESS);
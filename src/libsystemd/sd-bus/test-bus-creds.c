@@ -1,12 +1,76 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <signal.h>
+#include <unistd.h>
+
 #include "sd-bus.h"
 
+#include "bus-creds.h"
 #include "bus-dump.h"
 #include "bus-util.h"
 #include "cgroup-util.h"
+#include "process-util.h"
 #include "tests.h"
 
+static void test_creds_cache(void) {
+        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *a = NULL, *b = NULL, *c = NULL;
+        const uint64_t mask = SD_BUS_CREDS_AUGMENT|SD_BUS_CREDS_COMM|SD_BUS_CREDS_EUID|SD_BUS_CREDS_CGROUP;
+        Hashmap *cache = NULL;
+        const char *comm_a, *comm_b, *cgroup_a, *cgroup_b;
+        uid_t euid;
+        pid_t pid;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(a = bus_creds_new());
+        assert_se(bus_creds_add_more_cached(&cache, a, mask, getpid_cached(), 0) >= 0);
+        assert_se(sd_bus_creds_get_augmented_mask(a) == (sd_bus_creds_get_mask(a) & ~SD_BUS_CREDS_PID));
+
+        if (hashmap_size(cache) == 0) {
+                log_notice("pidfds not supported, skipping rest of %s", __func__);
+                return;
+        }
+        assert_se(hashmap_size(cache) == 1);
+
+        /* The second lookup is served from the cache, and must result in the same, still augmented data */
+        assert_se(b = bus_creds_new());
+        assert_se(bus_creds_add_more_cached(&cache, b, mask, getpid_cached(), 0) >= 0);
+        assert_se(sd_bus_creds_get_mask(a) == sd_bus_creds_get_mask(b));
+        assert_se(sd_bus_creds_get_augmented_mask(a) == sd_bus_creds_get_augmented_mask(b));
+        assert_se(sd_bus_creds_get_comm(a, &comm_a) >= 0);
+        assert_se(sd_bus_creds_get_comm(b, &comm_b) >= 0);
+        assert_se(streq(comm_a, comm_b));
+        assert_se(sd_bus_creds_get_euid(b, &euid) >= 0);
+        assert_se(euid == geteuid());
+        if (sd_bus_creds_get_cgroup(a, &cgroup_a) >= 0) {
+                assert_se(sd_bus_creds_get_cgroup(b, &cgroup_b) >= 0);
+                assert_se(streq(cgroup_a, cgroup_b));
+        }
+        assert_se(hashmap_size(cache) == 1);
+
+        /* Once a process exited its entry must not be used anymore */
+        pid = fork();
+        assert_se(pid >= 0);
+        if (pid == 0) {
+                pause();
+                _exit(EXIT_SUCCESS);
+        }
+
+        assert_se(c = bus_creds_new());
+        assert_se(bus_creds_add_more_cached(&cache, c, mask, pid, 0) >= 0);
+        assert_se(hashmap_size(cache) == 2);
+        c = sd_bus_creds_unref(c);
+
+        assert_se(kill(pid, SIGKILL) >= 0);
+        assert_se(wait_for_terminate(pid, NULL) >= 0);
+
+        assert_se(c = bus_creds_new());
+        assert_se(bus_creds_add_more_cached(&cache, c, mask, pid, 0) == -ESRCH);
+        assert_se(hashmap_size(cache) == 1);
+
+        bus_creds_cache_free(cache);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *creds = NULL;
         int r;
@@ -31,5 +95,7 @@ int main(int argc, char *argv[]) {
                 bus_creds_dump(creds, NULL, true);
         }
 
+        test_creds_cache();
+
         return 0;
 }
@@ -2,6 +2,7 @@
 
 #include "bus-introspect.h"
 #include "log.h"
+#include "string-util.h"
 #include "tests.h"
 
 #include "test-vtable-data.h"
@@ -23,6 +24,29 @@ static void test_manual_introspection(const sd_bus_vtable vtable[]) {
         fputs("\n", stdout);
 }
 
+static void test_cached_introspection(const sd_bus_vtable vtable[]) {
+        _cleanup_(introspect_free) struct introspect intro = {}, cached = {};
+        _cleanup_free_ char *s = NULL, *t = NULL, *cache = NULL;
+        const char *p;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(introspect_begin(&intro, false) >= 0);
+        assert_se(introspect_write_interface(&intro, "org.foo", vtable) >= 0);
+        assert_se(introspect_write_interface(&intro, "org.foo.bar", vtable) >= 0);
+        assert_se(introspect_finish(&intro, &s) == 0);
+
+        /* The second interface must be generated from the cache, with the same result */
+        assert_se(introspect_begin(&cached, false) >= 0);
+        assert_se(introspect_write_interface_cached(&cached, "org.foo", vtable, &cache) >= 0);
+        assert_se(p = cache);
+        assert_se(introspect_write_interface_cached(&cached, "org.foo.bar", vtable, &cache) >= 0);
+        assert_se(cache == p);
+        assert_se(introspect_finish(&cached, &t) == 0);
+
+        assert_se(streq(s, t));
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_DEBUG);
 
@@ -31,5 +55,8 @@ int main(int argc, char *argv[]) {
         test_manual_introspection(test_vtable_deprecated);
         test_manual_introspection((const sd_bus_vtable *) vtable_format_221);
 
+        test_cached_introspection(test_vtable_1);
+        test_cached_introspection(test_vtable_2);
+
         return 0;
 }
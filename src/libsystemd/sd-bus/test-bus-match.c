@@ -1,9 +1,13 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <sys/socket.h>
+
+#include "alloc-util.h"
 #include "bus-match.h"
 #include "bus-message.h"
 #include "bus-slot.h"
 #include "bus-util.h"
+#include "fd-util.h"
 #include "log.h"
 #include "macro.h"
 #include "memory-util.h"
@@ -59,6 +63,104 @@ static int match_add(sd_bus_slot *slots, struct bus_match_node *root, const char
         return r;
 }
 
+static void test_match_prefix(sd_bus *bus) {
+        struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        sd_bus_slot slots[13];
+
+        /* Namespace and path matches are looked up by prefix, make sure we find exactly the right ones */
+
+        assert_se(match_add(slots, &root, "path_namespace='/'", 1) >= 0);
+        assert_se(match_add(slots, &root, "path_namespace='/a'", 2) >= 0);
+        assert_se(match_add(slots, &root, "path_namespace='/a/b'", 3) >= 0);
+        assert_se(match_add(slots, &root, "path_namespace='/a/bc'", 4) >= 0);
+        assert_se(match_add(slots, &root, "arg0path='/x/'", 5) >= 0);
+        assert_se(match_add(slots, &root, "arg0path='/x/y/z'", 6) >= 0);
+        assert_se(match_add(slots, &root, "arg0path='/x'", 7) >= 0);
+        assert_se(match_add(slots, &root, "arg0path='/'", 8) >= 0);
+        assert_se(match_add(slots, &root, "arg0path='/xy/'", 9) >= 0);
+        assert_se(match_add(slots, &root, "arg1namespace='org.foo'", 10) >= 0);
+        assert_se(match_add(slots, &root, "arg1namespace='org.fo'", 11) >= 0);
+        assert_se(match_add(slots, &root, "arg1namespace='org.foo.bar.baz'", 12) >= 0);
+
+        assert_se(sd_bus_message_new_signal(bus, &m, "/a/b/c", "org.test", "Test") >= 0);
+        assert_se(sd_bus_message_append(m, "ss", "/x/", "org.foo.bar") >= 0);
+        assert_se(sd_bus_message_seal(m, 1, 0) >= 0);
+
+        zero(mask);
+        assert_se(bus_match_run(NULL, &root, m) == 0);
+        assert_se(mask_contains((unsigned[]) { 1, 2, 3, 5, 6, 8, 10 }, 7));
+
+        bus_match_free(&root);
+}
+
+static unsigned n_many_called;
+
+static int many_filter(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        n_many_called++;
+        return 0;
+}
+
+static void test_match_many(sd_bus *bus, enum bus_match_node_type type, unsigned n_matches) {
+        struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ sd_bus_slot *slots = NULL;
+        char buf[32];
+        unsigned i, n_runs = 10;
+
+        log_info("/* %s(%s, %u) */", __func__, bus_match_node_type_to_string(type, buf, sizeof buf), n_matches);
+
+        /* Install lots of matches which all differ in their last label, like PID 1 and logind do it for
+         * their units and sessions, and check that a message is dispatched to the right one of them. */
+
+        slots = new0(sd_bus_slot, n_matches);
+        assert_se(slots);
+
+        for (i = 0; i < n_matches; i++) {
+                struct bus_match_component *components = NULL;
+                unsigned n_components = 0;
+                _cleanup_free_ char *match = NULL;
+
+                switch (type) {
+                case BUS_MATCH_PATH_NAMESPACE:
+                        assert_se(asprintf(&match, "type='signal',path_namespace='/org/freedesktop/unit/u%u'", i) >= 0);
+                        break;
+                case BUS_MATCH_ARG_NAMESPACE:
+                        assert_se(asprintf(&match, "type='signal',arg0namespace='org.freedesktop.unit.u%u'", i) >= 0);
+                        break;
+                case BUS_MATCH_ARG_PATH:
+                        assert_se(asprintf(&match, "type='signal',arg1path='/org/freedesktop/unit/u%u/'", i) >= 0);
+                        break;
+                default:
+                        assert_se(asprintf(&match, "type='signal',path='/org/freedesktop/unit/u%u'", i) >= 0);
+                }
+
+                assert_se(bus_match_parse(match, &components, &n_components) >= 0);
+                slots[i].match_callback.callback = many_filter;
+                assert_se(bus_match_add(&root, components, n_components, &slots[i].match_callback) >= 0);
+                bus_match_parse_free(components, n_components);
+        }
+
+        assert_se(sd_bus_message_new_signal(bus, &m, "/org/freedesktop/unit/u42/sub", "org.test", "Test") >= 0);
+        assert_se(sd_bus_message_append(m, "ss", "org.freedesktop.unit.u42.sub", "/org/freedesktop/unit/u42/sub") >= 0);
+        assert_se(sd_bus_message_seal(m, 1, 0) >= 0);
+
+        n_many_called = 0;
+        for (i = 0; i < n_runs; i++)
+                assert_se(bus_match_run(NULL, &root, m) == 0);
+
+        /* Plain path= matches don't match the sub-object, all others match exactly one */
+        assert_se(n_many_called == (type == BUS_MATCH_PATH ? 0 : n_runs));
+
+        bus_match_free(&root);
+}
+
 static void test_match_scope(const char *match, enum bus_match_scope scope) {
         struct bus_match_component *components = NULL;
         unsigned n_components = 0;
@@ -75,17 +177,18 @@ int main(int argc, char *argv[]) {
 
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_close_pair_ int pair[2] = { -1, -1 };
         enum bus_match_node_type i;
         sd_bus_slot slots[19];
-        int r;
 
         test_setup_logging(LOG_INFO);
 
-        r = sd_bus_open_user(&bus);
-        if (r < 0)
-                r = sd_bus_open_system(&bus);
-        if (r < 0)
-                return log_tests_skipped("Failed to connect to bus");
+        /* We only need the bus connection to create messages, hence one end of a socket pair suffices */
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_fd(bus, pair[0], pair[0]) >= 0);
+        pair[0] = -1;
+        assert_se(sd_bus_start(bus) >= 0);
 
         assert_se(match_add(slots, &root, "arg2='wal\\'do',sender='foo',type='signal',interface='bar.x',", 1) >= 0);
         assert_se(match_add(slots, &root, "arg2='wal\\'do2',sender='foo',type='signal',interface='bar.x',", 2) >= 0);
@@ -137,6 +240,13 @@ int main(int argc, char *argv[]) {
 
         bus_match_free(&root);
 
+        test_match_prefix(bus);
+
+        test_match_many(bus, BUS_MATCH_PATH, 10000);
+        test_match_many(bus, BUS_MATCH_PATH_NAMESPACE, 10000);
+        test_match_many(bus, BUS_MATCH_ARG_NAMESPACE, 10000);
+        test_match_many(bus, BUS_MATCH_ARG_PATH, 10000);
+
         test_match_scope("interface='foobar'", BUS_MATCH_GENERIC);
         test_match_scope("", BUS_MATCH_GENERIC);
         test_match_scope("interface='org.freedesktop.DBus.Local'", BUS_MATCH_LOCAL);
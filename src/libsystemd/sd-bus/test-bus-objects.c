@@ -9,6 +9,7 @@
 #include "bus-dump.h"
 #include "bus-internal.h"
 #include "bus-message.h"
+#include "bus-objects.h"
 #include "bus-util.h"
 #include "log.h"
 #include "macro.h"
@@ -177,6 +178,28 @@ static int emit_object_removed(sd_bus_message *m, void *userdata, sd_bus_error *
         return 1;
 }
 
+static int get_values(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        const char *path;
+
+        assert_se(sd_bus_message_read_strv(m, &names) >= 0);
+
+        assert_se(sd_bus_message_new_method_return(m, &reply) >= 0);
+        assert_se(sd_bus_message_open_container(reply, 'a', "(oa{sv})") >= 0);
+
+        FOREACH_STRING(path, "/value/a", "/value/b", "/foo") {
+                assert_se(sd_bus_message_open_container(reply, 'r', "oa{sv}") >= 0);
+                assert_se(sd_bus_message_append(reply, "o", path) >= 0);
+                assert_se(bus_append_object_properties(sd_bus_message_get_bus(m), reply, path, "org.freedesktop.systemd.ValueTest", names, error) >= 0);
+                assert_se(sd_bus_message_close_container(reply) >= 0);
+        }
+
+        assert_se(sd_bus_message_close_container(reply) >= 0);
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static const sd_bus_vtable vtable[] = {
         SD_BUS_VTABLE_START(0),
         SD_BUS_METHOD("AlterSomething", "s", "s", something_handler, 0),
@@ -189,6 +212,7 @@ static const sd_bus_vtable vtable[] = {
         SD_BUS_METHOD("EmitInterfacesRemoved", NULL, NULL, emit_interfaces_removed, 0),
         SD_BUS_METHOD("EmitObjectAdded", NULL, NULL, emit_object_added, 0),
         SD_BUS_METHOD("EmitObjectRemoved", NULL, NULL, emit_object_removed, 0),
+        SD_BUS_METHOD("GetValues", "as", "a(oa{sv})", get_values, 0),
         SD_BUS_VTABLE_END
 };
 
@@ -409,6 +433,29 @@ static int client(struct context *c) {
         assert_se(sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_INTERFACE));
         sd_bus_error_free(&error);
 
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/foo", "org.freedesktop.systemd.test", "GetValues", &error, &reply, "as", 2, "Value3", "Value");
+        assert_se(r >= 0);
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "(oa{sv})") > 0);
+        FOREACH_STRING(s, "/value/a", "/value/b") {
+                _cleanup_free_ char *expected = NULL;
+                const char *p, *k1, *v1, *k2, *v2;
+
+                assert_se(asprintf(&expected, "object %p, path %s", UINT_TO_PTR(30), s) >= 0);
+
+                assert_se(sd_bus_message_read(reply, "(oa{sv})", &p, 2, &k1, "s", &v1, &k2, "s", &v2) > 0);
+                assert_se(streq(p, s));
+                assert_se(streq(k1, "Value") && streq(v1, expected));
+                assert_se(streq(k2, "Value3") && streq(v2, expected));
+        }
+        /* The interface isn't registered on /foo, hence no properties */
+        assert_se(sd_bus_message_read(reply, "(oa{sv})", &s, 0) > 0);
+        assert_se(streq(s, "/foo"));
+        assert_se(sd_bus_message_exit_container(reply) >= 0);
+
+        sd_bus_message_unref(reply);
+        reply = NULL;
+
         r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/foo", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects", &error, &reply, "");
         assert_se(r < 0);
         assert_se(sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD));
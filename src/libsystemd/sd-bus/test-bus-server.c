@@ -1,16 +1,24 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "sd-bus.h"
+#include "sd-event.h"
 
 #include "bus-internal.h"
+#include "bus-message.h"
 #include "bus-util.h"
+#include "fd-util.h"
 #include "log.h"
 #include "macro.h"
 #include "memory-util.h"
 
+#define BLOB_SIZE (1024U*1024U)
+#define N_PINGS 200U
+
 struct context {
         int fds[2];
 
@@ -74,6 +82,63 @@ static void *server(void *p) {
 
                         quit = true;
 
+                } else if (sd_bus_message_is_method_call(m, "org.freedesktop.systemd.test", "Blob")) {
+                        _cleanup_free_ uint8_t *blob = NULL;
+
+                        /* Large enough to be passed as memfd, if that was negotiated */
+                        blob = malloc(BLOB_SIZE);
+                        assert_se(blob);
+                        for (size_t i = 0; i < BLOB_SIZE; i++)
+                                blob[i] = (uint8_t) i;
+
+                        r = sd_bus_message_new_method_return(m, &reply);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to allocate return: %m");
+                                goto fail;
+                        }
+
+                        r = sd_bus_message_append_array(reply, 'y', blob, BLOB_SIZE);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to append blob: %m");
+                                goto fail;
+                        }
+
+                } else if (sd_bus_message_is_method_call(m, "org.freedesktop.systemd.test", "Ping")) {
+                        uint32_t i;
+
+                        r = sd_bus_message_read(m, "u", &i);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to read ping: %m");
+                                goto fail;
+                        }
+
+                        /* Make sure the fd we got is the one sent with this very message */
+                        if (sd_bus_message_has_signature(m, "uh")) {
+                                uint8_t x;
+                                int fd;
+
+                                r = sd_bus_message_read(m, "h", &fd);
+                                if (r < 0) {
+                                        log_error_errno(r, "Failed to read fd: %m");
+                                        goto fail;
+                                }
+
+                                assert_se(read(fd, &x, 1) == 1);
+                                assert_se(x == (uint8_t) i);
+                        }
+
+                        r = sd_bus_message_new_method_return(m, &reply);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to allocate return: %m");
+                                goto fail;
+                        }
+
+                        r = sd_bus_message_append(reply, "u", i);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to append pong: %m");
+                                goto fail;
+                        }
+
                 } else if (sd_bus_message_is_method_call(m, NULL, NULL)) {
                         r = sd_bus_message_new_method_error(
                                         m,
@@ -105,10 +170,84 @@ fail:
         return INT_TO_PTR(r);
 }
 
+static int pong_handler(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        unsigned *n_pongs = userdata;
+        uint32_t i;
+
+        assert_se(!sd_bus_message_is_method_error(m, NULL));
+        assert_se(sd_bus_message_read(m, "u", &i) >= 0);
+        assert_se(i == *n_pongs);
+
+        (*n_pongs)++;
+        return 0;
+}
+
+static int client_pings(sd_bus *bus) {
+        unsigned n_pongs = 0;
+        uint32_t i;
+        int r;
+
+        /* While attached to an event loop messages are queued, and then written together */
+        assert_se(sd_bus_attach_event(bus, NULL, 0) >= 0);
+
+        for (i = 0; i < N_PINGS; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                r = sd_bus_message_new_method_call(
+                                bus,
+                                &m,
+                                "org.freedesktop.systemd.test",
+                                "/",
+                                "org.freedesktop.systemd.test",
+                                "Ping");
+                if (r < 0)
+                        return log_error_errno(r, "Failed to allocate method call: %m");
+
+                r = sd_bus_message_append(m, "u", i);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to append ping: %m");
+
+                /* Pass an fd with some of them, which needs to arrive with the right message */
+                if (i % 7 == 0 && sd_bus_can_send(bus, 'h') > 0) {
+                        _cleanup_close_pair_ int pipe_fds[2] = { -1, -1 };
+                        uint8_t x = (uint8_t) i;
+
+                        assert_se(pipe2(pipe_fds, O_CLOEXEC) >= 0);
+                        assert_se(write(pipe_fds[1], &x, 1) == 1);
+
+                        r = sd_bus_message_append(m, "h", pipe_fds[0]);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to append fd: %m");
+                }
+
+                r = sd_bus_call_async(bus, NULL, m, pong_handler, &n_pongs, 0);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to issue method call: %m");
+        }
+
+        assert_se(bus->wqueue_size == N_PINGS);
+        assert_se(sd_bus_flush(bus) >= 0);
+        assert_se(bus->wqueue_size == 0);
+
+        assert_se(sd_bus_detach_event(bus) >= 0);
+
+        while (n_pongs < N_PINGS) {
+                r = sd_bus_process(bus, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to process: %m");
+                if (r == 0)
+                        assert_se(sd_bus_wait(bus, (uint64_t) -1) >= 0);
+        }
+
+        return 0;
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        const void *blob;
+        size_t blob_size;
         int r;
 
         assert_se(sd_bus_new(&bus) >= 0);
@@ -117,6 +256,36 @@ static int client(struct context *c) {
         assert_se(sd_bus_set_anonymous(bus, c->client_anonymous_auth) >= 0);
         assert_se(sd_bus_start(bus) >= 0);
 
+        r = sd_bus_call_method(
+                        bus,
+                        "org.freedesktop.systemd.test",
+                        "/",
+                        "org.freedesktop.systemd.test",
+                        "Blob",
+                        &error,
+                        &reply,
+                        NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue method call: %s", bus_error_message(&error, -r));
+
+        /* Both sides are sd-bus, hence the body should be passed as memfd whenever fds may be passed */
+        assert_se((reply->body.memfd >= 0) == (c->server_negotiate_unix_fds && c->client_negotiate_unix_fds));
+        assert_se(bus->can_memfd == (reply->body.memfd >= 0));
+
+        r = sd_bus_message_read_array(reply, 'y', &blob, &blob_size);
+        if (r < 0)
+                return log_error_errno(r, "Failed to read blob: %m");
+
+        assert_se(blob_size == BLOB_SIZE);
+        for (size_t i = 0; i < BLOB_SIZE; i++)
+                assert_se(((const uint8_t*) blob)[i] == (uint8_t) i);
+
+        reply = sd_bus_message_unref(reply);
+
+        r = client_pings(bus);
+        if (r < 0)
+                return r;
+
         r = sd_bus_message_new_method_call(
                         bus,
                         &m,
@@ -41,6 +41,60 @@ static int track_cb_y(sd_bus_track *t, void *userdata) {
         return 0;
 }
 
+static unsigned n_track_cb_many = 0;
+
+static int track_cb_many(sd_bus_track *t, void *userdata) {
+
+        assert_se(sd_bus_track_count(t) == 0);
+
+        /* Both track objects are empty now, i.e. we saw all names disappear */
+        if (++n_track_cb_many == 2)
+                assert_se(sd_event_exit(sd_bus_get_event(sd_bus_track_get_bus(t)), EXIT_SUCCESS) >= 0);
+
+        return 0;
+}
+
+static void test_many_names(bool use_system_bus) {
+        _cleanup_(sd_event_unrefp) sd_event *event = NULL;
+        _cleanup_(sd_bus_track_unrefp) sd_bus_track *x = NULL, *y = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *a = NULL;
+        sd_bus *peers[64] = {};
+        const char *unique;
+
+        /* Track more names than we install a match each for, with two track objects sharing half of them,
+         * and make sure we still notice all of them going away. */
+
+        assert_se(sd_event_new(&event) >= 0);
+
+        assert_se((use_system_bus ? sd_bus_open_system(&a) : sd_bus_open_user(&a)) >= 0);
+        assert_se(sd_bus_attach_event(a, event, SD_EVENT_PRIORITY_NORMAL) >= 0);
+
+        for (size_t i = 0; i < ELEMENTSOF(peers); i++) {
+                assert_se((use_system_bus ? sd_bus_open_system(&peers[i]) : sd_bus_open_user(&peers[i])) >= 0);
+                assert_se(sd_bus_get_unique_name(peers[i], &unique) >= 0);
+
+                if (!x)
+                        assert_se(sd_bus_track_new(a, &x, track_cb_many, NULL) >= 0);
+                assert_se(sd_bus_track_add_name(x, unique) > 0);
+
+                if (i % 2 != 0)
+                        continue;
+
+                if (!y)
+                        assert_se(sd_bus_track_new(a, &y, track_cb_many, NULL) >= 0);
+                assert_se(sd_bus_track_add_name(y, unique) > 0);
+        }
+
+        assert_se(sd_bus_track_count(x) == ELEMENTSOF(peers));
+        assert_se(sd_bus_track_count(y) == ELEMENTSOF(peers) / 2);
+
+        for (size_t i = 0; i < ELEMENTSOF(peers); i++)
+                peers[i] = sd_bus_flush_close_unref(peers[i]);
+
+        assert_se(sd_event_loop(event) >= 0);
+        assert_se(n_track_cb_many == 2);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_(sd_event_unrefp) sd_event *event = NULL;
         _cleanup_(sd_bus_track_unrefp) sd_bus_track *x = NULL, *y = NULL;
@@ -104,5 +158,7 @@ int main(int argc, char *argv[]) {
         assert_se(track_cb_called_x);
         assert_se(track_cb_called_y);
 
+        test_many_names(use_system_bus);
+
         return 0;
 }
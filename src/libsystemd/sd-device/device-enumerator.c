@@ -7,9 +7,12 @@
 
 #include "alloc-util.h"
 #include "device-enumerator-private.h"
+#include "device-internal.h"
 #include "device-util.h"
 #include "dirent-util.h"
 #include "fd-util.h"
+#include "fs-util.h"
+#include "path-util.h"
 #include "set.h"
 #include "sort-util.h"
 #include "string-util.h"
@@ -406,6 +409,67 @@ static bool match_sysname(sd_device_enumerator *enumerator, const char *sysname)
         return false;
 }
 
+static int device_new_from_enumerated_link(sd_device **ret, const char *path, DIR *dir, const char *name) {
+        _cleanup_(sd_device_unrefp) sd_device *device = NULL;
+        _cleanup_free_ char *target = NULL, *syspath = NULL;
+        const char *p, *s, *uevent;
+        size_t n;
+        int r;
+
+        assert(ret);
+        assert(path);
+        assert(endswith(path, "/"));
+        assert(dir);
+        assert(name);
+
+        /* The entries of /sys/class/ and /sys/bus/ are relative symlinks into /sys/devices/, and the
+         * directories below /sys/devices/ are never symlinks themselves. Hence resolve such a link
+         * textually instead of letting sd_device_new_from_syspath() canonicalize the path component by
+         * component, which is by far the most expensive part of enumerating a device. Returns 0 if
+         * the entry does not look like that, and the caller should fall back to the full lookup. */
+
+        r = readlinkat_malloc(dirfd(dir), name, &target);
+        if (r == -ENOENT)
+                return -ENODEV; /* this is necessarily racey, so ignore missing devices */
+        if (r < 0)
+                return 0;
+
+        n = strlen(path);
+        for (p = target; (s = startswith(p, "../")); p = s) {
+                /* drop the last component of the directory, which always ends in a slash */
+                if (n <= 1)
+                        return 0;
+                for (n--; n > 0 && path[n - 1] != '/'; n--)
+                        ;
+        }
+
+        if (!path_is_normalized(p))
+                return 0;
+
+        syspath = strndup(path, n);
+        if (!syspath || !strextend(&syspath, p, NULL))
+                return -ENOMEM;
+
+        if (!path_startswith(syspath, "/sys/devices/"))
+                return 0;
+
+        /* all 'devices' require an 'uevent' file */
+        uevent = strjoina(syspath, "/uevent");
+        if (access(uevent, F_OK) < 0)
+                return errno == ENOENT ? -ENODEV : -errno;
+
+        r = device_new_aux(&device);
+        if (r < 0)
+                return r;
+
+        r = device_set_syspath(device, syspath, false);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(device);
+        return 1;
+}
+
 static int enumerator_scan_dir_and_add_devices(sd_device_enumerator *enumerator, const char *basedir, const char *subdir1, const char *subdir2) {
         _cleanup_closedir_ DIR *dir = NULL;
         char *path;
@@ -440,7 +504,9 @@ static int enumerator_scan_dir_and_add_devices(sd_device_enumerator *enumerator,
 
                 (void) sprintf(syspath, "%s%s", path, dent->d_name);
 
-                k = sd_device_new_from_syspath(&device, syspath);
+                k = dent->d_type == DT_LNK ? device_new_from_enumerated_link(&device, path, dir, dent->d_name) : 0;
+                if (k == 0)
+                        k = sd_device_new_from_syspath(&device, syspath);
                 if (k < 0) {
                         if (k != -ENODEV)
                                 /* this is necessarily racey, so ignore missing devices */
@@ -8,6 +8,24 @@
 #include "set.h"
 #include "time-util.h"
 
+/* The contents of all files in /run/udev/data/ in one file, so that clients can look up many devices
+ * without opening a file for each of them: the header is followed by the entries sorted by id, which
+ * point to the NUL-terminated ids and the contents of the files stored after them. udevd writes it once
+ * its event queue is idle, and it is removed before any of the files is changed, so that whenever it
+ * exists it matches the files. */
+typedef struct DeviceDBSnapshotHeader {
+        uint8_t signature[8];
+        uint64_t n_entries;
+} DeviceDBSnapshotHeader;
+
+typedef struct DeviceDBSnapshotEntry {
+        uint64_t id_offset;
+        uint64_t data_offset;
+        uint64_t data_size;
+} DeviceDBSnapshotEntry;
+
+#define DEVICE_DB_SNAPSHOT_SIGNATURE ((const uint8_t[]) { 'U', 'D', 'E', 'V', 'D', 'B', 0, 1 })
+
 struct sd_device {
         unsigned n_ref;
 
@@ -49,6 +67,7 @@ struct sd_device {
         size_t properties_nulstr_len;
 
         char *syspath;
+        int sysfs_fd; /* O_PATH fd of the syspath, to look up sysattrs relative to it */
         const char *devpath;
         const char *sysnum;
         char *sysname;
@@ -71,6 +90,7 @@ struct sd_device {
 
         bool parent_set:1; /* no need to try to reload parent */
         bool sysattrs_read:1; /* don't try to re-read sysattrs once read */
+        bool keep_sysfs_fd:1; /* keep sysfs_fd open while the device object is around, inherited by parents */
         bool property_tags_outdated:1; /* need to update TAGS= property */
         bool property_devlinks_outdated:1; /* need to update DEVLINKS= property */
         bool properties_buf_outdated:1; /* need to reread hashmap */
@@ -660,6 +660,10 @@ _public_ int sd_device_monitor_filter_update(sd_device_monitor *m) {
                         uint32_t tag_bloom_hi = tag_bloom_bits >> 32;
                         uint32_t tag_bloom_lo = tag_bloom_bits & 0xffffffff;
 
+                        /* each tag match takes 6 instructions, followed by the final drop and pass */
+                        if (i + 6 + 2 > ELEMENTSOF(ins))
+                                return -E2BIG;
+
                         /* load device bloom bits in A */
                         bpf_stmt(ins, &i, BPF_LD|BPF_W|BPF_ABS, offsetof(monitor_netlink_header, filter_tag_bloom_hi));
                         /* clear bits (tag bits & bloom bits) */
@@ -685,6 +689,10 @@ _public_ int sd_device_monitor_filter_update(sd_device_monitor *m) {
                 HASHMAP_FOREACH_KEY(devtype, subsystem, m->subsystem_filter, it) {
                         uint32_t hash = string_hash32(subsystem);
 
+                        /* each subsystem match takes up to 5 instructions, followed by the final drop and pass */
+                        if (i + 5 + 2 > ELEMENTSOF(ins))
+                                return -E2BIG;
+
                         /* load device subsystem value in A */
                         bpf_stmt(ins, &i, BPF_LD|BPF_W|BPF_ABS, offsetof(monitor_netlink_header, filter_subsystem_hash));
                         if (!devtype) {
@@ -702,9 +710,6 @@ _public_ int sd_device_monitor_filter_update(sd_device_monitor *m) {
 
                         /* matched, pass packet */
                         bpf_stmt(ins, &i, BPF_RET|BPF_K, 0xffffffff);
-
-                        if (i+1 >= ELEMENTSOF(ins))
-                                return -E2BIG;
                 }
 
                 /* nothing matched, drop packet */
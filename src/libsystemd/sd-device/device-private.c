@@ -10,6 +10,7 @@
 #include "device-internal.h"
 #include "device-private.h"
 #include "device-util.h"
+#include "dirent-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
@@ -20,6 +21,7 @@
 #include "parse-util.h"
 #include "path-util.h"
 #include "set.h"
+#include "sort-util.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -861,6 +863,12 @@ void device_set_db_persist(sd_device *device) {
         device->db_persist = true;
 }
 
+void device_set_keep_sysfs_fd(sd_device *device) {
+        assert(device);
+
+        device->keep_sysfs_fd = true;
+}
+
 int device_update_db(sd_device *device) {
         const char *id;
         char *path;
@@ -879,6 +887,10 @@ int device_update_db(sd_device *device) {
 
         path = strjoina("/run/udev/data/", id);
 
+        /* the snapshot must never be older than any of the files */
+        if (unlink(DEVICE_DB_SNAPSHOT_PATH) < 0 && errno != ENOENT)
+                return -errno;
+
         /* do not store anything for otherwise empty devices */
         if (!has_info && major(device->devnum) == 0 && device->ifindex == 0) {
                 r = unlink(path);
@@ -977,6 +989,9 @@ int device_delete_db(sd_device *device) {
 
         path = strjoina("/run/udev/data/", id);
 
+        if (unlink(DEVICE_DB_SNAPSHOT_PATH) < 0 && errno != ENOENT)
+                return -errno;
+
         r = unlink(path);
         if (r < 0 && errno != ENOENT)
                 return -errno;
@@ -984,6 +999,130 @@ int device_delete_db(sd_device *device) {
         return 0;
 }
 
+typedef struct DBSnapshotItem {
+        char *id;
+        char *data;
+        size_t size;
+} DBSnapshotItem;
+
+typedef struct DBSnapshot {
+        DBSnapshotItem *items;
+        size_t n_items;
+        size_t n_allocated;
+} DBSnapshot;
+
+static void db_snapshot_done(DBSnapshot *s) {
+        assert(s);
+
+        for (size_t i = 0; i < s->n_items; i++) {
+                free(s->items[i].id);
+                free(s->items[i].data);
+        }
+
+        s->items = mfree(s->items);
+        s->n_items = s->n_allocated = 0;
+}
+
+static int db_snapshot_item_compare(const DBSnapshotItem *a, const DBSnapshotItem *b) {
+        return strcmp(a->id, b->id);
+}
+
+static int db_snapshot_read_files(DBSnapshot *s) {
+        _cleanup_closedir_ DIR *dir = NULL;
+        struct dirent *dent;
+        int r;
+
+        assert(s);
+
+        dir = opendir("/run/udev/data");
+        if (!dir)
+                return errno == ENOENT ? 0 : -errno;
+
+        FOREACH_DIRENT(dent, dir, return -errno) {
+                _cleanup_free_ char *id = NULL, *data = NULL;
+                size_t size;
+
+                if (dent->d_type != DT_REG)
+                        continue;
+
+                r = read_full_virtual_file_at(dirfd(dir), dent->d_name, &data, &size);
+                if (r == -ENOENT)
+                        continue;
+                if (r < 0)
+                        return r;
+
+                id = strdup(dent->d_name);
+                if (!id)
+                        return -ENOMEM;
+
+                if (!GREEDY_REALLOC(s->items, s->n_allocated, s->n_items + 1))
+                        return -ENOMEM;
+
+                s->items[s->n_items++] = (DBSnapshotItem) {
+                        .id = TAKE_PTR(id),
+                        .data = TAKE_PTR(data),
+                        .size = size,
+                };
+        }
+
+        typesafe_qsort(s->items, s->n_items, db_snapshot_item_compare);
+        return 0;
+}
+
+int device_write_db_snapshot(void) {
+        _cleanup_(db_snapshot_done) DBSnapshot s = {};
+        _cleanup_(unlink_and_freep) char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        DeviceDBSnapshotHeader h = {};
+        uint64_t offset;
+        int r;
+
+        r = db_snapshot_read_files(&s);
+        if (r < 0)
+                return r;
+
+        r = fopen_temporary(DEVICE_DB_SNAPSHOT_PATH, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        memcpy(h.signature, DEVICE_DB_SNAPSHOT_SIGNATURE, sizeof(h.signature));
+        h.n_entries = s.n_items;
+        fwrite(&h, sizeof(h), 1, f);
+
+        /* The contents of the files are NUL-terminated too, for good measure */
+        offset = sizeof(h) + s.n_items * sizeof(DeviceDBSnapshotEntry);
+        for (size_t i = 0; i < s.n_items; i++) {
+                DeviceDBSnapshotEntry e = {
+                        .id_offset = offset,
+                        .data_offset = offset + strlen(s.items[i].id) + 1,
+                        .data_size = s.items[i].size,
+                };
+
+                fwrite(&e, sizeof(e), 1, f);
+                offset = e.data_offset + e.data_size + 1;
+        }
+
+        for (size_t i = 0; i < s.n_items; i++) {
+                fwrite(s.items[i].id, strlen(s.items[i].id) + 1, 1, f);
+                fwrite(s.items[i].data, s.items[i].size + 1, 1, f);
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), 0644) < 0)
+                return -errno;
+
+        if (rename(temp_path, DEVICE_DB_SNAPSHOT_PATH) < 0)
+                return -errno;
+
+        temp_path = mfree(temp_path);
+
+        log_debug("sd-device: Wrote snapshot of %zu db files to %s.", s.n_items, DEVICE_DB_SNAPSHOT_PATH);
+        return 0;
+}
+
 static const char* const device_action_table[_DEVICE_ACTION_MAX] = {
         [DEVICE_ACTION_ADD]     = "add",
         [DEVICE_ACTION_REMOVE]  = "remove",
@@ -10,6 +10,8 @@
 
 #include "macro.h"
 
+#define DEVICE_DB_SNAPSHOT_PATH "/run/udev/data.bin"
+
 typedef enum DeviceAction {
         DEVICE_ACTION_ADD,
         DEVICE_ACTION_REMOVE,
@@ -41,6 +43,7 @@ void device_seal(sd_device *device);
 void device_set_is_initialized(sd_device *device);
 void device_set_watch_handle(sd_device *device, int fd);
 void device_set_db_persist(sd_device *device);
+void device_set_keep_sysfs_fd(sd_device *device);
 void device_set_devlink_priority(sd_device *device, int priority);
 int device_ensure_usec_initialized(sd_device *device, sd_device *device_old);
 int device_add_devlink(sd_device *device, const char *devlink);
@@ -67,6 +70,7 @@ int device_new_from_synthetic_event(sd_device **new_device, const char *syspath,
 int device_tag_index(sd_device *dev, sd_device *dev_old, bool add);
 int device_update_db(sd_device *device);
 int device_delete_db(sd_device *device);
+int device_write_db_snapshot(void);
 int device_read_db_internal_filename(sd_device *device, const char *filename); /* For fuzzer */
 int device_read_db_internal(sd_device *device, bool force);
 static inline int device_read_db(sd_device *device) {
@@ -2,7 +2,9 @@
 
 #include <ctype.h>
 #include <net/if.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 
 #include "sd-device.h"
@@ -40,6 +42,7 @@ int device_new_aux(sd_device **ret) {
         *device = (sd_device) {
                 .n_ref = 1,
                 .watch_handle = -1,
+                .sysfs_fd = -1,
                 .devmode = (mode_t) -1,
                 .devuid = (uid_t) -1,
                 .devgid = (gid_t) -1,
@@ -54,6 +57,7 @@ static sd_device *device_free(sd_device *device) {
         assert(device);
 
         sd_device_unref(device->parent);
+        safe_close(device->sysfs_fd);
         free(device->syspath);
         free(device->sysname);
         free(device->devtype);
@@ -211,6 +215,7 @@ int device_set_syspath(sd_device *device, const char *_syspath, bool verify) {
 
         free_and_replace(device->syspath, syspath);
         device->devpath = devpath;
+        device->sysfs_fd = safe_close(device->sysfs_fd);
         return 0;
 }
 
@@ -716,6 +721,8 @@ _public_ int sd_device_get_parent(sd_device *child, sd_device **ret) {
                 child->parent_set = true;
 
                 (void) device_new_from_child(&child->parent, child);
+                if (child->parent && child->keep_sysfs_fd)
+                        child->parent->keep_sysfs_fd = true;
         }
 
         if (!child->parent)
@@ -1261,10 +1268,9 @@ int device_get_id_filename(sd_device *device, const char **ret) {
         return 0;
 }
 
-int device_read_db_internal_filename(sd_device *device, const char *filename) {
-        _cleanup_free_ char *db = NULL;
+static int device_parse_db(sd_device *device, char *db, size_t db_len) {
         const char *value;
-        size_t db_len, i;
+        size_t i;
         char key;
         int r;
 
@@ -1277,15 +1283,7 @@ int device_read_db_internal_filename(sd_device *device, const char *filename) {
         } state = PRE_KEY;
 
         assert(device);
-        assert(filename);
-
-        r = read_full_file(filename, &db, &db_len);
-        if (r < 0) {
-                if (r == -ENOENT)
-                        return 0;
-
-                return log_device_debug_errno(device, r, "sd-device: Failed to read db '%s': %m", filename);
-        }
+        assert(db);
 
         /* devices with a database entry are initialized */
         device->is_initialized = true;
@@ -1344,6 +1342,220 @@ int device_read_db_internal_filename(sd_device *device, const char *filename) {
         return 0;
 }
 
+int device_read_db_internal_filename(sd_device *device, const char *filename) {
+        _cleanup_free_ char *db = NULL;
+        size_t db_len;
+        int r;
+
+        assert(device);
+        assert(filename);
+
+        r = read_full_file(filename, &db, &db_len);
+        if (r < 0) {
+                if (r == -ENOENT)
+                        return 0;
+
+                return log_device_debug_errno(device, r, "sd-device: Failed to read db '%s': %m", filename);
+        }
+
+        return device_parse_db(device, db, db_len);
+}
+
+/* The snapshot mapped last. It is shared by all threads, replaced as soon as udevd writes a new one, and
+ * released as soon as it is gone, so that we never pin a deleted file. */
+static struct {
+        pthread_mutex_t mutex;
+        void *map;
+        size_t size;
+        dev_t dev;
+        ino_t ino;
+        usec_t mtime;
+} db_snapshot = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void db_snapshot_release(void) {
+        /* Must be called with the lock held */
+
+        if (db_snapshot.map)
+                (void) munmap(db_snapshot.map, db_snapshot.size);
+
+        db_snapshot.map = NULL;
+        db_snapshot.size = 0;
+}
+
+_destructor_ static void db_snapshot_cleanup(void) {
+        assert_se(pthread_mutex_lock(&db_snapshot.mutex) == 0);
+        db_snapshot_release();
+        assert_se(pthread_mutex_unlock(&db_snapshot.mutex) == 0);
+}
+
+static const char *db_snapshot_string(const void *map, size_t size, uint64_t offset, uint64_t len) {
+        const char *s;
+
+        /* Returns the string of the given length at offset, if it is NUL-terminated and within the map */
+        if (offset > size || len >= size - offset)
+                return NULL;
+
+        s = (const char*) map + offset;
+        return s[len] == '\0' ? s : NULL;
+}
+
+static int db_snapshot_verify(const void *map, size_t size) {
+        const DeviceDBSnapshotHeader *h = map;
+        const DeviceDBSnapshotEntry *entries;
+        const char *previous = NULL;
+
+        if (size < sizeof(DeviceDBSnapshotHeader) ||
+            memcmp(h->signature, DEVICE_DB_SNAPSHOT_SIGNATURE, sizeof(h->signature)) != 0 ||
+            h->n_entries > (size - sizeof(DeviceDBSnapshotHeader)) / sizeof(DeviceDBSnapshotEntry))
+                return -EBADMSG;
+
+        entries = (const DeviceDBSnapshotEntry*) (h + 1);
+        for (uint64_t i = 0; i < h->n_entries; i++) {
+                const char *id;
+
+                if (entries[i].data_offset <= entries[i].id_offset)
+                        return -EBADMSG;
+
+                id = db_snapshot_string(map, size, entries[i].id_offset, entries[i].data_offset - entries[i].id_offset - 1);
+                if (!id ||
+                    !db_snapshot_string(map, size, entries[i].data_offset, entries[i].data_size) ||
+                    (previous && strcmp(previous, id) >= 0))
+                        return -EBADMSG;
+
+                previous = id;
+        }
+
+        return 0;
+}
+
+static int db_snapshot_open(void) {
+        _cleanup_close_ int fd = -1;
+        struct stat fst;
+        void *map;
+        int r;
+
+        /* Must be called with the lock held. The old mapping is out of date in any case. */
+        db_snapshot_release();
+
+        fd = open(DEVICE_DB_SNAPSHOT_PATH, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &fst) < 0)
+                return -errno;
+
+        if (fst.st_size < (off_t) sizeof(DeviceDBSnapshotHeader))
+                return -EBADMSG;
+
+        map = mmap(NULL, fst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+                return -errno;
+
+        r = db_snapshot_verify(map, fst.st_size);
+        if (r < 0) {
+                (void) munmap(map, fst.st_size);
+                return r;
+        }
+
+        db_snapshot.map = map;
+        db_snapshot.size = fst.st_size;
+        db_snapshot.dev = fst.st_dev;
+        db_snapshot.ino = fst.st_ino;
+        db_snapshot.mtime = timespec_load(&fst.st_mtim);
+        return 0;
+}
+
+static int db_snapshot_find(const char *id, char **ret, size_t *ret_size) {
+        const DeviceDBSnapshotEntry *entries;
+        size_t left = 0, right;
+        struct stat st;
+        int r;
+
+        assert(id);
+        assert(ret);
+        assert(ret_size);
+
+        /* Must be called with the lock held. Returns > 0 and a copy of the entry if the device is in the
+         * snapshot, 0 and NULL if it is not, and < 0 if the snapshot can't be used. The snapshot only exists
+         * while it is up to date, hence one stat() of it tells us whether we can trust it. */
+
+        if (stat(DEVICE_DB_SNAPSHOT_PATH, &st) < 0) {
+                db_snapshot_release();
+                return -errno;
+        }
+
+        if (!db_snapshot.map ||
+            st.st_dev != db_snapshot.dev ||
+            st.st_ino != db_snapshot.ino ||
+            timespec_load(&st.st_mtim) != db_snapshot.mtime ||
+            (size_t) st.st_size != db_snapshot.size) {
+                r = db_snapshot_open();
+                if (r < 0)
+                        return r;
+        }
+
+        entries = (const DeviceDBSnapshotEntry*) ((const DeviceDBSnapshotHeader*) db_snapshot.map + 1);
+        right = ((const DeviceDBSnapshotHeader*) db_snapshot.map)->n_entries;
+
+        while (left < right) {
+                size_t mid = left + (right - left) / 2;
+                int c;
+
+                c = strcmp(id, (const char*) db_snapshot.map + entries[mid].id_offset);
+                if (c < 0)
+                        right = mid;
+                else if (c > 0)
+                        left = mid + 1;
+                else {
+                        char *db;
+
+                        /* Copy the entry, as the mapping may go away as soon as we drop the lock */
+                        db = memdup_suffix0((const char*) db_snapshot.map + entries[mid].data_offset, entries[mid].data_size);
+                        if (!db)
+                                return -ENOMEM;
+
+                        *ret = db;
+                        *ret_size = entries[mid].data_size;
+                        return 1;
+                }
+        }
+
+        *ret = NULL;
+        *ret_size = 0;
+        return 0;
+}
+
+static int device_read_db_snapshot(sd_device *device, const char *id) {
+        _cleanup_free_ char *db = NULL;
+        size_t db_len;
+        int r;
+
+        assert(device);
+        assert(id);
+
+        /* Looks the device up in the snapshot of the database written by udevd. Returns 1 if the snapshot
+         * was used, and 0 if the caller has to fall back to the file of the device. */
+
+        assert_se(pthread_mutex_lock(&db_snapshot.mutex) == 0);
+        r = db_snapshot_find(id, &db, &db_len);
+        assert_se(pthread_mutex_unlock(&db_snapshot.mutex) == 0);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0) {
+                if (r != -ENOENT)
+                        log_device_debug_errno(device, r, "sd-device: Failed to map %s, ignoring: %m", DEVICE_DB_SNAPSHOT_PATH);
+                return 0;
+        }
+        if (r == 0)
+                /* Not in the snapshot, hence the device has no database entry */
+                return 1;
+
+        r = device_parse_db(device, db, db_len);
+        return r < 0 ? r : 1;
+}
+
 int device_read_db_internal(sd_device *device, bool force) {
         const char *id, *path;
         int r;
@@ -1357,6 +1569,10 @@ int device_read_db_internal(sd_device *device, bool force) {
         if (r < 0)
                 return r;
 
+        r = device_read_db_snapshot(device, id);
+        if (r != 0)
+                return r < 0 ? r : 0;
+
         path = strjoina("/run/udev/data/", id);
 
         return device_read_db_internal_filename(device, path);
@@ -1755,13 +1971,33 @@ static int device_get_sysattr_value(sd_device *device, const char *_key, const c
         return 0;
 }
 
+static int device_get_sysfs_fd(sd_device *device) {
+        const char *syspath;
+        int r;
+
+        assert(device);
+
+        if (device->sysfs_fd >= 0)
+                return device->sysfs_fd;
+
+        r = sd_device_get_syspath(device, &syspath);
+        if (r < 0)
+                return r;
+
+        device->sysfs_fd = open(syspath, O_PATH|O_DIRECTORY|O_CLOEXEC);
+        if (device->sysfs_fd < 0)
+                return -errno;
+
+        return device->sysfs_fd;
+}
+
 /* We cache all sysattr lookups. If an attribute does not exist, it is stored
  * with a NULL value in the cache, otherwise the returned string is stored */
 _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr, const char **_value) {
         _cleanup_free_ char *value = NULL;
         const char *path, *syspath, *cached_value = NULL;
         struct stat statbuf;
-        int r;
+        int r, dir_fd = -1;
 
         assert_return(device, -EINVAL);
         assert_return(sysattr, -EINVAL);
@@ -1787,7 +2023,17 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
                 return r;
 
         path = prefix_roota(syspath, sysattr);
-        r = lstat(path, &statbuf);
+
+        /* Devices processed by udev get many of their attributes looked up, and so do their parents.
+         * Resolve them relative to the device directory then, instead of walking the whole syspath for
+         * every attribute. Failing to open it, e.g. because we ran out of fds, is not fatal. */
+        if (device->keep_sysfs_fd && !path_is_absolute(sysattr))
+                dir_fd = device_get_sysfs_fd(device);
+
+        if (dir_fd >= 0)
+                r = fstatat(dir_fd, sysattr, &statbuf, AT_SYMLINK_NOFOLLOW);
+        else
+                r = lstat(path, &statbuf);
         if (r < 0) {
                 /* remember that we could not access the sysattr */
                 r = device_add_sysattr_value(device, sysattr, NULL);
@@ -1814,7 +2060,10 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
                 size_t size;
 
                 /* read attribute value */
-                r = read_full_virtual_file(path, &value, &size);
+                if (dir_fd >= 0)
+                        r = read_full_virtual_file_at(dir_fd, sysattr, &value, &size);
+                else
+                        r = read_full_virtual_file(path, &value, &size);
                 if (r < 0)
                         return r;
 
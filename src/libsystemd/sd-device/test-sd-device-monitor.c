@@ -10,6 +10,7 @@
 #include "device-private.h"
 #include "device-util.h"
 #include "macro.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "tests.h"
 #include "util.h"
@@ -157,6 +158,33 @@ static void test_sd_device_monitor_filter_remove(sd_device *device) {
         assert_se(sd_event_loop(sd_device_monitor_get_event(monitor_client)) == 100);
 }
 
+static void test_sd_device_monitor_filter_too_many(void) {
+        _cleanup_(sd_device_monitor_unrefp) sd_device_monitor *m = NULL, *n = NULL;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(device_monitor_new_full(&m, MONITOR_GROUP_NONE, -1) >= 0);
+        assert_se(device_monitor_new_full(&n, MONITOR_GROUP_NONE, -1) >= 0);
+
+        for (unsigned i = 0; i < 100; i++) {
+                char tag[STRLEN("tag") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(tag, "tag%u", i);
+                assert_se(sd_device_monitor_filter_add_match_tag(m, tag) >= 0);
+        }
+
+        assert_se(sd_device_monitor_filter_update(m) == -E2BIG);
+
+        for (unsigned i = 0; i < 120; i++) {
+                char subsystem[STRLEN("subsystem") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(subsystem, "subsystem%u", i);
+                assert_se(sd_device_monitor_filter_add_match_subsystem_devtype(n, subsystem, "devtype") >= 0);
+        }
+
+        assert_se(sd_device_monitor_filter_update(n) == -E2BIG);
+}
+
 static void test_device_copy_properties(sd_device *device) {
         _cleanup_(sd_device_unrefp) sd_device *copy = NULL;
 
@@ -195,6 +223,7 @@ int main(int argc, char *argv[]) {
 
         test_subsystem_filter(loopback);
         test_sd_device_monitor_filter_remove(loopback);
+        test_sd_device_monitor_filter_too_many();
         test_device_copy_properties(loopback);
 
         r = sd_device_new_from_subsystem_sysname(&sda, "block", "sda");
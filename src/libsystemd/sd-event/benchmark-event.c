@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "benchmark.h"
+#include "fd-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+#define N_IDLE_SOURCES 512U
+
+typedef struct Context {
+        sd_event *event;
+        sd_event_source *source;
+        int fd;
+} Context;
+
+static int on_defer(sd_event_source *s, void *userdata) {
+        return 0;
+}
+
+static int on_io(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        uint64_t x;
+
+        assert_se(read(fd, &x, sizeof(x)) == sizeof(x));
+        return 0;
+}
+
+static void bench_defer(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++)
+                assert_se(sd_event_run(c->event, 0) > 0);
+}
+
+static void bench_io(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                assert_se(eventfd_write(c->fd, 1) >= 0);
+                assert_se(sd_event_run(c->event, 0) > 0);
+        }
+}
+
+static void setup(Context *c, bool with_idle_sources) {
+        assert_se(sd_event_new(&c->event) >= 0);
+
+        /* Lots of other registered sources that never fire, like in any long running service */
+        if (with_idle_sources)
+                for (unsigned i = 0; i < N_IDLE_SOURCES; i++) {
+                        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL, *d = NULL;
+                        int fd;
+
+                        assert_se((fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK)) >= 0);
+                        assert_se(sd_event_add_io(c->event, &s, fd, EPOLLIN, on_io, NULL) >= 0);
+                        assert_se(sd_event_source_set_io_fd_own(s, true) >= 0);
+                        assert_se(sd_event_source_set_floating(s, true) >= 0);
+
+                        assert_se(sd_event_add_defer(c->event, &d, on_defer, NULL) >= 0);
+                        assert_se(sd_event_source_set_enabled(d, SD_EVENT_OFF) >= 0);
+                        assert_se(sd_event_source_set_floating(d, true) >= 0);
+
+                        assert_se(sd_event_add_time_relative(c->event, NULL, CLOCK_MONOTONIC, USEC_PER_DAY + i, 0, NULL, NULL) >= 0);
+                }
+}
+
+static void done(Context *c) {
+        c->source = sd_event_source_unref(c->source);
+        c->event = sd_event_unref(c->event);
+        c->fd = safe_close(c->fd);
+}
+
+int main(int argc, char *argv[]) {
+        Context c = { .fd = -1 };
+
+        test_setup_logging(LOG_INFO);
+
+        for (unsigned k = 0; k < 2; k++) {
+                setup(&c, k > 0);
+                assert_se(sd_event_add_defer(c.event, &c.source, on_defer, NULL) >= 0);
+                assert_se(sd_event_source_set_enabled(c.source, SD_EVENT_ON) >= 0);
+                benchmark_run(k > 0 ? "event-dispatch-defer-busy" : "event-dispatch-defer", bench_defer, &c);
+                done(&c);
+
+                setup(&c, k > 0);
+                assert_se((c.fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK)) >= 0);
+                assert_se(sd_event_add_io(c.event, &c.source, c.fd, EPOLLIN, on_io, NULL) >= 0);
+                benchmark_run(k > 0 ? "event-dispatch-io-busy" : "event-dispatch-io", bench_io, &c);
+                done(&c);
+        }
+
+        return 0;
+}
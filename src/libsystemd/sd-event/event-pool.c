@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "event-pool.h"
+#include "event-source.h"
+#include "list.h"
+#include "macro.h"
+
+#define WORKERS_MAX 64U
+
+/* Each worker has its own queue, which submissions are distributed over round-robin. A worker takes work
+ * from the head of its own queue, and when that is empty steals from the tail of the queues of the other
+ * workers, so that a few long running items don't hold up the rest. */
+struct pool_worker {
+        sd_event_pool *pool;
+        pthread_t thread;
+
+        pthread_mutex_t lock;
+        LIST_HEAD(sd_event_source, queue);
+        sd_event_source *queue_tail;
+};
+
+struct sd_event_pool {
+        unsigned n_ref;
+
+        /* Protects n_queued, next_worker and shutdown, and is what idle workers sleep on */
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        unsigned n_queued;
+        bool shutdown;
+
+        unsigned next_worker;
+
+        unsigned n_workers;
+        unsigned n_started;
+        struct pool_worker workers[];
+};
+
+static sd_event_source* worker_take(struct pool_worker *w, bool steal) {
+        sd_event_source *s;
+
+        assert(w);
+
+        assert_se(pthread_mutex_lock(&w->lock) == 0);
+
+        s = steal ? w->queue_tail : w->queue;
+        if (s) {
+                if (s == w->queue_tail)
+                        w->queue_tail = s->work.work_queue_prev;
+                LIST_REMOVE(work.work_queue, w->queue, s);
+                s->work.state = EVENT_WORK_RUNNING;
+        }
+
+        assert_se(pthread_mutex_unlock(&w->lock) == 0);
+
+        return s;
+}
+
+static sd_event_source* pool_take(sd_event_pool *p, struct pool_worker *w) {
+        sd_event_source *s;
+        unsigned i;
+
+        s = worker_take(w, false);
+        if (!s)
+                for (i = 1; i < p->n_workers && !s; i++)
+                        s = worker_take(&p->workers[(w - p->workers + i) % p->n_workers], true);
+        if (!s)
+                return NULL;
+
+        assert_se(pthread_mutex_lock(&p->lock) == 0);
+        assert(p->n_queued > 0);
+        p->n_queued--;
+        assert_se(pthread_mutex_unlock(&p->lock) == 0);
+
+        return s;
+}
+
+static void* worker_thread(void *userdata) {
+        struct pool_worker *w = userdata;
+        sd_event_pool *p = w->pool;
+
+        (void) pthread_setname_np(pthread_self(), "sd-event-pool");
+
+        for (;;) {
+                sd_event_source *s;
+
+                s = pool_take(p, w);
+                if (s) {
+                        source_work_complete(s, s->work.callback(s->userdata));
+                        continue;
+                }
+
+                assert_se(pthread_mutex_lock(&p->lock) == 0);
+                while (p->n_queued == 0 && !p->shutdown)
+                        assert_se(pthread_cond_wait(&p->cond, &p->lock) == 0);
+                if (p->n_queued == 0 && p->shutdown) {
+                        assert_se(pthread_mutex_unlock(&p->lock) == 0);
+                        break;
+                }
+                assert_se(pthread_mutex_unlock(&p->lock) == 0);
+        }
+
+        return NULL;
+}
+
+static sd_event_pool* event_pool_free(sd_event_pool *p) {
+        unsigned i;
+
+        if (!p)
+                return NULL;
+
+        assert_se(pthread_mutex_lock(&p->lock) == 0);
+        assert(p->n_queued == 0);
+        p->shutdown = true;
+        assert_se(pthread_cond_broadcast(&p->cond) == 0);
+        assert_se(pthread_mutex_unlock(&p->lock) == 0);
+
+        for (i = 0; i < p->n_started; i++)
+                (void) pthread_join(p->workers[i].thread, NULL);
+
+        for (i = 0; i < p->n_workers; i++) {
+                assert(!p->workers[i].queue);
+                (void) pthread_mutex_destroy(&p->workers[i].lock);
+        }
+
+        (void) pthread_cond_destroy(&p->cond);
+        (void) pthread_mutex_destroy(&p->lock);
+
+        return mfree(p);
+}
+
+_public_ int sd_event_pool_new(sd_event_pool **ret, unsigned n_threads) {
+        _cleanup_(sd_event_pool_unrefp) sd_event_pool *p = NULL;
+        sigset_t ss, saved_ss;
+        unsigned i;
+        int r, k;
+
+        assert_return(ret, -EINVAL);
+
+        if (n_threads == 0) {
+                long n;
+
+                n = sysconf(_SC_NPROCESSORS_ONLN);
+                n_threads = n > 0 ? (unsigned) n : 1;
+        }
+        n_threads = MIN(n_threads, WORKERS_MAX);
+
+        p = malloc0(offsetof(sd_event_pool, workers) + n_threads * sizeof(struct pool_worker));
+        if (!p)
+                return -ENOMEM;
+
+        p->n_ref = 1;
+        p->n_workers = n_threads;
+        assert_se(pthread_mutex_init(&p->lock, NULL) == 0);
+        assert_se(pthread_cond_init(&p->cond, NULL) == 0);
+
+        for (i = 0; i < n_threads; i++) {
+                p->workers[i].pool = p;
+                assert_se(pthread_mutex_init(&p->workers[i].lock, NULL) == 0);
+        }
+
+        assert_se(sigfillset(&ss) >= 0);
+
+        /* No signals in forked off threads please. We set the mask before forking, so that the threads never
+         * exist with a different mask than a fully blocked one */
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        for (; p->n_started < n_threads; p->n_started++) {
+                r = pthread_create(&p->workers[p->n_started].thread, NULL, worker_thread, &p->workers[p->n_started]);
+                if (r > 0) {
+                        r = -r;
+                        break;
+                }
+        }
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r < 0)
+                return r;
+        if (k > 0)
+                return -k;
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+_public_ sd_event_pool* sd_event_pool_ref(sd_event_pool *p) {
+        if (!p)
+                return NULL;
+
+        /* Pools may be shared between event loops running in different threads */
+        assert_se(__sync_add_and_fetch(&p->n_ref, 1) >= 2);
+        return p;
+}
+
+_public_ sd_event_pool* sd_event_pool_unref(sd_event_pool *p) {
+        if (!p)
+                return NULL;
+
+        if (__sync_sub_and_fetch(&p->n_ref, 1) == 0)
+                event_pool_free(p);
+
+        return NULL;
+}
+
+int event_pool_submit(sd_event_pool *p, sd_event_source *s) {
+        struct pool_worker *w;
+
+        assert(p);
+        assert(s);
+        assert(s->type == SOURCE_WORK);
+        assert(s->work.state == EVENT_WORK_IDLE);
+
+        if (p->n_started == 0)
+                return -ESRCH;
+
+        /* Queue and count the source with the pool lock taken, so that whoever takes it can't decrease
+         * the counter before we increased it. */
+        assert_se(pthread_mutex_lock(&p->lock) == 0);
+
+        w = &p->workers[p->next_worker++ % p->n_workers];
+
+        assert_se(pthread_mutex_lock(&w->lock) == 0);
+        LIST_INSERT_AFTER(work.work_queue, w->queue, w->queue_tail, s);
+        w->queue_tail = s;
+        s->work.worker = w - p->workers;
+        s->work.state = EVENT_WORK_QUEUED;
+        assert_se(pthread_mutex_unlock(&w->lock) == 0);
+
+        p->n_queued++;
+        assert_se(pthread_cond_signal(&p->cond) == 0);
+        assert_se(pthread_mutex_unlock(&p->lock) == 0);
+
+        return 0;
+}
+
+bool event_pool_dequeue(sd_event_pool *p, sd_event_source *s) {
+        struct pool_worker *w;
+        bool removed = false;
+
+        assert(p);
+        assert(s);
+        assert(s->type == SOURCE_WORK);
+        assert(s->work.worker < p->n_workers);
+
+        w = &p->workers[s->work.worker];
+
+        assert_se(pthread_mutex_lock(&w->lock) == 0);
+        if (s->work.state == EVENT_WORK_QUEUED) {
+                if (s == w->queue_tail)
+                        w->queue_tail = s->work.work_queue_prev;
+                LIST_REMOVE(work.work_queue, w->queue, s);
+                s->work.state = EVENT_WORK_IDLE;
+                removed = true;
+        }
+        assert_se(pthread_mutex_unlock(&w->lock) == 0);
+
+        if (removed) {
+                assert_se(pthread_mutex_lock(&p->lock) == 0);
+                assert(p->n_queued > 0);
+                p->n_queued--;
+                assert_se(pthread_mutex_unlock(&p->lock) == 0);
+        }
+
+        return removed;
+}
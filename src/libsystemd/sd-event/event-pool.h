@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include "sd-event.h"
+
+/* The states of work event sources. Transitions from QUEUED to RUNNING happen with the lock of the queue
+ * of the worker the source is queued on taken, from RUNNING to DONE with the work lock of the event loop
+ * taken. */
+typedef enum EventWorkState {
+        EVENT_WORK_IDLE,
+        EVENT_WORK_QUEUED,
+        EVENT_WORK_RUNNING,
+        EVENT_WORK_DONE,
+} EventWorkState;
+
+int event_pool_submit(sd_event_pool *p, sd_event_source *s);
+
+/* Removes the source from its queue, if it didn't start running yet. Returns true if it was removed. */
+bool event_pool_dequeue(sd_event_pool *p, sd_event_source *s);
+
+/* Called from the worker thread, implemented in sd-event.c */
+void source_work_complete(sd_event_source *s, int result);
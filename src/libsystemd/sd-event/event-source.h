@@ -7,6 +7,8 @@
 
 #include "sd-event.h"
 
+#include "event-pool.h"
+#include "event-uring.h"
 #include "fs-util.h"
 #include "hashmap.h"
 #include "list.h"
@@ -26,6 +28,9 @@ typedef enum EventSourceType {
         SOURCE_EXIT,
         SOURCE_WATCHDOG,
         SOURCE_INOTIFY,
+        SOURCE_ASYNC,
+        SOURCE_WORK,
+        SOURCE_MEMORY_PRESSURE,
         _SOURCE_EVENT_SOURCE_TYPE_MAX,
         _SOURCE_EVENT_SOURCE_TYPE_INVALID = -1
 } EventSourceType;
@@ -43,6 +48,7 @@ typedef enum WakeupType {
 } WakeupType;
 
 struct inode_data;
+struct source_statistics;
 
 struct sd_event_source {
         WakeupType wakeup;
@@ -55,7 +61,7 @@ struct sd_event_source {
 
         char *description;
 
-        EventSourceType type:5;
+        EventSourceType type:6;
         signed int enabled:3;
         bool pending:1;
         bool dispatching:1;
@@ -67,6 +73,10 @@ struct sd_event_source {
         uint64_t pending_iteration;
         uint64_t prepare_iteration;
 
+        /* Only maintained with statistics enabled, see sd_event_set_statistics() */
+        usec_t pending_since;
+        struct source_statistics *statistics;
+
         sd_event_destroy_t destroy_callback;
 
         LIST_FIELDS(sd_event_source, sources);
@@ -85,6 +95,10 @@ struct sd_event_source {
                         usec_t next, accuracy;
                         unsigned earliest_index;
                         unsigned latest_index;
+                        bool wheel:1; /* kept in the clock's timer wheel instead of the prioqs */
+                        uint8_t wheel_level;
+                        uint8_t wheel_slot;
+                        LIST_FIELDS(sd_event_source, wheel);
                 } time;
                 struct {
                         sd_event_signal_handler_t callback;
@@ -116,12 +130,59 @@ struct sd_event_source {
                 struct {
                         sd_event_inotify_handler_t callback;
                         uint32_t mask;
+                        bool coalesce:1; /* merge buffered events for the same inode and name */
                         struct inode_data *inode_data;
                         LIST_FIELDS(sd_event_source, by_inode_data);
                 } inotify;
+                struct {
+                        sd_event_async_handler_t callback;
+                        EventURingOp op;
+                        int fd;
+                        void *buf;     /* or the struct msghdr for EVENT_URING_RECVMSG */
+                        uint32_t size;
+                        uint64_t offset;
+                        uint32_t flags;
+                        int result;
+                        bool in_flight:1;
+                        bool cancelling:1; /* completion is to be swallowed */
+                } async;
+                struct {
+                        sd_event_work_handler_t callback; /* runs in a worker thread of the pool */
+                        sd_event_work_done_handler_t done;
+                        sd_event_pool *pool;
+                        int result;
+                        EventWorkState state;
+                        unsigned worker;
+                        /* Either in the queue of the worker, or in the list of completed work of the loop */
+                        LIST_FIELDS(sd_event_source, work_queue);
+                } work;
+                struct {
+                        sd_event_handler_t callback;
+                        int fd; /* the PSI trigger, owned by the source */
+                        bool registered:1;
+                } memory_pressure;
         };
 };
 
+/* Time sources with a coarse accuracy on clocks that don't jump are kept in a hierarchical timer wheel
+ * rather than the prioqs, so that re-arming them is O(1). Level 0 has one slot per tick, each slot of a
+ * higher level covers a whole round of the level below, and is redistributed to the lower levels when that
+ * round begins. */
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_DUE TIMER_WHEEL_LEVELS             /* already elapsed when queued */
+#define TIMER_WHEEL_PARKED (TIMER_WHEEL_LEVELS + 1)    /* off, pending or infinite */
+
+struct timer_wheel {
+        uint64_t base;   /* the next tick to process */
+        usec_t offset;   /* ticks are aligned to this, see timer_wheel_tick() */
+        uint64_t occupied[TIMER_WHEEL_LEVELS];
+        LIST_HEAD(sd_event_source, slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]);
+        LIST_HEAD(sd_event_source, due);
+        LIST_HEAD(sd_event_source, parked);
+};
+
 struct clock_data {
         WakeupType wakeup;
         int fd;
@@ -137,6 +198,8 @@ struct clock_data {
         Prioq *latest;
         usec_t next;
 
+        struct timer_wheel *wheel;
+
         bool needs_rearm:1;
 };
 
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#include "alloc-util.h"
+#include "event-uring.h"
+#include "fd-util.h"
+#include "missing_syscall.h"
+
+/* We need IORING_FEAT_EXT_ARG (kernel 5.11) in order to wait with a timeout without using up a submission
+ * queue entry, which also implies everything else we use. */
+#if HAVE_LINUX_IO_URING_H && defined(IORING_FEAT_EXT_ARG)
+
+#define EVENT_URING_ENTRIES 256U
+
+struct EventURing {
+        int fd;
+
+        void *sq_ring;
+        size_t sq_ring_size;
+        void *cq_ring;
+        size_t cq_ring_size;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+
+        unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        struct io_uring_cqe *cqes;
+        unsigned sq_entries;
+
+        unsigned sq_queued_tail; /* our copy of the tail, published to the kernel on submission */
+};
+
+EventURing *event_uring_free(EventURing *u) {
+        if (!u)
+                return NULL;
+
+        if (u->sqes)
+                (void) munmap(u->sqes, u->sqes_size);
+        if (u->cq_ring && u->cq_ring != u->sq_ring)
+                (void) munmap(u->cq_ring, u->cq_ring_size);
+        if (u->sq_ring)
+                (void) munmap(u->sq_ring, u->sq_ring_size);
+
+        safe_close(u->fd);
+        return mfree(u);
+}
+
+int event_uring_new(EventURing **ret) {
+        _cleanup_(event_uring_freep) EventURing *u = NULL;
+        struct io_uring_params p = {};
+        void *m;
+
+        assert(ret);
+
+        u = new(EventURing, 1);
+        if (!u)
+                return -ENOMEM;
+
+        *u = (EventURing) {
+                .fd = -1,
+        };
+
+        u->fd = (int) syscall(__NR_io_uring_setup, EVENT_URING_ENTRIES, &p);
+        if (u->fd < 0)
+                return -errno;
+
+        if (!FLAGS_SET(p.features, IORING_FEAT_EXT_ARG|IORING_FEAT_SINGLE_MMAP|IORING_FEAT_NODROP))
+                return -EOPNOTSUPP;
+
+        u->fd = fd_move_above_stdio(u->fd);
+
+        /* Both rings share one mapping with IORING_FEAT_SINGLE_MMAP */
+        u->sq_ring_size = MAX(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                              p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe));
+        m = mmap(NULL, u->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+        if (m == MAP_FAILED)
+                return -errno;
+        u->sq_ring = u->cq_ring = m;
+        u->cq_ring_size = u->sq_ring_size;
+
+        u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        m = mmap(NULL, u->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQES);
+        if (m == MAP_FAILED)
+                return -errno;
+        u->sqes = m;
+
+        u->sq_head = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.head);
+        u->sq_tail = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.tail);
+        u->sq_mask = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.ring_mask);
+        u->sq_array = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.array);
+        u->cq_head = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.head);
+        u->cq_tail = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.tail);
+        u->cq_mask = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.ring_mask);
+        u->cqes = (struct io_uring_cqe*) ((uint8_t*) u->cq_ring + p.cq_off.cqes);
+        u->sq_entries = p.sq_entries;
+        u->sq_queued_tail = *u->sq_tail;
+
+        *ret = TAKE_PTR(u);
+        return 0;
+}
+
+static int event_uring_submit_and_wait(EventURing *u, unsigned min_complete, const struct timespec *ts) {
+        struct io_uring_getevents_arg arg = {
+                .ts = PTR_TO_UINT64(ts),
+        };
+        unsigned to_submit;
+        int r;
+
+        assert(u);
+
+        /* Publish what we queued. The release store orders the entries before the tail. */
+        to_submit = u->sq_queued_tail - *u->sq_tail;
+        __atomic_store_n(u->sq_tail, u->sq_queued_tail, __ATOMIC_RELEASE);
+
+        if (to_submit == 0 && min_complete == 0)
+                return 0;
+
+        r = (int) syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete,
+                          IORING_ENTER_EXT_ARG | (min_complete > 0 ? IORING_ENTER_GETEVENTS : 0),
+                          &arg, sizeof(arg));
+        if (r < 0)
+                return -errno;
+
+        return 0;
+}
+
+int event_uring_queue(EventURing *u, EventURingOp op, int fd, void *addr, uint32_t len, uint64_t offset, uint32_t flags, uint64_t user_data) {
+        struct io_uring_sqe *sqe;
+        unsigned index;
+        int r;
+
+        assert(u);
+        assert(op >= 0 && op < _EVENT_URING_OP_MAX);
+
+        if (u->sq_queued_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+                /* The submission queue is full, hand what we have to the kernel right away */
+                r = event_uring_submit_and_wait(u, 0, NULL);
+                if (r < 0)
+                        return r;
+
+                if (u->sq_queued_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)
+                        return -EBUSY;
+        }
+
+        index = u->sq_queued_tail & *u->sq_mask;
+        sqe = u->sqes + index;
+        *sqe = (struct io_uring_sqe) {
+                .fd = fd,
+                .off = offset,
+                .addr = PTR_TO_UINT64(addr),
+                .len = len,
+                .user_data = user_data,
+        };
+
+        switch (op) {
+
+        case EVENT_URING_POLL:
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->len = 0;
+                sqe->addr = 0;
+                sqe->poll32_events = len;
+                break;
+
+        case EVENT_URING_READ:
+                sqe->opcode = IORING_OP_READ;
+                sqe->rw_flags = flags;
+                break;
+
+        case EVENT_URING_WRITE:
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->rw_flags = flags;
+                break;
+
+        case EVENT_URING_RECVMSG:
+                sqe->opcode = IORING_OP_RECVMSG;
+                sqe->len = 1;
+                sqe->msg_flags = flags;
+                break;
+
+        case EVENT_URING_CANCEL:
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->len = 0;
+                break;
+
+        default:
+                assert_not_reached("Unknown io_uring operation");
+        }
+
+        u->sq_array[index] = index;
+        u->sq_queued_tail++;
+
+        return 0;
+}
+
+int event_uring_enter(EventURing *u, usec_t timeout) {
+        struct timespec ts;
+        int r;
+
+        assert(u);
+
+        if (timeout == 0)
+                return event_uring_submit_and_wait(u, 0, NULL);
+
+        r = event_uring_submit_and_wait(u, 1, timeout == USEC_INFINITY ? NULL : timespec_store(&ts, timeout));
+        if (r == -ETIME)
+                return 0;
+
+        return r;
+}
+
+int event_uring_next_completion(EventURing *u, uint64_t *ret_user_data, int *ret_result) {
+        struct io_uring_cqe *cqe;
+        unsigned head;
+
+        assert(u);
+        assert(ret_user_data);
+        assert(ret_result);
+
+        head = *u->cq_head;
+        if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+                return 0;
+
+        cqe = u->cqes + (head & *u->cq_mask);
+        *ret_user_data = cqe->user_data;
+        *ret_result = cqe->res;
+
+        __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+        return 1;
+}
+
+bool event_uring_has_queued(EventURing *u) {
+        assert(u);
+
+        return u->sq_queued_tail != *u->sq_tail;
+}
+
+#else
+
+EventURing *event_uring_free(EventURing *u) {
+        assert(!u);
+        return NULL;
+}
+
+int event_uring_new(EventURing **ret) {
+        return -EOPNOTSUPP;
+}
+
+int event_uring_queue(EventURing *u, EventURingOp op, int fd, void *addr, uint32_t len, uint64_t offset, uint32_t flags, uint64_t user_data) {
+        return -EOPNOTSUPP;
+}
+
+int event_uring_enter(EventURing *u, usec_t timeout) {
+        return -EOPNOTSUPP;
+}
+
+int event_uring_next_completion(EventURing *u, uint64_t *ret_user_data, int *ret_result) {
+        return 0;
+}
+
+bool event_uring_has_queued(EventURing *u) {
+        return false;
+}
+
+#endif
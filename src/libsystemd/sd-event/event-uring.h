@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* A minimal io_uring wrapper for sd-event: a single ring, operations queued by the caller are submitted in
+ * one batch together with waiting for completions. */
+
+typedef struct EventURing EventURing;
+
+typedef enum EventURingOp {
+        EVENT_URING_POLL,
+        EVENT_URING_READ,
+        EVENT_URING_WRITE,
+        EVENT_URING_RECVMSG,
+        EVENT_URING_CANCEL,
+        _EVENT_URING_OP_MAX,
+        _EVENT_URING_OP_INVALID = -1,
+} EventURingOp;
+
+int event_uring_new(EventURing **ret);
+EventURing *event_uring_free(EventURing *u);
+DEFINE_TRIVIAL_CLEANUP_FUNC(EventURing*, event_uring_free);
+
+/* Queues an operation. For EVENT_URING_POLL "addr" is unused and "len" carries the poll mask, for
+ * EVENT_URING_RECVMSG "addr" is the struct msghdr and "len" unused, for EVENT_URING_CANCEL "addr" is the
+ * user data of the operation to cancel. */
+int event_uring_queue(EventURing *u, EventURingOp op, int fd, void *addr, uint32_t len, uint64_t offset, uint32_t flags, uint64_t user_data);
+
+/* Submits everything queued, and waits up to "timeout" for at least one completion, unless "timeout" is 0.
+ * Returns 0 also if none arrived in time. */
+int event_uring_enter(EventURing *u, usec_t timeout);
+
+/* Returns > 0 and the next completion, or 0 if there is none */
+int event_uring_next_completion(EventURing *u, uint64_t *ret_user_data, int *ret_result);
+
+bool event_uring_has_queued(EventURing *u);
@@ -1,6 +1,9 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <poll.h>
+#include <pthread.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/timerfd.h>
 #include <sys/wait.h>
 
@@ -9,6 +12,7 @@
 #include "sd-id128.h"
 
 #include "alloc-util.h"
+#include "cgroup-util.h"
 #include "env-util.h"
 #include "event-source.h"
 #include "fd-util.h"
@@ -24,8 +28,10 @@
 #include "signal-util.h"
 #include "string-table.h"
 #include "string-util.h"
+#include "strv.h"
 #include "strxcpyx.h"
 #include "time-util.h"
+#include "usdt.h"
 
 #define DEFAULT_ACCURACY_USEC (250 * USEC_PER_MSEC)
 
@@ -51,18 +57,53 @@ static const char* const event_source_type_table[_SOURCE_EVENT_SOURCE_TYPE_MAX]
         [SOURCE_EXIT] = "exit",
         [SOURCE_WATCHDOG] = "watchdog",
         [SOURCE_INOTIFY] = "inotify",
+        [SOURCE_ASYNC] = "async",
+        [SOURCE_WORK] = "work",
+        [SOURCE_MEMORY_PRESSURE] = "memory-pressure",
 };
 
 DEFINE_PRIVATE_STRING_TABLE_LOOKUP_TO_STRING(event_source_type, int);
 
 #define EVENT_SOURCE_IS_TIME(t) IN_SET((t), SOURCE_TIME_REALTIME, SOURCE_TIME_BOOTTIME, SOURCE_TIME_MONOTONIC, SOURCE_TIME_REALTIME_ALARM, SOURCE_TIME_BOOTTIME_ALARM)
 
+/* Dispatch statistics, aggregated by event source description */
+struct source_statistics {
+        char *key;
+        uint64_t n_dispatched;
+        usec_t total, max;
+        usec_t latency_total, latency_max;
+};
+
+static struct source_statistics* source_statistics_free(struct source_statistics *st) {
+        if (!st)
+                return NULL;
+
+        free(st->key);
+        return mfree(st);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(struct source_statistics*, source_statistics_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(source_statistics_hash_ops, char, string_hash_func, string_compare_func,
+                                              struct source_statistics, source_statistics_free);
+
 struct sd_event {
         unsigned n_ref;
 
         int epoll_fd;
         int watchdog_fd;
 
+        /* Only with SD_EVENT_IO_URING: we then wait on the ring, which has a poll on the epoll fd queued
+         * along with the operations of the async sources. */
+        EventURing *uring;
+
+        /* Completed work of sd_event_add_work() sources, posted by the worker threads of the pools, which
+         * signal work_fd when the list becomes non-empty. work_cond is signalled whenever work completes. */
+        int work_fd;
+        pthread_mutex_t work_lock;
+        pthread_cond_t work_cond;
+        LIST_HEAD(sd_event_source, work_done);
+
         Prioq *pending;
         Prioq *prepare;
 
@@ -105,6 +146,9 @@ struct sd_event {
         bool need_process_child:1;
         bool watchdog:1;
         bool profile_delays:1;
+        bool timer_wheel:1;
+        bool uring_poll_armed:1;
+        bool statistics:1;
 
         int exit_code;
 
@@ -120,6 +164,8 @@ struct sd_event {
 
         LIST_HEAD(sd_event_source, sources);
 
+        Hashmap *source_statistics;
+
         usec_t last_run, last_log;
         unsigned delays[sizeof(usec_t) * 8];
 };
@@ -127,6 +173,7 @@ struct sd_event {
 static thread_local sd_event *default_event = NULL;
 
 static void source_disconnect(sd_event_source *s);
+static int source_set_pending(sd_event_source *s, bool b);
 static void event_gc_inode_data(sd_event *e, struct inode_data *d);
 
 static sd_event *event_resolve(sd_event *e) {
@@ -250,6 +297,138 @@ static void free_clock_data(struct clock_data *d) {
         safe_close(d->fd);
         prioq_free(d->earliest);
         prioq_free(d->latest);
+        free(d->wheel);
+}
+
+/* Tick granularity of the timer wheels. Sources with an accuracy of at least this much are fired on the first
+ * tick after their time, which is what sleep_between() would pick for them in its finest step anyway. Larger
+ * accuracies are left to the prioqs, so that they continue to be coalesced on 1s, 10s and 1min boundaries. */
+#define TIMER_WHEEL_TICK_USEC (250 * USEC_PER_MSEC)
+#define TIMER_WHEEL_RANGE (UINT64_C(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+static bool time_source_wants_wheel(sd_event *e, EventSourceType type, usec_t accuracy) {
+        assert(e);
+
+        /* Only for clocks that never jump backwards, the wheel's notion of the current tick only moves forward */
+        return e->timer_wheel &&
+                IN_SET(type, SOURCE_TIME_MONOTONIC, SOURCE_TIME_BOOTTIME, SOURCE_TIME_BOOTTIME_ALARM) &&
+                accuracy >= TIMER_WHEEL_TICK_USEC && accuracy < USEC_PER_SEC;
+}
+
+static uint64_t timer_wheel_tick(const struct timer_wheel *w, usec_t t, bool round_up) {
+        assert(w);
+        assert(t != USEC_INFINITY);
+
+        /* Tick k fires at k * TIMER_WHEEL_TICK_USEC + offset - TIMER_WHEEL_TICK_USEC, so that the ticks are
+         * aligned like in sleep_between(), and tick 0 lies before any time. */
+        t += TIMER_WHEEL_TICK_USEC - w->offset;
+
+        return round_up ? DIV_ROUND_UP(t, TIMER_WHEEL_TICK_USEC) : t / TIMER_WHEEL_TICK_USEC;
+}
+
+static usec_t timer_wheel_tick_time(const struct timer_wheel *w, uint64_t k) {
+        assert(w);
+
+        if (k == 0)
+                return 0;
+
+        return k * TIMER_WHEEL_TICK_USEC + w->offset - TIMER_WHEEL_TICK_USEC;
+}
+
+static sd_event_source **timer_wheel_head(struct timer_wheel *w, unsigned level, unsigned slot) {
+        assert(w);
+
+        if (level == TIMER_WHEEL_DUE)
+                return &w->due;
+        if (level == TIMER_WHEEL_PARKED)
+                return &w->parked;
+
+        assert(level < TIMER_WHEEL_LEVELS);
+        assert(slot < TIMER_WHEEL_SLOTS);
+        return &w->slots[level][slot];
+}
+
+static void timer_wheel_link(struct timer_wheel *w, sd_event_source *s) {
+        unsigned level = TIMER_WHEEL_PARKED, slot = 0;
+
+        assert(w);
+        assert(s);
+        assert(s->time.wheel);
+
+        if (s->enabled != SD_EVENT_OFF && !s->pending && s->time.next != USEC_INFINITY) {
+                uint64_t k, delta;
+
+                k = timer_wheel_tick(w, s->time.next, true);
+                if (k < w->base)
+                        level = TIMER_WHEEL_DUE;
+                else {
+                        /* Sources further out than the wheel reaches are parked in the last slot of the top
+                         * level, and put back in their place when it is redistributed. */
+                        delta = MIN(k - w->base, TIMER_WHEEL_RANGE - 1);
+
+                        for (level = 0; delta >= (UINT64_C(1) << (TIMER_WHEEL_BITS * (level + 1))); level++)
+                                ;
+
+                        slot = ((w->base + delta) >> (TIMER_WHEEL_BITS * level)) % TIMER_WHEEL_SLOTS;
+                        w->occupied[level] |= UINT64_C(1) << slot;
+                }
+        }
+
+        LIST_PREPEND(time.wheel, *timer_wheel_head(w, level, slot), s);
+        s->time.wheel_level = level;
+        s->time.wheel_slot = slot;
+}
+
+static void timer_wheel_unlink(struct timer_wheel *w, sd_event_source *s) {
+        sd_event_source **head;
+
+        assert(w);
+        assert(s);
+        assert(s->time.wheel);
+
+        head = timer_wheel_head(w, s->time.wheel_level, s->time.wheel_slot);
+        LIST_REMOVE(time.wheel, *head, s);
+
+        if (s->time.wheel_level < TIMER_WHEEL_LEVELS && !*head)
+                w->occupied[s->time.wheel_level] &= ~(UINT64_C(1) << s->time.wheel_slot);
+}
+
+static usec_t timer_wheel_next(const struct timer_wheel *w) {
+        uint64_t best = UINT64_MAX;
+
+        /* Returns when we need to wake up next, either to dispatch level 0 sources, or to redistribute the
+         * slot of a higher level, whatever comes first. */
+
+        if (!w)
+                return USEC_INFINITY;
+        if (w->due)
+                return 0;
+
+        for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+                unsigned shift = TIMER_WHEEL_BITS * level, r;
+                uint64_t cur, m, k;
+
+                if (w->occupied[level] == 0)
+                        continue;
+
+                /* Rotate the bitmap so that bit 0 corresponds to the slot of the current tick */
+                cur = w->base >> shift;
+                r = cur % TIMER_WHEEL_SLOTS;
+                m = r == 0 ? w->occupied[level] : (w->occupied[level] >> r) | (w->occupied[level] << (64 - r));
+
+                /* On the higher levels, the current slot was already redistributed, unless its round begins
+                 * right now, and only contains sources for the next time around. */
+                if (level > 0 && (w->base & ((UINT64_C(1) << shift) - 1)) != 0 && m != 1)
+                        m &= ~UINT64_C(1);
+
+                k = (cur + __builtin_ctzll(m)) << shift;
+                if (k < w->base)
+                        k += UINT64_C(1) << (shift + TIMER_WHEEL_BITS);
+
+                best = MIN(best, k);
+        }
+
+        return best == UINT64_MAX ? USEC_INFINITY : timer_wheel_tick_time(w, best);
 }
 
 static sd_event *event_free(sd_event *e) {
@@ -271,6 +450,12 @@ static sd_event *event_free(sd_event *e) {
         safe_close(e->epoll_fd);
         safe_close(e->watchdog_fd);
 
+        event_uring_free(e->uring);
+
+        safe_close(e->work_fd);
+        (void) pthread_cond_destroy(&e->work_cond);
+        (void) pthread_mutex_destroy(&e->work_lock);
+
         free_clock_data(&e->realtime);
         free_clock_data(&e->boottime);
         free_clock_data(&e->monotonic);
@@ -291,14 +476,17 @@ static sd_event *event_free(sd_event *e) {
 
         free(e->event_queue);
 
+        hashmap_free(e->source_statistics);
+
         return mfree(e);
 }
 
-_public_ int sd_event_new(sd_event** ret) {
+_public_ int sd_event_new_with_flags(sd_event** ret, uint64_t flags) {
         sd_event *e;
         int r;
 
         assert_return(ret, -EINVAL);
+        assert_return((flags & ~SD_EVENT_IO_URING) == 0, -EINVAL);
 
         e = new(sd_event, 1);
         if (!e)
@@ -308,6 +496,9 @@ _public_ int sd_event_new(sd_event** ret) {
                 .n_ref = 1,
                 .epoll_fd = -1,
                 .watchdog_fd = -1,
+                .work_fd = -1,
+                .work_lock = PTHREAD_MUTEX_INITIALIZER,
+                .work_cond = PTHREAD_COND_INITIALIZER,
                 .realtime.wakeup = WAKEUP_CLOCK_DATA,
                 .realtime.fd = -1,
                 .realtime.next = USEC_INFINITY,
@@ -339,6 +530,19 @@ _public_ int sd_event_new(sd_event** ret) {
 
         e->epoll_fd = fd_move_above_stdio(e->epoll_fd);
 
+        if (FLAGS_SET(flags, SD_EVENT_IO_URING)) {
+                r = event_uring_new(&e->uring);
+                if (r == -ENOMEM)
+                        goto fail;
+                if (r < 0)
+                        /* io_uring is an optimization, if the kernel doesn't have it (or it is blocked by
+                         * seccomp) let's just stay with epoll. */
+                        log_debug_errno(r, "Failed to set up io_uring, using epoll only: %m");
+        }
+
+        e->timer_wheel = getenv_bool_secure("SD_EVENT_TIMER_WHEEL") != 0;
+        e->statistics = getenv_bool_secure("SD_EVENT_STATISTICS") > 0;
+
         if (secure_getenv("SD_EVENT_PROFILE_DELAYS")) {
                 log_debug("Event loop profiling enabled. Logarithmic histogram of event loop iterations in the range 2^0 ... 2^63 us will be logged every 5s.");
                 e->profile_delays = true;
@@ -352,6 +556,10 @@ fail:
         return r;
 }
 
+_public_ int sd_event_new(sd_event** ret) {
+        return sd_event_new_with_flags(ret, 0);
+}
+
 DEFINE_PUBLIC_TRIVIAL_REF_UNREF_FUNC(sd_event, sd_event, event_free);
 
 _public_ sd_event_source* sd_event_source_disable_unref(sd_event_source *s) {
@@ -413,6 +621,44 @@ static int source_io_register(
         return 0;
 }
 
+static void source_memory_pressure_unregister(sd_event_source *s) {
+        assert(s);
+        assert(s->type == SOURCE_MEMORY_PRESSURE);
+
+        if (event_pid_changed(s->event))
+                return;
+
+        if (!s->memory_pressure.registered)
+                return;
+
+        if (epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, s->memory_pressure.fd, NULL) < 0)
+                log_debug_errno(errno, "Failed to remove source %s (type %s) from epoll: %m",
+                                strna(s->description), event_source_type_to_string(s->type));
+
+        s->memory_pressure.registered = false;
+}
+
+static int source_memory_pressure_register(sd_event_source *s, int enabled) {
+        assert(s);
+        assert(s->type == SOURCE_MEMORY_PRESSURE);
+        assert(enabled != SD_EVENT_OFF);
+
+        /* PSI triggers are signalled with EPOLLPRI, and the kernel does so at most once per window. */
+        struct epoll_event ev = {
+                .events = EPOLLPRI | (enabled == SD_EVENT_ONESHOT ? EPOLLONESHOT : 0),
+                .data.ptr = s,
+        };
+
+        if (epoll_ctl(s->event->epoll_fd,
+                      s->memory_pressure.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                      s->memory_pressure.fd, &ev) < 0)
+                return -errno;
+
+        s->memory_pressure.registered = true;
+
+        return 0;
+}
+
 static void source_child_pidfd_unregister(sd_event_source *s) {
         assert(s);
         assert(s->type == SOURCE_CHILD);
@@ -456,6 +702,151 @@ static int source_child_pidfd_register(sd_event_source *s, int enabled) {
         return 0;
 }
 
+/* The user data of the poll on the epoll fd, and of cancellations, whose completions we don't care about */
+#define URING_POLL_TAG UINT64_C(1)
+#define URING_CANCEL_TAG UINT64_C(0)
+
+static int source_async_submit(sd_event_source *s) {
+        int r;
+
+        assert(s);
+        assert(s->type == SOURCE_ASYNC);
+        assert(!s->async.in_flight);
+        assert(s->event->uring);
+
+        r = event_uring_queue(s->event->uring, s->async.op, s->async.fd, s->async.buf, s->async.size,
+                              s->async.offset, s->async.flags, PTR_TO_UINT64(s));
+        if (r < 0)
+                return r;
+
+        s->async.in_flight = true;
+        return 0;
+}
+
+static void event_uring_reap(sd_event *e) {
+        uint64_t user_data;
+        int result;
+
+        assert(e);
+        assert(e->uring);
+
+        while (event_uring_next_completion(e->uring, &user_data, &result) > 0) {
+                sd_event_source *s;
+
+                if (user_data == URING_CANCEL_TAG)
+                        continue;
+                if (user_data == URING_POLL_TAG) {
+                        e->uring_poll_armed = false;
+                        continue;
+                }
+
+                s = UINT64_TO_PTR(user_data);
+                assert(s->type == SOURCE_ASYNC);
+                assert(s->async.in_flight);
+
+                s->async.in_flight = false;
+                if (s->async.cancelling) {
+                        s->async.cancelling = false;
+                        continue;
+                }
+
+                s->async.result = result;
+                if (source_set_pending(s, true) < 0)
+                        log_debug("Failed to mark event source %s (type %s) pending, ignoring completion.",
+                                  strna(s->description), event_source_type_to_string(s->type));
+        }
+}
+
+static void source_async_cancel(sd_event_source *s) {
+        int r;
+
+        assert(s);
+        assert(s->type == SOURCE_ASYNC);
+
+        if (!s->async.in_flight)
+                return;
+
+        if (event_pid_changed(s->event))
+                return;
+
+        s->async.cancelling = true;
+
+        r = event_uring_queue(s->event->uring, EVENT_URING_CANCEL, -1, s, 0, 0, 0, URING_CANCEL_TAG);
+        if (r < 0)
+                log_debug_errno(r, "Failed to cancel operation of event source %s (type %s), waiting for it instead: %m",
+                                strna(s->description), event_source_type_to_string(s->type));
+
+        /* The buffer belongs to the caller, who may free it as soon as we return, hence wait until the
+         * kernel is done with it. Cancellation of operations that already started may fail, in which case
+         * they complete normally, but soon. */
+        while (s->async.in_flight) {
+                r = event_uring_enter(s->event->uring, USEC_INFINITY);
+                if (r < 0 && r != -EINTR) {
+                        log_debug_errno(r, "Failed to wait for cancellation of event source %s (type %s): %m",
+                                        strna(s->description), event_source_type_to_string(s->type));
+                        return;
+                }
+
+                event_uring_reap(s->event);
+        }
+}
+
+void source_work_complete(sd_event_source *s, int result) {
+        sd_event *e;
+
+        assert(s);
+        assert(s->type == SOURCE_WORK);
+        assert_se(e = s->event);
+
+        /* This is called from the worker thread. The event loop thread waits for us if it wants to get rid
+         * of the source in the meantime, hence it is safe to access it until we unlock. */
+
+        assert_se(pthread_mutex_lock(&e->work_lock) == 0);
+
+        s->work.result = result;
+        s->work.state = EVENT_WORK_DONE;
+
+        if (!e->work_done) {
+                static const uint64_t one = 1;
+
+                if (write(e->work_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                        log_debug_errno(errno, "Failed to signal completed work, ignoring: %m");
+        }
+        LIST_PREPEND(work.work_queue, e->work_done, s);
+
+        assert_se(pthread_cond_broadcast(&e->work_cond) == 0);
+        assert_se(pthread_mutex_unlock(&e->work_lock) == 0);
+}
+
+static void source_work_cancel(sd_event_source *s) {
+        sd_event *e;
+
+        assert(s);
+        assert(s->type == SOURCE_WORK);
+        assert_se(e = s->event);
+
+        if (s->work.state == EVENT_WORK_IDLE)
+                return;
+
+        if (event_pid_changed(e))
+                return;
+
+        if (event_pool_dequeue(s->work.pool, s))
+                return;
+
+        /* Already running (or done), the userdata might be freed once we return, hence wait for it */
+        assert_se(pthread_mutex_lock(&e->work_lock) == 0);
+
+        while (s->work.state == EVENT_WORK_RUNNING)
+                assert_se(pthread_cond_wait(&e->work_cond, &e->work_lock) == 0);
+
+        assert(s->work.state == EVENT_WORK_DONE);
+        LIST_REMOVE(work.work_queue, e->work_done, s);
+        s->work.state = EVENT_WORK_IDLE;
+
+        assert_se(pthread_mutex_unlock(&e->work_lock) == 0);
+}
+
 static clockid_t event_source_type_to_clock(EventSourceType t) {
 
         switch (t) {
@@ -704,6 +1095,26 @@ static void event_gc_signal_data(sd_event *e, const int64_t *priority, int sig)
                 event_unmask_signal_data(e, d, sig);
 }
 
+static void event_source_time_requeue(sd_event_source *s) {
+        struct clock_data *d;
+
+        assert(s);
+        assert(EVENT_SOURCE_IS_TIME(s->type));
+
+        d = event_get_clock_data(s->event, s->type);
+        assert(d);
+
+        if (s->time.wheel) {
+                timer_wheel_unlink(d->wheel, s);
+                timer_wheel_link(d->wheel, s);
+        } else {
+                prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
+                prioq_reshuffle(d->latest, s, &s->time.latest_index);
+        }
+
+        d->needs_rearm = true;
+}
+
 static void source_disconnect(sd_event_source *s) {
         sd_event *event;
 
@@ -732,8 +1143,13 @@ static void source_disconnect(sd_event_source *s) {
                 d = event_get_clock_data(s->event, s->type);
                 assert(d);
 
-                prioq_remove(d->earliest, s, &s->time.earliest_index);
-                prioq_remove(d->latest, s, &s->time.latest_index);
+                if (s->time.wheel) {
+                        timer_wheel_unlink(d->wheel, s);
+                        s->time.wheel = false;
+                } else {
+                        prioq_remove(d->earliest, s, &s->time.earliest_index);
+                        prioq_remove(d->latest, s, &s->time.latest_index);
+                }
                 d->needs_rearm = true;
                 break;
         }
@@ -778,6 +1194,18 @@ static void source_disconnect(sd_event_source *s) {
                 prioq_remove(s->event->exit, s, &s->exit.prioq_index);
                 break;
 
+        case SOURCE_ASYNC:
+                source_async_cancel(s);
+                break;
+
+        case SOURCE_WORK:
+                source_work_cancel(s);
+                break;
+
+        case SOURCE_MEMORY_PRESSURE:
+                source_memory_pressure_unregister(s);
+                break;
+
         case SOURCE_INOTIFY: {
                 struct inode_data *inode_data;
 
@@ -842,6 +1270,12 @@ static void source_free(sd_event_source *s) {
         if (s->type == SOURCE_IO && s->io.owned)
                 s->io.fd = safe_close(s->io.fd);
 
+        if (s->type == SOURCE_WORK)
+                s->work.pool = sd_event_pool_unref(s->work.pool);
+
+        if (s->type == SOURCE_MEMORY_PRESSURE)
+                s->memory_pressure.fd = safe_close(s->memory_pressure.fd);
+
         if (s->type == SOURCE_CHILD) {
                 /* Eventually the kernel will do this automatically for us, but for now let's emulate this (unreliably) in userspace. */
 
@@ -901,6 +1335,8 @@ static int source_set_pending(sd_event_source *s, bool b) {
 
         if (b) {
                 s->pending_iteration = s->event->iteration;
+                if (s->event->statistics)
+                        s->pending_since = now(CLOCK_MONOTONIC);
 
                 r = prioq_put(s->event->pending, s, &s->pending_index);
                 if (r < 0) {
@@ -910,16 +1346,8 @@ static int source_set_pending(sd_event_source *s, bool b) {
         } else
                 assert_se(prioq_remove(s->event->pending, s, &s->pending_index));
 
-        if (EVENT_SOURCE_IS_TIME(s->type)) {
-                struct clock_data *d;
-
-                d = event_get_clock_data(s->event, s->type);
-                assert(d);
-
-                prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                d->needs_rearm = true;
-        }
+        if (EVENT_SOURCE_IS_TIME(s->type))
+                event_source_time_requeue(s);
 
         if (s->type == SOURCE_SIGNAL && !b) {
                 struct signal_data *d;
@@ -1013,6 +1441,92 @@ _public_ int sd_event_add_io(
         return 0;
 }
 
+/* Fire if tasks were stalled on memory for 200ms within any 2s window. Unprivileged processes may only use
+ * windows that are multiples of 2s. */
+#define MEMORY_PRESSURE_TRIGGER "some 200000 2000000"
+
+static int memory_pressure_open(const char *path) {
+        _cleanup_close_ int fd = -1;
+
+        assert(path);
+
+        fd = open(path, O_RDWR|O_NONBLOCK|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        /* The kernel wants the terminating NUL byte, too */
+        if (write(fd, MEMORY_PRESSURE_TRIGGER, sizeof(MEMORY_PRESSURE_TRIGGER)) < 0)
+                return -errno;
+
+        return TAKE_FD(fd);
+}
+
+static int memory_pressure_open_default(void) {
+        _cleanup_free_ char *cgroup = NULL, *path = NULL;
+        int fd;
+
+        /* Prefer the pressure of our own cgroup, so that we react to the limits applied to us. If that isn't
+         * available (legacy hierarchy, the root cgroup, or no permission to install a trigger), fall back
+         * to the system-wide pressure. */
+
+        if (cg_pid_get_path(SYSTEMD_CGROUP_CONTROLLER, 0, &cgroup) >= 0 &&
+            cg_get_path(SYSTEMD_CGROUP_CONTROLLER, cgroup, "memory.pressure", &path) >= 0) {
+                fd = memory_pressure_open(path);
+                if (fd >= 0)
+                        return fd;
+
+                log_debug_errno(fd, "Failed to install memory pressure trigger on %s, trying system-wide pressure: %m", path);
+        }
+
+        fd = memory_pressure_open("/proc/pressure/memory");
+        if (IN_SET(fd, -ENOENT, -EINVAL))
+                return -EOPNOTSUPP; /* PSI not compiled in or disabled */
+
+        return fd;
+}
+
+_public_ int sd_event_add_memory_pressure(
+                sd_event *e,
+                sd_event_source **ret,
+                sd_event_handler_t callback,
+                void *userdata) {
+
+        _cleanup_(source_freep) sd_event_source *s = NULL;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(callback, -EINVAL);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        s = source_new(e, !ret, SOURCE_MEMORY_PRESSURE);
+        if (!s)
+                return -ENOMEM;
+
+        s->wakeup = WAKEUP_EVENT_SOURCE;
+        s->memory_pressure.fd = -1;
+        s->memory_pressure.callback = callback;
+        s->userdata = userdata;
+
+        r = memory_pressure_open_default();
+        if (r < 0)
+                return r;
+
+        s->memory_pressure.fd = r;
+        s->enabled = SD_EVENT_ON;
+
+        r = source_memory_pressure_register(s, s->enabled);
+        if (r < 0)
+                return r;
+
+        if (ret)
+                *ret = s;
+        TAKE_PTR(s);
+
+        return 0;
+}
+
 static void initialize_perturb(sd_event *e) {
         sd_id128_t bootid = {};
 
@@ -1065,6 +1579,83 @@ static int event_setup_timer_fd(
         return 0;
 }
 
+static int event_ensure_timer_wheel(sd_event *e, EventSourceType type, struct clock_data *d) {
+        struct timer_wheel *w;
+        usec_t n;
+        int r;
+
+        assert(e);
+        assert(d);
+
+        if (d->wheel)
+                return 0;
+
+        r = sd_event_now(e, event_source_type_to_clock(type), &n);
+        if (r < 0)
+                return r;
+
+        w = new0(struct timer_wheel, 1);
+        if (!w)
+                return -ENOMEM;
+
+        initialize_perturb(e);
+        w->offset = e->perturb % TIMER_WHEEL_TICK_USEC;
+
+        /* Everything up to the current tick counts as elapsed already */
+        w->base = timer_wheel_tick(w, n, false) + 1;
+
+        d->wheel = w;
+        return 0;
+}
+
+static int event_source_time_relocate(sd_event_source *s) {
+        struct clock_data *d;
+        bool wheel;
+        int r;
+
+        assert(s);
+        assert(EVENT_SOURCE_IS_TIME(s->type));
+
+        /* Moves the source between the prioqs and the timer wheel, after its accuracy changed */
+
+        d = event_get_clock_data(s->event, s->type);
+        assert(d);
+
+        wheel = time_source_wants_wheel(s->event, s->type, s->time.accuracy);
+        if (wheel == s->time.wheel) {
+                event_source_time_requeue(s);
+                return 0;
+        }
+
+        if (wheel) {
+                r = event_ensure_timer_wheel(s->event, s->type, d);
+                if (r < 0)
+                        return r;
+
+                prioq_remove(d->earliest, s, &s->time.earliest_index);
+                prioq_remove(d->latest, s, &s->time.latest_index);
+
+                s->time.wheel = true;
+                timer_wheel_link(d->wheel, s);
+        } else {
+                r = prioq_put(d->earliest, s, &s->time.earliest_index);
+                if (r < 0)
+                        return r;
+
+                r = prioq_put(d->latest, s, &s->time.latest_index);
+                if (r < 0) {
+                        prioq_remove(d->earliest, s, &s->time.earliest_index);
+                        return r;
+                }
+
+                timer_wheel_unlink(d->wheel, s);
+                s->time.wheel = false;
+        }
+
+        d->needs_rearm = true;
+        return 0;
+}
+
 static int time_exit_callback(sd_event_source *s, uint64_t usec, void *userdata) {
         assert(s);
 
@@ -1118,12 +1709,21 @@ _public_ int sd_event_add_time(
                         return r;
         }
 
+        if (accuracy == 0)
+                accuracy = DEFAULT_ACCURACY_USEC;
+
+        if (time_source_wants_wheel(e, type, accuracy)) {
+                r = event_ensure_timer_wheel(e, type, d);
+                if (r < 0)
+                        return r;
+        }
+
         s = source_new(e, !ret, type);
         if (!s)
                 return -ENOMEM;
 
         s->time.next = usec;
-        s->time.accuracy = accuracy == 0 ? DEFAULT_ACCURACY_USEC : accuracy;
+        s->time.accuracy = accuracy;
         s->time.callback = callback;
         s->time.earliest_index = s->time.latest_index = PRIOQ_IDX_NULL;
         s->userdata = userdata;
@@ -1131,13 +1731,18 @@ _public_ int sd_event_add_time(
 
         d->needs_rearm = true;
 
-        r = prioq_put(d->earliest, s, &s->time.earliest_index);
-        if (r < 0)
-                return r;
+        if (time_source_wants_wheel(e, type, accuracy)) {
+                s->time.wheel = true;
+                timer_wheel_link(d->wheel, s);
+        } else {
+                r = prioq_put(d->earliest, s, &s->time.earliest_index);
+                if (r < 0)
+                        return r;
 
-        r = prioq_put(d->latest, s, &s->time.latest_index);
-        if (r < 0)
-                return r;
+                r = prioq_put(d->latest, s, &s->time.latest_index);
+                if (r < 0)
+                        return r;
+        }
 
         if (ret)
                 *ret = s;
@@ -1531,7 +2136,179 @@ _public_ int sd_event_add_exit(
                 *ret = s;
         TAKE_PTR(s);
 
-        return 0;
+        return 0;
+}
+
+static int event_setup_work_fd(sd_event *e) {
+        struct epoll_event ev;
+        int fd;
+
+        assert(e);
+
+        if (e->work_fd >= 0)
+                return 0;
+
+        fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (fd < 0)
+                return -errno;
+
+        fd = fd_move_above_stdio(fd);
+
+        ev = (struct epoll_event) {
+                .events = EPOLLIN,
+                .data.ptr = INT_TO_PTR(SOURCE_WORK),
+        };
+
+        if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                safe_close(fd);
+                return -errno;
+        }
+
+        e->work_fd = fd;
+        return 0;
+}
+
+_public_ int sd_event_add_work(
+                sd_event *e,
+                sd_event_source **ret,
+                sd_event_pool *pool,
+                sd_event_work_handler_t callback,
+                sd_event_work_done_handler_t done,
+                void *userdata) {
+
+        _cleanup_(source_freep) sd_event_source *s = NULL;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(pool, -EINVAL);
+        assert_return(callback, -EINVAL);
+        assert_return(done, -EINVAL);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        r = event_setup_work_fd(e);
+        if (r < 0)
+                return r;
+
+        s = source_new(e, !ret, SOURCE_WORK);
+        if (!s)
+                return -ENOMEM;
+
+        s->work.callback = callback;
+        s->work.done = done;
+        s->work.pool = sd_event_pool_ref(pool);
+        s->userdata = userdata;
+
+        r = event_pool_submit(pool, s);
+        if (r < 0)
+                return r;
+
+        s->enabled = SD_EVENT_ONESHOT;
+
+        if (ret)
+                *ret = s;
+        TAKE_PTR(s);
+
+        return 0;
+}
+
+static int event_add_async(
+                sd_event *e,
+                sd_event_source **ret,
+                EventURingOp op,
+                int fd,
+                void *buf,
+                size_t size,
+                uint64_t offset,
+                uint32_t flags,
+                int enabled,
+                sd_event_async_handler_t callback,
+                void *userdata) {
+
+        _cleanup_(source_freep) sd_event_source *s = NULL;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(fd >= 0, -EBADF);
+        assert_return(size <= UINT32_MAX, -EINVAL);
+        assert_return(callback, -EINVAL);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        if (!e->uring)
+                return -EOPNOTSUPP;
+
+        s = source_new(e, !ret, SOURCE_ASYNC);
+        if (!s)
+                return -ENOMEM;
+
+        s->async.callback = callback;
+        s->async.op = op;
+        s->async.fd = fd;
+        s->async.buf = buf;
+        s->async.size = size;
+        s->async.offset = offset;
+        s->async.flags = flags;
+        s->userdata = userdata;
+
+        r = source_async_submit(s);
+        if (r < 0)
+                return r;
+
+        s->enabled = enabled;
+
+        if (ret)
+                *ret = s;
+        TAKE_PTR(s);
+
+        return 0;
+}
+
+_public_ int sd_event_add_async_read(
+                sd_event *e,
+                sd_event_source **ret,
+                int fd,
+                void *buf,
+                size_t size,
+                uint64_t offset,
+                sd_event_async_handler_t callback,
+                void *userdata) {
+
+        assert_return(buf || size == 0, -EINVAL);
+
+        return event_add_async(e, ret, EVENT_URING_READ, fd, buf, size, offset, 0, SD_EVENT_ON, callback, userdata);
+}
+
+_public_ int sd_event_add_async_write(
+                sd_event *e,
+                sd_event_source **ret,
+                int fd,
+                const void *buf,
+                size_t size,
+                uint64_t offset,
+                sd_event_async_handler_t callback,
+                void *userdata) {
+
+        assert_return(buf || size == 0, -EINVAL);
+
+        /* Writing the same buffer over and over again is rarely useful, hence this is one-shot by default */
+        return event_add_async(e, ret, EVENT_URING_WRITE, fd, (void*) buf, size, offset, 0, SD_EVENT_ONESHOT, callback, userdata);
+}
+
+_public_ int sd_event_add_async_recvmsg(
+                sd_event *e,
+                sd_event_source **ret,
+                int fd,
+                struct msghdr *msg,
+                int flags,
+                sd_event_async_handler_t callback,
+                void *userdata) {
+
+        assert_return(msg, -EINVAL);
+
+        return event_add_async(e, ret, EVENT_URING_RECVMSG, fd, msg, 0, 0, flags, SD_EVENT_ON, callback, userdata);
 }
 
 static void event_free_inotify_data(sd_event *e, struct inotify_data *d) {
@@ -1923,6 +2700,8 @@ static sd_event_source* event_source_free(sd_event_source *s) {
         if (s->dispatching) {
                 if (s->type == SOURCE_IO)
                         source_io_unregister(s);
+                else if (s->type == SOURCE_MEMORY_PRESSURE)
+                        source_memory_pressure_unregister(s);
 
                 source_disconnect(s);
         } else
@@ -1937,6 +2716,9 @@ _public_ int sd_event_source_set_description(sd_event_source *s, const char *des
         assert_return(s, -EINVAL);
         assert_return(!event_pid_changed(s->event), -ECHILD);
 
+        /* Statistics are keyed by the description, look them up again on the next dispatch */
+        s->statistics = NULL;
+
         return free_and_strdup(&s->description, description);
 }
 
@@ -2241,18 +3023,10 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                 case SOURCE_TIME_BOOTTIME:
                 case SOURCE_TIME_MONOTONIC:
                 case SOURCE_TIME_REALTIME_ALARM:
-                case SOURCE_TIME_BOOTTIME_ALARM: {
-                        struct clock_data *d;
-
+                case SOURCE_TIME_BOOTTIME_ALARM:
                         s->enabled = m;
-                        d = event_get_clock_data(s->event, s->type);
-                        assert(d);
-
-                        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                        d->needs_rearm = true;
+                        event_source_time_requeue(s);
                         break;
-                }
 
                 case SOURCE_SIGNAL:
                         s->enabled = m;
@@ -2278,6 +3052,21 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                         prioq_reshuffle(s->event->exit, s, &s->exit.prioq_index);
                         break;
 
+                case SOURCE_ASYNC:
+                        s->enabled = m;
+                        source_async_cancel(s);
+                        break;
+
+                case SOURCE_WORK:
+                        s->enabled = m;
+                        source_work_cancel(s);
+                        break;
+
+                case SOURCE_MEMORY_PRESSURE:
+                        source_memory_pressure_unregister(s);
+                        s->enabled = m;
+                        break;
+
                 case SOURCE_DEFER:
                 case SOURCE_POST:
                 case SOURCE_INOTIFY:
@@ -2311,18 +3100,10 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                 case SOURCE_TIME_BOOTTIME:
                 case SOURCE_TIME_MONOTONIC:
                 case SOURCE_TIME_REALTIME_ALARM:
-                case SOURCE_TIME_BOOTTIME_ALARM: {
-                        struct clock_data *d;
-
+                case SOURCE_TIME_BOOTTIME_ALARM:
                         s->enabled = m;
-                        d = event_get_clock_data(s->event, s->type);
-                        assert(d);
-
-                        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                        d->needs_rearm = true;
+                        event_source_time_requeue(s);
                         break;
-                }
 
                 case SOURCE_SIGNAL:
 
@@ -2372,6 +3153,34 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                         prioq_reshuffle(s->event->exit, s, &s->exit.prioq_index);
                         break;
 
+                case SOURCE_ASYNC:
+                        if (s->enabled == SD_EVENT_OFF && !s->async.in_flight) {
+                                r = source_async_submit(s);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        s->enabled = m;
+                        break;
+
+                case SOURCE_WORK:
+                        if (s->enabled == SD_EVENT_OFF && s->work.state == EVENT_WORK_IDLE) {
+                                r = event_pool_submit(s->work.pool, s);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        s->enabled = m;
+                        break;
+
+                case SOURCE_MEMORY_PRESSURE:
+                        r = source_memory_pressure_register(s, m);
+                        if (r < 0)
+                                return r;
+
+                        s->enabled = m;
+                        break;
+
                 case SOURCE_DEFER:
                 case SOURCE_POST:
                 case SOURCE_INOTIFY:
@@ -2403,7 +3212,6 @@ _public_ int sd_event_source_get_time(sd_event_source *s, uint64_t *usec) {
 }
 
 _public_ int sd_event_source_set_time(sd_event_source *s, uint64_t usec) {
-        struct clock_data *d;
         int r;
 
         assert_return(s, -EINVAL);
@@ -2416,13 +3224,7 @@ _public_ int sd_event_source_set_time(sd_event_source *s, uint64_t usec) {
                 return r;
 
         s->time.next = usec;
-
-        d = event_get_clock_data(s->event, s->type);
-        assert(d);
-
-        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-        d->needs_rearm = true;
+        event_source_time_requeue(s);
 
         return 0;
 }
@@ -2455,7 +3257,7 @@ _public_ int sd_event_source_get_time_accuracy(sd_event_source *s, uint64_t *use
 }
 
 _public_ int sd_event_source_set_time_accuracy(sd_event_source *s, uint64_t usec) {
-        struct clock_data *d;
+        usec_t old;
         int r;
 
         assert_return(s, -EINVAL);
@@ -2471,13 +3273,14 @@ _public_ int sd_event_source_set_time_accuracy(sd_event_source *s, uint64_t usec
         if (usec == 0)
                 usec = DEFAULT_ACCURACY_USEC;
 
+        old = s->time.accuracy;
         s->time.accuracy = usec;
 
-        d = event_get_clock_data(s->event, s->type);
-        assert(d);
-
-        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-        d->needs_rearm = true;
+        r = event_source_time_relocate(s);
+        if (r < 0) {
+                s->time.accuracy = old;
+                return r;
+        }
 
         return 0;
 }
@@ -2604,6 +3407,23 @@ _public_ int sd_event_source_get_inotify_mask(sd_event_source *s, uint32_t *mask
         return 0;
 }
 
+_public_ int sd_event_source_set_inotify_coalesce(sd_event_source *s, int b) {
+        assert_return(s, -EINVAL);
+        assert_return(s->type == SOURCE_INOTIFY, -EDOM);
+        assert_return(!event_pid_changed(s->event), -ECHILD);
+
+        s->inotify.coalesce = b;
+        return 0;
+}
+
+_public_ int sd_event_source_get_inotify_coalesce(sd_event_source *s) {
+        assert_return(s, -EINVAL);
+        assert_return(s->type == SOURCE_INOTIFY, -EDOM);
+        assert_return(!event_pid_changed(s->event), -ECHILD);
+
+        return s->inotify.coalesce;
+}
+
 _public_ int sd_event_source_set_prepare(sd_event_source *s, sd_event_handler_t callback) {
         int r;
 
@@ -2751,7 +3571,19 @@ static int event_arm_timer(
                 d->needs_rearm = false;
 
         a = prioq_peek(d->earliest);
-        if (!a || a->enabled == SD_EVENT_OFF || a->time.next == USEC_INFINITY) {
+        if (!a || a->enabled == SD_EVENT_OFF || a->time.next == USEC_INFINITY)
+                t = USEC_INFINITY;
+        else {
+                b = prioq_peek(d->latest);
+                assert_se(b && b->enabled != SD_EVENT_OFF);
+
+                t = sleep_between(e, a->time.next, time_event_source_latest(b));
+        }
+
+        /* The wheel's ticks are already aligned, so simply wake up for whatever comes first */
+        t = MIN(t, timer_wheel_next(d->wheel));
+
+        if (t == USEC_INFINITY) {
 
                 if (d->fd < 0)
                         return 0;
@@ -2768,10 +3600,6 @@ static int event_arm_timer(
                 return 0;
         }
 
-        b = prioq_peek(d->latest);
-        assert_se(b && b->enabled != SD_EVENT_OFF);
-
-        t = sleep_between(e, a->time.next, time_event_source_latest(b));
         if (d->next == t)
                 return 0;
 
@@ -2837,6 +3665,72 @@ static int flush_timer(sd_event *e, int fd, uint32_t events, usec_t *next) {
         return 0;
 }
 
+static int timer_wheel_advance(struct clock_data *d, usec_t n) {
+        struct timer_wheel *w;
+        sd_event_source *s;
+        uint64_t target;
+        int r;
+
+        assert(d);
+
+        w = d->wheel;
+        if (!w)
+                return 0;
+
+        /* Making a source pending moves it to the parked list, hence always take the first one */
+        while ((s = w->due)) {
+                r = source_set_pending(s, true);
+                if (r < 0)
+                        return r;
+        }
+
+        target = timer_wheel_tick(w, n, false);
+
+        while (w->base <= target) {
+                uint64_t k = w->base;
+
+                /* Even if nothing is dispatched, sources might have been redistributed */
+                d->needs_rearm = true;
+
+                /* When a new round of a level begins, redistribute the next slot of the level above it */
+                for (unsigned level = 1;
+                     level < TIMER_WHEEL_LEVELS && (k & ((UINT64_C(1) << (TIMER_WHEEL_BITS * level)) - 1)) == 0;
+                     level++) {
+                        unsigned slot = (k >> (TIMER_WHEEL_BITS * level)) % TIMER_WHEEL_SLOTS;
+                        LIST_HEAD(sd_event_source, l) = TAKE_PTR(w->slots[level][slot]);
+
+                        w->occupied[level] &= ~(UINT64_C(1) << slot);
+
+                        while ((s = l)) {
+                                LIST_REMOVE(time.wheel, l, s);
+                                timer_wheel_link(w, s);
+                        }
+                }
+
+                while ((s = w->slots[0][k % TIMER_WHEEL_SLOTS])) {
+                        r = source_set_pending(s, true);
+                        if (r < 0)
+                                return r;
+                }
+
+                w->base = k + 1;
+
+                /* Skip over empty stretches, up to the next round of level 0, or the target if nothing is left */
+                if (w->occupied[0] == 0) {
+                        bool empty = true;
+
+                        for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++)
+                                if (w->occupied[level] != 0)
+                                        empty = false;
+
+                        w->base = empty ? target + 1 :
+                                MIN((w->base + TIMER_WHEEL_SLOTS - 1) & ~(uint64_t) (TIMER_WHEEL_SLOTS - 1), target + 1);
+                }
+        }
+
+        return 0;
+}
+
 static int process_timer(
                 sd_event *e,
                 usec_t n,
@@ -2859,13 +3753,9 @@ static int process_timer(
                 r = source_set_pending(s, true);
                 if (r < 0)
                         return r;
-
-                prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                d->needs_rearm = true;
         }
 
-        return 0;
+        return timer_wheel_advance(d, n);
 }
 
 static int process_child(sd_event *e) {
@@ -3077,6 +3967,63 @@ static void event_inotify_data_drop(sd_event *e, struct inotify_data *d, size_t
                 LIST_REMOVE(buffered, e->inotify_data_buffered, d);
 }
 
+static bool inode_data_coalesce(struct inode_data *inode_data) {
+        sd_event_source *s;
+        bool any = false;
+
+        assert(inode_data);
+
+        /* Only merge events if everybody who is going to see them asked for it */
+        LIST_FOREACH(inotify.by_inode_data, s, inode_data->event_sources) {
+                if (s->enabled == SD_EVENT_OFF)
+                        continue;
+                if (!s->inotify.coalesce)
+                        return false;
+
+                any = true;
+        }
+
+        return any;
+}
+
+static void event_inotify_data_coalesce(struct inotify_data *d, size_t sz) {
+        struct inotify_event *head = &d->buffer.ev;
+        size_t offset = sz;
+
+        assert(d);
+
+        /* Merges all later events in the buffer for the same watch descriptor and file name into the one
+         * at the front, until we hit one that must be delivered on its own. Events for other names or
+         * watches are left in place. Renames are never merged, as they are paired by the cookie. */
+
+        if ((head->mask & (IN_IGNORED|IN_UNMOUNT|IN_Q_OVERFLOW)) != 0 || head->cookie != 0)
+                return;
+
+        while (offset + offsetof(struct inotify_event, name) <= d->buffer_filled) {
+                struct inotify_event *ev = (struct inotify_event*) (d->buffer.raw + offset);
+                size_t esz = offsetof(struct inotify_event, name) + ev->len;
+
+                if (offset + esz > d->buffer_filled)
+                        break;
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                        break;
+
+                if (ev->wd != head->wd || ev->len != head->len || memcmp(ev->name, head->name, head->len) != 0) {
+                        offset += esz;
+                        continue;
+                }
+
+                if ((ev->mask & (IN_IGNORED|IN_UNMOUNT)) != 0 || ev->cookie != 0)
+                        break;
+
+                head->mask |= ev->mask;
+
+                memmove(d->buffer.raw + offset, d->buffer.raw + offset + esz, d->buffer_filled - offset - esz);
+                d->buffer_filled -= esz;
+        }
+}
+
 static int event_inotify_data_process(sd_event *e, struct inotify_data *d) {
         int r;
 
@@ -3140,6 +4087,9 @@ static int event_inotify_data_process(sd_event *e, struct inotify_data *d) {
                                         event_inotify_data_drop(e, d, sz);
                                         continue;
                                 }
+
+                                if (inode_data_coalesce(inode_data))
+                                        event_inotify_data_coalesce(d, sz);
                         }
 
                         /* Trigger all event sources that are interested in these events. Also trigger all event
@@ -3184,8 +4134,64 @@ static int process_inotify(sd_event *e) {
         return done;
 }
 
+static struct source_statistics* source_get_statistics(sd_event_source *s) {
+        _cleanup_(source_statistics_freep) struct source_statistics *st = NULL;
+        _cleanup_free_ char *key = NULL;
+        sd_event *e;
+
+        assert(s);
+        assert_se(e = s->event);
+
+        if (s->statistics)
+                return s->statistics;
+
+        /* Unnamed sources are accounted by their type */
+        if (s->description)
+                key = strdup(s->description);
+        else
+                key = strjoin("(", event_source_type_to_string(s->type), ")");
+        if (!key)
+                return NULL;
+
+        s->statistics = hashmap_get(e->source_statistics, key);
+        if (s->statistics)
+                return s->statistics;
+
+        if (hashmap_ensure_allocated(&e->source_statistics, &source_statistics_hash_ops) < 0)
+                return NULL;
+
+        st = new0(struct source_statistics, 1);
+        if (!st)
+                return NULL;
+
+        st->key = TAKE_PTR(key);
+
+        if (hashmap_put(e->source_statistics, st->key, st) < 0)
+                return NULL;
+
+        s->statistics = TAKE_PTR(st);
+        return s->statistics;
+}
+
+static void source_statistics_account(struct source_statistics *st, usec_t pending_since, usec_t start, usec_t end) {
+        usec_t latency;
+
+        assert(st);
+
+        latency = pending_since > 0 ? usec_sub_unsigned(start, pending_since) : 0;
+
+        st->n_dispatched++;
+        st->total = usec_add(st->total, end - start);
+        st->max = MAX(st->max, end - start);
+        st->latency_total = usec_add(st->latency_total, latency);
+        st->latency_max = MAX(st->latency_max, latency);
+}
+
 static int source_dispatch(sd_event_source *s) {
+        struct source_statistics *statistics = NULL;
+        usec_t start = 0, pending_since = 0;
         EventSourceType saved_type;
+        sd_event *saved_event;
         int r = 0;
 
         assert(s);
@@ -3194,6 +4200,7 @@ static int source_dispatch(sd_event_source *s) {
         /* Save the event source type, here, so that we still know it after the event callback which might invalidate
          * the event. */
         saved_type = s->type;
+        saved_event = s->event;
 
         if (!IN_SET(s->type, SOURCE_DEFER, SOURCE_EXIT)) {
                 r = source_set_pending(s, false);
@@ -3224,6 +4231,16 @@ static int source_dispatch(sd_event_source *s) {
                         return r;
         }
 
+        if (s->event->statistics) {
+                /* Look the entry up before the callback, which may change the description */
+                statistics = source_get_statistics(s);
+                pending_since = s->pending_since;
+                s->pending_since = 0;
+                start = now(CLOCK_MONOTONIC);
+        }
+
+        USDT(sd_event, dispatch, saved_event, s, saved_type, s->description);
+
         s->dispatching = true;
 
         switch (s->type) {
@@ -3294,6 +4311,18 @@ static int source_dispatch(sd_event_source *s) {
                 break;
         }
 
+        case SOURCE_ASYNC:
+                r = s->async.callback(s, s->async.result, s->userdata);
+                break;
+
+        case SOURCE_WORK:
+                r = s->work.done(s, s->work.result, s->userdata);
+                break;
+
+        case SOURCE_MEMORY_PRESSURE:
+                r = s->memory_pressure.callback(s, s->userdata);
+                break;
+
         case SOURCE_WATCHDOG:
         case _SOURCE_EVENT_SOURCE_TYPE_MAX:
         case _SOURCE_EVENT_SOURCE_TYPE_INVALID:
@@ -3302,10 +4331,25 @@ static int source_dispatch(sd_event_source *s) {
 
         s->dispatching = false;
 
+        USDT(sd_event, dispatch_done, saved_event, s, saved_type, r);
+
+        if (statistics)
+                source_statistics_account(statistics, pending_since, start, now(CLOCK_MONOTONIC));
+
         if (r < 0)
                 log_debug_errno(r, "Event source %s (type %s) returned error, disabling: %m",
                                 strna(s->description), event_source_type_to_string(saved_type));
 
+        /* Async and work sources that stay enabled repeat their operation */
+        if (r >= 0 && s->n_ref > 0 && s->enabled != SD_EVENT_OFF && !s->pending &&
+            ((saved_type == SOURCE_ASYNC && !s->async.in_flight) ||
+             (saved_type == SOURCE_WORK && s->work.state == EVENT_WORK_IDLE))) {
+                r = saved_type == SOURCE_ASYNC ? source_async_submit(s) : event_pool_submit(s->work.pool, s);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to resubmit operation of event source %s (type %s), disabling: %m",
+                                        strna(s->description), event_source_type_to_string(saved_type));
+        }
+
         if (s->n_ref == 0)
                 source_free(s);
         else if (r < 0)
@@ -3412,6 +4456,32 @@ static int arm_watchdog(sd_event *e) {
         return 0;
 }
 
+static int process_work(sd_event *e, uint32_t events) {
+        sd_event_source *done, *s;
+        int r;
+
+        assert(e);
+
+        r = flush_timer(e, e->work_fd, events, NULL);
+        if (r < 0)
+                return r;
+
+        assert_se(pthread_mutex_lock(&e->work_lock) == 0);
+        done = TAKE_PTR(e->work_done);
+        assert_se(pthread_mutex_unlock(&e->work_lock) == 0);
+
+        while ((s = done)) {
+                LIST_REMOVE(work.work_queue, done, s);
+                s->work.state = EVENT_WORK_IDLE;
+
+                r = source_set_pending(s, true);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 static int process_watchdog(sd_event *e) {
         assert(e);
 
@@ -3510,6 +4580,39 @@ pending:
         return r;
 }
 
+static int event_wait_uring(sd_event *e, usec_t timeout, size_t event_queue_max) {
+        int r, m;
+
+        assert(e);
+        assert(e->uring);
+
+        /* Submit the operations queued since the last iteration and wait for them and the epoll fd in one
+         * go. The remaining wakeups (timers, signals, I/O, …) are still delivered by epoll. */
+        if (!e->uring_poll_armed) {
+                r = event_uring_queue(e->uring, EVENT_URING_POLL, e->epoll_fd, NULL, POLLIN, 0, 0, URING_POLL_TAG);
+                if (r < 0)
+                        return r;
+
+                e->uring_poll_armed = true;
+        }
+
+        r = event_uring_enter(e->uring, timeout);
+        if (r < 0)
+                return r;
+
+        event_uring_reap(e);
+
+        /* Unless we are only polling anyway, skip epoll_wait() if the epoll fd didn't become readable */
+        if (e->uring_poll_armed && timeout != 0)
+                return 0;
+
+        m = epoll_wait(e->epoll_fd, e->event_queue, event_queue_max, 0);
+        if (m < 0)
+                return -errno;
+
+        return m;
+}
+
 _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
         size_t event_queue_max;
         int r, m, i;
@@ -3533,15 +4636,21 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
         if (e->inotify_data_buffered)
                 timeout = 0;
 
-        m = epoll_wait(e->epoll_fd, e->event_queue, event_queue_max,
-                       timeout == (uint64_t) -1 ? -1 : (int) DIV_ROUND_UP(timeout, USEC_PER_MSEC));
+        if (e->uring)
+                m = event_wait_uring(e, timeout, event_queue_max);
+        else {
+                m = epoll_wait(e->epoll_fd, e->event_queue, event_queue_max,
+                               timeout == (uint64_t) -1 ? -1 : (int) DIV_ROUND_UP(timeout, USEC_PER_MSEC));
+                if (m < 0)
+                        m = -errno;
+        }
         if (m < 0) {
-                if (errno == EINTR) {
+                if (m == -EINTR) {
                         e->state = SD_EVENT_PENDING;
                         return 1;
                 }
 
-                r = -errno;
+                r = m;
                 goto finish;
         }
 
@@ -3551,6 +4660,8 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
 
                 if (e->event_queue[i].data.ptr == INT_TO_PTR(SOURCE_WATCHDOG))
                         r = flush_timer(e, e->watchdog_fd, e->event_queue[i].events, NULL);
+                else if (e->event_queue[i].data.ptr == INT_TO_PTR(SOURCE_WORK))
+                        r = process_work(e, e->event_queue[i].events);
                 else {
                         WakeupType *t = e->event_queue[i].data.ptr;
 
@@ -3571,6 +4682,10 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
                                         r = process_pidfd(e, s, e->event_queue[i].events);
                                         break;
 
+                                case SOURCE_MEMORY_PRESSURE:
+                                        r = source_set_pending(s, true);
+                                        break;
+
                                 default:
                                         assert_not_reached("Unexpected event source type");
                                 }
@@ -3934,6 +5049,78 @@ _public_ int sd_event_get_iteration(sd_event *e, uint64_t *ret) {
         return 0;
 }
 
+_public_ int sd_event_set_statistics(sd_event *e, int b) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        e->statistics = b;
+        return 0;
+}
+
+_public_ int sd_event_get_statistics(sd_event *e) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        return e->statistics;
+}
+
+_public_ int sd_event_list_statistics(sd_event *e, char ***ret) {
+        _cleanup_strv_free_ char **l = NULL;
+        struct source_statistics *st;
+        Iterator i;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(ret, -EINVAL);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        HASHMAP_FOREACH(st, e->source_statistics, i) {
+                r = strv_extend(&l, st->key);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = strv_sort(TAKE_PTR(l));
+        return 0;
+}
+
+_public_ int sd_event_get_source_statistics(
+                sd_event *e,
+                const char *key,
+                uint64_t *ret_dispatched,
+                uint64_t *ret_total_usec,
+                uint64_t *ret_max_usec,
+                uint64_t *ret_latency_total_usec,
+                uint64_t *ret_latency_max_usec) {
+
+        struct source_statistics *st;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(key, -EINVAL);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        st = hashmap_get(e->source_statistics, key);
+        if (!st)
+                return -ENOENT;
+
+        if (ret_dispatched)
+                *ret_dispatched = st->n_dispatched;
+        if (ret_total_usec)
+                *ret_total_usec = st->total;
+        if (ret_max_usec)
+                *ret_max_usec = st->max;
+        if (ret_latency_total_usec)
+                *ret_latency_total_usec = st->latency_total;
+        if (ret_latency_max_usec)
+                *ret_latency_max_usec = st->latency_max;
+
+        return 0;
+}
+
 _public_ int sd_event_source_set_destroy_callback(sd_event_source *s, sd_event_destroy_t callback) {
         assert_return(s, -EINVAL);
 
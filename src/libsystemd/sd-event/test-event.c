@@ -9,6 +9,7 @@
 #include "fs-util.h"
 #include "log.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "missing_syscall.h"
 #include "parse-util.h"
 #include "path-util.h"
@@ -17,6 +18,7 @@
 #include "signal-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "strv.h"
 #include "tests.h"
 #include "tmpfile-util.h"
 #include "util.h"
@@ -520,6 +522,67 @@ static void test_inotify(unsigned n_create_events) {
         sd_event_unref(e);
 }
 
+struct coalesce_context {
+        unsigned n_called;
+        uint32_t mask;
+};
+
+static int coalesce_handler(sd_event_source *s, const struct inotify_event *ev, void *userdata) {
+        struct coalesce_context *c = userdata;
+
+        log_info("inotify-handler <coalesce>: mask %" PRIx32, ev->mask);
+
+        c->n_called++;
+        c->mask |= ev->mask;
+        return 0;
+}
+
+static void test_inotify_coalesce(void) {
+        _cleanup_(unlink_tempfilep) char p[] = "/tmp/test-inotify-coalesce-XXXXXX";
+        struct coalesce_context c = {};
+        _cleanup_close_ int fd = -1;
+        sd_event_source *s = NULL;
+        sd_event *e = NULL;
+        unsigned i;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        fd = mkostemp_safe(p);
+        assert_se(fd >= 0);
+
+        assert_se(sd_event_add_inotify(e, &s, p, IN_MODIFY|IN_CLOSE_WRITE, coalesce_handler, &c) >= 0);
+        assert_se(sd_event_source_get_inotify_coalesce(s) == 0);
+        assert_se(sd_event_source_set_inotify_coalesce(s, true) >= 0);
+        assert_se(sd_event_source_get_inotify_coalesce(s) > 0);
+
+        for (i = 0; i < 5; i++)
+                assert_se(write(fd, "x", 1) == 1);
+        fd = safe_close(fd);
+
+        /* The writes and the close are folded into a single dispatch */
+        while (sd_event_run(e, 0) > 0)
+                ;
+        assert_se(c.n_called == 1);
+        assert_se(c.mask == (IN_MODIFY|IN_CLOSE_WRITE));
+
+        /* Without coalescing they are dispatched one by one */
+        assert_se(sd_event_source_set_inotify_coalesce(s, false) >= 0);
+        c = (struct coalesce_context) {};
+
+        fd = open(p, O_WRONLY|O_CLOEXEC);
+        assert_se(fd >= 0);
+        assert_se(write(fd, "x", 1) == 1);
+        fd = safe_close(fd);
+
+        while (sd_event_run(e, 0) > 0)
+                ;
+        assert_se(c.n_called == 2);
+        assert_se(c.mask == (IN_MODIFY|IN_CLOSE_WRITE));
+
+        sd_event_source_unref(s);
+        sd_event_unref(e);
+}
+
 static int pidfd_handler(sd_event_source *s, const siginfo_t *si, void *userdata) {
         assert_se(s);
         assert_se(si);
@@ -590,6 +653,307 @@ static void test_pidfd(void) {
         sd_event_unref(e);
 }
 
+#define N_TIMERS 2000U
+
+static unsigned n_timers_fired = 0;
+static uint64_t timers_start = 0;
+
+static int timer_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        uint64_t n, next, accuracy;
+
+        assert_se(sd_event_now(sd_event_source_get_event(s), CLOCK_MONOTONIC, &n) >= 0);
+        assert_se(sd_event_source_get_time(s, &next) >= 0);
+        assert_se(sd_event_source_get_time_accuracy(s, &accuracy) >= 0);
+
+        /* Never early. Allow some slack for being late, the machine might be busy. */
+        assert_se(n >= next);
+        assert_se(n <= MAX(next, timers_start) + accuracy + USEC_PER_SEC);
+
+        if (++n_timers_fired >= N_TIMERS)
+                assert_se(sd_event_exit(sd_event_source_get_event(s), 0) >= 0);
+
+        return 0;
+}
+
+static void test_timers(void) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        static const usec_t accuracies[] = { 1, 250 * USEC_PER_MSEC, 500 * USEC_PER_MSEC, USEC_PER_SEC };
+        sd_event_source *s[N_TIMERS];
+        uint64_t start, t;
+        unsigned i;
+
+        /* Mixes sources kept in the timer wheel (coarse accuracy) and in the prioqs, re-arms most of them a
+         * few times, toggles some and moves some between the two by changing their accuracy. */
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_now(e, CLOCK_MONOTONIC, &start) >= 0);
+        timers_start = start;
+
+        for (i = 0; i < N_TIMERS; i++) {
+                t = start + (i * 7919U % N_TIMERS) * USEC_PER_MSEC;
+
+                assert_se(sd_event_add_time(e, &s[i], CLOCK_MONOTONIC, t, accuracies[i % ELEMENTSOF(accuracies)],
+                                            timer_handler, NULL) >= 0);
+        }
+
+        for (i = 0; i < N_TIMERS; i++) {
+                if (i % 3 == 0)
+                        assert_se(sd_event_source_set_time(s[i], USEC_INFINITY) >= 0);
+                if (i % 5 == 0)
+                        assert_se(sd_event_source_set_time(s[i], start + 60 * USEC_PER_SEC) >= 0);
+                if (i % 7 == 0)
+                        assert_se(sd_event_source_set_enabled(s[i], SD_EVENT_OFF) >= 0);
+                if (i % 11 == 0)
+                        assert_se(sd_event_source_set_time_accuracy(s[i], accuracies[(i + 1) % ELEMENTSOF(accuracies)]) >= 0);
+                if (i % 13 == 0)
+                        assert_se(sd_event_source_set_time_accuracy(s[i], accuracies[(i + 2) % ELEMENTSOF(accuracies)]) >= 0);
+
+                /* Some in the past, the rest spread over the next 2.5s */
+                t = i % 17 == 0 ? start - USEC_PER_SEC : start + (i * 104729U % 2500U) * USEC_PER_MSEC;
+                assert_se(sd_event_source_set_time(s[i], t) >= 0);
+                assert_se(sd_event_source_set_enabled(s[i], SD_EVENT_ONESHOT) >= 0);
+        }
+
+        /* Far enough out to be redistributed from a higher level of the wheel */
+        if (slow_tests_enabled())
+                assert_se(sd_event_source_set_time(s[1], start + 20 * USEC_PER_SEC) >= 0);
+
+        assert_se(sd_event_loop(e) >= 0);
+        assert_se(n_timers_fired == N_TIMERS);
+
+        for (i = 0; i < N_TIMERS; i++)
+                sd_event_source_unref(s[i]);
+}
+
+static unsigned n_async_read, n_async_write;
+static bool got_async_timer;
+static char async_buf[16];
+
+static int async_write_handler(sd_event_source *s, int result, void *userdata) {
+        assert_se(result == 5);
+        n_async_write++;
+        return 0;
+}
+
+static int async_read_handler(sd_event_source *s, int result, void *userdata) {
+        sd_event_source *w = userdata;
+
+        assert_se(result == 5);
+        assert_se(memcmp(async_buf, "hallo", 5) == 0);
+        memzero(async_buf, sizeof(async_buf));
+
+        /* Leave the read in flight after the last round, it is cancelled when the source is freed */
+        if (++n_async_read >= 3)
+                return 0;
+
+        /* Writes are one-shot by default, queue the next one */
+        return sd_event_source_set_enabled(w, SD_EVENT_ONESHOT);
+}
+
+static int async_time_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        /* Make sure epoll-based sources keep working next to the ring */
+        got_async_timer = true;
+        return sd_event_exit(sd_event_source_get_event(s), 0);
+}
+
+static void test_async(void) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *r = NULL, *w = NULL, *t = NULL, *c = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_pair_ int p[2] = { -1, -1 }, q[2] = { -1, -1 };
+        char buf[16];
+        int k;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(sd_event_new_with_flags(&e, SD_EVENT_IO_URING) >= 0);
+        assert_se(pipe2(p, O_CLOEXEC) >= 0);
+        assert_se(pipe2(q, O_CLOEXEC) >= 0);
+
+        k = sd_event_add_async_write(e, &w, p[1], "hallo", 5, (uint64_t) -1, async_write_handler, NULL);
+        if (k == -EOPNOTSUPP) {
+                log_notice("io_uring not available, skipping %s.", __func__);
+                return;
+        }
+        assert_se(k >= 0);
+
+        assert_se(sd_event_add_async_read(e, &r, p[0], async_buf, sizeof(async_buf), (uint64_t) -1, async_read_handler, w) >= 0);
+
+        /* A read that never completes, disabled and freed while in flight */
+        assert_se(sd_event_add_async_read(e, &c, q[0], buf, sizeof(buf), (uint64_t) -1, async_read_handler, NULL) >= 0);
+        assert_se(sd_event_add_time_relative(e, &t, CLOCK_MONOTONIC, 100 * USEC_PER_MSEC, 0, async_time_handler, NULL) >= 0);
+
+        assert_se(sd_event_run(e, 0) >= 0);
+        assert_se(sd_event_source_set_enabled(c, SD_EVENT_OFF) >= 0);
+        c = sd_event_source_unref(c);
+
+        assert_se(sd_event_loop(e) >= 0);
+        assert_se(n_async_read == 3);
+        assert_se(n_async_write == 3);
+        assert_se(got_async_timer);
+
+        /* Nothing must have been consumed from the other pipe */
+        assert_se(write(q[1], "x", 1) == 1);
+        k = read(q[0], buf, sizeof(buf));
+        assert_se(k == 1);
+
+        /* Without the flag async sources are refused */
+        e = sd_event_unref(e);
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_add_async_read(e, NULL, p[0], async_buf, sizeof(async_buf), (uint64_t) -1, async_read_handler, NULL) == -EOPNOTSUPP);
+}
+
+static int statistics_handler(sd_event_source *s, void *userdata) {
+        unsigned *n = userdata;
+
+        if (++(*n) >= 3)
+                return sd_event_exit(sd_event_source_get_event(s), 0);
+
+        return 0;
+}
+
+static void test_statistics(void) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *a = NULL, *b = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_strv_free_ char **keys = NULL;
+        uint64_t n, total, max, latency_total, latency_max;
+        unsigned n_a = 0, n_b = 0;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_get_statistics(e) == 0);
+        assert_se(sd_event_set_statistics(e, true) >= 0);
+        assert_se(sd_event_get_statistics(e) > 0);
+
+        assert_se(sd_event_add_defer(e, &a, statistics_handler, &n_a) >= 0);
+        assert_se(sd_event_source_set_enabled(a, SD_EVENT_ON) >= 0);
+        assert_se(sd_event_source_set_description(a, "test-a") >= 0);
+        assert_se(sd_event_add_defer(e, &b, statistics_handler, &n_b) >= 0);
+        assert_se(sd_event_source_set_priority(b, SD_EVENT_PRIORITY_IMPORTANT) >= 0);
+
+        assert_se(sd_event_loop(e) >= 0);
+
+        assert_se(sd_event_list_statistics(e, &keys) >= 0);
+        assert_se(strv_equal(keys, STRV_MAKE("(defer)", "test-a")));
+
+        assert_se(sd_event_get_source_statistics(e, "test-a", &n, &total, &max, &latency_total, &latency_max) >= 0);
+        assert_se(n == n_a);
+        assert_se(max <= total);
+        assert_se(latency_max <= latency_total);
+        assert_se(sd_event_get_source_statistics(e, "(defer)", &n, NULL, NULL, NULL, NULL) >= 0);
+        assert_se(n == 1 && n_b == 1);
+        assert_se(sd_event_get_source_statistics(e, "test-b", NULL, NULL, NULL, NULL, NULL) == -ENOENT);
+
+        /* What was recorded is kept when disabling collection */
+        assert_se(sd_event_set_statistics(e, false) >= 0);
+        assert_se(sd_event_get_statistics(e) == 0);
+        assert_se(sd_event_get_source_statistics(e, "test-a", &n, NULL, NULL, NULL, NULL) >= 0);
+        assert_se(n == 3);
+}
+
+#define N_WORK 200
+
+static unsigned n_work_run, n_work_done;
+static unsigned work_slow_started;
+
+static int work_handler(void *userdata) {
+        unsigned *v = userdata;
+
+        __sync_fetch_and_add(&n_work_run, 1);
+
+        /* Something CPU bound */
+        for (unsigned i = 0; i < 10000; i++)
+                *v = *v * 1103515245 + 12345;
+
+        return 7;
+}
+
+static int work_slow_handler(void *userdata) {
+        __sync_lock_test_and_set(&work_slow_started, 1);
+        usleep(100 * USEC_PER_MSEC);
+        return work_handler(userdata);
+}
+
+static int work_done_handler(sd_event_source *s, int result, void *userdata) {
+        assert_se(result == 7);
+
+        if (++n_work_done == N_WORK)
+                return sd_event_exit(sd_event_source_get_event(s), 0);
+
+        return 0;
+}
+
+static void test_work(void) {
+        _cleanup_(sd_event_pool_unrefp) sd_event_pool *p = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        sd_event_source *s[N_WORK], *slow;
+        unsigned v[N_WORK] = {}, i;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_pool_new(&p, 4) >= 0);
+
+        for (i = 0; i < N_WORK; i++)
+                assert_se(sd_event_add_work(e, &s[i], p, work_handler, work_done_handler, &v[i]) >= 0);
+
+        assert_se(sd_event_loop(e) >= 0);
+        assert_se(n_work_run == N_WORK);
+        assert_se(n_work_done == N_WORK);
+
+        for (i = 0; i < N_WORK; i++)
+                s[i] = sd_event_source_unref(s[i]);
+        e = sd_event_unref(e);
+        p = sd_event_pool_unref(p);
+
+        /* Work that didn't start yet is dropped when the source is freed, running work is waited for */
+        n_work_run = n_work_done = 0;
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_pool_new(&p, 1) >= 0);
+
+        assert_se(sd_event_add_work(e, &slow, p, work_slow_handler, work_done_handler, &v[0]) >= 0);
+        for (i = 1; i < N_WORK; i++)
+                assert_se(sd_event_add_work(e, &s[i], p, work_handler, work_done_handler, &v[i]) >= 0);
+
+        while (__sync_fetch_and_or(&work_slow_started, 0) == 0)
+                usleep(USEC_PER_MSEC);
+        for (i = 1; i < N_WORK; i++)
+                s[i] = sd_event_source_unref(s[i]);
+        slow = sd_event_source_unref(slow);
+
+        assert_se(n_work_run == 1);
+        assert_se(n_work_done == 0);
+}
+
+static int memory_pressure_handler(sd_event_source *s, void *userdata) {
+        return 0;
+}
+
+static void test_memory_pressure(void) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        int r;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        r = sd_event_add_memory_pressure(e, &s, memory_pressure_handler, NULL);
+        if (IN_SET(r, -EOPNOTSUPP, -EACCES, -EPERM)) {
+                log_notice_errno(r, "Memory pressure event source not available, skipping: %m");
+                return;
+        }
+        assert_se(r >= 0);
+
+        assert_se(sd_event_source_get_pending(s) == 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_OFF) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ON) >= 0);
+
+        /* No pressure is expected here, hence nothing should be dispatched */
+        assert_se(sd_event_run(e, 0) == 0);
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_INFO);
 
@@ -598,11 +962,18 @@ int main(int argc, char *argv[]) {
 
         test_sd_event_now();
         test_rtqueue();
+        test_timers();
 
         test_inotify(100); /* should work without overflow */
         test_inotify(33000); /* should trigger a q overflow */
+        test_inotify_coalesce();
 
         test_pidfd();
 
+        test_async();
+        test_statistics();
+        test_work();
+        test_memory_pressure();
+
         return 0;
 }
@@ -1,8 +1,11 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "alloc-util.h"
 #include "conf-files.h"
@@ -11,10 +14,13 @@
 #include "fs-util.h"
 #include "hwdb-internal.h"
 #include "hwdb-util.h"
+#include "io-util.h"
 #include "label.h"
 #include "mkdir.h"
 #include "path-util.h"
+#include "siphash24.h"
 #include "sort-util.h"
+#include "stat-util.h"
 #include "strbuf.h"
 #include "string-util.h"
 #include "strv.h"
@@ -32,6 +38,14 @@ static const char * const conf_file_dirs[] = {
  * Uses a Patricia/radix trie to index all matches for efficient lookup.
  */
 
+/* Reading the source files is spread over this many threads at most */
+#define HWDB_LOAD_THREADS_MAX 8U
+
+static const uint8_t hwdb_hash_key[] = {
+        0xa1, 0x48, 0x11, 0x35, 0xb4, 0x67, 0x42, 0x15,
+        0x9e, 0x2e, 0xa6, 0x9b, 0x23, 0xf6, 0x0d, 0x93
+};
+
 /* in-memory trie objects */
 struct trie {
         struct trie_node *root;
@@ -76,18 +90,27 @@ static int trie_children_cmp(const struct trie_child_entry *a, const struct trie
 
 static int node_add_child(struct trie *trie, struct trie_node *node, struct trie_node *node_child, uint8_t c) {
         struct trie_child_entry *child;
+        size_t i;
 
-        /* extend array, add new entry, sort for bisection */
+        /* extend array, add new entry, keep it sorted for bisection */
         child = reallocarray(node->children, node->children_count + 1, sizeof(struct trie_child_entry));
         if (!child)
                 return -ENOMEM;
 
         node->children = child;
-        trie->children_count++;
-        node->children[node->children_count].c = c;
-        node->children[node->children_count].child = node_child;
+
+        for (i = node->children_count; i > 0 && node->children[i - 1].c > c; i--)
+                ;
+
+        memmove(node->children + i + 1, node->children + i,
+                sizeof(struct trie_child_entry) * (node->children_count - i));
+        node->children[i] = (struct trie_child_entry) {
+                .c = c,
+                .child = node_child,
+        };
         node->children_count++;
-        typesafe_qsort(node->children, node->children_count, trie_children_cmp);
+
+        trie->children_count++;
         trie->nodes_count++;
 
         return 0;
@@ -138,6 +161,7 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                                const char *filename, uint16_t file_priority, uint32_t line_number, bool compat) {
         ssize_t k, v, fn = 0;
         struct trie_value_entry *val;
+        size_t i;
 
         k = strbuf_add_string(trie->strings, key, strlen(key));
         if (k < 0)
@@ -170,13 +194,19 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                 }
         }
 
-        /* extend array, add new entry, sort for bisection */
+        /* extend array, add new entry, keep it sorted for bisection */
         val = reallocarray(node->values, node->values_count + 1, sizeof(struct trie_value_entry));
         if (!val)
                 return -ENOMEM;
         trie->values_count++;
         node->values = val;
-        node->values[node->values_count] = (struct trie_value_entry) {
+
+        for (i = node->values_count; i > 0 && strcmp(trie->strings->buf + node->values[i - 1].key_off, key) > 0; i--)
+                ;
+
+        memmove(node->values + i + 1, node->values + i,
+                sizeof(struct trie_value_entry) * (node->values_count - i));
+        node->values[i] = (struct trie_value_entry) {
                 .key_off = k,
                 .value_off = v,
                 .filename_off = fn,
@@ -184,7 +214,6 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                 .line_number = line_number,
         };
         node->values_count++;
-        typesafe_qsort_r(node->values, node->values_count, trie_values_cmp, trie);
         return 0;
 }
 
@@ -359,7 +388,7 @@ static int64_t trie_store_nodes(struct trie_f *trie, struct trie_node *node, boo
         return node_off;
 }
 
-static int trie_store(struct trie *trie, const char *filename, bool compat) {
+static int trie_store(struct trie *trie, const char *filename, uint64_t sources_hash, bool compat) {
         struct trie_f t = {
                 .trie = trie,
         };
@@ -374,6 +403,7 @@ static int trie_store(struct trie *trie, const char *filename, bool compat) {
                 .node_size = htole64(sizeof(struct trie_node_f)),
                 .child_entry_size = htole64(sizeof(struct trie_child_entry_f)),
                 .value_entry_size = htole64(compat ? sizeof(struct trie_value_entry_f) : sizeof(struct trie_value_entry2_f)),
+                .sources_hash = htole64(sources_hash),
         };
         int r;
 
@@ -468,48 +498,247 @@ static int insert_data(struct trie *trie, char **match_list, char *line, const c
         return 0;
 }
 
-static int import_file(struct trie *trie, const char *filename, uint16_t file_priority, bool compat) {
+/* a hwdb.d file, read and split into lines before it is imported into the trie */
+struct hwdb_file {
+        const char *filename;
+        int error;
+
+        char *contents;
+        uint64_t hash;
+
+        /* lines[i] is line i + 1, with trailing whitespace and comments removed, or NULL for comment lines */
+        char **lines;
+        size_t n_lines;
+        size_t n_allocated;
+};
+
+struct hwdb_loader {
+        struct hwdb_file *files;
+        size_t n_files;
+        size_t next;
+};
+
+static void hwdb_loader_done(struct hwdb_loader *loader) {
+        assert(loader);
+
+        for (size_t i = 0; i < loader->n_files; i++) {
+                free(loader->files[i].contents);
+                free(loader->files[i].lines);
+        }
+
+        loader->files = mfree(loader->files);
+        loader->n_files = 0;
+}
+
+static int hwdb_file_load(struct hwdb_file *file) {
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        ssize_t n;
+        char *p, *e;
+        int r;
+
+        assert(file);
+
+        fd = open(file->filename, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        r = stat_verify_regular(&st);
+        if (r < 0)
+                return r;
+
+        file->contents = new(char, st.st_size + 1);
+        if (!file->contents)
+                return -ENOMEM;
+
+        n = loop_read(fd, file->contents, st.st_size, true);
+        if (n < 0)
+                return (int) n;
+        file->contents[n] = '\0';
+
+        file->hash = siphash24(file->contents, n, hwdb_hash_key);
+
+        for (p = file->contents, e = p + n; p < e; ) {
+                char *eol, *pos;
+                size_t len;
+
+                eol = memchr(p, '\n', e - p) ?: e;
+                *eol = '\0';
+
+                if (!GREEDY_REALLOC(file->lines, file->n_allocated, file->n_lines + 1))
+                        return -ENOMEM;
+
+                /* comment line */
+                if (p[0] == '#') {
+                        file->lines[file->n_lines++] = NULL;
+                        p = eol + 1;
+                        continue;
+                }
+
+                /* strip trailing comment */
+                pos = strchr(p, '#');
+                if (pos)
+                        pos[0] = '\0';
+
+                /* strip trailing whitespace */
+                len = strlen(p);
+                while (len > 0 && isspace(p[len-1]))
+                        len--;
+                p[len] = '\0';
+
+                file->lines[file->n_lines++] = p;
+                p = eol + 1;
+        }
+
+        return 0;
+}
+
+static void* hwdb_load_thread(void *userdata) {
+        struct hwdb_loader *loader = userdata;
+
+        for (;;) {
+                size_t i;
+
+                i = __sync_fetch_and_add(&loader->next, 1);
+                if (i >= loader->n_files)
+                        return NULL;
+
+                loader->files[i].error = hwdb_file_load(loader->files + i);
+        }
+}
+
+static int hwdb_load_files(struct hwdb_loader *loader, char **filenames) {
+        pthread_t threads[HWDB_LOAD_THREADS_MAX];
+        size_t n_threads = 0;
+        sigset_t ss, saved_ss;
+        long ncpus;
+        int r, k;
+
+        assert(loader);
+        assert(!loader->files);
+
+        /* Reads all files, and splits them into lines. Most of the time goes into waiting for the disk and
+         * into hashing, hence do that in a couple of threads. Importing them into the trie can only happen
+         * one after the other though, as later files override earlier ones. */
+
+        loader->files = new0(struct hwdb_file, strv_length(filenames));
+        if (!loader->files)
+                return -ENOMEM;
+
+        for (loader->n_files = 0; filenames[loader->n_files]; loader->n_files++)
+                loader->files[loader->n_files].filename = filenames[loader->n_files];
+
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (loader->n_files > 1 && ncpus > 1) {
+                /* Make sure the threads don't steal any signals from us */
+                assert_se(sigfillset(&ss) >= 0);
+                r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+                if (r > 0)
+                        return -r;
+
+                for (; n_threads < MIN3(loader->n_files, (size_t) ncpus, HWDB_LOAD_THREADS_MAX); n_threads++) {
+                        r = pthread_create(threads + n_threads, NULL, hwdb_load_thread, loader);
+                        if (r > 0) {
+                                log_debug_errno(r, "Failed to start thread for reading hwdb files, ignoring: %m");
+                                break;
+                        }
+                }
+
+                k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+                if (k > 0)
+                        log_debug_errno(k, "Failed to restore signal mask, ignoring: %m");
+        }
+
+        /* Help out, or do everything ourselves if we have no threads */
+        (void) hwdb_load_thread(loader);
+
+        for (size_t i = 0; i < n_threads; i++)
+                (void) pthread_join(threads[i], NULL);
+
+        for (size_t i = 0; i < loader->n_files; i++)
+                if (loader->files[i].error == -ENOMEM)
+                        return -ENOMEM;
+
+        return 0;
+}
+
+static uint64_t hwdb_files_hash(const struct hwdb_file *files, size_t n_files) {
+        struct siphash state;
+        uint64_t h;
+
+        siphash24_init(&state, hwdb_hash_key);
+
+        for (size_t i = 0; i < n_files; i++) {
+                le64_t le;
+
+                siphash24_compress(files[i].filename, strlen(files[i].filename) + 1, &state);
+
+                le = htole64(files[i].error < 0 ? (uint64_t) -files[i].error : files[i].hash);
+                siphash24_compress(&le, sizeof(le), &state);
+        }
+
+        /* Zero means "unknown" in the header */
+        h = siphash24_finalize(&state);
+        return h == 0 ? 1 : h;
+}
+
+static bool hwdb_bin_up_to_date(const char *filename, uint64_t sources_hash, bool compat) {
+        const char sig[] = HWDB_SIG;
+        struct trie_header_f h;
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        ssize_t n;
+
+        /* Checks whether filename was built by us from the very same sources, in the same format */
+
+        fd = open(filename, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return false;
+
+        if (fstat(fd, &st) < 0)
+                return false;
+
+        n = loop_read(fd, &h, sizeof(h), true);
+        if (n != sizeof(h))
+                return false;
+
+        return memcmp(h.signature, sig, sizeof(h.signature)) == 0 &&
+                le64toh(h.tool_version) == PROJECT_VERSION &&
+                le64toh(h.file_size) == (uint64_t) st.st_size &&
+                le64toh(h.header_size) == sizeof(struct trie_header_f) &&
+                le64toh(h.value_entry_size) == (compat ? sizeof(struct trie_value_entry_f) : sizeof(struct trie_value_entry2_f)) &&
+                le64toh(h.sources_hash) == sources_hash;
+}
+
+static int import_file(struct trie *trie, const struct hwdb_file *file, uint16_t file_priority, bool compat) {
         enum {
                 HW_NONE,
                 HW_MATCH,
                 HW_DATA,
         } state = HW_NONE;
-        _cleanup_fclose_ FILE *f = NULL;
         _cleanup_strv_free_ char **match_list = NULL;
+        const char *filename = file->filename;
         uint32_t line_number = 0;
         int r = 0, err;
 
-        f = fopen(filename, "re");
-        if (!f)
-                return -errno;
+        if (file->error < 0)
+                return file->error;
 
-        for (;;) {
-                _cleanup_free_ char *line = NULL;
+        for (size_t i = 0; i < file->n_lines; i++) {
+                char *line = file->lines[i];
                 size_t len;
-                char *pos;
-
-                r = read_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
-                if (r < 0)
-                        return r;
-                if (r == 0)
-                        break;
 
-                ++line_number;
+                line_number = i + 1;
 
                 /* comment line */
-                if (line[0] == '#')
+                if (!line)
                         continue;
 
-                /* strip trailing comment */
-                pos = strchr(line, '#');
-                if (pos)
-                        pos[0] = '\0';
-
-                /* strip trailing whitespace */
                 len = strlen(line);
-                while (len > 0 && isspace(line[len-1]))
-                        len--;
-                line[len] = '\0';
 
                 switch (state) {
                 case HW_NONE:
@@ -587,11 +816,12 @@ static int import_file(struct trie *trie, const char *filename, uint16_t file_pr
 }
 
 int hwdb_update(const char *root, const char *hwdb_bin_dir, bool strict, bool compat) {
+        _cleanup_(hwdb_loader_done) struct hwdb_loader loader = {};
         _cleanup_free_ char *hwdb_bin = NULL;
         _cleanup_(trie_freep) struct trie *trie = NULL;
         _cleanup_strv_free_ char **files = NULL;
-        char **f;
-        uint16_t file_priority = 1;
+        uint64_t sources_hash;
+        bool clean = true;
         int r = 0, err;
 
         /* The argument 'compat' controls the format version of database. If false, then hwdb.bin will be created with
@@ -599,6 +829,26 @@ int hwdb_update(const char *root, const char *hwdb_bin_dir, bool strict, bool co
          * will be created without the information. systemd-hwdb command should set the argument false, and 'udevadm hwdb'
          * command should set it true. */
 
+        err = conf_files_list_strv(&files, ".hwdb", root, 0, conf_file_dirs);
+        if (err < 0)
+                return log_error_errno(err, "Failed to enumerate hwdb files: %m");
+
+        err = hwdb_load_files(&loader, files);
+        if (err < 0)
+                return log_error_errno(err, "Failed to read hwdb files: %m");
+
+        hwdb_bin = path_join(root, hwdb_bin_dir ?: default_hwdb_bin_dir, "hwdb.bin");
+        if (!hwdb_bin)
+                return -ENOMEM;
+
+        /* Nothing to do if the database was built from exactly these sources before, e.g. when a package
+         * update touched the files without changing them. */
+        sources_hash = hwdb_files_hash(loader.files, loader.n_files);
+        if (hwdb_bin_up_to_date(hwdb_bin, sources_hash, compat)) {
+                log_debug("%s is up to date, not rebuilding.", hwdb_bin);
+                return 0;
+        }
+
         trie = new0(struct trie, 1);
         if (!trie)
                 return -ENOMEM;
@@ -615,15 +865,14 @@ int hwdb_update(const char *root, const char *hwdb_bin_dir, bool strict, bool co
 
         trie->nodes_count++;
 
-        err = conf_files_list_strv(&files, ".hwdb", root, 0, conf_file_dirs);
-        if (err < 0)
-                return log_error_errno(err, "Failed to enumerate hwdb files: %m");
-
-        STRV_FOREACH(f, files) {
-                log_debug("Reading file \"%s\"", *f);
-                err = import_file(trie, *f, file_priority++, compat);
-                if (err < 0 && strict)
-                        r = err;
+        for (size_t i = 0; i < loader.n_files; i++) {
+                log_debug("Reading file \"%s\"", loader.files[i].filename);
+                err = import_file(trie, loader.files + i, i + 1, compat);
+                if (err < 0) {
+                        clean = false;
+                        if (strict)
+                                r = err;
+                }
         }
 
         strbuf_complete(trie->strings);
@@ -642,12 +891,9 @@ int hwdb_update(const char *root, const char *hwdb_bin_dir, bool strict, bool co
         log_debug("strings dedup'ed: %8zu bytes (%8zu)",
                   trie->strings->dedup_len, trie->strings->dedup_count);
 
-        hwdb_bin = path_join(root, hwdb_bin_dir ?: default_hwdb_bin_dir, "hwdb.bin");
-        if (!hwdb_bin)
-                return -ENOMEM;
-
+        /* Only remember the sources if they are fine, so that any problems are reported again next time */
         mkdir_parents_label(hwdb_bin, 0755);
-        err = trie_store(trie, hwdb_bin, compat);
+        err = trie_store(trie, hwdb_bin, clean ? sources_hash : 0, compat);
         if (err < 0)
                 return log_error_errno(err, "Failed to write database %s: %m", hwdb_bin);
 
@@ -35,6 +35,11 @@ struct sd_hwdb {
         OrderedHashmap *properties;
         Iterator properties_iterator;
         bool properties_modified;
+
+        /* The modalias the current properties were looked up for. Callers commonly query the same
+         * modalias several times in a row (e.g. one sd_hwdb_get() per key), so we don't walk the
+         * trie again in that case. */
+        char *properties_modalias;
 };
 
 struct linebuf {
@@ -367,6 +372,7 @@ static sd_hwdb *hwdb_free(sd_hwdb *hwdb) {
                 munmap((void *)hwdb->map, hwdb->st.st_size);
         safe_fclose(hwdb->f);
         ordered_hashmap_free(hwdb->properties);
+        free(hwdb->properties_modalias);
         return mfree(hwdb);
 }
 
@@ -397,13 +403,27 @@ bool hwdb_validate(sd_hwdb *hwdb) {
 }
 
 static int properties_prepare(sd_hwdb *hwdb, const char *modalias) {
+        int r;
+
         assert(hwdb);
         assert(modalias);
 
-        ordered_hashmap_clear(hwdb->properties);
         hwdb->properties_modified = true;
 
-        return trie_search_f(hwdb, modalias);
+        if (streq_ptr(hwdb->properties_modalias, modalias))
+                return 0;
+
+        hwdb->properties_modalias = mfree(hwdb->properties_modalias);
+        ordered_hashmap_clear(hwdb->properties);
+
+        r = trie_search_f(hwdb, modalias);
+        if (r < 0)
+                return r;
+
+        /* Failing to remember the modalias only means the next lookup walks the trie again. */
+        hwdb->properties_modalias = strdup(modalias);
+
+        return 0;
 }
 
 _public_ int sd_hwdb_get(sd_hwdb *hwdb, const char *modalias, const char *key, const char **_value) {
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+
+#include "sd-netlink.h"
+
+#include "benchmark.h"
+#include "tests.h"
+
+static void bench_dump_links(void *userdata, uint64_t n) {
+        sd_netlink *rtnl = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *req = NULL, *reply = NULL;
+                sd_netlink_message *m;
+
+                assert_se(sd_rtnl_message_new_link(rtnl, &req, RTM_GETLINK, 0) >= 0);
+                assert_se(sd_netlink_message_request_dump(req, true) >= 0);
+                assert_se(sd_netlink_call(rtnl, req, 0, &reply) >= 0);
+
+                for (m = reply; m; m = sd_netlink_message_next(m)) {
+                        const char *name;
+
+                        assert_se(sd_netlink_message_read_string(m, IFLA_IFNAME, &name) >= 0);
+                }
+        }
+}
+
+static void bench_dump_routes(void *userdata, uint64_t n) {
+        sd_netlink *rtnl = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *req = NULL, *reply = NULL;
+                sd_netlink_message *m;
+
+                assert_se(sd_rtnl_message_new_route(rtnl, &req, RTM_GETROUTE, AF_UNSPEC, RTPROT_UNSPEC) >= 0);
+                assert_se(sd_netlink_message_request_dump(req, true) >= 0);
+                assert_se(sd_netlink_call(rtnl, req, 0, &reply) >= 0);
+
+                for (m = reply; m; m = sd_netlink_message_next(m)) {
+                        uint16_t type;
+
+                        assert_se(sd_netlink_message_get_type(m, &type) >= 0);
+                        assert_se(type == RTM_NEWROUTE);
+                }
+        }
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_netlink_unrefp) sd_netlink *rtnl = NULL;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        /* The cost is mostly in receiving and parsing the dumps, hence this is most interesting on hosts
+         * with many links or routes */
+        r = sd_netlink_open(&rtnl);
+        if (r < 0)
+                return log_tests_skipped_errno(r, "Failed to open rtnetlink socket");
+
+        benchmark_run("netlink-dump-links", bench_dump_links, rtnl);
+        benchmark_run("netlink-dump-routes", bench_dump_routes, rtnl);
+
+        return 0;
+}
@@ -14,6 +14,14 @@
 
 #define RTNL_RQUEUE_MAX 64*1024
 
+/* The kernel sizes dump replies after the largest buffer we ever passed to recvmsg(), up to 32K. Start
+ * out with that, so that each datagram carries as many messages as possible. */
+#define RTNL_RBUFFER_SIZE_MIN (32U*1024U)
+
+/* When batching, how many messages and bytes to send with a single sendmsg() at most */
+#define RTNL_WQUEUE_MAX 1024U
+#define RTNL_WQUEUE_BYTES_MAX (64U*1024U)
+
 #define RTNL_CONTAINER_DEPTH 32
 
 struct reply_callback {
@@ -80,7 +88,13 @@ struct sd_netlink {
         struct nlmsghdr *rbuffer;
         size_t rbuffer_allocated;
 
+        /* Messages sealed but not sent yet, if batching is enabled */
+        sd_netlink_message **wqueue;
+        unsigned wqueue_size;
+        size_t wqueue_allocated, wqueue_bytes;
+
         bool processing:1;
+        bool batching:1;
 
         uint32_t serial;
 
@@ -139,6 +153,7 @@ int socket_bind(sd_netlink *nl);
 int socket_broadcast_group_ref(sd_netlink *nl, unsigned group);
 int socket_broadcast_group_unref(sd_netlink *nl, unsigned group);
 int socket_write_message(sd_netlink *nl, sd_netlink_message *m);
+int socket_writev_message(sd_netlink *nl, sd_netlink_message **m, size_t msgcount);
 int socket_read_message(sd_netlink *nl);
 
 int rtnl_rqueue_make_room(sd_netlink *rtnl);
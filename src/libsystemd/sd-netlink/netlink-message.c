@@ -88,7 +88,7 @@ int sd_netlink_message_request_dump(sd_netlink_message *m, int dump) {
 
         assert_return(IN_SET(m->hdr->nlmsg_type,
                              RTM_GETLINK, RTM_GETLINKPROP, RTM_GETADDR, RTM_GETROUTE, RTM_GETNEIGH,
-                             RTM_GETRULE, RTM_GETADDRLABEL, RTM_GETNEXTHOP), -EINVAL);
+                             RTM_GETRULE, RTM_GETADDRLABEL, RTM_GETNEXTHOP, RTM_GETSTATS), -EINVAL);
 
         SET_FLAG(m->hdr->nlmsg_flags, NLM_F_DUMP, dump);
 
@@ -973,19 +973,29 @@ static int netlink_container_parse(sd_netlink_message *m,
                                    size_t rt_len) {
         _cleanup_free_ struct netlink_attribute *attributes = NULL;
         size_t n_allocated = 0;
+        struct rtattr *i;
 
         /* RTA_OK() macro compares with rta->rt_len, which is unsigned short, and
          * LGTM.com analysis does not like the type difference. Hence, here we
          * introduce an unsigned short variable as a workaround. */
         unsigned short len = rt_len;
+
+        /* Find the largest attribute type first, so that the table is allocated exactly once. */
+        for (i = rta; RTA_OK(i, len); i = RTA_NEXT(i, len))
+                n_allocated = MAX(n_allocated, (size_t) RTA_TYPE(i) + 1);
+
+        if (n_allocated > 0) {
+                attributes = new0(struct netlink_attribute, n_allocated);
+                if (!attributes)
+                        return -ENOMEM;
+        }
+
+        len = rt_len;
         for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
                 unsigned short type;
 
                 type = RTA_TYPE(rta);
 
-                if (!GREEDY_REALLOC0(attributes, n_allocated, type + 1))
-                        return -ENOMEM;
-
                 if (attributes[type].offset != 0)
                         log_debug("rtnl: message parse - overwriting repeated attribute");
 
@@ -968,6 +968,15 @@ static const NLTypeSystem rtnl_tca_type_system = {
         .types = rtnl_tca_types,
 };
 
+static const NLType rtnl_stats_types[] = {
+        [IFLA_STATS_LINK_64] = { .size = sizeof(struct rtnl_link_stats64) },
+};
+
+static const NLTypeSystem rtnl_stats_type_system = {
+        .count = ELEMENTSOF(rtnl_stats_types),
+        .types = rtnl_stats_types,
+};
+
 static const NLType error_types[] = {
         [NLMSGERR_ATTR_MSG]  = { .type = NETLINK_TYPE_STRING },
         [NLMSGERR_ATTR_OFFS] = { .type = NETLINK_TYPE_U32 },
@@ -1012,6 +1021,8 @@ static const NLType rtnl_types[] = {
         [RTM_NEWTCLASS]    = { .type = NETLINK_TYPE_NESTED, .type_system = &rtnl_tca_type_system, .size = sizeof(struct tcmsg) },
         [RTM_DELTCLASS]    = { .type = NETLINK_TYPE_NESTED, .type_system = &rtnl_tca_type_system, .size = sizeof(struct tcmsg) },
         [RTM_GETTCLASS]    = { .type = NETLINK_TYPE_NESTED, .type_system = &rtnl_tca_type_system, .size = sizeof(struct tcmsg) },
+        [RTM_NEWSTATS]     = { .type = NETLINK_TYPE_NESTED, .type_system = &rtnl_stats_type_system, .size = sizeof(struct if_stats_msg) },
+        [RTM_GETSTATS]     = { .type = NETLINK_TYPE_NESTED, .type_system = &rtnl_stats_type_system, .size = sizeof(struct if_stats_msg) },
 };
 
 const NLTypeSystem rtnl_type_system_root = {
@@ -1120,3 +1120,36 @@ int sd_rtnl_message_set_tclass_handle(sd_netlink_message *m, uint32_t handle) {
 
         return 0;
 }
+
+int sd_rtnl_message_new_stats(sd_netlink *rtnl, sd_netlink_message **ret, uint16_t nlmsg_type, int ifindex, uint32_t filter_mask) {
+        struct if_stats_msg *ifsm;
+        int r;
+
+        assert_return(rtnl_message_type_is_stats(nlmsg_type), -EINVAL);
+        assert_return(ret, -EINVAL);
+
+        r = message_new(rtnl, ret, nlmsg_type);
+        if (r < 0)
+                return r;
+
+        ifsm = NLMSG_DATA((*ret)->hdr);
+        ifsm->family = AF_UNSPEC;
+        ifsm->ifindex = ifindex;
+        ifsm->filter_mask = filter_mask;
+
+        return 0;
+}
+
+int sd_rtnl_message_stats_get_ifindex(sd_netlink_message *m, int *ret) {
+        struct if_stats_msg *ifsm;
+
+        assert_return(m, -EINVAL);
+        assert_return(m->hdr, -EINVAL);
+        assert_return(rtnl_message_type_is_stats(m->hdr->nlmsg_type), -EINVAL);
+        assert_return(ret, -EINVAL);
+
+        ifsm = NLMSG_DATA(m->hdr);
+        *ret = ifsm->ifindex;
+
+        return 0;
+}
@@ -42,9 +42,11 @@ static int sd_netlink_new(sd_netlink **ret) {
 
         /* We guarantee that the read buffer has at least space for
          * a message header */
-        if (!greedy_realloc((void**)&rtnl->rbuffer, &rtnl->rbuffer_allocated,
-                            sizeof(struct nlmsghdr), sizeof(uint8_t)))
+        assert_cc(RTNL_RBUFFER_SIZE_MIN >= sizeof(struct nlmsghdr));
+        rtnl->rbuffer = malloc(RTNL_RBUFFER_SIZE_MIN);
+        if (!rtnl->rbuffer)
                 return -ENOMEM;
+        rtnl->rbuffer_allocated = RTNL_RBUFFER_SIZE_MIN;
 
         *ret = TAKE_PTR(rtnl);
 
@@ -152,12 +154,110 @@ int sd_netlink_inc_rcvbuf(sd_netlink *rtnl, size_t size) {
         return fd_inc_rcvbuf(rtnl->fd, size);
 }
 
+int sd_netlink_attach_filter(sd_netlink *nl, size_t len, struct sock_filter *filter) {
+        int r;
+
+        assert_return(nl, -EINVAL);
+        assert_return(len == 0 || filter, -EINVAL);
+        assert_return(!rtnl_pid_changed(nl), -ECHILD);
+
+        if (len == 0) {
+                r = setsockopt_int(nl->fd, SOL_SOCKET, SO_DETACH_FILTER, 0);
+                if (r == -ENOENT)
+                        return 0;
+                return r;
+        }
+
+        if (setsockopt(nl->fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                       &(struct sock_fprog) {
+                               .len = len,
+                               .filter = filter,
+                       },
+                       sizeof(struct sock_fprog)) < 0)
+                return -errno;
+
+        return 0;
+}
+
+static int rtnl_wqueue_flush(sd_netlink *rtnl) {
+        unsigned i, n;
+        size_t bytes;
+        int r;
+
+        assert(rtnl);
+
+        while (rtnl->wqueue_size > 0) {
+
+                /* Send as many of the queued messages as we can with a single datagram */
+                for (n = 0, bytes = 0; n < MIN(rtnl->wqueue_size, RTNL_WQUEUE_MAX); n++) {
+                        size_t l = rtnl->wqueue[n]->hdr->nlmsg_len;
+
+                        if (n > 0 && bytes + l > RTNL_WQUEUE_BYTES_MAX)
+                                break;
+
+                        bytes += l;
+                }
+
+                r = socket_writev_message(rtnl, rtnl->wqueue, n);
+                if (r < 0) {
+                        log_debug_errno(r, "rtnl: failed to send %u batched messages: %m", n);
+
+                        /* Report the failure as reply to each of the messages, as if the kernel refused them */
+                        for (i = 0; i < n; i++) {
+                                sd_netlink_message *m;
+
+                                if (rtnl_rqueue_make_room(rtnl) < 0)
+                                        break;
+
+                                if (rtnl_message_new_synthetic_error(rtnl, r, rtnl_message_get_serial(rtnl->wqueue[i]), &m) < 0)
+                                        break;
+
+                                rtnl->rqueue[rtnl->rqueue_size++] = m;
+                        }
+                }
+
+                for (i = 0; i < n; i++)
+                        sd_netlink_message_unref(rtnl->wqueue[i]);
+
+                rtnl->wqueue_size -= n;
+                memmove(rtnl->wqueue, rtnl->wqueue + n, sizeof(sd_netlink_message*) * rtnl->wqueue_size);
+        }
+
+        rtnl->wqueue_bytes = 0;
+
+        return 0;
+}
+
+static int rtnl_wqueue_message(sd_netlink *rtnl, sd_netlink_message *m) {
+        assert(rtnl);
+        assert(m);
+
+        if (!GREEDY_REALLOC(rtnl->wqueue, rtnl->wqueue_allocated, rtnl->wqueue_size + 1))
+                return -ENOMEM;
+
+        rtnl->wqueue[rtnl->wqueue_size++] = sd_netlink_message_ref(m);
+        rtnl->wqueue_bytes += m->hdr->nlmsg_len;
+
+        if (rtnl->wqueue_size >= RTNL_WQUEUE_MAX || rtnl->wqueue_bytes >= RTNL_WQUEUE_BYTES_MAX)
+                return rtnl_wqueue_flush(rtnl);
+
+        return 0;
+}
+
 static sd_netlink *netlink_free(sd_netlink *rtnl) {
         sd_netlink_slot *s;
         unsigned i;
 
         assert(rtnl);
 
+        /* Don't lose messages that are queued for batching */
+        if (!rtnl_pid_changed(rtnl))
+                (void) rtnl_wqueue_flush(rtnl);
+
+        for (i = 0; i < rtnl->wqueue_size; i++)
+                sd_netlink_message_unref(rtnl->wqueue[i]);
+        free(rtnl->wqueue);
+
         for (i = 0; i < rtnl->rqueue_size; i++)
                 sd_netlink_message_unref(rtnl->rqueue[i]);
         free(rtnl->rqueue);
@@ -205,6 +305,23 @@ static void rtnl_seal_message(sd_netlink *rtnl, sd_netlink_message *m) {
         return;
 }
 
+int sd_netlink_set_batching(sd_netlink *nl, int b) {
+        int r;
+
+        assert_return(nl, -EINVAL);
+        assert_return(!rtnl_pid_changed(nl), -ECHILD);
+
+        if (!b) {
+                r = rtnl_wqueue_flush(nl);
+                if (r < 0)
+                        return r;
+        }
+
+        nl->batching = b;
+
+        return 0;
+}
+
 int sd_netlink_send(sd_netlink *nl,
                     sd_netlink_message *message,
                     uint32_t *serial) {
@@ -217,7 +334,17 @@ int sd_netlink_send(sd_netlink *nl,
 
         rtnl_seal_message(nl, message);
 
-        r = socket_write_message(nl, message);
+        /* When batching, queue the message and send all queued ones together when we return to the event
+         * loop. Errors are then reported as replies to the individual messages. */
+        if (nl->batching && nl->event)
+                r = rtnl_wqueue_message(nl, message);
+        else {
+                r = rtnl_wqueue_flush(nl);
+                if (r < 0)
+                        return r;
+
+                r = socket_write_message(nl, message);
+        }
         if (r < 0)
                 return r;
 
@@ -605,6 +732,11 @@ int sd_netlink_call(sd_netlink *rtnl,
         if (r < 0)
                 return r;
 
+        /* We are going to wait for the reply, hence make sure the message actually leaves */
+        r = rtnl_wqueue_flush(rtnl);
+        if (r < 0)
+                return r;
+
         timeout = calc_elapse(usec);
 
         for (;;) {
@@ -740,6 +872,11 @@ static int prepare_callback(sd_event_source *s, void *userdata) {
         assert(s);
         assert(rtnl);
 
+        /* Send everything that got queued while dispatching this event loop iteration */
+        r = rtnl_wqueue_flush(rtnl);
+        if (r < 0)
+                return r;
+
         e = sd_netlink_get_events(rtnl);
         if (e < 0)
                 return e;
@@ -822,6 +959,9 @@ int sd_netlink_detach_event(sd_netlink *rtnl) {
         assert_return(rtnl, -EINVAL);
         assert_return(rtnl->event, -ENXIO);
 
+        /* Without the event loop nobody would send the queued messages anymore */
+        (void) rtnl_wqueue_flush(rtnl);
+
         rtnl->io_event_source = sd_event_source_unref(rtnl->io_event_source);
 
         rtnl->time_event_source = sd_event_source_unref(rtnl->time_event_source);
@@ -105,6 +105,38 @@ static void test_link_get(sd_netlink *rtnl, int ifindex) {
         assert_se((r = sd_netlink_message_unref(r)) == NULL);
 }
 
+static void test_stats_get(sd_netlink *rtnl, int ifindex) {
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL, *r = NULL;
+        struct rtnl_link_stats64 stats;
+        sd_netlink_message *i;
+        bool found = false;
+        int index, k;
+
+        assert_se(sd_rtnl_message_new_stats(rtnl, &m, RTM_GETSTATS, 0, IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64)) >= 0);
+        assert_se(sd_netlink_message_request_dump(m, true) >= 0);
+
+        k = sd_netlink_call(rtnl, m, 0, &r);
+        if (k == -EOPNOTSUPP) {
+                log_info("RTM_GETSTATS is not supported by the kernel, skipping test.");
+                return;
+        }
+        assert_se(k >= 0);
+
+        for (i = r; i; i = sd_netlink_message_next(i)) {
+                uint16_t type;
+
+                assert_se(sd_netlink_message_get_type(i, &type) >= 0);
+                assert_se(type == RTM_NEWSTATS);
+
+                assert_se(sd_rtnl_message_stats_get_ifindex(i, &index) >= 0);
+                assert_se(sd_netlink_message_read(i, IFLA_STATS_LINK_64, sizeof stats, &stats) >= 0);
+                if (index == ifindex)
+                        found = true;
+        }
+
+        assert_se(found);
+}
+
 static void test_address_get(sd_netlink *rtnl, int ifindex) {
         sd_netlink_message *m;
         sd_netlink_message *r;
@@ -423,6 +455,54 @@ static void test_pipe(int ifindex) {
         assert_se((rtnl = sd_netlink_unref(rtnl)) == NULL);
 }
 
+static int batch_handler(sd_netlink *rtnl, sd_netlink_message *m, void *userdata) {
+        int *counter = userdata;
+
+        (*counter)--;
+
+        assert_se(sd_netlink_message_get_errno(m) == -ENODEV);
+
+        return 1;
+}
+
+static void test_batching(int ifindex) {
+        _cleanup_(sd_event_unrefp) sd_event *event = NULL;
+        _cleanup_(sd_netlink_unrefp) sd_netlink *rtnl = NULL;
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *r = NULL;
+        int counter = 0;
+        unsigned i;
+
+        assert_se(sd_netlink_open(&rtnl) >= 0);
+        assert_se(sd_event_default(&event) >= 0);
+        assert_se(sd_netlink_attach_event(rtnl, event, 0) >= 0);
+        assert_se(sd_netlink_set_batching(rtnl, true) >= 0);
+
+        /* Queue a number of messages, all of them should be replied to individually. Ask for a link that
+         * doesn't exist, so that the replies are small and don't overrun the receive buffer. */
+        for (i = 0; i < 100; i++) {
+                _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
+
+                assert_se(sd_rtnl_message_new_link(rtnl, &m, RTM_GETLINK, INT_MAX) >= 0);
+
+                counter++;
+                assert_se(sd_netlink_call_async(rtnl, NULL, m, batch_handler, NULL, &counter, 0, NULL) >= 0);
+        }
+
+        /* Synchronous calls must not wait for the event loop to send the batch */
+        {
+                _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
+
+                assert_se(sd_rtnl_message_new_link(rtnl, &m, RTM_GETLINK, ifindex) >= 0);
+                assert_se(sd_netlink_call(rtnl, m, 0, &r) == 1);
+        }
+
+        while (counter > 0)
+                assert_se(sd_event_run(event, 0) >= 0);
+
+        assert_se(sd_netlink_set_batching(rtnl, false) >= 0);
+        assert_se(sd_netlink_detach_event(rtnl) >= 0);
+}
+
 static void test_container(sd_netlink *rtnl) {
         _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *m = NULL;
         uint16_t u16_data;
@@ -607,6 +687,7 @@ int main(void) {
         test_slot_set(if_loopback);
         test_async_destroy_callback(if_loopback);
         test_pipe(if_loopback);
+        test_batching(if_loopback);
         test_event_loop(if_loopback);
         test_link_configure(rtnl, if_loopback);
 
@@ -632,6 +713,7 @@ int main(void) {
         assert_se((r = sd_netlink_message_unref(r)) == NULL);
 
         test_link_get(rtnl, if_loopback);
+        test_stats_get(rtnl, if_loopback);
         test_address_get(rtnl, if_loopback);
 
         assert_se((m = sd_netlink_message_unref(m)) == NULL);
@@ -18,17 +18,19 @@
 #include "dns-domain.h"
 #include "errno-util.h"
 #include "fd-util.h"
+#include "hashmap.h"
 #include "io-util.h"
 #include "list.h"
 #include "memory-util.h"
 #include "missing_syscall.h"
+#include "ordered-set.h"
 #include "process-util.h"
 #include "resolve-private.h"
 #include "socket-util.h"
 
 #define WORKERS_MIN 1U
 #define WORKERS_MAX 16U
-#define QUERIES_MAX 256U
+#define QUERIES_IN_FLIGHT_MAX 256U
 #define BUFSIZE 10240U
 
 typedef enum {
@@ -60,9 +62,13 @@ struct sd_resolve {
         unsigned n_valid_workers;
 
         unsigned current_id;
-        sd_resolve_query* query_array[QUERIES_MAX];
+        Hashmap *queries_by_id;
         unsigned n_queries, n_done, n_outstanding;
 
+        /* Queries that have not been passed to the workers yet, because QUERIES_IN_FLIGHT_MAX are
+         * already outstanding */
+        OrderedSet *pending;
+
         sd_event_source *event_source;
         sd_event *event;
 
@@ -90,6 +96,10 @@ struct sd_resolve_query {
         struct addrinfo *addrinfo;
         char *serv, *host;
 
+        /* The serialized request, while the query is queued in resolve->pending */
+        void *request;
+        size_t request_size;
+
         union {
                 sd_resolve_getaddrinfo_handler_t getaddrinfo_handler;
                 sd_resolve_getnameinfo_handler_t getnameinfo_handler;
@@ -505,10 +515,10 @@ _public_ int sd_resolve_new(sd_resolve **ret) {
         for (i = 0; i < _FD_MAX; i++)
                 resolve->fds[i] = fd_move_above_stdio(resolve->fds[i]);
 
-        (void) fd_inc_sndbuf(resolve->fds[REQUEST_SEND_FD], QUERIES_MAX * BUFSIZE);
-        (void) fd_inc_rcvbuf(resolve->fds[REQUEST_RECV_FD], QUERIES_MAX * BUFSIZE);
-        (void) fd_inc_sndbuf(resolve->fds[RESPONSE_SEND_FD], QUERIES_MAX * BUFSIZE);
-        (void) fd_inc_rcvbuf(resolve->fds[RESPONSE_RECV_FD], QUERIES_MAX * BUFSIZE);
+        (void) fd_inc_sndbuf(resolve->fds[REQUEST_SEND_FD], QUERIES_IN_FLIGHT_MAX * BUFSIZE);
+        (void) fd_inc_rcvbuf(resolve->fds[REQUEST_RECV_FD], QUERIES_IN_FLIGHT_MAX * BUFSIZE);
+        (void) fd_inc_sndbuf(resolve->fds[RESPONSE_SEND_FD], QUERIES_IN_FLIGHT_MAX * BUFSIZE);
+        (void) fd_inc_rcvbuf(resolve->fds[RESPONSE_RECV_FD], QUERIES_IN_FLIGHT_MAX * BUFSIZE);
 
         (void) fd_nonblock(resolve->fds[RESPONSE_RECV_FD], true);
 
@@ -597,6 +607,9 @@ static sd_resolve *resolve_free(sd_resolve *resolve) {
         /* Close all communication channels */
         close_many(resolve->fds, _FD_MAX);
 
+        hashmap_free(resolve->queries_by_id);
+        ordered_set_free(resolve->pending);
+
         return mfree(resolve);
 }
 
@@ -626,16 +639,9 @@ _public_ int sd_resolve_get_timeout(sd_resolve *resolve, uint64_t *usec) {
 }
 
 static sd_resolve_query *lookup_query(sd_resolve *resolve, unsigned id) {
-        sd_resolve_query *q;
-
         assert(resolve);
 
-        q = resolve->query_array[id % QUERIES_MAX];
-        if (q)
-                if (q->id == id)
-                        return q;
-
-        return NULL;
+        return hashmap_get(resolve->queries_by_id, UINT_TO_PTR(id));
 }
 
 static int complete_query(sd_resolve *resolve, sd_resolve_query *q) {
@@ -731,6 +737,84 @@ static int unserialize_addrinfo(const void **p, size_t *length, struct addrinfo
         return 0;
 }
 
+static int send_query(sd_resolve *resolve, sd_resolve_query *q, const struct iovec *iov, size_t n_iov) {
+        struct msghdr mh = {
+                .msg_iov = (struct iovec*) iov,
+                .msg_iovlen = n_iov,
+        };
+        size_t i;
+        int r;
+
+        assert(resolve);
+        assert(q);
+        assert(iov);
+
+        /* If the workers are already busy with QUERIES_IN_FLIGHT_MAX queries, keep a copy of the request
+         * around and send it off once a response came in. We don't want to just write all requests to the
+         * socket: if both the request and the response socket were to fill up, the workers and we would
+         * block on each other. */
+        if (resolve->n_outstanding >= QUERIES_IN_FLIGHT_MAX || !ordered_set_isempty(resolve->pending)) {
+                _cleanup_free_ void *request = NULL;
+                size_t size;
+                uint8_t *p;
+
+                size = IOVEC_TOTAL_SIZE((struct iovec*) iov, n_iov);
+                p = request = malloc(size);
+                if (!request)
+                        return -ENOMEM;
+
+                for (i = 0; i < n_iov; i++)
+                        p = mempcpy(p, iov[i].iov_base, iov[i].iov_len);
+
+                r = ordered_set_ensure_allocated(&resolve->pending, NULL);
+                if (r < 0)
+                        return r;
+
+                r = ordered_set_put(resolve->pending, q);
+                if (r < 0)
+                        return r;
+
+                q->request = TAKE_PTR(request);
+                q->request_size = size;
+                return 0;
+        }
+
+        if (sendmsg(resolve->fds[REQUEST_SEND_FD], &mh, MSG_NOSIGNAL) < 0)
+                return -errno;
+
+        resolve->n_outstanding++;
+        return 0;
+}
+
+static int dispatch_pending(sd_resolve *resolve) {
+        sd_resolve_query *q;
+
+        assert(resolve);
+
+        while (resolve->n_outstanding < QUERIES_IN_FLIGHT_MAX &&
+               (q = ordered_set_steal_first(resolve->pending))) {
+                ssize_t n;
+
+                n = send(resolve->fds[REQUEST_SEND_FD], q->request, q->request_size, MSG_NOSIGNAL);
+                q->request = mfree(q->request);
+                if (n < 0) {
+                        int r;
+
+                        /* Fail this query, but keep the others going */
+                        query_assign_errno(q, EAI_SYSTEM, errno, 0);
+                        r = complete_query(resolve, q);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                resolve->n_outstanding++;
+        }
+
+        return 0;
+}
+
 static int handle_response(sd_resolve *resolve, const Packet *packet, size_t length) {
         const RHeader *resp;
         sd_resolve_query *q;
@@ -751,6 +835,11 @@ static int handle_response(sd_resolve *resolve, const Packet *packet, size_t len
         assert(resolve->n_outstanding > 0);
         resolve->n_outstanding--;
 
+        /* A slot is free now, pass on the next queued query to the workers */
+        r = dispatch_pending(resolve);
+        if (r < 0)
+                return r;
+
         q = lookup_query(resolve, resp->id);
         if (!q)
                 return 0;
@@ -890,24 +979,35 @@ static int alloc_query(sd_resolve *resolve, bool floating, sd_resolve_query **_q
         assert(resolve);
         assert(_q);
 
-        if (resolve->n_queries >= QUERIES_MAX)
-                return -ENOBUFS;
-
         r = start_threads(resolve, 1);
         if (r < 0)
                 return r;
 
-        while (resolve->query_array[resolve->current_id % QUERIES_MAX])
+        r = hashmap_ensure_allocated(&resolve->queries_by_id, NULL);
+        if (r < 0)
+                return r;
+
+        /* Skip over IDs of queries that are still around after the counter wrapped */
+        while (hashmap_contains(resolve->queries_by_id, UINT_TO_PTR(resolve->current_id)))
                 resolve->current_id++;
 
-        q = resolve->query_array[resolve->current_id % QUERIES_MAX] = new0(sd_resolve_query, 1);
+        q = new0(sd_resolve_query, 1);
         if (!q)
                 return -ENOMEM;
 
+        q->id = resolve->current_id;
+
+        r = hashmap_put(resolve->queries_by_id, UINT_TO_PTR(q->id), q);
+        if (r < 0) {
+                free(q);
+                return r;
+        }
+
+        resolve->current_id++;
+
         q->n_ref = 1;
         q->resolve = resolve;
         q->floating = floating;
-        q->id = resolve->current_id++;
 
         if (!floating)
                 sd_resolve_ref(resolve);
@@ -932,7 +1032,7 @@ int resolve_getaddrinfo_with_destroy_callback(
         size_t node_len, service_len;
         AddrInfoRequest req = {};
         struct iovec iov[3];
-        struct msghdr mh = {};
+        size_t n_iov = 0;
         int r;
 
         assert_return(resolve, -EINVAL);
@@ -968,17 +1068,16 @@ int resolve_getaddrinfo_with_destroy_callback(
 
         msan_unpoison(&req, sizeof(req));
 
-        iov[mh.msg_iovlen++] = IOVEC_MAKE(&req, sizeof(AddrInfoRequest));
+        iov[n_iov++] = IOVEC_MAKE(&req, sizeof(AddrInfoRequest));
         if (node)
-                iov[mh.msg_iovlen++] = IOVEC_MAKE((void*) node, req.node_len);
+                iov[n_iov++] = IOVEC_MAKE((void*) node, req.node_len);
         if (service)
-                iov[mh.msg_iovlen++] = IOVEC_MAKE((void*) service, req.service_len);
-        mh.msg_iov = iov;
+                iov[n_iov++] = IOVEC_MAKE((void*) service, req.service_len);
 
-        if (sendmsg(resolve->fds[REQUEST_SEND_FD], &mh, MSG_NOSIGNAL) < 0)
-                return -errno;
+        r = send_query(resolve, q, iov, n_iov);
+        if (r < 0)
+                return r;
 
-        resolve->n_outstanding++;
         q->destroy_callback = destroy_callback;
 
         if (ret_query)
@@ -1024,7 +1123,6 @@ int resolve_getnameinfo_with_destroy_callback(
         _cleanup_(sd_resolve_query_unrefp) sd_resolve_query *q = NULL;
         NameInfoRequest req = {};
         struct iovec iov[2];
-        struct msghdr mh;
         int r;
 
         assert_return(resolve, -EINVAL);
@@ -1059,15 +1157,10 @@ int resolve_getnameinfo_with_destroy_callback(
         iov[0] = IOVEC_MAKE(&req, sizeof(NameInfoRequest));
         iov[1] = IOVEC_MAKE((void*) sa, salen);
 
-        mh = (struct msghdr) {
-                .msg_iov = iov,
-                .msg_iovlen = ELEMENTSOF(iov)
-        };
-
-        if (sendmsg(resolve->fds[REQUEST_SEND_FD], &mh, MSG_NOSIGNAL) < 0)
-                return -errno;
+        r = send_query(resolve, q, iov, ELEMENTSOF(iov));
+        if (r < 0)
+                return r;
 
-        resolve->n_outstanding++;
         q->destroy_callback = destroy_callback;
 
         if (ret_query)
@@ -1115,7 +1208,6 @@ static void resolve_freeaddrinfo(struct addrinfo *ai) {
 
 static void resolve_query_disconnect(sd_resolve_query *q) {
         sd_resolve *resolve;
-        unsigned i;
 
         assert(q);
 
@@ -1130,9 +1222,12 @@ static void resolve_query_disconnect(sd_resolve_query *q) {
                 resolve->n_done--;
         }
 
-        i = q->id % QUERIES_MAX;
-        assert(resolve->query_array[i] == q);
-        resolve->query_array[i] = NULL;
+        assert_se(hashmap_remove(resolve->queries_by_id, UINT_TO_PTR(q->id)) == q);
+        if (q->request) {
+                /* Never passed on to the workers, drop it from the queue */
+                assert_se(ordered_set_remove(resolve->pending, q) == q);
+                q->request = mfree(q->request);
+        }
         LIST_REMOVE(queries, resolve->queries, q);
         resolve->n_queries--;
 
@@ -16,13 +16,16 @@
 #include "efi-loader.h"
 #include "errno-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "limits-util.h"
 #include "logind.h"
+#include "memory-util.h"
 #include "parse-util.h"
 #include "path-util.h"
 #include "process-util.h"
 #include "strv.h"
 #include "terminal-util.h"
+#include "tmpfile-util.h"
 #include "udev-util.h"
 #include "user-util.h"
 #include "userdb.h"
@@ -795,6 +798,12 @@ void manager_connect_utmp(Manager *m) {
                         log_warning_errno(r, "Failed to adjust utmp event source priority, ignoring: %m");
 
                 (void) sd_event_source_set_description(s, "utmp");
+
+                /* Every login writes utmp in several steps, and we reread the whole file on each
+                 * notification anyway, hence fold queued up events into one. */
+                r = sd_event_source_set_inotify_coalesce(s, true);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to enable coalescing of utmp inotify events, ignoring: %m");
         }
 
         sd_event_source_unref(m->utmp_event_source);
@@ -836,3 +845,43 @@ int manager_read_efi_boot_loader_entries(Manager *m) {
         return 0;
 #endif
 }
+
+int logind_write_state_file(const char *path, const char *data, size_t size) {
+        _cleanup_free_ char *old = NULL, *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        size_t old_size;
+        int r;
+
+        assert(path);
+        assert(data || size == 0);
+
+        /* Many state changes do not change what we store, e.g. when the same property is set again. Avoid
+         * the write, and the inotify events every sd-login monitor would see, if the file is unchanged. */
+        if (read_full_file(path, &old, &old_size) >= 0 &&
+            old_size == size &&
+            memcmp_safe(old, data, size) == 0)
+                return 0;
+
+        r = fopen_temporary(path, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        (void) fchmod(fileno(f), 0644);
+
+        fwrite(data, 1, size, f);
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                goto fail;
+
+        if (rename(temp_path, path) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        return 1;
+
+fail:
+        (void) unlink(temp_path);
+        return r;
+}
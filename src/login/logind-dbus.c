@@ -554,6 +554,57 @@ static int method_list_sessions(sd_bus_message *message, void *userdata, sd_bus_
         return sd_bus_send(NULL, reply, NULL);
 }
 
+static int method_list_sessions_ex(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *m = userdata;
+        Session *session;
+        Iterator i;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sussussbto)");
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH(session, m->sessions, i) {
+                _cleanup_free_ char *p = NULL;
+                dual_timestamp idle_ts;
+                bool idle;
+
+                p = session_bus_path(session);
+                if (!p)
+                        return -ENOMEM;
+
+                idle = session_get_idle_hint(session, &idle_ts) > 0;
+
+                r = sd_bus_message_append(reply, "(sussussbto)",
+                                          session->id,
+                                          (uint32_t) session->user->user_record->uid,
+                                          session->user->user_record->user_name,
+                                          session->seat ? session->seat->id : "",
+                                          (uint32_t) session->leader,
+                                          session_class_to_string(session->class),
+                                          strempty(session->tty),
+                                          idle,
+                                          idle_ts.realtime,
+                                          p);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_list_users(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -3404,6 +3455,12 @@ static const sd_bus_vtable manager_vtable[] = {
                                  SD_BUS_PARAM(sessions),
                                  method_list_sessions,
                                  SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_NAMES("ListSessionsEx",
+                                 NULL,,
+                                 "a(sussussbto)",
+                                 SD_BUS_PARAM(sessions),
+                                 method_list_sessions_ex,
+                                 SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_NAMES("ListUsers",
                                  NULL,,
                                  "a(uso)",
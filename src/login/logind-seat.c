@@ -22,7 +22,6 @@
 #include "stdio-util.h"
 #include "string-util.h"
 #include "terminal-util.h"
-#include "tmpfile-util.h"
 #include "util.h"
 
 int seat_new(Seat** ret, Manager *m, const char *id) {
@@ -82,8 +81,9 @@ Seat* seat_free(Seat *s) {
 }
 
 int seat_save(Seat *s) {
-        _cleanup_free_ char *temp_path = NULL;
+        _cleanup_free_ char *buf = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        size_t size;
         int r;
 
         assert(s);
@@ -95,11 +95,11 @@ int seat_save(Seat *s) {
         if (r < 0)
                 goto fail;
 
-        r = fopen_temporary(s->state_file, &f, &temp_path);
-        if (r < 0)
+        f = open_memstream_unlocked(&buf, &size);
+        if (!f) {
+                r = -ENOMEM;
                 goto fail;
-
-        (void) fchmod(fileno(f), 0644);
+        }
 
         fprintf(f,
                 "# This is private data. Do not parse.\n"
@@ -144,19 +144,17 @@ int seat_save(Seat *s) {
         if (r < 0)
                 goto fail;
 
-        if (rename(temp_path, s->state_file) < 0) {
-                r = -errno;
+        f = safe_fclose(f);
+
+        r = logind_write_state_file(s->state_file, buf, size);
+        if (r < 0)
                 goto fail;
-        }
 
         return 0;
 
 fail:
         (void) unlink(s->state_file);
 
-        if (temp_path)
-                (void) unlink(temp_path);
-
         return log_error_errno(r, "Failed to save seat data %s: %m", s->state_file);
 }
 
@@ -34,7 +34,6 @@
 #include "string-table.h"
 #include "strv.h"
 #include "terminal-util.h"
-#include "tmpfile-util.h"
 #include "user-util.h"
 #include "util.h"
 
@@ -200,8 +199,9 @@ static void session_save_devices(Session *s, FILE *f) {
 }
 
 int session_save(Session *s) {
-        _cleanup_free_ char *temp_path = NULL;
+        _cleanup_free_ char *buf = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        size_t size;
         int r = 0;
 
         assert(s);
@@ -216,11 +216,11 @@ int session_save(Session *s) {
         if (r < 0)
                 goto fail;
 
-        r = fopen_temporary(s->state_file, &f, &temp_path);
-        if (r < 0)
+        f = open_memstream_unlocked(&buf, &size);
+        if (!f) {
+                r = -ENOMEM;
                 goto fail;
-
-        (void) fchmod(fileno(f), 0644);
+        }
 
         fprintf(f,
                 "# This is private data. Do not parse.\n"
@@ -342,19 +342,17 @@ int session_save(Session *s) {
         if (r < 0)
                 goto fail;
 
-        if (rename(temp_path, s->state_file) < 0) {
-                r = -errno;
+        f = safe_fclose(f);
+
+        r = logind_write_state_file(s->state_file, buf, size);
+        if (r < 0)
                 goto fail;
-        }
 
         return 0;
 
 fail:
         (void) unlink(s->state_file);
 
-        if (temp_path)
-                (void) unlink(temp_path);
-
         return log_error_errno(r, "Failed to save session data %s: %m", s->state_file);
 }
 
@@ -817,9 +817,12 @@ _public_ PAM_EXTERN int pam_sm_open_session(
         if (r < 0)
                 return pam_bus_log_create_error(handle, r);
 
+        /* Pass our own PID as session leader explicitly, rather than 0. That way logind doesn't have to
+         * query the bus broker for the sender's credentials synchronously from its event loop on every
+         * login. */
         r = sd_bus_message_append(m, "uusssssussbss",
                         (uint32_t) ur->uid,
-                        0,
+                        (uint32_t) getpid_cached(),
                         service,
                         type,
                         class,
@@ -20,6 +20,7 @@
 #include "mount-util.h"
 #include "process-util.h"
 #include "raw-clone.h"
+#include "stat-util.h"
 #include "strv.h"
 #include "user-util.h"
 
@@ -274,6 +275,143 @@ int bus_image_method_set_limit(
         return sd_bus_reply_method_return(message, NULL);
 }
 
+/* Reading the metadata of a raw image means setting up a loopback device and dissecting it, which is
+ * expensive. Hence we keep what we found around beyond the lifetime of the Image objects, for as long as the
+ * image file is not modified. For other image types there's no cheap way to tell if the contents changed,
+ * hence we always read their metadata afresh. */
+#define IMAGE_METADATA_CACHE_MAX 1024U
+
+typedef struct ImageMetadata {
+        char *path;
+        struct stat st;
+
+        char *hostname;
+        sd_id128_t machine_id;
+        char **machine_info;
+        char **os_release;
+} ImageMetadata;
+
+static ImageMetadata* image_metadata_free(ImageMetadata *md) {
+        if (!md)
+                return NULL;
+
+        free(md->path);
+        free(md->hostname);
+        strv_free(md->machine_info);
+        strv_free(md->os_release);
+
+        return mfree(md);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ImageMetadata*, image_metadata_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(image_metadata_hash_ops, char, string_hash_func, string_compare_func,
+                                              ImageMetadata, image_metadata_free);
+
+static int image_metadata_copy(
+                const char *hostname,
+                sd_id128_t machine_id,
+                char **machine_info,
+                char **os_release,
+                char **ret_hostname,
+                char ***ret_machine_info,
+                char ***ret_os_release) {
+
+        _cleanup_strv_free_ char **mi = NULL, **osr = NULL;
+        _cleanup_free_ char *hn = NULL;
+
+        if (hostname) {
+                hn = strdup(hostname);
+                if (!hn)
+                        return -ENOMEM;
+        }
+
+        if (machine_info) {
+                mi = strv_copy(machine_info);
+                if (!mi)
+                        return -ENOMEM;
+        }
+
+        if (os_release) {
+                osr = strv_copy(os_release);
+                if (!osr)
+                        return -ENOMEM;
+        }
+
+        free_and_replace(*ret_hostname, hn);
+        strv_free_and_replace(*ret_machine_info, mi);
+        strv_free_and_replace(*ret_os_release, osr);
+
+        return 0;
+}
+
+static int image_read_metadata_cached(Image *image) {
+        _cleanup_(image_metadata_freep) ImageMetadata *md = NULL;
+        Manager *m = image->userdata;
+        ImageMetadata *cached;
+        struct stat st;
+        int r;
+
+        assert(m);
+
+        if (image->metadata_valid)
+                return 0;
+
+        if (image->type != IMAGE_RAW)
+                return image_read_metadata(image);
+
+        if (stat(image->path, &st) < 0)
+                return -errno;
+
+        cached = hashmap_get(m->image_metadata_cache, image->path);
+        if (cached && stat_inode_unmodified(&cached->st, &st)) {
+                r = image_metadata_copy(cached->hostname, cached->machine_id, cached->machine_info, cached->os_release,
+                                        &image->hostname, &image->machine_info, &image->os_release);
+                if (r < 0)
+                        return r;
+
+                image->machine_id = cached->machine_id;
+                image->metadata_valid = true;
+                return 0;
+        }
+
+        r = image_read_metadata(image);
+        if (r < 0)
+                return r;
+
+        /* Failing to update the cache is not fatal, we got what we needed */
+
+        md = new0(ImageMetadata, 1);
+        if (!md)
+                return 0;
+
+        md->path = strdup(image->path);
+        if (!md->path)
+                return 0;
+
+        md->st = st;
+        md->machine_id = image->machine_id;
+
+        if (image_metadata_copy(image->hostname, image->machine_id, image->machine_info, image->os_release,
+                                &md->hostname, &md->machine_info, &md->os_release) < 0)
+                return 0;
+
+        if (hashmap_ensure_allocated(&m->image_metadata_cache, &image_metadata_hash_ops) < 0)
+                return 0;
+
+        image_metadata_free(hashmap_remove(m->image_metadata_cache, image->path));
+
+        /* Entries of images that were removed are never dropped individually, hence start over if this grows
+         * too large */
+        if (hashmap_size(m->image_metadata_cache) >= IMAGE_METADATA_CACHE_MAX)
+                hashmap_clear(m->image_metadata_cache);
+
+        if (hashmap_put(m->image_metadata_cache, md->path, md) >= 0)
+                TAKE_PTR(md);
+
+        return 0;
+}
+
 int bus_image_method_get_hostname(
                 sd_bus_message *message,
                 void *userdata,
@@ -282,11 +420,9 @@ int bus_image_method_get_hostname(
         Image *image = userdata;
         int r;
 
-        if (!image->metadata_valid) {
-                r = image_read_metadata(image);
-                if (r < 0)
-                        return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
-        }
+        r = image_read_metadata_cached(image);
+        if (r < 0)
+                return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
 
         return sd_bus_reply_method_return(message, "s", image->hostname);
 }
@@ -300,11 +436,9 @@ int bus_image_method_get_machine_id(
         Image *image = userdata;
         int r;
 
-        if (!image->metadata_valid) {
-                r = image_read_metadata(image);
-                if (r < 0)
-                        return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
-        }
+        r = image_read_metadata_cached(image);
+        if (r < 0)
+                return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
 
         r = sd_bus_message_new_method_return(message, &reply);
         if (r < 0)
@@ -328,11 +462,9 @@ int bus_image_method_get_machine_info(
         Image *image = userdata;
         int r;
 
-        if (!image->metadata_valid) {
-                r = image_read_metadata(image);
-                if (r < 0)
-                        return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
-        }
+        r = image_read_metadata_cached(image);
+        if (r < 0)
+                return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
 
         return bus_reply_pair_array(message, image->machine_info);
 }
@@ -345,11 +477,9 @@ int bus_image_method_get_os_release(
         Image *image = userdata;
         int r;
 
-        if (!image->metadata_valid) {
-                r = image_read_metadata(image);
-                if (r < 0)
-                        return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
-        }
+        r = image_read_metadata_cached(image);
+        if (r < 0)
+                return sd_bus_error_set_errnof(error, r, "Failed to read image metadata: %m");
 
         return bus_reply_pair_array(message, image->os_release);
 }
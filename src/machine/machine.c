@@ -102,6 +102,8 @@ Machine* machine_free(Machine *m) {
         free(m->service);
         free(m->root_directory);
         free(m->netif);
+        free(m->uid_map);
+        free(m->gid_map);
         return mfree(m);
 }
 
@@ -746,35 +748,35 @@ int machine_get_uid_shift(Machine *m, uid_t *ret) {
         return 0;
 }
 
-static int machine_owns_uid_internal(
+static int machine_load_uid_map(
                 Machine *machine,
                 const char *map_file, /* "uid_map" or "gid_map" */
-                uid_t uid,
-                uid_t *ret_internal_uid) {
+                UidMapEntry **map,
+                size_t *n_map) {
 
+        _cleanup_free_ UidMapEntry *entries = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        size_t n = 0, allocated = 0;
         const char *p;
 
-        /* This is a generic implementation for both uids and gids, under the assumptions they have the same types and semantics. */
-        assert_cc(sizeof(uid_t) == sizeof(gid_t));
-
         assert(machine);
-
-        /* Checks if the specified host UID is owned by the machine, and returns the UID it maps to
-         * internally in the machine */
-
-        if (machine->class != MACHINE_CONTAINER)
-                goto negative;
+        assert(map_file);
+        assert(map);
+        assert(n_map);
+
+        /* The mappings of a user namespace may be written only once, hence once we found some we can keep
+         * them. Until the file is written it is empty, and we'll look again next time. This matters, since
+         * the NSS lookups end up here for every machine, for each user and group lookup. */
+        if (*n_map > 0)
+                return 0;
 
         p = procfs_file_alloca(machine->leader, map_file);
         f = fopen(p, "re");
-        if (!f) {
-                log_debug_errno(errno, "Failed to open %s, ignoring.", p);
-                goto negative;
-        }
+        if (!f)
+                return -errno;
 
         for (;;) {
-                uid_t uid_base, uid_shift, uid_range, converted;
+                uid_t uid_base, uid_shift, uid_range;
                 int k;
 
                 errno = 0;
@@ -788,14 +790,62 @@ static int machine_owns_uid_internal(
                         return -EIO;
                 }
 
+                if (!GREEDY_REALLOC(entries, allocated, n + 1))
+                        return -ENOMEM;
+
+                entries[n++] = (UidMapEntry) {
+                        .uid_base = uid_base,
+                        .uid_shift = uid_shift,
+                        .uid_range = uid_range,
+                };
+        }
+
+        free_and_replace(*map, entries);
+        *n_map = n;
+
+        return 0;
+}
+
+static int machine_owns_uid_internal(
+                Machine *machine,
+                const char *map_file, /* "uid_map" or "gid_map" */
+                UidMapEntry **map,
+                size_t *n_map,
+                uid_t uid,
+                uid_t *ret_internal_uid) {
+
+        size_t i;
+        int r;
+
+        /* This is a generic implementation for both uids and gids, under the assumptions they have the same types and semantics. */
+        assert_cc(sizeof(uid_t) == sizeof(gid_t));
+
+        assert(machine);
+
+        /* Checks if the specified host UID is owned by the machine, and returns the UID it maps to
+         * internally in the machine */
+
+        if (machine->class != MACHINE_CONTAINER)
+                goto negative;
+
+        r = machine_load_uid_map(machine, map_file, map, n_map);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to read %s of machine %s, ignoring: %m", map_file, machine->name);
+                goto negative;
+        }
+
+        for (i = 0; i < *n_map; i++) {
+                const UidMapEntry *e = *map + i;
+                uid_t converted;
+
                 /* The private user namespace is disabled, ignoring. */
-                if (uid_shift == 0)
+                if (e->uid_shift == 0)
                         continue;
 
-                if (uid < uid_shift || uid >= uid_shift + uid_range)
+                if (uid < e->uid_shift || uid >= e->uid_shift + e->uid_range)
                         continue;
 
-                converted = (uid - uid_shift + uid_base);
+                converted = (uid - e->uid_shift + e->uid_base);
                 if (!uid_is_valid(converted))
                         return -EINVAL;
 
@@ -813,21 +863,23 @@ negative:
 }
 
 int machine_owns_uid(Machine *machine, uid_t uid, uid_t *ret_internal_uid) {
-        return machine_owns_uid_internal(machine, "uid_map", uid, ret_internal_uid);
+        return machine_owns_uid_internal(machine, "uid_map", &machine->uid_map, &machine->n_uid_map, uid, ret_internal_uid);
 }
 
 int machine_owns_gid(Machine *machine, gid_t gid, gid_t *ret_internal_gid) {
-        return machine_owns_uid_internal(machine, "gid_map", (uid_t) gid, (uid_t*) ret_internal_gid);
+        return machine_owns_uid_internal(machine, "gid_map", &machine->gid_map, &machine->n_gid_map, (uid_t) gid, (uid_t*) ret_internal_gid);
 }
 
 static int machine_translate_uid_internal(
                 Machine *machine,
                 const char *map_file, /* "uid_map" or "gid_map" */
+                UidMapEntry **map,
+                size_t *n_map,
                 uid_t uid,
                 uid_t *ret_host_uid) {
 
-        _cleanup_fclose_ FILE *f = NULL;
-        const char *p;
+        size_t i;
+        int r;
 
         /* This is a generic implementation for both uids and gids, under the assumptions they have the same types and semantics. */
         assert_cc(sizeof(uid_t) == sizeof(gid_t));
@@ -840,30 +892,18 @@ static int machine_translate_uid_internal(
 
         /* Translates a machine UID into a host UID */
 
-        p = procfs_file_alloca(machine->leader, map_file);
-        f = fopen(p, "re");
-        if (!f)
-                return -errno;
-
-        for (;;) {
-                uid_t uid_base, uid_shift, uid_range, converted;
-                int k;
-
-                errno = 0;
-                k = fscanf(f, UID_FMT " " UID_FMT " " UID_FMT, &uid_base, &uid_shift, &uid_range);
-                if (k < 0 && feof(f))
-                        break;
-                if (k != 3) {
-                        if (ferror(f))
-                                return errno_or_else(EIO);
+        r = machine_load_uid_map(machine, map_file, map, n_map);
+        if (r < 0)
+                return r;
 
-                        return -EIO;
-                }
+        for (i = 0; i < *n_map; i++) {
+                const UidMapEntry *e = *map + i;
+                uid_t converted;
 
-                if (uid < uid_base || uid >= uid_base + uid_range)
+                if (uid < e->uid_base || uid >= e->uid_base + e->uid_range)
                         continue;
 
-                converted = uid - uid_base + uid_shift;
+                converted = uid - e->uid_base + e->uid_shift;
                 if (!uid_is_valid(converted))
                         return -EINVAL;
 
@@ -876,11 +916,11 @@ static int machine_translate_uid_internal(
 }
 
 int machine_translate_uid(Machine *machine, gid_t uid, gid_t *ret_host_uid) {
-        return machine_translate_uid_internal(machine, "uid_map", uid, ret_host_uid);
+        return machine_translate_uid_internal(machine, "uid_map", &machine->uid_map, &machine->n_uid_map, uid, ret_host_uid);
 }
 
 int machine_translate_gid(Machine *machine, gid_t gid, gid_t *ret_host_gid) {
-        return machine_translate_uid_internal(machine, "gid_map", (uid_t) gid, (uid_t*) ret_host_gid);
+        return machine_translate_uid_internal(machine, "gid_map", &machine->gid_map, &machine->n_gid_map, (uid_t) gid, (uid_t*) ret_host_gid);
 }
 
 static const char* const machine_class_table[_MACHINE_CLASS_MAX] = {
@@ -25,6 +25,10 @@ typedef enum MachineClass {
         _MACHINE_CLASS_INVALID = -1
 } MachineClass;
 
+typedef struct UidMapEntry {
+        uid_t uid_base, uid_shift, uid_range;
+} UidMapEntry;
+
 enum KillWho {
         KILL_LEADER,
         KILL_ALL,
@@ -61,6 +65,10 @@ struct Machine {
         int *netif;
         size_t n_netif;
 
+        /* The leader's uid_map and gid_map, cached once they are written */
+        UidMapEntry *uid_map, *gid_map;
+        size_t n_uid_map, n_gid_map;
+
         LIST_HEAD(Operation, operations);
 
         LIST_FIELDS(Machine, gc_queue);
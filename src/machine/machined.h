@@ -28,6 +28,7 @@ struct Manager {
 
         Hashmap *image_cache;
         sd_event_source *image_cache_defer_event;
+        Hashmap *image_metadata_cache;
 
         LIST_HEAD(Machine, machine_gc_queue);
 
@@ -154,6 +154,11 @@ typedef struct LinkInfo {
 
         uint64_t tx_bitrate;
         uint64_t rx_bitrate;
+        uint64_t tx_bitrate_avg;
+        uint64_t rx_bitrate_avg;
+
+        sd_lldp_neighbor **lldp_neighbors;
+        size_t n_lldp_neighbors, n_allocated_lldp_neighbors;
 
         /* bridge info */
         uint32_t forward_delay;
@@ -217,6 +222,7 @@ typedef struct LinkInfo {
         bool has_stats64:1;
         bool has_stats:1;
         bool has_bitrates:1;
+        bool has_bitrates_avg:1;
         bool has_ethtool_link_info:1;
         bool has_wlan_link_info:1;
         bool has_tunnel_ipv4:1;
@@ -235,6 +241,10 @@ static const LinkInfo* link_info_array_free(LinkInfo *array) {
                 free(array[i].ssid);
                 free(array[i].qdisc);
                 strv_free(array[i].alternative_names);
+
+                for (size_t j = 0; j < array[i].n_lldp_neighbors; j++)
+                        sd_lldp_neighbor_unref(array[i].lldp_neighbors[j]);
+                free(array[i].lldp_neighbors);
         }
 
         return mfree(array);
@@ -534,6 +544,88 @@ static int acquire_link_bitrates(sd_bus *bus, LinkInfo *link) {
         return 0;
 }
 
+static int acquire_links_bitrates(sd_bus *bus, LinkInfo *links, size_t n) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        uint64_t tx, rx, tx_avg, rx_avg;
+        int ifindex, r;
+
+        assert(bus);
+        assert(links || n == 0);
+
+        if (n == 0)
+                return 0;
+
+        /* Query all links in one go. Older networkd versions only provide the per-link property. */
+        r = bus_call_method(bus, bus_network_mgr, "ListLinkBitRates", &error, &reply, NULL);
+        if (r < 0) {
+                if (sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD)) {
+                        for (size_t j = 0; j < n; j++)
+                                (void) acquire_link_bitrates(bus, links + j);
+                        return 0;
+                }
+
+                return log_full_errno(sd_bus_error_has_name(&error, BUS_ERROR_SPEED_METER_INACTIVE) ? LOG_DEBUG : LOG_WARNING,
+                                      r, "Failed to query link bit rates: %s", bus_error_message(&error, r));
+        }
+
+        r = sd_bus_message_enter_container(reply, 'a', "(itttt)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = sd_bus_message_read(reply, "(itttt)", &ifindex, &tx, &rx, &tx_avg, &rx_avg)) > 0) {
+                LinkInfo key = { .ifindex = ifindex }, *link;
+
+                /* The array is sorted by ifindex. */
+                link = typesafe_bsearch(&key, links, n, link_info_compare);
+                if (!link)
+                        continue;
+
+                link->tx_bitrate = tx;
+                link->rx_bitrate = rx;
+                link->tx_bitrate_avg = tx_avg;
+                link->rx_bitrate_avg = rx_avg;
+                link->has_bitrates = tx != UINT64_MAX && rx != UINT64_MAX;
+                link->has_bitrates_avg = tx_avg != UINT64_MAX && rx_avg != UINT64_MAX;
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return 0;
+}
+
+static int acquire_link_setup_timestamps(sd_bus *bus, const LinkInfo *link, usec_t ret[static 4]) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        int r;
+
+        r = link_get_property(bus, link, &error, &reply, "org.freedesktop.network1.Link", "SetupTimestampsMonotonic");
+        if (r < 0) {
+                bool quiet = sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_PROPERTY);
+
+                return log_full_errno(quiet ? LOG_DEBUG : LOG_WARNING,
+                                      r, "Failed to query link setup timestamps: %s", bus_error_message(&error, r));
+        }
+
+        r = sd_bus_message_enter_container(reply, 'v', "(tttt)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_read(reply, "(tttt)", &ret[0], &ret[1], &ret[2], &ret[3]);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return 0;
+}
+
 static void acquire_ether_link_info(int *fd, LinkInfo *link) {
         if (ethtool_get_link_info(fd, link->name,
                                   &link->autonegotiation,
@@ -578,7 +670,7 @@ static int acquire_link_info(sd_bus *bus, sd_netlink *rtnl, char **patterns, Lin
         _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *req = NULL, *reply = NULL;
         _cleanup_(link_info_array_freep) LinkInfo *links = NULL;
         _cleanup_close_ int fd = -1;
-        size_t allocated = 0, c = 0, j;
+        size_t allocated = 0, c = 0;
         sd_netlink_message *i;
         int r;
 
@@ -643,8 +735,7 @@ static int acquire_link_info(sd_bus *bus, sd_netlink *rtnl, char **patterns, Lin
         typesafe_qsort(links, c, link_info_compare);
 
         if (bus)
-                for (j = 0; j < c; j++)
-                        (void) acquire_link_bitrates(bus, links + j);
+                (void) acquire_links_bitrates(bus, links, c);
 
         *ret = TAKE_PTR(links);
 
@@ -1130,6 +1221,117 @@ static int next_lldp_neighbor(FILE *f, sd_lldp_neighbor **ret) {
         return 1;
 }
 
+static int link_info_add_lldp_neighbor(LinkInfo *link, sd_lldp_neighbor *n) {
+        assert(link);
+        assert(n);
+
+        if (!GREEDY_REALLOC(link->lldp_neighbors, link->n_allocated_lldp_neighbors, link->n_lldp_neighbors + 1))
+                return -ENOMEM;
+
+        link->lldp_neighbors[link->n_lldp_neighbors++] = sd_lldp_neighbor_ref(n);
+        return 0;
+}
+
+static int acquire_lldp_neighbors_from_file(LinkInfo *link) {
+        _cleanup_fclose_ FILE *f = NULL;
+        int r;
+
+        assert(link);
+
+        r = open_lldp_neighbors(link->ifindex, &f);
+        if (r == -ENOENT)
+                return 0;
+        if (r < 0)
+                return log_warning_errno(r, "Failed to open LLDP data for %i, ignoring: %m", link->ifindex);
+
+        for (;;) {
+                _cleanup_(sd_lldp_neighbor_unrefp) sd_lldp_neighbor *n = NULL;
+
+                r = next_lldp_neighbor(f, &n);
+                if (r < 0)
+                        return log_warning_errno(r, "Failed to read neighbor data: %m");
+                if (r == 0)
+                        return 0;
+
+                r = link_info_add_lldp_neighbor(link, n);
+                if (r < 0)
+                        return log_oom();
+        }
+}
+
+static int acquire_lldp_neighbors(sd_bus *bus, LinkInfo *links, size_t n) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        int r;
+
+        assert(links || n == 0);
+
+        /* Ask networkd for the neighbors of all links in one call, and fall back to the per-link
+         * files if it cannot be reached or is too old. */
+        if (bus) {
+                r = bus_call_method(bus, bus_network_mgr, "ListLLDPNeighbors", &error, &reply, NULL);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to query LLDP neighbors, reading saved data instead: %s",
+                                        bus_error_message(&error, r));
+        }
+
+        if (!reply) {
+                for (size_t j = 0; j < n; j++) {
+                        r = acquire_lldp_neighbors_from_file(links + j);
+                        if (r == -ENOMEM)
+                                return r;
+                }
+
+                return 0;
+        }
+
+        r = sd_bus_message_enter_container(reply, 'a', "(iay)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = sd_bus_message_enter_container(reply, 'r', "iay")) > 0) {
+                _cleanup_(sd_lldp_neighbor_unrefp) sd_lldp_neighbor *neighbor = NULL;
+                LinkInfo key = {}, *link;
+                const void *raw;
+                size_t sz;
+
+                r = sd_bus_message_read(reply, "i", &key.ifindex);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_read_array(reply, 'y', &raw, &sz);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                /* The array is sorted by ifindex. */
+                link = typesafe_bsearch(&key, links, n, link_info_compare);
+                if (!link)
+                        continue;
+
+                r = sd_lldp_neighbor_from_raw(&neighbor, raw, sz);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to parse neighbor data of %s, ignoring: %m", link->name);
+                        continue;
+                }
+
+                r = link_info_add_lldp_neighbor(link, neighbor);
+                if (r < 0)
+                        return log_oom();
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return 0;
+}
+
 static int dump_lldp_neighbors(Table *table, const char *prefix, int ifindex) {
         _cleanup_strv_free_ char **buf = NULL;
         _cleanup_fclose_ FILE *f = NULL;
@@ -1395,6 +1597,7 @@ static int link_status_one(
         _cleanup_free_ int *carrier_bound_to = NULL, *carrier_bound_by = NULL;
         _cleanup_(sd_dhcp_lease_unrefp) sd_dhcp_lease *lease = NULL;
         _cleanup_(table_unrefp) Table *table = NULL;
+        usec_t setup_timestamps[4] = {};
         TableCell *cell;
         int r;
 
@@ -1486,6 +1689,26 @@ static int link_status_one(
         if (r < 0)
                 return table_log_add_error(r);
 
+        /* Pending (waiting for udev), initialized, configuring, configured or failed */
+        if (bus && acquire_link_setup_timestamps(bus, info, setup_timestamps) >= 0 &&
+            setup_timestamps[2] > 0 && setup_timestamps[3] >= setup_timestamps[2]) {
+                char total[FORMAT_TIMESPAN_MAX], udev[FORMAT_TIMESPAN_MAX], configuring[FORMAT_TIMESPAN_MAX];
+                usec_t start = setup_timestamps[0] > 0 ? setup_timestamps[0] : setup_timestamps[1];
+
+                r = table_add_many(table,
+                                   TABLE_EMPTY,
+                                   TABLE_STRING, "Setup Time:");
+                if (r < 0)
+                        return table_log_add_error(r);
+                r = table_add_cell_stringf(table, NULL, "%s (udev: %s, configuring: %s)",
+                                           format_timespan(total, sizeof total, usec_sub_unsigned(setup_timestamps[3], start), USEC_PER_MSEC),
+                                           format_timespan(udev, sizeof udev, usec_sub_unsigned(setup_timestamps[1], start), USEC_PER_MSEC),
+                                           format_timespan(configuring, sizeof configuring,
+                                                           usec_sub_unsigned(setup_timestamps[3], setup_timestamps[2]), USEC_PER_MSEC));
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
         strv_sort(info->alternative_names);
         r = dump_list(table, "Alternative Names:", info->alternative_names);
         if (r < 0)
@@ -1985,6 +2208,21 @@ static int link_status_one(
                         return table_log_add_error(r);
         }
 
+        if (info->has_bitrates_avg) {
+                char tx[FORMAT_BYTES_MAX], rx[FORMAT_BYTES_MAX];
+
+                r = table_add_many(table,
+                                   TABLE_EMPTY,
+                                   TABLE_STRING, "Average Bit Rate (Tx/Rx):");
+                if (r < 0)
+                        return table_log_add_error(r);
+                r = table_add_cell_stringf(table, NULL, "%sbps/%sbps",
+                                           format_bytes_full(tx, sizeof tx, info->tx_bitrate_avg, 0),
+                                           format_bytes_full(rx, sizeof rx, info->rx_bitrate_avg, 0));
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
         if (info->has_tx_queues || info->has_rx_queues) {
                 r = table_add_many(table,
                                    TABLE_EMPTY,
@@ -2298,6 +2536,7 @@ static void lldp_capabilities_legend(uint16_t x) {
 }
 
 static int link_lldp_status(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         _cleanup_(sd_netlink_unrefp) sd_netlink *rtnl = NULL;
         _cleanup_(link_info_array_freep) LinkInfo *links = NULL;
         _cleanup_(table_unrefp) Table *table = NULL;
@@ -2309,6 +2548,10 @@ static int link_lldp_status(int argc, char *argv[], void *userdata) {
         if (r < 0)
                 return log_error_errno(r, "Failed to connect to netlink: %m");
 
+        r = sd_bus_open_system(&bus);
+        if (r < 0)
+                log_debug_errno(r, "Failed to connect system bus, ignoring: %m");
+
         c = acquire_link_info(NULL, rtnl, argc > 1 ? argv + 1 : NULL, &links);
         if (c < 0)
                 return c;
@@ -2347,31 +2590,17 @@ static int link_lldp_status(int argc, char *argv[], void *userdata) {
         assert_se(cell = table_get_cell(table, 0, 5));
         table_set_minimum_width(table, cell, 16);
 
-        for (i = 0; i < c; i++) {
-                _cleanup_fclose_ FILE *f = NULL;
-
-                r = open_lldp_neighbors(links[i].ifindex, &f);
-                if (r == -ENOENT)
-                        continue;
-                if (r < 0) {
-                        log_warning_errno(r, "Failed to open LLDP data for %i, ignoring: %m", links[i].ifindex);
-                        continue;
-                }
+        r = acquire_lldp_neighbors(bus, links, c);
+        if (r < 0)
+                return r;
 
-                for (;;) {
+        for (i = 0; i < c; i++) {
+                for (size_t j = 0; j < links[i].n_lldp_neighbors; j++) {
                         _cleanup_free_ char *cid = NULL, *pid = NULL, *sname = NULL, *pdesc = NULL, *capabilities = NULL;
                         const char *chassis_id = NULL, *port_id = NULL, *system_name = NULL, *port_description = NULL;
-                        _cleanup_(sd_lldp_neighbor_unrefp) sd_lldp_neighbor *n = NULL;
+                        sd_lldp_neighbor *n = links[i].lldp_neighbors[j];
                         uint16_t cc;
 
-                        r = next_lldp_neighbor(f, &n);
-                        if (r < 0) {
-                                log_warning_errno(r, "Failed to read neighbor data: %m");
-                                break;
-                        }
-                        if (r == 0)
-                                break;
-
                         (void) sd_lldp_neighbor_get_chassis_id_as_string(n, &chassis_id);
                         (void) sd_lldp_neighbor_get_port_id_as_string(n, &port_id);
                         (void) sd_lldp_neighbor_get_system_name(n, &system_name);
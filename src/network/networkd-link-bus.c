@@ -24,7 +24,7 @@ BUS_DEFINE_PROPERTY_GET_ENUM(property_get_carrier_state, link_carrier_state, Lin
 BUS_DEFINE_PROPERTY_GET_ENUM(property_get_address_state, link_address_state, LinkAddressState);
 static BUS_DEFINE_PROPERTY_GET_ENUM(property_get_administrative_state, link_state, LinkState);
 
-static int property_get_bit_rates(
+static int property_get_setup_timestamps(
                 sd_bus *bus,
                 const char *path,
                 const char *interface,
@@ -34,35 +34,41 @@ static int property_get_bit_rates(
                 sd_bus_error *error) {
 
         Link *link = userdata;
-        Manager *manager;
-        double interval_sec;
-        uint64_t tx, rx;
 
         assert(bus);
         assert(reply);
         assert(userdata);
 
-        manager = link->manager;
+        return sd_bus_message_append(reply, "(tttt)",
+                                     link->state_timestamp[LINK_STATE_PENDING],
+                                     link->state_timestamp[LINK_STATE_INITIALIZED],
+                                     link->state_timestamp[LINK_STATE_CONFIGURING],
+                                     MAX(link->state_timestamp[LINK_STATE_CONFIGURED],
+                                         link->state_timestamp[LINK_STATE_FAILED]));
+}
 
-        if (!manager->use_speed_meter ||
-            manager->speed_meter_usec_old == 0 ||
-            !link->stats_updated)
-                return sd_bus_message_append(reply, "(tt)", UINT64_MAX, UINT64_MAX);
+static int property_get_bit_rates(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Link *link = userdata;
 
-        assert(manager->speed_meter_usec_new > manager->speed_meter_usec_old);
-        interval_sec = (manager->speed_meter_usec_new - manager->speed_meter_usec_old) / USEC_PER_SEC;
+        assert(bus);
+        assert(reply);
+        assert(userdata);
 
-        if (link->stats_new.tx_bytes > link->stats_old.tx_bytes)
-                tx = (uint64_t) ((link->stats_new.tx_bytes - link->stats_old.tx_bytes) / interval_sec);
-        else
-                tx = (uint64_t) ((UINT64_MAX - (link->stats_old.tx_bytes - link->stats_new.tx_bytes)) / interval_sec);
+        if (!link->manager->use_speed_meter)
+                return sd_bus_message_append(reply, "(tt)", UINT64_MAX, UINT64_MAX);
 
-        if (link->stats_new.rx_bytes > link->stats_old.rx_bytes)
-                rx = (uint64_t) ((link->stats_new.rx_bytes - link->stats_old.rx_bytes) / interval_sec);
-        else
-                rx = (uint64_t) ((UINT64_MAX - (link->stats_old.rx_bytes - link->stats_new.rx_bytes)) / interval_sec);
+        if (streq(property, "BitRatesAverage"))
+                return sd_bus_message_append(reply, "(tt)", link->tx_bitrate_avg, link->rx_bitrate_avg);
 
-        return sd_bus_message_append(reply, "(tt)", tx, rx);
+        return sd_bus_message_append(reply, "(tt)", link->tx_bitrate, link->rx_bitrate);
 }
 
 static int verify_managed_link(Link *l, sd_bus_error *error) {
@@ -684,6 +690,8 @@ const sd_bus_vtable link_vtable[] = {
         SD_BUS_PROPERTY("AddressState", "s", property_get_address_state, offsetof(Link, address_state), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
         SD_BUS_PROPERTY("AdministrativeState", "s", property_get_administrative_state, offsetof(Link, state), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
         SD_BUS_PROPERTY("BitRates", "(tt)", property_get_bit_rates, 0, 0),
+        SD_BUS_PROPERTY("BitRatesAverage", "(tt)", property_get_bit_rates, 0, 0),
+        SD_BUS_PROPERTY("SetupTimestampsMonotonic", "(tttt)", property_get_setup_timestamps, 0, 0),
 
         SD_BUS_METHOD("SetNTP", "as", NULL, bus_link_method_set_ntp_servers, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("SetDNS", "a(iay)", NULL, bus_link_method_set_dns_servers, SD_BUS_VTABLE_UNPRIVILEGED),
@@ -594,7 +594,12 @@ static int link_new(Manager *manager, sd_netlink_message *message, Link **ret) {
                 .n_ref = 1,
                 .manager = manager,
                 .state = LINK_STATE_PENDING,
+                .state_timestamp[LINK_STATE_PENDING] = now(CLOCK_MONOTONIC),
                 .ifindex = ifindex,
+                .tx_bitrate = UINT64_MAX,
+                .rx_bitrate = UINT64_MAX,
+                .tx_bitrate_avg = UINT64_MAX,
+                .rx_bitrate_avg = UINT64_MAX,
                 .iftype = iftype,
 
                 .n_dns = (unsigned) -1,
@@ -798,6 +803,18 @@ void link_set_state(Link *link, LinkState state) {
                        link_state_to_string(state));
 
         link->state = state;
+        link->state_timestamp[state] = now(CLOCK_MONOTONIC);
+
+        if (IN_SET(state, LINK_STATE_CONFIGURED, LINK_STATE_FAILED) &&
+            link->state_timestamp[LINK_STATE_CONFIGURING] > 0) {
+                char buf[FORMAT_TIMESPAN_MAX];
+
+                log_link_debug(link, "Configuring took %s.",
+                               format_timespan(buf, sizeof buf,
+                                               usec_sub_unsigned(link->state_timestamp[state],
+                                                                 link->state_timestamp[LINK_STATE_CONFIGURING]),
+                                               USEC_PER_MSEC));
+        }
 
         link_send_changed(link, "AdministrativeState", NULL);
 }
@@ -70,6 +70,7 @@ typedef struct Link {
         Network *network;
 
         LinkState state;
+        usec_t state_timestamp[_LINK_STATE_MAX]; /* CLOCK_MONOTONIC, when each state was entered last */
         LinkOperationalState operstate;
         LinkCarrierState carrier_state;
         LinkAddressState address_state;
@@ -172,6 +173,10 @@ typedef struct Link {
         /* For speed meter */
         struct rtnl_link_stats64 stats_old, stats_new;
         bool stats_updated;
+        bool stats_valid;
+        /* In bytes per second, UINT64_MAX when unknown. The averages are exponentially weighted. */
+        uint64_t tx_bitrate, rx_bitrate;
+        uint64_t tx_bitrate_avg, rx_bitrate_avg;
 
         /* All kinds of DNS configuration the user configured via D-Bus */
         struct in_addr_full **dns;
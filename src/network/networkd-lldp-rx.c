@@ -52,7 +52,10 @@ static void lldp_handler(sd_lldp *lldp, sd_lldp_event event, sd_lldp_neighbor *n
 
         assert(link);
 
-        (void) link_lldp_save(link);
+        /* A refresh only restarts the TTL of an unchanged neighbor, and the saved data does not
+         * contain the TTL, hence there is no need to rewrite the file. */
+        if (event != SD_LLDP_EVENT_REFRESHED)
+                (void) link_lldp_save(link);
 
         if (link_lldp_emit_enabled(link) && event == SD_LLDP_EVENT_ADDED) {
                 /* If we received information about a new neighbor, restart the LLDP "fast" logic */
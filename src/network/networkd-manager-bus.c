@@ -55,6 +55,117 @@ static int method_list_links(sd_bus_message *message, void *userdata, sd_bus_err
         return sd_bus_send(NULL, reply, NULL);
 }
 
+static int method_list_link_bit_rates(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *manager = userdata;
+        Iterator i;
+        Link *link;
+        int r;
+
+        if (!manager->use_speed_meter)
+                return sd_bus_error_set(error, BUS_ERROR_SPEED_METER_INACTIVE, "Speed meter is disabled.");
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(itttt)");
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH(link, manager->links, i) {
+                r = sd_bus_message_append(
+                        reply, "(itttt)",
+                        link->ifindex,
+                        link->tx_bitrate,
+                        link->rx_bitrate,
+                        link->tx_bitrate_avg,
+                        link->rx_bitrate_avg);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
+static int append_lldp_neighbors(sd_bus_message *reply, Link *link) {
+        sd_lldp_neighbor **l = NULL;
+        int n, r = 0;
+
+        assert(reply);
+        assert(link);
+
+        if (!link->lldp)
+                return 0;
+
+        n = sd_lldp_get_neighbors(link->lldp, &l);
+        if (n < 0)
+                return n;
+
+        for (int i = 0; i < n; i++) {
+                const void *p;
+                size_t sz;
+
+                r = sd_lldp_neighbor_get_raw(l[i], &p, &sz);
+                if (r < 0)
+                        break;
+
+                r = sd_bus_message_open_container(reply, 'r', "iay");
+                if (r < 0)
+                        break;
+
+                r = sd_bus_message_append(reply, "i", link->ifindex);
+                if (r < 0)
+                        break;
+
+                r = sd_bus_message_append_array(reply, 'y', p, sz);
+                if (r < 0)
+                        break;
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        break;
+        }
+
+        for (int i = 0; i < n; i++)
+                sd_lldp_neighbor_unref(l[i]);
+        free(l);
+
+        return r;
+}
+
+static int method_list_lldp_neighbors(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *manager = userdata;
+        Iterator i;
+        Link *link;
+        int r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(iay)");
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH(link, manager->links, i) {
+                r = append_lldp_neighbors(reply, link);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_get_link_by_name(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_free_ char *path = NULL;
@@ -239,6 +350,8 @@ const sd_bus_vtable manager_vtable[] = {
         SD_BUS_PROPERTY("AddressState", "s", property_get_address_state, offsetof(Manager, address_state), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
 
         SD_BUS_METHOD("ListLinks", NULL, "a(iso)", method_list_links, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ListLinkBitRates", NULL, "a(itttt)", method_list_link_bit_rates, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ListLLDPNeighbors", NULL, "a(iay)", method_list_lldp_neighbors, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("GetLinkByName", "s", "io", method_get_link_by_name, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("GetLinkByIndex", "i", "so", method_get_link_by_index, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("SetLinkNTP", "ias", NULL, bus_method_set_link_ntp_servers, SD_BUS_VTABLE_UNPRIVILEGED),
@@ -285,6 +285,13 @@ static int manager_connect_udev(Manager *m) {
         return 0;
 }
 
+static bool manager_route_is_ignored(Manager *m, uint32_t table, uint8_t protocol) {
+        assert(m);
+
+        return set_contains(m->ignore_route_tables, UINT32_TO_PTR(table)) ||
+                set_contains(m->ignore_route_protocols, UINT32_TO_PTR(protocol));
+}
+
 int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, void *userdata) {
         _cleanup_(route_freep) Route *tmp = NULL;
         Route *route = NULL;
@@ -356,6 +363,17 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, vo
                 return 0;
         }
 
+        r = sd_rtnl_message_route_get_table(message, &table);
+        if (r < 0) {
+                log_link_warning_errno(link, r, "rtnl: received route message with invalid table, ignoring: %m");
+                return 0;
+        }
+        tmp->table = table;
+
+        /* The socket filter cannot see tables above 255 and does not apply to dumps, hence check again. */
+        if (manager_route_is_ignored(m, tmp->table, tmp->protocol))
+                return 0;
+
         switch (tmp->family) {
         case AF_INET:
                 r = sd_netlink_message_read_in_addr(message, RTA_DST, &tmp->dst.in);
@@ -446,13 +464,6 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, vo
                 return 0;
         }
 
-        r = sd_rtnl_message_route_get_table(message, &table);
-        if (r < 0) {
-                log_link_warning_errno(link, r, "rtnl: received route message with invalid table, ignoring: %m");
-                return 0;
-        }
-        tmp->table = table;
-
         r = sd_netlink_message_read_u32(message, RTA_PRIORITY, &tmp->priority);
         if (r < 0 && r != -ENODATA) {
                 log_link_warning_errno(link, r, "rtnl: received route message with invalid priority, ignoring: %m");
@@ -1376,6 +1387,12 @@ static int manager_connect_rtnl(Manager *m) {
         if (r < 0)
                 return r;
 
+        /* Links may come with thousands of routes and addresses, hence send all requests we queue while
+         * processing one event with as few syscalls as possible. */
+        r = sd_netlink_set_batching(m->rtnl, true);
+        if (r < 0)
+                return r;
+
         r = sd_netlink_add_match(m->rtnl, NULL, RTM_NEWLINK, &manager_rtnl_process_link, NULL, m, "network-rtnl_process_link");
         if (r < 0)
                 return r;
@@ -1843,6 +1860,7 @@ void manager_free(Manager *m) {
         m->links = hashmap_free_with_destructor(m->links, link_unref);
 
         m->duids_requesting_uuid = set_free(m->duids_requesting_uuid);
+        m->networks_by_name = hashmap_free_with_destructor(m->networks_by_name, ordered_set_free);
         m->networks = ordered_hashmap_free_with_destructor(m->networks, network_unref);
 
         m->netdevs = hashmap_free_with_destructor(m->netdevs, netdev_unref);
@@ -1852,6 +1870,9 @@ void manager_free(Manager *m) {
 
         /* routing_policy_rule_free() access m->rules and m->rules_foreign.
          * So, it is necessary to set NULL after the sets are freed. */
+        m->ignore_route_tables = set_free(m->ignore_route_tables);
+        m->ignore_route_protocols = set_free(m->ignore_route_protocols);
+
         m->rules = set_free(m->rules);
         m->rules_foreign = set_free(m->rules_foreign);
         set_free(m->rules_saved);
@@ -1876,6 +1897,65 @@ void manager_free(Manager *m) {
         free(m);
 }
 
+static int manager_setup_rtnl_filter(Manager *m) {
+        _cleanup_free_ struct sock_filter *filter = NULL;
+        size_t n = 0, n_max;
+        Iterator i;
+        void *p;
+
+        assert(m);
+
+        if (set_isempty(m->ignore_route_tables) && set_isempty(m->ignore_route_protocols))
+                return 0;
+
+        /* Drop multicast notifications about routes in ignored tables or with ignored protocols already in
+         * the kernel, so that a host carrying a full routing table does not wake us up for every change. */
+
+        /* 10 instructions for the header checks, one load per non-empty set, two instructions per set
+         * entry, and the final accept. */
+        n_max = 13 + 2 * (set_size(m->ignore_route_tables) + set_size(m->ignore_route_protocols));
+        filter = new(struct sock_filter, n_max);
+        if (!filter)
+                return -ENOMEM;
+
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD + BPF_W + BPF_LEN, 0);                                       /* A <- message length */
+        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JGE + BPF_K, NLMSG_HDRLEN + sizeof(struct rtmsg), 1, 0); /* A >= header + rtmsg ? */
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, UINT32_MAX);                                       /* accept */
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD + BPF_H + BPF_ABS, offsetof(struct nlmsghdr, nlmsg_flags));  /* A <- flags */
+        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K, htobe16(NLM_F_MULTI), 0, 1);            /* part of a dump ? */
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, UINT32_MAX);                                       /* accept */
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD + BPF_H + BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type));   /* A <- type */
+        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, htobe16(RTM_NEWROUTE), 2, 0);            /* RTM_NEWROUTE ? */
+        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, htobe16(RTM_DELROUTE), 1, 0);            /* RTM_DELROUTE ? */
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, UINT32_MAX);                                       /* accept */
+
+        if (!set_isempty(m->ignore_route_tables)) {
+                filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD + BPF_B + BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_table));
+                SET_FOREACH(p, m->ignore_route_tables, i) {
+                        /* rtm_table carries RT_TABLE_COMPAT for larger tables, those are filtered later. */
+                        if (PTR_TO_UINT32(p) > UINT8_MAX)
+                                continue;
+
+                        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, PTR_TO_UINT32(p), 0, 1);
+                        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, 0);
+                }
+        }
+
+        if (!set_isempty(m->ignore_route_protocols)) {
+                filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD + BPF_B + BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_protocol));
+                SET_FOREACH(p, m->ignore_route_protocols, i) {
+                        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, PTR_TO_UINT32(p), 0, 1);
+                        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, 0);
+                }
+        }
+
+        filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET + BPF_K, UINT32_MAX);                                       /* accept */
+
+        assert(n <= n_max);
+
+        return sd_netlink_attach_filter(m->rtnl, n, filter);
+}
+
 int manager_start(Manager *m) {
         Link *link;
         Iterator i;
@@ -1887,6 +1967,10 @@ int manager_start(Manager *m) {
         if (r < 0)
                 return log_error_errno(r, "Failed to initialize speed meter: %m");
 
+        r = manager_setup_rtnl_filter(m);
+        if (r < 0)
+                log_warning_errno(r, "Failed to install socket filter for ignored routes, ignoring: %m");
+
         /* The dirty handler will deal with future serialization, but the first one
            must be done explicitly. */
 
@@ -1912,6 +1996,10 @@ int manager_load_config(Manager *m) {
         if (r < 0)
                 return r;
 
+        r = network_build_index(m);
+        if (r < 0)
+                return r;
+
         return 0;
 }
 
@@ -32,6 +32,8 @@ struct Manager {
         bool dirty:1;
         bool restarting:1;
         bool manage_foreign_routes;
+        Set *ignore_route_tables;
+        Set *ignore_route_protocols;
 
         Set *dirty_links;
 
@@ -43,6 +45,7 @@ struct Manager {
         Hashmap *links;
         Hashmap *netdevs;
         OrderedHashmap *networks;
+        Hashmap *networks_by_name; /* literal Name= entry → OrderedSet of Network */
         Hashmap *dhcp6_prefixes;
         Set *dhcp6_pd_prefixes;
         LIST_HEAD(AddressPool, address_pools);
@@ -68,6 +71,7 @@ struct Manager {
         usec_t speed_meter_interval_usec;
         usec_t speed_meter_usec_new;
         usec_t speed_meter_usec_old;
+        bool speed_meter_use_link_dump;
 
         bool dhcp4_prefix_root_cannot_set_table;
 };
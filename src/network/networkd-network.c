@@ -10,6 +10,7 @@
 #include "conf-parser.h"
 #include "dns-domain.h"
 #include "fd-util.h"
+#include "glob-util.h"
 #include "hostname-util.h"
 #include "in-addr-util.h"
 #include "networkd-dhcp-server.h"
@@ -628,10 +629,11 @@ int network_reload(Manager *manager) {
                 network_unref(n);
         }
 
+        manager->networks_by_name = hashmap_free_with_destructor(manager->networks_by_name, ordered_set_free);
         ordered_hashmap_free_with_destructor(manager->networks, network_unref);
         manager->networks = new_networks;
 
-        return 0;
+        return network_build_index(manager);
 
 failure:
         ordered_hashmap_free_with_destructor(new_networks, network_unref);
@@ -639,6 +641,77 @@ failure:
         return r;
 }
 
+static bool network_match_name_is_literal(char * const *names) {
+        char * const *n;
+
+        if (strv_isempty(names))
+                return false;
+
+        STRV_FOREACH(n, names)
+                if (**n == '!' || string_is_glob(*n) || strchr(*n, '\\'))
+                        return false;
+
+        return true;
+}
+
+int network_build_index(Manager *manager) {
+        Network *network;
+        unsigned order = 0;
+        Iterator i;
+        int r;
+
+        assert(manager);
+
+        /* Networks matching on nothing but literal interface names can only ever apply to links with one
+         * of these names. Index them by name, so that network_get() does not need to try each of them for
+         * every link. All other networks are still tried in order. */
+
+        manager->networks_by_name = hashmap_free_with_destructor(manager->networks_by_name, ordered_set_free);
+
+        ORDERED_HASHMAP_FOREACH(network, manager->networks, i) {
+                char **n;
+
+                network->order = order++;
+                network->indexed_by_name = false;
+
+                if (!network_match_name_is_literal(network->match_name) ||
+                    network->match_mac || network->match_permanent_mac || network->match_path ||
+                    network->match_driver || network->match_type || network->match_property ||
+                    network->match_wlan_iftype || network->match_ssid || network->match_bssid)
+                        continue;
+
+                STRV_FOREACH(n, network->match_name) {
+                        _cleanup_ordered_set_free_ OrderedSet *new_set = NULL;
+                        OrderedSet *set;
+
+                        set = hashmap_get(manager->networks_by_name, *n);
+                        if (!set) {
+                                new_set = ordered_set_new(NULL);
+                                if (!new_set)
+                                        return log_oom();
+
+                                r = hashmap_ensure_allocated(&manager->networks_by_name, &string_hash_ops);
+                                if (r < 0)
+                                        return log_oom();
+
+                                r = hashmap_put(manager->networks_by_name, *n, new_set);
+                                if (r < 0)
+                                        return log_oom();
+
+                                set = TAKE_PTR(new_set);
+                        }
+
+                        r = ordered_set_put(set, network);
+                        if (r < 0 && r != -EEXIST)
+                                return log_oom();
+                }
+
+                network->indexed_by_name = true;
+        }
+
+        return 0;
+}
+
 static Network *network_free(Network *network) {
         IPv6ProxyNDPAddress *ipv6_proxy_ndp_address;
         RoutePrefix *route_prefix;
@@ -792,46 +865,102 @@ int network_get_by_name(Manager *manager, const char *name, Network **ret) {
         return 0;
 }
 
+static bool network_matches(
+                Network *network, unsigned short iftype, sd_device *device,
+                const char *ifname, char * const *alternative_names, const char *driver,
+                const struct ether_addr *mac, const struct ether_addr *permanent_mac,
+                enum nl80211_iftype wlan_iftype, const char *ssid, const struct ether_addr *bssid) {
+
+        return net_match_config(network->match_mac, network->match_permanent_mac,
+                                network->match_path, network->match_driver,
+                                network->match_type, network->match_name, network->match_property,
+                                network->match_wlan_iftype, network->match_ssid, network->match_bssid,
+                                device, mac, permanent_mac, driver, iftype,
+                                ifname, alternative_names, wlan_iftype, ssid, bssid);
+}
+
 int network_get(Manager *manager, unsigned short iftype, sd_device *device,
                 const char *ifname, char * const *alternative_names, const char *driver,
                 const struct ether_addr *mac, const struct ether_addr *permanent_mac,
                 enum nl80211_iftype wlan_iftype, const char *ssid, const struct ether_addr *bssid,
                 Network **ret) {
-        Network *network;
+        Network *network, *found = NULL;
+        const char *name = ifname;
         Iterator i;
+        char * const *a;
 
         assert(manager);
         assert(ret);
 
-        ORDERED_HASHMAP_FOREACH(network, manager->networks, i)
-                if (net_match_config(network->match_mac, network->match_permanent_mac,
-                                     network->match_path, network->match_driver,
-                                     network->match_type, network->match_name, network->match_property,
-                                     network->match_wlan_iftype, network->match_ssid, network->match_bssid,
-                                     device, mac, permanent_mac, driver, iftype,
-                                     ifname, alternative_names, wlan_iftype, ssid, bssid)) {
-                        if (network->match_name && device) {
-                                const char *attr;
-                                uint8_t name_assign_type = NET_NAME_UNKNOWN;
-
-                                if (sd_device_get_sysattr_value(device, "name_assign_type", &attr) >= 0)
-                                        (void) safe_atou8(attr, &name_assign_type);
-
-                                if (name_assign_type == NET_NAME_ENUM)
-                                        log_warning("%s: found matching network '%s', based on potentially unpredictable ifname",
-                                                    ifname, network->filename);
-                                else
-                                        log_debug("%s: found matching network '%s'", ifname, network->filename);
-                        } else
-                                log_debug("%s: found matching network '%s'", ifname, network->filename);
-
-                        *ret = network;
-                        return 0;
+        if (!name && device)
+                (void) sd_device_get_sysname(device, &name);
+
+        /* First look at the candidates indexed by name. The first match in file order wins, hence only
+         * networks before the best one found so far need to be tried afterwards. */
+        if (name) {
+                OrderedSet *set;
+
+                set = hashmap_get(manager->networks_by_name, name);
+                ORDERED_SET_FOREACH(network, set, i)
+                        if (network_matches(network, iftype, device, ifname, alternative_names, driver,
+                                            mac, permanent_mac, wlan_iftype, ssid, bssid)) {
+                                found = network;
+                                break;
+                        }
+        }
+
+        STRV_FOREACH(a, alternative_names) {
+                OrderedSet *set;
+
+                set = hashmap_get(manager->networks_by_name, *a);
+                ORDERED_SET_FOREACH(network, set, i) {
+                        if (found && network->order >= found->order)
+                                break;
+
+                        if (network_matches(network, iftype, device, ifname, alternative_names, driver,
+                                            mac, permanent_mac, wlan_iftype, ssid, bssid)) {
+                                found = network;
+                                break;
+                        }
                 }
+        }
+
+        ORDERED_HASHMAP_FOREACH(network, manager->networks, i) {
+                if (found && network->order >= found->order)
+                        break;
+
+                if (network->indexed_by_name)
+                        continue;
+
+                if (network_matches(network, iftype, device, ifname, alternative_names, driver,
+                                    mac, permanent_mac, wlan_iftype, ssid, bssid)) {
+                        found = network;
+                        break;
+                }
+        }
 
-        *ret = NULL;
+        if (!found) {
+                *ret = NULL;
+                return -ENOENT;
+        }
+
+        if (found->match_name && device) {
+                const char *attr;
+                uint8_t name_assign_type = NET_NAME_UNKNOWN;
+
+                if (sd_device_get_sysattr_value(device, "name_assign_type", &attr) >= 0)
+                        (void) safe_atou8(attr, &name_assign_type);
 
-        return -ENOENT;
+                if (name_assign_type == NET_NAME_ENUM)
+                        log_warning("%s: found matching network '%s', based on potentially unpredictable ifname",
+                                    ifname, found->filename);
+                else
+                        log_debug("%s: found matching network '%s'", ifname, found->filename);
+        } else
+                log_debug("%s: found matching network '%s'", ifname, found->filename);
+
+        *ret = found;
+        return 0;
 }
 
 int network_apply(Network *network, Link *link) {
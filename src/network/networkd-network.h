@@ -92,6 +92,11 @@ struct Network {
         Set *match_bssid;
         LIST_HEAD(Condition, conditions);
 
+        /* Position in Manager.networks, and whether the network is found through Manager.networks_by_name
+         * instead of being tried for every link. Both are set by network_build_index(). */
+        unsigned order;
+        bool indexed_by_name;
+
         char *description;
 
         NetDev *bridge;
@@ -340,6 +345,7 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(Network*, network_unref);
 
 int network_load(Manager *manager, OrderedHashmap **networks);
 int network_reload(Manager *manager);
+int network_build_index(Manager *manager);
 int network_load_one(Manager *manager, OrderedHashmap **networks, const char *filename);
 int network_verify(Network *network);
 
@@ -963,7 +963,7 @@ static const char * const route_protocol_full_table[] = {
         [RTPROT_EIGRP]    = "eigrp",
 };
 
-DEFINE_PRIVATE_STRING_TABLE_LOOKUP_TO_STRING(route_protocol_full, int);
+DEFINE_PRIVATE_STRING_TABLE_LOOKUP(route_protocol_full, int);
 
 const char *format_route_protocol(int protocol, char *buf, size_t size) {
         const char *s;
@@ -1276,6 +1276,82 @@ int config_parse_route_table(
         return 0;
 }
 
+int config_parse_ignore_foreign_routes(
+                const char *unit,
+                const char *filename,
+                unsigned line,
+                const char *section,
+                unsigned section_line,
+                const char *lvalue,
+                int ltype,
+                const char *rvalue,
+                void *data,
+                void *userdata) {
+
+        /* ltype selects whether the list contains route protocols (true) or route tables (false). */
+        Set **s = data;
+        const char *p;
+        int r;
+
+        assert(filename);
+        assert(lvalue);
+        assert(rvalue);
+        assert(data);
+
+        if (isempty(rvalue)) {
+                *s = set_free(*s);
+                return 0;
+        }
+
+        for (p = rvalue;;) {
+                _cleanup_free_ char *word = NULL;
+                uint32_t k;
+
+                r = extract_first_word(&p, &word, NULL, 0);
+                if (r == -ENOMEM)
+                        return log_oom();
+                if (r < 0) {
+                        log_syntax(unit, LOG_WARNING, filename, line, r,
+                                   "Invalid syntax, ignoring: %s", rvalue);
+                        return 0;
+                }
+                if (r == 0)
+                        return 0;
+
+                if (ltype) {
+                        r = route_protocol_full_from_string(word);
+                        if (r >= 0)
+                                k = r;
+                        else {
+                                uint8_t u;
+
+                                r = safe_atou8(word, &u);
+                                k = u;
+                        }
+                } else {
+                        r = route_table_from_string(word);
+                        if (r >= 0)
+                                k = r;
+                        else
+                                r = safe_atou32(word, &k);
+                }
+                if (r < 0) {
+                        log_syntax(unit, LOG_WARNING, filename, line, r,
+                                   "Could not parse %s= value \"%s\", ignoring: %m", lvalue, word);
+                        continue;
+                }
+                if (k == 0) {
+                        log_syntax(unit, LOG_WARNING, filename, line, 0,
+                                   "Invalid %s= value \"%s\", ignoring.", lvalue, word);
+                        continue;
+                }
+
+                r = set_ensure_put(s, NULL, UINT32_TO_PTR(k));
+                if (r < 0)
+                        return log_oom();
+        }
+}
+
 int config_parse_route_boolean(
                 const char *unit,
                 const char *filename,
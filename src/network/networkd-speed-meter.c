@@ -5,6 +5,7 @@
 #include "sd-event.h"
 #include "sd-netlink.h"
 
+#include "errno-util.h"
 #include "networkd-link-bus.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
@@ -19,10 +20,12 @@ static int process_message(Manager *manager, sd_netlink_message *message) {
         if (r < 0)
                 return r;
 
-        if (type != RTM_NEWLINK)
+        if (type == RTM_NEWSTATS)
+                r = sd_rtnl_message_stats_get_ifindex(message, &ifindex);
+        else if (type == RTM_NEWLINK)
+                r = sd_rtnl_message_link_get_ifindex(message, &ifindex);
+        else
                 return 0;
-
-        r = sd_rtnl_message_link_get_ifindex(message, &ifindex);
         if (r < 0)
                 return r;
 
@@ -32,7 +35,8 @@ static int process_message(Manager *manager, sd_netlink_message *message) {
 
         link->stats_old = link->stats_new;
 
-        r = sd_netlink_message_read(message, IFLA_STATS64, sizeof link->stats_new, &link->stats_new);
+        r = sd_netlink_message_read(message, type == RTM_NEWSTATS ? IFLA_STATS_LINK_64 : IFLA_STATS64,
+                                    sizeof link->stats_new, &link->stats_new);
         if (r < 0)
                 return r;
 
@@ -41,8 +45,88 @@ static int process_message(Manager *manager, sd_netlink_message *message) {
         return 0;
 }
 
+static uint64_t counter_rate(uint64_t old, uint64_t new, usec_t interval) {
+        /* Unsigned subtraction also does the right thing when the counter wrapped around. */
+        return (uint64_t) ((double) (new - old) * USEC_PER_SEC / interval);
+}
+
+static uint64_t rate_average(uint64_t avg, uint64_t rate) {
+        if (avg == UINT64_MAX)
+                return rate;
+
+        return avg - (avg >> SPEED_METER_AVERAGE_SHIFT) + (rate >> SPEED_METER_AVERAGE_SHIFT);
+}
+
+static void link_update_bit_rates(Link *link, usec_t interval) {
+        assert(link);
+
+        if (!link->stats_updated) {
+                /* The link did not show up in this dump, hence the next sample cannot be compared. */
+                link->stats_valid = false;
+                link->tx_bitrate = link->rx_bitrate = UINT64_MAX;
+                return;
+        }
+
+        if (!link->stats_valid || interval == 0) {
+                link->stats_valid = true;
+                link->tx_bitrate = link->rx_bitrate = UINT64_MAX;
+                return;
+        }
+
+        link->tx_bitrate = counter_rate(link->stats_old.tx_bytes, link->stats_new.tx_bytes, interval);
+        link->rx_bitrate = counter_rate(link->stats_old.rx_bytes, link->stats_new.rx_bytes, interval);
+
+        link->tx_bitrate_avg = rate_average(link->tx_bitrate_avg, link->tx_bitrate);
+        link->rx_bitrate_avg = rate_average(link->rx_bitrate_avg, link->rx_bitrate);
+}
+
+static int speed_meter_dump(Manager *manager, sd_netlink_message **ret) {
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *req = NULL;
+        int r;
+
+        assert(manager);
+        assert(ret);
+
+        if (!manager->speed_meter_use_link_dump) {
+                /* RTM_GETSTATS only carries the 64bit counters, which is much cheaper than dumping
+                 * the full link information when there are many interfaces. */
+                r = sd_rtnl_message_new_stats(manager->rtnl, &req, RTM_GETSTATS, 0,
+                                              IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64));
+                if (r < 0)
+                        return log_warning_errno(r, "Failed to allocate RTM_GETSTATS netlink message, ignoring: %m");
+
+                r = sd_netlink_message_request_dump(req, true);
+                if (r < 0)
+                        return log_warning_errno(r, "Failed to set dump flag, ignoring: %m");
+
+                r = sd_netlink_call(manager->rtnl, req, 0, ret);
+                if (r >= 0)
+                        return 0;
+                if (!ERRNO_IS_NOT_SUPPORTED(r) && r != -EINVAL)
+                        return log_warning_errno(r, "Failed to call RTM_GETSTATS, ignoring: %m");
+
+                log_debug_errno(r, "Kernel does not support RTM_GETSTATS, falling back to RTM_GETLINK: %m");
+                manager->speed_meter_use_link_dump = true;
+                req = sd_netlink_message_unref(req);
+        }
+
+        r = sd_rtnl_message_new_link(manager->rtnl, &req, RTM_GETLINK, 0);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to allocate RTM_GETLINK netlink message, ignoring: %m");
+
+        r = sd_netlink_message_request_dump(req, true);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to set dump flag, ignoring: %m");
+
+        r = sd_netlink_call(manager->rtnl, req, 0, ret);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to call RTM_GETLINK, ignoring: %m");
+
+        return 0;
+}
+
 static int speed_meter_handler(sd_event_source *s, uint64_t usec, void *userdata) {
-        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *req = NULL, *reply = NULL;
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *reply = NULL;
         Manager *manager = userdata;
         sd_netlink_message *i;
         usec_t usec_now;
@@ -67,26 +151,14 @@ static int speed_meter_handler(sd_event_source *s, uint64_t usec, void *userdata
         HASHMAP_FOREACH(link, manager->links, j)
                 link->stats_updated = false;
 
-        r = sd_rtnl_message_new_link(manager->rtnl, &req, RTM_GETLINK, 0);
-        if (r < 0) {
-                log_warning_errno(r, "Failed to allocate RTM_GETLINK netlink message, ignoring: %m");
-                return 0;
-        }
-
-        r = sd_netlink_message_request_dump(req, true);
-        if (r < 0) {
-                log_warning_errno(r, "Failed to set dump flag, ignoring: %m");
-                return 0;
-        }
-
-        r = sd_netlink_call(manager->rtnl, req, 0, &reply);
-        if (r < 0) {
-                log_warning_errno(r, "Failed to call RTM_GETLINK, ignoring: %m");
-                return 0;
-        }
+        r = speed_meter_dump(manager, &reply);
+        if (r >= 0)
+                for (i = reply; i; i = sd_netlink_message_next(i))
+                        (void) process_message(manager, i);
 
-        for (i = reply; i; i = sd_netlink_message_next(i))
-                (void) process_message(manager, i);
+        HASHMAP_FOREACH(link, manager->links, j)
+                link_update_bit_rates(link, manager->speed_meter_usec_old > 0 ?
+                                      manager->speed_meter_usec_new - manager->speed_meter_usec_old : 0);
 
         return 0;
 }
@@ -7,6 +7,9 @@
 #define SPEED_METER_DEFAULT_TIME_INTERVAL (10 * USEC_PER_SEC)
 #define SPEED_METER_MINIMUM_TIME_INTERVAL (100 * USEC_PER_MSEC)
 
+/* The averaged bit rates weigh each new sample with 1/8. */
+#define SPEED_METER_AVERAGE_SHIFT 3
+
 typedef struct Manager Manager;
 
 int manager_start_speed_meter(Manager *m);
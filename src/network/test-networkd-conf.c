@@ -243,6 +243,27 @@ static void test_config_parse_match_strv(void) {
                                        "KEY3=val with \\quotation\\")));
 }
 
+static void test_config_parse_ignore_foreign_routes(void) {
+        _cleanup_set_free_ Set *tables = NULL, *protocols = NULL;
+
+        assert_se(config_parse_ignore_foreign_routes("network", "filename", 1, "section", 1, "IgnoreForeignRouteTable", false,
+                                                     "main 1000 0 hoge 4294967296", &tables, NULL) == 0);
+        assert_se(set_size(tables) == 2);
+        assert_se(set_contains(tables, UINT32_TO_PTR(RT_TABLE_MAIN)));
+        assert_se(set_contains(tables, UINT32_TO_PTR(1000)));
+
+        assert_se(config_parse_ignore_foreign_routes("network", "filename", 1, "section", 1, "IgnoreForeignRouteProtocol", true,
+                                                     "bird bgp 99 256 main", &protocols, NULL) == 0);
+        assert_se(set_size(protocols) == 3);
+        assert_se(set_contains(protocols, UINT32_TO_PTR(RTPROT_BIRD)));
+        assert_se(set_contains(protocols, UINT32_TO_PTR(RTPROT_BGP)));
+        assert_se(set_contains(protocols, UINT32_TO_PTR(99)));
+
+        assert_se(config_parse_ignore_foreign_routes("network", "filename", 1, "section", 1, "IgnoreForeignRouteTable", false,
+                                                     "", &tables, NULL) == 0);
+        assert_se(set_isempty(tables));
+}
+
 int main(int argc, char **argv) {
         log_parse_environment();
         log_open();
@@ -253,6 +274,7 @@ int main(int argc, char **argv) {
         test_config_parse_address();
         test_config_parse_match_ifnames();
         test_config_parse_match_strv();
+        test_config_parse_ignore_foreign_routes();
 
         return 0;
 }
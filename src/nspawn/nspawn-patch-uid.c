@@ -292,33 +292,41 @@ static int is_fs_fully_userns_compatible(const struct statfs *sfs) {
                F_TYPE_EQUAL(sfs->f_type, SYSFS_MAGIC);
 }
 
-static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift, bool is_toplevel) {
+static int recurse_fd(int fd, bool donate_fd, const struct stat *st, dev_t parent_dev, uid_t shift, bool is_toplevel) {
         _cleanup_closedir_ DIR *d = NULL;
         bool changed = false;
-        struct statfs sfs;
         int r;
 
         assert(fd >= 0);
 
-        if (fstatfs(fd, &sfs) < 0)
-                return -errno;
+        /* If we are still on the same file system as the parent directory, the checks below have been done for
+         * it already. A read-only bind mount of the same file system is not caught this way, but patching the
+         * first inode below it fails with EROFS then, which we handle the same way. */
+        if (is_toplevel || st->st_dev != parent_dev) {
+                struct statfs sfs;
 
-        /* We generally want to permit crossing of mount boundaries when patching the UIDs/GIDs. However, we probably
-         * shouldn't do this for /proc and /sys if that is already mounted into place. Hence, let's stop the recursion
-         * when we hit procfs, sysfs or some other special file systems. */
+                if (fstatfs(fd, &sfs) < 0) {
+                        r = -errno;
+                        goto finish;
+                }
 
-        r = is_fs_fully_userns_compatible(&sfs);
-        if (r < 0)
-                goto finish;
-        if (r > 0) {
-                r = 0; /* don't recurse */
-                goto finish;
-        }
+                /* We generally want to permit crossing of mount boundaries when patching the UIDs/GIDs. However, we
+                 * probably shouldn't do this for /proc and /sys if that is already mounted into place. Hence, let's
+                 * stop the recursion when we hit procfs, sysfs or some other special file systems. */
 
-        /* Also, if we hit a read-only file system, then don't bother, skip the whole subtree */
-        if ((sfs.f_flags & ST_RDONLY) ||
-            access_fd(fd, W_OK) == -EROFS)
-                goto read_only;
+                r = is_fs_fully_userns_compatible(&sfs);
+                if (r < 0)
+                        goto finish;
+                if (r > 0) {
+                        r = 0; /* don't recurse */
+                        goto finish;
+                }
+
+                /* Also, if we hit a read-only file system, then don't bother, skip the whole subtree */
+                if ((sfs.f_flags & ST_RDONLY) ||
+                    access_fd(fd, W_OK) == -EROFS)
+                        goto read_only;
+        }
 
         if (S_ISDIR(st->st_mode)) {
                 struct dirent *de;
@@ -363,7 +371,7 @@ static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift
 
                                 }
 
-                                r = recurse_fd(subdir_fd, true, &fst, shift, false);
+                                r = recurse_fd(subdir_fd, true, &fst, st->st_dev, shift, false);
                                 if (r < 0)
                                         goto finish;
                                 if (r > 0)
@@ -371,6 +379,8 @@ static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift
 
                         } else {
                                 r = patch_fd(dirfd(d), de->d_name, &fst, shift);
+                                if (r == -EROFS)
+                                        goto read_only;
                                 if (r < 0)
                                         goto finish;
                                 if (r > 0)
@@ -396,7 +406,7 @@ read_only:
                 _cleanup_free_ char *name = NULL;
 
                 /* When we hit a ready-only subtree we simply skip it, but log about it. */
-                (void) fd_get_path(fd, &name);
+                (void) fd_get_path(d ? dirfd(d) : fd, &name);
                 log_debug("Skipping read-only file or directory %s.", strna(name));
                 r = changed;
         }
@@ -465,7 +475,7 @@ static int fd_patch_uid_internal(int fd, bool donate_fd, uid_t shift, uid_t rang
                 }
         }
 
-        return recurse_fd(fd, donate_fd, &st, shift, true);
+        return recurse_fd(fd, donate_fd, &st, 0, shift, true);
 
 finish:
         if (donate_fd)
@@ -1,14 +1,140 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "env-util.h"
 #include "fd-util.h"
 #include "group-record-nss.h"
 #include "nss-systemd.h"
+#include "pthread-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "user-record.h"
+#include "user-util.h"
 #include "userdb-glue.h"
 #include "userdb.h"
 
+/* Programs such as ls or ps look up the same few users over and over again, and every lookup means
+ * talking to each userdb service. Hence remember the last results (including negative ones) for a short
+ * time. The cache is flushed whenever a service appears in or disappears from /run/systemd/userdb/. */
+#define USER_CACHE_MAX 16U
+#define USER_CACHE_USEC (1 * USEC_PER_SEC)
+
+typedef struct UserCacheEntry {
+        char *name;          /* set if the user was looked up by name */
+        uid_t uid;           /* set if the user was looked up by UID */
+        UserDBFlags flags;
+        usec_t until;
+        UserRecord *record;  /* NULL if there is no such user */
+} UserCacheEntry;
+
+static struct {
+        pthread_mutex_t mutex;
+        UserCacheEntry entries[USER_CACHE_MAX];
+        ino_t dir_ino;
+        usec_t dir_mtime;
+} user_cache = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void user_cache_entry_done(UserCacheEntry *e) {
+        assert(e);
+
+        free(e->name);
+        user_record_unref(e->record);
+        *e = (UserCacheEntry) {};
+}
+
+static bool user_cache_enabled(void) {
+        /* These change which services are asked, hence bypass the cache when they are used. */
+        return !getenv("SYSTEMD_BYPASS_USERDB") && !getenv("SYSTEMD_ONLY_USERDB");
+}
+
+static void user_cache_validate(usec_t n) {
+        struct stat st = {};
+
+        /* Must be called with the mutex held. */
+
+        (void) stat("/run/systemd/userdb/", &st);
+
+        if (st.st_ino == user_cache.dir_ino && timespec_load(&st.st_mtim) == user_cache.dir_mtime) {
+                for (size_t i = 0; i < USER_CACHE_MAX; i++)
+                        if (user_cache.entries[i].until != 0 && user_cache.entries[i].until <= n)
+                                user_cache_entry_done(user_cache.entries + i);
+                return;
+        }
+
+        for (size_t i = 0; i < USER_CACHE_MAX; i++)
+                user_cache_entry_done(user_cache.entries + i);
+
+        user_cache.dir_ino = st.st_ino;
+        user_cache.dir_mtime = timespec_load(&st.st_mtim);
+}
+
+static int user_cache_get(const char *name, uid_t uid, UserDBFlags flags, UserRecord **ret) {
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+
+        assert(ret);
+
+        if (!user_cache_enabled())
+                return 0;
+
+        _l = pthread_mutex_lock_assert(&user_cache.mutex);
+
+        user_cache_validate(now(CLOCK_MONOTONIC));
+
+        for (size_t i = 0; i < USER_CACHE_MAX; i++) {
+                UserCacheEntry *e = user_cache.entries + i;
+
+                if (e->until == 0 || e->flags != flags)
+                        continue;
+
+                if (name ? !streq_ptr(e->name, name) : (e->name || e->uid != uid))
+                        continue;
+
+                *ret = e->record ? user_record_ref(e->record) : NULL;
+                return 1;
+        }
+
+        return 0;
+}
+
+static void user_cache_put(const char *name, uid_t uid, UserDBFlags flags, UserRecord *hr) {
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = NULL;
+        _cleanup_free_ char *copy = NULL;
+        UserCacheEntry *e = NULL;
+        usec_t n;
+
+        if (!user_cache_enabled())
+                return;
+
+        if (name) {
+                copy = strdup(name);
+                if (!copy)
+                        return;
+        }
+
+        _l = pthread_mutex_lock_assert(&user_cache.mutex);
+
+        n = now(CLOCK_MONOTONIC);
+        user_cache_validate(n);
+
+        /* Take a free slot, or replace the entry that expires first */
+        for (size_t i = 0; i < USER_CACHE_MAX; i++)
+                if (!e || user_cache.entries[i].until < e->until)
+                        e = user_cache.entries + i;
+
+        user_cache_entry_done(e);
+        *e = (UserCacheEntry) {
+                .name = TAKE_PTR(copy),
+                .uid = name ? UID_INVALID : uid,
+                .flags = flags,
+                .until = usec_add(n, USER_CACHE_USEC),
+                .record = hr ? user_record_ref(hr) : NULL,
+        };
+}
+
 UserDBFlags nss_glue_userdb_flags(void) {
         UserDBFlags flags = USERDB_AVOID_NSS;
 
@@ -70,6 +196,7 @@ enum nss_status userdb_getpwnam(
                 int *errnop) {
 
         _cleanup_(user_record_unrefp) UserRecord *hr = NULL;
+        UserDBFlags flags;
         int r;
 
         assert(pwd);
@@ -78,13 +205,20 @@ enum nss_status userdb_getpwnam(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
-        r = userdb_by_name(name, nss_glue_userdb_flags(), &hr);
-        if (r == -ESRCH)
-                return NSS_STATUS_NOTFOUND;
-        if (r < 0) {
+        flags = nss_glue_userdb_flags();
+
+        r = user_cache_get(name, UID_INVALID, flags, &hr);
+        if (r == 0) {
+                r = userdb_by_name(name, flags, &hr);
+                if (r >= 0 || r == -ESRCH)
+                        user_cache_put(name, UID_INVALID, flags, hr);
+        }
+        if (r < 0 && r != -ESRCH) {
                 *errnop = -r;
                 return NSS_STATUS_UNAVAIL;
         }
+        if (!hr)
+                return NSS_STATUS_NOTFOUND;
 
         r = nss_pack_user_record(hr, pwd, buffer, buflen);
         if (r < 0) {
@@ -103,6 +237,7 @@ enum nss_status userdb_getpwuid(
                 int *errnop) {
 
         _cleanup_(user_record_unrefp) UserRecord *hr = NULL;
+        UserDBFlags flags;
         int r;
 
         assert(pwd);
@@ -111,13 +246,20 @@ enum nss_status userdb_getpwuid(
         if (_nss_systemd_is_blocked())
                 return NSS_STATUS_NOTFOUND;
 
-        r = userdb_by_uid(uid, nss_glue_userdb_flags(), &hr);
-        if (r == -ESRCH)
-                return NSS_STATUS_NOTFOUND;
-        if (r < 0) {
+        flags = nss_glue_userdb_flags();
+
+        r = user_cache_get(NULL, uid, flags, &hr);
+        if (r == 0) {
+                r = userdb_by_uid(uid, flags, &hr);
+                if (r >= 0 || r == -ESRCH)
+                        user_cache_put(NULL, uid, flags, hr);
+        }
+        if (r < 0 && r != -ESRCH) {
                 *errnop = -r;
                 return NSS_STATUS_UNAVAIL;
         }
+        if (!hr)
+                return NSS_STATUS_NOTFOUND;
 
         r = nss_pack_user_record(hr, pwd, buffer, buflen);
         if (r < 0) {
@@ -2494,7 +2494,8 @@ static int context_copy_blocks(Context *context) {
                 _cleanup_(loop_device_unrefp) LoopDevice *d = NULL;
                 _cleanup_free_ char *encrypted = NULL;
                 _cleanup_close_ int encrypted_dev_fd = -1;
-                char buf[FORMAT_BYTES_MAX];
+                char buf[FORMAT_BYTES_MAX], ts[FORMAT_TIMESPAN_MAX];
+                usec_t start;
                 int target_fd;
 
                 if (p->copy_blocks_fd < 0)
@@ -2539,7 +2540,11 @@ static int context_copy_blocks(Context *context) {
 
                 log_info("Copying in '%s' (%s) on block level into future partition %" PRIu64 ".", p->copy_blocks_path, format_bytes(buf, sizeof(buf), p->copy_blocks_size), p->partno);
 
-                r = copy_bytes_full(p->copy_blocks_fd, target_fd, p->copy_blocks_size, 0, NULL, NULL, NULL, NULL);
+                start = now(CLOCK_MONOTONIC);
+
+                /* If both the source and the image file are on btrfs, this is just a reflink, and otherwise
+                 * copy_file_range() is used where the kernel supports it. */
+                r = copy_bytes_full(p->copy_blocks_fd, target_fd, p->copy_blocks_size, COPY_REFLINK, NULL, NULL, NULL, NULL);
                 if (r < 0)
                         return log_error_errno(r, "Failed to copy in data from '%s': %m", p->copy_blocks_path);
 
@@ -2561,7 +2566,8 @@ static int context_copy_blocks(Context *context) {
                                 return log_error_errno(r, "Failed to sync loopback device: %m");
                 }
 
-                log_info("Copying in of '%s' on block level completed.", p->copy_blocks_path);
+                log_info("Copying in of '%s' on block level completed in %s.", p->copy_blocks_path,
+                         format_timespan(ts, sizeof(ts), usec_sub_unsigned(now(CLOCK_MONOTONIC), start), USEC_PER_MSEC));
         }
 
         return 0;
@@ -2698,8 +2704,10 @@ static int context_mkfs(Context *context) {
                 _cleanup_(loop_device_unrefp) LoopDevice *d = NULL;
                 _cleanup_free_ char *encrypted = NULL;
                 _cleanup_close_ int encrypted_dev_fd = -1;
+                char ts[FORMAT_TIMESPAN_MAX];
                 const char *fsdev;
                 sd_id128_t fs_uuid;
+                usec_t start;
 
                 if (p->dropped)
                         continue;
@@ -2741,6 +2749,8 @@ static int context_mkfs(Context *context) {
 
                 log_info("Formatting future partition %" PRIu64 ".", p->partno);
 
+                start = now(CLOCK_MONOTONIC);
+
                 /* Calculate the UUID for the file system as HMAC-SHA256 of the string "file-system-uuid",
                  * keyed off the partition UUID. */
                 r = derive_uuid(p->new_uuid, "file-system-uuid", &fs_uuid);
@@ -2754,7 +2764,8 @@ static int context_mkfs(Context *context) {
                         return r;
                 }
 
-                log_info("Successfully formatted future partition %" PRIu64 ".", p->partno);
+                log_info("Successfully formatted future partition %" PRIu64 " in %s.", p->partno,
+                         format_timespan(ts, sizeof(ts), usec_sub_unsigned(now(CLOCK_MONOTONIC), start), USEC_PER_MSEC));
 
                 /* The file system is now created, no need to delay udev further */
                 if (p->encrypt)
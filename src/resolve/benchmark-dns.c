@@ -0,0 +1,183 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <netinet/in.h>
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "resolved-dns-cache.h"
+#include "resolved-dns-packet.h"
+#include "stdio-util.h"
+#include "tests.h"
+
+#define N_NAMES 2048U
+
+typedef struct Context {
+        DnsPacket *reply;
+        DnsPacket *large;
+        DnsCache cache;
+        DnsResourceKey **keys;
+        DnsResourceKey **missing;
+        unsigned next;
+} Context;
+
+static void make_reply(DnsPacket **ret) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *cname = NULL;
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL, *cname_key = NULL;
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        unsigned n;
+
+        /* A typical reply for a name hosted on a CDN: a CNAME, followed by a handful of addresses */
+        assert_se(dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX) >= 0);
+        assert_se(key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, "www.example.com"));
+        assert_se(dns_packet_append_key(p, key, 0, NULL) >= 0);
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+
+        assert_se(cname_key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_CNAME, "www.example.com"));
+        assert_se(cname = dns_resource_record_new(cname_key));
+        cname->ttl = 300;
+        assert_se(cname->cname.name = strdup("www.example.com.cdn.example.net"));
+        assert_se(dns_packet_append_rr(p, cname, 0, NULL, NULL) >= 0);
+
+        for (n = 0; n < 6; n++) {
+                _cleanup_(dns_resource_key_unrefp) DnsResourceKey *k = NULL;
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *a = NULL;
+
+                assert_se(k = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, "www.example.com.cdn.example.net"));
+                assert_se(a = dns_resource_record_new(k));
+                a->ttl = 60;
+                a->a.in_addr.s_addr = htobe32(UINT32_C(0xc0000200) + n);
+                assert_se(dns_packet_append_rr(p, a, 0, NULL, NULL) >= 0);
+        }
+
+        DNS_PACKET_HEADER(p)->ancount = htobe16(n + 1);
+        DNS_PACKET_HEADER(p)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(1, 0, 0, 0, 1, 1, 0, 0, DNS_RCODE_SUCCESS));
+
+        *ret = TAKE_PTR(p);
+}
+
+static void make_reply_large(DnsPacket **ret) {
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        unsigned n;
+
+        /* A large reply: many RRs, all with the owner name of the question */
+        assert_se(dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX) >= 0);
+        assert_se(key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, "many.example.com"));
+        assert_se(dns_packet_append_key(p, key, 0, NULL) >= 0);
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+
+        for (n = 0; n < 200; n++) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *a = NULL;
+
+                assert_se(a = dns_resource_record_new(key));
+                a->ttl = 3600;
+                a->a.in_addr.s_addr = htobe32(UINT32_C(0x0a000000) + n);
+                assert_se(dns_packet_append_rr(p, a, 0, NULL, NULL) >= 0);
+        }
+
+        DNS_PACKET_HEADER(p)->ancount = htobe16(n);
+        DNS_PACKET_HEADER(p)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(1, 0, 0, 0, 1, 1, 0, 0, DNS_RCODE_SUCCESS));
+
+        *ret = TAKE_PTR(p);
+}
+
+static void parse(DnsPacket *reply, uint64_t n, size_t n_answer) {
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+
+                assert_se(dns_packet_new(&p, DNS_PROTOCOL_DNS, reply->size, DNS_PACKET_SIZE_MAX) >= 0);
+
+                /* Like manager_recv() does it */
+                memcpy(DNS_PACKET_DATA(p), DNS_PACKET_DATA(reply), reply->size);
+                p->size = reply->size;
+
+                assert_se(dns_packet_validate_reply(p) > 0);
+                assert_se(dns_packet_extract(p) >= 0);
+                assert_se(dns_answer_size(p->answer) == n_answer);
+        }
+}
+
+static void bench_parse(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        parse(c->reply, n, 7);
+}
+
+static void bench_parse_large(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        parse(c->large, n, 200);
+}
+
+static void bench_lookup(DnsCache *cache, DnsResourceKey **keys, unsigned *next, uint64_t n, bool hit) {
+        for (uint64_t i = 0; i < n; i++, (*next)++) {
+                _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+                bool authenticated;
+                int rcode;
+
+                assert_se(dns_cache_lookup(cache, keys[*next % N_NAMES], false, &rcode, &answer, &authenticated) == hit);
+        }
+}
+
+static void bench_lookup_hit(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        bench_lookup(&c->cache, c->keys, &c->next, n, true);
+}
+
+static void bench_lookup_miss(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        bench_lookup(&c->cache, c->missing, &c->next, n, false);
+}
+
+int main(int argc, char *argv[]) {
+        const union in_addr_union owner = { .in.s_addr = htobe32(UINT32_C(0x0a000001)) };
+        Context c = {};
+
+        test_setup_logging(LOG_INFO);
+
+        make_reply(&c.reply);
+        make_reply_large(&c.large);
+
+        assert_se(c.keys = new0(DnsResourceKey*, N_NAMES));
+        assert_se(c.missing = new0(DnsResourceKey*, N_NAMES));
+
+        for (unsigned i = 0; i < N_NAMES; i++) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+                _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+                char name[STRLEN("host-.example.com") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(name, "host-%u.example.com", i);
+                assert_se(c.keys[i] = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name));
+                assert_se(c.missing[i] = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_AAAA, name));
+
+                assert_se(rr = dns_resource_record_new(c.keys[i]));
+                rr->ttl = 3600;
+                rr->a.in_addr.s_addr = htobe32(UINT32_C(0xc0000200) + i);
+
+                assert_se(answer = dns_answer_new(1));
+                assert_se(dns_answer_add(answer, rr, 0, DNS_ANSWER_CACHEABLE) >= 0);
+
+                assert_se(dns_cache_put(&c.cache, DNS_CACHE_MODE_YES, c.keys[i], DNS_RCODE_SUCCESS, answer, false, 0, 0, AF_INET, &owner) >= 0);
+        }
+
+        assert_se(dns_cache_size(&c.cache) == N_NAMES);
+
+        benchmark_run("dns-packet-parse", bench_parse, &c);
+        benchmark_run("dns-packet-parse-large", bench_parse_large, &c);
+        benchmark_run("dns-cache-lookup-hit", bench_lookup_hit, &c);
+        benchmark_run("dns-cache-lookup-miss", bench_lookup_miss, &c);
+
+        dns_cache_flush(&c.cache);
+        for (unsigned i = 0; i < N_NAMES; i++) {
+                dns_resource_key_unref(c.keys[i]);
+                dns_resource_key_unref(c.missing[i]);
+        }
+        free(c.keys);
+        free(c.missing);
+        dns_packet_unref(c.reply);
+        dns_packet_unref(c.large);
+
+        return 0;
+}
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "resolved-etc-hosts.h"
+#include "tests.h"
+
+#define N_ENTRIES 2000U
+
+typedef struct Context {
+        char *text;
+        size_t size;
+        EtcHosts hosts;
+} Context;
+
+static void parse_one(Context *c, EtcHosts *hosts) {
+        _cleanup_fclose_ FILE *f = NULL;
+
+        assert_se(f = fmemopen_unlocked(c->text, c->size, "r"));
+        assert_se(etc_hosts_parse(hosts, f) == 0);
+        assert_se(hashmap_size(hosts->by_address) == N_ENTRIES);
+}
+
+static void bench_parse_cold(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                EtcHosts hosts = {};
+
+                parse_one(c, &hosts);
+
+                benchmark_pause();
+                etc_hosts_free(&hosts);
+                benchmark_resume();
+        }
+}
+
+static void bench_parse_again(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        /* Like a reload, i.e. with the tables from the previous run as reference for their size */
+        for (uint64_t i = 0; i < n; i++)
+                parse_one(c, &c->hosts);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_fclose_ FILE *f = NULL;
+        Context c = {};
+
+        test_setup_logging(LOG_INFO);
+
+        /* A file as large as the ones on container hosts */
+        assert_se(f = open_memstream_unlocked(&c.text, &c.size));
+        for (unsigned i = 0; i < N_ENTRIES; i++)
+                fprintf(f, "10.%u.%u.%u pod-%u.cluster.local pod-%u # managed\n",
+                        (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF, i, i);
+        assert_se(fflush_and_check(f) >= 0);
+        f = safe_fclose(f);
+
+        parse_one(&c, &c.hosts);
+
+        benchmark_run("etc-hosts-parse-cold", bench_parse_cold, &c);
+        benchmark_run("etc-hosts-parse-again", bench_parse_again, &c);
+
+        etc_hosts_free(&c.hosts);
+        free(c.text);
+
+        return 0;
+}
@@ -8,6 +8,7 @@
 #include "format-util.h"
 #include "resolved-dns-answer.h"
 #include "resolved-dns-cache.h"
+#include "resolved-dns-dnssec.h"
 #include "resolved-dns-packet.h"
 #include "string-util.h"
 
@@ -22,8 +23,10 @@
  * now) */
 #define CACHE_TTL_STRANGE_RCODE_USEC (30 * USEC_PER_SEC)
 
+/* How many cached NSEC/NSEC3 RRs to look at at most when trying to synthesize a negative answer from them */
+#define CACHE_PROOFS_MAX 256U
+
 typedef enum DnsCacheItemType DnsCacheItemType;
-typedef struct DnsCacheItem DnsCacheItem;
 
 enum DnsCacheItemType {
         DNS_CACHE_POSITIVE,
@@ -48,6 +51,8 @@ struct DnsCacheItem {
 
         unsigned prioq_idx;
         LIST_FIELDS(DnsCacheItem, by_key);
+        LIST_FIELDS(DnsCacheItem, by_lru);
+        LIST_FIELDS(DnsCacheItem, proofs);
 };
 
 static const char *dns_cache_item_type_to_string(DnsCacheItem *item) {
@@ -82,6 +87,53 @@ static void dns_cache_item_free(DnsCacheItem *i) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(DnsCacheItem*, dns_cache_item_free);
 
+static void dns_cache_lru_remove(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        if (c->by_lru_tail == i)
+                c->by_lru_tail = i->by_lru_prev;
+
+        LIST_REMOVE(by_lru, c->by_lru, i);
+}
+
+static void dns_cache_lru_prepend(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        LIST_PREPEND(by_lru, c->by_lru, i);
+
+        if (!c->by_lru_tail)
+                c->by_lru_tail = i;
+}
+
+static bool dns_cache_item_is_proof(DnsCacheItem *i) {
+        assert(i);
+
+        return i->authenticated && i->rr && IN_SET(i->rr->key->type, DNS_TYPE_NSEC, DNS_TYPE_NSEC3);
+}
+
+static void dns_cache_proof_remove(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        if (dns_cache_item_is_proof(i))
+                LIST_REMOVE(proofs, c->proofs, i);
+}
+
+static void dns_cache_touch(DnsCache *c, DnsCacheItem *first) {
+        DnsCacheItem *i;
+
+        assert(c);
+
+        /* Marks all items of an RRset as most recently used */
+
+        LIST_FOREACH(by_key, i, first) {
+                dns_cache_lru_remove(c, i);
+                dns_cache_lru_prepend(c, i);
+        }
+}
+
 static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
         DnsCacheItem *first;
 
@@ -99,6 +151,8 @@ static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
                 hashmap_remove(c->by_key, i->key);
 
         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+        dns_cache_lru_remove(c, i);
+        dns_cache_proof_remove(c, i);
 
         dns_cache_item_free(i);
 }
@@ -133,6 +187,8 @@ static bool dns_cache_remove_by_key(DnsCache *c, DnsResourceKey *key) {
 
         LIST_FOREACH_SAFE(by_key, i, n, first) {
                 prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                dns_cache_lru_remove(c, i);
+                dns_cache_proof_remove(c, i);
                 dns_cache_item_free(i);
         }
 
@@ -149,6 +205,8 @@ void dns_cache_flush(DnsCache *c) {
 
         assert(hashmap_size(c->by_key) == 0);
         assert(prioq_size(c->by_expiry) == 0);
+        assert(!c->by_lru && !c->by_lru_tail);
+        assert(!c->proofs);
 
         c->by_key = hashmap_free(c->by_key);
         c->by_expiry = prioq_free(c->by_expiry);
@@ -165,9 +223,15 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
          * add more RRs to the cache than CACHE_MAX at once. In that
          * case the cache will be emptied completely otherwise. */
 
+        if (prioq_size(c->by_expiry) + add < CACHE_MAX)
+                return;
+
+        /* First get rid of everything that expired anyway, then evict the least recently used RRsets, so
+         * that frequently used entries with short TTLs are not pushed out by ones nobody asks for. */
+        dns_cache_prune(c);
+
         for (;;) {
                 _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
-                DnsCacheItem *i;
 
                 if (prioq_size(c->by_expiry) <= 0)
                         break;
@@ -175,12 +239,11 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
                 if (prioq_size(c->by_expiry) + add < CACHE_MAX)
                         break;
 
-                i = prioq_peek(c->by_expiry);
-                assert(i);
+                assert(c->by_lru_tail);
 
                 /* Take an extra reference to the key so that it
                  * doesn't go away in the middle of the remove call */
-                key = dns_resource_key_ref(i->key);
+                key = dns_resource_key_ref(c->by_lru_tail->key);
                 dns_cache_remove_by_key(c, key);
         }
 }
@@ -226,18 +289,13 @@ void dns_cache_prune(DnsCache *c) {
         }
 }
 
-static int dns_cache_item_prioq_compare_func(const void *a, const void *b) {
-        const DnsCacheItem *x = a, *y = b;
-
-        return CMP(x->until, y->until);
-}
-
 static int dns_cache_init(DnsCache *c) {
         int r;
 
         assert(c);
 
-        r = prioq_ensure_allocated(&c->by_expiry, dns_cache_item_prioq_compare_func);
+        /* Ordered by the expiry time, which is passed as key on insertion */
+        r = prioq_ensure_allocated(&c->by_expiry, NULL);
         if (r < 0)
                 return r;
 
@@ -255,7 +313,7 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
         assert(c);
         assert(i);
 
-        r = prioq_put(c->by_expiry, i, &i->prioq_idx);
+        r = prioq_put_with_key(c->by_expiry, i, &i->prioq_idx, i->until);
         if (r < 0)
                 return r;
 
@@ -284,6 +342,11 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
                 }
         }
 
+        dns_cache_lru_prepend(c, i);
+
+        if (dns_cache_item_is_proof(i))
+                LIST_PREPEND(proofs, c->proofs, i);
+
         return 0;
 }
 
@@ -376,7 +439,7 @@ static void dns_cache_item_update_positive(
         i->owner_family = owner_family;
         i->owner_address = *owner_address;
 
-        prioq_reshuffle(c->by_expiry, i, &i->prioq_idx);
+        prioq_reshuffle_with_key(c->by_expiry, i, &i->prioq_idx, i->until);
 }
 
 static int dns_cache_put_positive(
@@ -822,6 +885,82 @@ static DnsCacheItem *dns_cache_get_by_key_follow_cname_dname_nsec(DnsCache *c, D
         return NULL;
 }
 
+static int dns_cache_lookup_proofs(DnsCache *c, DnsResourceKey *key, int *ret_rcode) {
+        _cleanup_(dns_answer_unrefp) DnsAnswer *proofs = NULL;
+        bool authenticated = false;
+        DnssecNsecResult result;
+        const char *name;
+        DnsCacheItem *i;
+        unsigned n = 0;
+        usec_t t = 0;
+        int r;
+
+        assert(c);
+        assert(key);
+        assert(ret_rcode);
+
+        /* Aggressive use of the DNSSEC-validated cache (RFC 8198): if we have validated NSEC/NSEC3 RRs that
+         * prove that the name or type doesn't exist, we can answer negatively without asking upstream. We
+         * don't do this for DS RRs, as they are in the parent zone, see below. */
+
+        if (!c->proofs)
+                return 0;
+
+        if (IN_SET(key->type, DNS_TYPE_DS, DNS_TYPE_NSEC, DNS_TYPE_NSEC3, DNS_TYPE_RRSIG))
+                return 0;
+
+        name = dns_resource_key_name(key);
+
+        LIST_FOREACH(proofs, i, c->proofs) {
+                const char *signer;
+
+                if (n++ >= CACHE_PROOFS_MAX)
+                        break;
+
+                if (t <= 0)
+                        t = now(clock_boottime_or_monotonic());
+
+                if (i->until <= t)
+                        continue;
+
+                if (i->rr->key->class != key->class)
+                        continue;
+
+                /* Only consider RRs of zones the name is in */
+                if (dns_resource_record_signer(i->rr, &signer) < 0)
+                        continue;
+                if (dns_name_endswith(name, signer) <= 0)
+                        continue;
+
+                r = dns_answer_add_extend(&proofs, i->rr, i->ifindex, DNS_ANSWER_AUTHENTICATED);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!proofs)
+                return 0;
+
+        r = dnssec_nsec_test(proofs, key, &result, &authenticated, NULL);
+        if (r < 0)
+                return r;
+        if (!authenticated)
+                return 0;
+
+        switch (result) {
+
+        case DNSSEC_NSEC_NXDOMAIN:
+                *ret_rcode = DNS_RCODE_NXDOMAIN;
+                return 1;
+
+        case DNSSEC_NSEC_NODATA:
+                *ret_rcode = DNS_RCODE_SUCCESS;
+                return 1;
+
+        default:
+                return 0;
+        }
+}
+
 int dns_cache_lookup(DnsCache *c, DnsResourceKey *key, bool clamp_ttl, int *rcode, DnsAnswer **ret, bool *authenticated) {
         _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
         char key_str[DNS_RESOURCE_KEY_STRING_MAX];
@@ -857,6 +996,26 @@ int dns_cache_lookup(DnsCache *c, DnsResourceKey *key, bool clamp_ttl, int *rcod
 
         first = dns_cache_get_by_key_follow_cname_dname_nsec(c, key);
         if (!first) {
+                int proof_rcode;
+
+                r = dns_cache_lookup_proofs(c, key, &proof_rcode);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to check cached NSEC/NSEC3 RRs for %s, ignoring: %m",
+                                        dns_resource_key_to_string(key, key_str, sizeof key_str));
+                if (r > 0) {
+                        log_debug("%s cache hit for %s, synthesized from NSEC/NSEC3 RRs",
+                                  proof_rcode == DNS_RCODE_NXDOMAIN ? "NXDOMAIN" : "NODATA",
+                                  dns_resource_key_to_string(key, key_str, sizeof key_str));
+
+                        c->n_hit++;
+
+                        *ret = NULL;
+                        *rcode = proof_rcode;
+                        *authenticated = true;
+
+                        return 1;
+                }
+
                 /* If one question cannot be answered we need to refresh */
 
                 log_debug("Cache miss for %s",
@@ -871,6 +1030,8 @@ int dns_cache_lookup(DnsCache *c, DnsResourceKey *key, bool clamp_ttl, int *rcod
                 return 0;
         }
 
+        dns_cache_touch(c, first);
+
         LIST_FOREACH(by_key, j, first) {
                 if (j->rr) {
                         if (j->rr->key->type == DNS_TYPE_NSEC)
@@ -7,9 +7,14 @@
 #include "resolve-util.h"
 #include "time-util.h"
 
+typedef struct DnsCacheItem DnsCacheItem;
+
 typedef struct DnsCache {
         Hashmap *by_key;
         Prioq *by_expiry;
+        LIST_HEAD(DnsCacheItem, by_lru); /* most recently used first */
+        DnsCacheItem *by_lru_tail;
+        LIST_HEAD(DnsCacheItem, proofs); /* validated NSEC/NSEC3 RRs, newest first */
         unsigned n_hit;
         unsigned n_miss;
 } DnsCache;
@@ -9,6 +9,7 @@
 #include "memory-util.h"
 #include "resolved-dns-dnssec.h"
 #include "resolved-dns-packet.h"
+#include "siphash24.h"
 #include "sort-util.h"
 #include "string-table.h"
 
@@ -627,6 +628,192 @@ static void dnssec_fix_rrset_ttl(
         rrsig->expiry = rrsig->rrsig.expiration * USEC_PER_SEC;
 }
 
+/* The verdict of a signature check only depends on the signed data, the signature and the key, hence
+ * remember it under a digest of those. This way the same RRset isn't checked again with the same key when
+ * it is seen again on another transaction, e.g. after some dependent RR expired from the cache. */
+#define DNSSEC_VERIFY_CACHE_KEY_SIZE 32U
+#define DNSSEC_VERIFY_CACHE_MAX 4096U
+
+typedef struct DnssecVerifyCacheEntry {
+        uint8_t key[DNSSEC_VERIFY_CACHE_KEY_SIZE];
+        bool valid;
+} DnssecVerifyCacheEntry;
+
+static Hashmap *verify_cache = NULL;
+
+static void verify_cache_entry_hash_func(const DnssecVerifyCacheEntry *e, struct siphash *state) {
+        siphash24_compress(e->key, sizeof(e->key), state);
+}
+
+static int verify_cache_entry_compare_func(const DnssecVerifyCacheEntry *x, const DnssecVerifyCacheEntry *y) {
+        return memcmp(x->key, y->key, sizeof(x->key));
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(verify_cache_hash_ops, DnssecVerifyCacheEntry, verify_cache_entry_hash_func, verify_cache_entry_compare_func, free);
+
+static int dnssec_verify_cache_key(
+                const void *data,
+                size_t size,
+                DnsResourceRecord *rrsig,
+                DnsResourceRecord *dnskey,
+                uint8_t ret[static DNSSEC_VERIFY_CACHE_KEY_SIZE]) {
+
+        _cleanup_(gcry_md_closep) gcry_md_hd_t md = NULL;
+        void *hash;
+
+        assert(data);
+        assert(rrsig);
+        assert(dnskey);
+        assert(ret);
+
+        assert_cc(DNSSEC_VERIFY_CACHE_KEY_SIZE == 256 / 8);
+
+        gcry_md_open(&md, GCRY_MD_SHA256, 0);
+        if (!md)
+                return -EIO;
+
+        /* The signed data includes the RRSIG fields but not the signature itself, hence add that and the
+         * key explicitly */
+        gcry_md_write(md, data, size);
+        gcry_md_write(md, rrsig->rrsig.signature, rrsig->rrsig.signature_size);
+        gcry_md_putc(md, dnskey->dnskey.algorithm);
+        gcry_md_write(md, dnskey->dnskey.key, dnskey->dnskey.key_size);
+
+        hash = gcry_md_read(md, 0);
+        if (!hash)
+                return -EIO;
+
+        memcpy(ret, hash, DNSSEC_VERIFY_CACHE_KEY_SIZE);
+        return 0;
+}
+
+static int dnssec_verify_cache_get(const uint8_t key[static DNSSEC_VERIFY_CACHE_KEY_SIZE]) {
+        DnssecVerifyCacheEntry *e;
+
+        /* Returns > 0 if the signature was found valid before, 0 if it was found invalid, -ENOENT if we
+         * don't know */
+
+        e = hashmap_get(verify_cache, key);
+        if (!e)
+                return -ENOENT;
+
+        return e->valid;
+}
+
+static void dnssec_verify_cache_put(const uint8_t key[static DNSSEC_VERIFY_CACHE_KEY_SIZE], bool valid) {
+        _cleanup_free_ DnssecVerifyCacheEntry *e = NULL;
+
+        /* This is just an optimization, hence failures are silently ignored */
+
+        if (hashmap_ensure_allocated(&verify_cache, &verify_cache_hash_ops) < 0)
+                return;
+
+        /* Make room by dropping an arbitrary entry, which is good enough to keep the cache bounded */
+        if (hashmap_size(verify_cache) >= DNSSEC_VERIFY_CACHE_MAX)
+                free(hashmap_steal_first_key(verify_cache));
+
+        e = new(DnssecVerifyCacheEntry, 1);
+        if (!e)
+                return;
+
+        memcpy(e->key, key, sizeof(e->key));
+        e->valid = valid;
+
+        if (hashmap_put(verify_cache, e, e) < 0)
+                return;
+
+        TAKE_PTR(e);
+}
+
+void dnssec_verify_cache_flush(void) {
+        verify_cache = hashmap_free(verify_cache);
+}
+
+static int dnssec_verify_signature(
+                DnsResourceRecord *rrsig,
+                DnsResourceRecord *dnskey,
+                const void *sig_data,
+                size_t sig_size) {
+
+        _cleanup_(gcry_md_closep) gcry_md_hd_t md = NULL;
+        int r, md_algorithm;
+        size_t hash_size;
+        void *hash;
+
+        assert(rrsig);
+        assert(dnskey);
+        assert(sig_data);
+
+        /* Returns > 0 if the signature is valid, 0 if it is not, -EOPNOTSUPP if the algorithm isn't
+         * supported by us */
+
+        switch (rrsig->rrsig.algorithm) {
+#if GCRYPT_VERSION_NUMBER >= 0x010600
+        case DNSSEC_ALGORITHM_ED25519:
+                break;
+#else
+        case DNSSEC_ALGORITHM_ED25519:
+#endif
+        case DNSSEC_ALGORITHM_ED448:
+                return -EOPNOTSUPP;
+        default:
+                /* Calculate the digest of the signed data */
+                md_algorithm = algorithm_to_gcrypt_md(rrsig->rrsig.algorithm);
+                if (md_algorithm < 0)
+                        return md_algorithm;
+
+                gcry_md_open(&md, md_algorithm, 0);
+                if (!md)
+                        return -EIO;
+
+                hash_size = gcry_md_get_algo_dlen(md_algorithm);
+                assert(hash_size > 0);
+
+                gcry_md_write(md, sig_data, sig_size);
+
+                hash = gcry_md_read(md, 0);
+                if (!hash)
+                        return -EIO;
+        }
+
+        switch (rrsig->rrsig.algorithm) {
+
+        case DNSSEC_ALGORITHM_RSASHA1:
+        case DNSSEC_ALGORITHM_RSASHA1_NSEC3_SHA1:
+        case DNSSEC_ALGORITHM_RSASHA256:
+        case DNSSEC_ALGORITHM_RSASHA512:
+                r = dnssec_rsa_verify(
+                                gcry_md_algo_name(md_algorithm),
+                                hash, hash_size,
+                                rrsig,
+                                dnskey);
+                break;
+
+        case DNSSEC_ALGORITHM_ECDSAP256SHA256:
+        case DNSSEC_ALGORITHM_ECDSAP384SHA384:
+                r = dnssec_ecdsa_verify(
+                                gcry_md_algo_name(md_algorithm),
+                                rrsig->rrsig.algorithm,
+                                hash, hash_size,
+                                rrsig,
+                                dnskey);
+                break;
+#if GCRYPT_VERSION_NUMBER >= 0x010600
+        case DNSSEC_ALGORITHM_ED25519:
+                r = dnssec_eddsa_verify(
+                                rrsig->rrsig.algorithm,
+                                sig_data, sig_size,
+                                rrsig,
+                                dnskey);
+                break;
+#endif
+        default:
+                return -EOPNOTSUPP;
+        }
+
+        return r;
+}
+
 int dnssec_verify_rrset(
                 DnsAnswer *a,
                 const DnsResourceKey *key,
@@ -636,16 +823,14 @@ int dnssec_verify_rrset(
                 DnssecResult *result) {
 
         uint8_t wire_format_name[DNS_WIRE_FORMAT_HOSTNAME_MAX];
+        uint8_t cache_key[DNSSEC_VERIFY_CACHE_KEY_SIZE];
         DnsResourceRecord **list, *rr;
         const char *source, *name;
-        _cleanup_(gcry_md_closep) gcry_md_hd_t md = NULL;
-        int r, md_algorithm;
+        int r;
         size_t k, n = 0;
         size_t sig_size = 0;
         _cleanup_free_ char *sig_data = NULL;
         _cleanup_fclose_ FILE *f = NULL;
-        size_t hash_size;
-        void *hash;
         bool wildcard;
 
         assert(key);
@@ -797,74 +982,22 @@ int dnssec_verify_rrset(
 
         initialize_libgcrypt(false);
 
-        switch (rrsig->rrsig.algorithm) {
-#if GCRYPT_VERSION_NUMBER >= 0x010600
-        case DNSSEC_ALGORITHM_ED25519:
-                break;
-#else
-        case DNSSEC_ALGORITHM_ED25519:
-#endif
-        case DNSSEC_ALGORITHM_ED448:
-                *result = DNSSEC_UNSUPPORTED_ALGORITHM;
-                return 0;
-        default:
-                /* OK, the RRs are now in canonical order. Let's calculate the digest */
-                md_algorithm = algorithm_to_gcrypt_md(rrsig->rrsig.algorithm);
-                if (md_algorithm == -EOPNOTSUPP) {
+        r = dnssec_verify_cache_key(sig_data, sig_size, rrsig, dnskey, cache_key);
+        if (r < 0)
+                return r;
+
+        r = dnssec_verify_cache_get(cache_key);
+        if (r == -ENOENT) {
+                r = dnssec_verify_signature(rrsig, dnskey, sig_data, sig_size);
+                if (r == -EOPNOTSUPP) {
                         *result = DNSSEC_UNSUPPORTED_ALGORITHM;
                         return 0;
                 }
-                if (md_algorithm < 0)
-                        return md_algorithm;
-
-                gcry_md_open(&md, md_algorithm, 0);
-                if (!md)
-                        return -EIO;
-
-                hash_size = gcry_md_get_algo_dlen(md_algorithm);
-                assert(hash_size > 0);
-
-                gcry_md_write(md, sig_data, sig_size);
-
-                hash = gcry_md_read(md, 0);
-                if (!hash)
-                        return -EIO;
-        }
-
-        switch (rrsig->rrsig.algorithm) {
-
-        case DNSSEC_ALGORITHM_RSASHA1:
-        case DNSSEC_ALGORITHM_RSASHA1_NSEC3_SHA1:
-        case DNSSEC_ALGORITHM_RSASHA256:
-        case DNSSEC_ALGORITHM_RSASHA512:
-                r = dnssec_rsa_verify(
-                                gcry_md_algo_name(md_algorithm),
-                                hash, hash_size,
-                                rrsig,
-                                dnskey);
-                break;
+                if (r < 0)
+                        return r;
 
-        case DNSSEC_ALGORITHM_ECDSAP256SHA256:
-        case DNSSEC_ALGORITHM_ECDSAP384SHA384:
-                r = dnssec_ecdsa_verify(
-                                gcry_md_algo_name(md_algorithm),
-                                rrsig->rrsig.algorithm,
-                                hash, hash_size,
-                                rrsig,
-                                dnskey);
-                break;
-#if GCRYPT_VERSION_NUMBER >= 0x010600
-        case DNSSEC_ALGORITHM_ED25519:
-                r = dnssec_eddsa_verify(
-                                rrsig->rrsig.algorithm,
-                                sig_data, sig_size,
-                                rrsig,
-                                dnskey);
-                break;
-#endif
+                dnssec_verify_cache_put(cache_key, r > 0);
         }
-        if (r < 0)
-                return r;
 
         /* Now, fix the ttl, expiry, and remember the synthesizing source and the signer */
         if (r > 0)
@@ -2235,6 +2368,9 @@ int dnssec_test_positive_wildcard(
         return -EOPNOTSUPP;
 }
 
+void dnssec_verify_cache_flush(void) {
+}
+
 #endif
 
 static const char* const dnssec_result_table[_DNSSEC_RESULT_MAX] = {
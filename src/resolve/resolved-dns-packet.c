@@ -176,6 +176,7 @@ static void dns_packet_free(DnsPacket *p) {
         dns_question_unref(p->question);
         dns_answer_unref(p->answer);
         dns_resource_record_unref(p->opt);
+        dns_resource_key_unref(p->last_key);
 
         while ((s = hashmap_steal_first_key(p->names)))
                 free(s);
@@ -372,6 +373,9 @@ void dns_packet_truncate(DnsPacket *p, size_t sz) {
                 free(s);
         }
 
+        if (p->last_key && p->last_key_offset >= sz)
+                p->last_key = dns_resource_key_unref(p->last_key);
+
         p->size = sz;
 }
 
@@ -1563,19 +1567,46 @@ static int dns_packet_read_type_windows(DnsPacket *p, Bitmap **types, size_t siz
         return 0;
 }
 
+static size_t dns_packet_name_offset(DnsPacket *p) {
+        const uint8_t *d;
+
+        assert(p);
+
+        /* Returns the offset the labels of the name at the read index start at, i.e. follows a compression
+         * pointer, if the name is nothing but one. */
+
+        if (p->refuse_compression || p->rindex + 2 > p->size)
+                return p->rindex;
+
+        d = DNS_PACKET_DATA(p) + p->rindex;
+        if ((d[0] & 0xc0) != 0xc0)
+                return p->rindex;
+
+        return ((size_t) (d[0] & ~0xc0) << 8) | d[1];
+}
+
 int dns_packet_read_key(DnsPacket *p, DnsResourceKey **ret, bool *ret_cache_flush, size_t *start) {
         _cleanup_(rewind_dns_packet) DnsPacketRewinder rewinder;
         _cleanup_free_ char *name = NULL;
-        bool cache_flush = false;
+        bool cache_flush = false, same_name;
         uint16_t class, type;
         DnsResourceKey *key;
+        size_t offset;
         int r;
 
         assert(p);
         assert(ret);
         INIT_REWINDER(rewinder, p);
 
-        r = dns_packet_read_name(p, &name, true, NULL);
+        /* A pointer to where the name of the previous key starts, which is necessarily before us? Then
+         * the name is the same, and there's no need to decompress it again. */
+        offset = dns_packet_name_offset(p);
+        same_name = p->last_key && offset == p->last_key_offset && offset < p->rindex;
+
+        if (same_name)
+                r = dns_packet_read(p, 2, NULL, NULL);
+        else
+                r = dns_packet_read_name(p, &name, true, NULL);
         if (r < 0)
                 return r;
 
@@ -1596,11 +1627,24 @@ int dns_packet_read_key(DnsPacket *p, DnsResourceKey **ret, bool *ret_cache_flus
                 }
         }
 
-        key = dns_resource_key_new_consume(class, type, name);
-        if (!key)
-                return -ENOMEM;
+        if (!same_name) {
+                key = dns_resource_key_new_consume(class, type, name);
+                if (!key)
+                        return -ENOMEM;
+
+                name = NULL;
+        } else if (p->last_key->class == class && p->last_key->type == type)
+                key = dns_resource_key_ref(p->last_key);
+        else {
+                key = dns_resource_key_new(class, type, dns_resource_key_name(p->last_key));
+                if (!key)
+                        return -ENOMEM;
+        }
+
+        dns_resource_key_unref(p->last_key);
+        p->last_key = dns_resource_key_ref(key);
+        p->last_key_offset = offset;
 
-        name = NULL;
         *ret = key;
 
         if (ret_cache_flush)
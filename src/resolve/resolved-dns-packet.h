@@ -65,6 +65,11 @@ struct DnsPacket {
         DnsAnswer *answer;
         DnsResourceRecord *opt;
 
+        /* The key read last, and the offset its name starts at. RRs that refer to the same name via
+         * compression, as most RRs in a reply do, share the key instead of decompressing the name again. */
+        DnsResourceKey *last_key;
+        size_t last_key_offset;
+
         /* Packet reception metadata */
         int ifindex;
         int family, ipproto;
@@ -70,6 +70,7 @@ struct DnsStream {
 
         LIST_HEAD(DnsTransaction, transactions); /* when used by the transaction logic */
         DnsServer *server;                       /* when used by the transaction logic */
+        unsigned n_replies;                      /* when used by the transaction logic */
         Set *queries;                            /* when used by the DNS stub logic */
 
         /* used when DNS-over-TLS is enabled */
@@ -1,18 +1,280 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include "alloc-util.h"
 #include "errno-util.h"
 #include "fd-util.h"
 #include "missing_network.h"
 #include "resolved-dns-stub.h"
+#include "siphash24.h"
 #include "socket-util.h"
+#include "unaligned.h"
 
 /* The MTU of the loopback device is 64K on Linux, advertise that as maximum datagram size, but subtract the Ethernet,
  * IP and UDP header sizes */
 #define ADVERTISE_DATAGRAM_SIZE_MAX (65536U-14U-20U-8U)
 
+/* How many UDP queries to read per wakeup at most, so that bursts of queries are handled without an epoll
+ * round-trip each, while still letting other event sources (e.g. upstream replies) run in between */
+#define DNS_STUB_UDP_BATCH_MAX 32U
+
+/* Queue up to 1M of queries in the socket before the kernel starts to drop them on busy systems */
+#define DNS_STUB_UDP_RCVBUF_SIZE (1U*1024U*1024U)
+
+/* Successful UDP replies are kept in pre-serialized form for a short while, keyed by the raw request (minus
+ * the transaction ID), so that clients repeating the same lookup in quick succession are answered without
+ * parsing the request or building a new reply. The lifetime is kept below the granularity of DNS TTLs so
+ * that the TTLs in the cached reply never need to be corrected. */
+#define DNS_STUB_REPLY_CACHE_USEC (1 * USEC_PER_SEC)
+#define DNS_STUB_REPLY_CACHE_MAX 1024U
+#define DNS_STUB_REPLY_CACHE_REQUEST_SIZE_MAX DNS_PACKET_UNICAST_SIZE_MAX
+
+typedef struct DnsStubReply {
+        uint8_t *request;       /* The request, starting right after the transaction ID */
+        size_t request_size;
+        DnsPacket *reply;
+        usec_t until;
+} DnsStubReply;
+
 static int manager_dns_stub_udp_fd(Manager *m);
 static int manager_dns_stub_tcp_fd(Manager *m);
 
+static DnsStubReply* dns_stub_reply_free(DnsStubReply *r) {
+        if (!r)
+                return NULL;
+
+        dns_packet_unref(r->reply);
+        free(r->request);
+        return mfree(r);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(DnsStubReply*, dns_stub_reply_free);
+
+static void dns_stub_reply_hash_func(const DnsStubReply *r, struct siphash *state) {
+        assert(r);
+
+        siphash24_compress(&r->request_size, sizeof(r->request_size), state);
+        siphash24_compress(r->request, r->request_size, state);
+}
+
+static int dns_stub_reply_compare_func(const DnsStubReply *x, const DnsStubReply *y) {
+        int r;
+
+        r = CMP(x->request_size, y->request_size);
+        if (r != 0)
+                return r;
+
+        return memcmp(x->request, y->request, x->request_size);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(dns_stub_reply_hash_ops, DnsStubReply, dns_stub_reply_hash_func, dns_stub_reply_compare_func, dns_stub_reply_free);
+
+static bool dns_stub_skip_name(const uint8_t *d, size_t size, size_t *offset) {
+        size_t i;
+
+        assert(d);
+        assert(offset);
+
+        for (i = *offset;;) {
+                uint8_t c;
+
+                if (i >= size)
+                        return false;
+
+                c = d[i];
+                if (c == 0) {
+                        *offset = i + 1;
+                        return true;
+                }
+                if ((c & 0xC0) == 0xC0) {
+                        /* A compression pointer terminates the name */
+                        if (i + 2 > size)
+                                return false;
+
+                        *offset = i + 2;
+                        return true;
+                }
+                if ((c & 0xC0) != 0)
+                        return false;
+
+                i += 1 + c;
+        }
+}
+
+static bool dns_stub_reply_cacheable(DnsPacket *reply, uint16_t type, usec_t *ret_usec) {
+        const uint8_t *d;
+        uint32_t ttl_min = UINT32_MAX;
+        bool found = false;
+        size_t offset;
+        unsigned n;
+
+        assert(reply);
+        assert(ret_usec);
+
+        /* Only cache replies that carry an answer of the requested type, whose RRs may all be cached for at
+         * least a second. Looks at the wire format directly, as that's what we'll hand out later. */
+
+        if (DNS_PACKET_TC(reply) ||
+            DNS_PACKET_RCODE(reply) != DNS_RCODE_SUCCESS ||
+            DNS_PACKET_QDCOUNT(reply) != 1 ||
+            DNS_PACKET_ANCOUNT(reply) == 0)
+                return false;
+
+        d = DNS_PACKET_DATA(reply);
+        offset = DNS_PACKET_HEADER_SIZE;
+
+        if (!dns_stub_skip_name(d, reply->size, &offset))
+                return false;
+        offset += 4; /* type + class */
+
+        for (n = 0; n < DNS_PACKET_ANCOUNT(reply); n++) {
+                uint16_t rr_type, rdlength;
+                uint32_t ttl;
+
+                if (!dns_stub_skip_name(d, reply->size, &offset))
+                        return false;
+                if (offset + 10 > reply->size)
+                        return false;
+
+                rr_type = unaligned_read_be16(d + offset);
+                ttl = unaligned_read_be32(d + offset + 4);
+                rdlength = unaligned_read_be16(d + offset + 8);
+
+                if (ttl == 0)
+                        return false;
+
+                if (rr_type == type)
+                        found = true;
+
+                ttl_min = MIN(ttl_min, ttl);
+                offset += 10 + rdlength;
+        }
+
+        if (!found || offset > reply->size)
+                return false;
+
+        *ret_usec = MIN(ttl_min * USEC_PER_SEC, DNS_STUB_REPLY_CACHE_USEC);
+        return true;
+}
+
+static void dns_stub_reply_cache_prune(Manager *m, usec_t ts) {
+        DnsStubReply *e;
+        Iterator i;
+
+        assert(m);
+
+        HASHMAP_FOREACH_KEY(e, e, m->dns_stub_reply_cache, i)
+                if (e->until <= ts)
+                        dns_stub_reply_free(hashmap_remove(m->dns_stub_reply_cache, e));
+}
+
+static void dns_stub_reply_cache_put(DnsQuery *q) {
+        _cleanup_(dns_stub_reply_freep) DnsStubReply *e = NULL;
+        DnsPacket *p;
+        Manager *m;
+        usec_t ts, usec;
+        int r;
+
+        assert(q);
+
+        m = q->manager;
+        p = q->request_dns_packet;
+
+        /* TCP clients are rare and don't repeat themselves much, and DNSSEC-aware requests depend on more
+         * state than what is encoded in the reply. */
+        if (q->request_dns_stream ||
+            DNS_PACKET_DO(p) ||
+            p->size <= 2 ||
+            p->size > DNS_STUB_REPLY_CACHE_REQUEST_SIZE_MAX ||
+            dns_question_size(q->question_idna) != 1)
+                return;
+
+        if (!dns_stub_reply_cacheable(q->reply_dns_packet, q->question_idna->keys[0]->type, &usec))
+                return;
+
+        assert_se(sd_event_now(m->event, clock_boottime_or_monotonic(), &ts) >= 0);
+
+        if (hashmap_size(m->dns_stub_reply_cache) >= DNS_STUB_REPLY_CACHE_MAX) {
+                dns_stub_reply_cache_prune(m, ts);
+
+                if (hashmap_size(m->dns_stub_reply_cache) >= DNS_STUB_REPLY_CACHE_MAX)
+                        return;
+        }
+
+        e = new(DnsStubReply, 1);
+        if (!e)
+                return (void) log_oom();
+
+        *e = (DnsStubReply) {
+                .request = memdup(DNS_PACKET_DATA(p) + 2, p->size - 2),
+                .request_size = p->size - 2,
+                .reply = dns_packet_ref(q->reply_dns_packet),
+                .until = usec_add(ts, usec),
+        };
+        if (!e->request)
+                return (void) log_oom();
+
+        /* Replace an older entry for the same request, which might exist if two identical queries were in
+         * flight at the same time */
+        dns_stub_reply_free(hashmap_remove(m->dns_stub_reply_cache, e));
+
+        r = hashmap_ensure_allocated(&m->dns_stub_reply_cache, &dns_stub_reply_hash_ops);
+        if (r < 0)
+                return (void) log_oom();
+
+        r = hashmap_put(m->dns_stub_reply_cache, e, e);
+        if (r < 0)
+                return (void) log_debug_errno(r, "Failed to cache stub reply, ignoring: %m");
+
+        TAKE_PTR(e);
+}
+
+static int dns_stub_reply_cache_answer(Manager *m, DnsPacket *p) {
+        DnsStubReply *e, key;
+        usec_t ts;
+        int fd, r;
+
+        assert(m);
+        assert(p);
+
+        if (hashmap_isempty(m->dns_stub_reply_cache) ||
+            p->size <= 2 ||
+            p->size > DNS_STUB_REPLY_CACHE_REQUEST_SIZE_MAX)
+                return 0;
+
+        if (in_addr_is_localhost(p->family, &p->sender) <= 0 ||
+            in_addr_is_localhost(p->family, &p->destination) <= 0)
+                return 0;
+
+        key = (DnsStubReply) {
+                .request = DNS_PACKET_DATA(p) + 2,
+                .request_size = p->size - 2,
+        };
+
+        e = hashmap_get(m->dns_stub_reply_cache, &key);
+        if (!e)
+                return 0;
+
+        assert_se(sd_event_now(m->event, clock_boottime_or_monotonic(), &ts) >= 0);
+        if (e->until <= ts) {
+                dns_stub_reply_free(hashmap_remove(m->dns_stub_reply_cache, e));
+                return 0;
+        }
+
+        fd = manager_dns_stub_udp_fd(m);
+        if (fd < 0)
+                return log_debug_errno(fd, "Failed to get reply socket: %m");
+
+        /* The cached reply is only referenced by us, hence patch the ID in place */
+        DNS_PACKET_HEADER(e->reply)->id = DNS_PACKET_ID(p);
+
+        r = manager_send(m, fd, LOOPBACK_IFINDEX, p->family, &p->sender, p->sender_port, &p->destination, e->reply);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to send cached reply packet: %m");
+
+        log_debug("Answered DNS stub UDP query for id %u from reply cache.", DNS_PACKET_ID(p));
+        return 1;
+}
+
 static int dns_stub_make_reply_packet(
                 DnsPacket **p,
                 size_t max_size,
@@ -218,6 +480,8 @@ static void dns_stub_query_complete(DnsQuery *q) {
                         break;
                 }
 
+                dns_stub_reply_cache_put(q);
+
                 (void) dns_stub_send(q->manager, q->request_dns_stream, q->request_dns_packet, q->reply_dns_packet);
                 break;
         }
@@ -368,20 +632,28 @@ static void dns_stub_process_query(Manager *m, DnsStream *s, DnsPacket *p) {
 }
 
 static int on_dns_stub_packet(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
-        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
         Manager *m = userdata;
         int r;
 
-        r = manager_recv(m, fd, DNS_PROTOCOL_DNS, &p);
-        if (r <= 0)
-                return r;
+        for (unsigned n = 0; n < DNS_STUB_UDP_BATCH_MAX; n++) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
 
-        if (dns_packet_validate_query(p) > 0) {
-                log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+                r = manager_recv(m, fd, DNS_PROTOCOL_DNS, &p);
+                if (r == -EAGAIN && n > 0)
+                        break;
+                if (r <= 0)
+                        return r;
 
-                dns_stub_process_query(m, NULL, p);
-        } else
-                log_debug("Invalid DNS stub UDP packet, ignoring.");
+                if (dns_packet_validate_query(p) > 0) {
+                        log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+
+                        if (dns_stub_reply_cache_answer(m, p) != 0)
+                                continue;
+
+                        dns_stub_process_query(m, NULL, p);
+                } else
+                        log_debug("Invalid DNS stub UDP packet, ignoring.");
+        }
 
         return 0;
 }
@@ -414,6 +686,10 @@ static int manager_dns_stub_udp_fd(Manager *m) {
         if (r < 0)
                 return r;
 
+        r = fd_inc_rcvbuf(fd, DNS_STUB_UDP_RCVBUF_SIZE);
+        if (r < 0)
+                log_debug_errno(r, "Failed to increase receive buffer of DNS stub UDP socket, ignoring: %m");
+
         /* Make sure no traffic from outside the local host can leak to onto this socket */
         r = socket_bind_to_ifindex(fd, LOOPBACK_IFINDEX);
         if (r < 0)
@@ -575,4 +851,12 @@ void manager_dns_stub_stop(Manager *m) {
 
         m->dns_stub_udp_fd = safe_close(m->dns_stub_udp_fd);
         m->dns_stub_tcp_fd = safe_close(m->dns_stub_tcp_fd);
+
+        m->dns_stub_reply_cache = hashmap_free(m->dns_stub_reply_cache);
+}
+
+void manager_dns_stub_flush_cache(Manager *m) {
+        assert(m);
+
+        hashmap_clear(m->dns_stub_reply_cache);
 }
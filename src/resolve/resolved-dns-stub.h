@@ -5,3 +5,4 @@
 
 void manager_dns_stub_stop(Manager *m);
 int manager_dns_stub_start(Manager *m);
+void manager_dns_stub_flush_cache(Manager *m);
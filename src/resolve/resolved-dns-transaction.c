@@ -14,6 +14,7 @@
 #include "resolved-dnstls.h"
 #include "resolved-llmnr.h"
 #include "string-table.h"
+#include "usdt.h"
 
 #define TRANSACTIONS_MAX 4096
 #define TRANSACTION_TCP_TIMEOUT_USEC (10U*USEC_PER_SEC)
@@ -46,9 +47,112 @@ static void dns_transaction_flush_dnssec_transactions(DnsTransaction *t) {
         }
 }
 
+static void dns_transaction_upstream_hash_func(const DnsTransaction *t, struct siphash *state) {
+        int ifindex;
+
+        assert(t);
+        assert(t->server);
+
+        dns_resource_key_hash_ops.hash(t->key, state);
+        siphash24_compress(&t->scope, sizeof(t->scope), state);
+        siphash24_compress(&t->server->family, sizeof(t->server->family), state);
+        siphash24_compress(&t->server->address, FAMILY_ADDRESS_SIZE(t->server->family), state);
+        siphash24_compress(&t->server->port, sizeof(t->server->port), state);
+        ifindex = dns_server_ifindex(t->server);
+        siphash24_compress(&ifindex, sizeof(ifindex), state);
+        siphash24_compress(&t->current_feature_level, sizeof(t->current_feature_level), state);
+}
+
+static int dns_transaction_upstream_compare_func(const DnsTransaction *x, const DnsTransaction *y) {
+        int r;
+
+        /* Two transactions are considered equivalent if they'd send the very same packet (modulo the
+         * transaction ID) to the very same server, on behalf of the same scope. Servers configured for
+         * different links are never the same, even if their addresses match: the answer might be
+         * specific to the link it was received on. */
+
+        r = CMP(x->scope, y->scope);
+        if (r != 0)
+                return r;
+
+        r = CMP(x->server->family, y->server->family);
+        if (r != 0)
+                return r;
+
+        r = memcmp(&x->server->address, &y->server->address, FAMILY_ADDRESS_SIZE(x->server->family));
+        if (r != 0)
+                return r;
+
+        r = CMP(x->server->port, y->server->port);
+        if (r != 0)
+                return r;
+
+        r = CMP(dns_server_ifindex(x->server), dns_server_ifindex(y->server));
+        if (r != 0)
+                return r;
+
+        r = CMP(x->current_feature_level, y->current_feature_level);
+        if (r != 0)
+                return r;
+
+        /* This controls the CD bit */
+        r = CMP(x->scope->dnssec_mode != DNSSEC_NO, y->scope->dnssec_mode != DNSSEC_NO);
+        if (r != 0)
+                return r;
+
+        return dns_resource_key_hash_ops.compare(x->key, y->key);
+}
+
+DEFINE_PRIVATE_HASH_OPS(dns_transaction_upstream_hash_ops, DnsTransaction, dns_transaction_upstream_hash_func, dns_transaction_upstream_compare_func);
+
+static void dns_transaction_unpublish(DnsTransaction *t) {
+        Manager *m;
+
+        assert(t);
+
+        /* Make sure nobody else coalesces with our query anymore */
+
+        if (!t->server || !t->scope)
+                return;
+
+        m = t->scope->manager;
+        if (set_get(m->dns_transactions_in_flight, t) == t)
+                set_remove(m->dns_transactions_in_flight, t);
+}
+
+static void dns_transaction_stop_coalescing(DnsTransaction *t) {
+        DnsTransaction *f;
+        usec_t ts;
+
+        assert(t);
+
+        if (t->coalesced_leader) {
+                set_remove(t->coalesced_leader->coalesced_followers, t);
+                t->coalesced_leader = NULL;
+        }
+
+        dns_transaction_unpublish(t);
+
+        if (set_isempty(t->coalesced_followers))
+                return;
+
+        /* We won't get a reply to our query anymore, hence make everybody who waited for it time out right
+         * away, so that they send their own. */
+        assert_se(sd_event_now(t->scope->manager->event, clock_boottime_or_monotonic(), &ts) >= 0);
+
+        while ((f = set_steal_first(t->coalesced_followers))) {
+                f->coalesced_leader = NULL;
+
+                if (f->timeout_event_source)
+                        (void) sd_event_source_set_time(f->timeout_event_source, ts);
+        }
+}
+
 static void dns_transaction_close_connection(DnsTransaction *t) {
         assert(t);
 
+        dns_transaction_stop_coalescing(t);
+
         if (t->stream) {
                 /* Let's detach the stream from our transaction, in case something else keeps a reference to it. */
                 LIST_REMOVE(transactions_by_stream, t->stream->transactions, t);
@@ -122,6 +226,8 @@ DnsTransaction* dns_transaction_free(DnsTransaction *t) {
         dns_transaction_flush_dnssec_transactions(t);
         set_free(t->dnssec_transactions);
 
+        set_free(t->coalesced_followers);
+
         dns_answer_unref(t->validated_keys);
         dns_resource_key_unref(t->key);
 
@@ -225,6 +331,8 @@ int dns_transaction_new(DnsTransaction **ret, DnsScope *s, DnsResourceKey *key)
 
         s->manager->n_transactions_total++;
 
+        USDT(resolved, transaction_new, t, t->id, dns_resource_key_name(t->key), t->key->type, s->protocol);
+
         if (ret)
                 *ret = t;
 
@@ -337,6 +445,8 @@ void dns_transaction_complete(DnsTransaction *t, DnsTransactionState state) {
                   t->answer_source < 0 ? "none" : dns_transaction_source_to_string(t->answer_source),
                   t->answer_authenticated ? "authenticated" : "unsigned");
 
+        USDT(resolved, transaction_complete, t, t->id, state, t->answer_rcode, t->answer_source);
+
         t->state = state;
 
         dns_transaction_close_connection(t);
@@ -450,7 +560,7 @@ static int dns_transaction_maybe_restart(DnsTransaction *t) {
         return 1;
 }
 
-static void on_transaction_stream_error(DnsTransaction *t, int error) {
+static void on_transaction_stream_error(DnsTransaction *t, int error, bool next_server) {
         assert(t);
 
         dns_transaction_close_connection(t);
@@ -463,7 +573,7 @@ static void on_transaction_stream_error(DnsTransaction *t, int error) {
                         return;
                 }
 
-                dns_transaction_retry(t, true);
+                dns_transaction_retry(t, next_server);
                 return;
         }
         if (error != 0) {
@@ -502,16 +612,27 @@ static int dns_transaction_on_stream_packet(DnsTransaction *t, DnsPacket *p) {
 }
 
 static int on_stream_complete(DnsStream *s, int error) {
+        bool next_server = true;
+
         assert(s);
 
         if (ERRNO_IS_DISCONNECT(error) && s->protocol != DNS_PROTOCOL_LLMNR) {
-                log_debug_errno(error, "Connection failure for DNS TCP stream: %m");
+                if (s->n_replies > 0) {
+                        /* Servers close long-lived connections they consider idle, which we might only notice
+                         * once we queued the next query on it. That's not a failure of the server, hence
+                         * don't degrade it, and retry on a new connection to the same server. */
+                        log_debug_errno(error, "DNS TCP stream that served %u replies was closed, retrying on a new connection: %m", s->n_replies);
+                        next_server = false;
+
+                } else {
+                        log_debug_errno(error, "Connection failure for DNS TCP stream: %m");
 
-                if (s->transactions) {
-                        DnsTransaction *t;
+                        if (s->transactions) {
+                                DnsTransaction *t;
 
-                        t = s->transactions;
-                        dns_server_packet_lost(t->server, IPPROTO_TCP, t->current_feature_level);
+                                t = s->transactions;
+                                dns_server_packet_lost(t->server, IPPROTO_TCP, t->current_feature_level);
+                        }
                 }
         }
 
@@ -519,7 +640,7 @@ static int on_stream_complete(DnsStream *s, int error) {
                 DnsTransaction *t, *n;
 
                 LIST_FOREACH_SAFE(transactions_by_stream, t, n, s->transactions)
-                        on_transaction_stream_error(t, error);
+                        on_transaction_stream_error(t, error, next_server);
         }
 
         return 0;
@@ -535,9 +656,13 @@ static int on_stream_packet(DnsStream *s) {
         p = dns_stream_take_read_packet(s);
         assert(p);
 
+        /* Many transactions may be pipelined on the same stream, find the one this reply is for. Only
+         * accept replies for transactions that were actually sent on this stream though. */
         t = hashmap_get(s->manager->dns_transactions, UINT_TO_PTR(DNS_PACKET_ID(p)));
-        if (t)
+        if (t && t->stream == s) {
+                s->n_replies++;
                 return dns_transaction_on_stream_packet(t, p);
+        }
 
         /* Ignore incorrect transaction id as an old transaction can have been canceled. */
         log_debug("Received unexpected TCP reply packet with id %" PRIu16 ", ignoring.", DNS_PACKET_ID(p));
@@ -661,6 +786,7 @@ static int dns_transaction_emit_tcp(DnsTransaction *t) {
         dns_transaction_reset_answer(t);
 
         t->tried_stream = true;
+        t->coalesced = false;
 
         return 0;
 }
@@ -908,6 +1034,8 @@ void dns_transaction_process_reply(DnsTransaction *t, DnsPacket *p) {
         log_debug("Processing incoming packet on transaction %" PRIu16" (rcode=%s).",
                   t->id, dns_rcode_to_string(DNS_PACKET_RCODE(p)));
 
+        USDT(resolved, transaction_reply, t, t->id, DNS_PACKET_RCODE(p), p->size);
+
         switch (t->scope->protocol) {
 
         case DNS_PROTOCOL_LLMNR:
@@ -1175,7 +1303,7 @@ fail:
 
 static int on_dns_packet(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
-        DnsTransaction *t = userdata;
+        DnsTransaction *t = userdata, *f;
         int r;
 
         assert(t);
@@ -1219,10 +1347,81 @@ static int on_dns_packet(sd_event_source *s, int fd, uint32_t revents, void *use
                 return 0;
         }
 
+        /* First pass the reply on to everybody who coalesced with us, since processing it ourselves might
+         * free us or make us send another query. */
+        dns_transaction_unpublish(t);
+
+        t->block_gc++;
+        while ((f = set_steal_first(t->coalesced_followers))) {
+                f->coalesced_leader = NULL;
+                dns_transaction_process_reply(f, p);
+        }
+        t->block_gc--;
+
+        if (!dns_transaction_gc(t))
+                return 0;
+
         dns_transaction_process_reply(t, p);
         return 0;
 }
 
+static int dns_transaction_coalesce(DnsTransaction *t) {
+        DnsTransaction *leader;
+        int r;
+
+        assert(t);
+        assert(t->server);
+
+        /* Check if some other scope currently asks the same server the same question. If so, don't send
+         * our own packet, but wait for the reply to that one. This avoids sending the same query many
+         * times if the same server is configured on multiple links. */
+
+        leader = set_get(t->scope->manager->dns_transactions_in_flight, t);
+        if (!leader || leader == t)
+                return 0;
+
+        r = set_ensure_allocated(&leader->coalesced_followers, NULL);
+        if (r < 0)
+                return r;
+
+        r = set_put(leader->coalesced_followers, t);
+        if (r < 0)
+                return r;
+
+        dns_transaction_close_connection(t);
+        t->coalesced_leader = leader;
+        t->coalesced = true;
+
+        log_debug("Transaction %" PRIu16 " coalesced with transaction %" PRIu16 " on scope %s/%s.",
+                  t->id, leader->id,
+                  leader->scope->link ? leader->scope->link->ifname : "*",
+                  af_to_name_short(leader->scope->family));
+
+        return 1;
+}
+
+static void dns_transaction_publish(DnsTransaction *t) {
+        Manager *m;
+        int r;
+
+        assert(t);
+        assert(t->server);
+
+        /* Allow transactions on other scopes to coalesce with the query we just sent */
+
+        m = t->scope->manager;
+
+        r = set_ensure_allocated(&m->dns_transactions_in_flight, &dns_transaction_upstream_hash_ops);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to allocate in-flight transaction set, ignoring: %m");
+                return;
+        }
+
+        r = set_put(m->dns_transactions_in_flight, t);
+        if (r < 0 && r != -EEXIST)
+                log_debug_errno(r, "Failed to register transaction %" PRIu16 " as in flight, ignoring: %m", t->id);
+}
+
 static int dns_transaction_emit_udp(DnsTransaction *t) {
         int r;
 
@@ -1230,6 +1429,9 @@ static int dns_transaction_emit_udp(DnsTransaction *t) {
 
         if (t->scope->protocol == DNS_PROTOCOL_DNS) {
 
+                /* Picking the server might change our identity in the in-flight set, hence leave it first */
+                dns_transaction_stop_coalescing(t);
+
                 r = dns_transaction_pick_server(t);
                 if (r < 0)
                         return r;
@@ -1240,6 +1442,14 @@ static int dns_transaction_emit_udp(DnsTransaction *t) {
                 if (!dns_server_dnssec_supported(t->server) && dns_type_is_dnssec(t->key->type))
                         return -EOPNOTSUPP;
 
+                r = dns_transaction_coalesce(t);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        dns_transaction_reset_answer(t);
+                        return 0;
+                }
+
                 if (r > 0 || t->dns_udp_fd < 0) { /* Server changed, or no connection yet. */
                         int fd;
 
@@ -1271,22 +1481,32 @@ static int dns_transaction_emit_udp(DnsTransaction *t) {
 
         dns_transaction_reset_answer(t);
 
+        t->coalesced = false;
+        if (t->scope->protocol == DNS_PROTOCOL_DNS)
+                dns_transaction_publish(t);
+
         return 0;
 }
 
 static int on_transaction_timeout(sd_event_source *s, usec_t usec, void *userdata) {
         DnsTransaction *t = userdata;
+        bool coalesced;
 
         assert(s);
         assert(t);
 
+        /* If we didn't send the query ourselves, the server didn't lose anything of ours, and we should give
+         * it a try on our own before moving on to the next one. */
+        coalesced = t->coalesced;
+
         if (!t->initial_jitter_scheduled || t->initial_jitter_elapsed) {
                 /* Timeout reached? Increase the timeout for the server used */
                 switch (t->scope->protocol) {
 
                 case DNS_PROTOCOL_DNS:
                         assert(t->server);
-                        dns_server_packet_lost(t->server, t->stream ? IPPROTO_TCP : IPPROTO_UDP, t->current_feature_level);
+                        if (!coalesced)
+                                dns_server_packet_lost(t->server, t->stream ? IPPROTO_TCP : IPPROTO_UDP, t->current_feature_level);
                         break;
 
                 case DNS_PROTOCOL_LLMNR:
@@ -1304,7 +1524,7 @@ static int on_transaction_timeout(sd_event_source *s, usec_t usec, void *userdat
 
         log_debug("Timeout reached on transaction %" PRIu16 ".", t->id);
 
-        dns_transaction_retry(t, true);
+        dns_transaction_retry(t, !coalesced);
         return 0;
 }
 
@@ -1649,6 +1869,8 @@ int dns_transaction_go(DnsTransaction *t) {
         if (r <= 0)
                 return r;
 
+        USDT(resolved, transaction_go, t, t->id, t->n_attempts);
+
         log_debug("Transaction %" PRIu16 " for <%s> scope %s on %s/%s.",
                   t->id,
                   dns_resource_key_to_string(t->key, key_str, sizeof key_str),
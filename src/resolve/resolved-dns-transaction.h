@@ -63,6 +63,9 @@ struct DnsTransaction {
 
         bool probing:1;
 
+        /* Set when the last attempt was not sent by us, but piggybacked on a coalesced_leader */
+        bool coalesced:1;
+
         DnsPacket *sent, *received;
 
         DnsAnswer *answer;
@@ -128,6 +131,11 @@ struct DnsTransaction {
          * created in order to request DNSKEY or DS RRs. */
         Set *dnssec_transactions;
 
+        /* If a transaction on another scope already asks the same server the same question via UDP, we
+         * don't send our own packet, but are handed the reply to its packet instead. */
+        DnsTransaction *coalesced_leader;
+        Set *coalesced_followers;
+
         unsigned block_gc;
 
         LIST_FIELDS(DnsTransaction, transactions_by_scope);
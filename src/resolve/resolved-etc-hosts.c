@@ -4,11 +4,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hostname-util.h"
 #include "resolved-dns-synthesize.h"
 #include "resolved-etc-hosts.h"
+#include "siphash24.h"
 #include "socket-netlink.h"
 #include "string-util.h"
 #include "strv.h"
@@ -167,6 +169,28 @@ int etc_hosts_parse(EtcHosts *hosts, FILE *f) {
         unsigned nr = 0;
         int r;
 
+        /* The new tables will most likely end up as large as the old ones, hence size them accordingly right
+         * away, instead of growing and rehashing them over and over again while parsing */
+        if (!hashmap_isempty(hosts->by_address)) {
+                r = hashmap_ensure_allocated(&t.by_address, &in_addr_data_hash_ops);
+                if (r < 0)
+                        return log_oom();
+
+                r = hashmap_reserve(t.by_address, hashmap_size(hosts->by_address));
+                if (r < 0)
+                        return log_oom();
+        }
+
+        if (!hashmap_isempty(hosts->by_name)) {
+                r = hashmap_ensure_allocated(&t.by_name, &dns_name_hash_ops);
+                if (r < 0)
+                        return log_oom();
+
+                r = hashmap_reserve(t.by_name, hashmap_size(hosts->by_name));
+                if (r < 0)
+                        return log_oom();
+        }
+
         for (;;) {
                 _cleanup_free_ char *line = NULL;
                 char *l;
@@ -198,8 +222,36 @@ int etc_hosts_parse(EtcHosts *hosts, FILE *f) {
         return 0;
 }
 
+static int etc_hosts_digest(FILE *f, uint64_t *ret) {
+        struct siphash state;
+
+        assert(f);
+        assert(ret);
+
+        /* This is only used to detect whether the contents changed, hence a fixed key is fine */
+        siphash24_init(&state, (const uint8_t[16]) {});
+
+        for (;;) {
+                char buf[16U*1024U];
+                size_t n;
+
+                n = fread(buf, 1, sizeof(buf), f);
+                siphash24_compress(buf, n, &state);
+
+                if (n < sizeof(buf)) {
+                        if (ferror(f))
+                                return errno_or_else(EIO);
+                        break;
+                }
+        }
+
+        *ret = siphash24_finalize(&state);
+        return 0;
+}
+
 static int manager_etc_hosts_read(Manager *m) {
         _cleanup_fclose_ FILE *f = NULL;
+        uint64_t digest;
         struct stat st;
         usec_t ts;
         int r;
@@ -242,9 +294,24 @@ static int manager_etc_hosts_read(Manager *m) {
         if (r < 0)
                 return log_error_errno(errno, "Failed to fstat() /etc/hosts: %m");
 
-        r = etc_hosts_parse(&m->etc_hosts, f);
+        /* Tools that manage /etc/hosts tend to rewrite it in full even if nothing changed. Parsing is
+         * comparatively expensive for large files though, hence check whether the contents are actually
+         * different before doing that. */
+        r = etc_hosts_digest(f, &digest);
         if (r < 0)
-                return r;
+                return log_error_errno(r, "Failed to read /etc/hosts: %m");
+
+        if (m->etc_hosts_mtime != USEC_INFINITY && digest == m->etc_hosts_digest)
+                log_debug("/etc/hosts was modified, but its contents did not change, not parsing it again.");
+        else {
+                rewind(f);
+
+                r = etc_hosts_parse(&m->etc_hosts, f);
+                if (r < 0)
+                        return r;
+
+                m->etc_hosts_digest = digest;
+        }
 
         m->etc_hosts_mtime = timespec_load(&st.st_mtim);
         m->etc_hosts_ino = st.st_ino;
@@ -550,6 +550,18 @@ static int manager_sigusr2(sd_event_source *s, const struct signalfd_siginfo *si
         return 0;
 }
 
+static int manager_memory_pressure(sd_event_source *s, void *userdata) {
+        Manager *m = userdata;
+
+        assert(s);
+        assert(m);
+
+        log_debug("Under memory pressure, flushing caches.");
+        manager_flush_caches(m);
+
+        return 0;
+}
+
 static int manager_sigrtmin1(sd_event_source *s, const struct signalfd_siginfo *si, void *userdata) {
         Manager *m = userdata;
 
@@ -648,6 +660,10 @@ int manager_new(Manager **ret) {
         (void) sd_event_add_signal(m->event, &m->sigusr2_event_source, SIGUSR2, manager_sigusr2, m);
         (void) sd_event_add_signal(m->event, &m->sigrtmin1_event_source, SIGRTMIN+1, manager_sigrtmin1, m);
 
+        r = sd_event_add_memory_pressure(m->event, &m->memory_pressure_event_source, manager_memory_pressure, m);
+        if (r < 0)
+                log_debug_errno(r, "Failed to watch for memory pressure, ignoring: %m");
+
         manager_cleanup_saved_user(m);
 
         *ret = TAKE_PTR(m);
@@ -701,6 +717,7 @@ Manager *manager_free(Manager *m) {
 
         hashmap_free(m->links);
         hashmap_free(m->dns_transactions);
+        set_free(m->dns_transactions_in_flight);
 
         sd_event_source_unref(m->network_event_source);
         sd_network_monitor_unref(m->network_monitor);
@@ -720,6 +737,7 @@ Manager *manager_free(Manager *m) {
         sd_event_source_unref(m->sigusr1_event_source);
         sd_event_source_unref(m->sigusr2_event_source);
         sd_event_source_unref(m->sigrtmin1_event_source);
+        sd_event_source_unref(m->memory_pressure_event_source);
 
         sd_event_unref(m->event);
 
@@ -741,6 +759,7 @@ Manager *manager_free(Manager *m) {
 
         dns_trust_anchor_flush(&m->trust_anchor);
         manager_etc_hosts_flush(m);
+        dnssec_verify_cache_flush();
 
         return mfree(m);
 }
@@ -1444,6 +1463,9 @@ void manager_flush_caches(Manager *m) {
         LIST_FOREACH(scopes, scope, m->dns_scopes)
                 dns_cache_flush(&scope->cache);
 
+        manager_dns_stub_flush_cache(m);
+        dnssec_verify_cache_flush();
+
         log_info("Flushed all caches.");
 }
 
@@ -56,6 +56,7 @@ struct Manager {
 
         /* DNS query management */
         Hashmap *dns_transactions;
+        Set *dns_transactions_in_flight; /* UDP transactions others may coalesce with */
         LIST_HEAD(DnsQuery, dns_queries);
         unsigned n_dns_queries;
 
@@ -122,6 +123,7 @@ struct Manager {
         sd_event_source *sigusr1_event_source;
         sd_event_source *sigusr2_event_source;
         sd_event_source *sigrtmin1_event_source;
+        sd_event_source *memory_pressure_event_source;
 
         unsigned n_transactions_total;
         unsigned n_dnssec_verdict[_DNSSEC_VERDICT_MAX];
@@ -131,6 +133,7 @@ struct Manager {
         usec_t etc_hosts_last, etc_hosts_mtime;
         ino_t etc_hosts_ino;
         dev_t etc_hosts_dev;
+        uint64_t etc_hosts_digest;
         bool read_etc_hosts;
 
         /* Local DNS stub on 127.0.0.53:53 */
@@ -140,6 +143,9 @@ struct Manager {
         sd_event_source *dns_stub_udp_event_source;
         sd_event_source *dns_stub_tcp_event_source;
 
+        /* Recently sent stub replies, see resolved-dns-stub.c */
+        Hashmap *dns_stub_reply_cache;
+
         Hashmap *polkit_registry;
 
         VarlinkServer *varlink_server;
@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "hexdecoct.h"
+#include "resolved-dns-cache.h"
+#include "resolved-dns-dnssec.h"
+#include "string-util.h"
+#include "tests.h"
+
+#if HAVE_GCRYPT
+
+#define TTL 3600U
+#define SHA1_HASH_SIZE 20
+
+static DnsResourceRecord* nsec_new(const char *name, const char *next, unsigned n_skip_labels_signer, unsigned n_skip_labels_source, ...) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+        va_list ap;
+        int type;
+
+        rr = dns_resource_record_new_full(DNS_CLASS_IN, DNS_TYPE_NSEC, name);
+        assert_se(rr);
+
+        rr->ttl = TTL;
+        rr->nsec.next_domain_name = strdup(next);
+        assert_se(rr->nsec.next_domain_name);
+        rr->nsec.types = bitmap_new();
+        assert_se(rr->nsec.types);
+
+        va_start(ap, n_skip_labels_source);
+        while ((type = va_arg(ap, int)) > 0)
+                assert_se(bitmap_set(rr->nsec.types, type) >= 0);
+        va_end(ap);
+
+        /* Normally set when the RRSIG is verified */
+        rr->n_skip_labels_signer = n_skip_labels_signer;
+        rr->n_skip_labels_source = n_skip_labels_source;
+
+        return TAKE_PTR(rr);
+}
+
+/* An NSEC3 RR for the apex of 'zone' whose range spans the whole zone: it proves that the zone exists and
+ * covers the hashes of all other names in it, including the wildcard. */
+static DnsResourceRecord* nsec3_new(const char *zone, uint8_t flags) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+        _cleanup_free_ char *b = NULL, *name = NULL;
+        uint8_t h[DNSSEC_HASH_SIZE_MAX];
+        int k;
+
+        rr = dns_resource_record_new_full(DNS_CLASS_IN, DNS_TYPE_NSEC3, zone);
+        assert_se(rr);
+
+        rr->ttl = TTL;
+        rr->nsec3.algorithm = DNSSEC_DIGEST_SHA1;
+        rr->nsec3.flags = flags;
+        rr->nsec3.iterations = 1;
+        assert_se(rr->nsec3.next_hashed_name = new0(uint8_t, SHA1_HASH_SIZE));
+        rr->nsec3.next_hashed_name_size = SHA1_HASH_SIZE;
+
+        k = dnssec_nsec3_hash(rr, zone, &h);
+        assert_se(k == SHA1_HASH_SIZE);
+        memcpy(rr->nsec3.next_hashed_name, h, k);
+
+        assert_se(b = base32hexmem(h, k, false));
+        assert_se(name = strjoin(b, ".", zone));
+        dns_resource_key_unref(rr->key);
+        assert_se(rr->key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_NSEC3, name));
+
+        assert_se(rr->nsec3.types = bitmap_new());
+        assert_se(bitmap_set(rr->nsec3.types, DNS_TYPE_SOA) >= 0);
+        assert_se(bitmap_set(rr->nsec3.types, DNS_TYPE_NS) >= 0);
+        assert_se(bitmap_set(rr->nsec3.types, DNS_TYPE_A) >= 0);
+        assert_se(bitmap_set(rr->nsec3.types, DNS_TYPE_RRSIG) >= 0);
+
+        rr->n_skip_labels_signer = 1;
+        rr->n_skip_labels_source = 0;
+
+        return TAKE_PTR(rr);
+}
+
+static void cache_put(DnsCache *c, usec_t timestamp, DnsResourceRecord *rr) {
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+
+        assert_se(answer = dns_answer_new(1));
+        assert_se(dns_answer_add(answer, rr, 0, DNS_ANSWER_AUTHENTICATED|DNS_ANSWER_CACHEABLE) >= 0);
+
+        /* Without a key, only the RRs themselves are cached, as for mDNS. */
+        assert_se(dns_cache_put(c, DNS_CACHE_MODE_YES, NULL, DNS_RCODE_SUCCESS, answer, true, (uint32_t) -1,
+                                timestamp, AF_INET, &(union in_addr_union) {}) >= 0);
+}
+
+static int lookup(DnsCache *c, uint16_t type, const char *name, int *ret_rcode) {
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        bool authenticated;
+        int r;
+
+        assert_se(key = dns_resource_key_new(DNS_CLASS_IN, type, name));
+
+        r = dns_cache_lookup(c, key, false, ret_rcode, &answer, &authenticated);
+        assert_se(r >= 0);
+        assert_se(!answer);
+        assert_se(r == 0 || authenticated);
+
+        return r;
+}
+
+static void test_proofs_nsec(void) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *apex = NULL, *b = NULL;
+        DnsCache c = {};
+        int rcode;
+
+        log_info("/* %s */", __func__);
+
+        /* example.com → b.example.com, covering "a" and the wildcard; b.example.com → x.c.example.com,
+         * covering the empty non-terminal "c". */
+        apex = nsec_new("example.com", "b.example.com", 0, 0,
+                        DNS_TYPE_SOA, DNS_TYPE_NS, DNS_TYPE_A, DNS_TYPE_RRSIG, DNS_TYPE_NSEC, DNS_TYPE_DNSKEY, 0);
+        b = nsec_new("b.example.com", "x.c.example.com", 1, 0,
+                     DNS_TYPE_A, DNS_TYPE_RRSIG, DNS_TYPE_NSEC, 0);
+        cache_put(&c, 0, apex);
+        cache_put(&c, 0, b);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.com", &rcode) == 1);
+        assert_se(rcode == DNS_RCODE_NXDOMAIN);
+        assert_se(lookup(&c, DNS_TYPE_AAAA, "a.b.example.com", &rcode) == 1);
+        assert_se(rcode == DNS_RCODE_NXDOMAIN);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "c.example.com", &rcode) == 1);
+        assert_se(rcode == DNS_RCODE_SUCCESS);
+
+        /* Names past the end of the chain, and names of other zones */
+        assert_se(lookup(&c, DNS_TYPE_A, "z.example.com", &rcode) == 0);
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.org", &rcode) == 0);
+
+        /* DS RRs live in the parent zone, we never synthesize answers for them */
+        assert_se(lookup(&c, DNS_TYPE_DS, "a.example.com", &rcode) == 0);
+
+        dns_cache_flush(&c);
+}
+
+static void test_proofs_wildcard(void) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *apex = NULL, *wildcard = NULL;
+        DnsCache c = {};
+        int rcode;
+
+        log_info("/* %s */", __func__);
+
+        /* "a" does not exist, but the wildcard does, hence we must not claim NXDOMAIN */
+        apex = nsec_new("example.com", "*.example.com", 0, 0,
+                        DNS_TYPE_SOA, DNS_TYPE_NS, DNS_TYPE_RRSIG, DNS_TYPE_NSEC, DNS_TYPE_DNSKEY, 0);
+        wildcard = nsec_new("*.example.com", "b.example.com", 1, 1,
+                            DNS_TYPE_A, DNS_TYPE_RRSIG, DNS_TYPE_NSEC, 0);
+        cache_put(&c, 0, apex);
+        cache_put(&c, 0, wildcard);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.com", &rcode) == 0);
+
+        dns_cache_flush(&c);
+}
+
+static void test_proofs_nsec3(void) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL, *optout = NULL;
+        DnsCache c = {};
+        int rcode;
+
+        log_info("/* %s */", __func__);
+
+        rr = nsec3_new("example.com", 0);
+        cache_put(&c, 0, rr);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.com", &rcode) == 1);
+        assert_se(rcode == DNS_RCODE_NXDOMAIN);
+
+        dns_cache_flush(&c);
+
+        /* With opt-out there may be unsigned delegations the NSEC3 RR doesn't tell us about */
+        optout = nsec3_new("example.com", 1);
+        cache_put(&c, 0, optout);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.com", &rcode) == 0);
+
+        dns_cache_flush(&c);
+}
+
+static void test_proofs_expired(void) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *apex = NULL;
+        DnsCache c = {};
+        int rcode;
+
+        log_info("/* %s */", __func__);
+
+        apex = nsec_new("example.com", "b.example.com", 0, 0,
+                        DNS_TYPE_SOA, DNS_TYPE_NS, DNS_TYPE_A, DNS_TYPE_RRSIG, DNS_TYPE_NSEC, DNS_TYPE_DNSKEY, 0);
+        cache_put(&c, now(clock_boottime_or_monotonic()) - 2 * TTL * USEC_PER_SEC, apex);
+
+        assert_se(lookup(&c, DNS_TYPE_A, "a.example.com", &rcode) == 0);
+
+        dns_cache_flush(&c);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_DEBUG);
+
+#if HAVE_GCRYPT
+        test_proofs_nsec();
+        test_proofs_wildcard();
+        test_proofs_nsec3();
+        test_proofs_expired();
+#endif
+
+        return 0;
+}
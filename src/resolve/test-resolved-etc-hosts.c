@@ -127,6 +127,40 @@ static void test_parse_etc_hosts(void) {
         assert_se(!set_contains(hosts.no_address, "foobar.foo.foo"));
 }
 
+#define N_ENTRIES 2000U
+
+static void test_parse_etc_hosts_large(void) {
+        _cleanup_(unlink_tempfilep) char
+                t[] = "/tmp/test-resolved-etc-hosts-large.XXXXXX";
+        _cleanup_(etc_hosts_free) EtcHosts hosts = {};
+        _cleanup_fclose_ FILE *f = NULL;
+        int fd;
+
+        log_info("/* %s */", __func__);
+
+        /* Parse a generated file twice, the second time with the tables from the first run as reference
+         * for their size */
+
+        fd = mkostemp_safe(t);
+        assert_se(fd >= 0);
+
+        f = fdopen(fd, "r+");
+        assert_se(f);
+
+        for (unsigned i = 0; i < N_ENTRIES; i++)
+                fprintf(f, "10.%u.%u.%u pod-%u.cluster.local pod-%u # managed\n",
+                        (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF, i, i);
+        assert_se(fflush_and_check(f) >= 0);
+
+        for (unsigned k = 0; k < 2; k++) {
+                rewind(f);
+
+                assert_se(etc_hosts_parse(&hosts, f) == 0);
+                assert_se(hashmap_size(hosts.by_address) == N_ENTRIES);
+                assert_se(hashmap_size(hosts.by_name) == 2 * N_ENTRIES);
+        }
+}
+
 static void test_parse_file(const char *fname) {
         _cleanup_(etc_hosts_free) EtcHosts hosts = {};
         _cleanup_fclose_ FILE *f;
@@ -143,6 +177,7 @@ int main(int argc, char **argv) {
         if (argc == 1) {
                 test_parse_etc_hosts_system();
                 test_parse_etc_hosts();
+                test_parse_etc_hosts_large();
         } else
                 test_parse_file(argv[1]);
 
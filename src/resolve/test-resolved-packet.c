@@ -23,10 +23,48 @@ static void test_dns_packet_new(void) {
         assert_se(dns_packet_new(&p2, DNS_PROTOCOL_DNS, DNS_PACKET_SIZE_MAX + 1, DNS_PACKET_SIZE_MAX) == -EFBIG);
 }
 
+static void test_dns_packet_extract_shared_keys(void) {
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        DnsResourceRecord *rr, *previous = NULL;
+        unsigned n;
+
+        /* A typical large reply: many RRs, all with the owner name of the question */
+
+        assert_se(dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX) >= 0);
+        assert_se(key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, "many.example.com"));
+        assert_se(dns_packet_append_key(p, key, 0, NULL) >= 0);
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+
+        for (n = 0; n < 200; n++) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *a = NULL;
+
+                assert_se(a = dns_resource_record_new(key));
+                a->ttl = 3600;
+                a->a.in_addr.s_addr = htobe32(UINT32_C(0x0a000000) + n);
+                assert_se(dns_packet_append_rr(p, a, 0, NULL, NULL) >= 0);
+        }
+        DNS_PACKET_HEADER(p)->ancount = htobe16(n);
+        DNS_PACKET_HEADER(p)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(1, 0, 0, 0, 1, 1, 0, 0, DNS_RCODE_SUCCESS));
+
+        assert_se(dns_packet_extract(p) >= 0);
+        assert_se(dns_question_size(p->question) == 1);
+        assert_se(dns_answer_size(p->answer) == n);
+
+        /* All RRs refer to the question name via a compression pointer, hence should share one key */
+        DNS_ANSWER_FOREACH(rr, p->answer) {
+                assert_se(dns_resource_key_equal(rr->key, key) > 0);
+                assert_se(rr->key == p->question->keys[0]);
+                assert_se(!previous || previous->key == rr->key);
+                previous = rr;
+        }
+}
+
 int main(int argc, char **argv) {
         test_setup_logging(LOG_DEBUG);
 
         test_dns_packet_new();
+        test_dns_packet_extract_shared_keys();
 
         return 0;
 }
@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "env-util.h"
+#include "json.h"
+#include "log.h"
+#include "parse-util.h"
+#include "sort-util.h"
+#include "time-util.h"
+
+#define BENCHMARK_SAMPLES_MAX 100000U
+
+static bool arg_initialized = false;
+static unsigned arg_samples = 25;
+static unsigned arg_warmup = 3;
+static usec_t arg_sample_time = 10 * USEC_PER_MSEC;
+static const char *arg_filter = NULL;
+static bool arg_json = false;
+
+static nsec_t paused_since = 0;
+static nsec_t paused_total = 0;
+
+static void parse_unsigned_env(const char *name, unsigned *value, unsigned min) {
+        const char *e;
+        unsigned u;
+
+        e = getenv(name);
+        if (!e)
+                return;
+
+        if (safe_atou(e, &u) < 0 || u < min || u > BENCHMARK_SAMPLES_MAX) {
+                log_warning("Failed to parse $%s, ignoring: %s", name, e);
+                return;
+        }
+
+        *value = u;
+}
+
+static void benchmark_parse_env(void) {
+        const char *e;
+        int r;
+
+        if (arg_initialized)
+                return;
+
+        parse_unsigned_env("SYSTEMD_BENCHMARK_SAMPLES", &arg_samples, 1);
+        parse_unsigned_env("SYSTEMD_BENCHMARK_WARMUP", &arg_warmup, 0);
+
+        e = getenv("SYSTEMD_BENCHMARK_SAMPLE_TIME");
+        if (e) {
+                usec_t t;
+
+                if (parse_sec(e, &t) < 0 || t == 0 || t == USEC_INFINITY)
+                        log_warning("Failed to parse $SYSTEMD_BENCHMARK_SAMPLE_TIME, ignoring: %s", e);
+                else
+                        arg_sample_time = t;
+        }
+
+        arg_filter = getenv("SYSTEMD_BENCHMARK_FILTER");
+
+        r = getenv_bool("SYSTEMD_BENCHMARK_JSON");
+        if (r >= 0)
+                arg_json = r;
+        else if (r != -ENXIO)
+                log_warning_errno(r, "Failed to parse $SYSTEMD_BENCHMARK_JSON, ignoring: %m");
+
+        arg_initialized = true;
+}
+
+static nsec_t measure(benchmark_func_t func, void *userdata, uint64_t n) {
+        nsec_t start, t;
+
+        paused_total = 0;
+
+        start = now_nsec(CLOCK_MONOTONIC);
+        func(userdata, n);
+        t = now_nsec(CLOCK_MONOTONIC) - start;
+
+        assert(paused_since == 0);
+        assert(paused_total <= t);
+
+        return t - paused_total;
+}
+
+void benchmark_pause(void) {
+        assert(paused_since == 0);
+
+        paused_since = now_nsec(CLOCK_MONOTONIC);
+}
+
+void benchmark_resume(void) {
+        assert(paused_since > 0);
+
+        paused_total += now_nsec(CLOCK_MONOTONIC) - paused_since;
+        paused_since = 0;
+}
+
+static uint64_t calibrate(benchmark_func_t func, void *userdata) {
+        nsec_t target = arg_sample_time * NSEC_PER_USEC;
+        uint64_t n = 1;
+
+        /* Find the number of operations that takes roughly the target time. Start with a single one, and
+         * then extrapolate from the time the last attempt took, growing by at most 100x at a time so that a
+         * slow first call (cold caches, lazy initialization) doesn't make us overshoot too much. */
+        for (;;) {
+                nsec_t t;
+                uint64_t m;
+
+                t = measure(func, userdata, n);
+                if (t >= target / 2 || n >= UINT64_MAX / 100)
+                        return n;
+
+                m = t > 0 ? (uint64_t) ((double) n * target / t) : n * 100;
+                n = CLAMP(m, n * 2, n * 100);
+        }
+}
+
+static double percentile(const double *sorted, size_t n, unsigned p) {
+        size_t i;
+
+        assert(sorted);
+        assert(n > 0);
+        assert(p <= 100);
+
+        /* Nearest rank */
+        i = DIV_ROUND_UP(n * p, 100U);
+        return sorted[i > 0 ? i - 1 : 0];
+}
+
+static int cmp_double(const double *a, const double *b) {
+        return CMP(*a, *b);
+}
+
+static void benchmark_print(const BenchmarkResult *r) {
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+        int k;
+
+        assert(r);
+
+        if (!arg_json) {
+                printf("%-40s %10.1f ns/op  (min %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f; %" PRIu64 " samples of %" PRIu64 " ops)\n",
+                       r->name, r->mean, r->min, r->p50, r->p90, r->p99, r->max, r->n_samples, r->n_per_sample);
+                fflush(stdout);
+                return;
+        }
+
+        k = json_build(&v, JSON_BUILD_OBJECT(
+                                       JSON_BUILD_PAIR("name", JSON_BUILD_STRING(r->name)),
+                                       JSON_BUILD_PAIR("samples", JSON_BUILD_UNSIGNED(r->n_samples)),
+                                       JSON_BUILD_PAIR("opsPerSample", JSON_BUILD_UNSIGNED(r->n_per_sample)),
+                                       JSON_BUILD_PAIR("minNsec", JSON_BUILD_REAL(r->min)),
+                                       JSON_BUILD_PAIR("meanNsec", JSON_BUILD_REAL(r->mean)),
+                                       JSON_BUILD_PAIR("p50Nsec", JSON_BUILD_REAL(r->p50)),
+                                       JSON_BUILD_PAIR("p90Nsec", JSON_BUILD_REAL(r->p90)),
+                                       JSON_BUILD_PAIR("p99Nsec", JSON_BUILD_REAL(r->p99)),
+                                       JSON_BUILD_PAIR("maxNsec", JSON_BUILD_REAL(r->max))));
+        if (k < 0) {
+                log_error_errno(k, "Failed to format benchmark result as JSON: %m");
+                return;
+        }
+
+        json_variant_dump(v, JSON_FORMAT_NEWLINE|JSON_FORMAT_FLUSH, stdout, NULL);
+}
+
+int benchmark_run_full(const char *name, benchmark_func_t func, void *userdata, BenchmarkResult *ret) {
+        _cleanup_free_ double *samples = NULL;
+        BenchmarkResult result;
+        double sum = 0;
+        uint64_t n;
+
+        assert(name);
+        assert(func);
+
+        benchmark_parse_env();
+
+        if (arg_filter && fnmatch(arg_filter, name, 0) != 0)
+                return 0;
+
+        samples = new(double, arg_samples);
+        if (!samples)
+                return log_oom();
+
+        n = calibrate(func, userdata);
+
+        for (unsigned i = 0; i < arg_warmup; i++)
+                (void) measure(func, userdata, n);
+
+        for (unsigned i = 0; i < arg_samples; i++) {
+                samples[i] = (double) measure(func, userdata, n) / n;
+                sum += samples[i];
+        }
+
+        typesafe_qsort(samples, arg_samples, cmp_double);
+
+        result = (BenchmarkResult) {
+                .name = name,
+                .n_samples = arg_samples,
+                .n_per_sample = n,
+                .min = samples[0],
+                .mean = sum / arg_samples,
+                .p50 = percentile(samples, arg_samples, 50),
+                .p90 = percentile(samples, arg_samples, 90),
+                .p99 = percentile(samples, arg_samples, 99),
+                .max = samples[arg_samples - 1],
+        };
+
+        benchmark_print(&result);
+
+        if (ret)
+                *ret = result;
+
+        return 1;
+}
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "macro.h"
+
+/* A minimal harness for micro benchmarks. The function passed to benchmark_run() is expected to execute the
+ * operation under test 'n' times. The harness calibrates 'n' so that a single sample takes long enough to be
+ * measured reliably, runs a few warmup samples, and then reports the distribution of the time per operation
+ * over the measured samples.
+ *
+ * The following environment variables are honoured:
+ *
+ *     $SYSTEMD_BENCHMARK_SAMPLES      — number of measured samples (default: 25)
+ *     $SYSTEMD_BENCHMARK_WARMUP       — number of samples to run and discard first (default: 3)
+ *     $SYSTEMD_BENCHMARK_SAMPLE_TIME  — target duration of one sample (default: 10ms)
+ *     $SYSTEMD_BENCHMARK_FILTER       — only run benchmarks whose name matches this glob
+ *     $SYSTEMD_BENCHMARK_JSON         — if true, print one JSON object per benchmark instead of text
+ */
+
+typedef struct BenchmarkResult {
+        const char *name;
+        uint64_t n_samples;
+        uint64_t n_per_sample;
+        double min, mean, p50, p90, p99, max; /* nanoseconds per operation */
+} BenchmarkResult;
+
+typedef void (*benchmark_func_t)(void *userdata, uint64_t n);
+
+/* Returns > 0 if the benchmark was run, and 0 if it was skipped because it doesn't match the filter */
+int benchmark_run_full(const char *name, benchmark_func_t func, void *userdata, BenchmarkResult *ret);
+static inline int benchmark_run(const char *name, benchmark_func_t func, void *userdata) {
+        return benchmark_run_full(name, func, userdata, NULL);
+}
+
+/* Exclude the time between the two calls from the measurement, e.g. to prepare the input of the next
+ * operation from within the benchmarked function */
+void benchmark_pause(void);
+void benchmark_resume(void);
+
+/* Makes sure the compiler doesn't optimize away the computation of a value that is otherwise unused */
+#define BENCHMARK_KEEP(x)                                       \
+        do {                                                    \
+                __asm__ __volatile__("" : : "g" (x) : "memory"); \
+        } while (false)
@@ -6,6 +6,8 @@
 #include "bus-util.h"
 #include "log.h"
 #include "sd-bus.h"
+#include "sd-event.h"
+#include "strv.h"
 #include "syslog-util.h"
 
 int bus_property_get_log_level(
@@ -94,12 +96,109 @@ int bus_property_set_log_target(
 
 BUS_DEFINE_PROPERTY_GET_GLOBAL(bus_property_get_syslog_identifier, "s", program_invocation_short_name);
 
+int bus_property_get_event_statistics(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        sd_event *e;
+
+        assert(bus);
+        assert(reply);
+
+        e = sd_bus_get_event(bus);
+
+        return sd_bus_message_append(reply, "b", e && sd_event_get_statistics(e) > 0);
+}
+
+int bus_property_set_event_statistics(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *value,
+                void *userdata,
+                sd_bus_error *error) {
+
+        sd_event *e;
+        int b, r;
+
+        assert(bus);
+        assert(value);
+
+        r = sd_bus_message_read(value, "b", &b);
+        if (r < 0)
+                return r;
+
+        e = sd_bus_get_event(bus);
+        if (!e)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_NOT_SUPPORTED, "Bus connection is not attached to an event loop");
+
+        log_info("%s event loop statistics.", b ? "Enabling" : "Disabling");
+        return sd_event_set_statistics(e, b);
+}
+
+int bus_method_get_event_statistics(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **keys = NULL;
+        sd_event *e;
+        char **k;
+        int r;
+
+        assert(message);
+
+        e = sd_bus_get_event(sd_bus_message_get_bus(message));
+        if (e) {
+                r = sd_event_list_statistics(e, &keys);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sttttt)");
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(k, keys) {
+                uint64_t n, total, max, latency_total, latency_max;
+
+                r = sd_event_get_source_statistics(e, *k, &n, &total, &max, &latency_total, &latency_max);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(reply, "(sttttt)", *k, n, total, max, latency_total, latency_max);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static const sd_bus_vtable log_control_vtable[] = {
         SD_BUS_VTABLE_START(0),
 
         SD_BUS_WRITABLE_PROPERTY("LogLevel", "s", bus_property_get_log_level, bus_property_set_log_level, 0, 0),
         SD_BUS_WRITABLE_PROPERTY("LogTarget", "s", bus_property_get_log_target, bus_property_set_log_target, 0, 0),
         SD_BUS_PROPERTY("SyslogIdentifier", "s", bus_property_get_syslog_identifier, 0, 0),
+        SD_BUS_WRITABLE_PROPERTY("EventStatistics", "b", bus_property_get_event_statistics, bus_property_set_event_statistics, 0, 0),
+
+        SD_BUS_METHOD_WITH_NAMES("GetEventStatistics",
+                                 NULL,,
+                                 "a(sttttt)",
+                                 SD_BUS_PARAM(statistics),
+                                 bus_method_get_event_statistics,
+                                 0),
 
         /* One of those days we might want to add a similar, second interface to cover common service
          * operations such as Reload(), Reexecute(), Exit() …  and maybe some properties exposing version
@@ -36,6 +36,7 @@
 #include "sort-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "strv.h"
 #include "syslog-util.h"
 #include "terminal-util.h"
 #include "unit-def.h"
@@ -1966,6 +1967,7 @@ static int bus_append_socket_property(sd_bus_message *m, const char *field, cons
                               "PassSecurity",
                               "PassPacketInfo",
                               "ReusePort",
+                              "ReusePortCPUSteering",
                               "RemoveOnStop",
                               "SELinuxContextFromNet"))
                 return bus_append_parse_boolean(m, field, eq);
@@ -1982,6 +1984,7 @@ static int bus_append_socket_property(sd_bus_message *m, const char *field, cons
                               "MaxConnections",
                               "MaxConnectionsPerSource",
                               "KeepAliveProbes",
+                              "ReusePortInstances",
                               "TriggerLimitBurst"))
                 return bus_append_safe_atou(m, field, eq);
 
@@ -2393,3 +2396,104 @@ int unit_load_state(sd_bus *bus, const char *name, char **load_state) {
 
         return 0;
 }
+
+int bus_map_units_properties(
+                sd_bus *bus,
+                char **states,
+                char **patterns,
+                const struct bus_properties_map *map,
+                unsigned flags,
+                bus_unit_properties_target_t target,
+                sd_bus_error *error,
+                sd_bus_message **reply,
+                void *userdata) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply_m = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        const struct bus_properties_map *i;
+        const char *unit;
+        int r;
+
+        assert(bus);
+        assert(map);
+        assert(target);
+        assert(reply || (flags & BUS_MAP_STRDUP));
+
+        /* Like bus_map_all_properties(), but for all units matching the specified states and patterns at
+         * once, with a single method call instead of one GetAll() call per unit. Only the properties
+         * listed in the map are requested. */
+
+        for (i = map; i->member; i++) {
+                r = strv_extend(&names, i->member);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_new_method_call(
+                        bus,
+                        &m,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "ListUnitsWithProperties");
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_append_strv(m, states);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_append_strv(m, patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_append(m, "s", "");
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_append_strv(m, names);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_call(bus, m, 0, error, &reply_m);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_enter_container(reply_m, 'a', "(sa{sv})");
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_enter_container(reply_m, 'r', "sa{sv}")) > 0) {
+                void *t = NULL;
+
+                r = sd_bus_message_read(reply_m, "s", &unit);
+                if (r < 0)
+                        return r;
+
+                r = target(unit, &t, userdata);
+                if (r < 0)
+                        return r;
+
+                if (t)
+                        r = bus_message_map_all_properties(reply_m, map, flags, error, t);
+                else
+                        r = sd_bus_message_skip(reply_m, "a{sv}");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_exit_container(reply_m);
+                if (r < 0)
+                        return r;
+        }
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_exit_container(reply_m);
+        if (r < 0)
+                return r;
+
+        if (reply)
+                *reply = TAKE_PTR(reply_m);
+
+        return 0;
+}
@@ -3,6 +3,7 @@
 
 #include "sd-bus.h"
 
+#include "bus-map-properties.h"
 #include "install.h"
 #include "unit-def.h"
 
@@ -28,3 +29,17 @@ int bus_append_unit_property_assignment_many(sd_bus_message *m, UnitType t, char
 int bus_deserialize_and_dump_unit_file_changes(sd_bus_message *m, bool quiet, UnitFileChange **changes, size_t *n_changes);
 
 int unit_load_state(sd_bus *bus, const char *name, char **load_state);
+
+/* Called for each unit returned by bus_map_units_properties(), returns the object to map the properties into */
+typedef int (*bus_unit_properties_target_t)(const char *unit, void **ret_target, void *userdata);
+
+int bus_map_units_properties(
+                sd_bus *bus,
+                char **states,
+                char **patterns,
+                const struct bus_properties_map *map,
+                unsigned flags,
+                bus_unit_properties_target_t target,
+                sd_bus_error *error,
+                sd_bus_message **reply,
+                void *userdata);
@@ -19,6 +19,9 @@ typedef struct BusWaitForJobs {
         char *name;
         char *result;
 
+        /* Unit name and job result pairs of JobRemoved messages not looked at yet, in the order received */
+        char **finished;
+
         sd_bus_slot *slot_job_removed;
         sd_bus_slot *slot_disconnected;
 } BusWaitForJobs;
@@ -54,9 +57,11 @@ static int match_job_removed(sd_bus_message *m, void *userdata, sd_bus_error *er
 
         free(found);
 
-        (void) free_and_strdup(&d->result, empty_to_null(result));
-
-        (void) free_and_strdup(&d->name, empty_to_null(unit));
+        /* Queue the result, rather than storing it directly: if jobs are enqueued in a pipelined fashion,
+         * multiple JobRemoved messages might be dispatched before bus_wait_for_jobs() gets to look at them. */
+        r = strv_extend_strv(&d->finished, STRV_MAKE(unit, result), false);
+        if (r < 0)
+                log_oom();
 
         return 0;
 }
@@ -73,6 +78,7 @@ void bus_wait_for_jobs_free(BusWaitForJobs *d) {
         sd_bus_unref(d->bus);
 
         free(d->name);
+        strv_free(d->finished);
         free(d->result);
 
         free(d);
@@ -290,12 +296,24 @@ int bus_wait_for_jobs(BusWaitForJobs *d, bool quiet, const char* const* extra_ar
 
         assert(d);
 
-        while (!set_isempty(d->jobs)) {
+        while (!set_isempty(d->jobs) || !strv_isempty(d->finished)) {
                 int q;
 
-                q = bus_process_wait(d->bus);
-                if (q < 0)
-                        return log_error_errno(q, "Failed to wait for response: %m");
+                if (strv_isempty(d->finished)) {
+                        q = bus_process_wait(d->bus);
+                        if (q < 0)
+                                return log_error_errno(q, "Failed to wait for response: %m");
+
+                        continue;
+                }
+
+                (void) free_and_strdup(&d->name, empty_to_null(d->finished[0]));
+                (void) free_and_strdup(&d->result, empty_to_null(d->finished[1]));
+
+                /* Drop the pair from the head of the queue */
+                free(d->finished[0]);
+                free(d->finished[1]);
+                memmove(d->finished, d->finished + 2, (strv_length(d->finished + 2) + 1) * sizeof(char*));
 
                 if (d->name && d->result) {
                         q = check_wait_response(d, quiet, extra_args);
@@ -1196,19 +1196,122 @@ static int tm_within_bounds(struct tm *tm, bool utc) {
         return good;
 }
 
-static bool matches_weekday(int weekdays_bits, const struct tm *tm, bool utc) {
-        struct tm t;
-        int k;
+static int days_in_month(int year, int mon) {
+        static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
-        if (weekdays_bits < 0 || weekdays_bits >= BITS_WEEKDAYS)
-                return true;
+        assert(mon >= 0 && mon < 12);
 
-        t = *tm;
-        if (mktime_or_timegm(&t, utc) < 0)
+        if (mon == 1 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+                return 29;
+
+        return days[mon];
+}
+
+static bool tm_normalize_fields(struct tm *tm) {
+        int y;
+
+        assert(tm);
+
+        /* Carries overflowing fields into the next bigger ones, with plain calendar arithmetic, which is a
+         * lot cheaper than mktime(). Unlike mktime() this does not take timezone transitions into account,
+         * i.e. the result might be a local time that doesn't exist. find_next() hence validates the time of
+         * day with mktime() before accepting it. Returns false if there's something we can't deal with. */
+
+        if (tm->tm_year < 0 || tm->tm_mon < 0 || tm->tm_mday < 1 ||
+            tm->tm_hour < 0 || tm->tm_min < 0 || tm->tm_sec < 0)
                 return false;
 
-        k = t.tm_wday == 0 ? 6 : t.tm_wday - 1;
-        return (weekdays_bits & (1 << k));
+        tm->tm_min += tm->tm_sec / 60;
+        tm->tm_sec %= 60;
+        tm->tm_hour += tm->tm_min / 60;
+        tm->tm_min %= 60;
+        tm->tm_mday += tm->tm_hour / 24;
+        tm->tm_hour %= 24;
+        tm->tm_year += tm->tm_mon / 12;
+        tm->tm_mon %= 12;
+
+        y = tm->tm_year + 1900;
+        while (tm->tm_mday > days_in_month(y, tm->tm_mon)) {
+                if (y > MAX_YEAR)
+                        break;
+
+                tm->tm_mday -= days_in_month(y, tm->tm_mon);
+                if (++tm->tm_mon >= 12) {
+                        tm->tm_mon = 0;
+                        tm->tm_year++;
+                        y++;
+                }
+        }
+
+        return true;
+}
+
+static int date_within_bounds(struct tm *tm, bool changed, bool *validated) {
+        assert(tm);
+        assert(validated);
+
+        /* Checks whether the date in 'tm' exists. This is independent of the timezone, hence we don't need
+         * mktime() for it. The time of day is checked separately by time_within_bounds(). */
+
+        if (tm->tm_year + 1900 > MAX_YEAR)
+                return -ERANGE;
+
+        if (!changed)
+                return 1;
+
+        *validated = false;
+
+        return tm->tm_mon < 12 && tm->tm_mday <= days_in_month(tm->tm_year + 1900, tm->tm_mon);
+}
+
+static int time_within_bounds(struct tm *tm, const CalendarSpec *spec, bool changed, bool *validated) {
+        int r;
+
+        assert(tm);
+        assert(spec);
+        assert(validated);
+
+        /* Like tm_within_bounds(), but avoids the mktime() call if nothing changed since 'tm' was last
+         * validated by it. This doesn't hold if an explicit DST setting is forced on the normalized time,
+         * hence only do this if the spec doesn't carry one. */
+
+        if (!changed && *validated)
+                return 1;
+
+        r = tm_within_bounds(tm, spec->utc);
+        *validated = r > 0 && spec->dst < 0;
+        return r;
+}
+
+static int tm_weekday(const struct tm *tm) {
+        static const int offsets[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+        int y;
+
+        assert(tm);
+        assert(tm->tm_mon >= 0 && tm->tm_mon < 12);
+
+        /* Returns the day of the week of the (normalized) date in 'tm', with Monday being 0. This is simple
+         * arithmetic on the proleptic Gregorian calendar, and thus independent of the timezone. */
+
+        y = tm->tm_year + 1900 - (tm->tm_mon < 2);
+        return (y + y/4 - y/100 + y/400 + offsets[tm->tm_mon] + tm->tm_mday + 6) % 7;
+}
+
+static int weekday_distance(int weekdays_bits, const struct tm *tm) {
+        int k;
+
+        /* Returns the number of days from 'tm' to the next day with a matching weekday, 0 if 'tm' matches
+         * already */
+
+        if (weekdays_bits <= 0 || weekdays_bits >= BITS_WEEKDAYS)
+                return 0;
+
+        k = tm_weekday(tm);
+        for (int d = 0; d < 7; d++)
+                if (weekdays_bits & (1 << ((k + d) % 7)))
+                        return d;
+
+        assert_not_reached("No weekday set");
 }
 
 static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
@@ -1224,9 +1327,21 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
         c = *tm;
         tm_usec = *usec;
 
-        for (;;) {
+        /* Normalize the starting point with mktime() once. Besides validating it, this makes mktime()
+         * resolve ambiguous local times we look at later on relative to the UTC offset we start from. */
+        (void) mktime_or_timegm(&c, spec->utc);
+        c.tm_isdst = spec->dst;
+
+        for (bool first = true;; first = false) {
+                /* Only the starting point is known to be validated by mktime() */
+                bool validated = first && spec->dst < 0;
+                int d;
+
                 /* Normalize the current date */
-                (void) mktime_or_timegm(&c, spec->utc);
+                if (!tm_normalize_fields(&c)) {
+                        (void) mktime_or_timegm(&c, spec->utc);
+                        validated = spec->dst < 0;
+                }
                 c.tm_isdst = spec->dst;
 
                 c.tm_year += 1900;
@@ -1240,7 +1355,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 }
                 if (r < 0)
                         return r;
-                if (tm_within_bounds(&c, spec->utc) <= 0)
+                if (date_within_bounds(&c, r > 0, &validated) <= 0)
                         return -ENOENT;
 
                 c.tm_mon += 1;
@@ -1251,7 +1366,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                         c.tm_mday = 1;
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
                 }
-                if (r < 0 || (r = tm_within_bounds(&c, spec->utc)) < 0) {
+                if (r < 0 || (r = date_within_bounds(&c, r > 0, &validated)) < 0) {
                         c.tm_year++;
                         c.tm_mon = 0;
                         c.tm_mday = 1;
@@ -1264,7 +1379,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 r = find_matching_component(spec, spec->day, &c, &c.tm_mday);
                 if (r > 0)
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
-                if (r < 0 || (r = tm_within_bounds(&c, spec->utc)) < 0) {
+                if (r < 0 || (r = date_within_bounds(&c, r > 0, &validated)) < 0) {
                         c.tm_mon++;
                         c.tm_mday = 1;
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
@@ -1273,8 +1388,11 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 if (r == 0)
                         continue;
 
-                if (!matches_weekday(spec->weekdays_bits, &c, spec->utc)) {
-                        c.tm_mday++;
+                /* All days in between don't match the weekday either, hence skip right to the next one that
+                 * does, instead of going day by day */
+                d = weekday_distance(spec->weekdays_bits, &c);
+                if (d > 0) {
+                        c.tm_mday += d;
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
                         continue;
                 }
@@ -1282,7 +1400,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 r = find_matching_component(spec, spec->hour, &c, &c.tm_hour);
                 if (r > 0)
                         c.tm_min = c.tm_sec = tm_usec = 0;
-                if (r < 0 || (r = tm_within_bounds(&c, spec->utc)) < 0) {
+                if (r < 0 || (r = time_within_bounds(&c, spec, r > 0, &validated)) < 0) {
                         c.tm_mday++;
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
                         continue;
@@ -1296,7 +1414,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 r = find_matching_component(spec, spec->minute, &c, &c.tm_min);
                 if (r > 0)
                         c.tm_sec = tm_usec = 0;
-                if (r < 0 || (r = tm_within_bounds(&c, spec->utc)) < 0) {
+                if (r < 0 || (r = time_within_bounds(&c, spec, r > 0, &validated)) < 0) {
                         c.tm_hour++;
                         c.tm_min = c.tm_sec = tm_usec = 0;
                         continue;
@@ -1309,7 +1427,7 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 tm_usec = c.tm_sec % USEC_PER_SEC;
                 c.tm_sec /= USEC_PER_SEC;
 
-                if (r < 0 || (r = tm_within_bounds(&c, spec->utc)) < 0) {
+                if (r < 0 || (r = time_within_bounds(&c, spec, r > 0, &validated)) < 0) {
                         c.tm_min++;
                         c.tm_sec = tm_usec = 0;
                         continue;
@@ -1323,6 +1441,60 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
         }
 }
 
+static bool tm_same_time(const struct tm *a, const struct tm *b) {
+        return a->tm_year == b->tm_year &&
+               a->tm_mon  == b->tm_mon  &&
+               a->tm_mday == b->tm_mday &&
+               a->tm_hour == b->tm_hour &&
+               a->tm_min  == b->tm_min  &&
+               a->tm_sec  == b->tm_sec;
+}
+
+static time_t tm_to_time_t_after(const CalendarSpec *spec, struct tm *tm, usec_t tm_usec, usec_t after) {
+        struct tm t;
+        time_t x, best;
+
+        assert(spec);
+        assert(tm);
+
+        /* Converts the local time in 'tm' to a time_t. When the clock is turned back, local times happen
+         * twice, and mktime() picks one of them depending on what it converted previously. Since
+         * find_next() doesn't convert every intermediate time it looks at, make the choice explicitly
+         * here: pick the earliest occurrence that is not before 'after'. The other occurrence, if there is
+         * one, is off by the difference of the UTC offsets in effect some hours earlier or later. */
+
+        if (spec->utc || spec->dst >= 0)
+                return mktime_or_timegm(tm, spec->utc);
+
+        t = *tm;
+        x = mktime(&t);
+        if (x < 0)
+                return x;
+
+        best = (usec_t) x * USEC_PER_SEC + tm_usec >= after ? x : -1;
+
+        for (int i = -1; i <= 1; i += 2) {
+                time_t y = x + i * 12 * 60 * 60;
+                struct tm o;
+
+                if (!localtime_r(&y, &o) || o.tm_gmtoff == t.tm_gmtoff)
+                        continue;
+
+                y = x + t.tm_gmtoff - o.tm_gmtoff;
+                if (!localtime_r(&y, &o) || !tm_same_time(&o, tm))
+                        continue;
+
+                if ((usec_t) y * USEC_PER_SEC + tm_usec < after)
+                        continue;
+
+                if (best < 0 || y < best)
+                        best = y;
+        }
+
+        *tm = t;
+        return best < 0 ? x : best;
+}
+
 static int calendar_spec_next_usec_impl(const CalendarSpec *spec, usec_t usec, usec_t *ret_next) {
         struct tm tm;
         time_t t;
@@ -1343,7 +1515,7 @@ static int calendar_spec_next_usec_impl(const CalendarSpec *spec, usec_t usec, u
         if (r < 0)
                 return r;
 
-        t = mktime_or_timegm(&tm, spec->utc);
+        t = tm_to_time_t_after(spec, &tm, tm_usec, usec);
         if (t < 0)
                 return -EINVAL;
 
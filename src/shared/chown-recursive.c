@@ -10,6 +10,7 @@
 #include "fd-util.h"
 #include "fs-util.h"
 #include "macro.h"
+#include "nulstr-util.h"
 #include "stdio-util.h"
 #include "strv.h"
 #include "user-util.h"
@@ -22,7 +23,9 @@ static int chown_one(
                 mode_t mask) {
 
         char procfs_path[STRLEN("/proc/self/fd/") + DECIMAL_STR_MAX(int) + 1];
+        char names[256 + 1];
         const char *n;
+        ssize_t l;
         int r;
 
         assert(fd >= 0);
@@ -32,11 +35,28 @@ static int chown_one(
          * with O_PATH. */
         xsprintf(procfs_path, "/proc/self/fd/%i", fd);
 
+        /* Most inodes carry no ACL at all, hence check which xattrs there are first, with a single call,
+         * instead of trying to remove both ACLs on every inode. If the list doesn't fit into our buffer,
+         * try to remove both anyway. */
+        l = listxattr(procfs_path, names, sizeof(names) - 1);
+        if (l < 0) {
+                if (IN_SET(errno, EOPNOTSUPP, ENOSYS, ENOTTY))
+                        l = 0;
+                else if (errno != ERANGE)
+                        return -errno;
+        }
+        if (l >= 0)
+                names[l] = 0; /* make this a NULSTR */
+
         /* Drop any ACL if there is one */
-        FOREACH_STRING(n, "system.posix_acl_access", "system.posix_acl_default")
+        FOREACH_STRING(n, "system.posix_acl_access", "system.posix_acl_default") {
+                if (l >= 0 && !nulstr_contains(names, n))
+                        continue;
+
                 if (removexattr(procfs_path, n) < 0)
                         if (!IN_SET(errno, ENODATA, EOPNOTSUPP, ENOSYS, ENOTTY))
                                 return -errno;
+        }
 
         r = fchmod_and_chown(fd, st->st_mode & mask, uid, gid);
         if (r < 0)
@@ -27,6 +27,7 @@
 #include "fileio.h"
 #include "fs-util.h"
 #include "glob-util.h"
+#include "hashmap.h"
 #include "hostname-util.h"
 #include "ima-util.h"
 #include "limits-util.h"
@@ -776,6 +777,71 @@ static int condition_test_file_is_executable(Condition *c, char **env) {
                 (st.st_mode & 0111));
 }
 
+/* Results of conditions already tested, while caching is enabled, keyed by "<type>:<parameter>". The values
+ * are 1 + the (boolean) test result, i.e. unaffected by negation. */
+static Hashmap *condition_cache = NULL;
+static bool condition_cache_enabled = false;
+
+static bool condition_type_cacheable(ConditionType t) {
+        /* Only conditions which check properties of the system, rather than of paths in the file system,
+         * which units started in the meantime might create or mount, and which are otherwise not influenced
+         * by what we are doing. Also, not the environment, which is passed in explicitly. */
+        return IN_SET(t,
+                      CONDITION_KERNEL_COMMAND_LINE,
+                      CONDITION_KERNEL_VERSION,
+                      CONDITION_VIRTUALIZATION,
+                      CONDITION_SECURITY,
+                      CONDITION_CAPABILITY,
+                      CONDITION_AC_POWER,
+                      CONDITION_ARCHITECTURE,
+                      CONDITION_FIRST_BOOT,
+                      CONDITION_CONTROL_GROUP_CONTROLLER,
+                      CONDITION_CPUS,
+                      CONDITION_MEMORY);
+}
+
+void condition_cache_enable(bool b) {
+        /* Enables caching of condition results, for a limited span of time, for example while the service
+         * manager processes its run queue, where the same conditions are typically tested for many units
+         * in a row. Disabling flushes the cache again. */
+
+        condition_cache_enabled = b;
+        if (!b)
+                condition_cache = hashmap_free_free_key(condition_cache);
+}
+
+static int condition_test_cached(Condition *c, char **env, int (*test)(Condition *c, char **env)) {
+        _cleanup_free_ char *key = NULL;
+        void *v;
+        int r;
+
+        assert(c);
+        assert(test);
+
+        if (!condition_cache_enabled || !condition_type_cacheable(c->type))
+                return test(c, env);
+
+        if (asprintf(&key, "%i:%s", c->type, strempty(c->parameter)) < 0)
+                return test(c, env);
+
+        v = hashmap_get(condition_cache, key);
+        if (v)
+                return PTR_TO_INT(v) - 1;
+
+        r = test(c, env);
+        if (r < 0) /* Errors are not cached, let's try again next time */
+                return r;
+
+        r = r > 0;
+
+        /* Caching is just an optimization, hence ignore failures */
+        if (hashmap_ensure_allocated(&condition_cache, &string_hash_ops) >= 0 &&
+            hashmap_put(condition_cache, key, INT_TO_PTR(r + 1)) >= 0)
+                TAKE_PTR(key);
+
+        return r;
+}
+
 int condition_test(Condition *c, char **env) {
 
         static int (*const condition_tests[_CONDITION_TYPE_MAX])(Condition *c, char **env) = {
@@ -813,7 +879,7 @@ int condition_test(Condition *c, char **env) {
         assert(c->type >= 0);
         assert(c->type < _CONDITION_TYPE_MAX);
 
-        r = condition_tests[c->type](c, env);
+        r = condition_test_cached(c, env, condition_tests[c->type]);
         if (r < 0) {
                 c->result = CONDITION_ERROR;
                 return r;
@@ -73,6 +73,7 @@ static inline Condition* condition_free_list(Condition *first) {
 }
 
 int condition_test(Condition *c, char **env);
+void condition_cache_enable(bool b);
 
 typedef int (*condition_test_logger_t)(void *userdata, int level, int error, const char *file, int line, const char *func, const char *format, ...) _printf_(7, 8);
 typedef const char* (*condition_to_string_t)(ConditionType t) _const_;
@@ -267,6 +267,7 @@ int config_parse(const char *unit,
         _cleanup_fclose_ FILE *ours = NULL;
         unsigned line = 0, section_line = 0;
         bool section_ignored = false, bom_seen = false;
+        ReadLineFlags read_flags = 0;
         int r, fd;
         usec_t mtime;
 
@@ -295,6 +296,11 @@ int config_parse(const char *unit,
 
                 (void) stat_warn_permissions(filename, &st);
                 mtime = timespec_load(&st.st_mtim);
+
+                /* Let read_line() know right away that this can't be a TTY, so that it doesn't have to
+                 * check with isatty() for each line again. */
+                if (!S_ISCHR(st.st_mode))
+                        read_flags |= READ_LINE_NOT_A_TTY;
         }
 
         for (;;) {
@@ -302,7 +308,7 @@ int config_parse(const char *unit,
                 bool escaped = false;
                 char *l, *p, *e;
 
-                r = read_line(f, LONG_LINE_MAX, &buf);
+                r = read_line_full(f, LONG_LINE_MAX, read_flags, &buf);
                 if (r == 0)
                         break;
                 if (r == -ENOBUFS) {
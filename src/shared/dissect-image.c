@@ -706,6 +706,11 @@ int dissect_image(
                                 if (m->partitions[designator].found)
                                         continue;
 
+                                /* udev already probed the file system when it initialized the partition
+                                 * device, hence reuse its result rather than probing again below. */
+                                if (!fstype && !FLAGS_SET(flags, DISSECT_IMAGE_NO_UDEV))
+                                        (void) sd_device_get_property_value(q, "ID_FS_TYPE", &fstype);
+
                                 if (fstype) {
                                         t = strdup(fstype);
                                         if (!t)
@@ -546,9 +546,18 @@ static int set_features_bit(
 int ethtool_set_features(int *ethtool_fd, const char *ifname, int *features) {
         _cleanup_free_ struct ethtool_gstrings *strings = NULL;
         struct ethtool_sfeatures *sfeatures;
+        struct ethtool_gfeatures *gfeatures;
         struct ifreq ifr = {};
+        bool need_update = false;
+        unsigned n_blocks;
         int i, r;
 
+        for (i = 0; i < _NET_DEV_FEAT_MAX; i++)
+                if (features[i] != -1)
+                        break;
+        if (i >= _NET_DEV_FEAT_MAX)
+                return 0;
+
         if (*ethtool_fd < 0) {
                 r = ethtool_connect_or_warn(ethtool_fd, true);
                 if (r < 0)
@@ -561,9 +570,11 @@ int ethtool_set_features(int *ethtool_fd, const char *ifname, int *features) {
         if (r < 0)
                 return log_warning_errno(r, "ethtool: could not get ethtool features for %s", ifname);
 
-        sfeatures = alloca0(sizeof(struct ethtool_sfeatures) + DIV_ROUND_UP(strings->len, 32U) * sizeof(sfeatures->features[0]));
+        n_blocks = DIV_ROUND_UP(strings->len, 32U);
+
+        sfeatures = alloca0(sizeof(struct ethtool_sfeatures) + n_blocks * sizeof(sfeatures->features[0]));
         sfeatures->cmd = ETHTOOL_SFEATURES;
-        sfeatures->size = DIV_ROUND_UP(strings->len, 32U);
+        sfeatures->size = n_blocks;
 
         for (i = 0; i < _NET_DEV_FEAT_MAX; i++)
                 if (features[i] != -1) {
@@ -574,6 +585,25 @@ int ethtool_set_features(int *ethtool_fd, const char *ifname, int *features) {
                         }
                 }
 
+        /* Only issue ETHTOOL_SFEATURES if any of the requested features differs from what's requested already */
+        gfeatures = alloca0(sizeof(struct ethtool_gfeatures) + n_blocks * sizeof(gfeatures->features[0]));
+        gfeatures->cmd = ETHTOOL_GFEATURES;
+        gfeatures->size = n_blocks;
+
+        ifr.ifr_data = (void *) gfeatures;
+
+        r = ioctl(*ethtool_fd, SIOCETHTOOL, &ifr);
+        if (r < 0)
+                need_update = true;
+        else
+                for (unsigned b = 0; b < n_blocks; b++)
+                        if ((gfeatures->features[b].requested ^ sfeatures->features[b].requested) & sfeatures->features[b].valid) {
+                                need_update = true;
+                                break;
+                        }
+        if (!need_update)
+                return 0;
+
         ifr.ifr_data = (void *) sfeatures;
 
         r = ioctl(*ethtool_fd, SIOCETHTOOL, &ifr);
@@ -760,10 +790,15 @@ int ethtool_set_glinksettings(
                 NetDevPort port) {
         _cleanup_free_ struct ethtool_link_usettings *u = NULL;
         struct ifreq ifr = {};
+        bool need_update = false;
         int r;
 
         assert(advertise);
 
+        if (autonegotiation < 0 && memeqzero(advertise, sizeof(uint32_t) * N_ADVERTISE) &&
+            speed == 0 && duplex == _DUP_INVALID && port == _NET_DEV_PORT_INVALID)
+                return 0;
+
         if (autonegotiation != AUTONEG_DISABLE && memeqzero(advertise, sizeof(uint32_t) * N_ADVERTISE)) {
                 log_info("ethtool: autonegotiation is unset or enabled, the speed and duplex are not writable.");
                 return 0;
@@ -784,25 +819,42 @@ int ethtool_set_glinksettings(
                         return log_warning_errno(r, "ethtool: Cannot get device settings for %s : %m", ifname);
         }
 
-        if (speed > 0)
+        if (speed > 0 && u->base.speed != DIV_ROUND_UP(speed, 1000000)) {
                 u->base.speed = DIV_ROUND_UP(speed, 1000000);
+                need_update = true;
+        }
 
-        if (duplex != _DUP_INVALID)
+        if (duplex != _DUP_INVALID && u->base.duplex != duplex) {
                 u->base.duplex = duplex;
+                need_update = true;
+        }
 
-        if (port != _NET_DEV_PORT_INVALID)
+        if (port != _NET_DEV_PORT_INVALID && u->base.port != port) {
                 u->base.port = port;
+                need_update = true;
+        }
 
-        if (autonegotiation >= 0)
+        if (autonegotiation >= 0 && u->base.autoneg != autonegotiation) {
                 u->base.autoneg = autonegotiation;
+                need_update = true;
+        }
 
         if (!memeqzero(advertise, sizeof(uint32_t) * N_ADVERTISE)) {
-                u->base.autoneg = AUTONEG_ENABLE;
-                memcpy(&u->link_modes.advertising, advertise, sizeof(uint32_t) * N_ADVERTISE);
-                memzero((uint8_t*) &u->link_modes.advertising + sizeof(uint32_t) * N_ADVERTISE,
-                        ETHTOOL_LINK_MODE_MASK_MAX_KERNEL_NBYTES - sizeof(uint32_t) * N_ADVERTISE);
+                uint32_t a[ETHTOOL_LINK_MODE_MASK_MAX_KERNEL_NU32] = {};
+
+                memcpy(a, advertise, sizeof(uint32_t) * N_ADVERTISE);
+
+                if (u->base.autoneg != AUTONEG_ENABLE ||
+                    memcmp(u->link_modes.advertising, a, 4 * u->base.link_mode_masks_nwords) != 0) {
+                        u->base.autoneg = AUTONEG_ENABLE;
+                        memcpy(&u->link_modes.advertising, a, sizeof(a));
+                        need_update = true;
+                }
         }
 
+        if (!need_update)
+                return 0;
+
         if (u->base.cmd == ETHTOOL_GLINKSETTINGS)
                 r = set_slinksettings(*fd, &ifr, u);
         else
@@ -3,19 +3,23 @@
 #include <dirent.h>
 #include <errno.h>
 #include <sys/prctl.h>
+#include <sys/wait.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdio.h>
 
 #include "alloc-util.h"
 #include "conf-files.h"
+#include "cpu-set-util.h"
 #include "env-file.h"
 #include "env-util.h"
+#include "extract-word.h"
 #include "exec-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
 #include "macro.h"
+#include "parse-util.h"
 #include "process-util.h"
 #include "rlimit-util.h"
 #include "serialize.h"
@@ -72,19 +76,90 @@ static int do_spawn(const char *path, char *argv[], int stdout_fd, pid_t *pid) {
         return 1;
 }
 
+typedef struct ExecChild {
+        char *path;
+        usec_t begin;
+} ExecChild;
+
+static ExecChild* exec_child_free(ExecChild *c) {
+        if (!c)
+                return NULL;
+
+        free(c->path);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ExecChild*, exec_child_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(exec_child_hash_ops, void, trivial_hash_func, trivial_compare_func,
+                                              ExecChild, exec_child_free);
+
+static unsigned parallel_max(void) {
+        int n;
+
+        /* Generators and hooks mostly wait for IO, hence allow a couple of them per CPU */
+        n = cpus_in_affinity_mask();
+        if (n <= 0)
+                return EXEC_DIR_PARALLEL_MIN;
+
+        return CLAMP(2U * (unsigned) n, EXEC_DIR_PARALLEL_MIN, EXEC_DIR_PARALLEL_MAX);
+}
+
+static void record_runtime(const char *path, usec_t begin, FILE *timing) {
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t duration;
+
+        duration = usec_sub_unsigned(now(CLOCK_MONOTONIC), begin);
+        log_debug("%s took %s.", path, format_timespan(ts, sizeof(ts), duration, USEC_PER_MSEC));
+
+        if (!timing)
+                return;
+
+        fprintf(timing, USEC_FMT " " USEC_FMT " %s\n", begin, duration, path);
+        (void) fflush(timing);
+}
+
+static int wait_for_any(Hashmap *pids, FILE *timing, ExecDirFlags flags) {
+        _cleanup_(exec_child_freep) ExecChild *c = NULL;
+        siginfo_t si = {};
+        int r;
+
+        /* Find out which child finished first without reaping it, so that wait_for_terminate_and_check()
+         * can do that for us and log the result. */
+        if (waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) < 0)
+                return log_error_errno(errno, "Failed to wait for child processes: %m");
+
+        c = hashmap_remove(pids, PID_TO_PTR(si.si_pid));
+        if (!c) {
+                /* Not one of ours? Reap it anyway, so that we don't loop */
+                (void) wait_for_terminate(si.si_pid, NULL);
+                return 0;
+        }
+
+        r = wait_for_terminate_and_check(c->path, si.si_pid, WAIT_LOG);
+        record_runtime(c->path, c->begin, timing);
+        if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
+                return r;
+
+        return 0;
+}
+
 static int do_execute(
                 char **directories,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 int output_fd,
+                int timing_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags) {
 
-        _cleanup_hashmap_free_free_ Hashmap *pids = NULL;
+        _cleanup_hashmap_free_ Hashmap *pids = NULL;
         _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_fclose_ FILE *timing = NULL;
         char **path, **e;
+        unsigned n_max = 0;
         int r;
         bool parallel_execution;
 
@@ -101,9 +176,17 @@ static int do_execute(
                 return log_error_errno(r, "Failed to enumerate executables: %m");
 
         if (parallel_execution) {
-                pids = hashmap_new(NULL);
+                pids = hashmap_new(&exec_child_hash_ops);
                 if (!pids)
                         return log_oom();
+
+                n_max = parallel_max();
+        }
+
+        if (timing_fd >= 0) {
+                timing = take_fdopen(&timing_fd, "w");
+                if (!timing)
+                        return log_error_errno(errno, "Failed to open timing file: %m");
         }
 
         /* Abort execution of this process after the timeout. We simply rely on SIGALRM as
@@ -119,6 +202,7 @@ static int do_execute(
         STRV_FOREACH(path, paths) {
                 _cleanup_free_ char *t = NULL;
                 _cleanup_close_ int fd = -1;
+                usec_t begin;
                 pid_t pid;
 
                 t = strdup(*path);
@@ -131,17 +215,38 @@ static int do_execute(
                                 return log_error_errno(fd, "Failed to open serialization file: %m");
                 }
 
+                /* Don't start more than n_max processes at once, wait for one of them to finish first */
+                while (parallel_execution && hashmap_size(pids) >= n_max) {
+                        r = wait_for_any(pids, timing, flags);
+                        if (r != 0)
+                                return r;
+                }
+
+                begin = now(CLOCK_MONOTONIC);
+
                 r = do_spawn(t, argv, fd, &pid);
                 if (r <= 0)
                         continue;
 
                 if (parallel_execution) {
-                        r = hashmap_put(pids, PID_TO_PTR(pid), t);
+                        _cleanup_(exec_child_freep) ExecChild *c = NULL;
+
+                        c = new(ExecChild, 1);
+                        if (!c)
+                                return log_oom();
+
+                        *c = (ExecChild) {
+                                .path = TAKE_PTR(t),
+                                .begin = begin,
+                        };
+
+                        r = hashmap_put(pids, PID_TO_PTR(pid), c);
                         if (r < 0)
                                 return log_oom();
-                        t = NULL;
+                        TAKE_PTR(c);
                 } else {
                         r = wait_for_terminate_and_check(t, pid, WAIT_LOG);
+                        record_runtime(t, begin, timing);
                         if (FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS)) {
                                 if (r < 0)
                                         continue;
@@ -167,34 +272,74 @@ static int do_execute(
         }
 
         while (!hashmap_isempty(pids)) {
-                _cleanup_free_ char *t = NULL;
-                pid_t pid;
+                r = wait_for_any(pids, timing, flags);
+                if (r != 0)
+                        return r;
+        }
+
+        return 0;
+}
 
-                pid = PTR_TO_PID(hashmap_first_key(pids));
-                assert(pid > 0);
+static void parse_runtimes(int *fd, exec_dir_runtime_callback_t callback, void *userdata) {
+        _cleanup_fclose_ FILE *f = NULL;
+        int r;
 
-                t = hashmap_remove(pids, PID_TO_PTR(pid));
-                assert(t);
+        assert(fd);
+        assert(*fd >= 0);
+        assert(callback);
 
-                r = wait_for_terminate_and_check(t, pid, WAIT_LOG);
-                if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
-                        return r;
+        /* The runtimes are reported on a best effort basis, hence failures are only logged here */
+
+        if (lseek(*fd, 0, SEEK_SET) < 0) {
+                log_debug_errno(errno, "Failed to rewind timing fd, ignoring: %m");
+                return;
         }
 
-        return 0;
+        f = take_fdopen(fd, "r");
+        if (!f) {
+                log_debug_errno(errno, "Failed to open timing fd, ignoring: %m");
+                return;
+        }
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL, *b = NULL, *d = NULL;
+                usec_t begin, duration;
+                const char *p;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to read timing data, ignoring: %m");
+                        return;
+                }
+                if (r == 0)
+                        return;
+
+                p = line;
+                r = extract_many_words(&p, NULL, 0, &b, &d, NULL);
+                if (r != 2 || isempty(p) ||
+                    safe_atou64(b, &begin) < 0 ||
+                    safe_atou64(d, &duration) < 0) {
+                        log_debug("Failed to parse timing line, ignoring: %s", line);
+                        continue;
+                }
+
+                callback(p, begin, duration, userdata);
+        }
 }
 
-int execute_directories(
+int execute_directories_full(
                 const char* const* directories,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 char *argv[],
                 char *envp[],
-                ExecDirFlags flags) {
+                ExecDirFlags flags,
+                exec_dir_runtime_callback_t runtime_callback,
+                void *runtime_userdata) {
 
         char **dirs = (char**) directories;
-        _cleanup_close_ int fd = -1;
+        _cleanup_close_ int fd = -1, timing_fd = -1;
         char *name;
         int r;
         pid_t executor_pid;
@@ -215,6 +360,12 @@ int execute_directories(
                         return log_error_errno(fd, "Failed to open serialization file: %m");
         }
 
+        if (runtime_callback) {
+                timing_fd = open_serialization_fd("timing");
+                if (timing_fd < 0)
+                        return log_error_errno(timing_fd, "Failed to open timing file: %m");
+        }
+
         /* Executes all binaries in the directories serially or in parallel and waits for
          * them to finish. Optionally a timeout is applied. If a file with the same name
          * exists in more than one directory, the earliest one wins. */
@@ -223,13 +374,17 @@ int execute_directories(
         if (r < 0)
                 return r;
         if (r == 0) {
-                r = do_execute(dirs, timeout, callbacks, callback_args, fd, argv, envp, flags);
+                r = do_execute(dirs, timeout, callbacks, callback_args, fd, timing_fd, argv, envp, flags);
                 _exit(r < 0 ? EXIT_FAILURE : r);
         }
 
         r = wait_for_terminate_and_check("(sd-executor)", executor_pid, 0);
         if (r < 0)
                 return r;
+
+        if (runtime_callback)
+                parse_runtimes(&timing_fd, runtime_callback, runtime_userdata);
+
         if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
                 return r;
 
@@ -29,14 +29,34 @@ typedef enum ExecCommandFlags {
         _EXEC_COMMAND_FLAGS_INVALID   = -1,
 } ExecCommandFlags;
 
-int execute_directories(
+/* Bounds for the number of binaries executed at the same time with EXEC_DIR_PARALLEL */
+#define EXEC_DIR_PARALLEL_MIN 4U
+#define EXEC_DIR_PARALLEL_MAX 64U
+
+/* Called for each executed binary, with the CLOCK_MONOTONIC timestamp it was started at and its runtime */
+typedef void (*exec_dir_runtime_callback_t) (const char *path, usec_t begin, usec_t duration, void *userdata);
+
+int execute_directories_full(
+                const char* const* directories,
+                usec_t timeout,
+                gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
+                void* const callback_args[_STDOUT_CONSUME_MAX],
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags,
+                exec_dir_runtime_callback_t runtime_callback,
+                void *runtime_userdata);
+
+static inline int execute_directories(
                 const char* const* directories,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 char *argv[],
                 char *envp[],
-                ExecDirFlags flags);
+                ExecDirFlags flags) {
+        return execute_directories_full(directories, timeout, callbacks, callback_args, argv, envp, flags, NULL, NULL);
+}
 
 int exec_command_flags_from_strv(char **ex_opts, ExecCommandFlags *flags);
 int exec_command_flags_to_strv(ExecCommandFlags flags, char ***ex_opts);
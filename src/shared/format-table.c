@@ -140,8 +140,17 @@ struct Table {
         bool *reverse_map;
 
         char *empty_string;
+
+        FILE *stream;           /* If set, write out rows while they are added, see table_set_stream() */
+        size_t stream_sample;   /* Number of rows to determine column widths from, before writing any */
+        size_t *stream_width;   /* Column widths, once we started writing rows */
+        bool *stream_grow;      /* Columns which may grow after we started writing rows (only the last one) */
+        size_t n_stream_width;
+        bool stream_have_last;  /* Whether the row after the header was written out already */
 };
 
+static int table_stream_flush(Table *t, FILE *f);
+
 Table *table_new_raw(size_t n_columns) {
         _cleanup_(table_unrefp) Table *t = NULL;
 
@@ -236,6 +245,8 @@ Table *table_unref(Table *t) {
         free(t->sort_map);
         free(t->reverse_map);
         free(t->empty_string);
+        free(t->stream_width);
+        free(t->stream_grow);
 
         return mfree(t);
 }
@@ -408,6 +419,18 @@ int table_add_cell_full(
         if (!data)
                 type = TABLE_EMPTY;
 
+        /* When streaming, write out the rows completed so far before starting a new one, once we have
+         * enough of them to determine column widths from. (Not any earlier: the caller might still
+         * change the last cell added.) */
+        if (t->stream && !t->sort_map && t->n_cells % t->n_columns == 0 &&
+            (t->stream_width || t->n_cells / t->n_columns > t->stream_sample)) {
+                int r;
+
+                r = table_stream_flush(t, t->stream);
+                if (r < 0)
+                        return r;
+        }
+
         /* Determine the cell adjacent to the current one, but one row up */
         if (t->n_cells >= t->n_columns)
                 assert_se(p = t->data[t->n_cells - t->n_columns]);
@@ -1046,6 +1069,30 @@ int table_set_empty_string(Table *t, const char *empty) {
         return free_and_strdup(&t->empty_string, empty);
 }
 
+int table_set_stream(Table *t, FILE *f, size_t sample_rows) {
+        assert(t);
+
+        /* Instead of buffering all rows until table_print() is called, write them out as they are added,
+         * so that huge tables don't have to be kept in memory, and output starts right away. Column widths
+         * are determined from the header and the first 'sample_rows' rows, and stay fixed afterwards, so
+         * that all rows stay aligned: later cells that don't fit are ellipsized, except in the last column,
+         * which may grow if it is formatted as wide as necessary. Callers which must not lose data should
+         * set the minimum column widths upfront, if they know them. Rows have to be
+         * added in the order they shall be shown, since a table with a sort order set is never streamed.
+         * The set of displayed columns may not be changed anymore once the first row was written out,
+         * and cells of rows written out may not be accessed anymore. table_print() has to be called at
+         * the end to write out the remaining rows. Of course, this is only useful for plain text output,
+         * since rows already written out are not included in the JSON output. */
+
+        if (t->n_cells > t->n_columns)
+                return -EBUSY;
+
+        t->stream = f ?: stdout;
+        t->stream_sample = sample_rows;
+
+        return 0;
+}
+
 int table_set_display_all(Table *t) {
         size_t allocated;
 
@@ -1769,49 +1816,28 @@ static const char* table_data_rgap_color(TableData *d) {
         return NULL;
 }
 
-int table_print(Table *t, FILE *f) {
-        size_t n_rows, *minimum_width, *maximum_width, display_columns, *requested_width,
-                i, j, table_minimum_width, table_maximum_width, table_requested_width, table_effective_width,
-                *width;
-        _cleanup_free_ size_t *sorted = NULL;
+static size_t table_display_columns(Table *t) {
+        assert(t);
+
+        return t->display_map ? t->n_display_map : t->n_columns;
+}
+
+static int table_compute_widths(Table *t, size_t display_columns, size_t *width, bool *ret_grow) {
+        size_t n_rows, *minimum_width, *maximum_width, *requested_width,
+                i, j, table_minimum_width, table_maximum_width, table_requested_width, table_effective_width;
         uint64_t *column_weight, weight_sum;
+        bool as_wide_as_needed;
         int r;
 
         assert(t);
-
-        if (!f)
-                f = stdout;
-
-        /* Ensure we have no incomplete rows */
-        assert(t->n_cells % t->n_columns == 0);
+        assert(display_columns > 0);
+        assert(width);
 
         n_rows = t->n_cells / t->n_columns;
-        assert(n_rows > 0); /* at least the header row must be complete */
-
-        if (t->sort_map) {
-                /* If sorting is requested, let's calculate an index table we use to lookup the actual index to display with. */
-
-                sorted = new(size_t, n_rows);
-                if (!sorted)
-                        return -ENOMEM;
-
-                for (i = 0; i < n_rows; i++)
-                        sorted[i] = i * t->n_columns;
-
-                typesafe_qsort_r(sorted, n_rows, table_data_compare, t);
-        }
-
-        if (t->display_map)
-                display_columns = t->n_display_map;
-        else
-                display_columns = t->n_columns;
-
-        assert(display_columns > 0);
 
         minimum_width = newa(size_t, display_columns);
         maximum_width = newa(size_t, display_columns);
         requested_width = newa(size_t, display_columns);
-        width = newa(size_t, display_columns);
         column_weight = newa0(uint64_t, display_columns);
 
         for (j = 0; j < display_columns; j++) {
@@ -1906,6 +1932,8 @@ int table_print(Table *t, FILE *f) {
         else
                 table_effective_width = MIN(table_requested_width, columns());
 
+        as_wide_as_needed = t->width == 0 || (t->width == (size_t) -1 && (pager_have() || !isatty(STDOUT_FILENO)));
+
         if (table_maximum_width != (size_t) -1 && table_effective_width > table_maximum_width)
                 table_effective_width = table_maximum_width;
 
@@ -2008,137 +2036,268 @@ int table_print(Table *t, FILE *f) {
                 }
         }
 
-        /* Second pass: show output */
-        for (i = t->header ? 0 : 1; i < n_rows; i++) {
-                size_t n_subline = 0;
-                bool more_sublines;
-                TableData **row;
+        /* Let the caller know which columns may be widened for cells that were not looked at here, see
+         * table_set_stream(): widening any but the last column would break the alignment with the rows
+         * written out already, hence that's only the last one, if we are formatting it as wide as
+         * necessary. */
+        if (ret_grow)
+                for (j = 0; j < display_columns; j++)
+                        ret_grow[j] = j == display_columns - 1 && as_wide_as_needed && maximum_width[j] == (size_t) -1;
 
-                if (sorted)
-                        row = t->data + sorted[i];
-                else
-                        row = t->data + i * t->n_columns;
+        return 0;
+}
 
-                do {
-                        const char *gap_color = NULL;
-                        more_sublines = false;
+static int table_print_row(Table *t, FILE *f, TableData **row, size_t display_columns, size_t *width, const bool *grow) {
+        size_t n_subline = 0, j;
+        bool more_sublines;
+        int r;
 
-                        for (j = 0; j < display_columns; j++) {
-                                _cleanup_free_ char *buffer = NULL, *extracted = NULL;
-                                bool lines_truncated = false;
-                                const char *field, *color = NULL;
-                                TableData *d;
-                                size_t l;
+        assert(t);
+        assert(f);
+        assert(row);
+        assert(width);
 
-                                assert_se(d = row[t->display_map ? t->display_map[j] : j]);
+        do {
+                const char *gap_color = NULL;
+                more_sublines = false;
 
-                                field = table_data_format(t, d, false);
-                                if (!field)
+                for (j = 0; j < display_columns; j++) {
+                        _cleanup_free_ char *buffer = NULL, *extracted = NULL;
+                        bool lines_truncated = false;
+                        const char *field, *color = NULL;
+                        TableData *d;
+                        size_t l;
+
+                        assert_se(d = row[t->display_map ? t->display_map[j] : j]);
+
+                        field = table_data_format(t, d, false);
+                        if (!field)
+                                return -ENOMEM;
+
+                        r = string_extract_line(field, n_subline, &extracted);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                /* There are more lines to come */
+                                if ((t->cell_height_max == (size_t) -1 || n_subline + 1 < t->cell_height_max))
+                                        more_sublines = true; /* There are more lines to come */
+                                else
+                                        lines_truncated = true;
+                        }
+                        if (extracted)
+                                field = extracted;
+
+                        l = utf8_console_width(field);
+                        if (grow && grow[j] && l > width[j])
+                                width[j] = l; /* Don't ellipsize, but widen the column from here on */
+
+                        if (l > width[j]) {
+                                /* Field is wider than allocated space. Let's ellipsize */
+
+                                buffer = ellipsize(field, width[j], /* ellipsize at the end if we truncated coming lines, otherwise honour configuration */
+                                                   lines_truncated ? 100 : d->ellipsize_percent);
+                                if (!buffer)
                                         return -ENOMEM;
 
-                                r = string_extract_line(field, n_subline, &extracted);
-                                if (r < 0)
-                                        return r;
-                                if (r > 0) {
-                                        /* There are more lines to come */
-                                        if ((t->cell_height_max == (size_t) -1 || n_subline + 1 < t->cell_height_max))
-                                                more_sublines = true; /* There are more lines to come */
-                                        else
-                                                lines_truncated = true;
-                                }
-                                if (extracted)
-                                        field = extracted;
+                                field = buffer;
+                        } else {
+                                if (lines_truncated) {
+                                        _cleanup_free_ char *padded = NULL;
 
-                                l = utf8_console_width(field);
-                                if (l > width[j]) {
-                                        /* Field is wider than allocated space. Let's ellipsize */
+                                        /* We truncated more lines of this cell, let's add an
+                                         * ellipsis. We first append it, but that might make our
+                                         * string grow above what we have space for, hence ellipsize
+                                         * right after. This will truncate the ellipsis and add a new
+                                         * one. */
 
-                                        buffer = ellipsize(field, width[j], /* ellipsize at the end if we truncated coming lines, otherwise honour configuration */
-                                                           lines_truncated ? 100 : d->ellipsize_percent);
+                                        padded = strjoin(field, special_glyph(SPECIAL_GLYPH_ELLIPSIS));
+                                        if (!padded)
+                                                return -ENOMEM;
+
+                                        buffer = ellipsize(padded, width[j], 100);
                                         if (!buffer)
                                                 return -ENOMEM;
 
                                         field = buffer;
-                                } else {
-                                        if (lines_truncated) {
-                                                _cleanup_free_ char *padded = NULL;
-
-                                                /* We truncated more lines of this cell, let's add an
-                                                 * ellipsis. We first append it, but that might make our
-                                                 * string grow above what we have space for, hence ellipsize
-                                                 * right after. This will truncate the ellipsis and add a new
-                                                 * one. */
-
-                                                padded = strjoin(field, special_glyph(SPECIAL_GLYPH_ELLIPSIS));
-                                                if (!padded)
-                                                        return -ENOMEM;
-
-                                                buffer = ellipsize(padded, width[j], 100);
-                                                if (!buffer)
-                                                        return -ENOMEM;
-
-                                                field = buffer;
-                                                l = utf8_console_width(field);
-                                        }
-
-                                        if (l < width[j]) {
-                                                _cleanup_free_ char *aligned = NULL;
-                                                /* Field is shorter than allocated space. Let's align with spaces */
-
-                                                aligned = align_string_mem(field, d->url, width[j], d->align_percent);
-                                                if (!aligned)
-                                                        return -ENOMEM;
-
-                                                free_and_replace(buffer, aligned);
-                                                field = buffer;
-                                        }
+                                        l = utf8_console_width(field);
                                 }
 
-                                if (l >= width[j] && d->url) {
-                                        _cleanup_free_ char *clickable = NULL;
+                                if (l < width[j]) {
+                                        _cleanup_free_ char *aligned = NULL;
+                                        /* Field is shorter than allocated space. Let's align with spaces */
 
-                                        r = terminal_urlify(d->url, field, &clickable);
-                                        if (r < 0)
-                                                return r;
+                                        aligned = align_string_mem(field, d->url, width[j], d->align_percent);
+                                        if (!aligned)
+                                                return -ENOMEM;
 
-                                        free_and_replace(buffer, clickable);
+                                        free_and_replace(buffer, aligned);
                                         field = buffer;
                                 }
+                        }
 
-                                if (colors_enabled()) {
-                                        if (gap_color)
-                                                fputs(gap_color, f);
-                                        else if (row == t->data) /* underline header line fully, including the column separator */
-                                                fputs(ansi_underline(), f);
-                                }
+                        if (l >= width[j] && d->url) {
+                                _cleanup_free_ char *clickable = NULL;
 
-                                if (j > 0)
-                                        fputc(' ', f); /* column separator left of cell */
+                                r = terminal_urlify(d->url, field, &clickable);
+                                if (r < 0)
+                                        return r;
 
-                                if (colors_enabled()) {
-                                        color = table_data_color(d);
+                                free_and_replace(buffer, clickable);
+                                field = buffer;
+                        }
 
-                                        /* Undo gap color */
-                                        if (gap_color || (color && row == t->data))
-                                                fputs(ANSI_NORMAL, f);
+                        if (colors_enabled()) {
+                                if (gap_color)
+                                        fputs(gap_color, f);
+                                else if (row == t->data) /* underline header line fully, including the column separator */
+                                        fputs(ansi_underline(), f);
+                        }
 
-                                        if (color)
-                                                fputs(color, f);
-                                        else if (gap_color && row == t->data) /* underline header line cell */
-                                                fputs(ansi_underline(), f);
-                                }
+                        if (j > 0)
+                                fputc(' ', f); /* column separator left of cell */
 
-                                fputs(field, f);
+                        if (colors_enabled()) {
+                                color = table_data_color(d);
 
-                                if (colors_enabled() && (color || row == t->data))
+                                /* Undo gap color */
+                                if (gap_color || (color && row == t->data))
                                         fputs(ANSI_NORMAL, f);
 
-                                gap_color = table_data_rgap_color(d);
+                                if (color)
+                                        fputs(color, f);
+                                else if (gap_color && row == t->data) /* underline header line cell */
+                                        fputs(ansi_underline(), f);
                         }
 
-                        fputc('\n', f);
-                        n_subline ++;
-                } while (more_sublines);
+                        fputs(field, f);
+
+                        if (colors_enabled() && (color || row == t->data))
+                                fputs(ANSI_NORMAL, f);
+
+                        gap_color = table_data_rgap_color(d);
+                }
+
+                fputc('\n', f);
+                n_subline ++;
+        } while (more_sublines);
+
+        return 0;
+}
+
+static int table_stream_flush(Table *t, FILE *f) {
+        size_t display_columns, n_rows, i;
+        int r;
+
+        assert(t);
+        assert(f);
+        assert(t->n_cells % t->n_columns == 0);
+
+        /* Writes out all complete rows not written out yet, and drops them from memory, see
+         * table_set_stream(). The first time around the column widths are determined from the rows
+         * collected so far, and stay fixed afterwards. */
+
+        n_rows = t->n_cells / t->n_columns;
+        display_columns = table_display_columns(t);
+
+        if (!t->stream_width) {
+                _cleanup_free_ size_t *width = NULL;
+                _cleanup_free_ bool *grow = NULL;
+
+                width = new(size_t, display_columns);
+                grow = new(bool, display_columns);
+                if (!width || !grow)
+                        return -ENOMEM;
+
+                r = table_compute_widths(t, display_columns, width, grow);
+                if (r < 0)
+                        return r;
+
+                t->stream_width = TAKE_PTR(width);
+                t->stream_grow = TAKE_PTR(grow);
+                t->n_stream_width = display_columns;
+
+                i = t->header ? 0 : 1;
+        } else
+                i = t->stream_have_last ? 2 : 1;
+
+        /* The set of displayed columns may not change once we started writing */
+        assert(t->n_stream_width == display_columns);
+
+        for (; i < n_rows; i++) {
+                r = table_print_row(t, f, t->data + i * t->n_columns, display_columns, t->stream_width, t->stream_grow);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Drop all rows but the header and the last one. The latter is kept (but not written again), since
+         * table_add_cell_full() copies formatting parameters of new cells from the row above. */
+        if (n_rows > 2) {
+                for (i = t->n_columns; i < t->n_cells - t->n_columns; i++)
+                        table_data_unref(t->data[i]);
+
+                memmove(t->data + t->n_columns, t->data + t->n_cells - t->n_columns, t->n_columns * sizeof(TableData*));
+                t->n_cells = 2 * t->n_columns;
+        }
+
+        t->stream_have_last = t->n_cells > t->n_columns;
+
+        return fflush_and_check(f);
+}
+
+int table_print(Table *t, FILE *f) {
+        size_t n_rows, display_columns, i, *width;
+        _cleanup_free_ size_t *sorted = NULL;
+        int r;
+
+        assert(t);
+
+        if (!f)
+                f = stdout;
+
+        /* Ensure we have no incomplete rows */
+        assert(t->n_cells % t->n_columns == 0);
+
+        n_rows = t->n_cells / t->n_columns;
+        assert(n_rows > 0); /* at least the header row must be complete */
+
+        /* If we already started streaming rows, write out the rest with the same column widths */
+        if (t->stream_width)
+                return table_stream_flush(t, f);
+
+        if (t->sort_map) {
+                /* If sorting is requested, let's calculate an index table we use to lookup the actual index to display with. */
+
+                sorted = new(size_t, n_rows);
+                if (!sorted)
+                        return -ENOMEM;
+
+                for (i = 0; i < n_rows; i++)
+                        sorted[i] = i * t->n_columns;
+
+                typesafe_qsort_r(sorted, n_rows, table_data_compare, t);
+        }
+
+        display_columns = table_display_columns(t);
+        assert(display_columns > 0);
+
+        width = newa(size_t, display_columns);
+
+        r = table_compute_widths(t, display_columns, width, NULL);
+        if (r < 0)
+                return r;
+
+        /* Second pass: show output */
+        for (i = t->header ? 0 : 1; i < n_rows; i++) {
+                TableData **row;
+
+                if (sorted)
+                        row = t->data + sorted[i];
+                else
+                        row = t->data + i * t->n_columns;
+
+                r = table_print_row(t, f, row, display_columns, width, NULL);
+                if (r < 0)
+                        return r;
         }
 
         return fflush_and_check(f);
@@ -219,6 +219,10 @@ static int process_special_field(JournalImporter *imp, char *line) {
 
         assert(line);
 
+        /* All special fields start with an underscore, most lines don't: skip the comparisons below. */
+        if (line[0] != '_')
+                return 0;
+
         value = startswith(line, "__CURSOR=");
         if (value)
                 /* ignore __CURSOR */
@@ -4,6 +4,7 @@
 #include <locale.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdio_ext.h>
 #include <stdlib.h>
 #include <sys/types.h>
 
@@ -1769,6 +1770,72 @@ int json_variant_format(JsonVariant *v, JsonFormatFlags flags, char **ret) {
         return (int) sz - 1;
 }
 
+typedef struct JsonAppendBuffer {
+        char **buf;
+        size_t *allocated;
+        size_t *size;
+} JsonAppendBuffer;
+
+static ssize_t json_append_buffer_write(void *userdata, const char *p, size_t n) {
+        JsonAppendBuffer *b = userdata;
+
+        if (!GREEDY_REALLOC(*b->buf, *b->allocated, *b->size + n)) {
+                errno = ENOMEM;
+                return -1;
+        }
+
+        memcpy(*b->buf + *b->size, p, n);
+        *b->size += n;
+
+        return n;
+}
+
+int json_variant_format_append(JsonVariant *v, JsonFormatFlags flags, char **buf, size_t *allocated, size_t *size) {
+        JsonAppendBuffer b = {
+                .buf = buf,
+                .allocated = allocated,
+                .size = size,
+        };
+        size_t previous;
+        int r;
+
+        /* Like json_variant_format(), but appends the formatted string including the terminating NUL to the
+         * first *size bytes of *buf, growing the buffer as needed, instead of allocating a new string for
+         * it. This allows callers to keep one buffer around for many variants. Returns the length of the
+         * appended string (without the terminating NUL). On failure the size is left as it was. */
+
+        assert_return(v, -EINVAL);
+        assert_return(buf, -EINVAL);
+        assert_return(allocated, -EINVAL);
+        assert_return(size, -EINVAL);
+
+        previous = *size;
+
+        {
+                _cleanup_fclose_ FILE *f = NULL;
+
+                f = fopencookie(&b, "w", (cookie_io_functions_t) {
+                                .write = json_append_buffer_write,
+                        });
+                if (!f)
+                        return -ENOMEM;
+
+                (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+
+                json_variant_dump(v, flags, f, NULL);
+                fputc('\0', f);
+
+                r = fflush_and_check(f);
+        }
+        if (r < 0) {
+                *size = previous;
+                return r;
+        }
+
+        assert(*size > previous);
+        return (int) (*size - previous - 1);
+}
+
 void json_variant_dump(JsonVariant *v, JsonFormatFlags flags, FILE *f, const char *prefix) {
         if (!v)
                 return;
@@ -192,16 +192,6 @@ static int parse_fieldv(const void *data, size_t length, const ParseFieldVec *fi
         return 0;
 }
 
-static int field_set_test(const Set *fields, const char *name, size_t n) {
-        char *s;
-
-        if (!fields)
-                return 1;
-
-        s = strndupa(name, n);
-        return set_contains(fields, s);
-}
-
 static bool shall_print(const char *p, size_t l, OutputFlags flags) {
         assert(p);
 
@@ -691,7 +681,7 @@ static int output_verbose(
                 timestamp ?: "(no timestamp)",
                 cursor);
 
-        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+        JOURNAL_FOREACH_DATA_FILTERED_RETVAL(j, output_fields, data, length, r) {
                 const char *c, *p;
                 int fieldlen;
                 const char *on = "", *off = "";
@@ -704,12 +694,6 @@ static int output_verbose(
                                                "Invalid field.");
                 fieldlen = c - (const char*) data;
 
-                r = field_set_test(output_fields, data, fieldlen);
-                if (r < 0)
-                        return r;
-                if (r == 0)
-                        continue;
-
                 valuelen = length - 1 - fieldlen;
 
                 if ((flags & OUTPUT_COLOR) && (p = startswith(data, "MESSAGE="))) {
@@ -795,7 +779,7 @@ static int output_export(
                 monotonic,
                 sd_id128_to_string(boot_id, sid));
 
-        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+        JOURNAL_FOREACH_DATA_FILTERED_RETVAL(j, output_fields, data, length, r) {
                 const char *c;
 
                 /* We already printed the boot id from the data in the header, hence let's suppress it here */
@@ -807,12 +791,6 @@ static int output_export(
                         return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                "Invalid field.");
 
-                r = field_set_test(output_fields, data, c - (const char *) data);
-                if (r < 0)
-                        return r;
-                if (!r)
-                        continue;
-
                 if (utf8_is_printable_newline(data, length, false))
                         fwrite(data, length, 1, f);
                 else {
@@ -1046,7 +1024,7 @@ static int output_json(
                 const void *data;
                 size_t size;
 
-                r = sd_journal_enumerate_data(j, &data, &size);
+                r = journal_enumerate_data_filtered(j, output_fields, &data, &size);
                 if (r == -EBADMSG) {
                         log_debug_errno(r, "Skipping message we can't read: %m");
                         r = 0;
@@ -1233,6 +1211,302 @@ static int output_cat(
         return 0;
 }
 
+/* Entries are collected into batches of at most this many rows or bytes, before they are written out in
+ * columnar form. */
+#define OUTPUT_COLUMNS_BATCH_ROWS 4096U
+#define OUTPUT_COLUMNS_BATCH_BYTES (4U*1024U*1024U)
+
+#define OUTPUT_COLUMNS_MAGIC "JRNLCOL1"
+
+typedef struct OutputColumn {
+        char *name;
+
+        uint64_t *counts;       /* number of values per row */
+        size_t n_counts_allocated;
+
+        uint64_t *lengths;      /* length of each value */
+        size_t n_lengths, n_lengths_allocated;
+
+        char *data;             /* all values, concatenated */
+        size_t n_data, n_data_allocated;
+} OutputColumn;
+
+struct OutputColumns {
+        Set *fields;
+        OrderedHashmap *columns;
+        size_t n_rows;
+        size_t n_bytes;
+};
+
+static OutputColumn* output_column_free(OutputColumn *c) {
+        if (!c)
+                return NULL;
+
+        free(c->name);
+        free(c->counts);
+        free(c->lengths);
+        free(c->data);
+
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(OutputColumn*, output_column_free);
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(output_column_hash_ops, char, string_hash_func, string_compare_func,
+                                              OutputColumn, output_column_free);
+
+static void output_columns_done(OutputColumns *c) {
+        assert(c);
+
+        c->columns = ordered_hashmap_free(c->columns);
+        c->n_rows = c->n_bytes = 0;
+}
+
+OutputColumns* output_columns_free(OutputColumns *c) {
+        if (!c)
+                return NULL;
+
+        output_columns_done(c);
+        set_free(c->fields);
+
+        return mfree(c);
+}
+
+int output_columns_new(char **output_fields, OutputColumns **ret) {
+        _cleanup_(output_columns_freep) OutputColumns *c = NULL;
+        int r;
+
+        assert(ret);
+
+        c = new0(OutputColumns, 1);
+        if (!c)
+                return -ENOMEM;
+
+        r = set_put_strdupv(&c->fields, output_fields);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(c);
+        return 0;
+}
+
+static int output_columns_add_value(OutputColumns *c, const char *name, size_t name_len, const void *value, size_t size) {
+        OutputColumn *column;
+        int r;
+
+        assert(c);
+        assert(name);
+        assert(value || size == 0);
+
+        column = ordered_hashmap_get(c->columns, strndupa(name, name_len));
+        if (!column) {
+                _cleanup_(output_column_freep) OutputColumn *n = NULL;
+
+                r = ordered_hashmap_ensure_allocated(&c->columns, &output_column_hash_ops);
+                if (r < 0)
+                        return r;
+
+                n = new0(OutputColumn, 1);
+                if (!n)
+                        return -ENOMEM;
+
+                n->name = strndup(name, name_len);
+                if (!n->name)
+                        return -ENOMEM;
+
+                r = ordered_hashmap_put(c->columns, n->name, n);
+                if (r < 0)
+                        return r;
+
+                column = TAKE_PTR(n);
+        }
+
+        /* Rows this column had no values for are left zeroed */
+        if (!GREEDY_REALLOC0(column->counts, column->n_counts_allocated, c->n_rows + 1))
+                return -ENOMEM;
+        if (!GREEDY_REALLOC(column->lengths, column->n_lengths_allocated, column->n_lengths + 1))
+                return -ENOMEM;
+        if (!GREEDY_REALLOC(column->data, column->n_data_allocated, column->n_data + size))
+                return -ENOMEM;
+
+        column->counts[c->n_rows]++;
+        column->lengths[column->n_lengths++] = size;
+        memcpy_safe(column->data + column->n_data, value, size);
+        column->n_data += size;
+
+        c->n_bytes += size;
+        return 0;
+}
+
+static int output_columns_add_string(OutputColumns *c, const char *name, const char *value) {
+        return output_columns_add_value(c, name, strlen(name), value, strlen(value));
+}
+
+int output_columns_add_entry(OutputColumns *c, sd_journal *j) {
+        char sid[SD_ID128_STRING_MAX], usecbuf[DECIMAL_STR_MAX(usec_t)];
+        _cleanup_free_ char *cursor = NULL;
+        usec_t realtime, monotonic;
+        sd_id128_t boot_id;
+        const void *data;
+        size_t length;
+        int r;
+
+        assert(c);
+        assert(j);
+
+        sd_journal_set_data_threshold(j, 0);
+
+        r = sd_journal_get_realtime_usec(j, &realtime);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get realtime timestamp: %m");
+
+        r = sd_journal_get_monotonic_usec(j, &monotonic, &boot_id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
+
+        r = sd_journal_get_cursor(j, &cursor);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get cursor: %m");
+
+        r = output_columns_add_string(c, "__CURSOR", cursor);
+        if (r < 0)
+                return log_oom();
+
+        xsprintf(usecbuf, USEC_FMT, realtime);
+        r = output_columns_add_string(c, "__REALTIME_TIMESTAMP", usecbuf);
+        if (r < 0)
+                return log_oom();
+
+        xsprintf(usecbuf, USEC_FMT, monotonic);
+        r = output_columns_add_string(c, "__MONOTONIC_TIMESTAMP", usecbuf);
+        if (r < 0)
+                return log_oom();
+
+        r = output_columns_add_string(c, "_BOOT_ID", sd_id128_to_string(boot_id, sid));
+        if (r < 0)
+                return log_oom();
+
+        /* Fields not selected are skipped without looking at their (possibly compressed) contents */
+        JOURNAL_FOREACH_DATA_FILTERED_RETVAL(j, c->fields, data, length, r) {
+                const char *eq;
+
+                /* We already added the boot id from the entry header above */
+                if (memory_startswith(data, length, "_BOOT_ID="))
+                        continue;
+
+                eq = memchr(data, '=', length);
+                if (!eq)
+                        return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Invalid field.");
+
+                r = output_columns_add_value(c, data, eq - (const char*) data,
+                                             eq + 1, length - (eq - (const char*) data) - 1);
+                if (r < 0)
+                        return log_oom();
+        }
+        if (r == -EBADMSG)
+                log_debug_errno(r, "Skipping remaining fields of message we can't read: %m");
+        else if (r < 0)
+                return log_error_errno(r, "Failed to read journal: %m");
+
+        c->n_rows++;
+
+        return c->n_rows >= OUTPUT_COLUMNS_BATCH_ROWS || c->n_bytes >= OUTPUT_COLUMNS_BATCH_BYTES;
+}
+
+static void fwrite_le64(FILE *f, const uint64_t *p, size_t n) {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        fwrite(p, sizeof(uint64_t), n, f);
+#else
+        for (size_t i = 0; i < n; i++) {
+                le64_t le = htole64(p[i]);
+                fwrite(&le, sizeof(le), 1, f);
+        }
+#endif
+}
+
+int output_columns_flush(OutputColumns *c, FILE *f) {
+        OutputColumn *column;
+        Iterator i;
+        uint64_t h[2];
+
+        assert(c);
+        assert(f);
+
+        /* Writes out the current batch. All integers are unsigned 64bit little endian. A batch starts with
+         * the magic, followed by the number of rows and the number of columns. Each column then consists of
+         * the length of its name, its number of values and the total size of its values, followed by the
+         * name, the number of values in each row, the length of each value and finally all values
+         * concatenated. A row may have no, one or more values for a column, since journal entries may lack
+         * fields as well as carry the same field more than once. */
+
+        if (c->n_rows == 0)
+                return 0;
+
+        ORDERED_HASHMAP_FOREACH(column, c->columns, i)
+                if (column->n_lengths == 0)
+                        output_column_free(ordered_hashmap_remove(c->columns, column->name));
+
+        fputs(OUTPUT_COLUMNS_MAGIC, f);
+        h[0] = c->n_rows;
+        h[1] = ordered_hashmap_size(c->columns);
+        fwrite_le64(f, h, ELEMENTSOF(h));
+
+        ORDERED_HASHMAP_FOREACH(column, c->columns, i) {
+                uint64_t m[3] = {
+                        strlen(column->name),
+                        column->n_lengths,
+                        column->n_data,
+                };
+
+                /* Make sure there's a (zero) count for each row, also for the ones after the last one this
+                 * column has a value in */
+                if (!GREEDY_REALLOC0(column->counts, column->n_counts_allocated, c->n_rows))
+                        return log_oom();
+
+                fwrite_le64(f, m, ELEMENTSOF(m));
+                fwrite(column->name, 1, m[0], f);
+                fwrite_le64(f, column->counts, c->n_rows);
+                fwrite_le64(f, column->lengths, column->n_lengths);
+                fwrite(column->data, 1, column->n_data, f);
+
+                /* Keep the allocations around for the next batch */
+                memzero(column->counts, c->n_rows * sizeof(uint64_t));
+                column->n_lengths = 0;
+                column->n_data = 0;
+        }
+
+        c->n_rows = 0;
+        c->n_bytes = 0;
+
+        return 0;
+}
+
+static int output_columnar(
+                FILE *f,
+                sd_journal *j,
+                OutputMode mode,
+                unsigned n_columns,
+                OutputFlags flags,
+                const Set *output_fields,
+                const size_t highlight[2]) {
+
+        OutputColumns c = {
+                .fields = (Set*) output_fields,
+        };
+        int r;
+
+        assert(j);
+
+        /* Writes a batch of a single row, for callers showing entries one by one. Use output_columns_new()
+         * and friends to get batches worth the name. */
+
+        r = output_columns_add_entry(&c, j);
+        if (r >= 0)
+                r = output_columns_flush(&c, f);
+
+        output_columns_done(&c);
+        return r;
+}
+
 static int (*output_funcs[_OUTPUT_MODE_MAX])(
                 FILE *f,
                 sd_journal *j,
@@ -1257,6 +1531,7 @@ static int (*output_funcs[_OUTPUT_MODE_MAX])(
         [OUTPUT_JSON_SEQ]          = output_json,
         [OUTPUT_CAT]               = output_cat,
         [OUTPUT_WITH_UNIT]         = output_short,
+        [OUTPUT_COLUMNAR]          = output_columnar,
 };
 
 int show_journal_entry(
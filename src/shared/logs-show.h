@@ -22,6 +22,14 @@ int show_journal_entry(
                 char **output_fields,
                 const size_t highlight[2],
                 bool *ellipsized);
+typedef struct OutputColumns OutputColumns;
+
+int output_columns_new(char **output_fields, OutputColumns **ret);
+OutputColumns* output_columns_free(OutputColumns *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(OutputColumns*, output_columns_free);
+int output_columns_add_entry(OutputColumns *c, sd_journal *j);
+int output_columns_flush(OutputColumns *c, FILE *f);
+
 int show_journal(
                 FILE *f,
                 sd_journal *j,
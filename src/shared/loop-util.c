@@ -15,12 +15,14 @@
 
 #include "alloc-util.h"
 #include "blockdev-util.h"
+#include "dirent-util.h"
 #include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "loop-util.h"
 #include "missing_loop.h"
 #include "parse-util.h"
+#include "path-util.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -259,6 +261,121 @@ int loop_device_make_by_path(const char *path, int open_flags, uint32_t loop_fla
         return loop_device_make(fd, open_flags, 0, 0, loop_flags, ret);
 }
 
+static int loop_device_find_attached(const struct stat *st, uint32_t loop_flags, LoopDevice **ret) {
+        _cleanup_closedir_ DIR *d = NULL;
+        struct dirent *de;
+
+        assert(st);
+        assert(ret);
+
+        /* Looks for an already attached loop device that is backed by the specified inode in its entirety,
+         * and was set up with the same flags. */
+
+        d = opendir("/sys/block");
+        if (!d)
+                return errno == ENOENT ? 0 : -errno;
+
+        FOREACH_DIRENT(de, d, return -errno) {
+                _cleanup_free_ char *sysfs = NULL, *loopdev = NULL;
+                _cleanup_close_ int loop = -1;
+                struct loop_info64 info;
+                struct stat lst;
+                LoopDevice *ld;
+
+                if (!startswith(de->d_name, "loop"))
+                        continue;
+
+                /* Only devices that are currently bound have this attribute */
+                sysfs = path_join("/sys/block", de->d_name, "loop/backing_file");
+                if (!sysfs)
+                        return -ENOMEM;
+                if (access(sysfs, F_OK) < 0)
+                        continue;
+
+                loopdev = path_join("/dev", de->d_name);
+                if (!loopdev)
+                        return -ENOMEM;
+
+                loop = open(loopdev, O_CLOEXEC|O_NONBLOCK|O_NOCTTY|O_RDONLY);
+                if (loop < 0)
+                        continue;
+
+                if (fstat(loop, &lst) < 0 || !S_ISBLK(lst.st_mode))
+                        continue;
+
+                /* Now that we hold an fd open the device can't be auto-cleared anymore under our feet, hence
+                 * check what it is bound to only now. */
+                if (ioctl(loop, LOOP_GET_STATUS64, &info) < 0)
+                        continue;
+
+#if HAVE_VALGRIND_MEMCHECK_H
+                VALGRIND_MAKE_MEM_DEFINED(&info, sizeof(info));
+#endif
+
+                if (info.lo_device != st->st_dev ||
+                    info.lo_inode != st->st_ino ||
+                    info.lo_offset != 0 ||
+                    info.lo_sizelimit != 0 ||
+                    info.lo_flags != loop_flags)
+                        continue;
+
+                ld = new(LoopDevice, 1);
+                if (!ld)
+                        return -ENOMEM;
+
+                *ld = (LoopDevice) {
+                        .fd = TAKE_FD(loop),
+                        .nr = info.lo_number,
+                        .node = TAKE_PTR(loopdev),
+                        .relinquished = true, /* Shared with others, leave the clean-up to auto-clear */
+                };
+
+                *ret = ld;
+                return 1;
+        }
+
+        return 0;
+}
+
+int loop_device_make_by_path_shared(const char *path, uint32_t loop_flags, LoopDevice **ret) {
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        /* Like loop_device_make_by_path() with O_RDONLY, but if there's already a read-only loop device
+         * attached to the same file with the same flags, use that instead of allocating a new one. This
+         * is useful when many units use the same image, so that they share a single block device (and
+         * thus the page cache and dm-verity device on top of it). The returned object is always
+         * relinquished, as we might not be its only user. */
+
+        fd = open(path, O_CLOEXEC|O_NONBLOCK|O_NOCTTY|O_RDONLY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (S_ISREG(st.st_mode)) {
+                r = loop_device_find_attached(&st, (loop_flags & ~LO_FLAGS_READ_ONLY) | LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR, ret);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to look for existing loop device for %s, ignoring: %m", path);
+                else if (r > 0) {
+                        log_debug("Reusing loop device %s for %s.", (*ret)->node, path);
+                        return (*ret)->fd;
+                }
+        }
+
+        r = loop_device_make(fd, O_RDONLY, 0, 0, loop_flags, ret);
+        if (r < 0)
+                return r;
+
+        (*ret)->relinquished = true;
+        return r;
+}
+
 LoopDevice* loop_device_unref(LoopDevice *d) {
         if (!d)
                 return NULL;
@@ -88,7 +88,9 @@ static int get_mount_flags(
          * in place (which provides us with mostly the same info), but it's just a fallback, since using it
          * means triggering autofs or NFS mounts, which we'd rather avoid needlessly. */
 
-        fs = mnt_table_find_target(table, path, MNT_ITER_FORWARD);
+        /* Search backwards, so that we find the top-most mount if the path is over-mounted, i.e. the one
+         * that is actually visible and that a remount will affect. */
+        fs = mnt_table_find_target(table, path, MNT_ITER_BACKWARD);
         if (!fs) {
                 log_debug("Could not find '%s' in mount table, ignoring.", path);
                 goto fallback;
@@ -299,7 +301,12 @@ int bind_remount_recursive_with_mountinfo(
 
                         /* Try to reuse the original flag set */
                         orig_flags = 0;
-                        (void) get_mount_flags(table, x, &orig_flags);
+                        r = get_mount_flags(table, x, &orig_flags);
+                        if (r >= 0 && (orig_flags & flags_mask) == new_flags) {
+                                /* Submounts frequently are read-only already, save the remount then */
+                                log_debug("%s already has the desired mount flags, not remounting.", x);
+                                continue;
+                        }
 
                         if (mount(NULL, x, NULL, (orig_flags & ~flags_mask)|MS_BIND|MS_REMOUNT|new_flags, NULL) < 0)
                                 return -errno;
@@ -349,7 +356,9 @@ int bind_remount_one_with_mountinfo(
                 return r;
 
         /* Try to reuse the original flag set */
-        (void) get_mount_flags(table, path, &orig_flags);
+        r = get_mount_flags(table, path, &orig_flags);
+        if (r >= 0 && (orig_flags & flags_mask) == new_flags)
+                return 0; /* Nothing to change */
 
         if (mount(NULL, path, NULL, (orig_flags & ~flags_mask)|MS_BIND|MS_REMOUNT|new_flags, NULL) < 0)
                 return -errno;
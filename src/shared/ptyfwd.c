@@ -23,6 +23,10 @@
 #include "terminal-util.h"
 #include "time-util.h"
 
+/* Input is typed by a human, but the output might be a lot, hence pick a larger buffer for that, so that we
+ * need fewer iterations to pass it on. */
+#define PTY_FORWARD_OUT_BUFFER_SIZE (64U*1024U)
+
 struct PTYForward {
         sd_event *event;
 
@@ -58,7 +62,7 @@ struct PTYForward {
         bool last_char_set:1;
         char last_char;
 
-        char in_buffer[LINE_MAX], out_buffer[LINE_MAX];
+        char in_buffer[LINE_MAX], out_buffer[PTY_FORWARD_OUT_BUFFER_SIZE];
         size_t in_buffer_full, out_buffer_full;
 
         usec_t escape_timestamp;
@@ -243,9 +247,9 @@ static int shovel(PTYForward *f) {
                         }
                 }
 
-                if (f->master_readable && f->out_buffer_full < LINE_MAX) {
+                if (f->master_readable && f->out_buffer_full < sizeof(f->out_buffer)) {
 
-                        k = read(f->master, f->out_buffer + f->out_buffer_full, LINE_MAX - f->out_buffer_full);
+                        k = read(f->master, f->out_buffer + f->out_buffer_full, sizeof(f->out_buffer) - f->out_buffer_full);
                         if (k < 0) {
 
                                 /* Note that EIO on the master device
@@ -2,6 +2,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 #include <linux/seccomp.h>
 #include <seccomp.h>
 #include <stddef.h>
@@ -9,12 +10,16 @@
 #include <sys/prctl.h>
 #include <sys/shm.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "af-list.h"
 #include "alloc-util.h"
 #include "env-util.h"
 #include "errno-list.h"
+#include "fd-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "nsflags.h"
 #include "nulstr-util.h"
 #include "process-util.h"
@@ -23,6 +28,10 @@
 #include "string-util.h"
 #include "strv.h"
 
+#ifndef SECCOMP_FILTER_FLAG_LOG
+#define SECCOMP_FILTER_FLAG_LOG (1UL << 1)
+#endif
+
 const uint32_t seccomp_local_archs[] = {
 
         /* Note: always list the native arch we are compiled as last, so that users can deny-list seccomp(), but our own calls to it still succeed */
@@ -1046,6 +1055,55 @@ int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilter
         return 0;
 }
 
+static int seccomp_build_syscall_filter_for_arch(
+                uint32_t arch,
+                uint32_t default_action,
+                Hashmap *set,
+                uint32_t action,
+                bool log_missing,
+                scmp_filter_ctx *ret) {
+
+        _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+        Iterator i;
+        void *syscall_id, *val;
+        int r;
+
+        assert(ret);
+
+        log_debug("Operating on architecture: %s", seccomp_arch_to_string(arch));
+
+        r = seccomp_init_for_arch(&seccomp, arch, default_action);
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH_KEY(val, syscall_id, set, i) {
+                uint32_t a = action;
+                int id = PTR_TO_INT(syscall_id) - 1;
+                int error = PTR_TO_INT(val);
+
+                if (action != SCMP_ACT_ALLOW && error >= 0)
+                        a = SCMP_ACT_ERRNO(error);
+
+                r = seccomp_rule_add_exact(seccomp, a, id, 0);
+                if (r < 0) {
+                        /* If the system call is not known on this architecture, then that's fine, let's ignore it */
+                        _cleanup_free_ char *n = NULL;
+                        bool ignore;
+
+                        n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
+                        ignore = r == -EDOM;
+                        if (!ignore || log_missing)
+                                log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
+                                                strna(n), id, ignore ? ", ignoring" : "");
+                        if (!ignore)
+                                return r;
+                }
+        }
+
+        *ret = TAKE_PTR(seccomp);
+        return 0;
+}
+
 int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* set, uint32_t action, bool log_missing) {
         uint32_t arch;
         int r;
@@ -1058,44 +1116,156 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* set, u
 
         SECCOMP_FOREACH_LOCAL_ARCH(arch) {
                 _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
-                Iterator i;
-                void *syscall_id, *val;
 
-                log_debug("Operating on architecture: %s", seccomp_arch_to_string(arch));
+                r = seccomp_build_syscall_filter_for_arch(arch, default_action, set, action, log_missing, &seccomp);
+                if (r < 0)
+                        return r;
 
-                r = seccomp_init_for_arch(&seccomp, arch, default_action);
+                r = seccomp_load(seccomp);
+                if (ERRNO_IS_SECCOMP_FATAL(r))
+                        return r;
+                if (r < 0)
+                        log_debug_errno(r, "Failed to install filter set for architecture %s, skipping: %m", seccomp_arch_to_string(arch));
+        }
+
+        return 0;
+}
+
+SeccompProgram *seccomp_program_free(SeccompProgram *p) {
+        if (!p)
+                return NULL;
+
+        for (size_t i = 0; i < p->n_filters; i++)
+                free(p->filters[i].insns);
+        free(p->filters);
+
+        return mfree(p);
+}
+
+static int seccomp_export(scmp_filter_ctx seccomp, struct SeccompProgramFilter *ret) {
+        _cleanup_free_ struct sock_filter *insns = NULL;
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        ssize_t n;
+        int r;
+
+        assert(seccomp);
+        assert(ret);
+
+        /* libseccomp can only write the generated program into an fd, hence bounce it through a memfd */
+
+        fd = memfd_new("seccomp-bpf");
+        if (fd < 0)
+                return fd;
+
+        r = seccomp_export_bpf(seccomp, fd);
+        if (r < 0)
+                return r;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+        if (st.st_size <= 0 ||
+            st.st_size % sizeof(struct sock_filter) != 0 ||
+            st.st_size / sizeof(struct sock_filter) > BPF_MAXINSNS)
+                return -EBADMSG;
+
+        insns = malloc(st.st_size);
+        if (!insns)
+                return -ENOMEM;
+
+        n = pread(fd, insns, st.st_size, 0);
+        if (n < 0)
+                return -errno;
+        if (n != st.st_size)
+                return -EIO;
+
+        *ret = (struct SeccompProgramFilter) {
+                .n_insns = st.st_size / sizeof(struct sock_filter),
+                .insns = TAKE_PTR(insns),
+        };
+
+#if SCMP_VER_MAJOR >= 3 || (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 4)
+        uint32_t log = 0;
+
+        if (seccomp_attr_get(seccomp, SCMP_FLTATR_CTL_LOG, &log) >= 0 && log)
+                ret->flags |= SECCOMP_FILTER_FLAG_LOG;
+#endif
+
+        return 0;
+}
+
+int seccomp_compile_syscall_filter_set_raw(
+                uint32_t default_action,
+                Hashmap *set,
+                uint32_t action,
+                bool log_missing,
+                SeccompProgram **ret) {
+
+        _cleanup_(seccomp_program_freep) SeccompProgram *p = NULL;
+        uint32_t arch;
+        int r;
+
+        /* Like seccomp_load_syscall_filter_set_raw(), but instead of loading the filters right-away
+         * generates the BPF programs for all local architectures, so that they can be loaded later with
+         * seccomp_program_load(), possibly many times and from a different process. */
+
+        assert(ret);
+
+        p = new0(SeccompProgram, 1);
+        if (!p)
+                return -ENOMEM;
+
+        if (hashmap_isempty(set) && default_action == SCMP_ACT_ALLOW) {
+                *ret = TAKE_PTR(p);
+                return 0;
+        }
+
+        p->filters = new0(struct SeccompProgramFilter, ELEMENTSOF(seccomp_local_archs));
+        if (!p->filters)
+                return -ENOMEM;
+
+        SECCOMP_FOREACH_LOCAL_ARCH(arch) {
+                _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+
+                r = seccomp_build_syscall_filter_for_arch(arch, default_action, set, action, log_missing, &seccomp);
                 if (r < 0)
                         return r;
 
-                HASHMAP_FOREACH_KEY(val, syscall_id, set, i) {
-                        uint32_t a = action;
-                        int id = PTR_TO_INT(syscall_id) - 1;
-                        int error = PTR_TO_INT(val);
+                r = seccomp_export(seccomp, p->filters + p->n_filters);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to generate filter for architecture %s: %m", seccomp_arch_to_string(arch));
 
-                        if (action != SCMP_ACT_ALLOW && error >= 0)
-                                a = SCMP_ACT_ERRNO(error);
+                p->filters[p->n_filters++].arch = arch;
+        }
 
-                        r = seccomp_rule_add_exact(seccomp, a, id, 0);
-                        if (r < 0) {
-                                /* If the system call is not known on this architecture, then that's fine, let's ignore it */
-                                _cleanup_free_ char *n = NULL;
-                                bool ignore;
-
-                                n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
-                                ignore = r == -EDOM;
-                                if (!ignore || log_missing)
-                                        log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
-                                                        strna(n), id, ignore ? ", ignoring" : "");
-                                if (!ignore)
-                                        return r;
-                        }
-                }
+        *ret = TAKE_PTR(p);
+        return 0;
+}
 
-                r = seccomp_load(seccomp);
+int seccomp_program_load(const SeccompProgram *p) {
+        int r;
+
+        assert(p);
+
+        /* Loads the filters in the same order and with the same treatment of failures as
+         * seccomp_load_syscall_filter_set_raw() does. NNP is not touched, as in seccomp_init_for_arch(). */
+
+        for (size_t i = 0; i < p->n_filters; i++) {
+                const struct SeccompProgramFilter *f = p->filters + i;
+                struct sock_fprog prog = {
+                        .len = f->n_insns,
+                        .filter = f->insns,
+                };
+
+                if (f->flags == 0)
+                        r = prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0);
+                else
+                        r = syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, f->flags, &prog);
+                r = r < 0 ? -errno : 0;
                 if (ERRNO_IS_SECCOMP_FATAL(r))
                         return r;
                 if (r < 0)
-                        log_debug_errno(r, "Failed to install filter set for architecture %s, skipping: %m", seccomp_arch_to_string(arch));
+                        log_debug_errno(r, "Failed to install filter set for architecture %s, skipping: %m", seccomp_arch_to_string(f->arch));
         }
 
         return 0;
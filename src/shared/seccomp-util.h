@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 #pragma once
 
+#include <linux/filter.h>
 #include <seccomp.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -71,6 +72,23 @@ int seccomp_add_syscall_filter_item(
 int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilterSet *set, uint32_t action, bool log_missing);
 int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* set, uint32_t action, bool log_missing);
 
+/* A syscall filter compiled to BPF, one program per local architecture */
+typedef struct SeccompProgram {
+        struct SeccompProgramFilter {
+                uint32_t arch;
+                unsigned flags;        /* SECCOMP_FILTER_FLAG_xyz */
+                size_t n_insns;
+                struct sock_filter *insns;
+        } *filters;
+        size_t n_filters;
+} SeccompProgram;
+
+SeccompProgram *seccomp_program_free(SeccompProgram *p);
+DEFINE_TRIVIAL_CLEANUP_FUNC(SeccompProgram*, seccomp_program_free);
+
+int seccomp_compile_syscall_filter_set_raw(uint32_t default_action, Hashmap* set, uint32_t action, bool log_missing, SeccompProgram **ret);
+int seccomp_program_load(const SeccompProgram *p);
+
 typedef enum SeccompParseFlags {
         SECCOMP_PARSE_INVERT     = 1 << 0,
         SECCOMP_PARSE_ALLOW_LIST = 1 << 1,
@@ -131,6 +131,22 @@ int serialize_strv(FILE *f, const char *key, char **l) {
         return ret;
 }
 
+int deserialize_read_line(FILE *f, char **ret) {
+        int r;
+
+        assert(f);
+        assert(ret);
+
+        /* Serializations are read from a memfd or an unlinked temporary file, never from a TTY, hence tell
+         * read_line() so, which saves an isatty() call for each line. Returns 0 on EOF. */
+
+        r = read_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, ret);
+        if (r < 0)
+                return log_error_errno(r, "Failed to read serialization line: %m");
+
+        return r;
+}
+
 int deserialize_usec(const char *value, usec_t *ret) {
         int r;
 
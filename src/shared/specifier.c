@@ -40,6 +40,16 @@ int specifier_printf(const char *text, const Specifier table[], const void *user
         assert(text);
         assert(table);
 
+        /* Nothing to expand, skip the buffer juggling below */
+        if (!strchr(text, '%')) {
+                ret = strdup(text);
+                if (!ret)
+                        return -ENOMEM;
+
+                *_ret = TAKE_PTR(ret);
+                return 0;
+        }
+
         l = strlen(text);
         if (!GREEDY_REALLOC(ret, allocated, l + 1))
                 return -ENOMEM;
@@ -58,18 +68,26 @@ int specifier_printf(const char *text, const Specifier table[], const void *user
 
                                 if (i->lookup) {
                                         _cleanup_free_ char *w = NULL;
+                                        const char *v;
                                         size_t k, j;
 
-                                        r = i->lookup(i->specifier, i->data, userdata, &w);
-                                        if (r < 0)
-                                                return r;
+                                        /* Plain strings are copied in directly, without a temporary copy */
+                                        if (i->lookup == specifier_string)
+                                                v = strempty(i->data);
+                                        else {
+                                                r = i->lookup(i->specifier, i->data, userdata, &w);
+                                                if (r < 0)
+                                                        return r;
+
+                                                v = w;
+                                        }
 
                                         j = t - ret;
-                                        k = strlen(w);
+                                        k = strlen(v);
 
                                         if (!GREEDY_REALLOC(ret, allocated, j + k + l + 1))
                                                 return -ENOMEM;
-                                        memcpy(ret + j, w, k);
+                                        memcpy(ret + j, v, k);
                                         t = ret + j + k;
                                 } else if (strchr(POSSIBLE_SPECIFIERS, *f))
                                         /* Oops, an unknown specifier. */
@@ -234,6 +252,49 @@ int specifier_os_variant_id(char specifier, const void *data, const void *userda
         return specifier_os_release_common("VARIANT_ID", ret);
 }
 
+void specifier_cache_populate(SpecifierCache *c) {
+        _cleanup_free_ char *os_id = NULL, *os_version_id = NULL, *os_build_id = NULL, *os_variant_id = NULL;
+
+        assert(c);
+
+        if (c->populated)
+                return;
+
+        (void) specifier_machine_id('m', NULL, NULL, &c->machine_id);
+        (void) specifier_boot_id('b', NULL, NULL, &c->boot_id);
+        (void) specifier_kernel_release('v', NULL, NULL, &c->kernel_release);
+        (void) specifier_architecture('a', NULL, NULL, &c->architecture);
+
+        /* Read os-release only once for all fields, rather than once per field */
+        if (parse_os_release(NULL,
+                             "ID", &os_id,
+                             "VERSION_ID", &os_version_id,
+                             "BUILD_ID", &os_build_id,
+                             "VARIANT_ID", &os_variant_id,
+                             NULL) >= 0) {
+                c->os_id = TAKE_PTR(os_id) ?: strdup("");
+                c->os_version_id = TAKE_PTR(os_version_id) ?: strdup("");
+                c->os_build_id = TAKE_PTR(os_build_id) ?: strdup("");
+                c->os_variant_id = TAKE_PTR(os_variant_id) ?: strdup("");
+        }
+
+        c->populated = true;
+}
+
+void specifier_cache_clear(SpecifierCache *c) {
+        assert(c);
+
+        c->machine_id = mfree(c->machine_id);
+        c->boot_id = mfree(c->boot_id);
+        c->kernel_release = mfree(c->kernel_release);
+        c->architecture = mfree(c->architecture);
+        c->os_id = mfree(c->os_id);
+        c->os_version_id = mfree(c->os_version_id);
+        c->os_build_id = mfree(c->os_build_id);
+        c->os_variant_id = mfree(c->os_variant_id);
+        c->populated = false;
+}
+
 int specifier_group_name(char specifier, const void *data, const void *userdata, char **ret) {
         char *t;
 
@@ -13,6 +13,27 @@ typedef struct Specifier {
 
 int specifier_printf(const char *text, const Specifier table[], const void *userdata, char **ret);
 
+/* Values of the host-wide specifiers, which don't change while a program runs, hence can be looked up once
+ * and then be used with specifier_string(). Values that failed to resolve are left unset, so that the
+ * ordinary lookup is used and reports the error. */
+typedef struct SpecifierCache {
+        bool populated;
+        char *machine_id;
+        char *boot_id;
+        char *kernel_release;
+        char *architecture;
+        char *os_id;
+        char *os_version_id;
+        char *os_build_id;
+        char *os_variant_id;
+} SpecifierCache;
+
+void specifier_cache_populate(SpecifierCache *c);
+void specifier_cache_clear(SpecifierCache *c);
+
+#define SPECIFIER_CACHED(c, value, lookup) \
+        { c, (value) ? specifier_string : (lookup), (value) }
+
 int specifier_string(char specifier, const void *data, const void *userdata, char **ret);
 
 int specifier_machine_id(char specifier, const void *data, const void *userdata, char **ret);
@@ -26,10 +26,11 @@ int udev_parse_config_full(
                 unsigned *ret_children_max,
                 usec_t *ret_exec_delay_usec,
                 usec_t *ret_event_timeout_usec,
+                usec_t *ret_watch_delay_usec,
                 ResolveNameTiming *ret_resolve_name_timing,
                 int *ret_timeout_signal) {
 
-        _cleanup_free_ char *log_val = NULL, *children_max = NULL, *exec_delay = NULL, *event_timeout = NULL, *resolve_names = NULL, *timeout_signal = NULL;
+        _cleanup_free_ char *log_val = NULL, *children_max = NULL, *exec_delay = NULL, *event_timeout = NULL, *watch_delay = NULL, *resolve_names = NULL, *timeout_signal = NULL;
         int r;
 
         r = parse_env_file(NULL, "/etc/udev/udev.conf",
@@ -37,6 +38,7 @@ int udev_parse_config_full(
                            "children_max", &children_max,
                            "exec_delay", &exec_delay,
                            "event_timeout", &event_timeout,
+                           "watch_delay", &watch_delay,
                            "resolve_names", &resolve_names,
                            "timeout_signal", &timeout_signal);
         if (r == -ENOENT)
@@ -87,6 +89,13 @@ int udev_parse_config_full(
                                    "failed to parse event_timeout=%s, ignoring: %m", event_timeout);
         }
 
+        if (ret_watch_delay_usec && watch_delay) {
+                r = parse_sec(watch_delay, ret_watch_delay_usec);
+                if (r < 0)
+                        log_syntax(NULL, LOG_WARNING, "/etc/udev/udev.conf", 0, r,
+                                   "failed to parse watch_delay=%s, ignoring: %m", watch_delay);
+        }
+
         if (ret_resolve_name_timing && resolve_names) {
                 ResolveNameTiming t;
 
@@ -1,15 +1,21 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include "dirent-util.h"
+#include "escape.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "macro.h"
+#include "parse-util.h"
 #include "path-lookup.h"
+#include "path-util.h"
 #include "set.h"
 #include "special.h"
 #include "stat-util.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 bool unit_type_may_alias(UnitType type) {
@@ -226,6 +232,317 @@ bool lookup_paths_mtime_good(const LookupPaths *lp, usec_t mtime) {
         return true;
 }
 
+#define NAME_MAP_CACHE_HEADER "# systemd unit name map v1"
+
+/* File systems may store timestamps with a granularity as coarse as this */
+#define NAME_MAP_CACHE_MTIME_GRANULARITY_USEC USEC_PER_SEC
+
+static int name_map_cache_path(const LookupPaths *lp, char **ret) {
+        _cleanup_free_ char *d = NULL;
+        char *p;
+
+        assert(lp);
+        assert(ret);
+
+        /* The name map is cached next to the transient directory, i.e. in /run/systemd/ for the system
+         * manager and in $XDG_RUNTIME_DIR/systemd/ for the user manager, where only the owner of the
+         * manager may write. Not when operating on a different root though. */
+
+        if (lp->root_dir || !lp->transient)
+                return -EOPNOTSUPP;
+
+        d = dirname_malloc(lp->transient);
+        if (!d)
+                return -ENOMEM;
+
+        p = path_join(d, "unit-name-map");
+        if (!p)
+                return -ENOMEM;
+
+        *ret = p;
+        return 0;
+}
+
+static int name_map_cache_put(FILE *f, const char *type, const char *a, const char *b) {
+        _cleanup_free_ char *x = NULL, *y = NULL;
+
+        /* Fields are separated by spaces, hence escape those */
+
+        x = xescape(a, " ");
+        if (!x)
+                return -ENOMEM;
+
+        if (b) {
+                y = xescape(b, " ");
+                if (!y)
+                        return -ENOMEM;
+        }
+
+        fprintf(f, "%s %s%s%s\n", type, x, y ? " " : "", strempty(y));
+        return 0;
+}
+
+static void name_map_cache_save(
+                const LookupPaths *lp,
+                const usec_t *dir_mtimes,
+                usec_t mtime,
+                Hashmap *ids,
+                Hashmap *names,
+                Set *paths) {
+
+        _cleanup_free_ char *fn = NULL, *temp = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *k, *v;
+        char **dir, **l, **a;
+        Iterator i;
+        usec_t n;
+        int r;
+
+        assert(lp);
+        assert(dir_mtimes);
+
+        /* Writes out the map, together with the mtimes of all directories of the search path, so that
+         * the next process looking at the same search path can skip enumerating the directories. Failure
+         * is not fatal, the cache is a pure optimization. */
+
+        if (name_map_cache_path(lp, &fn) < 0)
+                return;
+
+        /* A directory modified right before or while we enumerated it may be modified again without its
+         * mtime changing, and the cache would then hide that change forever. */
+        n = now(CLOCK_REALTIME);
+        STRV_FOREACH(dir, lp->search_path)
+                if (usec_add(dir_mtimes[dir - lp->search_path], NAME_MAP_CACHE_MTIME_GRANULARITY_USEC) > n) {
+                        log_debug("%s was modified just now, not caching unit name map.", *dir);
+                        return;
+                }
+
+        r = fopen_temporary(fn, &f, &temp);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to create temporary file for %s, not caching unit name map: %m", fn);
+                return;
+        }
+
+        (void) fchmod(fileno(f), 0644);
+
+        fputs(NAME_MAP_CACHE_HEADER "\n", f);
+        fprintf(f, "M " USEC_FMT "\n", mtime);
+
+        STRV_FOREACH(dir, lp->search_path) {
+                char t[STRLEN("D ") + DECIMAL_STR_MAX(usec_t)];
+
+                xsprintf(t, "D " USEC_FMT, dir_mtimes[dir - lp->search_path]);
+                r = name_map_cache_put(f, t, *dir, NULL);
+                if (r < 0)
+                        goto fail;
+        }
+
+        HASHMAP_FOREACH_KEY(v, k, ids, i) {
+                r = name_map_cache_put(f, "I", k, v);
+                if (r < 0)
+                        goto fail;
+        }
+
+        HASHMAP_FOREACH_KEY(l, k, names, i)
+                STRV_FOREACH(a, l) {
+                        r = name_map_cache_put(f, "N", k, *a);
+                        if (r < 0)
+                                goto fail;
+                }
+
+        SET_FOREACH(k, paths, i) {
+                r = name_map_cache_put(f, "P", k, NULL);
+                if (r < 0)
+                        goto fail;
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                goto fail;
+
+        if (rename(temp, fn) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        temp = mfree(temp);
+        log_debug("Saved unit name map to %s.", fn);
+        return;
+
+fail:
+        log_debug_errno(r, "Failed to write %s, ignoring: %m", fn);
+        if (temp)
+                (void) unlink(temp);
+}
+
+static int name_map_cache_load(
+                const LookupPaths *lp,
+                usec_t *ret_mtime,
+                Hashmap **ret_ids,
+                Hashmap **ret_names,
+                Set **ret_paths) {
+
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_set_free_free_ Set *paths = NULL;
+        _cleanup_free_ char *fn = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        usec_t mtime = USEC_INFINITY;
+        char **dir = lp->search_path;
+        struct stat st;
+        int r;
+
+        assert(lp);
+        assert(ret_mtime);
+        assert(ret_ids);
+        assert(ret_names);
+
+        /* Returns > 0 if the cached map could be used, 0 if it is missing or outdated. */
+
+        r = name_map_cache_path(lp, &fn);
+        if (r < 0)
+                return 0;
+
+        f = fopen(fn, "re");
+        if (!f) {
+                if (errno != ENOENT)
+                        log_debug_errno(errno, "Failed to open %s, ignoring: %m", fn);
+                return 0;
+        }
+
+        /* Only trust what we or the superuser wrote */
+        if (fstat(fileno(f), &st) < 0)
+                return 0;
+        if (!S_ISREG(st.st_mode) || (st.st_uid != 0 && st.st_uid != geteuid()))
+                return 0;
+
+        if (ret_paths) {
+                paths = set_new(&path_hash_ops_free);
+                if (!paths)
+                        return -ENOMEM;
+        }
+
+        for (unsigned n = 0;; n++) {
+                _cleanup_strv_free_ char **fields = NULL;
+                _cleanup_free_ char *line = NULL, *a = NULL, *b = NULL;
+                size_t n_fields;
+
+                r = read_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to read %s, ignoring: %m", fn);
+                if (r == 0)
+                        break;
+
+                if (n == 0) {
+                        if (!streq(line, NAME_MAP_CACHE_HEADER))
+                                return 0;
+                        continue;
+                }
+
+                fields = strv_split(line, " ");
+                if (!fields)
+                        return -ENOMEM;
+                n_fields = strv_length(fields);
+                if (n_fields < 2 || strlen(fields[0]) != 1)
+                        goto bad;
+
+                if (fields[0][0] == 'M') {
+                        if (n_fields != 2 || safe_atou64(fields[1], &mtime) < 0)
+                                goto bad;
+                        continue;
+                }
+
+                if (fields[0][0] == 'D') {
+                        usec_t m, current = 0;
+
+                        if (n_fields != 3 || safe_atou64(fields[1], &m) < 0)
+                                goto bad;
+                        if (cunescape(fields[2], 0, &a) < 0)
+                                goto bad;
+
+                        /* The directories must be the same and in the same order, and none may have
+                         * changed. Unlike lookup_paths_mtime_good() this includes the generator and
+                         * transient directories. */
+                        if (!dir || !*dir || !path_equal(*dir, a))
+                                return 0;
+
+                        if (stat(*dir, &st) >= 0)
+                                current = timespec_load(&st.st_mtim);
+                        else if (errno != ENOENT)
+                                return 0;
+                        if (current != m)
+                                return 0;
+
+                        dir++;
+                        continue;
+                }
+
+                /* The list of directories comes first */
+                if (dir && *dir)
+                        return 0;
+
+                if (cunescape(fields[1], 0, &a) < 0)
+                        goto bad;
+                if (n_fields > 2 && cunescape(fields[2], 0, &b) < 0)
+                        goto bad;
+
+                switch (fields[0][0]) {
+
+                case 'I':
+                        if (n_fields != 3)
+                                goto bad;
+                        r = hashmap_ensure_allocated(&ids, &fast_string_hash_ops_free_free);
+                        if (r < 0)
+                                return r;
+                        r = hashmap_put(ids, a, b);
+                        if (r == -EEXIST)
+                                goto bad;
+                        if (r < 0)
+                                return r;
+                        TAKE_PTR(a);
+                        TAKE_PTR(b);
+                        break;
+
+                case 'N':
+                        if (n_fields != 3)
+                                goto bad;
+                        r = string_strv_hashmap_put(&names, a, b);
+                        if (r < 0)
+                                return r;
+                        break;
+
+                case 'P':
+                        if (n_fields != 2)
+                                goto bad;
+                        if (paths) {
+                                r = set_consume(paths, TAKE_PTR(a));
+                                if (r < 0)
+                                        return r;
+                        }
+                        break;
+
+                default:
+                        goto bad;
+                }
+        }
+
+        if (mtime == USEC_INFINITY || (dir && *dir))
+                return 0;
+
+        log_debug("Loaded unit name map from %s.", fn);
+
+        *ret_mtime = mtime;
+        hashmap_free_and_replace(*ret_ids, ids);
+        hashmap_free_and_replace(*ret_names, names);
+        if (ret_paths)
+                set_free_and_replace(*ret_paths, paths);
+
+        return 1;
+
+bad:
+        log_debug("%s is corrupted, ignoring.", fn);
+        return 0;
+}
+
 int unit_file_build_name_map(
                 const LookupPaths *lp,
                 usec_t *cache_mtime,
@@ -245,6 +562,8 @@ int unit_file_build_name_map(
 
         _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
         _cleanup_set_free_free_ Set *paths = NULL;
+        _cleanup_free_ usec_t *dir_mtimes = NULL;
+        bool cacheable = true;
         char **dir;
         int r;
         usec_t mtime = 0;
@@ -254,12 +573,35 @@ int unit_file_build_name_map(
         if (cache_mtime && *cache_mtime > 0 && lookup_paths_mtime_good(lp, *cache_mtime))
                 return 0;
 
-        if (path_cache) {
-                paths = set_new(&path_hash_ops_free);
-                if (!paths)
+        /* Then check if somebody else already did the work for the current state of the directories,
+         * unless we were asked to build the cache from scratch */
+        if (!cache_mtime || *cache_mtime > 0) {
+                r = name_map_cache_load(lp, &mtime, unit_ids_map, unit_names_map, path_cache);
+                if (r < 0)
                         return log_oom();
+                if (r > 0) {
+                        if (cache_mtime)
+                                *cache_mtime = mtime;
+                        return 1;
+                }
         }
 
+        /* We always collect the paths, as they are part of the cache we write */
+        paths = set_new(&path_hash_ops_free);
+        if (!paths)
+                return log_oom();
+
+        /* Unit file names come from directories only privileged users (or, for the user manager, the
+         * user itself) may write to, hence the fast hash is fine. Lookups of names chosen by others don't
+         * matter, as they never insert anything. */
+        ids = hashmap_new(&fast_string_hash_ops_free_free);
+        if (!ids)
+                return log_oom();
+
+        dir_mtimes = new0(usec_t, strv_length(lp->search_path));
+        if (!dir_mtimes)
+                return log_oom();
+
         STRV_FOREACH(dir, (char**) lp->search_path) {
                 struct dirent *de;
                 _cleanup_closedir_ DIR *d = NULL;
@@ -267,8 +609,10 @@ int unit_file_build_name_map(
 
                 d = opendir(*dir);
                 if (!d) {
-                        if (errno != ENOENT)
+                        if (errno != ENOENT) {
                                 log_warning_errno(errno, "Failed to open \"%s\", ignoring: %m", *dir);
+                                cacheable = false;
+                        }
                         continue;
                 }
 
@@ -276,12 +620,17 @@ int unit_file_build_name_map(
                 if (fstat(dirfd(d), &st) < 0)
                         return log_error_errno(errno, "Failed to fstat %s: %m", *dir);
 
+                dir_mtimes[dir - lp->search_path] = timespec_load(&st.st_mtim);
+
                 if (!lookup_paths_mtime_exclude(lp, *dir))
                         mtime = MAX(mtime, timespec_load(&st.st_mtim));
 
-                FOREACH_DIRENT_ALL(de, d, log_warning_errno(errno, "Failed to read \"%s\", ignoring: %m", *dir)) {
+                FOREACH_DIRENT_ALL(de, d, {
+                                log_warning_errno(errno, "Failed to read \"%s\", ignoring: %m", *dir);
+                                cacheable = false;
+                        }) {
                         char *filename;
-                        _cleanup_free_ char *_filename_free = NULL, *simplified = NULL;
+                        _cleanup_free_ char *simplified = NULL;
                         const char *suffix, *dst = NULL;
                         bool valid_unit_name;
 
@@ -297,14 +646,11 @@ int unit_file_build_name_map(
                         if (!filename)
                                 return log_oom();
 
-                        if (paths) {
-                                r = set_consume(paths, filename);
-                                if (r < 0)
-                                        return log_oom();
-                                /* We will still use filename below. This is safe because we know the set
-                                 * holds a reference. */
-                        } else
-                                _filename_free = filename; /* Make sure we free the filename. */
+                        r = set_consume(paths, filename);
+                        if (r < 0)
+                                return log_oom();
+                        /* We will still use filename below. This is safe because we know the set
+                         * holds a reference. */
 
                         if (!valid_unit_name)
                                 continue;
@@ -417,6 +763,9 @@ int unit_file_build_name_map(
                                                  basename(dst), src);
         }
 
+        if (cacheable)
+                name_map_cache_save(lp, dir_mtimes, mtime, ids, names, paths);
+
         if (cache_mtime)
                 *cache_mtime = mtime;
 
@@ -17,6 +17,10 @@
 #include "userdb.h"
 #include "varlink.h"
 
+/* How long to wait for each service when looking up a single record. Enumerations may legitimately take
+ * longer, and use the varlink default instead. */
+#define USERDB_LOOKUP_TIMEOUT_USEC (10U*USEC_PER_SEC)
+
 DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(link_hash_ops, void, trivial_hash_func, trivial_compare_func, Varlink, varlink_unref);
 
 typedef enum LookupWhat {
@@ -36,6 +40,7 @@ struct UserDBIterator {
         bool nss_systemd_blocked:1;
         int error;
         unsigned n_found;
+        usec_t start_usec;
         sd_event *event;
         UserRecord *found_user;                   /* when .what == LOOKUP_USER */
         GroupRecord *found_group;                 /* when .what == LOOKUP_GROUP */
@@ -148,7 +153,7 @@ static int userdb_on_query_reply(
         assert(iterator);
 
         if (error_id) {
-                log_debug("Got lookup error: %s", error_id);
+                log_debug("Got lookup error from %s: %s", strna(varlink_get_description(link)), error_id);
 
                 if (STR_IN_SET(error_id,
                                "io.systemd.UserDatabase.NoRecordFound",
@@ -326,6 +331,14 @@ static int userdb_on_query_reply(
         }
 
 finish:
+        if (DEBUG_LOGGING) {
+                char buf[FORMAT_TIMESPAN_MAX];
+
+                log_debug("Lookup on %s finished after %s.",
+                          strna(varlink_get_description(link)),
+                          format_timespan(buf, sizeof buf, usec_sub_unsigned(now(CLOCK_MONOTONIC), iterator->start_usec), USEC_PER_MSEC));
+        }
+
         /* If we got one ESRCH, let that win. This way when we do a wild dump we won't be tripped up by bad
          * errors if at least one connection ended cleanly */
         if (r == -ESRCH || iterator->error == 0)
@@ -372,6 +385,14 @@ static int userdb_connect(
         if (r < 0)
                 return log_debug_errno(r, "Failed to bind reply callback: %m");
 
+        /* A slow service should not hold up single record lookups for too long. We return as soon as one
+         * service gave us a record anyway, see userdb_process(). */
+        if (!more) {
+                r = varlink_set_relative_timeout(vl, USERDB_LOOKUP_TIMEOUT_USEC);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to set varlink timeout: %m");
+        }
+
         if (more)
                 r = varlink_observe(vl, method, query);
         else
@@ -401,6 +422,8 @@ static int userdb_start_query(
         assert(iterator);
         assert(method);
 
+        iterator->start_usec = now(CLOCK_MONOTONIC);
+
         e = getenv("SYSTEMD_BYPASS_USERDB");
         if (e) {
                 r = parse_boolean(e);
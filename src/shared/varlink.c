@@ -1213,52 +1213,33 @@ Varlink* varlink_flush_close_unref(Varlink *v) {
 }
 
 static int varlink_enqueue_json(Varlink *v, JsonVariant *m) {
-        _cleanup_free_ char *text = NULL;
+        size_t previous;
         int r;
 
         assert(v);
         assert(m);
 
-        r = json_variant_format(m, 0, &text);
-        if (r < 0)
-                return r;
-        assert(text[r] == '\0');
-
-        if (v->output_buffer_size + r + 1 > VARLINK_BUFFER_MAX)
-                return -ENOBUFS;
-
-        varlink_log(v, "Sending message: %s", text);
-
-        if (v->output_buffer_size == 0) {
-
-                free_and_replace(v->output_buffer, text);
-
-                v->output_buffer_size = v->output_buffer_allocated = r + 1;
+        /* Format the message directly into the output buffer, right after what is still pending. Move that to
+         * the front of the buffer first, so that the buffer doesn't grow indefinitely. */
+        if (v->output_buffer_index > 0) {
+                memmove(v->output_buffer, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
                 v->output_buffer_index = 0;
+        }
 
-        } else if (v->output_buffer_index == 0) {
-
-                if (!GREEDY_REALLOC(v->output_buffer, v->output_buffer_allocated, v->output_buffer_size + r + 1))
-                        return -ENOMEM;
-
-                memcpy(v->output_buffer + v->output_buffer_size, text, r + 1);
-                v->output_buffer_size += r + 1;
-
-        } else {
-                char *n;
-                const size_t new_size = v->output_buffer_size + r + 1;
-
-                n = new(char, new_size);
-                if (!n)
-                        return -ENOMEM;
+        previous = v->output_buffer_size;
 
-                memcpy(mempcpy(n, v->output_buffer + v->output_buffer_index, v->output_buffer_size), text, r + 1);
+        r = json_variant_format_append(m, 0, &v->output_buffer, &v->output_buffer_allocated, &v->output_buffer_size);
+        if (r < 0)
+                return r;
+        assert(v->output_buffer[v->output_buffer_size - 1] == '\0');
 
-                free_and_replace(v->output_buffer, n);
-                v->output_buffer_allocated = v->output_buffer_size = new_size;
-                v->output_buffer_index = 0;
+        if (v->output_buffer_size > VARLINK_BUFFER_MAX) {
+                v->output_buffer_size = previous;
+                return -ENOBUFS;
         }
 
+        varlink_log(v, "Sending message: %s", v->output_buffer + previous);
+
         return 0;
 }
 
@@ -1810,6 +1791,12 @@ int varlink_set_description(Varlink *v, const char *description) {
         return free_and_strdup(&v->description, description);
 }
 
+const char* varlink_get_description(Varlink *v) {
+        assert_return(v, NULL);
+
+        return v->description;
+}
+
 static int io_callback(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         Varlink *v = userdata;
 
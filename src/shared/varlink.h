@@ -120,6 +120,7 @@ int varlink_set_relative_timeout(Varlink *v, usec_t usec);
 VarlinkServer* varlink_get_server(Varlink *v);
 
 int varlink_set_description(Varlink *v, const char *d);
+const char* varlink_get_description(Varlink *v);
 
 /* Create a varlink server */
 int varlink_server_new(VarlinkServer **ret, VarlinkServerFlags flags);
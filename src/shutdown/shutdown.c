@@ -313,6 +313,7 @@ int main(int argc, char *argv[]) {
         char *arguments[3], *watchdog_device;
         int cmd, r, umount_log_level = LOG_INFO;
         static const char* const dirs[] = {SYSTEM_SHUTDOWN_PATH, NULL};
+        usec_t start;
 
         /* The log target defaults to console, but the original systemd process will pass its log target in through a
          * command line argument, which will override this default. Also, ensure we'll never log to the journal or
@@ -402,6 +403,7 @@ int main(int argc, char *argv[]) {
         can_initrd = !in_container && !in_initrd() && access("/run/initramfs/shutdown", X_OK) == 0;
 
         /* Unmount all mountpoints, swaps, and loopback devices */
+        start = now(CLOCK_MONOTONIC);
         for (;;) {
                 bool changed = false;
 
@@ -464,7 +466,10 @@ int main(int argc, char *argv[]) {
                 }
 
                 if (!need_umount && !need_swapoff && !need_loop_detach && !need_dm_detach) {
-                        log_info("All filesystems, swaps, loop devices and DM devices detached.");
+                        char ts[FORMAT_TIMESPAN_MAX];
+
+                        log_info("All filesystems, swaps, loop devices and DM devices detached in %s.",
+                                 format_timespan(ts, sizeof(ts), usec_sub_unsigned(now(CLOCK_MONOTONIC), start), USEC_PER_MSEC));
                         /* Yay, done */
                         break;
                 }
@@ -35,6 +35,9 @@
 #include "util.h"
 #include "virt.h"
 
+/* How many leaf mount points to unmount at the same time */
+#define UMOUNT_PARALLEL_MAX 32U
+
 static void mount_point_free(MountPoint **head, MountPoint *m) {
         assert(head);
         assert(m);
@@ -420,6 +423,32 @@ static bool nonunmountable_path(const char *path) {
                 || path_startswith(path, "/run/initramfs");
 }
 
+static int mount_point_remount_ro(MountPoint *m, int umount_log_level) {
+        assert(m);
+
+        log_info("Remounting '%s' read-only in with options '%s'.", m->path, m->remount_options);
+
+        if (mount(NULL, m->path, NULL, m->remount_flags, m->remount_options) < 0)
+                return log_full_errno(umount_log_level, errno, "Failed to remount '%s' read-only: %m", m->path);
+
+        return 0;
+}
+
+static int mount_point_umount(MountPoint *m, int umount_log_level) {
+        assert(m);
+
+        log_info("Unmounting '%s'.", m->path);
+
+        /* Using MNT_FORCE causes some filesystems (e.g. FUSE and NFS and other network filesystems) to abort
+         * any pending requests and return -EIO rather than blocking indefinitely. If the filesysten is
+         * "busy", this may allow processes to die, thus making the filesystem less busy so the unmount
+         * might succeed (rather then return EBUSY). */
+        if (umount2(m->path, MNT_FORCE) < 0)
+                return log_full_errno(umount_log_level, errno, "Failed to unmount %s: %m", m->path);
+
+        return 0;
+}
+
 static int remount_with_timeout(MountPoint *m, int umount_log_level) {
         pid_t pid;
         int r;
@@ -436,13 +465,8 @@ static int remount_with_timeout(MountPoint *m, int umount_log_level) {
         if (r < 0)
                 return r;
         if (r == 0) {
-                log_info("Remounting '%s' read-only in with options '%s'.", m->path, m->remount_options);
-
                 /* Start the mount operation here in the child */
-                r = mount(NULL, m->path, NULL, m->remount_flags, m->remount_options);
-                if (r < 0)
-                        log_full_errno(umount_log_level, errno, "Failed to remount '%s' read-only: %m", m->path);
-
+                r = mount_point_remount_ro(m, umount_log_level);
                 _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
         }
 
@@ -474,19 +498,8 @@ static int umount_with_timeout(MountPoint *m, int umount_log_level) {
         if (r < 0)
                 return r;
         if (r == 0) {
-                log_info("Unmounting '%s'.", m->path);
-
-                /* Start the mount operation here in the child Using MNT_FORCE
-                 * causes some filesystems (e.g. FUSE and NFS and other network
-                 * filesystems) to abort any pending requests and return -EIO
-                 * rather than blocking indefinitely. If the filesysten is
-                 * "busy", this may allow processes to die, thus making the
-                 * filesystem less busy so the unmount might succeed (rather
-                 * then return EBUSY).*/
-                r = umount2(m->path, MNT_FORCE);
-                if (r < 0)
-                        log_full_errno(umount_log_level, errno, "Failed to unmount %s: %m", m->path);
-
+                /* Start the umount operation here in the child */
+                r = mount_point_umount(m, umount_log_level);
                 _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
         }
 
@@ -502,6 +515,137 @@ static int umount_with_timeout(MountPoint *m, int umount_log_level) {
         return r;
 }
 
+static bool mount_point_is_leaf(MountPoint *head, MountPoint *m) {
+        MountPoint *i;
+        bool after = false;
+
+        assert(m);
+
+        /* Returns true if nothing is mounted below or on top of the specified mount point. The list is
+         * ordered newest first, hence mounts stacked on top of this one on the same path come before it. */
+
+        LIST_FOREACH(mount_point, i, head) {
+                const char *e;
+
+                if (i == m) {
+                        after = true;
+                        continue;
+                }
+
+                e = path_startswith(i->path, m->path);
+                if (!e)
+                        continue;
+
+                if (!isempty(e) || !after)
+                        return false;
+        }
+
+        return true;
+}
+
+static int mount_points_list_umount_batch(
+                MountPoint **head,
+                MountPoint *batch[],
+                size_t n,
+                bool *changed,
+                int umount_log_level) {
+
+        pid_t pids[UMOUNT_PARALLEL_MAX] = {};
+        size_t i, n_running = 0;
+        int n_failed = 0, r;
+        sigset_t mask;
+        usec_t until;
+
+        BLOCK_SIGNALS(SIGCHLD);
+
+        assert(head);
+        assert(batch);
+        assert(n <= UMOUNT_PARALLEL_MAX);
+        assert(changed);
+
+        assert_se(sigemptyset(&mask) == 0);
+        assert_se(sigaddset(&mask, SIGCHLD) == 0);
+
+        /* Remounts and umounts may hang, like in remount_with_timeout() and umount_with_timeout() we hence
+         * do them in child processes. Here we fork off one for each mount point of the batch, and give
+         * them all the same deadline. */
+        for (i = 0; i < n; i++) {
+                r = safe_fork("(sd-umount)", FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_LOG|FORK_REOPEN_LOG, &pids[i]);
+                if (r < 0) {
+                        n_failed++;
+                        continue;
+                }
+                if (r == 0) {
+                        /* Same as in the serial case: if the remount fails, try unmounting anyway */
+                        if (batch[i]->try_remount_ro)
+                                (void) mount_point_remount_ro(batch[i], umount_log_level);
+
+                        r = mount_point_umount(batch[i], umount_log_level);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+
+                n_running++;
+        }
+
+        until = usec_add(now(CLOCK_MONOTONIC), DEFAULT_TIMEOUT_USEC);
+
+        while (n_running > 0) {
+                siginfo_t status = {};
+
+                if (waitid(P_ALL, 0, &status, WEXITED|WNOHANG) < 0) {
+                        log_error_errno(errno, "Failed to wait for umount child processes: %m");
+                        break;
+                }
+
+                if (status.si_pid == 0) {
+                        struct timespec ts;
+                        usec_t t;
+
+                        /* Nothing exited yet, wait for SIGCHLD */
+                        t = now(CLOCK_MONOTONIC);
+                        if (t >= until)
+                                break;
+
+                        if (sigtimedwait(&mask, NULL, timespec_store(&ts, until - t)) < 0 &&
+                            !IN_SET(errno, EAGAIN, EINTR)) {
+                                log_error_errno(errno, "Failed to wait for SIGCHLD: %m");
+                                break;
+                        }
+
+                        continue;
+                }
+
+                for (i = 0; i < n; i++)
+                        if (pids[i] == status.si_pid)
+                                break;
+                if (i >= n) /* Some other process, possibly reparented to us */
+                        continue;
+
+                pids[i] = 0;
+                n_running--;
+
+                if (status.si_code == CLD_EXITED && status.si_status == EXIT_SUCCESS)
+                        *changed = true;
+                else {
+                        log_debug("Unmounting '%s' failed abnormally, child process " PID_FMT " aborted or exited non-zero.", batch[i]->path, status.si_pid);
+                        n_failed++;
+                }
+        }
+
+        for (i = 0; i < n; i++)
+                if (pids[i] > 0) {
+                        log_error("Unmounting '%s' timed out, issuing SIGKILL to PID " PID_FMT ".", batch[i]->path, pids[i]);
+                        (void) kill(pids[i], SIGKILL);
+                        n_failed++;
+                }
+
+        /* Whether they worked or not, don't try these again during this iteration */
+        for (i = 0; i < n; i++)
+                mount_point_free(head, batch[i]);
+
+        return n_failed;
+}
+
 /* This includes remounting readonly, which changes the kernel mount options.  Therefore the list passed to
  * this function is invalidated, and should not be reused. */
 static int mount_points_list_umount(MountPoint **head, bool *changed, int umount_log_level) {
@@ -511,6 +655,30 @@ static int mount_points_list_umount(MountPoint **head, bool *changed, int umount
         assert(head);
         assert(changed);
 
+        /* First, unmount all mount points that nothing else is mounted on or below in parallel, in waves,
+         * until only those remain that are blocked by something we cannot or could not unmount. */
+        for (;;) {
+                MountPoint *batch[UMOUNT_PARALLEL_MAX];
+                size_t n = 0;
+
+                LIST_FOREACH(mount_point, m, *head) {
+                        if (n >= ELEMENTSOF(batch))
+                                break;
+
+                        if (nonunmountable_path(m->path))
+                                continue;
+
+                        if (mount_point_is_leaf(*head, m))
+                                batch[n++] = m;
+                }
+
+                if (n == 0)
+                        break;
+
+                n_failed += mount_points_list_umount_batch(head, batch, n, changed, umount_log_level);
+        }
+
+        /* The rest is processed one by one, newest first */
         LIST_FOREACH(mount_point, m, *head) {
                 if (m->try_remount_ro) {
                         /* We always try to remount directories read-only first, before we go on and umount
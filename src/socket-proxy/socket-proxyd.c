@@ -27,6 +27,9 @@
 #include "string-util.h"
 #include "util.h"
 
+/* Pipes start out with the kernel's default size, and are grown up to this size only for connections
+ * that actually fill them up. With many mostly idle connections this keeps the memory pinned in pipe
+ * buffers small, and the per-user pipe buffer limit is not hit as quickly. */
 #define BUFFER_SIZE (256 * 1024)
 
 static unsigned arg_connections_max = 256;
@@ -146,8 +149,6 @@ static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *
         if (r < 0)
                 return log_error_errno(errno, "Failed to allocate pipe buffer: %m");
 
-        (void) fcntl(buffer[0], F_SETPIPE_SZ, BUFFER_SIZE);
-
         r = fcntl(buffer[0], F_GETPIPE_SZ);
         if (r < 0)
                 return log_error_errno(errno, "Failed to get pipe buffer size: %m");
@@ -158,6 +159,26 @@ static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *
         return 0;
 }
 
+static void connection_grow_pipe(int buffer[static 2], size_t *sz) {
+        int r;
+
+        assert(buffer);
+        assert(sz);
+
+        if (*sz >= BUFFER_SIZE)
+                return;
+
+        /* This might fail if the per-user limit on pipe buffers is reached, in which case we just continue
+         * with what we have. */
+        r = fcntl(buffer[0], F_SETPIPE_SZ, BUFFER_SIZE);
+        if (r < 0) {
+                log_debug_errno(errno, "Failed to increase pipe buffer size, ignoring: %m");
+                return;
+        }
+
+        *sz = r;
+}
+
 static int connection_shovel(
                 Connection *c,
                 int *from, int buffer[2], int *to,
@@ -187,6 +208,10 @@ static int connection_shovel(
                         if (z > 0) {
                                 *full += z;
                                 shoveled = true;
+
+                                /* The pipe filled up, this is a bulk transfer, give it more room */
+                                if (*full >= *sz)
+                                        connection_grow_pipe(buffer, sz);
                         } else if (z == 0 || ERRNO_IS_DISCONNECT(errno)) {
                                 *from_source = sd_event_source_unref(*from_source);
                                 *from = safe_close(*from);
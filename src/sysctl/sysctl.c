@@ -48,7 +48,8 @@ static Option *option_free(Option *o) {
 }
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(Option*, option_free);
-DEFINE_HASH_OPS_WITH_VALUE_DESTRUCTOR(option_hash_ops, char, string_hash_func, string_compare_func, Option, option_free);
+/* The keys come from configuration files and the command line, which are trusted */
+DEFINE_HASH_OPS_WITH_VALUE_DESTRUCTOR(option_hash_ops, char, fast_string_hash_func, string_compare_func, Option, option_free);
 
 static bool test_prefix(const char *p) {
         char **i;
@@ -113,6 +113,7 @@ static PagerFlags arg_pager_flags = 0;
 static bool arg_no_wtmp = false;
 static bool arg_no_sync = false;
 static bool arg_no_wall = false;
+static bool arg_incremental = false;
 static bool arg_no_reload = false;
 static bool arg_value = false;
 static bool arg_show_types = false;
@@ -419,6 +420,52 @@ static int output_units_list(const UnitInfo *unit_infos, unsigned c) {
         (void) table_set_empty_string(table, "-");
 
         int job_count = 0;
+        for (const UnitInfo *u = unit_infos; unit_infos && u < unit_infos + c; u++)
+                if (u->job_id != 0)
+                        job_count++;
+
+        if (job_count == 0) {
+                /* There's no data in the JOB column, so let's hide it */
+                r = table_hide_column_from_display(table, 5);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to hide column: %m");
+        }
+
+        /* The list can be huge with --all. If it goes to a pipe (but neither to a terminal nor to the pager,
+         * where people look at it), write it out while we go. The streamed rows keep the column widths
+         * determined at the start, hence make sure they fit everything we have, so that nothing is
+         * ellipsized. The description is the last column, which may grow as needed. */
+        if (!OUTPUT_MODE_IS_JSON(arg_output) && !pager_have() && !isatty(STDOUT_FILENO)) {
+                size_t w_id = 0, w_load = 0, w_active = 0, w_sub = 0, w_job = 0;
+
+                /* All of these are plain ASCII */
+                for (const UnitInfo *u = unit_infos; unit_infos && u < unit_infos + c; u++) {
+                        w_id = MAX(w_id, strlen(u->id) + (u->machine ? strlen(u->machine) + 1 : 0));
+                        w_load = MAX(w_load, strlen(u->load_state));
+                        w_active = MAX(w_active, strlen(u->active_state));
+                        w_sub = MAX(w_sub, strlen(u->sub_state));
+                        if (u->job_id != 0)
+                                w_job = MAX(w_job, strlen(u->job_type));
+                }
+
+                /* The header cells pass their minimum width on to all rows added below them */
+                r = table_set_minimum_width(table, TABLE_HEADER_CELL(1), w_id);
+                if (r >= 0)
+                        r = table_set_minimum_width(table, TABLE_HEADER_CELL(2), w_load);
+                if (r >= 0)
+                        r = table_set_minimum_width(table, TABLE_HEADER_CELL(3), w_active);
+                if (r >= 0)
+                        r = table_set_minimum_width(table, TABLE_HEADER_CELL(4), w_sub);
+                if (r >= 0)
+                        r = table_set_minimum_width(table, TABLE_HEADER_CELL(5), w_job);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set minimum column width: %m");
+
+                r = table_set_stream(table, stdout, 256);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to enable streaming table output: %m");
+        }
+
         for (const UnitInfo *u = unit_infos; unit_infos && u < unit_infos + c; u++) {
                 _cleanup_free_ char *j = NULL;
                 const char *on_underline = "", *on_loaded = "", *on_active = "";
@@ -471,16 +518,6 @@ static int output_units_list(const UnitInfo *unit_infos, unsigned c) {
                                    TABLE_SET_BOTH_COLORS, on_underline);
                 if (r < 0)
                         return table_log_add_error(r);
-
-                if (u->job_id != 0)
-                        job_count++;
-        }
-
-        if (job_count == 0) {
-                /* There's no data in the JOB column, so let's hide it */
-                r = table_hide_column_from_display(table, 5);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to hide column: %m");
         }
 
         r = output_table(table);
@@ -489,7 +526,7 @@ static int output_units_list(const UnitInfo *unit_infos, unsigned c) {
 
         if (!arg_no_legend) {
                 const char *on, *off;
-                size_t records = table_get_rows(table) - 1;
+                size_t records = c;
 
                 if (records > 0) {
                         puts("\n"
@@ -734,36 +771,35 @@ static int expand_names(sd_bus *bus, char **names, const char* suffix, char ***r
         return 0;
 }
 
+static const struct bus_properties_map list_dependencies_map[_DEPENDENCY_MAX][6] = {
+        [DEPENDENCY_FORWARD] = {
+                { "Requires",    "as", NULL, 0 },
+                { "Requisite",   "as", NULL, 0 },
+                { "Wants",       "as", NULL, 0 },
+                { "ConsistsOf",  "as", NULL, 0 },
+                { "BindsTo",     "as", NULL, 0 },
+                {}
+        },
+        [DEPENDENCY_REVERSE] = {
+                { "RequiredBy",  "as", NULL, 0 },
+                { "RequisiteOf", "as", NULL, 0 },
+                { "WantedBy",    "as", NULL, 0 },
+                { "PartOf",      "as", NULL, 0 },
+                { "BoundBy",     "as", NULL, 0 },
+                {}
+        },
+        [DEPENDENCY_AFTER] = {
+                { "After",       "as", NULL, 0 },
+                {}
+        },
+        [DEPENDENCY_BEFORE] = {
+                { "Before",      "as", NULL, 0 },
+                {}
+        },
+};
+
 static int list_dependencies_get_dependencies(sd_bus *bus, const char *name, char ***ret) {
         _cleanup_strv_free_ char **deps = NULL;
-
-        static const struct bus_properties_map map[_DEPENDENCY_MAX][6] = {
-                [DEPENDENCY_FORWARD] = {
-                        { "Requires",    "as", NULL, 0 },
-                        { "Requisite",   "as", NULL, 0 },
-                        { "Wants",       "as", NULL, 0 },
-                        { "ConsistsOf",  "as", NULL, 0 },
-                        { "BindsTo",     "as", NULL, 0 },
-                        {}
-                },
-                [DEPENDENCY_REVERSE] = {
-                        { "RequiredBy",  "as", NULL, 0 },
-                        { "RequisiteOf", "as", NULL, 0 },
-                        { "WantedBy",    "as", NULL, 0 },
-                        { "PartOf",      "as", NULL, 0 },
-                        { "BoundBy",     "as", NULL, 0 },
-                        {}
-                },
-                [DEPENDENCY_AFTER] = {
-                        { "After",       "as", NULL, 0 },
-                        {}
-                },
-                [DEPENDENCY_BEFORE] = {
-                        { "Before",      "as", NULL, 0 },
-                        {}
-                },
-        };
-
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
         _cleanup_free_ char *dbus_path = NULL;
         int r;
@@ -779,7 +815,7 @@ static int list_dependencies_get_dependencies(sd_bus *bus, const char *name, cha
         r = bus_map_all_properties(bus,
                                    "org.freedesktop.systemd1",
                                    dbus_path,
-                                   map[arg_dependency],
+                                   list_dependencies_map[arg_dependency],
                                    BUS_MAP_STRDUP,
                                    &error,
                                    NULL,
@@ -1722,15 +1758,149 @@ static int list_dependencies_compare(char * const *a, char * const *b) {
         return strcasecmp(*a, *b);
 }
 
+typedef struct DependencyGraphUnit {
+        char *id;
+        UnitActiveState active_state;
+        char **dependencies;
+} DependencyGraphUnit;
+
+static DependencyGraphUnit *dependency_graph_unit_free(DependencyGraphUnit *u) {
+        if (!u)
+                return NULL;
+
+        free(u->id);
+        strv_free(u->dependencies);
+        return mfree(u);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(DependencyGraphUnit*, dependency_graph_unit_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(dependency_graph_hash_ops, char, string_hash_func, string_compare_func,
+                                              DependencyGraphUnit, dependency_graph_unit_free);
+
+static int list_dependencies_get_graph(sd_bus *bus, char **roots, Hashmap **ret) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_hashmap_free_ Hashmap *graph = NULL;
+        _cleanup_strv_free_ char **types = NULL;
+        const struct bus_properties_map *p;
+        int r;
+
+        assert(bus);
+        assert(ret);
+
+        /* Fetch the whole dependency tree below the specified units in one go. Returns 0 and a NULL graph
+         * if the manager is too old to know the method, in which case the caller queries each unit's
+         * dependencies separately. */
+
+        for (p = list_dependencies_map[arg_dependency]; p->member; p++)
+                if (strv_extend(&types, p->member) < 0)
+                        return log_oom();
+
+        r = bus_message_new_method_call(bus, &m, bus_systemd_mgr, "ListUnitDependencyGraph");
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_message_append_strv(m, roots);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_message_append_strv(m, types);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0) {
+                if (sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD)) {
+                        *ret = NULL;
+                        return 0;
+                }
+
+                return log_error_errno(r, "Failed to get dependency graph: %s", bus_error_message(&error, r));
+        }
+
+        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(sssa(ss))");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_STRUCT, "sssa(ss)")) > 0) {
+                _cleanup_(dependency_graph_unit_freep) DependencyGraphUnit *u = NULL;
+                const char *id, *load_state, *active_state, *type, *other;
+
+                r = sd_bus_message_read(reply, "sss", &id, &load_state, &active_state);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                u = new(DependencyGraphUnit, 1);
+                if (!u)
+                        return log_oom();
+
+                *u = (DependencyGraphUnit) {
+                        .id = strdup(id),
+                        .active_state = unit_active_state_from_string(active_state),
+                };
+                if (!u->id)
+                        return log_oom();
+
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ss)");
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                while ((r = sd_bus_message_read(reply, "(ss)", &type, &other)) > 0)
+                        if (strv_extend(&u->dependencies, other) < 0)
+                                return log_oom();
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                strv_uniq(u->dependencies);
+                typesafe_qsort(u->dependencies, strv_length(u->dependencies), list_dependencies_compare);
+
+                r = hashmap_ensure_allocated(&graph, &dependency_graph_hash_ops);
+                if (r < 0)
+                        return log_oom();
+
+                r = hashmap_put(graph, u->id, u);
+                if (r < 0)
+                        return log_oom();
+
+                TAKE_PTR(u);
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        /* An empty graph still means the method is supported */
+        if (!graph) {
+                r = hashmap_ensure_allocated(&graph, &dependency_graph_hash_ops);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        *ret = TAKE_PTR(graph);
+        return 0;
+}
+
 static int list_dependencies_one(
                 sd_bus *bus,
+                Hashmap *graph,
                 const char *name,
                 int level,
                 char ***units,
                 unsigned branches) {
 
-        _cleanup_strv_free_ char **deps = NULL;
-        char **c;
+        _cleanup_strv_free_ char **fetched = NULL;
+        char **deps, **c;
         int r = 0;
 
         assert(bus);
@@ -1741,11 +1911,19 @@ static int list_dependencies_one(
         if (r < 0)
                 return log_oom();
 
-        r = list_dependencies_get_dependencies(bus, name, &deps);
-        if (r < 0)
-                return r;
+        if (graph) {
+                DependencyGraphUnit *u;
+
+                u = hashmap_get(graph, name);
+                deps = u ? u->dependencies : NULL;
+        } else {
+                r = list_dependencies_get_dependencies(bus, name, &fetched);
+                if (r < 0)
+                        return r;
 
-        typesafe_qsort(deps, strv_length(deps), list_dependencies_compare);
+                typesafe_qsort(fetched, strv_length(fetched), list_dependencies_compare);
+                deps = fetched;
+        }
 
         STRV_FOREACH(c, deps) {
                 if (strv_contains(*units, *c)) {
@@ -1764,7 +1942,14 @@ static int list_dependencies_one(
                         UnitActiveState active_state = _UNIT_ACTIVE_STATE_INVALID;
                         const char *on;
 
-                        (void) get_state_one_unit(bus, *c, &active_state);
+                        if (graph) {
+                                DependencyGraphUnit *u;
+
+                                u = hashmap_get(graph, *c);
+                                if (u)
+                                        active_state = u->active_state;
+                        } else
+                                (void) get_state_one_unit(bus, *c, &active_state);
 
                         switch (active_state) {
                         case UNIT_ACTIVE:
@@ -1791,7 +1976,7 @@ static int list_dependencies_one(
                         return r;
 
                 if (arg_all || unit_name_to_type(*c) == UNIT_TARGET) {
-                       r = list_dependencies_one(bus, *c, level + 1, units, (branches << 1) | (c[1] == NULL ? 0 : 1));
+                       r = list_dependencies_one(bus, graph, *c, level + 1, units, (branches << 1) | (c[1] == NULL ? 0 : 1));
                        if (r < 0)
                                return r;
                 }
@@ -1805,6 +1990,7 @@ static int list_dependencies_one(
 
 static int list_dependencies(int argc, char *argv[], void *userdata) {
         _cleanup_strv_free_ char **units = NULL, **done = NULL;
+        _cleanup_hashmap_free_ Hashmap *graph = NULL;
         char **u, **patterns;
         sd_bus *bus;
         int r;
@@ -1824,6 +2010,10 @@ static int list_dependencies(int argc, char *argv[], void *userdata) {
                         return log_error_errno(r, "Failed to expand names: %m");
         }
 
+        r = list_dependencies_get_graph(bus, units, &graph);
+        if (r < 0)
+                return r;
+
         (void) pager_open(arg_pager_flags);
 
         STRV_FOREACH(u, units) {
@@ -1831,7 +2021,7 @@ static int list_dependencies(int argc, char *argv[], void *userdata) {
                         puts("");
 
                 puts(*u);
-                r = list_dependencies_one(bus, *u, 0, &done, 0);
+                r = list_dependencies_one(bus, graph, *u, 0, &done, 0);
                 if (r < 0)
                         return r;
         }
@@ -2832,6 +3022,28 @@ static const char *verb_to_job_type(const char *verb) {
        return "start";
 }
 
+static int log_start_unit_error(int r, const char *job_type, const char *name, const sd_bus_error *error) {
+        assert(job_type);
+        assert(name);
+
+        /* There's always a fallback possible for legacy actions. */
+        if (arg_action != ACTION_SYSTEMCTL)
+                return r;
+
+        log_error_errno(r, "Failed to %s %s: %s", job_type, name, bus_error_message(error, r));
+
+        if (!sd_bus_error_has_names(error, BUS_ERROR_NO_SUCH_UNIT,
+                                           BUS_ERROR_UNIT_MASKED,
+                                           BUS_ERROR_JOB_TYPE_NOT_APPLICABLE))
+                log_error("See %s logs and 'systemctl%s status%s %s' for details.",
+                          arg_scope == UNIT_FILE_SYSTEM ? "system" : "user",
+                          arg_scope == UNIT_FILE_SYSTEM ? "" : " --user",
+                          name[0] == '-' ? " --" : "",
+                          name);
+
+        return r;
+}
+
 static int start_unit_one(
                 sd_bus *bus,
                 const char *method,    /* When using classic per-job bus methods */
@@ -2939,21 +3151,235 @@ static int start_unit_one(
         return 0;
 
 fail:
-        /* There's always a fallback possible for legacy actions. */
-        if (arg_action != ACTION_SYSTEMCTL)
-                return r;
+        return log_start_unit_error(r, job_type, name, error);
+}
 
-        log_error_errno(r, "Failed to %s %s: %s", job_type, name, bus_error_message(error, r));
+/* Maximum number of job requests start_units_pipelined() keeps in flight at the same time */
+#define START_UNIT_CALLS_IN_FLIGHT_MAX 64U
 
-        if (!sd_bus_error_has_names(error, BUS_ERROR_NO_SUCH_UNIT,
-                                           BUS_ERROR_UNIT_MASKED,
-                                           BUS_ERROR_JOB_TYPE_NOT_APPLICABLE))
-                log_error("See %s logs and 'systemctl%s status%s %s' for details.",
-                          arg_scope == UNIT_FILE_SYSTEM ? "system" : "user",
-                          arg_scope == UNIT_FILE_SYSTEM ? "" : " --user",
-                          name[0] == '-' ? " --" : "",
-                          name);
+typedef struct StartUnitCall {
+        const char *name;
+        BusWaitForJobs *w;
+
+        sd_bus_slot *slot_job;
+        sd_bus_slot *slot_reload;
+        sd_bus_message *reply_job;
+        sd_bus_message *reply_reload;
+
+        int parse_error;
+        int watch_error;
+} StartUnitCall;
+
+static int on_start_unit_reply(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        StartUnitCall *c = userdata;
+        const char *path;
+        int r;
+
+        assert(m);
+        assert(c);
 
+        c->slot_job = sd_bus_slot_unref(c->slot_job);
+        c->reply_job = sd_bus_message_ref(m);
+
+        if (sd_bus_message_is_method_error(m, NULL))
+                return 0;
+
+        r = sd_bus_message_read(m, "o", &path);
+        if (r < 0) {
+                c->parse_error = r;
+                return 0;
+        }
+
+        /* Start watching the job right-away: its JobRemoved signal might be dispatched before we get around
+         * to processing this reply in start_units_pipelined(). */
+        if (c->w) {
+                log_debug("Adding %s to the set", path);
+                c->watch_error = bus_wait_for_jobs_add(c->w, path);
+        }
+
+        return 0;
+}
+
+static int on_need_daemon_reload_reply(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        StartUnitCall *c = userdata;
+
+        assert(m);
+        assert(c);
+
+        c->slot_reload = sd_bus_slot_unref(c->slot_reload);
+        c->reply_reload = sd_bus_message_ref(m);
+
+        return 0;
+}
+
+static void start_unit_call_array_free(StartUnitCall *c, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+                sd_bus_slot_unref(c[i].slot_job);
+                sd_bus_slot_unref(c[i].slot_reload);
+                sd_bus_message_unref(c[i].reply_job);
+                sd_bus_message_unref(c[i].reply_reload);
+        }
+
+        free(c);
+}
+
+static int start_unit_call_issue(sd_bus *bus, StartUnitCall *c, const char *method, const char *mode) {
+        _cleanup_free_ char *path = NULL;
+        int r;
+
+        assert(bus);
+        assert(c);
+
+        log_debug("Executing dbus call org.freedesktop.systemd1.Manager %s(%s, %s)", method, c->name, mode);
+
+        r = bus_call_method_async(bus, &c->slot_job, bus_systemd_mgr, method, on_start_unit_reply, c, "ss", c->name, mode);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue %s() call for %s: %m", method, c->name);
+
+        /* The job request loaded the unit, if it wasn't loaded already, hence we can query the unit object
+         * directly here, unlike need_daemon_reload(). The manager processes our messages in order. */
+        path = unit_dbus_path_from_name(c->name);
+        if (!path)
+                return log_oom();
+
+        r = sd_bus_call_method_async(
+                        bus,
+                        &c->slot_reload,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.DBus.Properties",
+                        "Get",
+                        on_need_daemon_reload_reply,
+                        c,
+                        "ss", "org.freedesktop.systemd1.Unit", "NeedDaemonReload");
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue property query for %s: %m", c->name);
+
+        return 0;
+}
+
+static int start_unit_call_complete(StartUnitCall *c, const char *job_type, sd_bus_error *error, BusWaitForUnits *wu) {
+        int b, r;
+
+        assert(c);
+        assert(c->reply_job);
+        assert(error);
+
+        if (sd_bus_message_is_method_error(c->reply_job, NULL)) {
+                r = sd_bus_error_copy(error, sd_bus_message_get_error(c->reply_job));
+                return log_start_unit_error(r, job_type, c->name, error);
+        }
+        if (c->parse_error < 0)
+                return bus_log_parse_error(c->parse_error);
+
+        /* Errors are ignored here, since this is used to show a warning only */
+        if (c->reply_reload &&
+            !sd_bus_message_is_method_error(c->reply_reload, NULL) &&
+            sd_bus_message_read(c->reply_reload, "v", "b", &b) > 0 && b)
+                warn_unit_file_changed(c->name);
+
+        if (c->watch_error < 0)
+                return log_error_errno(c->watch_error, "Failed to watch job for %s: %m", c->name);
+
+        if (wu) {
+                r = bus_wait_for_units_add_unit(wu, c->name, BUS_WAIT_FOR_INACTIVE|BUS_WAIT_NO_JOB, NULL, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to watch unit %s: %m", c->name);
+        }
+
+        return 0;
+}
+
+static int start_units_pipelined(
+                sd_bus *bus,
+                const char *method,
+                const char *job_type,
+                char **names,
+                const char *mode,
+                BusWaitForJobs *w,
+                BusWaitForUnits *wu,
+                char ***stopped_units,
+                int *ret) {
+
+        StartUnitCall *calls;
+        size_t n, issued = 0, completed = 0;
+        int r;
+
+        assert(bus);
+        assert(method);
+        assert(stopped_units);
+        assert(ret);
+
+        /* Like calling start_unit_one() for each unit, but keeps a window of requests in flight, instead of
+         * waiting for each reply before sending the next request. Replies are processed in the order the
+         * requests were issued. */
+
+        n = strv_length(names);
+        calls = new0(StartUnitCall, n);
+        if (n > 0 && !calls)
+                return log_oom();
+
+        while (completed < n) {
+                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+                StartUnitCall *c;
+
+                /* The first request is sent on its own, so that if it triggers interactive polkit
+                 * authorization, the authorization may be cached for the following ones, instead of being
+                 * asked for all of them in parallel. */
+                while (issued < n && issued - completed < (completed == 0 ? 1 : START_UNIT_CALLS_IN_FLIGHT_MAX)) {
+                        c = calls + issued;
+                        *c = (StartUnitCall) {
+                                .name = names[issued],
+                                .w = w,
+                        };
+
+                        r = start_unit_call_issue(bus, c, method, mode);
+                        if (r < 0)
+                                goto finish;
+
+                        issued++;
+                }
+
+                c = calls + completed;
+                if (!c->reply_job || !c->reply_reload) {
+                        r = sd_bus_process(bus, NULL);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to process bus messages: %m");
+                                goto finish;
+                        }
+                        if (r > 0)
+                                continue;
+
+                        r = sd_bus_wait(bus, UINT64_MAX);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to wait for bus messages: %m");
+                                goto finish;
+                        }
+
+                        continue;
+                }
+
+                r = start_unit_call_complete(c, job_type, &error, wu);
+                if (*ret == EXIT_SUCCESS && r < 0)
+                        *ret = translate_bus_error_to_exit_status(r, &error);
+
+                if (r >= 0 && streq(method, "StopUnit")) {
+                        r = strv_push(stopped_units, (char*) c->name);
+                        if (r < 0) {
+                                log_oom();
+                                goto finish;
+                        }
+                }
+
+                c->reply_job = sd_bus_message_unref(c->reply_job);
+                c->reply_reload = sd_bus_message_unref(c->reply_reload);
+                completed++;
+        }
+
+        r = 0;
+
+finish:
+        start_unit_call_array_free(calls, n);
         return r;
 }
 
@@ -3109,18 +3535,24 @@ static int start_unit(int argc, char *argv[], void *userdata) {
                         return log_error_errno(r, "Failed to allocate unit watch context: %m");
         }
 
-        STRV_FOREACH(name, names) {
-                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        if (arg_dry_run || arg_show_transaction)
+                STRV_FOREACH(name, names) {
+                        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
 
-                r = start_unit_one(bus, method, job_type, *name, mode, &error, w, wu);
-                if (ret == EXIT_SUCCESS && r < 0)
-                        ret = translate_bus_error_to_exit_status(r, &error);
+                        r = start_unit_one(bus, method, job_type, *name, mode, &error, w, wu);
+                        if (ret == EXIT_SUCCESS && r < 0)
+                                ret = translate_bus_error_to_exit_status(r, &error);
 
-                if (r >= 0 && streq(method, "StopUnit")) {
-                        r = strv_push(&stopped_units, *name);
-                        if (r < 0)
-                                return log_oom();
+                        if (r >= 0 && streq(method, "StopUnit")) {
+                                r = strv_push(&stopped_units, *name);
+                                if (r < 0)
+                                        return log_oom();
+                        }
                 }
+        else {
+                r = start_units_pipelined(bus, method, job_type, names, mode, w, wu, &stopped_units, &ret);
+                if (r < 0)
+                        return r;
         }
 
         if (!arg_no_block) {
@@ -6077,8 +6509,10 @@ static int daemon_reload(int argc, char *argv[], void *userdata) {
                 break;
 
         case ACTION_SYSTEMCTL:
-                method = streq(argv[0], "daemon-reexec") ? "Reexecute" :
-                                     /* "daemon-reload" */ "Reload";
+                if (streq(argv[0], "daemon-reexec"))
+                        method = "Reexecute";
+                else /* "daemon-reload" */
+                        method = arg_incremental ? "ReloadIncremental" : "Reload";
                 break;
 
         default:
@@ -7815,6 +8249,7 @@ static int systemctl_help(void) {
                "     --no-block          Do not wait until operation finished\n"
                "     --no-wall           Don't send wall message before halt/power-off/reboot\n"
                "     --no-reload         Don't reload daemon after en-/dis-abling unit files\n"
+               "     --incremental       For daemon-reload, only reload units that changed\n"
                "     --no-legend         Do not print a legend (column headers and hints)\n"
                "     --no-pager          Do not pipe output into a pager\n"
                "     --no-ask-password   Do not ask for system passwords\n"
@@ -8073,6 +8508,7 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                 ARG_NO_WALL,
                 ARG_ROOT,
                 ARG_NO_RELOAD,
+                ARG_INCREMENTAL,
                 ARG_KILL_WHO,
                 ARG_NO_ASK_PASSWORD,
                 ARG_FAILED,
@@ -8124,6 +8560,7 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                 { "root",                required_argument, NULL, ARG_ROOT                },
                 { "force",               no_argument,       NULL, 'f'                     },
                 { "no-reload",           no_argument,       NULL, ARG_NO_RELOAD           },
+                { "incremental",         no_argument,       NULL, ARG_INCREMENTAL         },
                 { "kill-who",            required_argument, NULL, ARG_KILL_WHO            },
                 { "signal",              required_argument, NULL, 's'                     },
                 { "no-ask-password",     no_argument,       NULL, ARG_NO_ASK_PASSWORD     },
@@ -8351,6 +8788,10 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                         arg_no_reload = true;
                         break;
 
+                case ARG_INCREMENTAL:
+                        arg_incremental = true;
+                        break;
+
                 case ARG_KILL_WHO:
                         arg_kill_who = optarg;
                         break;
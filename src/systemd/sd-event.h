@@ -22,6 +22,7 @@
 #include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
@@ -44,6 +45,7 @@ _SD_BEGIN_DECLARATIONS;
 
 typedef struct sd_event sd_event;
 typedef struct sd_event_source sd_event_source;
+typedef struct sd_event_pool sd_event_pool;
 
 enum {
         SD_EVENT_OFF = 0,
@@ -68,6 +70,10 @@ enum {
         SD_EVENT_PRIORITY_IDLE = 100
 };
 
+enum {
+        SD_EVENT_IO_URING = 1 << 0,
+};
+
 typedef int (*sd_event_handler_t)(sd_event_source *s, void *userdata);
 typedef int (*sd_event_io_handler_t)(sd_event_source *s, int fd, uint32_t revents, void *userdata);
 typedef int (*sd_event_time_handler_t)(sd_event_source *s, uint64_t usec, void *userdata);
@@ -78,11 +84,15 @@ typedef int (*sd_event_child_handler_t)(sd_event_source *s, const siginfo_t *si,
 typedef void* sd_event_child_handler_t;
 #endif
 typedef int (*sd_event_inotify_handler_t)(sd_event_source *s, const struct inotify_event *event, void *userdata);
+typedef int (*sd_event_async_handler_t)(sd_event_source *s, int result, void *userdata);
+typedef int (*sd_event_work_handler_t)(void *userdata);
+typedef int (*sd_event_work_done_handler_t)(sd_event_source *s, int result, void *userdata);
 typedef _sd_destroy_t sd_event_destroy_t;
 
 int sd_event_default(sd_event **e);
 
 int sd_event_new(sd_event **e);
+int sd_event_new_with_flags(sd_event **e, uint64_t flags);
 sd_event* sd_event_ref(sd_event *e);
 sd_event* sd_event_unref(sd_event *e);
 
@@ -96,6 +106,11 @@ int sd_event_add_inotify(sd_event *e, sd_event_source **s, const char *path, uin
 int sd_event_add_defer(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
 int sd_event_add_post(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
 int sd_event_add_exit(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
+int sd_event_add_async_read(sd_event *e, sd_event_source **s, int fd, void *buf, size_t size, uint64_t offset, sd_event_async_handler_t callback, void *userdata);
+int sd_event_add_async_write(sd_event *e, sd_event_source **s, int fd, const void *buf, size_t size, uint64_t offset, sd_event_async_handler_t callback, void *userdata);
+int sd_event_add_async_recvmsg(sd_event *e, sd_event_source **s, int fd, struct msghdr *msg, int flags, sd_event_async_handler_t callback, void *userdata);
+int sd_event_add_work(sd_event *e, sd_event_source **s, sd_event_pool *pool, sd_event_work_handler_t callback, sd_event_work_done_handler_t done, void *userdata);
+int sd_event_add_memory_pressure(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
 
 int sd_event_prepare(sd_event *e);
 int sd_event_wait(sd_event *e, uint64_t usec);
@@ -113,6 +128,14 @@ int sd_event_get_exit_code(sd_event *e, int *code);
 int sd_event_set_watchdog(sd_event *e, int b);
 int sd_event_get_watchdog(sd_event *e);
 int sd_event_get_iteration(sd_event *e, uint64_t *ret);
+int sd_event_set_statistics(sd_event *e, int b);
+int sd_event_get_statistics(sd_event *e);
+int sd_event_list_statistics(sd_event *e, char ***ret);
+int sd_event_get_source_statistics(sd_event *e, const char *key, uint64_t *ret_dispatched, uint64_t *ret_total_usec, uint64_t *ret_max_usec, uint64_t *ret_latency_total_usec, uint64_t *ret_latency_max_usec);
+
+int sd_event_pool_new(sd_event_pool **ret, unsigned n_threads);
+sd_event_pool* sd_event_pool_ref(sd_event_pool *p);
+sd_event_pool* sd_event_pool_unref(sd_event_pool *p);
 
 sd_event_source* sd_event_source_ref(sd_event_source *s);
 sd_event_source* sd_event_source_unref(sd_event_source *s);
@@ -156,6 +179,8 @@ int sd_event_source_send_child_signal(sd_event_source *s, int sig, const siginfo
 int sd_event_source_send_child_signal(sd_event_source *s, int sig, const void *si, unsigned flags);
 #endif
 int sd_event_source_get_inotify_mask(sd_event_source *s, uint32_t *ret);
+int sd_event_source_set_inotify_coalesce(sd_event_source *s, int b);
+int sd_event_source_get_inotify_coalesce(sd_event_source *s);
 int sd_event_source_set_destroy_callback(sd_event_source *s, sd_event_destroy_t callback);
 int sd_event_source_get_destroy_callback(sd_event_source *s, sd_event_destroy_t *ret);
 int sd_event_source_get_floating(sd_event_source *s);
@@ -165,6 +190,7 @@ int sd_event_source_set_floating(sd_event_source *s, int b);
 _SD_DEFINE_POINTER_CLEANUP_FUNC(sd_event, sd_event_unref);
 _SD_DEFINE_POINTER_CLEANUP_FUNC(sd_event_source, sd_event_source_unref);
 _SD_DEFINE_POINTER_CLEANUP_FUNC(sd_event_source, sd_event_source_disable_unref);
+_SD_DEFINE_POINTER_CLEANUP_FUNC(sd_event_pool, sd_event_pool_unref);
 
 _SD_END_DECLARATIONS;
 
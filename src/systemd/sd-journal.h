@@ -107,6 +107,7 @@ int sd_journal_get_data(sd_journal *j, const char *field, const void **data, siz
 int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t *l);
 int sd_journal_enumerate_available_data(sd_journal *j, const void **data, size_t *l);
 void sd_journal_restart_data(sd_journal *j);
+int sd_journal_set_data_fields(sd_journal *j, const char **fields);
 
 int sd_journal_add_match(sd_journal *j, const void *data, size_t size);
 int sd_journal_add_disjunction(sd_journal *j);
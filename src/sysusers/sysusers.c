@@ -69,6 +69,7 @@ static char *arg_image = NULL;
 static bool arg_cat_config = false;
 static const char *arg_replace = NULL;
 static bool arg_inline = false;
+static bool arg_nss = true;
 static PagerFlags arg_pager_flags = 0;
 
 static OrderedHashmap *users = NULL, *groups = NULL;
@@ -808,6 +809,11 @@ static int write_files(void) {
         return 0;
 }
 
+static bool use_nss(void) {
+        /* When operating on a different root, NSS wouldn't tell us about it anyway */
+        return arg_nss && !arg_root;
+}
+
 static int uid_is_ok(uid_t uid, const char *name, bool check_with_gid) {
         struct passwd *p;
         struct group *g;
@@ -837,7 +843,7 @@ static int uid_is_ok(uid_t uid, const char *name, bool check_with_gid) {
         }
 
         /* Let's also check via NSS, to avoid UID clashes over LDAP and such, just in case */
-        if (!arg_root) {
+        if (use_nss()) {
                 errno = 0;
                 p = getpwuid(uid);
                 if (p)
@@ -942,7 +948,7 @@ static int add_user(Item *i) {
                 return 0;
         }
 
-        if (!arg_root) {
+        if (use_nss()) {
                 struct passwd *p;
 
                 /* Also check NSS */
@@ -1055,7 +1061,7 @@ static int gid_is_ok(gid_t gid) {
         if (hashmap_contains(database_by_uid, UID_TO_PTR(gid)))
                 return 0;
 
-        if (!arg_root) {
+        if (use_nss()) {
                 errno = 0;
                 g = getgrgid(gid);
                 if (g)
@@ -1087,7 +1093,7 @@ static int get_gid_by_name(const char *name, gid_t *gid) {
         }
 
         /* Also check NSS */
-        if (!arg_root) {
+        if (use_nss()) {
                 struct group *g;
 
                 errno = 0;
@@ -1263,7 +1269,8 @@ static Item* item_free(Item *i) {
 }
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(Item*, item_free);
-DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(item_hash_ops, char, string_hash_func, string_compare_func, Item, item_free);
+/* The user and group names come from configuration files, which are trusted */
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(item_hash_ops, char, fast_string_hash_func, string_compare_func, Item, item_free);
 
 static int add_implicit(void) {
         char *g, **l;
@@ -1746,6 +1753,7 @@ static int help(void) {
                "     --image=PATH           Operate on disk image as filesystem root\n"
                "     --replace=PATH         Treat arguments as replacement for PATH\n"
                "     --inline               Treat arguments as configuration lines\n"
+               "     --no-nss               Don't look up existing users and groups via NSS\n"
                "     --no-pager             Do not pipe output into a pager\n"
                "\nSee the %s for details.\n"
                , program_invocation_short_name
@@ -1764,6 +1772,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_IMAGE,
                 ARG_REPLACE,
                 ARG_INLINE,
+                ARG_NO_NSS,
                 ARG_NO_PAGER,
         };
 
@@ -1775,6 +1784,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "image",      required_argument, NULL, ARG_IMAGE          },
                 { "replace",    required_argument, NULL, ARG_REPLACE    },
                 { "inline",     no_argument,       NULL, ARG_INLINE     },
+                { "no-nss",     no_argument,       NULL, ARG_NO_NSS     },
                 { "no-pager",   no_argument,       NULL, ARG_NO_PAGER   },
                 {}
         };
@@ -1823,6 +1833,10 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_inline = true;
                         break;
 
+                case ARG_NO_NSS:
+                        arg_nss = false;
+                        break;
+
                 case ARG_NO_PAGER:
                         arg_pager_flags |= PAGER_DISABLE;
                         break;
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "calendarspec.h"
+#include "tests.h"
+
+#define START_USEC UINT64_C(1500000000000000)
+
+typedef struct Context {
+        CalendarSpec *spec;
+        usec_t next;
+} Context;
+
+static void bench_next(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                usec_t w;
+                int r;
+
+                /* Calculate a long series of elapses, and start over once sparse specs run out of them */
+                r = calendar_spec_next_usec(c->spec, c->next, &w);
+                if (r == -ENOENT) {
+                        c->next = START_USEC;
+                        continue;
+                }
+                assert_se(r >= 0);
+                assert_se(w > c->next);
+                c->next = w;
+        }
+}
+
+int main(int argc, char *argv[]) {
+        static const struct {
+                const char *name;
+                const char *spec;
+        } table[] = {
+                { "calendarspec-next-minutely",      "*-*-* *:*:00"                },
+                { "calendarspec-next-daily",         "*-*-* 06:00:00"              },
+                { "calendarspec-next-friday-13",     "Fri *-*-13 00:00:00"         },
+                { "calendarspec-next-leap-day",      "*-02-29 00:00:00"            },
+                { "calendarspec-next-first-monday",  "Mon *-05~01..07 12:00"       },
+                { "calendarspec-next-office-hours",  "Mon..Fri *-*-* 09..17/2:30"  },
+                { "calendarspec-next-friday-13-utc", "Fri *-*-13 00:00:00 UTC"     },
+                { "calendarspec-next-leap-day-utc",  "*-02-29 00:00:00 UTC"        },
+        };
+
+        test_setup_logging(LOG_INFO);
+
+        /* Local time is where mktime() gets expensive, hence pick one with DST unless told otherwise */
+        if (!getenv("TZ"))
+                assert_se(setenv("TZ", ":Europe/Berlin", 1) >= 0);
+        tzset();
+
+        for (size_t i = 0; i < ELEMENTSOF(table); i++) {
+                _cleanup_(calendar_spec_freep) CalendarSpec *spec = NULL;
+                Context c = {
+                        .next = START_USEC,
+                };
+
+                assert_se(calendar_spec_from_string(table[i].spec, &spec) >= 0);
+                c.spec = spec;
+
+                benchmark_run(table[i].name, bench_next, &c);
+        }
+
+        return 0;
+}
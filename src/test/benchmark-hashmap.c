@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "hash-funcs.h"
+#include "hashmap.h"
+#include "siphash24.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+
+#define N_KEYS 65536U
+
+typedef struct Context {
+        Hashmap *numbers;
+        Hashmap *strings;
+        char **keys;
+        unsigned next;
+} Context;
+
+typedef struct LookupContext {
+        Hashmap *h;
+        char **keys;
+        bool strings;
+        unsigned next;
+} LookupContext;
+
+/* Wrap the common hash and compare functions, so that the hashmap doesn't recognize them, and calls them
+ * through the hash_ops like for any other key type */
+static void opaque_trivial_hash_func(const void *p, struct siphash *state) {
+        trivial_hash_func(p, state);
+}
+
+static int opaque_trivial_compare_func(const void *a, const void *b) {
+        return trivial_compare_func(a, b);
+}
+
+static const struct hash_ops opaque_trivial_hash_ops = {
+        .hash = opaque_trivial_hash_func,
+        .compare = opaque_trivial_compare_func,
+};
+
+static void opaque_string_hash_func(const char *p, struct siphash *state) {
+        string_hash_func(p, state);
+}
+
+static int opaque_string_compare_func(const char *a, const char *b) {
+        return strcmp(a, b);
+}
+
+DEFINE_PRIVATE_HASH_OPS(opaque_string_hash_ops, char, opaque_string_hash_func, opaque_string_compare_func);
+
+static void bench_get_hit(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++, c->next++)
+                BENCHMARK_KEEP(hashmap_get(c->numbers, UINT_TO_PTR(c->next % N_KEYS + 1)));
+}
+
+static void bench_get_miss(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++, c->next++)
+                BENCHMARK_KEEP(hashmap_get(c->numbers, UINT_TO_PTR(c->next % N_KEYS + N_KEYS + 1)));
+}
+
+static void bench_put_remove(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        /* Keeps the size of the table constant, so that every sample sees the same load */
+        for (uint64_t i = 0; i < n; i++, c->next++) {
+                void *k = UINT_TO_PTR(c->next % N_KEYS + N_KEYS + 1);
+
+                assert_se(hashmap_put(c->numbers, k, k) > 0);
+                assert_se(hashmap_remove(c->numbers, k) == k);
+        }
+}
+
+static void bench_string_get(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++, c->next++)
+                BENCHMARK_KEEP(hashmap_get(c->strings, c->keys[c->next % N_KEYS]));
+}
+
+static void bench_lookup(void *userdata, uint64_t n) {
+        LookupContext *c = userdata;
+
+        /* One successful and one failed lookup per operation */
+        for (uint64_t i = 0; i < n; i++, c->next++) {
+                unsigned k = c->next % N_KEYS;
+
+                assert_se(PTR_TO_UINT(hashmap_get(c->h, c->strings ? (void*) c->keys[k] : UINT_TO_PTR(k + 1))) == k + 1);
+                assert_se(!hashmap_get(c->h, c->strings ? "nonexistent" : UINT_TO_PTR(k + N_KEYS + 1)));
+        }
+}
+
+static void bench_iterate(void *userdata, uint64_t n) {
+        Context *c = userdata;
+        Iterator it;
+        void *v;
+
+        for (uint64_t i = 0; i < n; i++)
+                HASHMAP_FOREACH(v, c->numbers, it)
+                        BENCHMARK_KEEP(v);
+}
+
+static void bench_fill(void *userdata, uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_hashmap_free_ Hashmap *h = NULL;
+
+                assert_se(h = hashmap_new(NULL));
+                for (unsigned k = 1; k <= 1024; k++)
+                        assert_se(hashmap_put(h, UINT_TO_PTR(k), UINT_TO_PTR(k)) > 0);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        static const struct {
+                const char *name;
+                const struct hash_ops *ops;
+                bool strings;
+        } lookup_table[] = {
+                { "hashmap-lookup-trivial",        &trivial_hash_ops,        false },
+                { "hashmap-lookup-opaque-trivial", &opaque_trivial_hash_ops, false },
+                { "hashmap-lookup-string",         &string_hash_ops,         true  },
+                { "hashmap-lookup-opaque-string",  &opaque_string_hash_ops,  true  },
+                { "hashmap-lookup-fast-string",    &fast_string_hash_ops,    true  },
+        };
+        Context c = {};
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(c.numbers = hashmap_new(NULL));
+        assert_se(c.strings = hashmap_new(&string_hash_ops));
+        assert_se(c.keys = new0(char*, N_KEYS + 1));
+
+        for (unsigned i = 0; i < N_KEYS; i++) {
+                char buf[STRLEN("key-") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(buf, "key-%u", i);
+                assert_se(c.keys[i] = strdup(buf));
+
+                assert_se(hashmap_put(c.numbers, UINT_TO_PTR(i + 1), UINT_TO_PTR(i + 1)) > 0);
+                assert_se(hashmap_put(c.strings, c.keys[i], c.keys[i]) > 0);
+        }
+
+        benchmark_run("hashmap-get-hit", bench_get_hit, &c);
+        benchmark_run("hashmap-get-miss", bench_get_miss, &c);
+        benchmark_run("hashmap-put-remove", bench_put_remove, &c);
+        benchmark_run("hashmap-string-get", bench_string_get, &c);
+        benchmark_run("hashmap-iterate-64k", bench_iterate, &c);
+        benchmark_run("hashmap-fill-1k", bench_fill, NULL);
+
+        for (size_t j = 0; j < ELEMENTSOF(lookup_table); j++) {
+                _cleanup_hashmap_free_ Hashmap *h = NULL;
+                LookupContext l = {
+                        .keys = c.keys,
+                        .strings = lookup_table[j].strings,
+                };
+
+                assert_se(h = hashmap_new(lookup_table[j].ops));
+                for (unsigned i = 0; i < N_KEYS; i++)
+                        assert_se(hashmap_put(h, l.strings ? (void*) c.keys[i] : UINT_TO_PTR(i + 1), UINT_TO_PTR(i + 1)) > 0);
+                l.h = h;
+
+                benchmark_run(lookup_table[j].name, bench_lookup, &l);
+        }
+
+        hashmap_free(c.numbers);
+        hashmap_free(c.strings);
+        strv_free(c.keys);
+
+        return 0;
+}
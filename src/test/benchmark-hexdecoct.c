@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "hexdecoct.h"
+#include "tests.h"
+
+#define DATA_SIZE (64U * 1024U)
+
+typedef struct Context {
+        uint8_t *data;
+        char *hex;
+        char *b64;
+} Context;
+
+static void bench_hexmem(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_free_ char *hex = NULL;
+
+                assert_se(hex = hexmem(c->data, DATA_SIZE));
+        }
+}
+
+static void bench_unhexmem(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_free_ void *mem = NULL;
+                size_t size;
+
+                assert_se(unhexmem(c->hex, (size_t) -1, &mem, &size) >= 0);
+        }
+}
+
+static void bench_base64mem(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_free_ char *b64 = NULL;
+
+                assert_se(base64mem(c->data, DATA_SIZE, &b64) >= 0);
+        }
+}
+
+static void bench_unbase64mem(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_free_ void *mem = NULL;
+                size_t size;
+
+                assert_se(unbase64mem(c->b64, (size_t) -1, &mem, &size) >= 0);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        Context c = {};
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(c.data = malloc(DATA_SIZE));
+        for (size_t i = 0; i < DATA_SIZE; i++)
+                c.data[i] = i * 7 + (i >> 8);
+
+        assert_se(c.hex = hexmem(c.data, DATA_SIZE));
+        assert_se(base64mem(c.data, DATA_SIZE, &c.b64) >= 0);
+
+        benchmark_run("hexmem-64k", bench_hexmem, &c);
+        benchmark_run("unhexmem-64k", bench_unhexmem, &c);
+        benchmark_run("base64mem-64k", bench_base64mem, &c);
+        benchmark_run("unbase64mem-64k", bench_unbase64mem, &c);
+
+        free(c.data);
+        free(c.hex);
+        free(c.b64);
+
+        return 0;
+}
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "json.h"
+#include "stdio-util.h"
+#include "strv.h"
+#include "tests.h"
+
+#define N_RECORDS 64U
+
+typedef struct Context {
+        JsonVariant *variant;
+        char *text;
+} Context;
+
+static void bench_parse(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+
+                assert_se(json_parse(c->text, 0, &v, NULL, NULL) >= 0);
+        }
+}
+
+static void bench_format(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_free_ char *s = NULL;
+
+                assert_se(json_variant_format(c->variant, 0, &s) >= 0);
+        }
+}
+
+static void bench_lookup(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                JsonVariant *e;
+
+                assert_se(e = json_variant_by_index(c->variant, i % N_RECORDS));
+                assert_se(json_variant_by_key(e, "homeDirectory"));
+                assert_se(!json_variant_by_key(e, "doesNotExist"));
+        }
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(json_variant_unrefp) JsonVariant *array = NULL;
+        char **groups = STRV_MAKE("wheel", "audio", "video", "users");
+        char **passwords = STRV_MAKE("$6$abcdefgh$ijklmnopqrstuvwxyz0123456789");
+        Context c = {};
+
+        test_setup_logging(LOG_INFO);
+
+        /* An array of records shaped like user records, as passed around by userdbd and homed */
+        for (unsigned i = 0; i < N_RECORDS; i++) {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                char name[STRLEN("user") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(name, "user%u", i);
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR("userName", JSON_BUILD_STRING(name)),
+                                                     JSON_BUILD_PAIR("uid", JSON_BUILD_UNSIGNED(1000 + i)),
+                                                     JSON_BUILD_PAIR("gid", JSON_BUILD_UNSIGNED(1000 + i)),
+                                                     JSON_BUILD_PAIR("realName", JSON_BUILD_STRING("Some Body \"with quotes\" and ünicode")),
+                                                     JSON_BUILD_PAIR("homeDirectory", JSON_BUILD_STRING("/home/somebody")),
+                                                     JSON_BUILD_PAIR("shell", JSON_BUILD_STRING("/bin/bash")),
+                                                     JSON_BUILD_PAIR("memberOf", JSON_BUILD_STRV(groups)),
+                                                     JSON_BUILD_PAIR("locked", JSON_BUILD_BOOLEAN(false)),
+                                                     JSON_BUILD_PAIR("lastChangeUSec", JSON_BUILD_UNSIGNED(UINT64_C(1600000000000000) + i)),
+                                                     JSON_BUILD_PAIR("diskSize", JSON_BUILD_REAL(1.5e10)),
+                                                     JSON_BUILD_PAIR("privileged", JSON_BUILD_OBJECT(
+                                                                                     JSON_BUILD_PAIR("hashedPassword", JSON_BUILD_STRV(passwords)))))) >= 0);
+
+                assert_se(json_variant_append_array(&array, v) >= 0);
+        }
+
+        assert_se(json_variant_format(array, 0, &c.text) >= 0);
+        assert_se(json_parse(c.text, 0, &c.variant, NULL, NULL) >= 0);
+
+        log_info("Document is %zu bytes", strlen(c.text));
+
+        benchmark_run("json-parse", bench_parse, &c);
+        benchmark_run("json-format", bench_format, &c);
+        benchmark_run("json-lookup", bench_lookup, &c);
+
+        json_variant_unref(c.variant);
+        free(c.text);
+
+        return 0;
+}
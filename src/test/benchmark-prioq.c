@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdlib.h>
+
+#include "alloc-util.h"
+#include "benchmark.h"
+#include "prioq.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+typedef struct Timer {
+        usec_t next;
+        unsigned idx;
+} Timer;
+
+typedef struct Context {
+        Prioq *queue;
+        Timer *timers;
+        unsigned n_timers;
+        bool keyed;
+        usec_t clock;
+        uint64_t iteration;
+} Context;
+
+static int timer_compare(const void *a, const void *b) {
+        const Timer *x = a, *y = b;
+
+        return CMP(x->next, y->next);
+}
+
+static void bench_rearm(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        /* Mimic what sd-event does with its timer queues: a number of periodic timers, of which the earliest
+         * one is dispatched and rearmed over and over again, with some others being rearmed or disabled and
+         * reenabled in between. */
+
+        for (uint64_t i = 0; i < n; i++, c->iteration++) {
+                Timer *t;
+
+                assert_se(t = prioq_peek(c->queue));
+                assert_se(t->next >= c->clock);
+                c->clock = t->next;
+
+                t->next = c->clock + 1 + rand() % USEC_PER_SEC;
+                assert_se(prioq_reshuffle_with_key(c->queue, t, &t->idx, c->keyed ? t->next : 0) == 1);
+
+                if (c->iteration % 4 == 0) {
+                        t = c->timers + rand() % c->n_timers;
+                        t->next = c->clock + 1 + rand() % USEC_PER_SEC;
+                        assert_se(prioq_reshuffle_with_key(c->queue, t, &t->idx, c->keyed ? t->next : 0) == 1);
+                }
+
+                if (c->iteration % 16 == 0) {
+                        t = c->timers + rand() % c->n_timers;
+                        assert_se(prioq_remove(c->queue, t, &t->idx) == 1);
+                        t->next = MAX(t->next, c->clock);
+                        assert_se(prioq_put_with_key(c->queue, t, &t->idx, c->keyed ? t->next : 0) >= 0);
+                }
+        }
+}
+
+static void run_one(unsigned n_timers, bool keyed) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        _cleanup_free_ Timer *timers = NULL;
+        char name[STRLEN("prioq-rearm--compare") + DECIMAL_STR_MAX(unsigned)];
+
+        srand(0);
+
+        assert_se(q = prioq_new(keyed ? NULL : timer_compare));
+        assert_se(timers = new(Timer, n_timers));
+
+        for (unsigned i = 0; i < n_timers; i++) {
+                timers[i].next = rand() % USEC_PER_SEC;
+                assert_se(prioq_put_with_key(q, timers + i, &timers[i].idx, keyed ? timers[i].next : 0) >= 0);
+        }
+
+        Context c = {
+                .queue = q,
+                .timers = timers,
+                .n_timers = n_timers,
+                .keyed = keyed,
+        };
+
+        xsprintf(name, "prioq-rearm-%u-%s", n_timers, keyed ? "keyed" : "compare");
+        benchmark_run(name, bench_rearm, &c);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        for (unsigned n_timers = 16; n_timers <= 65536; n_timers *= 16) {
+                run_one(n_timers, false);
+                run_one(n_timers, true);
+        }
+
+        return 0;
+}
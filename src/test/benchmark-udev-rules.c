@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <signal.h>
+#include <stdio.h>
+
+#include "benchmark.h"
+#include "device-private.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "udev-event.h"
+#include "udev-rules.h"
+
+#define N_GROUPS 100U
+
+typedef struct Context {
+        const char *filename;
+        UdevRules *rules;
+        sd_device *device;
+} Context;
+
+static void write_rules(FILE *f) {
+        /* Something resembling the rules shipped by systemd and the usual distribution packages: most
+         * rules are for other subsystems, or skip the device early on. */
+        for (unsigned i = 0; i < N_GROUPS; i++)
+                fprintf(f,
+                        "ACTION==\"remove\", GOTO=\"bench_end_%1$u\"\n"
+                        "SUBSYSTEM==\"block\", KERNEL==\"sd*[0-9]\", ENV{ID_BENCH_PART_%1$u}=\"1\"\n"
+                        "SUBSYSTEM==\"usb\", ENV{DEVTYPE}==\"usb_device\", ENV{ID_BENCH_USB_%1$u}=\"%1$u\"\n"
+                        "KERNEL==\"tty[0-9]*\", GROUP=\"tty\", MODE=\"0620\"\n"
+                        "SUBSYSTEM!=\"net\", GOTO=\"bench_end_%1$u\"\n"
+                        "ENV{ID_NET_BENCH_%1$u}=\"%%k\"\n"
+                        "KERNEL==\"eth*|wl*|en*\", ENV{ID_BENCH_PHYSICAL_%1$u}=\"1\"\n"
+                        "LABEL=\"bench_end_%1$u\"\n"
+                        "\n",
+                        i);
+}
+
+static void bench_parse(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
+
+                assert_se(rules = udev_rules_new(RESOLVE_NAME_EARLY));
+                assert_se(udev_rules_parse_file(rules, c->filename) >= 0);
+        }
+}
+
+static void bench_apply(void *userdata, uint64_t n) {
+        Context *c = userdata;
+
+        for (uint64_t i = 0; i < n; i++) {
+                _cleanup_(udev_event_freep) UdevEvent *event = NULL;
+
+                assert_se(event = udev_event_new(c->device, 0, NULL));
+                assert_se(udev_rules_apply_to_event(c->rules, event, 0, SIGKILL, NULL) >= 0);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(unlink_tempfilep) char filename[] = "/tmp/benchmark-udev-rules-XXXXXX";
+        _cleanup_strv_free_ char **uevent = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *value;
+        Context c = {};
+        int fd;
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se((fd = mkostemp_safe(filename)) >= 0);
+        assert_se(f = fdopen(fd, "w"));
+        write_rules(f);
+        assert_se(fflush_and_check(f) >= 0);
+        c.filename = filename;
+
+        /* A synthetic uevent, so that we don't depend on what's in /sys */
+        assert_se(uevent = strv_new("ACTION=add",
+                                    "DEVPATH=/devices/virtual/net/veth4711",
+                                    "SUBSYSTEM=net",
+                                    "INTERFACE=veth4711",
+                                    "IFINDEX=4711",
+                                    "SEQNUM=1"));
+        assert_se(device_new_from_strv(&c.device, uevent) >= 0);
+
+        assert_se(c.rules = udev_rules_new(RESOLVE_NAME_EARLY));
+        assert_se(udev_rules_parse_file(c.rules, c.filename) >= 0);
+
+        /* Make sure the rules do what we think they do */
+        bench_apply(&c, 1);
+        assert_se(sd_device_get_property_value(c.device, "ID_NET_BENCH_0", &value) >= 0);
+        assert_se(streq(value, "veth4711"));
+        assert_se(sd_device_get_property_value(c.device, "ID_BENCH_PHYSICAL_0", NULL) == -ENOENT);
+
+        benchmark_run("udev-rules-parse", bench_parse, &c);
+        benchmark_run("udev-rules-apply", bench_apply, &c);
+
+        udev_rules_free(c.rules);
+        sd_device_unref(c.device);
+
+        return 0;
+}
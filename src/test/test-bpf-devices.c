@@ -27,7 +27,7 @@ static void test_policy_closed(const char *cgroup_path, BPFProgram **installed_p
         r = bpf_devices_allow_list_static(prog, cgroup_path);
         assert_se(r >= 0);
 
-        r = bpf_devices_apply_policy(prog, CGROUP_DEVICE_POLICY_CLOSED, true, cgroup_path, installed_prog);
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_CLOSED, true, cgroup_path, installed_prog, NULL);
         assert_se(r >= 0);
 
         const char *s;
@@ -52,6 +52,28 @@ static void test_policy_closed(const char *cgroup_path, BPFProgram **installed_p
         assert_se(wrong == 0);
 }
 
+static void test_policy_unchanged(const char *cgroup_path, BPFProgram **installed_prog) {
+        _cleanup_(bpf_program_unrefp) BPFProgram *prog = NULL;
+        BPFProgram *old;
+        int r;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(old = *installed_prog);
+
+        r = bpf_devices_cgroup_init(&prog, CGROUP_DEVICE_POLICY_CLOSED, true);
+        assert_se(r >= 0);
+
+        r = bpf_devices_allow_list_static(prog, cgroup_path);
+        assert_se(r >= 0);
+
+        /* Same policy as in test_policy_closed(), hence the program attached already must be kept */
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_CLOSED, true, cgroup_path, installed_prog, NULL);
+        assert_se(r >= 0);
+        assert_se(*installed_prog == old);
+        assert_se(prog->kernel_fd < 0);
+}
+
 static void test_policy_strict(const char *cgroup_path, BPFProgram **installed_prog) {
         _cleanup_(bpf_program_unrefp) BPFProgram *prog = NULL;
         unsigned wrong = 0;
@@ -71,7 +93,7 @@ static void test_policy_strict(const char *cgroup_path, BPFProgram **installed_p
         r = bpf_devices_allow_list_device(prog, cgroup_path, "/dev/zero", "w");
         assert_se(r >= 0);
 
-        r = bpf_devices_apply_policy(prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog);
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog, NULL);
         assert_se(r >= 0);
 
         {
@@ -142,7 +164,7 @@ static void test_policy_allow_list_major(const char *pattern, const char *cgroup
         r = bpf_devices_allow_list_major(prog, cgroup_path, pattern, 'c', "rw");
         assert_se(r >= 0);
 
-        r = bpf_devices_apply_policy(prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog);
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog, NULL);
         assert_se(r >= 0);
 
         /* /dev/null, /dev/full have major==1, /dev/tty has major==5 */
@@ -201,7 +223,7 @@ static void test_policy_allow_list_major_star(char type, const char *cgroup_path
         r = bpf_devices_allow_list_major(prog, cgroup_path, "*", type, "rw");
         assert_se(r >= 0);
 
-        r = bpf_devices_apply_policy(prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog);
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_STRICT, true, cgroup_path, installed_prog, NULL);
         assert_se(r >= 0);
 
         {
@@ -234,7 +256,7 @@ static void test_policy_empty(bool add_mismatched, const char *cgroup_path, BPFP
                 assert_se(r < 0);
         }
 
-        r = bpf_devices_apply_policy(prog, CGROUP_DEVICE_POLICY_STRICT, false, cgroup_path, installed_prog);
+        r = bpf_devices_apply_policy(NULL, prog, CGROUP_DEVICE_POLICY_STRICT, false, cgroup_path, installed_prog, NULL);
         assert_se(r >= 0);
 
         {
@@ -285,6 +307,7 @@ int main(int argc, char *argv[]) {
         _cleanup_(bpf_program_unrefp) BPFProgram *prog = NULL;
 
         test_policy_closed(cgroup, &prog);
+        test_policy_unchanged(cgroup, &prog);
         test_policy_strict(cgroup, &prog);
 
         test_policy_allow_list_major("mem", cgroup, &prog);
@@ -21,10 +21,11 @@ int main(int argc, char *argv[]) {
         };
 
         _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL;
-        CGroupContext *cc = NULL;
+        CGroupContext *cc = NULL, *cc2 = NULL;
+        BPFAccessMap *maps[2];
         _cleanup_(bpf_program_unrefp) BPFProgram *p = NULL;
         _cleanup_(manager_freep) Manager *m = NULL;
-        Unit *u;
+        Unit *u, *u2;
         char log_buf[65535];
         struct rlimit rl;
         int r;
@@ -142,6 +143,28 @@ int main(int argc, char *argv[]) {
         assert(u->ip_bpf_ingress);
         assert(u->ip_bpf_egress);
 
+        /* A unit with the same access lists, in a different order and with the host bits set differently,
+         * shares the maps, and so does a recompilation of the unit itself */
+        assert_se(u2 = unit_new(m, sizeof(Service)));
+        assert_se(unit_add_name(u2, "bar.service") == 0);
+        assert_se(cc2 = unit_get_cgroup_context(u2));
+
+        assert_se(config_parse_ip_address_access(u2->id, "filename", 1, "Service", 1, "IPAddressAllow", 0, "127.0.0.2 10.0.1.7/24", &cc2->ip_address_allow, NULL) == 0);
+        assert_se(config_parse_ip_address_access(u2->id, "filename", 1, "Service", 1, "IPAddressDeny", 0, "10.0.3.0/24 127.0.0.0/25", &cc2->ip_address_deny, NULL) == 0);
+
+        assert_se(bpf_firewall_compile(u2) >= 0);
+        assert_se(u->ipv4_allow_map);
+        assert_se(u->ipv4_deny_map);
+        assert_se(u2->ipv4_allow_map == u->ipv4_allow_map);
+        assert_se(u2->ipv4_deny_map == u->ipv4_deny_map);
+        assert_se(!u->ipv6_allow_map && !u2->ipv6_allow_map);
+
+        maps[0] = u->ipv4_allow_map;
+        maps[1] = u->ipv4_deny_map;
+        assert_se(bpf_firewall_compile(u) >= 0);
+        assert_se(u->ipv4_allow_map == maps[0]);
+        assert_se(u->ipv4_deny_map == maps[1]);
+
         r = bpf_program_load_kernel(u->ip_bpf_ingress, log_buf, ELEMENTSOF(log_buf));
 
         log_notice("log:");
@@ -73,6 +73,47 @@ static void test_next(const char *input, const char *new_tz, usec_t after, usec_
         tzset();
 }
 
+static void test_next_chain(const char *input, const char *new_tz, usec_t after, usec_t until, unsigned n_expect) {
+        _cleanup_(calendar_spec_freep) CalendarSpec *c = NULL;
+        char buf[FORMAT_TIMESTAMP_MAX];
+        unsigned n = 0;
+        char *old_tz;
+        usec_t u;
+
+        /* Follow the chain of elapses across a DST transition, and count them */
+
+        old_tz = getenv("TZ");
+        if (old_tz)
+                old_tz = strdupa(old_tz);
+
+        assert_se(setenv("TZ", strjoina(":", new_tz), 1) >= 0);
+        tzset();
+
+        assert_se(calendar_spec_from_string(input, &c) >= 0);
+
+        printf("\"%s\" in %s\n", input, new_tz);
+
+        for (u = after;; n++) {
+                usec_t w;
+
+                assert_se(calendar_spec_next_usec(c, u, &w) >= 0);
+                if (w >= until)
+                        break;
+
+                printf("At: %s\n", format_timestamp_style(buf, sizeof buf, w, TIMESTAMP_UTC));
+                assert_se(w > u);
+                u = w;
+        }
+
+        assert_se(n == n_expect);
+
+        if (old_tz)
+                assert_se(setenv("TZ", old_tz, 1) >= 0);
+        else
+                assert_se(unsetenv("TZ") >= 0);
+        tzset();
+}
+
 static void test_timestamp(void) {
         char buf[FORMAT_TIMESTAMP_MAX];
         _cleanup_free_ char *t = NULL;
@@ -218,6 +259,18 @@ int main(int argc, char* argv[]) {
         // Confirm that timezones in the Spec work regardless of current timezone
         test_next("2017-09-09 20:42:00 Pacific/Auckland", "", 12345, 1504946520000000);
         test_next("2017-09-09 20:42:00 Pacific/Auckland", "EET", 12345, 1504946520000000);
+        // Skip local times that don't exist on days the clock is turned forward
+        test_next("*-*-* 02:30:00", "Europe/Berlin", 1490443200000000, 1490574600000000);
+        test_next("*-*-* 02:30:00", "Pacific/Auckland", 1506124800000000, 1506259800000000);
+        test_next("daily", "America/Sao_Paulo", 1541246400000000, 1541383200000000);
+        // Local times that happen twice when the clock is turned back elapse at the first occurrence only
+        test_next("*-*-* 02:30:00", "Europe/Berlin", 1509192000000000, 1509237000000000);
+        test_next("*-*-* 02:30:00", "Europe/Berlin", 1509237000000000, 1509327000000000);
+        test_next("*-*-* *:30:00", "Europe/Berlin", 1509237000000000, 1509244200000000);
+        // A day with 23 and one with 25 hours, with each local hour elapsing once
+        test_next_chain("*-*-* *:00:00", "Europe/Berlin", 1490482800000000, 1490565600000000, 22);
+        test_next_chain("*-*-* *:30:00", "Europe/Berlin", 1509228000000000, 1509318000000000, 24);
+        test_next_chain("*-*-* *:*:00", "Pacific/Auckland", 1491050000000000, 1491060000000000, 106);
 
         assert_se(calendar_spec_from_string("test", &c) < 0);
         assert_se(calendar_spec_from_string(" utc", &c) < 0);
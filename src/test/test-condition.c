@@ -296,6 +296,32 @@ static void test_condition_test_kernel_command_line(void) {
         condition_free(condition);
 }
 
+static void test_condition_cache(void) {
+        Condition *condition;
+
+        assert_se(setenv("SYSTEMD_PROC_CMDLINE", "foo=bar", 1) >= 0);
+
+        condition_cache_enable(true);
+
+        assert_se(condition = condition_new(CONDITION_KERNEL_COMMAND_LINE, "foo", false, false));
+        assert_se(condition_test(condition, environ) > 0);
+
+        /* While caching is enabled, changes are not noticed */
+        assert_se(setenv("SYSTEMD_PROC_CMDLINE", "quux", 1) >= 0);
+        assert_se(condition_test(condition, environ) > 0);
+
+        /* … but negation is still applied */
+        condition->negate = true;
+        assert_se(condition_test(condition, environ) == 0);
+        condition->negate = false;
+
+        condition_cache_enable(false);
+        assert_se(condition_test(condition, environ) == 0);
+        condition_free(condition);
+
+        assert_se(unsetenv("SYSTEMD_PROC_CMDLINE") >= 0);
+}
+
 static void test_condition_test_kernel_version(void) {
         Condition *condition;
         struct utsname u;
@@ -853,6 +879,7 @@ int main(int argc, char *argv[]) {
         test_condition_test_host();
         test_condition_test_architecture();
         test_condition_test_kernel_command_line();
+        test_condition_cache();
         test_condition_test_kernel_version();
         test_condition_test_security();
         print_securities();
@@ -11,6 +11,7 @@
 #include "hexdecoct.h"
 #include "log.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "mkdir.h"
 #include "path-util.h"
 #include "rm-rf.h"
@@ -260,6 +261,101 @@ static void test_copy_bytes_regular_file(const char *src, bool try_reflink, uint
         unlink(fn3);
 }
 
+static void test_copy_holes(void) {
+        char fn[] = "/var/tmp/test-copy-hole-fd-XXXXXX";
+        char fn_copy[] = "/var/tmp/test-copy-hole-fd-XXXXXX";
+        char buf[4096] = {}, buf2[sizeof(buf)];
+        _cleanup_close_ int fd = -1, fd_copy = -1;
+        struct stat st;
+        off_t blksz;
+
+        log_info("%s", __func__);
+
+        fd = mkostemp_safe(fn);
+        assert_se(fd >= 0);
+
+        fd_copy = mkostemp_safe(fn_copy);
+        assert_se(fd_copy >= 0);
+
+        assert_se(fstat(fd, &st) >= 0);
+        blksz = MAX((off_t) st.st_blksize, (off_t) sizeof(buf));
+
+        /* A hole, followed by one block of data, followed by another hole up to EOF */
+        memset(buf, 'x', sizeof(buf));
+        assert_se(ftruncate(fd, 3 * blksz) >= 0);
+        assert_se(pwrite(fd, buf, sizeof(buf), blksz) == sizeof(buf));
+
+        if (lseek(fd, 0, SEEK_DATA) != blksz || lseek(fd, blksz, SEEK_HOLE) != 2 * blksz) {
+                log_notice("File system doesn't track holes at block granularity, skipping test.");
+                goto finish;
+        }
+
+        assert_se(lseek(fd, 0, SEEK_SET) == 0);
+        assert_se(copy_bytes(fd, fd_copy, (uint64_t) -1, COPY_HOLES) >= 0);
+
+        /* The size is retained, and so are both holes */
+        assert_se(fstat(fd_copy, &st) >= 0);
+        assert_se(st.st_size == 3 * blksz);
+        assert_se(lseek(fd_copy, 0, SEEK_DATA) == blksz);
+        assert_se(lseek(fd_copy, blksz, SEEK_HOLE) == 2 * blksz);
+
+        assert_se(pread(fd_copy, buf2, sizeof(buf2), blksz) == sizeof(buf2));
+        assert_se(memcmp(buf, buf2, sizeof(buf)) == 0);
+
+        assert_se(pread(fd_copy, buf2, sizeof(buf2), 0) == sizeof(buf2));
+        assert_se(memeqzero(buf2, sizeof(buf2)));
+
+finish:
+        unlink(fn);
+        unlink(fn_copy);
+}
+
+static void test_copy_sparse(void) {
+        char fn[] = "/var/tmp/test-copy-sparse-fd-XXXXXX";
+        char fn_copy[] = "/var/tmp/test-copy-sparse-fd-XXXXXX";
+        char buf[16*1024] = {}, buf2[sizeof(buf)];
+        _cleanup_close_ int fd = -1, fd_copy = -1;
+        struct stat st;
+
+        log_info("%s", __func__);
+
+        fd = mkostemp_safe(fn);
+        assert_se(fd >= 0);
+
+        fd_copy = mkostemp_safe(fn_copy);
+        assert_se(fd_copy >= 0);
+
+        /* Zeroes, data, zeroes, all written out explicitly */
+        assert_se(write(fd, buf, sizeof(buf)) == sizeof(buf));
+        memset(buf, 'x', sizeof(buf));
+        assert_se(write(fd, buf, sizeof(buf)) == sizeof(buf));
+        memzero(buf, sizeof(buf));
+        assert_se(write(fd, buf, sizeof(buf)) == sizeof(buf));
+
+        assert_se(lseek(fd, 0, SEEK_SET) == 0);
+        assert_se(copy_bytes(fd, fd_copy, (uint64_t) -1, COPY_SPARSE) >= 0);
+
+        /* The trailing zeroes must not get lost */
+        assert_se(fstat(fd_copy, &st) >= 0);
+        assert_se(st.st_size == 3 * sizeof(buf));
+
+        assert_se(pread(fd_copy, buf2, sizeof(buf2), 0) == sizeof(buf2));
+        assert_se(memeqzero(buf2, sizeof(buf2)));
+        assert_se(pread(fd_copy, buf2, sizeof(buf2), sizeof(buf2)) == sizeof(buf2));
+        memset(buf, 'x', sizeof(buf));
+        assert_se(memcmp(buf, buf2, sizeof(buf)) == 0);
+        assert_se(pread(fd_copy, buf2, sizeof(buf2), 2 * sizeof(buf2)) == sizeof(buf2));
+        assert_se(memeqzero(buf2, sizeof(buf2)));
+
+        if (st.st_blksize <= (blksize_t) sizeof(buf) && lseek(fd_copy, 0, SEEK_DATA) > 0)
+                assert_se(lseek(fd_copy, sizeof(buf), SEEK_HOLE) == 2 * sizeof(buf));
+        else
+                log_notice("File system doesn't track holes at block granularity, not checking them.");
+
+        unlink(fn);
+        unlink(fn_copy);
+}
+
 static void test_copy_atomic(void) {
         _cleanup_(rm_rf_physical_and_freep) char *p = NULL;
         const char *q;
@@ -291,6 +387,8 @@ int main(int argc, char *argv[]) {
         test_copy_bytes_regular_file(argv[0], true, 1000);
         test_copy_bytes_regular_file(argv[0], false, 32000); /* larger than copy buffer size */
         test_copy_bytes_regular_file(argv[0], true, 32000);
+        test_copy_holes();
+        test_copy_sparse();
         test_copy_atomic();
 
         return 0;
@@ -17,6 +17,7 @@
 #include "macro.h"
 #include "path-util.h"
 #include "rm-rf.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -378,6 +379,48 @@ static void test_environment_gathering(void) {
                 (void) unsetenv("PATH");
 }
 
+static void count_runtime(const char *path, usec_t begin, usec_t duration, void *userdata) {
+        unsigned *n = userdata;
+
+        assert_se(startswith(path, "/tmp/test-exec-util."));
+        assert_se(begin > 0);
+        assert_se(duration != USEC_INFINITY);
+
+        (*n)++;
+}
+
+static void test_runtimes(bool parallel) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        char template[] = "/tmp/test-exec-util.XXXXXXX";
+        const char *dirs[] = {template, NULL};
+        unsigned i, n = 0;
+
+        log_info("/* %s (%s) */", __func__, parallel ? "parallel" : "serial");
+
+        assert_se(mkdtemp(template));
+        assert_se(tmpdir = strdup(template));
+
+        /* More binaries than we'll run at the same time, so that the concurrency limit kicks in */
+        for (i = 0; i < EXEC_DIR_PARALLEL_MAX + 2; i++) {
+                char name[STRLEN("/script-") + DECIMAL_STR_MAX(unsigned)];
+                const char *p;
+
+                xsprintf(name, "/script-%u", i);
+                p = strjoina(template, name);
+
+                assert_se(write_string_file(p, "#!/bin/sh\n", WRITE_STRING_FILE_CREATE) == 0);
+                assert_se(chmod(p, 0755) == 0);
+
+                if (access(p, X_OK) < 0 && ERRNO_IS_PRIVILEGE(errno))
+                        return;
+        }
+
+        assert_se(execute_directories_full(dirs, DEFAULT_TIMEOUT_USEC, NULL, NULL, NULL, NULL,
+                                           parallel ? EXEC_DIR_PARALLEL : EXEC_DIR_NONE,
+                                           count_runtime, &n) == 0);
+        assert_se(n == EXEC_DIR_PARALLEL_MAX + 2);
+}
+
 static void test_error_catching(void) {
         char template[] = "/tmp/test-exec-util.XXXXXXX";
         const char *dirs[] = {template, NULL};
@@ -468,6 +511,8 @@ int main(int argc, char *argv[]) {
         test_execution_order();
         test_stdout_gathering();
         test_environment_gathering();
+        test_runtimes(true);
+        test_runtimes(false);
         test_error_catching();
         test_exec_command_flags_from_strv();
         test_exec_command_flags_to_strv();
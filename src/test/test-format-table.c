@@ -3,6 +3,8 @@
 #include <unistd.h>
 
 #include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
 #include "format-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -256,6 +258,52 @@ static void test_strv(void) {
         formatted = mfree(formatted);
 }
 
+static void test_stream(void) {
+        _cleanup_free_ char *buf = NULL;
+        size_t sz = 0;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+
+        assert_se(f = open_memstream_unlocked(&buf, &sz));
+
+        assert_se(table = table_new("name", "value"));
+        table_set_width(table, 0);
+        assert_se(table_set_stream(table, f, 1) >= 0);
+
+        assert_se(table_add_many(table,
+                                 TABLE_STRING, "a",
+                                 TABLE_UINT, 1U) >= 0);
+        assert_se(table_add_many(table,
+                                 TABLE_STRING, "bb",
+                                 TABLE_UINT, 2U) >= 0);
+
+        /* The header and the first row determine the column widths, and are written out as soon as the
+         * second row is started */
+        assert_se(fflush(f) == 0);
+        assert_se(streq(buf,
+                        "NAME VALUE\n"
+                        "a    1    \n"));
+
+        assert_se(table_add_many(table,
+                                 TABLE_STRING, "ccccccc",
+                                 TABLE_UINT, 3U) >= 0);
+        assert_se(table_set_stream(table, f, 1) == -EBUSY);
+
+        assert_se(table_add_many(table,
+                                 TABLE_STRING, "d",
+                                 TABLE_UINT, 123456789U) >= 0);
+
+        /* Later rows don't change the width of earlier ones, hence cells which don't fit are ellipsized,
+         * except in the last column, which is allowed to grow, so that all rows stay aligned */
+        assert_se(table_print(table, f) >= 0);
+        assert_se(streq(buf,
+                        "NAME VALUE\n"
+                        "a    1    \n"
+                        "bb   2    \n"
+                        "ccc… 3    \n"
+                        "d    123456789\n"));
+}
+
 int main(int argc, char *argv[]) {
 
         _cleanup_(table_unrefp) Table *t = NULL;
@@ -398,6 +446,7 @@ int main(int argc, char *argv[]) {
 
         test_issue_9549();
         test_multiline();
+        test_stream();
         test_strv();
 
         return 0;
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "hashed-string.h"
+#include "hashmap.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+
+static void test_hashed_string_new(void) {
+        _cleanup_(hashed_string_freep) char *a = NULL, *b = NULL, *c = NULL, *d = NULL;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(a = hashed_string_new("foo.service"));
+        assert_se(b = hashed_strndup("foo.service.d", 11));
+        assert_se(c = hashed_string_new("bar.service"));
+        assert_se(d = hashed_string_new(""));
+
+        assert_se(streq(a, "foo.service"));
+        assert_se(streq(b, "foo.service"));
+        assert_se(streq(c, "bar.service"));
+        assert_se(isempty(d));
+
+        assert_se(hashed_string_hash(a) == hashed_string_hash(b));
+        assert_se(hashed_string_hash(a) != hashed_string_hash(c));
+        assert_se(hashed_string_hash(hashed_string_onstack("foo.service")) == hashed_string_hash(a));
+
+        assert_se(hashed_string_compare_func(a, b) == 0);
+        assert_se(hashed_string_compare_func(a, c) != 0);
+        assert_se(hashed_string_compare_func(a, c) == -hashed_string_compare_func(c, a));
+        assert_se(hashed_string_compare_func(d, hashed_string_onstack("")) == 0);
+
+        assert_se(!hashed_string_free(NULL));
+}
+
+static void test_hashed_string_hashmap(void) {
+        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        char *k;
+        unsigned i;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(h = hashmap_new(&hashed_string_hash_ops_free));
+
+        /* Enough entries to resize a couple of times */
+        for (i = 0; i < 1000; i++) {
+                char buf[DECIMAL_STR_MAX(unsigned) + STRLEN("unit-.service")];
+
+                xsprintf(buf, "unit-%u.service", i);
+                assert_se(k = hashed_string_new(buf));
+                assert_se(hashmap_put(h, k, UINT_TO_PTR(i + 1)) == 1);
+        }
+
+        for (i = 0; i < 1000; i++) {
+                char buf[DECIMAL_STR_MAX(unsigned) + STRLEN("unit-.service")];
+
+                xsprintf(buf, "unit-%u.service", i);
+                assert_se(hashmap_get(h, hashed_string_onstack(buf)) == UINT_TO_PTR(i + 1));
+        }
+
+        assert_se(!hashmap_get(h, hashed_string_onstack("unit-1000.service")));
+        assert_se(!hashmap_get(h, hashed_string_onstack("unit-1.servic")));
+
+        assert_se(hashmap_remove2(h, hashed_string_onstack("unit-42.service"), (void**) &k) == UINT_TO_PTR(43));
+        assert_se(streq(k, "unit-42.service"));
+        hashed_string_free(k);
+        assert_se(hashmap_size(h) == 999);
+        assert_se(!hashmap_get(h, hashed_string_onstack("unit-42.service")));
+        assert_se(hashmap_get(h, hashed_string_onstack("unit-43.service")) == UINT_TO_PTR(44));
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        test_hashed_string_new();
+        test_hashed_string_hashmap();
+
+        return 0;
+}
@@ -51,6 +51,22 @@ static void test_string_compare_func(void) {
         assert_se(string_compare_func("fred", "fred") == 0);
 }
 
+static void test_fast_hash64(void) {
+        static const uint8_t k1[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 },
+                             k2[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 17 };
+        const char s[] = "foobar.service\0\0\0\0";
+        size_t i, j;
+
+        assert_se(fast_hash64(s, 14, k1) == fast_hash64(s, 14, k1));
+        assert_se(fast_hash64(s, 14, k1) != fast_hash64(s, 14, k2));
+        assert_se(fast_hash64(NULL, 0, k1) != fast_hash64(NULL, 0, k2));
+
+        /* Trailing NUL bytes are not simply padding */
+        for (i = 0; i < sizeof(s); i++)
+                for (j = 0; j < i; j++)
+                        assert_se(fast_hash64(s, i, k1) != fast_hash64(s, j, k1));
+}
+
 static void compare_cache(Hashmap *map, IteratedCache *cache) {
         const void **keys = NULL, **values = NULL;
         unsigned num, idx;
@@ -179,6 +195,7 @@ int main(int argc, const char *argv[]) {
         test_uint64_compare_func();
         test_trivial_compare_func();
         test_string_compare_func();
+        test_fast_hash64();
         test_iterated_cache();
         test_hashmap_put_strdup();
         test_hashmap_put_strdup_null();
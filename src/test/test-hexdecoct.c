@@ -6,6 +6,7 @@
 #include "hexdecoct.h"
 #include "macro.h"
 #include "string-util.h"
+#include "tests.h"
 
 static void test_hexchar(void) {
         assert_se(hexchar(0xa) == 'a');
@@ -314,6 +315,44 @@ static void test_unbase64mem(void) {
         test_unbase64mem_one(" Z m 8 = q u u x ", NULL, -ENAMETOOLONG);
 }
 
+static void test_hexmem_base64mem_roundtrip(void) {
+        uint8_t data[1027];
+        size_t i, l;
+
+        log_info("/* %s */", __func__);
+
+        for (i = 0; i < sizeof(data); i++)
+                data[i] = i * 7 + (i >> 8);
+
+        /* Every length, so that the fast paths end at all positions within a block */
+        for (l = 0; l <= sizeof(data); l += l < 64 ? 1 : 61) {
+                _cleanup_free_ char *hex = NULL, *b64 = NULL;
+                _cleanup_free_ void *mem = NULL;
+                size_t size;
+
+                assert_se(hex = hexmem(data, l));
+                assert_se(strlen(hex) == l * 2);
+                assert_se(unhexmem(hex, (size_t) -1, &mem, &size) >= 0);
+                assert_se(size == l);
+                assert_se(memcmp(mem, data, l) == 0);
+                mem = mfree(mem);
+
+                assert_se(base64mem(data, l, &b64) == (ssize_t) (DIV_ROUND_UP(l, 3) * 4));
+                assert_se(unbase64mem(b64, (size_t) -1, &mem, &size) >= 0);
+                assert_se(size == l);
+                assert_se(memcmp(mem, data, l) == 0);
+                mem = mfree(mem);
+
+                if (l > 0) {
+                        /* A single invalid character anywhere is refused */
+                        hex[l] = 'x';
+                        assert_se(unhexmem(hex, (size_t) -1, &mem, &size) == -EINVAL);
+                        b64[l] = '-';
+                        assert_se(unbase64mem(b64, (size_t) -1, &mem, &size) == -EINVAL);
+                }
+        }
+}
+
 static void test_hexdump(void) {
         uint8_t data[146];
         unsigned i;
@@ -334,6 +373,8 @@ static void test_hexdump(void) {
 }
 
 int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
         test_hexchar();
         test_unhexchar();
         test_base32hexchar();
@@ -349,6 +390,7 @@ int main(int argc, char *argv[]) {
         test_unbase32hexmem();
         test_base64mem();
         test_unbase64mem();
+        test_hexmem_base64mem_roundtrip();
         test_hexdump();
 
         return 0;
@@ -501,6 +501,35 @@ static void test_bisect(void) {
         }
 }
 
+static void test_format_append(void) {
+        _cleanup_(json_variant_unrefp) JsonVariant *a = NULL, *b = NULL;
+        _cleanup_free_ char *buf = NULL, *s = NULL;
+        size_t allocated = 0, size = 0;
+        unsigned i;
+        int r;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(json_build(&a, JSON_BUILD_OBJECT(JSON_BUILD_PAIR("method", JSON_BUILD_STRING("io.systemd.Foo")),
+                                                   JSON_BUILD_PAIR("more", JSON_BUILD_BOOLEAN(true)))) >= 0);
+        assert_se(json_build(&b, JSON_BUILD_ARRAY(JSON_BUILD_UNSIGNED(4711), JSON_BUILD_NULL)) >= 0);
+
+        assert_se(json_variant_format(a, 0, &s) >= 0);
+
+        /* Several variants one after the other, separated by their NUL bytes */
+        for (i = 0; i < 100; i++) {
+                r = json_variant_format_append(i % 2 == 0 ? a : b, 0, &buf, &allocated, &size);
+                assert_se(r >= 0);
+                assert_se(buf[size - 1] == 0);
+                assert_se((size_t) r == strlen(buf + size - r - 1));
+        }
+
+        assert_se(streq(buf, s));
+        assert_se(streq(buf + strlen(s) + 1, "[4711,null]"));
+        assert_se(size == 50 * (strlen(s) + 1 + strlen("[4711,null]") + 1));
+        assert_se(allocated >= size);
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_DEBUG);
 
@@ -553,6 +582,7 @@ int main(int argc, char *argv[]) {
 
         test_normalize();
         test_bisect();
+        test_format_append();
 
         return 0;
 }
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "fileio.h"
+#include "fs-util.h"
+#include "manager.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "unit.h"
+
+static usec_t stamp = 0;
+
+static void bump_mtime(const char *path) {
+        struct timespec ts[2];
+
+        /* File systems only update timestamps once per timer tick, hence set them explicitly, and always
+         * move forward so that every change is visible. Never go back before the current time, as units
+         * that were not found are only retried if the directory changed after they were loaded. */
+        stamp = MAX(usec_add(stamp, USEC_PER_SEC), now(CLOCK_REALTIME));
+        timespec_store(&ts[0], stamp);
+        ts[1] = ts[0];
+
+        assert_se(utimensat(AT_FDCWD, path, ts, AT_SYMLINK_NOFOLLOW) >= 0);
+}
+
+static void write_unit(const char *dir, const char *name, const char *contents) {
+        _cleanup_free_ char *p = NULL;
+
+        assert_se(p = path_join(dir, name));
+        assert_se(write_string_file(p, contents, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC) >= 0);
+
+        bump_mtime(p);
+        bump_mtime(dir);
+}
+
+static void test_changed_inactive(Manager *m, const char *dir) {
+        Unit *a, *x;
+
+        log_info("/* %s */", __func__);
+
+        write_unit(dir, "a.service", "[Unit]\nDescription=old\n[Service]\nExecStart=/bin/true\n");
+        write_unit(dir, "x.service", "[Unit]\nWants=a.service\n[Service]\nExecStart=/bin/true\n");
+
+        assert_se(manager_load_unit(m, "x.service", NULL, NULL, &x) >= 0);
+        assert_se(a = manager_get_unit(m, "a.service"));
+        assert_se(a->load_state == UNIT_LOADED);
+        assert_se(streq(a->description, "old"));
+
+        write_unit(dir, "a.service", "[Unit]\nDescription=new\n[Service]\nExecStart=/bin/true\n");
+
+        assert_se(manager_reload_incremental(m) > 0);
+
+        /* The unit was flushed out and loaded again, and the dependency x has on it through its own
+         * configuration now points to the new object */
+        assert_se(a = manager_get_unit(m, "a.service"));
+        assert_se(a->load_state == UNIT_LOADED);
+        assert_se(streq(a->description, "new"));
+        assert_se(manager_get_unit(m, "x.service") == x);
+        assert_se(hashmap_get(x->dependencies[UNIT_WANTS], a));
+        assert_se(hashmap_get(a->dependencies[UNIT_WANTED_BY], x));
+
+        /* Nothing changed, nothing to do */
+        assert_se(manager_reload_incremental(m) > 0);
+        assert_se(manager_get_unit(m, "a.service") == a);
+}
+
+static void test_new_alias(Manager *m, const char *dir) {
+        _cleanup_free_ char *p = NULL;
+        Unit *a;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(a = manager_get_unit(m, "a.service"));
+        assert_se(!manager_get_unit(m, "alias.service"));
+
+        assert_se(p = path_join(dir, "alias.service"));
+        assert_se(symlink("a.service", p) >= 0);
+        bump_mtime(dir);
+
+        assert_se(manager_reload_incremental(m) > 0);
+
+        assert_se(a = manager_get_unit(m, "a.service"));
+        assert_se(a->load_state == UNIT_LOADED);
+        assert_se(manager_get_unit(m, "alias.service") == a);
+        assert_se(set_contains(a->aliases, "alias.service"));
+}
+
+static void test_not_found(Manager *m, const char *dir) {
+        Unit *b;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(manager_load_unit(m, "b.service", NULL, NULL, &b) >= 0);
+        assert_se(b->load_state == UNIT_NOT_FOUND);
+
+        write_unit(dir, "b.service", "[Unit]\nDescription=found\n[Service]\nExecStart=/bin/true\n");
+
+        assert_se(manager_reload_incremental(m) > 0);
+
+        assert_se(manager_get_unit(m, "b.service") == b);
+        assert_se(b->load_state == UNIT_LOADED);
+        assert_se(streq(b->description, "found"));
+}
+
+static void test_active_fallback(Manager *m, const char *dir) {
+        Unit *c;
+        Job *j;
+
+        log_info("/* %s */", __func__);
+
+        write_unit(dir, "c.target", "[Unit]\nDescription=old\nDefaultDependencies=no\n");
+
+        assert_se(manager_load_unit(m, "c.target", NULL, NULL, &c) >= 0);
+        assert_se(manager_add_job(m, JOB_START, c, JOB_REPLACE, NULL, NULL, &j) >= 0);
+        for (unsigned k = 0; c->job && k < 100; k++)
+                assert_se(sd_event_run(m->event, 0) >= 0);
+        assert_se(!c->job);
+        assert_se(unit_active_state(c) == UNIT_ACTIVE);
+
+        write_unit(dir, "c.target", "[Unit]\nDescription=new\nDefaultDependencies=no\n");
+
+        /* An active unit can't be flushed out, hence this must be left to a full reload, and nothing may
+         * have been touched */
+        assert_se(manager_reload_incremental(m) == 0);
+
+        assert_se(manager_get_unit(m, "c.target") == c);
+        assert_se(streq(c->description, "old"));
+        assert_se(unit_active_state(c) == UNIT_ACTIVE);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL, *unit_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        int r;
+
+        test_setup_logging(LOG_DEBUG);
+
+        r = enter_cgroup_subroot(NULL);
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        assert_se(mkdtemp_malloc("/tmp/test-manager-reload-XXXXXX", &unit_dir) >= 0);
+        assert_se(set_unit_path(unit_dir) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+
+        r = manager_new(UNIT_FILE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL) >= 0);
+
+        test_changed_inactive(m, unit_dir);
+        test_new_alias(m, unit_dir);
+        test_not_found(m, unit_dir);
+        test_active_fallback(m, unit_dir);
+
+        return 0;
+}
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+
+#include "mempool.h"
+#include "tests.h"
+
+#define NUM 1000
+
+typedef struct Tile {
+        uint64_t a, b, c;
+} Tile;
+
+DEFINE_MEMPOOL(test_pool, Tile, 8);
+
+static void* free_tiles(void *p) {
+        Tile **tiles = p;
+        unsigned i;
+
+        for (i = 0; i < NUM; i++)
+                mempool_free_tile(&test_pool, tiles[i]);
+
+        return NULL;
+}
+
+static void* alloc_tiles(void *p) {
+        Tile **tiles = p;
+        unsigned i;
+
+        for (i = 0; i < NUM; i++) {
+                assert_se(tiles[i] = mempool_alloc0_tile(&test_pool));
+                assert_se(tiles[i]->a == 0 && tiles[i]->b == 0 && tiles[i]->c == 0);
+                tiles[i]->a = i;
+        }
+
+        return NULL;
+}
+
+static void test_free_other_thread(void) {
+        static Tile *tiles[NUM], *again[NUM];
+        pthread_t t;
+        unsigned i, j, n = 0;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(alloc_tiles(tiles) == NULL);
+
+        assert_se(pthread_create(&t, NULL, free_tiles, tiles) == 0);
+        assert_se(pthread_join(t, NULL) == 0);
+
+        /* The tiles freed by the other thread are handed back to us */
+        assert_se(alloc_tiles(again) == NULL);
+        for (i = 0; i < NUM; i++)
+                for (j = 0; j < NUM; j++)
+                        if (again[i] == tiles[j]) {
+                                n++;
+                                break;
+                        }
+        assert_se(n == NUM);
+
+        assert_se(free_tiles(again) == NULL);
+}
+
+static void test_thread_exit(void) {
+        static Tile *tiles[NUM], *more[NUM];
+        pthread_t t;
+        unsigned i, j;
+
+        log_info("/* %s */", __func__);
+
+        /* Tiles of an exited thread stay valid, and may be freed afterwards */
+        assert_se(pthread_create(&t, NULL, alloc_tiles, tiles) == 0);
+        assert_se(pthread_join(t, NULL) == 0);
+
+        for (i = 0; i < NUM; i++)
+                assert_se(tiles[i]->a == i);
+
+        /* The next thread adopts the state of the exited one */
+        assert_se(pthread_create(&t, NULL, alloc_tiles, more) == 0);
+        assert_se(pthread_join(t, NULL) == 0);
+
+        for (i = 0; i < NUM; i++) {
+                assert_se(tiles[i]->a == i);
+                for (j = 0; j < NUM; j++)
+                        assert_se(more[i] != tiles[j]);
+        }
+
+        assert_se(free_tiles(tiles) == NULL);
+        assert_se(free_tiles(more) == NULL);
+}
+
+static void test_concurrent(void) {
+        static Tile *tiles[4][NUM];
+        pthread_t t[4];
+        unsigned i;
+
+        log_info("/* %s */", __func__);
+
+        /* Several threads freeing tiles of the same thread at the same time */
+        for (i = 0; i < ELEMENTSOF(tiles); i++)
+                assert_se(alloc_tiles(tiles[i]) == NULL);
+
+        for (i = 0; i < ELEMENTSOF(t); i++)
+                assert_se(pthread_create(&t[i], NULL, free_tiles, tiles[i]) == 0);
+        for (i = 0; i < ELEMENTSOF(t); i++)
+                assert_se(pthread_join(t[i], NULL) == 0);
+
+        for (i = 0; i < ELEMENTSOF(tiles); i++)
+                assert_se(alloc_tiles(tiles[i]) == NULL);
+        for (i = 0; i < ELEMENTSOF(tiles); i++)
+                assert_se(free_tiles(tiles[i]) == NULL);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        test_free_other_thread();
+        test_thread_exit();
+        test_concurrent();
+
+        return 0;
+}
@@ -1,11 +1,18 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <sched.h>
 #include <sys/mount.h>
+#include <sys/statvfs.h>
 
 #include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
 #include "mount-util.h"
+#include "process-util.h"
+#include "rm-rf.h"
 #include "string-util.h"
 #include "tests.h"
+#include "tmpfile-util.h"
 
 static void test_mount_option_mangle(void) {
         char *opts = NULL;
@@ -61,10 +68,61 @@ static void test_mount_option_mangle(void) {
         assert_se(mount_option_mangle("rw,relatime,fmask=0022,dmask=0022,\"hogehoge", MS_RDONLY, &f, &opts) < 0);
 }
 
+static void test_bind_remount_one_overmounted(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        int r;
+
+        log_info("/* %s */", __func__);
+
+        if (geteuid() != 0) {
+                log_info("Not running as root, skipping.");
+                return;
+        }
+
+        assert_se(mkdtemp_malloc("/tmp/test-mount-util-XXXXXX", &t) >= 0);
+
+        r = safe_fork("(remount)", FORK_DEATHSIG|FORK_LOG|FORK_WAIT, NULL);
+        assert_se(r >= 0);
+        if (r == 0) {
+                _cleanup_fclose_ FILE *proc_self_mountinfo = NULL;
+                struct statvfs sv;
+
+                if (unshare(CLONE_NEWNS) < 0) {
+                        log_info_errno(errno, "Cannot create mount namespace, skipping: %m");
+                        _exit(EXIT_SUCCESS);
+                }
+                assert_se(mount(NULL, "/", NULL, MS_SLAVE|MS_REC, NULL) >= 0);
+
+                /* A read-only mount hidden below a writable one: the flags of the former must not make
+                 * us skip the remount of the latter. */
+                if (mount("tmpfs", t, "tmpfs", MS_RDONLY, NULL) < 0) {
+                        log_info_errno(errno, "Cannot mount tmpfs, skipping: %m");
+                        _exit(EXIT_SUCCESS);
+                }
+                assert_se(mount("tmpfs", t, "tmpfs", 0, NULL) >= 0);
+
+                assert_se(statvfs(t, &sv) >= 0);
+                assert_se(!FLAGS_SET(sv.f_flag, ST_RDONLY));
+
+                assert_se(proc_self_mountinfo = fopen("/proc/self/mountinfo", "re"));
+                assert_se(bind_remount_one_with_mountinfo(t, MS_RDONLY, MS_RDONLY, proc_self_mountinfo) >= 0);
+
+                assert_se(statvfs(t, &sv) >= 0);
+                assert_se(FLAGS_SET(sv.f_flag, ST_RDONLY));
+
+                /* And now that it is read-only, remounting it read-only again is a NOP */
+                rewind(proc_self_mountinfo);
+                assert_se(bind_remount_one_with_mountinfo(t, MS_RDONLY, MS_RDONLY, proc_self_mountinfo) >= 0);
+
+                _exit(EXIT_SUCCESS);
+        }
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_DEBUG);
 
         test_mount_option_mangle();
+        test_bind_remount_one_overmounted();
 
         return 0;
 }
@@ -7,6 +7,7 @@
 #include "set.h"
 #include "siphash24.h"
 #include "sort-util.h"
+#include "tests.h"
 
 #define SET_SIZE 1024*4
 
@@ -119,10 +120,41 @@ static void test_struct(void) {
         assert_se(set_isempty(s));
 }
 
+static void test_key(void) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        struct test t[SET_SIZE], *p;
+        unsigned previous = 0, i;
+
+        srand(0);
+
+        assert_se(q = prioq_new(NULL));
+
+        for (i = 0; i < SET_SIZE; i++) {
+                t[i].value = (unsigned) rand();
+                assert_se(prioq_put_with_key(q, t + i, &t[i].idx, t[i].value) >= 0);
+        }
+
+        /* Change the keys of every other item, so that some move up and some move down */
+        for (i = 0; i < SET_SIZE; i += 2) {
+                t[i].value = (unsigned) rand();
+                assert_se(prioq_reshuffle_with_key(q, t + i, &t[i].idx, t[i].value) == 1);
+        }
+
+        for (i = 0; i < SET_SIZE; i += 3)
+                assert_se(prioq_remove(q, t + i, &t[i].idx) == 1);
+
+        while ((p = prioq_pop(q))) {
+                assert_se(previous <= p->value);
+                previous = p->value;
+        }
+}
+
 int main(int argc, char* argv[]) {
+        test_setup_logging(LOG_INFO);
 
         test_unsigned();
         test_struct();
+        test_key();
 
         return 0;
 }
@@ -37,6 +37,38 @@ static void test_serialize_item(void) {
         assert_se(streq(line3, ""));
 }
 
+static void test_deserialize_read_line(void) {
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int fd = -1;
+
+        log_info("/* %s */", __func__);
+
+        fd = open_serialization_fd("test-serialize");
+        assert_se(fd >= 0);
+        assert_se(f = fdopen(fd, "w+"));
+        TAKE_FD(fd);
+
+        assert_se(serialize_item(f, "a", "bbb") == 1);
+        fputs("\n", f);
+        assert_se(serialize_item(f, "c", "ddd") == 1);
+        fputs("eee\r\n", f);
+        assert_se(fflush_and_check(f) >= 0);
+
+        rewind(f);
+
+        _cleanup_free_ char *line1 = NULL, *line2 = NULL, *line3 = NULL, *line4 = NULL, *line5 = NULL;
+        assert_se(deserialize_read_line(f, &line1) > 0);
+        assert_se(streq(line1, "a=bbb"));
+        assert_se(deserialize_read_line(f, &line2) > 0);
+        assert_se(streq(line2, ""));
+        assert_se(deserialize_read_line(f, &line3) > 0);
+        assert_se(streq(line3, "c=ddd"));
+        assert_se(deserialize_read_line(f, &line4) > 0);
+        assert_se(streq(line4, "eee"));
+        assert_se(deserialize_read_line(f, &line5) == 0);
+        assert_se(streq(line5, ""));
+}
+
 static void test_serialize_item_escaped(void) {
         _cleanup_(unlink_tempfilep) char fn[] = "/tmp/test-serialize.XXXXXX";
         _cleanup_fclose_ FILE *f = NULL;
@@ -198,6 +230,7 @@ int main(int argc, char *argv[]) {
         char_array_0(long_string);
 
         test_serialize_item();
+        test_deserialize_read_line();
         test_serialize_item_escaped();
         test_serialize_usec();
         test_serialize_strv();
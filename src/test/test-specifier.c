@@ -84,12 +84,42 @@ static void test_specifiers(void) {
         }
 }
 
+static void test_specifier_cache(void) {
+        _cleanup_free_ char *mid = NULL, *osid = NULL, *a = NULL, *b = NULL;
+        SpecifierCache c = {};
+        int r;
+
+        log_info("/* %s */", __func__);
+
+        specifier_cache_populate(&c);
+        assert_se(c.populated);
+        assert_se(c.architecture);
+
+        const Specifier table[] = {
+                SPECIFIER_CACHED('m', c.machine_id, specifier_machine_id),
+                SPECIFIER_CACHED('a', c.architecture, specifier_architecture),
+                SPECIFIER_CACHED('o', c.os_id, specifier_os_id),
+                {}
+        };
+
+        /* Cached and uncached lookups must agree, including on failure */
+        r = specifier_printf("%m-%a-%o", table, NULL, &a);
+        assert_se(specifier_printf("%m-%a-%o", specifier_table, NULL, &b) == r);
+        assert_se(streq_ptr(a, b));
+        log_info("%%m-%%a-%%o → %s", strnull(a));
+
+        specifier_cache_clear(&c);
+        assert_se(!c.populated);
+        assert_se(!c.architecture);
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_DEBUG);
 
         test_specifier_escape();
         test_specifier_escape_strv();
         test_specifiers();
+        test_specifier_cache();
 
         return 0;
 }
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 
+#include "stdio-util.h"
 #include "strbuf.h"
 #include "string-util.h"
 #include "strv.h"
@@ -68,8 +69,40 @@ static void test_strbuf(void) {
         assert_se(sb->root == NULL);
 }
 
+static void test_strbuf_many(void) {
+        _cleanup_(strbuf_cleanupp) struct strbuf *sb = NULL;
+        ssize_t offsets[1000];
+        unsigned i;
+
+        assert_se(sb = strbuf_new());
+
+        /* Enough strings for the buffer to be reallocated a couple of times, and for nodes with many children */
+        for (i = 0; i < ELEMENTSOF(offsets); i++) {
+                char buf[DECIMAL_STR_MAX(unsigned) + 4];
+
+                xsprintf(buf, "foo%u", i);
+                assert_se((offsets[i] = add_string(sb, buf)) > 0);
+                assert_se(streq(sb->buf + offsets[i], buf));
+        }
+
+        for (i = 0; i < ELEMENTSOF(offsets); i++) {
+                char buf[DECIMAL_STR_MAX(unsigned) + 4];
+
+                xsprintf(buf, "foo%u", i);
+                assert_se(add_string(sb, buf) == offsets[i]);
+
+                /* Tails are found too */
+                assert_se(add_string(sb, buf + 1) == offsets[i] + 1);
+                assert_se(add_string(sb, buf + 1) == offsets[i] + 1);
+        }
+
+        assert_se(sb->nodes_count == 1 + ELEMENTSOF(offsets));
+        assert_se(sb->dedup_count == 3 * ELEMENTSOF(offsets));
+}
+
 int main(int argc, const char *argv[]) {
         test_strbuf();
+        test_strbuf_many();
 
         return 0;
 }
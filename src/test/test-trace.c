@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "trace.h"
+
+static void test_trace_ring(void) {
+        Trace t = {};
+        char buf[32];
+        size_t i;
+
+        log_info("/* %s */", __func__);
+
+        trace_add(&t, TRACE_UNIT_LOAD, "foo.service", 10, 5);
+        trace_add(&t, TRACE_JOB_ENQUEUE, "foo.service/start", 20, USEC_INFINITY);
+        assert_se(t.n_events == 2);
+        assert_se(trace_get(&t, 0)->type == TRACE_UNIT_LOAD);
+        assert_se(streq(trace_get(&t, 0)->name, "foo.service"));
+        assert_se(trace_get(&t, 0)->duration == 5);
+        assert_se(trace_get(&t, 1)->timestamp == 20);
+        assert_se(trace_get(&t, 1)->duration == USEC_INFINITY);
+
+        /* Overflow the buffer, the oldest events should be dropped */
+        for (i = 0; i < TRACE_EVENTS_MAX; i++) {
+                xsprintf(buf, "%zu.service", i);
+                trace_add(&t, TRACE_SPAWN, buf, 100 + i, 1);
+        }
+
+        assert_se(t.n_events == TRACE_EVENTS_MAX);
+        assert_se(streq(trace_get(&t, 0)->name, "0.service"));
+        assert_se(trace_get(&t, 0)->timestamp == 100);
+        assert_se(trace_get(&t, TRACE_EVENTS_MAX - 1)->timestamp == 100 + TRACE_EVENTS_MAX - 1);
+
+        trace_done(&t);
+        assert_se(!t.events);
+        assert_se(t.n_events == 0);
+}
+
+static void test_trace_event_type(void) {
+        TraceEventType i;
+
+        log_info("/* %s */", __func__);
+
+        for (i = 0; i < _TRACE_EVENT_TYPE_MAX; i++)
+                assert_se(trace_event_type_from_string(trace_event_type_to_string(i)) == i);
+
+        assert_se(trace_event_type_from_string("foo") < 0);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        test_trace_ring();
+        test_trace_event_type();
+
+        return 0;
+}
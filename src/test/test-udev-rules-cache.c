@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "udev-rules.h"
+
+/* Tokens of all kinds: string and non-string data, labels and GOTOs, and file names of odd length so that
+ * nothing in the cache ends up naturally aligned. */
+static const char rules_a[] =
+        "ACTION==\"remove\", GOTO=\"a_end\"\n"
+        "SUBSYSTEM==\"block\", KERNEL==\"sd*[0-9]\", ENV{ID_PART}=\"1\"\n"
+        "ATTR{size}==\"0\", ATTRS{removable}==\"1\", SYMLINK+=\"disk/%k\"\n"
+        "KERNEL==\"tty[0-9]*\", OWNER=\"root\", GROUP=\"root\", MODE=\"0620\", OPTIONS+=\"string_escape=replace\"\n"
+        "SUBSYSTEM!=\"net\", GOTO=\"a_end\"\n"
+        "IMPORT{builtin}=\"net_id\", PROGRAM=\"/bin/true %k\", RESULT==\"?*\", NAME=\"%c\"\n"
+        "LABEL=\"a_end\"\n";
+
+static const char rules_b[] =
+        "SUBSYSTEM==\"input\", ENV{ID_INPUT}==\"\", IMPORT{builtin}=\"input_id\"\n"
+        "TEST==\"power/control\", ATTR{power/control}=\"auto\"\n";
+
+static void save(UdevRules *rules, char **sources, const char *path, char **ret_contents, size_t *ret_size) {
+        assert_se(udev_rules_cache_save(rules, sources, path) >= 0);
+        assert_se(read_full_file(path, ret_contents, ret_size) >= 0);
+}
+
+static void test_round_trip(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmp = NULL;
+        _cleanup_(udev_rules_freep) UdevRules *rules = NULL, *loaded = NULL, *stale = NULL;
+        _cleanup_free_ char *contents1 = NULL, *contents2 = NULL;
+        _cleanup_strv_free_ char **sources = NULL;
+        const char *cache1, *cache2, *replacement;
+        size_t size1, size2;
+        struct stat st;
+        char **f;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(mkdtemp_malloc("/tmp/test-udev-rules-cache-XXXXXX", &tmp) >= 0);
+
+        assert_se(sources = strv_new(prefix_roota(tmp, "10-a.rules"),
+                                     prefix_roota(tmp, "99-bb.rules")));
+        assert_se(write_string_file(sources[0], rules_a, WRITE_STRING_FILE_CREATE) >= 0);
+        assert_se(write_string_file(sources[1], rules_b, WRITE_STRING_FILE_CREATE) >= 0);
+
+        assert_se(rules = udev_rules_new(RESOLVE_NAME_EARLY));
+        STRV_FOREACH(f, sources)
+                assert_se(udev_rules_parse_file(rules, *f) >= 0);
+
+        /* Serialize the parsed rules, parse the cache back, and serialize the result again: the two
+         * caches must be identical. */
+        cache1 = prefix_roota(tmp, "rules1.bin");
+        cache2 = prefix_roota(tmp, "rules2.bin");
+
+        save(rules, sources, cache1, &contents1, &size1);
+        assert_se(udev_rules_cache_load(cache1, RESOLVE_NAME_EARLY, sources, &loaded) >= 0);
+        save(loaded, sources, cache2, &contents2, &size2);
+
+        assert_se(size1 == size2);
+        assert_se(memcmp(contents1, contents2, size1) == 0);
+
+        /* Anything that does not match the current configuration must be refused */
+        assert_se(udev_rules_cache_load(cache1, RESOLVE_NAME_LATE, sources, &stale) == -ESTALE);
+        assert_se(udev_rules_cache_load(cache1, RESOLVE_NAME_EARLY, STRV_MAKE(sources[0]), &stale) == -ESTALE);
+
+        /* A truncated cache is refused as corrupted */
+        assert_se(truncate(cache2, size2 - 1) >= 0);
+        assert_se(udev_rules_cache_load(cache2, RESOLVE_NAME_EARLY, sources, &stale) == -EBADMSG);
+        assert_se(!stale);
+
+        /* A rules file replaced by a different file (as after an image update) must invalidate the cache,
+         * even if it has the same size and timestamp. */
+        replacement = prefix_roota(tmp, "replacement");
+        assert_se(write_string_file(replacement, rules_b, WRITE_STRING_FILE_CREATE) >= 0);
+        assert_se(stat(sources[1], &st) >= 0);
+        assert_se(utimensat(AT_FDCWD, replacement, (const struct timespec[2]) { st.st_atim, st.st_mtim }, 0) >= 0);
+        assert_se(rename(replacement, sources[1]) >= 0);
+
+        assert_se(udev_rules_cache_load(cache1, RESOLVE_NAME_EARLY, sources, &stale) == -ESTALE);
+        assert_se(!stale);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_DEBUG);
+
+        test_round_trip();
+
+        return 0;
+}
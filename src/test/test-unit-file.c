@@ -1,10 +1,20 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
 #include "path-lookup.h"
+#include "path-util.h"
+#include "rm-rf.h"
 #include "set.h"
 #include "special.h"
 #include "strv.h"
 #include "tests.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 static void test_unit_validate_alias_symlink_and_warn(void) {
@@ -75,6 +85,114 @@ static void test_unit_file_build_name_map(char **ids) {
         }
 }
 
+static void test_unit_file_name_map_cache(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmp = NULL;
+        _cleanup_(lookup_paths_free) LookupPaths lp = {};
+        _cleanup_free_ char *units = NULL, *a = NULL, *cache = NULL;
+        struct timespec ts[2];
+        const char *p;
+        usec_t mtime;
+
+        log_info("/* %s */", __func__);
+
+        assert_se(mkdtemp_malloc("/tmp/test-unit-file.XXXXXX", &tmp) >= 0);
+        assert_se(units = path_join(tmp, "units"));
+        assert_se(mkdir(units, 0755) >= 0);
+        assert_se(a = path_join(units, "a.service"));
+        assert_se(write_string_file(a, "[Service]\nExecStart=/bin/true", WRITE_STRING_FILE_CREATE) >= 0);
+        p = strjoina(units, "/b.service");
+        assert_se(symlink("a.service", p) >= 0);
+
+        assert_se(lp.search_path = strv_new(units));
+        assert_se(lp.transient = path_join(tmp, "transient"));
+        assert_se(cache = path_join(tmp, "unit-name-map"));
+
+        /* A directory modified just now might be modified again within the timestamp granularity, hence
+         * nothing is cached. */
+        {
+                _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+
+                mtime = 0;
+                assert_se(unit_file_build_name_map(&lp, &mtime, &ids, &names, NULL) == 1);
+                assert_se(streq_ptr(hashmap_get(ids, "a.service"), a));
+                assert_se(access(cache, F_OK) < 0 && errno == ENOENT);
+        }
+
+        /* Pretend the directory was last modified a while ago */
+        timespec_store(&ts[0], now(CLOCK_REALTIME) - 10 * USEC_PER_SEC);
+        ts[1] = ts[0];
+        assert_se(utimensat(AT_FDCWD, units, ts, 0) >= 0);
+
+        /* Build from scratch, this writes the cache */
+        {
+                _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+                _cleanup_set_free_free_ Set *paths = NULL;
+
+                mtime = 0;
+                assert_se(unit_file_build_name_map(&lp, &mtime, &ids, &names, &paths) == 1);
+                assert_se(mtime > 0);
+                assert_se(streq_ptr(hashmap_get(ids, "a.service"), a));
+                assert_se(streq_ptr(hashmap_get(ids, "b.service"), "a.service"));
+                assert_se(strv_equal(hashmap_get(names, "a.service"), STRV_MAKE("a.service", "b.service")) ||
+                          strv_equal(hashmap_get(names, "a.service"), STRV_MAKE("b.service", "a.service")));
+                assert_se(set_contains(paths, a));
+                assert_se(access(cache, F_OK) >= 0);
+        }
+
+        /* Prove that the cache is used by adding an entry only it knows about */
+        {
+                _cleanup_fclose_ FILE *f = NULL;
+
+                assert_se(f = fopen(cache, "ae"));
+                assert_se(fputs("I c.service /fake/c.service\n", f) >= 0);
+        }
+        {
+                _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+                _cleanup_set_free_free_ Set *paths = NULL;
+                usec_t m = 1; /* outdated */
+
+                assert_se(unit_file_build_name_map(&lp, &m, &ids, &names, &paths) == 1);
+                assert_se(m == mtime);
+                assert_se(streq_ptr(hashmap_get(ids, "a.service"), a));
+                assert_se(streq_ptr(hashmap_get(ids, "b.service"), "a.service"));
+                assert_se(streq_ptr(hashmap_get(ids, "c.service"), "/fake/c.service"));
+                assert_se(set_contains(paths, a));
+        }
+
+        /* A changed directory invalidates the cache. Bump the mtime explicitly, as the change might happen
+         * within the timestamp granularity of the file system. */
+        p = strjoina(units, "/d.service");
+        assert_se(touch(p) >= 0);
+        timespec_store(&ts[0], mtime + USEC_PER_SEC);
+        ts[1] = ts[0];
+        assert_se(utimensat(AT_FDCWD, units, ts, 0) >= 0);
+        {
+                _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+                usec_t m = 1;
+
+                assert_se(unit_file_build_name_map(&lp, &m, &ids, &names, NULL) == 1);
+                assert_se(m > mtime);
+                assert_se(!hashmap_contains(ids, "c.service"));
+                assert_se(streq_ptr(hashmap_get(ids, "d.service"), p));
+        }
+
+        /* Nothing is loaded from the cache if we are asked to build from scratch, as on daemon-reload */
+        {
+                _cleanup_fclose_ FILE *f = NULL;
+
+                assert_se(f = fopen(cache, "ae"));
+                assert_se(fputs("I c.service /fake/c.service\n", f) >= 0);
+        }
+        {
+                _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+                usec_t m = 0;
+
+                assert_se(unit_file_build_name_map(&lp, &m, &ids, &names, NULL) == 1);
+                assert_se(streq_ptr(hashmap_get(ids, "a.service"), a));
+                assert_se(!hashmap_contains(ids, "c.service"));
+        }
+}
+
 static void test_runlevel_to_target(void) {
         log_info("/* %s */", __func__);
 
@@ -98,6 +216,7 @@ int main(int argc, char **argv) {
 
         test_unit_validate_alias_symlink_and_warn();
         test_unit_file_build_name_map(strv_skip(argv, 1));
+        test_unit_file_name_map_cache();
         test_runlevel_to_target();
 
         return 0;
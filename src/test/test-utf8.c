@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include "alloc-util.h"
+#include "memory-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "utf8.h"
@@ -215,6 +216,62 @@ static void test_utf8_to_utf16(void) {
         }
 }
 
+static char *build_string(char *buf, size_t pos, const char *insert, size_t len) {
+        char *p;
+
+        p = mempset(buf, 'a', pos);
+        p = stpcpy(p, insert);
+        p = mempset(p, 'b', len - pos);
+        *p = 0;
+
+        return buf;
+}
+
+static void test_utf8_long_strings(void) {
+        static const struct {
+                const char *insert;
+                bool valid, printable, ascii;
+                const char *escaped;
+        } table[] = {
+                { " ",            true,  true,  true  },
+                { "~",            true,  true,  true  },
+                { "\t",           true,  true,  true  },
+                { "\n",           true,  true,  true  },
+                { "\r",           true,  false, true  },
+                { "\177",         true,  false, true  },
+                { "\37",          true,  false, true  },
+                { "\302\206",     true,  false, false }, /* C1 control */
+                { "\342\204\242", true,  true,  false },
+                { "\341\204",     false, false, false, UTF8_REPLACEMENT_CHARACTER UTF8_REPLACEMENT_CHARACTER }, /* truncated */
+                { "\377",         false, false, false, UTF8_REPLACEMENT_CHARACTER },
+        };
+        size_t i, len, pos;
+
+        log_info("/* %s */", __func__);
+
+        /* Exercise the fast paths that look at multiple bytes at once, with the interesting bytes at every
+         * position of the chunks they look at */
+
+        for (i = 0; i < ELEMENTSOF(table); i++)
+                for (len = 0; len < 40; len++)
+                        for (pos = 0; pos <= len; pos++) {
+                                char s[64], expected[64];
+                                _cleanup_free_ char *escaped = NULL;
+                                size_t l;
+
+                                build_string(s, pos, table[i].insert, len);
+                                l = strlen(s);
+
+                                assert_se(!!utf8_is_valid(s) == table[i].valid);
+                                assert_se(!!ascii_is_valid(s) == table[i].ascii);
+                                assert_se(utf8_is_printable(s, l) == table[i].printable);
+                                assert_se(utf8_is_printable_newline(s, l, false) == (table[i].printable && !streq(table[i].insert, "\n")));
+
+                                assert_se(escaped = utf8_escape_invalid(s));
+                                assert_se(streq(escaped, table[i].valid ? s : build_string(expected, pos, table[i].escaped, len)));
+                        }
+}
+
 int main(int argc, char *argv[]) {
         test_utf8_is_valid();
         test_utf8_is_printable();
@@ -228,6 +285,7 @@ int main(int argc, char *argv[]) {
         test_utf8_n_codepoints();
         test_utf8_console_width();
         test_utf8_to_utf16();
+        test_utf8_long_strings();
 
         return 0;
 }
@@ -55,6 +55,8 @@
 #define RATELIMIT_BURST 10
 
 #define TIMEOUT_USEC (10*USEC_PER_SEC)
+/* A server that never replied before is given up on sooner, so that a dead one does not hold up the initial sync */
+#define TIMEOUT_INITIAL_USEC (3*USEC_PER_SEC)
 
 static int manager_arm_timer(Manager *m, usec_t next);
 static int manager_clock_watch_setup(Manager *m);
@@ -152,7 +154,7 @@ static int manager_send_request(Manager *m) {
                                 m->event,
                                 &m->event_timeout,
                                 clock_boottime_or_monotonic(),
-                                now(clock_boottime_or_monotonic()) + TIMEOUT_USEC, 0,
+                                now(clock_boottime_or_monotonic()) + (m->good ? TIMEOUT_USEC : TIMEOUT_INITIAL_USEC), 0,
                                 manager_timeout, m);
                 if (r < 0)
                         return log_error_errno(r, "Failed to arm timeout timer: %m");
@@ -422,7 +424,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
         double origin, receive, trans, dest;
         double delay, offset;
         double root_distance;
-        bool spike;
+        bool spike, in_burst;
         int leap_sec;
         int r;
 
@@ -549,7 +551,12 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
 
         spike = manager_sample_spike_detection(m, offset, delay);
 
-        manager_adjust_poll(m, offset, spike);
+        /* Don't let the burst samples drive the poll interval up */
+        in_burst = m->burst > 0;
+        if (in_burst)
+                m->burst--;
+        else
+                manager_adjust_poll(m, offset, spike);
 
         log_debug("NTP response:\n"
                   "  leap         : %u\n"
@@ -614,7 +621,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 sd_notifyf(false, "STATUS=Initial synchronization to time server %s (%s).", strna(pretty), m->current_server_name->string);
         }
 
-        r = manager_arm_timer(m, m->poll_interval_usec);
+        r = manager_arm_timer(m, in_burst ? NTP_BURST_INTERVAL_USEC : m->poll_interval_usec);
         if (r < 0)
                 return log_error_errno(r, "Failed to rearm timer: %m");
 
@@ -668,6 +675,7 @@ static int manager_begin(Manager *m) {
         assert_return(m->current_server_address, -EHOSTUNREACH);
 
         m->good = false;
+        m->burst = NTP_BURST_SAMPLES;
         m->missed_replies = NTP_MAX_MISSED_REPLIES;
         if (m->poll_interval_usec == 0)
                 m->poll_interval_usec = m->poll_interval_min_usec;
@@ -27,6 +27,11 @@ typedef struct Manager Manager;
 #define NTP_RETRY_INTERVAL_MIN_USEC     (15 * USEC_PER_SEC)
 #define NTP_RETRY_INTERVAL_MAX_USEC     (6 * 60 * USEC_PER_SEC) /* 6 minutes */
 
+/* After the first reply from a newly selected server, take a few more samples in quick succession, like
+ * the "iburst" mode of RFC 5905, so that the jitter estimate and spike detection settle quickly. */
+#define NTP_BURST_SAMPLES               3U
+#define NTP_BURST_INTERVAL_USEC         (2 * USEC_PER_SEC)
+
 struct Manager {
         sd_bus *bus;
         sd_event *event;
@@ -55,6 +60,7 @@ struct Manager {
         uint64_t packet_count;
         sd_event_source *event_timeout;
         bool good;
+        unsigned burst;
 
         /* last sent packet */
         struct timespec trans_time_mon;
@@ -10,6 +10,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <sys/file.h>
+#include <sys/sysmacros.h>
 #include <sys/xattr.h>
 #include <sysexits.h>
 #include <time.h>
@@ -38,6 +39,8 @@
 #include "log.h"
 #include "macro.h"
 #include "main-func.h"
+#include "missing_stat.h"
+#include "missing_syscall.h"
 #include "mkdir.h"
 #include "mount-util.h"
 #include "mountpoint-util.h"
@@ -490,6 +493,55 @@ static DIR* opendir_nomod(const char *path) {
         return xopendirat_nomod(AT_FDCWD, path);
 }
 
+/* The fields dir_cleanup() needs */
+#define STATX_CLEANUP_MASK (STATX_TYPE|STATX_MODE|STATX_UID|STATX_INO|STATX_ATIME|STATX_MTIME|STATX_CTIME)
+
+static int dir_cleanup_stat(int dfd, const char *name, struct stat *ret, int *ret_mount_root) {
+        struct statx sx
+#if HAS_FEATURE_MEMORY_SANITIZER
+                = {}
+#  warning "Explicitly initializing struct statx, to work around msan limitation. Please remove as soon as msan has been updated to not require this."
+#endif
+                ;
+
+        assert(dfd >= 0);
+        assert(name);
+        assert(ret);
+        assert(ret_mount_root);
+
+        /* Stats a directory entry for aging. If possible, use statx(), which also tells us whether the
+         * entry is a mount point, saving us another syscall or two for each directory. Only the fields
+         * dir_cleanup() looks at are filled in. Returns the mount point state in *ret_mount_root, or -1 if
+         * not known. */
+
+        if (statx(dfd, name, AT_SYMLINK_NOFOLLOW|AT_NO_AUTOMOUNT, STATX_CLEANUP_MASK, &sx) < 0) {
+                if (!ERRNO_IS_NOT_SUPPORTED(errno) && !ERRNO_IS_PRIVILEGE(errno))
+                        return -errno;
+
+                /* If statx() is not available or forbidden, fall back to fstatat() below */
+        } else if ((sx.stx_mask & STATX_CLEANUP_MASK) == STATX_CLEANUP_MASK) {
+                *ret = (struct stat) {
+                        .st_dev = makedev(sx.stx_dev_major, sx.stx_dev_minor),
+                        .st_ino = sx.stx_ino,
+                        .st_mode = sx.stx_mode,
+                        .st_uid = sx.stx_uid,
+                        .st_atim = { sx.stx_atime.tv_sec, sx.stx_atime.tv_nsec },
+                        .st_mtim = { sx.stx_mtime.tv_sec, sx.stx_mtime.tv_nsec },
+                        .st_ctim = { sx.stx_ctime.tv_sec, sx.stx_ctime.tv_nsec },
+                };
+
+                *ret_mount_root = FLAGS_SET(sx.stx_attributes_mask, STATX_ATTR_MOUNT_ROOT) ?
+                        FLAGS_SET(sx.stx_attributes, STATX_ATTR_MOUNT_ROOT) : -1;
+                return 0;
+        }
+
+        if (fstatat(dfd, name, ret, AT_SYMLINK_NOFOLLOW) < 0)
+                return -errno;
+
+        *ret_mount_root = -1;
+        return 0;
+}
+
 static int dir_cleanup(
                 Item *i,
                 const char *p,
@@ -509,16 +561,18 @@ static int dir_cleanup(
                 struct stat s;
                 usec_t age;
                 _cleanup_free_ char *sub_path = NULL;
+                int mount_root, q;
 
                 if (dot_or_dot_dot(dent->d_name))
                         continue;
 
-                if (fstatat(dirfd(d), dent->d_name, &s, AT_SYMLINK_NOFOLLOW) < 0) {
-                        if (errno == ENOENT)
+                q = dir_cleanup_stat(dirfd(d), dent->d_name, &s, &mount_root);
+                if (q < 0) {
+                        if (q == -ENOENT)
                                 continue;
 
                         /* FUSE, NFS mounts, SELinux might return EACCES */
-                        r = log_full_errno(errno == EACCES ? LOG_DEBUG : LOG_ERR, errno,
+                        r = log_full_errno(q == -EACCES ? LOG_DEBUG : LOG_ERR, q,
                                            "stat(%s/%s) failed: %m", p, dent->d_name);
                         continue;
                 }
@@ -533,9 +587,7 @@ static int dir_cleanup(
                  * do not differ in device major/minors. This type of query is not
                  * supported on all kernels or filesystem types though. */
                 if (S_ISDIR(s.st_mode)) {
-                        int q;
-
-                        q = fd_is_mount_point(dirfd(d), dent->d_name, 0);
+                        q = mount_root >= 0 ? mount_root : fd_is_mount_point(dirfd(d), dent->d_name, 0);
                         if (q < 0)
                                 log_debug_errno(q, "Failed to determine whether \"%s/%s\" is a mount point, ignoring: %m", p, dent->d_name);
                         else if (q > 0) {
@@ -574,8 +626,6 @@ static int dir_cleanup(
                         if (maxdepth <= 0)
                                 log_warning("Reached max depth on \"%s\".", sub_path);
                         else {
-                                int q;
-
                                 sub_dir = xopendirat_nomod(dirfd(d), dent->d_name);
                                 if (!sub_dir) {
                                         if (errno != ENOENT)
@@ -3258,7 +3308,8 @@ static int link_parent(ItemArray *a) {
         return 0;
 }
 
-DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(item_array_hash_ops, char, string_hash_func, string_compare_func,
+/* The paths come from configuration files, which are trusted */
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(item_array_hash_ops, char, fast_string_hash_func, string_compare_func,
                                               ItemArray, item_array_free);
 
 static int run(int argc, char *argv[]) {
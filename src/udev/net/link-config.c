@@ -12,6 +12,7 @@
 #include "conf-parser.h"
 #include "def.h"
 #include "device-util.h"
+#include "ether-addr-util.h"
 #include "ethtool-util.h"
 #include "fd-util.h"
 #include "link-config.h"
@@ -37,6 +38,11 @@ struct link_config_ctx {
 
         bool enable_name_policy;
 
+        /* Whether any of the loaded .link files matches on Type= or PermanentMACAddress=. If none does,
+         * there's no need to query the type and the permanent MAC address of each device we see. */
+        bool match_iftype;
+        bool match_permanent_mac;
+
         sd_netlink *rtnl;
 
         usec_t network_dirs_ts_usec;
@@ -78,6 +84,9 @@ static void link_configs_free(link_config_ctx *ctx) {
 
         LIST_FOREACH_SAFE(links, link, link_next, ctx->links)
                 link_config_free(link);
+
+        ctx->links = NULL;
+        ctx->match_iftype = ctx->match_permanent_mac = false;
 }
 
 void link_config_ctx_free(link_config_ctx *ctx) {
@@ -182,6 +191,11 @@ int link_load_one(link_config_ctx *ctx, const char *filename) {
 
         log_debug("Parsed configuration file %s", filename);
 
+        if (!strv_isempty(link->match_type))
+                ctx->match_iftype = true;
+        if (!set_isempty(link->match_permanent_mac))
+                ctx->match_permanent_mac = true;
+
         LIST_PREPEND(links, ctx->links, TAKE_PTR(link));
         return 0;
 }
@@ -259,13 +273,17 @@ int link_config_get(link_config_ctx *ctx, sd_device *device, link_config **ret)
         if (r < 0)
                 return r;
 
-        r = rtnl_get_link_iftype(&ctx->rtnl, ifindex, &iftype);
-        if (r < 0)
-                return r;
+        if (ctx->match_iftype) {
+                r = rtnl_get_link_iftype(&ctx->rtnl, ifindex, &iftype);
+                if (r < 0)
+                        return r;
+        }
 
-        r = ethtool_get_permanent_macaddr(&ctx->ethtool_fd, name, &permanent_mac);
-        if (r < 0)
-                log_device_debug_errno(device, r, "Failed to get permanent MAC address, ignoring: %m");
+        if (ctx->match_permanent_mac) {
+                r = ethtool_get_permanent_macaddr(&ctx->ethtool_fd, name, &permanent_mac);
+                if (r < 0)
+                        log_device_debug_errno(device, r, "Failed to get permanent MAC address, ignoring: %m");
+        }
 
         LIST_FOREACH(links, link, ctx->links) {
                 if (net_match_config(link->match_mac, link->match_permanent_mac, link->match_path, link->match_driver,
@@ -356,14 +374,37 @@ static int get_mac(sd_device *device, MACAddressPolicy policy, struct ether_addr
         return 1;
 }
 
+static int link_get_state(link_config_ctx *ctx, int ifindex, sd_netlink_message **ret) {
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *message = NULL;
+        int r;
+
+        assert(ctx);
+        assert(ifindex > 0);
+        assert(ret);
+
+        if (!ctx->rtnl) {
+                r = sd_netlink_open(&ctx->rtnl);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_rtnl_message_new_link(ctx->rtnl, &message, RTM_GETLINK, ifindex);
+        if (r < 0)
+                return r;
+
+        return sd_netlink_call(ctx->rtnl, message, 0, ret);
+}
+
 int link_config_apply(link_config_ctx *ctx, link_config *config,
                       sd_device *device, const char **name) {
+        _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *state = NULL;
         _cleanup_strv_free_ char **altnames = NULL, **current_altnames = NULL;
         struct ether_addr generated_mac;
         struct ether_addr *mac = NULL;
-        const char *new_name = NULL;
+        const char *new_name = NULL, *alias;
         const char *old_name;
         unsigned speed, name_type = NET_NAME_UNKNOWN;
+        uint32_t mtu;
         NamePolicy policy;
         int r, ifindex;
 
@@ -496,7 +537,35 @@ int link_config_apply(link_config_ctx *ctx, link_config *config,
         } else
                 mac = config->mac;
 
-        r = rtnl_set_link_properties(&ctx->rtnl, ifindex, config->alias, mac, config->mtu);
+        alias = config->alias;
+        mtu = config->mtu;
+
+        /* Read the current state of the interface once, and leave out whatever already has the value we
+         * want, so that in the common case no RTM_SETLINK needs to be issued at all. */
+        r = link_get_state(ctx, ifindex, &state);
+        if (r < 0)
+                log_device_debug_errno(device, r, "Failed to get current link state, ignoring: %m");
+        else {
+                struct ether_addr current_mac;
+                uint32_t current_mtu;
+                const char *s;
+
+                if (alias && sd_netlink_message_read_string(state, IFLA_IFALIAS, &s) >= 0 && streq(s, alias))
+                        alias = NULL;
+
+                if (mac && sd_netlink_message_read_ether_addr(state, IFLA_ADDRESS, &current_mac) >= 0 &&
+                    ether_addr_equal(&current_mac, mac))
+                        mac = NULL;
+
+                if (mtu > 0 && sd_netlink_message_read_u32(state, IFLA_MTU, &current_mtu) >= 0 && current_mtu == mtu)
+                        mtu = 0;
+
+                r = sd_netlink_message_read_strv(state, IFLA_PROP_LIST, IFLA_ALT_IFNAME, &current_altnames);
+                if (r < 0 && r != -ENODATA)
+                        log_device_debug_errno(device, r, "Failed to get alternative names on %s, ignoring: %m", old_name);
+        }
+
+        r = rtnl_set_link_properties(&ctx->rtnl, ifindex, alias, mac, mtu);
         if (r < 0)
                 return log_warning_errno(r, "Could not set Alias=, MACAddress= or MTU= on %s: %m", old_name);
 
@@ -540,10 +609,6 @@ int link_config_apply(link_config_ctx *ctx, link_config *config,
                 strv_remove(altnames, new_name);
         strv_remove(altnames, old_name);
 
-        r = rtnl_get_link_alternative_names(&ctx->rtnl, ifindex, &current_altnames);
-        if (r < 0)
-                log_debug_errno(r, "Failed to get alternative names on %s, ignoring: %m", old_name);
-
         char **p;
         STRV_FOREACH(p, current_altnames)
                 strv_remove(altnames, *p);
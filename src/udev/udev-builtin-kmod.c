@@ -11,17 +11,24 @@
 #include <stdlib.h>
 
 #include "module-util.h"
+#include "set.h"
 #include "string-util.h"
 #include "udev-builtin.h"
 
 static struct kmod_ctx *ctx = NULL;
 
+/* Modules and aliases this worker took care of already. At coldplug the same alias shows up for many identical
+ * devices, and once it was loaded (or found to match nothing, or to be built in) there's nothing to do for it
+ * anymore. Workers exit when idle and the set is flushed when the module index is reloaded, hence it doesn't
+ * outlive a burst of events. */
+static Set *handled = NULL;
+
 _printf_(6,0) static void udev_kmod_log(void *data, int priority, const char *file, int line, const char *fn, const char *format, va_list args) {
         log_internalv(priority, 0, file, line, fn, format, args);
 }
 
 static int builtin_kmod(sd_device *dev, int argc, char *argv[], bool test) {
-        int i;
+        int i, r;
 
         if (!ctx)
                 return 0;
@@ -30,8 +37,16 @@ static int builtin_kmod(sd_device *dev, int argc, char *argv[], bool test) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "%s: expected: load <module>", argv[0]);
 
-        for (i = 2; argv[i]; i++)
-                (void) module_load_and_warn(ctx, argv[i], false);
+        for (i = 2; argv[i]; i++) {
+                if (set_contains(handled, argv[i])) {
+                        log_debug("Module '%s' was handled already, skipping.", argv[i]);
+                        continue;
+                }
+
+                r = module_load_and_warn(ctx, argv[i], false);
+                if (IN_SET(r, 0, -ENOENT))
+                        (void) set_put_strdup(&handled, argv[i]);
+        }
 
         return 0;
 }
@@ -55,6 +70,7 @@ static int builtin_kmod_init(void) {
 static void builtin_kmod_exit(void) {
         log_debug("Unload module index");
         ctx = kmod_unref(ctx);
+        handled = set_free_free(handled);
 }
 
 /* called every couple of seconds during event activity; 'true' if config has changed */
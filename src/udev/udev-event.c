@@ -33,6 +33,7 @@
 #include "udev-node.h"
 #include "udev-util.h"
 #include "udev-watch.h"
+#include "usdt.h"
 #include "user-util.h"
 
 typedef struct Spawn {
@@ -60,6 +61,9 @@ UdevEvent *udev_event_new(sd_device *dev, usec_t exec_delay_usec, sd_netlink *rt
         if (!event)
                 return NULL;
 
+        /* The rules are going to look up lots of attributes of the device and its parents */
+        device_set_keep_sysfs_fd(dev);
+
         *event = (UdevEvent) {
                 .dev = sd_device_ref(dev),
                 .birth_usec = now(CLOCK_MONOTONIC),
@@ -958,11 +962,13 @@ static int udev_event_on_move(UdevEvent *event) {
         return 0;
 }
 
-int udev_event_execute_rules(UdevEvent *event,
-                             usec_t timeout_usec,
-                             int timeout_signal,
-                             Hashmap *properties_list,
-                             UdevRules *rules) {
+static int event_execute_rules(
+                UdevEvent *event,
+                usec_t timeout_usec,
+                int timeout_signal,
+                Hashmap *properties_list,
+                UdevRules *rules) {
+
         const char *subsystem;
         DeviceAction action;
         sd_device *dev;
@@ -1031,6 +1037,25 @@ int udev_event_execute_rules(UdevEvent *event,
         return 0;
 }
 
+int udev_event_execute_rules(UdevEvent *event,
+                             usec_t timeout_usec,
+                             int timeout_signal,
+                             Hashmap *properties_list,
+                             UdevRules *rules) {
+        const char *devpath = NULL;
+        int r;
+
+        assert(event);
+
+        (void) sd_device_get_devpath(event->dev, &devpath);
+
+        USDT(udev, execute_rules, event, devpath);
+        r = event_execute_rules(event, timeout_usec, timeout_signal, properties_list, rules);
+        USDT(udev, execute_rules_done, event, devpath, r);
+
+        return r;
+}
+
 void udev_event_execute_run(UdevEvent *event, usec_t timeout_usec, int timeout_signal) {
         const char *command;
         void *val;
@@ -17,6 +17,7 @@
 #include "fs-util.h"
 #include "libudev-util.h"
 #include "mkdir.h"
+#include "parse-util.h"
 #include "path-util.h"
 #include "selinux-util.h"
 #include "smack-util.h"
@@ -104,6 +105,75 @@ static int node_symlink(sd_device *dev, const char *node, const char *slink) {
         return r;
 }
 
+/* Each device claiming a symlink leaves a symlink named after its device ID in the stack directory,
+ * pointing to "<priority>:<devnode>". This way the priority of competing devices can be read from the
+ * stack directory itself, rather than from the udev database of every one of them. */
+static int stack_entry_read(int dir_fd, const char *id, int *ret_priority, char **ret_devnode) {
+        _cleanup_free_ char *buf = NULL;
+        const char *colon;
+        char *devnode;
+        int r, priority;
+
+        assert(dir_fd >= 0);
+        assert(id);
+        assert(ret_priority);
+        assert(ret_devnode);
+
+        r = readlinkat_malloc(dir_fd, id, &buf);
+        if (r < 0)
+                return r;
+
+        colon = strchr(buf, ':');
+        if (!colon || !path_startswith(colon + 1, "/dev/"))
+                return -EINVAL;
+
+        devnode = strdup(colon + 1);
+        if (!devnode)
+                return -ENOMEM;
+
+        buf[colon - buf] = '\0';
+        r = safe_atoi(buf, &priority);
+        if (r < 0) {
+                free(devnode);
+                return r;
+        }
+
+        *ret_priority = priority;
+        *ret_devnode = devnode;
+        return 0;
+}
+
+static int stack_entry_read_db(const char *id, int *ret_priority, char **ret_devnode) {
+        _cleanup_(sd_device_unrefp) sd_device *dev_db = NULL;
+        const char *devnode;
+        char *d;
+        int r, priority = 0;
+
+        assert(id);
+        assert(ret_priority);
+        assert(ret_devnode);
+
+        r = sd_device_new_from_device_id(&dev_db, id);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_devname(dev_db, &devnode);
+        if (r < 0)
+                return r;
+
+        r = device_get_devlink_priority(dev_db, &priority);
+        if (r < 0)
+                return r;
+
+        d = strdup(devnode);
+        if (!d)
+                return -ENOMEM;
+
+        *ret_priority = priority;
+        *ret_devnode = d;
+        return 0;
+}
+
 /* find device node of device with highest priority */
 static int link_find_prioritized(sd_device *dev, bool add, const char *stackdir, char **ret) {
         _cleanup_closedir_ DIR *dir = NULL;
@@ -142,8 +212,8 @@ static int link_find_prioritized(sd_device *dev, bool add, const char *stackdir,
         }
 
         FOREACH_DIRENT_ALL(dent, dir, break) {
-                _cleanup_(sd_device_unrefp) sd_device *dev_db = NULL;
-                const char *devnode, *id_filename;
+                _cleanup_free_ char *devnode = NULL;
+                const char *id_filename;
                 int db_prio = 0;
 
                 if (dent->d_name[0] == '\0')
@@ -160,23 +230,22 @@ static int link_find_prioritized(sd_device *dev, bool add, const char *stackdir,
                 if (streq(dent->d_name, id_filename))
                         continue;
 
-                if (sd_device_new_from_device_id(&dev_db, dent->d_name) < 0)
-                        continue;
-
-                if (sd_device_get_devname(dev_db, &devnode) < 0)
-                        continue;
-
-                if (device_get_devlink_priority(dev_db, &db_prio) < 0)
+                /* Entries written by older versions are empty regular files, fall back to the database
+                 * for those. */
+                r = stack_entry_read(dirfd(dir), dent->d_name, &db_prio, &devnode);
+                if (r == -EINVAL)
+                        r = stack_entry_read_db(dent->d_name, &db_prio, &devnode);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
                         continue;
 
                 if (target && db_prio <= priority)
                         continue;
 
-                log_device_debug(dev_db, "Device claims priority %i for '%s'", db_prio, stackdir);
+                log_device_debug(dev, "Device '%s' claims priority %i for '%s'", dent->d_name, db_prio, stackdir);
 
-                r = free_and_strdup(&target, devnode);
-                if (r < 0)
-                        return r;
+                free_and_replace(target, devnode);
                 priority = db_prio;
         }
 
@@ -220,17 +289,29 @@ static int link_update(sd_device *dev, const char *slink, bool add) {
         } else
                 (void) node_symlink(dev, target, slink);
 
-        if (add)
-                do {
-                        _cleanup_close_ int fd = -1;
+        if (add) {
+                _cleanup_free_ char *entry = NULL;
+                const char *devnode;
+                int priority;
+
+                r = sd_device_get_devname(dev, &devnode);
+                if (r < 0)
+                        return log_device_debug_errno(dev, r, "Failed to get device name: %m");
+
+                r = device_get_devlink_priority(dev, &priority);
+                if (r < 0)
+                        return log_device_debug_errno(dev, r, "Failed to get devlink priority: %m");
+
+                if (asprintf(&entry, "%i:%s", priority, devnode) < 0)
+                        return log_oom();
 
+                do {
                         r = mkdir_parents(filename, 0755);
                         if (!IN_SET(r, 0, -ENOENT))
                                 break;
-                        fd = open(filename, O_WRONLY|O_CREAT|O_CLOEXEC|O_TRUNC|O_NOFOLLOW, 0444);
-                        if (fd < 0)
-                                r = -errno;
+                        r = symlink_atomic(entry, filename);
                 } while (r == -ENOENT);
+        }
 
         return r;
 }
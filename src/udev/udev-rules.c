@@ -2,8 +2,11 @@
 
 #include <ctype.h>
 
+#include <sys/mman.h>
+
 #include "alloc-util.h"
 #include "architecture.h"
+#include "build.h"
 #include "conf-files.h"
 #include "def.h"
 #include "device-util.h"
@@ -25,9 +28,11 @@
 #include "strv.h"
 #include "strxcpyx.h"
 #include "sysctl-util.h"
+#include "tmpfile-util.h"
 #include "udev-builtin.h"
 #include "udev-event.h"
 #include "udev-rules.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "virt.h"
 
@@ -134,6 +139,18 @@ typedef enum {
         LINE_UPDATE_SOMETHING = 1 << 5, /* has other TK_A_* or TK_M_IMPORT tokens */
 } UdevRuleLineType;
 
+/* Cheap keys whose value cannot change while the rules are applied to an event. The first match on each
+ * of them is indexed per line, so that lines which cannot match are rejected without walking their
+ * tokens, and runs of consecutive lines with the very same match are skipped at once. */
+typedef enum {
+        INDEX_KEY_ACTION,
+        INDEX_KEY_KERNEL,
+        INDEX_KEY_SUBSYSTEM,
+        INDEX_KEY_DRIVER,
+        _INDEX_KEY_MAX,
+        _INDEX_KEY_INVALID = -1,
+} UdevRuleIndexKey;
+
 typedef struct UdevRuleFile UdevRuleFile;
 typedef struct UdevRuleLine UdevRuleLine;
 typedef struct UdevRuleToken UdevRuleToken;
@@ -144,6 +161,7 @@ struct UdevRuleToken {
         UdevRuleMatchType match_type:8;
         UdevRuleSubstituteType attr_subst_type:7;
         bool attr_match_remove_trailing_whitespace:1;
+        bool match_glob_prefix:1; /* all globs are of the form "foo*", so comparing the prefix is sufficient */
         const char *value;
         void *data;
         LIST_FIELDS(UdevRuleToken, tokens);
@@ -151,6 +169,7 @@ struct UdevRuleToken {
 
 struct UdevRuleLine {
         char *line;
+        size_t line_size; /* including the two trailing NUL bytes */
         unsigned line_number;
         UdevRuleLineType type;
 
@@ -158,15 +177,18 @@ struct UdevRuleLine {
         const char *goto_label;
         UdevRuleLine *goto_line;
 
+        UdevRuleToken *index_token[_INDEX_KEY_MAX]; /* first match on the key, if any */
+        UdevRuleLine *index_skip[_INDEX_KEY_MAX];   /* first following line without the same match, or NULL */
+
         UdevRuleFile *rule_file;
-        UdevRuleToken *current_token;
+        UdevRuleToken *current_token; /* the last token, while parsing */
         LIST_HEAD(UdevRuleToken, tokens);
         LIST_FIELDS(UdevRuleLine, rule_lines);
 };
 
 struct UdevRuleFile {
         char *filename;
-        UdevRuleLine *current_line;
+        UdevRuleLine *current_line; /* the last line, while parsing */
         LIST_HEAD(UdevRuleLine, rule_lines);
         LIST_FIELDS(UdevRuleFile, rule_files);
 };
@@ -176,7 +198,12 @@ struct UdevRules {
         ResolveNameTiming resolve_name_timing;
         Hashmap *known_users;
         Hashmap *known_groups;
+        /* The position while parsing or applying the rules. This is kept here rather than in the lines and
+         * files themselves, so that applying the rules doesn't write to them, and forked workers keep
+         * sharing their pages with the main process. */
         UdevRuleFile *current_file;
+        UdevRuleLine *current_line;
+        UdevRuleToken *current_token;
         LIST_HEAD(UdevRuleFile, rule_files);
 };
 
@@ -186,7 +213,7 @@ struct UdevRules {
         ({                                                              \
                 UdevRules *_r = (rules);                                \
                 UdevRuleFile *_f = _r ? _r->current_file : NULL;        \
-                UdevRuleLine *_l = _f ? _f->current_line : NULL;        \
+                UdevRuleLine *_l = _r ? _r->current_line : NULL;        \
                 const char *_n = _f ? _f->filename : NULL;              \
                                                                         \
                 log_device_full(device, level, error, "%s:%u " fmt,     \
@@ -406,11 +433,26 @@ static void rule_line_append_token(UdevRuleLine *rule_line, UdevRuleToken *token
         rule_line->current_token = token;
 }
 
+static bool nulstr_is_glob_prefixes(const char *nulstr) {
+        const char *i;
+
+        /* Returns true if all patterns are a literal prefix followed by a single trailing "*" */
+
+        NULSTR_FOREACH(i, nulstr) {
+                size_t n = strcspn(i, GLOB_CHARS "\\");
+
+                if (n == 0 || !streq(i + n, "*"))
+                        return false;
+        }
+
+        return true;
+}
+
 static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type, UdevRuleOperatorType op, char *value, void *data) {
         UdevRuleToken *token;
         UdevRuleMatchType match_type = _MATCH_TYPE_INVALID;
         UdevRuleSubstituteType subst_type = _SUBST_TYPE_INVALID;
-        bool remove_trailing_whitespace = false;
+        bool remove_trailing_whitespace = false, glob_prefix = false;
         size_t len;
 
         assert(rule_line);
@@ -466,6 +508,9 @@ static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type,
                                 if (match_type == MATCH_TYPE_PLAIN)
                                         match_type = MATCH_TYPE_PLAIN_WITH_EMPTY;
                         }
+
+                        if (IN_SET(match_type, MATCH_TYPE_GLOB, MATCH_TYPE_GLOB_WITH_EMPTY))
+                                glob_prefix = nulstr_is_glob_prefixes(value);
                 }
         }
 
@@ -492,6 +537,7 @@ static int rule_line_add_token(UdevRuleLine *rule_line, UdevRuleTokenType type,
                 .match_type = match_type,
                 .attr_subst_type = subst_type,
                 .attr_match_remove_trailing_whitespace = remove_trailing_whitespace,
+                .match_glob_prefix = glob_prefix,
         };
 
         rule_line_append_token(rule_line, token);
@@ -1103,6 +1149,7 @@ static int rule_add_line(UdevRules *rules, const char *line_str, unsigned line_n
 
         *rule_line = (UdevRuleLine) {
                 .line = TAKE_PTR(line),
+                .line_size = strlen(line_str) + 2,
                 .line_number = line_nr,
                 .rule_file = rule_file,
         };
@@ -1113,6 +1160,7 @@ static int rule_add_line(UdevRules *rules, const char *line_str, unsigned line_n
                 LIST_APPEND(rule_lines, rule_file->rule_lines, rule_line);
 
         rule_file->current_line = rule_line;
+        rules->current_line = rule_line;
 
         for (p = rule_line->line; !isempty(p); ) {
                 char *key, *attr, *value;
@@ -1174,6 +1222,84 @@ static void rule_resolve_goto(UdevRuleFile *rule_file) {
         }
 }
 
+static UdevRuleIndexKey token_type_to_index_key(UdevRuleTokenType type) {
+        switch (type) {
+        case TK_M_ACTION:
+                return INDEX_KEY_ACTION;
+        case TK_M_KERNEL:
+                return INDEX_KEY_KERNEL;
+        case TK_M_SUBSYSTEM:
+                return INDEX_KEY_SUBSYSTEM;
+        case TK_M_DRIVER:
+                return INDEX_KEY_DRIVER;
+        default:
+                return _INDEX_KEY_INVALID;
+        }
+}
+
+static bool token_has_side_effects(UdevRuleTokenType type) {
+        /* Tokens which change the state of the event (or run something) when they are reached, even if a
+         * later match on the same line fails. */
+        return type >= _TK_A_MIN ||
+                IN_SET(type, TK_M_PROGRAM, TK_M_IMPORT_FILE, TK_M_IMPORT_PROGRAM, TK_M_IMPORT_BUILTIN,
+                       TK_M_IMPORT_DB, TK_M_IMPORT_CMDLINE, TK_M_IMPORT_PARENT);
+}
+
+static bool token_match_equal(const UdevRuleToken *a, const UdevRuleToken *b) {
+        const char *i, *j;
+
+        if (!a || !b)
+                return false;
+
+        if (a->type != b->type || a->op != b->op || a->match_type != b->match_type)
+                return false;
+
+        /* Compare the nulstrs */
+        for (i = a->value, j = b->value; *i != '\0' && *j != '\0'; i = strchr(i, '\0') + 1, j = strchr(j, '\0') + 1)
+                if (!streq(i, j))
+                        return false;
+
+        return *i == *j;
+}
+
+static void rule_file_build_index(UdevRuleFile *rule_file) {
+        UdevRuleLine *line, *tail;
+        UdevRuleToken *token;
+        UdevRuleIndexKey k;
+
+        assert(rule_file);
+
+        /* Only matches that are evaluated before anything with side effects may be indexed, as rejecting
+         * the line early must not skip e.g. an IMPORT{program} that would have run before the match
+         * failed. sort_tokens() puts the indexed keys first, so in practice this never stops early, but
+         * don't rely on it. */
+        LIST_FOREACH(rule_lines, line, rule_file->rule_lines)
+                LIST_FOREACH(tokens, token, line->tokens) {
+                        if (token_has_side_effects(token->type))
+                                break;
+
+                        k = token_type_to_index_key(token->type);
+                        if (k >= 0 && !line->index_token[k])
+                                line->index_token[k] = token;
+                }
+
+        /* Walk backwards, so that each line can pick up the skip target of the next one if it shares
+         * the same match. */
+        LIST_FIND_TAIL(rule_lines, rule_file->rule_lines, tail);
+        for (line = tail; line; line = line->rule_lines_prev)
+                for (k = 0; k < _INDEX_KEY_MAX; k++) {
+                        UdevRuleLine *next = line->rule_lines_next;
+
+                        if (!line->index_token[k])
+                                continue;
+
+                        if (next && token_match_equal(line->index_token[k], next->index_token[k]))
+                                line->index_skip[k] = next->index_skip[k];
+                        else
+                                line->index_skip[k] = next;
+                }
+}
+
 int udev_rules_parse_file(UdevRules *rules, const char *filename) {
         _cleanup_free_ char *continuation = NULL, *name = NULL;
         _cleanup_fclose_ FILE *f = NULL;
@@ -1269,11 +1395,14 @@ int udev_rules_parse_file(UdevRules *rules, const char *filename) {
                 else if (len > 0)
                         (void) rule_add_line(rules, line, line_nr);
 
+                rules->current_line = NULL;
+
                 continuation = mfree(continuation);
                 ignore_line = false;
         }
 
         rule_resolve_goto(rule_file);
+        rule_file_build_index(rule_file);
         return 0;
 }
 
@@ -1291,28 +1420,717 @@ UdevRules* udev_rules_new(ResolveNameTiming resolve_name_timing) {
         return rules;
 }
 
-int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing) {
+/*** Rules cache ***/
+
+/* The parsed rules are stored in a binary cache, so that a restarted udevd or "udevadm test" don't need to
+ * parse all rules files again, and in particular don't need to resolve all user and group names again.
+ * The cache is only meant for this host, hence everything is stored in native byte order. It is
+ * invalidated whenever the udev version, the name resolution timing, the list of rules files, or the
+ * modification time, size or inode number of any of the rules files, /etc/passwd or /etc/group changes,
+ * so that a cache carried along with an image update is not reused.
+ *
+ * The structures below only describe the on-disk layout. Nothing in the file is aligned, hence when
+ * reading, all fields are decoded with unaligned_read_ne*() from the mapped file. */
+
+#define RULES_CACHE_SIGNATURE "UDEVRLS2"
+
+typedef struct _packed_ RulesCacheStamp {
+        uint64_t mtime;
+        uint64_t size;
+        uint64_t inode;
+} RulesCacheStamp;
+
+typedef struct _packed_ RulesCacheHeader {
+        char signature[8];
+        char version[32];
+        uint64_t header_size;
+        uint64_t resolve_name_timing;
+        RulesCacheStamp passwd;
+        RulesCacheStamp group;
+        uint64_t n_sources;
+        uint64_t n_files;
+} RulesCacheHeader;
+
+typedef struct _packed_ RulesCacheSource {
+        RulesCacheStamp stamp;
+        uint64_t path_size;
+        /* followed by the NUL terminated path */
+} RulesCacheSource;
+
+typedef struct _packed_ RulesCacheLine {
+        uint64_t line_size;
+        uint64_t label;
+        uint64_t goto_label;
+        uint64_t n_tokens;
+        uint32_t line_number;
+        uint32_t type;
+        /* followed by the line buffer and the tokens */
+} RulesCacheLine;
+
+typedef struct _packed_ RulesCacheToken {
+        int8_t type;
+        int8_t op;
+        int8_t match_type;
+        int8_t attr_subst_type;
+        uint8_t flags;
+        uint64_t value;
+        uint64_t data;
+} RulesCacheToken;
+
+#define RULES_CACHE_NULL UINT64_MAX
+
+enum {
+        RULES_CACHE_TOKEN_REMOVE_TRAILING_WHITESPACE = 1 << 0,
+        RULES_CACHE_TOKEN_GLOB_PREFIX                = 1 << 1,
+};
+
+static bool token_data_is_string(UdevRuleTokenType type) {
+        return IN_SET(type, TK_M_ENV, TK_M_CONST, TK_M_ATTR, TK_M_SYSCTL, TK_M_PARENTS_ATTR,
+                      TK_A_SECLABEL, TK_A_ENV, TK_A_ATTR, TK_A_SYSCTL);
+}
+
+static void rules_cache_stamp_from_stat(RulesCacheStamp *stamp, const struct stat *st) {
+        assert(stamp);
+        assert(st);
+
+        *stamp = (RulesCacheStamp) {
+                .mtime = timespec_load(&st->st_mtim),
+                .size = st->st_size,
+                .inode = st->st_ino,
+        };
+}
+
+static void rules_cache_stamp_from_path(RulesCacheStamp *stamp, const char *path) {
+        struct stat st;
+
+        assert(stamp);
+        assert(path);
+
+        if (stat(path, &st) < 0) {
+                *stamp = (RulesCacheStamp) {
+                        .mtime = USEC_INFINITY,
+                        .size = UINT64_MAX,
+                        .inode = UINT64_MAX,
+                };
+                return;
+        }
+
+        rules_cache_stamp_from_stat(stamp, &st);
+}
+
+static bool rules_cache_stamp_equal(const RulesCacheStamp *a, const RulesCacheStamp *b) {
+        assert(a);
+        assert(b);
+
+        return a->mtime == b->mtime &&
+                a->size == b->size &&
+                a->inode == b->inode;
+}
+
+static int rules_cache_header_init(RulesCacheHeader *h, ResolveNameTiming resolve_name_timing) {
+        assert(h);
+
+        if (strlen(GIT_VERSION) >= sizeof(h->version))
+                return -E2BIG;
+
+        *h = (RulesCacheHeader) {
+                .header_size = sizeof(RulesCacheHeader),
+                .resolve_name_timing = resolve_name_timing,
+        };
+        rules_cache_stamp_from_path(&h->passwd, "/etc/passwd");
+        rules_cache_stamp_from_path(&h->group, "/etc/group");
+        memcpy(h->signature, RULES_CACHE_SIGNATURE, sizeof(h->signature));
+        strncpy(h->version, GIT_VERSION, sizeof(h->version));
+
+        return 0;
+}
+
+static uint64_t rules_cache_offset(const UdevRuleLine *line, const char *p) {
+        assert(line);
+
+        if (!p)
+                return RULES_CACHE_NULL;
+
+        /* All strings used by tokens point into the line buffer */
+        if (p < line->line || p >= line->line + line->line_size)
+                return RULES_CACHE_NULL - 1;
+
+        return p - line->line;
+}
+
+static int rules_cache_write_line(FILE *f, const UdevRuleLine *line) {
+        const UdevRuleToken *token;
+        RulesCacheLine l;
+        uint64_t n = 0;
+
+        assert(f);
+        assert(line);
+
+        LIST_FOREACH(tokens, token, line->tokens)
+                n++;
+
+        l = (RulesCacheLine) {
+                .line_size = line->line_size,
+                .label = rules_cache_offset(line, line->label),
+                .goto_label = rules_cache_offset(line, line->goto_label),
+                .n_tokens = n,
+                .line_number = line->line_number,
+                .type = line->type,
+        };
+        if (l.label == RULES_CACHE_NULL - 1 || l.goto_label == RULES_CACHE_NULL - 1)
+                return -EINVAL;
+
+        fwrite(&l, sizeof(l), 1, f);
+        fwrite(line->line, line->line_size, 1, f);
+
+        LIST_FOREACH(tokens, token, line->tokens) {
+                RulesCacheToken t = {
+                        .type = token->type,
+                        .op = token->op,
+                        .match_type = token->match_type,
+                        .attr_subst_type = token->attr_subst_type,
+                        .flags = (token->attr_match_remove_trailing_whitespace ? RULES_CACHE_TOKEN_REMOVE_TRAILING_WHITESPACE : 0) |
+                                 (token->match_glob_prefix ? RULES_CACHE_TOKEN_GLOB_PREFIX : 0),
+                        .value = rules_cache_offset(line, token->value),
+                        .data = token_data_is_string(token->type) ?
+                                rules_cache_offset(line, token->data) :
+                                (uint64_t) (uintptr_t) token->data,
+                };
+                if (t.value == RULES_CACHE_NULL - 1 ||
+                    (token_data_is_string(token->type) && t.data == RULES_CACHE_NULL - 1))
+                        return -EINVAL;
+
+                fwrite(&t, sizeof(t), 1, f);
+        }
+
+        return 0;
+}
+
+static int rules_cache_write_source(FILE *f, const char *path) {
+        RulesCacheSource src;
+        struct stat st;
+
+        assert(f);
+        assert(path);
+
+        if (stat(path, &st) < 0)
+                return -errno;
+
+        src = (RulesCacheSource) {
+                .path_size = strlen(path) + 1,
+        };
+        rules_cache_stamp_from_stat(&src.stamp, &st);
+
+        fwrite(&src, sizeof(src), 1, f);
+        fwrite(path, src.path_size, 1, f);
+        return 0;
+}
+
+int udev_rules_cache_save(UdevRules *rules, char **sources, const char *path) {
+        _cleanup_(unlink_and_freep) char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const UdevRuleFile *file;
+        const UdevRuleLine *line;
+        RulesCacheHeader h;
+        char **i;
+        int r;
+
+        assert(rules);
+        assert(path);
+
+        r = rules_cache_header_init(&h, rules->resolve_name_timing);
+        if (r < 0)
+                return r;
+
+        h.n_sources = strv_length(sources);
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                h.n_files++;
+
+        (void) mkdir_parents(path, 0755);
+
+        r = fopen_temporary(path, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        fwrite(&h, sizeof(h), 1, f);
+
+        STRV_FOREACH(i, sources) {
+                r = rules_cache_write_source(f, *i);
+                if (r < 0)
+                        return r;
+        }
+
+        LIST_FOREACH(rule_files, file, rules->rule_files) {
+                uint64_t n = 0, size = strlen(file->filename) + 1;
+
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        n++;
+
+                fwrite(&size, sizeof(size), 1, f);
+                fwrite(file->filename, size, 1, f);
+                fwrite(&n, sizeof(n), 1, f);
+
+                LIST_FOREACH(rule_lines, line, file->rule_lines) {
+                        r = rules_cache_write_line(f, line);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), 0644) < 0)
+                return -errno;
+
+        if (rename(temp_path, path) < 0)
+                return -errno;
+
+        temp_path = mfree(temp_path);
+        return 0;
+}
+
+typedef struct RulesCacheReader {
+        const uint8_t *p;
+        const uint8_t *end;
+} RulesCacheReader;
+
+static const void *rules_cache_read(RulesCacheReader *reader, uint64_t size) {
+        const void *p;
+
+        assert(reader);
+
+        if (size > (uint64_t) (reader->end - reader->p))
+                return NULL;
+
+        p = reader->p;
+        reader->p += size;
+        return p;
+}
+
+static int rules_cache_read_u64(RulesCacheReader *reader, uint64_t *ret) {
+        const uint8_t *p;
+
+        assert(ret);
+
+        p = rules_cache_read(reader, sizeof(uint64_t));
+        if (!p)
+                return -EBADMSG;
+
+        *ret = unaligned_read_ne64(p);
+        return 0;
+}
+
+static const char *rules_cache_read_string(RulesCacheReader *reader, uint64_t size) {
+        const char *s;
+
+        s = rules_cache_read(reader, size);
+        if (!s || size == 0 || s[size - 1] != '\0')
+                return NULL;
+
+        return s;
+}
+
+#define RULES_CACHE_FIELD64(p, type, field) \
+        unaligned_read_ne64((const uint8_t*) (p) + offsetof(type, field))
+#define RULES_CACHE_FIELD32(p, type, field) \
+        unaligned_read_ne32((const uint8_t*) (p) + offsetof(type, field))
+
+static void rules_cache_decode_stamp(const uint8_t *p, RulesCacheStamp *ret) {
+        assert(p);
+        assert(ret);
+
+        *ret = (RulesCacheStamp) {
+                .mtime = RULES_CACHE_FIELD64(p, RulesCacheStamp, mtime),
+                .size = RULES_CACHE_FIELD64(p, RulesCacheStamp, size),
+                .inode = RULES_CACHE_FIELD64(p, RulesCacheStamp, inode),
+        };
+}
+
+static int rules_cache_read_header(RulesCacheReader *reader, RulesCacheHeader *ret) {
+        const uint8_t *p;
+
+        assert(ret);
+
+        p = rules_cache_read(reader, sizeof(RulesCacheHeader));
+        if (!p)
+                return -EBADMSG;
+
+        *ret = (RulesCacheHeader) {
+                .header_size = RULES_CACHE_FIELD64(p, RulesCacheHeader, header_size),
+                .resolve_name_timing = RULES_CACHE_FIELD64(p, RulesCacheHeader, resolve_name_timing),
+                .n_sources = RULES_CACHE_FIELD64(p, RulesCacheHeader, n_sources),
+                .n_files = RULES_CACHE_FIELD64(p, RulesCacheHeader, n_files),
+        };
+        memcpy(ret->signature, p + offsetof(RulesCacheHeader, signature), sizeof(ret->signature));
+        memcpy(ret->version, p + offsetof(RulesCacheHeader, version), sizeof(ret->version));
+        rules_cache_decode_stamp(p + offsetof(RulesCacheHeader, passwd), &ret->passwd);
+        rules_cache_decode_stamp(p + offsetof(RulesCacheHeader, group), &ret->group);
+
+        return 0;
+}
+
+static int rules_cache_read_source(RulesCacheReader *reader, RulesCacheSource *ret) {
+        const uint8_t *p;
+
+        assert(ret);
+
+        p = rules_cache_read(reader, sizeof(RulesCacheSource));
+        if (!p)
+                return -EBADMSG;
+
+        *ret = (RulesCacheSource) {
+                .path_size = RULES_CACHE_FIELD64(p, RulesCacheSource, path_size),
+        };
+        rules_cache_decode_stamp(p + offsetof(RulesCacheSource, stamp), &ret->stamp);
+
+        return 0;
+}
+
+static int rules_cache_read_line_header(RulesCacheReader *reader, RulesCacheLine *ret) {
+        const uint8_t *p;
+
+        assert(ret);
+
+        p = rules_cache_read(reader, sizeof(RulesCacheLine));
+        if (!p)
+                return -EBADMSG;
+
+        *ret = (RulesCacheLine) {
+                .line_size = RULES_CACHE_FIELD64(p, RulesCacheLine, line_size),
+                .label = RULES_CACHE_FIELD64(p, RulesCacheLine, label),
+                .goto_label = RULES_CACHE_FIELD64(p, RulesCacheLine, goto_label),
+                .n_tokens = RULES_CACHE_FIELD64(p, RulesCacheLine, n_tokens),
+                .line_number = RULES_CACHE_FIELD32(p, RulesCacheLine, line_number),
+                .type = RULES_CACHE_FIELD32(p, RulesCacheLine, type),
+        };
+
+        return 0;
+}
+
+static int rules_cache_read_token(RulesCacheReader *reader, RulesCacheToken *ret) {
+        const uint8_t *p;
+
+        assert(ret);
+
+        p = rules_cache_read(reader, sizeof(RulesCacheToken));
+        if (!p)
+                return -EBADMSG;
+
+        *ret = (RulesCacheToken) {
+                .type = (int8_t) p[offsetof(RulesCacheToken, type)],
+                .op = (int8_t) p[offsetof(RulesCacheToken, op)],
+                .match_type = (int8_t) p[offsetof(RulesCacheToken, match_type)],
+                .attr_subst_type = (int8_t) p[offsetof(RulesCacheToken, attr_subst_type)],
+                .flags = p[offsetof(RulesCacheToken, flags)],
+                .value = RULES_CACHE_FIELD64(p, RulesCacheToken, value),
+                .data = RULES_CACHE_FIELD64(p, RulesCacheToken, data),
+        };
+
+        return 0;
+}
+
+static int rules_cache_resolve_offset(const UdevRuleLine *line, uint64_t offset, const char **ret) {
+        assert(line);
+        assert(ret);
+
+        if (offset == RULES_CACHE_NULL) {
+                *ret = NULL;
+                return 0;
+        }
+
+        /* The line buffer is terminated by two NUL bytes, hence every offset within it is a valid string */
+        if (offset >= line->line_size)
+                return -EBADMSG;
+
+        *ret = line->line + offset;
+        return 0;
+}
+
+static int rules_cache_read_line(RulesCacheReader *reader, UdevRuleFile *rule_file) {
+        _cleanup_(udev_rule_line_freep) UdevRuleLine *rule_line = NULL;
+        RulesCacheLine l;
+        const char *buf;
+        uint64_t i;
+        int r;
+
+        r = rules_cache_read_line_header(reader, &l);
+        if (r < 0)
+                return r;
+        if (l.line_size < 2)
+                return -EBADMSG;
+
+        buf = rules_cache_read(reader, l.line_size);
+        if (!buf || buf[l.line_size - 1] != '\0' || buf[l.line_size - 2] != '\0')
+                return -EBADMSG;
+
+        rule_line = new(UdevRuleLine, 1);
+        if (!rule_line)
+                return -ENOMEM;
+
+        *rule_line = (UdevRuleLine) {
+                .line = memdup(buf, l.line_size),
+                .line_size = l.line_size,
+                .line_number = l.line_number,
+                .type = l.type,
+                .rule_file = rule_file,
+        };
+        if (!rule_line->line)
+                return -ENOMEM;
+
+        if (rule_file->current_line)
+                LIST_APPEND(rule_lines, rule_file->current_line, rule_line);
+        else
+                LIST_APPEND(rule_lines, rule_file->rule_lines, rule_line);
+
+        rule_file->current_line = rule_line;
+
+        r = rules_cache_resolve_offset(rule_line, l.label, &rule_line->label);
+        if (r < 0)
+                return r;
+
+        r = rules_cache_resolve_offset(rule_line, l.goto_label, &rule_line->goto_label);
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < l.n_tokens; i++) {
+                UdevRuleToken *token;
+                const char *value, *data;
+                RulesCacheToken t;
+
+                r = rules_cache_read_token(reader, &t);
+                if (r < 0)
+                        return r;
+
+                if (t.type < 0 || t.type >= _TK_TYPE_MAX ||
+                    t.op < 0 || t.op >= _OP_TYPE_MAX ||
+                    t.match_type < _MATCH_TYPE_INVALID || t.match_type >= _MATCH_TYPE_MAX ||
+                    t.attr_subst_type < _SUBST_TYPE_INVALID || t.attr_subst_type >= _SUBST_TYPE_MAX)
+                        return -EBADMSG;
+
+                r = rules_cache_resolve_offset(rule_line, t.value, &value);
+                if (r < 0)
+                        return r;
+                if (t.type < _TK_M_MAX && !value)
+                        return -EBADMSG;
+
+                if (token_data_is_string(t.type)) {
+                        r = rules_cache_resolve_offset(rule_line, t.data, &data);
+                        if (r < 0)
+                                return r;
+                } else
+                        data = (const char*) (uintptr_t) t.data;
+
+                token = new(UdevRuleToken, 1);
+                if (!token)
+                        return -ENOMEM;
+
+                *token = (UdevRuleToken) {
+                        .type = t.type,
+                        .op = t.op,
+                        .match_type = t.match_type,
+                        .attr_subst_type = t.attr_subst_type,
+                        .attr_match_remove_trailing_whitespace = FLAGS_SET(t.flags, RULES_CACHE_TOKEN_REMOVE_TRAILING_WHITESPACE),
+                        .match_glob_prefix = FLAGS_SET(t.flags, RULES_CACHE_TOKEN_GLOB_PREFIX),
+                        .value = value,
+                        .data = (void*) data,
+                };
+
+                rule_line_append_token(rule_line, token);
+        }
+
+        TAKE_PTR(rule_line);
+        return 0;
+}
+
+static int rules_cache_parse(
+                const void *map,
+                size_t size,
+                ResolveNameTiming resolve_name_timing,
+                char **sources,
+                UdevRules **ret) {
+
         _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
-        _cleanup_strv_free_ char **files = NULL;
-        char **f;
+        RulesCacheReader reader = {
+                .p = map,
+                .end = (const uint8_t*) map + size,
+        };
+        RulesCacheHeader h, expected;
+        uint64_t i, j;
+        char **s;
         int r;
 
+        assert(map);
+        assert(ret);
+
+        r = rules_cache_header_init(&expected, resolve_name_timing);
+        if (r < 0)
+                return r;
+
+        r = rules_cache_read_header(&reader, &h);
+        if (r < 0)
+                return r;
+        if (memcmp(h.signature, expected.signature, sizeof(h.signature)) != 0 ||
+            h.header_size != sizeof(RulesCacheHeader))
+                return -EBADMSG;
+
+        if (memcmp(h.version, expected.version, sizeof(h.version)) != 0 ||
+            h.resolve_name_timing != expected.resolve_name_timing ||
+            !rules_cache_stamp_equal(&h.passwd, &expected.passwd) ||
+            !rules_cache_stamp_equal(&h.group, &expected.group) ||
+            h.n_sources != strv_length(sources))
+                return -ESTALE;
+
+        STRV_FOREACH(s, sources) {
+                RulesCacheSource src;
+                RulesCacheStamp stamp;
+                const char *path;
+                struct stat st;
+
+                r = rules_cache_read_source(&reader, &src);
+                if (r < 0)
+                        return r;
+
+                path = rules_cache_read_string(&reader, src.path_size);
+                if (!path)
+                        return -EBADMSG;
+
+                if (!streq(path, *s) || stat(*s, &st) < 0)
+                        return -ESTALE;
+
+                rules_cache_stamp_from_stat(&stamp, &st);
+                if (!rules_cache_stamp_equal(&src.stamp, &stamp))
+                        return -ESTALE;
+        }
+
         rules = udev_rules_new(resolve_name_timing);
         if (!rules)
                 return -ENOMEM;
 
-        (void) udev_rules_check_timestamp(rules);
+        for (i = 0; i < h.n_files; i++) {
+                uint64_t filename_size, n_lines;
+                UdevRuleFile *rule_file;
+                const char *filename;
+
+                r = rules_cache_read_u64(&reader, &filename_size);
+                if (r < 0)
+                        return r;
+
+                filename = rules_cache_read_string(&reader, filename_size);
+                if (!filename)
+                        return -EBADMSG;
+
+                r = rules_cache_read_u64(&reader, &n_lines);
+                if (r < 0)
+                        return r;
+
+                rule_file = new(UdevRuleFile, 1);
+                if (!rule_file)
+                        return -ENOMEM;
+
+                *rule_file = (UdevRuleFile) {
+                        .filename = strdup(filename),
+                };
+
+                if (rules->current_file)
+                        LIST_APPEND(rule_files, rules->current_file, rule_file);
+                else
+                        LIST_APPEND(rule_files, rules->rule_files, rule_file);
+
+                rules->current_file = rule_file;
+
+                if (!rule_file->filename)
+                        return -ENOMEM;
+
+                for (j = 0; j < n_lines; j++) {
+                        r = rules_cache_read_line(&reader, rule_file);
+                        if (r < 0)
+                                return r;
+                }
+
+                rule_resolve_goto(rule_file);
+                rule_file_build_index(rule_file);
+        }
+
+        if (reader.p != reader.end)
+                return -EBADMSG;
+
+        *ret = TAKE_PTR(rules);
+        return 0;
+}
+
+int udev_rules_cache_load(const char *path, ResolveNameTiming resolve_name_timing, char **sources, UdevRules **ret) {
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        void *map;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+        if (st.st_size < (off_t) sizeof(RulesCacheHeader))
+                return -EBADMSG;
+
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+                return -errno;
+
+        r = rules_cache_parse(map, st.st_size, resolve_name_timing, sources, ret);
+
+        (void) munmap(map, st.st_size);
+        return r;
+}
+
+int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing, bool use_cache) {
+        _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
+        _cleanup_strv_free_ char **files = NULL;
+        usec_t dirs_ts_usec = 0;
+        char **f;
+        int r;
+
+        (void) paths_check_timestamp(RULES_DIRS, &dirs_ts_usec, true);
 
         r = conf_files_list_strv(&files, ".rules", NULL, 0, RULES_DIRS);
         if (r < 0)
                 return log_debug_errno(r, "Failed to enumerate rules files: %m");
 
+        if (use_cache) {
+                r = udev_rules_cache_load(UDEV_RULES_CACHE_PATH, resolve_name_timing, files, &rules);
+                if (r >= 0) {
+                        log_debug("Loaded rules from %s.", UDEV_RULES_CACHE_PATH);
+                        rules->dirs_ts_usec = dirs_ts_usec;
+                        *ret_rules = TAKE_PTR(rules);
+                        return 0;
+                }
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to load rules from %s, parsing rules files: %m", UDEV_RULES_CACHE_PATH);
+        }
+
+        rules = udev_rules_new(resolve_name_timing);
+        if (!rules)
+                return -ENOMEM;
+
+        rules->dirs_ts_usec = dirs_ts_usec;
+
         STRV_FOREACH(f, files) {
                 r = udev_rules_parse_file(rules, *f);
                 if (r < 0)
                         log_debug_errno(r, "Failed to read rules file %s, ignoring: %m", *f);
         }
 
+        if (use_cache) {
+                r = udev_rules_cache_save(rules, files, UDEV_RULES_CACHE_PATH);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to write %s, ignoring: %m", UDEV_RULES_CACHE_PATH);
+        }
+
         *ret_rules = TAKE_PTR(rules);
         return 0;
 }
@@ -1363,7 +2181,9 @@ static bool token_match_string(UdevRuleToken *token, const char *str) {
                 _fallthrough_;
         case MATCH_TYPE_GLOB:
                 NULSTR_FOREACH(i, value)
-                        if ((fnmatch(i, str, 0) == 0)) {
+                        if (token->match_glob_prefix ?
+                            strncmp(i, str, strlen(i) - 1) == 0 :
+                            fnmatch(i, str, 0) == 0) {
                                 match = true;
                                 break;
                         }
@@ -1549,7 +2369,7 @@ static int udev_rule_apply_token_to_event(
          * 1 on the current token matches the event, and
          * negative errno on some critical errors. */
 
-        token = rules->current_file->current_line->current_token;
+        token = rules->current_token;
 
         switch (token->type) {
         case TK_M_ACTION: {
@@ -2176,16 +2996,14 @@ static int udev_rule_apply_parent_token_to_event(
                 UdevEvent *event,
                 int timeout_signal) {
 
-        UdevRuleLine *line;
         UdevRuleToken *head;
         int r;
 
-        line = rules->current_file->current_line;
-        head = rules->current_file->current_line->current_token;
+        head = rules->current_token;
         event->dev_parent = event->dev;
         for (;;) {
-                LIST_FOREACH(tokens, line->current_token, head) {
-                        if (!token_is_for_parents(line->current_token))
+                LIST_FOREACH(tokens, rules->current_token, head) {
+                        if (!token_is_for_parents(rules->current_token))
                                 return true; /* All parent tokens match. */
                         r = udev_rule_apply_token_to_event(rules, event->dev_parent, event, 0, timeout_signal, NULL);
                         if (r < 0)
@@ -2193,7 +3011,7 @@ static int udev_rule_apply_parent_token_to_event(
                         if (r == 0)
                                 break;
                 }
-                if (!line->current_token)
+                if (!rules->current_token)
                         /* All parent tokens match. But no assign tokens in the line. Hmm... */
                         return true;
 
@@ -2210,33 +3028,30 @@ static int udev_rule_apply_line_to_event(
                 usec_t timeout_usec,
                 int timeout_signal,
                 Hashmap *properties_list,
+                UdevRuleLineType mask,
+                const char * const *index_values,
                 UdevRuleLine **next_line) {
 
-        UdevRuleLine *line = rules->current_file->current_line;
-        UdevRuleLineType mask = LINE_HAS_GOTO | LINE_UPDATE_SOMETHING;
+        UdevRuleLine *line = rules->current_line;
         UdevRuleToken *token, *next_token;
         bool parents_done = false;
-        DeviceAction action;
+        UdevRuleIndexKey k;
         int r;
 
-        r = device_get_action(event->dev, &action);
-        if (r < 0)
-                return r;
-
-        if (action != DEVICE_ACTION_REMOVE) {
-                if (sd_device_get_devnum(event->dev, NULL) >= 0)
-                        mask |= LINE_HAS_DEVLINK;
-
-                if (sd_device_get_ifindex(event->dev, NULL) >= 0)
-                        mask |= LINE_HAS_NAME;
-        }
-
         if ((line->type & mask) == 0)
                 return 0;
 
+        if (index_values)
+                for (k = 0; k < _INDEX_KEY_MAX; k++)
+                        if (line->index_token[k] && !token_match_string(line->index_token[k], index_values[k])) {
+                                /* The following lines with the same match cannot match either */
+                                *next_line = line->index_skip[k];
+                                return 0;
+                        }
+
         event->esc = ESCAPE_UNSET;
         LIST_FOREACH_SAFE(tokens, token, next_token, line->tokens) {
-                line->current_token = token;
+                rules->current_token = token;
 
                 if (token_is_for_parents(token)) {
                         if (parents_done)
@@ -2268,17 +3083,46 @@ int udev_rules_apply_to_event(
                 int timeout_signal,
                 Hashmap *properties_list) {
 
-        UdevRuleFile *file;
+        UdevRuleLineType mask = LINE_HAS_GOTO | LINE_UPDATE_SOMETHING;
+        const char *index_values[_INDEX_KEY_MAX] = {};
+        bool use_index = true;
         UdevRuleLine *next_line;
+        UdevRuleFile *file;
+        DeviceAction action;
         int r;
 
         assert(rules);
         assert(event);
 
+        r = device_get_action(event->dev, &action);
+        if (r < 0)
+                return r;
+
+        if (action != DEVICE_ACTION_REMOVE) {
+                if (sd_device_get_devnum(event->dev, NULL) >= 0)
+                        mask |= LINE_HAS_DEVLINK;
+
+                if (sd_device_get_ifindex(event->dev, NULL) >= 0)
+                        mask |= LINE_HAS_NAME;
+        }
+
+        /* Look up the indexed keys once. If any of them cannot be read, don't use the index, and let the
+         * token matching log about it. */
+        index_values[INDEX_KEY_ACTION] = device_action_to_string(action);
+        if (sd_device_get_sysname(event->dev, &index_values[INDEX_KEY_KERNEL]) < 0)
+                use_index = false;
+        r = sd_device_get_subsystem(event->dev, &index_values[INDEX_KEY_SUBSYSTEM]);
+        if (r < 0 && r != -ENOENT)
+                use_index = false;
+        r = sd_device_get_driver(event->dev, &index_values[INDEX_KEY_DRIVER]);
+        if (r < 0 && r != -ENOENT)
+                use_index = false;
+
         LIST_FOREACH(rule_files, file, rules->rule_files) {
                 rules->current_file = file;
-                LIST_FOREACH_SAFE(rule_lines, file->current_line, next_line, file->rule_lines) {
-                        r = udev_rule_apply_line_to_event(rules, event, timeout_usec, timeout_signal, properties_list, &next_line);
+                LIST_FOREACH_SAFE(rule_lines, rules->current_line, next_line, file->rule_lines) {
+                        r = udev_rule_apply_line_to_event(rules, event, timeout_usec, timeout_signal, properties_list,
+                                                          mask, use_index ? index_values : NULL, &next_line);
                         if (r < 0)
                                 return r;
                 }
@@ -5,6 +5,8 @@
 #include "time-util.h"
 #include "udev-util.h"
 
+#define UDEV_RULES_CACHE_PATH "/run/udev/rules.bin"
+
 typedef struct UdevRules UdevRules;
 typedef struct UdevEvent UdevEvent;
 
@@ -18,7 +20,9 @@ typedef enum {
 
 int udev_rules_parse_file(UdevRules *rules, const char *filename);
 UdevRules* udev_rules_new(ResolveNameTiming resolve_name_timing);
-int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing);
+int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing, bool use_cache);
+int udev_rules_cache_save(UdevRules *rules, char **sources, const char *path);
+int udev_rules_cache_load(const char *path, ResolveNameTiming resolve_name_timing, char **sources, UdevRules **ret);
 UdevRules *udev_rules_free(UdevRules *rules);
 DEFINE_TRIVIAL_CLEANUP_FUNC(UdevRules*, udev_rules_free);
 
@@ -250,6 +250,7 @@ static void cleanup_db(void) {
         _cleanup_closedir_ DIR *dir1 = NULL, *dir2 = NULL, *dir3 = NULL, *dir4 = NULL, *dir5 = NULL;
 
         (void) unlink("/run/udev/queue.bin");
+        (void) unlink(DEVICE_DB_SNAPSHOT_PATH);
 
         dir1 = opendir("/run/udev/data");
         if (dir1)
@@ -10,9 +10,10 @@
 #include "device-private.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "hashmap.h"
+#include "id128-util.h"
 #include "path-util.h"
 #include "process-util.h"
-#include "set.h"
 #include "string-util.h"
 #include "strv.h"
 #include "udevadm.h"
@@ -22,13 +23,59 @@
 
 static bool arg_verbose = false;
 static bool arg_dry_run = false;
+static bool arg_uuid = false;
 
-static int exec_list(sd_device_enumerator *e, const char *action, Set **settle_set) {
+static int write_uevent(const char *filename, const char *action, bool with_uuid, char **ret_uuid) {
+        static bool uuid_supported = true;
+        _cleanup_free_ char *uuid = NULL, *s = NULL;
+        sd_id128_t id;
+        int r;
+
+        assert(filename);
+        assert(action);
+        assert(ret_uuid);
+
+        if (!with_uuid || !uuid_supported) {
+                *ret_uuid = NULL;
+                return write_string_file(filename, action, WRITE_STRING_FILE_DISABLE_BUFFER);
+        }
+
+        r = sd_id128_randomize(&id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to generate synthetic uevent UUID: %m");
+
+        uuid = new(char, ID128_UUID_STRING_MAX);
+        if (!uuid)
+                return log_oom();
+        id128_to_uuid_string(id, uuid);
+
+        s = strjoin(action, " ", uuid);
+        if (!s)
+                return log_oom();
+
+        /* The kernel sets SYNTH_UUID= on the resulting uevent, so that we can match it exactly. Kernels
+         * older than 4.13 refuse anything but the action, fall back to plain actions then, unless the
+         * caller asked for the UUIDs explicitly. */
+        r = write_string_file(filename, s, WRITE_STRING_FILE_DISABLE_BUFFER);
+        if (r == -EINVAL && !arg_uuid) {
+                log_debug_errno(r, "Kernel does not support synthetic uevent UUIDs, triggering plain '%s' events.", action);
+                uuid_supported = false;
+                *ret_uuid = NULL;
+                return write_string_file(filename, action, WRITE_STRING_FILE_DISABLE_BUFFER);
+        }
+        if (r < 0)
+                return r;
+
+        *ret_uuid = TAKE_PTR(uuid);
+        return 0;
+}
+
+static int exec_list(sd_device_enumerator *e, const char *action, Hashmap *settle_hashmap) {
         sd_device *d;
         int r, ret = 0;
 
         FOREACH_DEVICE_AND_SUBSYSTEM(e, d) {
-                _cleanup_free_ char *filename = NULL;
+                _cleanup_free_ char *filename = NULL, *uuid = NULL;
                 const char *syspath;
 
                 if (sd_device_get_syspath(d, &syspath) < 0)
@@ -43,7 +90,7 @@ static int exec_list(sd_device_enumerator *e, const char *action, Set **settle_s
                 if (!filename)
                         return log_oom();
 
-                r = write_string_file(filename, action, WRITE_STRING_FILE_DISABLE_BUFFER);
+                r = write_uevent(filename, action, arg_uuid || settle_hashmap, &uuid);
                 if (r < 0) {
                         bool ignore = IN_SET(r, -ENOENT, -EACCES, -ENODEV, -EROFS);
 
@@ -57,10 +104,22 @@ static int exec_list(sd_device_enumerator *e, const char *action, Set **settle_s
                         continue;
                 }
 
-                if (settle_set) {
-                        r = set_put_strdup(settle_set, syspath);
+                if (arg_uuid && uuid)
+                        printf("%s\n", uuid);
+
+                if (settle_hashmap) {
+                        _cleanup_free_ char *p = NULL;
+
+                        p = strdup(syspath);
+                        if (!p)
+                                return log_oom();
+
+                        r = hashmap_put(settle_hashmap, p, uuid);
                         if (r < 0)
                                 return log_oom();
+
+                        TAKE_PTR(p);
+                        TAKE_PTR(uuid);
                 }
         }
 
@@ -68,24 +127,35 @@ static int exec_list(sd_device_enumerator *e, const char *action, Set **settle_s
 }
 
 static int device_monitor_handler(sd_device_monitor *m, sd_device *dev, void *userdata) {
-        _cleanup_free_ char *val = NULL;
-        Set *settle_set = userdata;
-        const char *syspath;
+        _cleanup_free_ char *key = NULL, *uuid = NULL;
+        Hashmap *settle_hashmap = userdata;
+        const char *syspath, *expected, *id;
 
         assert(dev);
-        assert(settle_set);
+        assert(settle_hashmap);
 
         if (sd_device_get_syspath(dev, &syspath) < 0)
                 return 0;
 
+        if (!hashmap_contains(settle_hashmap, syspath)) {
+                log_debug("Got uevent for syspath %s not present in syspath set, ignoring.", syspath);
+                return 0;
+        }
+
+        /* Only our own event finishes the wait, not a concurrent one for the same device */
+        expected = hashmap_get(settle_hashmap, syspath);
+        if (expected &&
+            (sd_device_get_property_value(dev, "SYNTH_UUID", &id) < 0 || !streq(id, expected))) {
+                log_debug("Got uevent for syspath %s not matching the expected UUID %s, ignoring.", syspath, expected);
+                return 0;
+        }
+
         if (arg_verbose)
                 printf("settle %s\n", syspath);
 
-        val = set_remove(settle_set, syspath);
-        if (!val)
-                log_debug("Got epoll event on syspath %s not present in syspath set", syspath);
+        uuid = hashmap_remove2(settle_hashmap, syspath, (void**) &key);
 
-        if (set_isempty(settle_set))
+        if (hashmap_isempty(settle_hashmap))
                 return sd_event_exit(sd_device_monitor_get_event(m), 0);
 
         return 0;
@@ -131,6 +201,7 @@ static int help(void) {
                "     --name-match=NAME              Trigger devices with this /dev name\n"
                "  -b --parent-match=NAME            Trigger devices with that parent device\n"
                "  -w --settle                       Wait for the triggered events to complete\n"
+               "     --uuid                         Print synthetic uevent UUID\n"
                "     --wait-daemon[=SECONDS]        Wait for udevd daemon to be initialized\n"
                "                                    before triggering uevents\n"
                , program_invocation_short_name);
@@ -142,6 +213,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         enum {
                 ARG_NAME = 0x100,
                 ARG_PING,
+                ARG_UUID,
         };
 
         static const struct option options[] = {
@@ -160,6 +232,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 { "parent-match",      required_argument, NULL, 'b'      },
                 { "settle",            no_argument,       NULL, 'w'      },
                 { "wait-daemon",       optional_argument, NULL, ARG_PING },
+                { "uuid",              no_argument,       NULL, ARG_UUID },
                 { "version",           no_argument,       NULL, 'V'      },
                 { "help",              no_argument,       NULL, 'h'      },
                 {}
@@ -172,7 +245,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_device_enumerator_unrefp) sd_device_enumerator *e = NULL;
         _cleanup_(sd_device_monitor_unrefp) sd_device_monitor *m = NULL;
         _cleanup_(sd_event_unrefp) sd_event *event = NULL;
-        _cleanup_set_free_ Set *settle_set = NULL;
+        _cleanup_hashmap_free_free_free_ Hashmap *settle_hashmap = NULL;
         usec_t ping_timeout_usec = 5 * USEC_PER_SEC;
         bool settle = false, ping = false;
         int c, r;
@@ -302,6 +375,10 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                         break;
                 }
 
+                case ARG_UUID:
+                        arg_uuid = true;
+                        break;
+
                 case 'V':
                         return print_version();
                 case 'h':
@@ -342,8 +419,8 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         }
 
         if (settle) {
-                settle_set = set_new(&string_hash_ops_free);
-                if (!settle_set)
+                settle_hashmap = hashmap_new(&string_hash_ops);
+                if (!settle_hashmap)
                         return log_oom();
 
                 r = sd_event_default(&event);
@@ -358,7 +435,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 if (r < 0)
                         return log_error_errno(r, "Failed to attach event to device monitor: %m");
 
-                r = sd_device_monitor_start(m, device_monitor_handler, settle_set);
+                r = sd_device_monitor_start(m, device_monitor_handler, settle_hashmap);
                 if (r < 0)
                         return log_error_errno(r, "Failed to start device monitor: %m");
         }
@@ -378,11 +455,11 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 assert_not_reached("Unknown device type");
         }
 
-        r = exec_list(e, action, settle ? &settle_set : NULL);
+        r = exec_list(e, action, settle_hashmap);
         if (r < 0)
                 return r;
 
-        if (event && !set_isempty(settle_set)) {
+        if (event && !hashmap_isempty(settle_hashmap)) {
                 r = sd_event_loop(event);
                 if (r < 0)
                         return log_error_errno(r, "Event loop failed: %m");
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -49,6 +50,7 @@
 #include "mkdir.h"
 #include "netlink-util.h"
 #include "parse-util.h"
+#include "path-util.h"
 #include "pretty-print.h"
 #include "proc-cmdline.h"
 #include "process-util.h"
@@ -75,6 +77,7 @@ static ResolveNameTiming arg_resolve_name_timing = RESOLVE_NAME_EARLY;
 static unsigned arg_children_max = 0;
 static usec_t arg_exec_delay_usec = 0;
 static usec_t arg_event_timeout_usec = 180 * USEC_PER_SEC;
+static usec_t arg_watch_delay_usec = 0;
 static int arg_timeout_signal = SIGKILL;
 static bool arg_blockdev_read_only = false;
 
@@ -97,11 +100,18 @@ typedef struct Manager {
 
         sd_event_source *inotify_event;
         sd_event_source *kill_workers_event;
+        sd_event_source *db_snapshot_event;
+        sd_event_source *watch_delay_event;
+        sd_event_source *memory_pressure_event;
+
+        Hashmap *event_index;
+        Hashmap *watch_pending; /* device ID → sd_device, watched devices closed during the watch delay */
 
         usec_t last_usec;
 
         bool stop_exec_queue:1;
         bool exit:1;
+        bool db_snapshot_outdated:1;
 } Manager;
 
 enum event_state {
@@ -110,6 +120,22 @@ enum event_state {
         EVENT_RUNNING,
 };
 
+typedef struct EventIndexEntry EventIndexEntry;
+typedef struct EventIndexBucket EventIndexBucket;
+
+struct EventIndexEntry {
+        struct event *event;
+        EventIndexBucket *bucket;
+        LIST_FIELDS(EventIndexEntry, entries);
+};
+
+/* All queued or running events sharing one index key, ordered by their seqnum */
+struct EventIndexBucket {
+        char *key;
+        LIST_HEAD(EventIndexEntry, entries);
+        EventIndexEntry *tail;
+};
+
 struct event {
         Manager *manager;
         struct worker *worker;
@@ -124,6 +150,9 @@ struct event {
         sd_event_source *timeout_warning_event;
         sd_event_source *timeout_event;
 
+        EventIndexEntry *index_entries;
+        size_t n_index_entries;
+
         LIST_FIELDS(struct event, event);
 };
 
@@ -148,12 +177,176 @@ struct worker {
 struct worker_message {
 };
 
+static int event_get_index_keys(sd_device *dev, bool lookup, char ***ret) {
+        const char *subsystem, *devpath, *devpath_old = NULL;
+        _cleanup_strv_free_ char **keys = NULL;
+        dev_t devnum = makedev(0, 0);
+        int r, ifindex = 0;
+
+        assert(dev);
+        assert(ret);
+
+        /* Returns the keys under which an event is indexed, or with lookup set, the keys of all events
+         * which block it: events for the same device node, network interface or devpath, for our old
+         * devpath, and for any parent or child devpath. Parents of an event are referenced as "p<devpath>"
+         * like the exact devpath, while an event is additionally indexed at each of its parents as
+         * "s<parent devpath>", so that children can be found with a single lookup of our own devpath. */
+
+        r = sd_device_get_subsystem(dev, &subsystem);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_devpath(dev, &devpath);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_property_value(dev, "DEVPATH_OLD", &devpath_old);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        r = sd_device_get_devnum(dev, &devnum);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        r = sd_device_get_ifindex(dev, &ifindex);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        if (major(devnum) != 0) {
+                r = strv_extendf(&keys, "%c%u:%u", streq(subsystem, "block") ? 'b' : 'c',
+                                 major(devnum), minor(devnum));
+                if (r < 0)
+                        return r;
+        }
+
+        if (ifindex > 0) {
+                r = strv_extendf(&keys, "n%i", ifindex);
+                if (r < 0)
+                        return r;
+        }
+
+        r = strv_extendf(&keys, "p%s", devpath);
+        if (r < 0)
+                return r;
+
+        if (lookup) {
+                if (devpath_old) {
+                        r = strv_extendf(&keys, "p%s", devpath_old);
+                        if (r < 0)
+                                return r;
+                }
+
+                r = strv_extendf(&keys, "s%s", devpath);
+                if (r < 0)
+                        return r;
+        }
+
+        for (const char *p = devpath + 1; (p = strchr(p, '/')); p++) {
+                r = strv_extendf(&keys, "%c%.*s", lookup ? 'p' : 's', (int) (p - devpath), devpath);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(keys);
+        return 0;
+}
+
+static void event_index_remove(struct event *event) {
+        assert(event);
+        assert(event->manager);
+
+        for (size_t i = 0; i < event->n_index_entries; i++) {
+                EventIndexEntry *e = event->index_entries + i;
+                EventIndexBucket *b = e->bucket;
+
+                if (!b)
+                        continue;
+
+                if (b->tail == e)
+                        b->tail = e->entries_prev;
+                LIST_REMOVE(entries, b->entries, e);
+
+                if (!b->entries) {
+                        hashmap_remove(event->manager->event_index, b->key);
+                        free(b->key);
+                        free(b);
+                }
+        }
+
+        event->index_entries = mfree(event->index_entries);
+        event->n_index_entries = 0;
+}
+
+static int event_index_add(struct event *event) {
+        _cleanup_strv_free_ char **keys = NULL;
+        Manager *manager;
+        size_t i = 0;
+        char **k;
+        int r;
+
+        assert(event);
+        assert(event->manager);
+
+        manager = event->manager;
+
+        r = event_get_index_keys(event->dev, false, &keys);
+        if (r < 0)
+                return r;
+
+        r = hashmap_ensure_allocated(&manager->event_index, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        event->index_entries = new0(EventIndexEntry, strv_length(keys));
+        if (!event->index_entries)
+                return -ENOMEM;
+        event->n_index_entries = strv_length(keys);
+
+        STRV_FOREACH(k, keys) {
+                EventIndexEntry *e = event->index_entries + i++, *after;
+                EventIndexBucket *b;
+
+                b = hashmap_get(manager->event_index, *k);
+                if (!b) {
+                        b = new0(EventIndexBucket, 1);
+                        if (!b)
+                                return -ENOMEM;
+
+                        b->key = strdup(*k);
+                        if (!b->key) {
+                                free(b);
+                                return -ENOMEM;
+                        }
+
+                        r = hashmap_put(manager->event_index, b->key, b);
+                        if (r < 0) {
+                                free(b->key);
+                                free(b);
+                                return r;
+                        }
+                }
+
+                /* Events are received in the order of their seqnums, so this normally appends. */
+                for (after = b->tail; after && after->event->seqnum > event->seqnum; after = after->entries_prev)
+                        ;
+
+                e->event = event;
+                e->bucket = b;
+                LIST_INSERT_AFTER(entries, b->entries, after, e);
+                if (after == b->tail)
+                        b->tail = e;
+        }
+
+        return 0;
+}
+
 static void event_free(struct event *event) {
         if (!event)
                 return;
 
         assert(event->manager);
 
+        event_index_remove(event);
         LIST_REMOVE(event, event->manager->events, event);
         sd_device_unref(event->dev);
         sd_device_unref(event->dev_kernel);
@@ -279,11 +472,16 @@ static void manager_clear_for_worker(Manager *manager) {
 
         manager->inotify_event = sd_event_source_unref(manager->inotify_event);
         manager->kill_workers_event = sd_event_source_unref(manager->kill_workers_event);
+        manager->db_snapshot_event = sd_event_source_unref(manager->db_snapshot_event);
+        manager->watch_delay_event = sd_event_source_unref(manager->watch_delay_event);
+        manager->memory_pressure_event = sd_event_source_unref(manager->memory_pressure_event);
 
         manager->event = sd_event_unref(manager->event);
 
         manager->workers = hashmap_free(manager->workers);
         event_queue_cleanup(manager, EVENT_UNDEF);
+        manager->event_index = hashmap_free(manager->event_index);
+        manager->watch_pending = hashmap_free_with_destructor(manager->watch_pending, sd_device_unref);
 
         manager->monitor = sd_device_monitor_unref(manager->monitor);
         manager->ctrl = udev_ctrl_unref(manager->ctrl);
@@ -305,7 +503,11 @@ static void manager_free(Manager *manager) {
         sd_netlink_unref(manager->rtnl);
 
         hashmap_free_free_free(manager->properties);
-        udev_rules_free(manager->rules);
+
+        /* Workers share the rules with the main daemon copy-on-write, don't make them copy all pages just to
+         * free them right before exiting. */
+        if (manager->pid == getpid_cached())
+                udev_rules_free(manager->rules);
 
         safe_close(manager->fd_inotify);
         safe_close_pair(manager->worker_watch);
@@ -712,6 +914,16 @@ static int event_queue_insert(Manager *manager, sd_device *dev) {
 
         LIST_APPEND(event, manager->events, event);
 
+        /* the event is going to change the database, write a new snapshot once we are idle again */
+        manager->db_snapshot_outdated = true;
+        (void) event_source_disable(manager->db_snapshot_event);
+
+        r = event_index_add(event);
+        if (r < 0) {
+                event_free(event);
+                return r;
+        }
+
         log_device_debug(dev, "Device (SEQNUM=%"PRIu64", ACTION=%s) is queued",
                          seqnum, device_action_to_string(action));
 
@@ -735,112 +947,36 @@ static void manager_kill_workers(Manager *manager) {
 
 /* lookup event for identical, parent, child device */
 static int is_device_busy(Manager *manager, struct event *event) {
-        const char *subsystem, *devpath, *devpath_old = NULL;
-        dev_t devnum = makedev(0, 0);
-        struct event *loop_event;
-        size_t devpath_len;
-        int r, ifindex = 0;
-        bool is_block;
-
-        r = sd_device_get_subsystem(event->dev, &subsystem);
-        if (r < 0)
-                return r;
-
-        is_block = streq(subsystem, "block");
+        _cleanup_strv_free_ char **keys = NULL;
+        struct event *blocker = NULL;
+        char **k;
+        int r;
 
-        r = sd_device_get_devpath(event->dev, &devpath);
+        r = event_get_index_keys(event->dev, true, &keys);
         if (r < 0)
                 return r;
 
-        devpath_len = strlen(devpath);
-
-        r = sd_device_get_property_value(event->dev, "DEVPATH_OLD", &devpath_old);
-        if (r < 0 && r != -ENOENT)
-                return r;
-
-        r = sd_device_get_devnum(event->dev, &devnum);
-        if (r < 0 && r != -ENOENT)
-                return r;
-
-        r = sd_device_get_ifindex(event->dev, &ifindex);
-        if (r < 0 && r != -ENOENT)
-                return r;
-
-        /* check if queue contains events we depend on */
-        LIST_FOREACH(event, loop_event, manager->events) {
-                size_t loop_devpath_len, common;
-                const char *loop_devpath;
+        /* check if queue contains events we depend on, the oldest event of each bucket is enough */
+        STRV_FOREACH(k, keys) {
+                EventIndexBucket *b;
 
-                /* we already found a later event, earlier cannot block us, no need to check again */
-                if (loop_event->seqnum < event->delaying_seqnum)
+                b = hashmap_get(manager->event_index, *k);
+                if (!b || b->entries->event->seqnum >= event->seqnum)
                         continue;
 
-                /* event we checked earlier still exists, no need to check again */
-                if (loop_event->seqnum == event->delaying_seqnum)
-                        return true;
-
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        break;
-
-                /* check major/minor */
-                if (major(devnum) != 0) {
-                        const char *s;
-                        dev_t d;
-
-                        if (sd_device_get_subsystem(loop_event->dev, &s) < 0)
-                                continue;
-
-                        if (sd_device_get_devnum(loop_event->dev, &d) >= 0 &&
-                            devnum == d && is_block == streq(s, "block"))
-                                goto set_delaying_seqnum;
-                }
-
-                /* check network device ifindex */
-                if (ifindex > 0) {
-                        int i;
-
-                        if (sd_device_get_ifindex(loop_event->dev, &i) >= 0 &&
-                            ifindex == i)
-                                goto set_delaying_seqnum;
-                }
-
-                if (sd_device_get_devpath(loop_event->dev, &loop_devpath) < 0)
-                        continue;
-
-                /* check our old name */
-                if (devpath_old && streq(devpath_old, loop_devpath))
-                        goto set_delaying_seqnum;
-
-                loop_devpath_len = strlen(loop_devpath);
-
-                /* compare devpath */
-                common = MIN(devpath_len, loop_devpath_len);
-
-                /* one devpath is contained in the other? */
-                if (!strneq(devpath, loop_devpath, common))
-                        continue;
-
-                /* identical device event found */
-                if (devpath_len == loop_devpath_len)
-                        goto set_delaying_seqnum;
-
-                /* parent device event found */
-                if (devpath[common] == '/')
-                        goto set_delaying_seqnum;
-
-                /* child device event found */
-                if (loop_devpath[common] == '/')
-                        goto set_delaying_seqnum;
+                if (!blocker || b->entries->event->seqnum < blocker->seqnum)
+                        blocker = b->entries->event;
         }
 
-        return false;
+        if (!blocker)
+                return false;
 
-set_delaying_seqnum:
-        log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
-                         event->seqnum, loop_event->seqnum);
+        if (blocker->seqnum != event->delaying_seqnum) {
+                log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
+                                 event->seqnum, blocker->seqnum);
+                event->delaying_seqnum = blocker->seqnum;
+        }
 
-        event->delaying_seqnum = loop_event->seqnum;
         return true;
 }
 
@@ -858,6 +994,8 @@ static void manager_exit(Manager *manager) {
 
         manager->inotify_event = sd_event_source_unref(manager->inotify_event);
         manager->fd_inotify = safe_close(manager->fd_inotify);
+        (void) event_source_disable(manager->watch_delay_event);
+        manager->watch_pending = hashmap_free_with_destructor(manager->watch_pending, sd_device_unref);
 
         manager->monitor = sd_device_monitor_unref(manager->monitor);
 
@@ -879,11 +1017,29 @@ static void manager_reload(Manager *manager) {
         manager->rules = udev_rules_free(manager->rules);
         udev_builtin_exit();
 
+        /* Make sure the rules files are parsed again, even if the cache looks up-to-date */
+        if (unlink(UDEV_RULES_CACHE_PATH) < 0 && errno != ENOENT)
+                log_debug_errno(errno, "Failed to remove %s, ignoring: %m", UDEV_RULES_CACHE_PATH);
+
         sd_notifyf(false,
                    "READY=1\n"
                    "STATUS=Processing with %u children at max", arg_children_max);
 }
 
+static int on_db_snapshot_event(sd_event_source *s, uint64_t usec, void *userdata) {
+        Manager *manager = userdata;
+        int r;
+
+        assert(manager);
+
+        r = device_write_db_snapshot();
+        if (r < 0)
+                log_warning_errno(r, "Failed to write snapshot of the udev database, ignoring: %m");
+
+        manager->db_snapshot_outdated = false;
+        return 1;
+}
+
 static int on_kill_workers_event(sd_event_source *s, uint64_t usec, void *userdata) {
         Manager *manager = userdata;
 
@@ -895,6 +1051,27 @@ static int on_kill_workers_event(sd_event_source *s, uint64_t usec, void *userda
         return 1;
 }
 
+static int on_memory_pressure(sd_event_source *s, void *userdata) {
+        Manager *manager = userdata;
+        struct worker *worker;
+        Iterator i;
+
+        assert(manager);
+
+        /* Idle workers are cheap to respawn, while running ones are busy, hence only kill the former. */
+        log_debug("Under memory pressure, killing idle workers");
+
+        HASHMAP_FOREACH(worker, manager->workers, i) {
+                if (worker->state != WORKER_IDLE)
+                        continue;
+
+                worker->state = WORKER_KILLED;
+                (void) kill(worker->pid, SIGTERM);
+        }
+
+        return 1;
+}
+
 static void event_queue_start(Manager *manager) {
         struct event *event;
         usec_t usec;
@@ -924,7 +1101,7 @@ static void event_queue_start(Manager *manager) {
         udev_builtin_init();
 
         if (!manager->rules) {
-                r = udev_rules_load(&manager->rules, arg_resolve_name_timing);
+                r = udev_rules_load(&manager->rules, arg_resolve_name_timing, true);
                 if (r < 0) {
                         log_warning_errno(r, "Failed to read udev rules: %m");
                         return;
@@ -1146,10 +1323,66 @@ static int on_ctrl_msg(struct udev_ctrl *uctrl, enum udev_ctrl_msg_type type, co
         return 1;
 }
 
-static int synthesize_change_one(sd_device *dev, const char *syspath) {
+static void manager_receive_uevents(Manager *manager) {
+        int fd;
+
+        assert(manager);
+
+        /* Move the uevents the kernel has already sent, but we did not read yet, into our queue. */
+
+        fd = device_monitor_get_fd(manager->monitor);
+        if (fd < 0)
+                return;
+
+        while (fd_wait_for_event(fd, POLLIN, 0) > 0) {
+                _cleanup_(sd_device_unrefp) sd_device *dev = NULL;
+
+                if (device_monitor_receive_device(manager->monitor, &dev) <= 0)
+                        continue;
+
+                (void) on_uevent(manager->monitor, dev, manager);
+        }
+}
+
+static bool manager_has_queued_event(Manager *manager, const char *syspath) {
+        EventIndexBucket *b;
+        EventIndexEntry *e;
+        const char *devpath, *key;
+
+        assert(manager);
+        assert(syspath);
+
+        devpath = path_startswith(syspath, "/sys");
+        if (!devpath)
+                return false;
+
+        /* The "p<devpath>" bucket contains exactly the events for this devpath. */
+        key = strjoina("p/", devpath);
+        b = hashmap_get(manager->event_index, key);
+        if (!b)
+                return false;
+
+        LIST_FOREACH(entries, e, b->entries)
+                if (e->event->state == EVENT_QUEUED)
+                        return true;
+
+        return false;
+}
+
+static int synthesize_change_one(Manager *manager, sd_device *dev, const char *syspath) {
         const char *filename;
         int r;
 
+        assert(manager);
+
+        /* An event for the device which has not been passed to a worker yet will see the new contents
+         * of the device anyway. Don't queue another one, so that devices which are opened for writing
+         * and closed repeatedly, e.g. by databases, are not probed for every single close. */
+        if (manager_has_queued_event(manager, syspath)) {
+                log_device_debug(dev, "device is closed, but an event for %s is already queued, not synthesising 'change'", syspath);
+                return 0;
+        }
+
         filename = strjoina(syspath, "/uevent");
         log_device_debug(dev, "device is closed, synthesising 'change' on %s", syspath);
         r = write_string_file(filename, "change", WRITE_STRING_FILE_DISABLE_BUFFER);
@@ -1158,10 +1391,12 @@ static int synthesize_change_one(sd_device *dev, const char *syspath) {
         return 0;
 }
 
-static int synthesize_change(sd_device *dev) {
+static int synthesize_change(Manager *manager, sd_device *dev) {
         const char *subsystem, *sysname, *devname, *syspath, *devtype;
         int r;
 
+        assert(manager);
+
         r = sd_device_get_subsystem(dev, &subsystem);
         if (r < 0)
                 return r;
@@ -1247,7 +1482,7 @@ static int synthesize_change(sd_device *dev) {
                  * We have partitions but re-reading the partition table did not
                  * work, synthesize "change" for the disk and all partitions.
                  */
-                (void) synthesize_change_one(dev, syspath);
+                (void) synthesize_change_one(manager, dev, syspath);
 
                 FOREACH_DEVICE(e, d) {
                         const char *t, *n, *s;
@@ -1260,11 +1495,69 @@ static int synthesize_change(sd_device *dev) {
                             sd_device_get_syspath(d, &s) < 0)
                                 continue;
 
-                        (void) synthesize_change_one(dev, s);
+                        (void) synthesize_change_one(manager, dev, s);
                 }
 
         } else
-                (void) synthesize_change_one(dev, syspath);
+                (void) synthesize_change_one(manager, dev, syspath);
+
+        return 0;
+}
+
+static int on_watch_delay_event(sd_event_source *s, uint64_t usec, void *userdata) {
+        Manager *manager = userdata;
+        sd_device *dev;
+
+        assert(manager);
+
+        manager_receive_uevents(manager);
+
+        while ((dev = hashmap_steal_first(manager->watch_pending))) {
+                (void) synthesize_change(manager, dev);
+                sd_device_unref(dev);
+        }
+
+        return 1;
+}
+
+static int watch_delay_add(Manager *manager, sd_device *dev) {
+        const char *id;
+        int r;
+
+        assert(manager);
+        assert(dev);
+
+        /* Collect the watched devices which are closed during the delay, and synthesize a single 'change'
+         * for each of them when it is over, rather than one per close. */
+
+        r = device_get_id_filename(dev, &id);
+        if (r < 0)
+                return r;
+
+        if (hashmap_contains(manager->watch_pending, id))
+                return 0;
+
+        r = hashmap_ensure_allocated(&manager->watch_pending, &string_hash_ops);
+        if (r < 0)
+                return log_oom();
+
+        r = hashmap_put(manager->watch_pending, id, dev);
+        if (r < 0)
+                return log_device_debug_errno(dev, r, "Failed to remember closed device: %m");
+
+        sd_device_ref(dev);
+
+        if (event_source_is_enabled(manager->watch_delay_event) > 0)
+                return 0;
+
+        r = event_reset_time(manager->event, &manager->watch_delay_event, CLOCK_MONOTONIC,
+                             now(CLOCK_MONOTONIC) + arg_watch_delay_usec, USEC_PER_MSEC,
+                             on_watch_delay_event, manager, 0, "watch-delay-event", false);
+        if (r < 0) {
+                /* Don't leave the device behind without a timer. */
+                (void) on_watch_delay_event(NULL, 0, manager);
+                return r;
+        }
 
         return 0;
 }
@@ -1301,10 +1594,22 @@ static int on_inotify(sd_event_source *s, int fd, uint32_t revents, void *userda
                         continue;
 
                 log_device_debug(dev, "Inotify event: %x for %s", e->mask, devnode);
-                if (e->mask & IN_CLOSE_WRITE)
-                        synthesize_change(dev);
-                else if (e->mask & IN_IGNORED)
+                if (e->mask & IN_CLOSE_WRITE) {
+                        if (arg_watch_delay_usec > 0) {
+                                (void) watch_delay_add(manager, dev);
+                                continue;
+                        }
+
+                        manager_receive_uevents(manager);
+                        synthesize_change(manager, dev);
+                } else if (e->mask & IN_IGNORED) {
+                        const char *id;
+
+                        if (device_get_id_filename(dev, &id) >= 0)
+                                sd_device_unref(hashmap_remove(manager->watch_pending, id));
+
                         udev_watch_end(dev);
+                }
         }
 
         return 1;
@@ -1406,7 +1711,14 @@ static int on_post(sd_event_source *s, void *userdata) {
         if (!LIST_IS_EMPTY(manager->events))
                 return 1;
 
-        /* There are no pending events. Let's cleanup idle process. */
+        /* There are no pending events. Let's write a snapshot of the database for clients, if it is not
+         * up to date, but wait a bit in case more events are about to arrive. */
+        if (manager->db_snapshot_outdated && !manager->exit && event_source_is_enabled(manager->db_snapshot_event) <= 0)
+                (void) event_reset_time(manager->event, &manager->db_snapshot_event, CLOCK_MONOTONIC,
+                                        now(CLOCK_MONOTONIC) + USEC_PER_SEC, USEC_PER_SEC,
+                                        on_db_snapshot_event, manager, 0, "db-snapshot-event", false);
+
+        /* Let's cleanup idle process. */
 
         if (!hashmap_isempty(manager->workers)) {
                 /* There are idle workers */
@@ -1506,6 +1818,13 @@ static int parse_proc_cmdline_item(const char *key, const char *value, void *dat
 
                 r = parse_sec(value, &arg_exec_delay_usec);
 
+        } else if (proc_cmdline_key_streq(key, "udev.watch_delay")) {
+
+                if (proc_cmdline_value_missing(key, value))
+                        return 0;
+
+                r = parse_sec(value, &arg_watch_delay_usec);
+
         } else if (proc_cmdline_key_streq(key, "udev.timeout_signal")) {
 
                 if (proc_cmdline_value_missing(key, value))
@@ -1667,6 +1986,7 @@ static int manager_new(Manager **ret, int fd_ctrl, int fd_uevent, const char *cg
                 .fd_inotify = -1,
                 .worker_watch = { -1, -1 },
                 .cgroup = cgroup,
+                .db_snapshot_outdated = true,
         };
 
         r = udev_ctrl_new_from_fd(&manager->ctrl, fd_ctrl);
@@ -1742,6 +2062,10 @@ static int main_loop(Manager *manager) {
         if (r < 0)
                 return log_error_errno(r, "Failed to create SIGCHLD event source: %m");
 
+        r = sd_event_add_memory_pressure(manager->event, &manager->memory_pressure_event, on_memory_pressure, manager);
+        if (r < 0)
+                log_debug_errno(r, "Failed to watch for memory pressure, ignoring: %m");
+
         r = sd_event_set_watchdog(manager->event, true);
         if (r < 0)
                 return log_error_errno(r, "Failed to create watchdog event source: %m");
@@ -1786,7 +2110,7 @@ static int main_loop(Manager *manager) {
 
         udev_builtin_init();
 
-        r = udev_rules_load(&manager->rules, arg_resolve_name_timing);
+        r = udev_rules_load(&manager->rules, arg_resolve_name_timing, true);
         if (!manager->rules)
                 return log_error_errno(r, "Failed to read udev rules: %m");
 
@@ -1816,7 +2140,7 @@ int run_udevd(int argc, char *argv[]) {
 
         log_set_target(LOG_TARGET_AUTO);
         log_open();
-        udev_parse_config_full(&arg_children_max, &arg_exec_delay_usec, &arg_event_timeout_usec, &arg_resolve_name_timing, &arg_timeout_signal);
+        udev_parse_config_full(&arg_children_max, &arg_exec_delay_usec, &arg_event_timeout_usec, &arg_watch_delay_usec, &arg_resolve_name_timing, &arg_timeout_signal);
         log_parse_environment();
         log_open(); /* Done again to update after reading configuration. */
 
@@ -17,6 +17,11 @@
 
 #define LISTEN_TIMEOUT_USEC (25 * USEC_PER_SEC)
 
+/* If workers ask for more workers again within this time, the connection queue is not draining, and the
+ * number of workers added for each request is doubled, up to the maximum step. */
+#define WORKER_SCALE_WINDOW_USEC (1 * USEC_PER_SEC)
+#define WORKER_SCALE_STEP_MAX 64U
+
 static int start_workers(Manager *m, bool explicit_request);
 
 static int on_sigchld(sd_event_source *s, const struct signalfd_siginfo *si, void *userdata) {
@@ -221,30 +226,50 @@ static int start_one_worker(Manager *m) {
         return 0;
 }
 
+static size_t manager_scale_step(Manager *m) {
+        usec_t n;
+
+        assert(m);
+
+        n = now(CLOCK_MONOTONIC);
+
+        if (m->scale_step > 0 && n < usec_add(m->last_scale_usec, WORKER_SCALE_WINDOW_USEC))
+                m->scale_step = MIN(m->scale_step * 2, WORKER_SCALE_STEP_MAX);
+        else
+                m->scale_step = 1;
+
+        m->last_scale_usec = n;
+        return m->scale_step;
+}
+
 static int start_workers(Manager *m, bool explicit_request) {
+        size_t n, target;
         int r;
 
         assert(m);
 
-        for (;;)  {
-                size_t n;
+        n = manager_current_workers(m);
+        target = MAX(n, (size_t) USERDB_WORKERS_MIN);
+        if (explicit_request)
+                target = MIN(MAX(target, n + manager_scale_step(m)), (size_t) USERDB_WORKERS_MAX);
 
-                n = manager_current_workers(m);
-                if (n >= USERDB_WORKERS_MIN && (!explicit_request || n >= USERDB_WORKERS_MAX))
-                        break;
+        if (n >= target)
+                return 0;
 
-                if (!ratelimit_below(&m->worker_ratelimit)) {
-                        /* If we keep starting workers too often, let's fail the whole daemon, something is wrong */
-                        sd_event_exit(m->event, EXIT_FAILURE);
+        if (!ratelimit_below(&m->worker_ratelimit)) {
+                /* If we keep starting workers too often, let's fail the whole daemon, something is wrong */
+                sd_event_exit(m->event, EXIT_FAILURE);
 
-                        return log_error_errno(SYNTHETIC_ERRNO(EUCLEAN), "Worker threads requested too frequently, something is wrong.");
-                }
+                return log_error_errno(SYNTHETIC_ERRNO(EUCLEAN), "Worker threads requested too frequently, something is wrong.");
+        }
+
+        if (target - n > 1)
+                log_debug("Starting %zu more workers.", target - n);
 
+        for (; n < target; n++) {
                 r = start_one_worker(m);
                 if (r < 0)
                         return r;
-
-                explicit_request = false;
         }
 
         return 0;
@@ -25,6 +25,10 @@ struct Manager {
         int listen_fd;
 
         RateLimit worker_ratelimit;
+
+        /* Number of workers added for the last explicit request, and when that happened */
+        size_t scale_step;
+        usec_t last_scale_usec;
 };
 
 int manager_new(Manager **ret);
@@ -39,6 +39,14 @@ if [ ! -e "$D/etc/udev/hwdb.bin" ]; then
     exit 1
 fi
 
+# The database is not rebuilt if the sources didn't change
+inode=$(stat -c %i "$D/etc/udev/hwdb.bin")
+"$SYSTEMD_HWDB" update --root "$D"
+if [ "$(stat -c %i "$D/etc/udev/hwdb.bin")" != "$inode" ]; then
+    echo "$D/etc/udev/hwdb.bin was rebuilt even though the sources didn't change"
+    exit 1
+fi
+
 # Test "bad" properties" — warnings required, errors not allowed
 rm -f "$D/etc/udev/hwdb.bin" "$D/etc/udev/hwdb.d"
 
@@ -60,3 +68,10 @@ if [ ! -e "$D/etc/udev/hwdb.bin" ]; then
     echo "$D/etc/udev/hwdb.bin was not generated"
     exit 1
 fi
+
+# Warnings are shown again, as databases built from bad sources are always rebuilt
+err=$("$SYSTEMD_HWDB" update --root "$D" 2>&1 >/dev/null) && rc= || rc=$?
+if [ -z "$err" ]; then
+    echo "$SYSTEMD_HWDB printed no warnings the second time"
+    exit 1
+fi
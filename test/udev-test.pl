@@ -134,6 +134,29 @@ EOF
                 rules           => <<EOF
 KERNEL=="*ACM1", SYMLINK+="bad"
 KERNEL=="*ACM0", SYMLINK+="modem/%n"
+EOF
+        },
+        {
+                desc            => "catch device by prefix alternatives",
+                devpath         => "/devices/pci0000:00/0000:00:1d.7/usb5/5-2/5-2:1.0/tty/ttyACM0",
+                exp_name        => "modem/0",
+                not_exp_name    => "bad",
+                rules           => <<EOF
+KERNEL=="ttyUSB*|ttyS*", SYMLINK+="bad"
+KERNEL=="ttyUSB*|ttyACM*", SYMLINK+="modem/%n"
+EOF
+        },
+        {
+                desc            => "skip consecutive rules with the same non-matching key",
+                devpath         => "/devices/pci0000:00/0000:00:1d.7/usb5/5-2/5-2:1.0/tty/ttyACM0",
+                exp_name        => "modem/0",
+                not_exp_name    => "bad",
+                rules           => <<EOF
+SUBSYSTEM=="block", SYMLINK+="bad"
+SUBSYSTEM=="block", SYMLINK+="bad"
+SUBSYSTEM=="block", KERNEL=="ttyACM0", SYMLINK+="bad"
+SUBSYSTEM=="tty", KERNEL=="ttyUSB*", SYMLINK+="bad"
+SUBSYSTEM=="tty", KERNEL=="ttyACM*", SYMLINK+="modem/%n"
 EOF
         },
         {